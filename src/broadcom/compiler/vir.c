@@ -926,6 +926,17 @@ uint64_t *v3d_compile(const struct v3d_compiler *compiler,
 
         v3d_optimize_nir(c->s);
         NIR_PASS_V(c->s, nir_lower_bool_to_int32);
+
+        /* Issue the TMU and VPM accesses early, but keep few enough temps
+         * live to allow 4 threads.  The VPM is where both the VS inputs
+         * and outputs live, so they mustn't be reordered.
+         */
+        nir_schedule_options schedule_options = {
+                .threshold = 24,
+                .stages_with_shared_io_memory = 1 << MESA_SHADER_VERTEX,
+        };
+        NIR_PASS_V(c->s, nir_schedule, &schedule_options);
+
         NIR_PASS_V(c->s, nir_convert_from_ssa, true);
 
         v3d_nir_to_vir(c);
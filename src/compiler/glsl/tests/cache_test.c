@@ -493,6 +493,221 @@ test_put_key_and_get_key(void)
 
    disk_cache_destroy(cache);
 }
+
+static void
+test_single_file(void)
+{
+   struct disk_cache *cache;
+   char blob[] = "This is a blob of thirty-seven bytes";
+   uint8_t blob_key[20];
+   const size_t big_size = 300 * 1024;
+   uint8_t *big;
+   uint8_t big_keys[4][20];
+   uint32_t seed = 1;
+   char *result;
+   size_t size;
+   int i;
+
+   setenv("MESA_DISK_CACHE_SINGLE_FILE", "true", 1);
+   setenv("MESA_GLSL_CACHE_MAX_SIZE", "1M", 1);
+   cache = disk_cache_create("test", "make_check", 0);
+
+   disk_cache_compute_key(cache, blob, sizeof(blob), blob_key);
+   disk_cache_put(cache, blob_key, blob, sizeof(blob), NULL);
+   wait_until_file_written(cache, blob_key);
+
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_equal_str(blob, result, "single file: disk_cache_get (pointer)");
+   expect_equal(size, sizeof(blob), "single file: disk_cache_get (size)");
+   free(result);
+
+   expect_equal(access(CACHE_TEST_TMP "/mesa-glsl-cache-dir/"
+                       CACHE_DIR_NAME "/mesa_cache.db", F_OK), 0,
+                "single file: database file created");
+
+   /* A new cache object has to find the entry in the file, like another
+    * process would.
+    */
+   disk_cache_destroy(cache);
+   cache = disk_cache_create("test", "make_check", 0);
+
+   expect_true(does_cache_contain(cache, blob_key),
+               "single file: disk_cache_get after reopening");
+
+   disk_cache_remove(cache, blob_key);
+   expect_true(!does_cache_contain(cache, blob_key),
+               "single file: disk_cache_remove");
+
+   /* Add incompressible entries until the file grows past 1M, the
+    * compaction should then drop the oldest ones.
+    */
+   big = malloc(big_size);
+   for (i = 0; i < 4; i++) {
+      for (size_t j = 0; j < big_size; j++) {
+         seed = seed * 1103515245 + 12345;
+         big[j] = seed >> 16;
+      }
+
+      disk_cache_compute_key(cache, big, big_size, big_keys[i]);
+      disk_cache_put(cache, big_keys[i], big, big_size, NULL);
+      wait_until_file_written(cache, big_keys[i]);
+   }
+   free(big);
+
+   /* The compaction runs after the put, give it some time to finish. */
+   for (i = 0; i < 20 && does_cache_contain(cache, big_keys[0]); i++) {
+      struct timespec req = { 0, 100000000 };
+      nanosleep(&req, NULL);
+   }
+
+   expect_true(!does_cache_contain(cache, big_keys[0]),
+               "single file: compaction evicts the oldest entry");
+   expect_true(does_cache_contain(cache, big_keys[3]),
+               "single file: compaction keeps the newest entry");
+
+   result = disk_cache_get(cache, big_keys[3], &size);
+   expect_equal(size, big_size, "single file: get after compaction (size)");
+   free(result);
+
+   disk_cache_destroy(cache);
+
+   unsetenv("MESA_DISK_CACHE_SINGLE_FILE");
+}
+
+static void
+test_lru_eviction(void)
+{
+   struct disk_cache *cache;
+   struct disk_cache_stats stats;
+   const size_t entry_size = 10 * 1024;
+   uint8_t *entries[3];
+   uint8_t keys[3][20];
+   uint32_t seed = 1;
+   void *result;
+   int i;
+
+   /* Three incompressible entries, only two of which fit. */
+   for (i = 0; i < 3; i++) {
+      entries[i] = malloc(entry_size);
+      for (size_t j = 0; j < entry_size; j++) {
+         seed = seed * 1103515245 + 12345;
+         entries[i][j] = seed >> 16;
+      }
+   }
+
+   setenv("MESA_GLSL_CACHE_DIR", CACHE_TEST_TMP "/lru", 1);
+   setenv("MESA_GLSL_CACHE_MAX_SIZE", "32K", 1);
+   cache = disk_cache_create("test", "make_check", 0);
+
+   for (i = 0; i < 3; i++)
+      disk_cache_compute_key(cache, entries[i], entry_size, keys[i]);
+
+   disk_cache_put(cache, keys[0], entries[0], entry_size, NULL);
+   disk_cache_put(cache, keys[1], entries[1], entry_size, NULL);
+   disk_cache_wait_for_idle(cache);
+
+   /* Using the first entry makes the second one the least recently used. */
+   result = disk_cache_get(cache, keys[0], NULL);
+   expect_non_null(result, "lru: disk_cache_get of first entry");
+   free(result);
+
+   disk_cache_put(cache, keys[2], entries[2], entry_size, NULL);
+   disk_cache_wait_for_idle(cache);
+
+   expect_true(does_cache_contain(cache, keys[0]),
+               "lru: recently used entry is kept");
+   expect_true(!does_cache_contain(cache, keys[1]),
+               "lru: least recently used entry is evicted");
+   expect_true(does_cache_contain(cache, keys[2]),
+               "lru: new entry is stored");
+
+   disk_cache_get_stats(cache, &stats);
+   expect_equal(stats.puts, 3, "stats: puts");
+   expect_equal(stats.hits, 3, "stats: hits");
+   expect_equal(stats.misses, 1, "stats: misses");
+   expect_equal(stats.evictions, 1, "stats: evictions");
+   expect_equal(stats.bytes_written, 3 * entry_size, "stats: bytes written");
+   expect_true(stats.size > 0 && stats.size <= stats.max_size,
+               "stats: size within the maximum");
+
+   disk_cache_destroy(cache);
+
+   /* The next cache object evicts using the index saved by this one. */
+   expect_true(access(CACHE_TEST_TMP "/lru/mesa_shader_cache/eviction_index", F_OK) == 0,
+               "lru: eviction index saved");
+
+   cache = disk_cache_create("test", "make_check", 0);
+   disk_cache_put(cache, keys[1], entries[1], entry_size, NULL);
+   disk_cache_wait_for_idle(cache);
+
+   disk_cache_get_stats(cache, &stats);
+   expect_equal(stats.evictions, 1, "lru: eviction with the saved index");
+   expect_true(does_cache_contain(cache, keys[1]),
+               "lru: entry stored with the saved index");
+   int evicted = does_cache_contain(cache, keys[0]) ? 2 : 0;
+   disk_cache_destroy(cache);
+
+   /* A corrupt index is ignored, the directory is scanned instead. */
+   FILE *index = fopen(CACHE_TEST_TMP "/lru/mesa_shader_cache/eviction_index", "r+");
+   expect_non_null(index, "lru: open eviction index");
+   fputs("garbage", index);
+   fclose(index);
+
+   cache = disk_cache_create("test", "make_check", 0);
+   disk_cache_put(cache, keys[evicted], entries[evicted], entry_size, NULL);
+   disk_cache_wait_for_idle(cache);
+
+   disk_cache_get_stats(cache, &stats);
+   expect_equal(stats.evictions, 1, "lru: eviction with a corrupt index");
+   disk_cache_destroy(cache);
+
+   for (i = 0; i < 3; i++)
+      free(entries[i]);
+
+   setenv("MESA_GLSL_CACHE_DIR", CACHE_TEST_TMP "/mesa-glsl-cache-dir", 1);
+}
+
+static void
+test_memory_cache(void)
+{
+   struct disk_cache *cache;
+   char blob[] = "This is a blob of thirty-seven bytes";
+   char string[] = "While this string has thirty-four";
+   uint8_t blob_key[20];
+   uint8_t string_key[20];
+   int err;
+
+   setenv("MESA_DISK_CACHE_MEMORY_SIZE", "1M", 1);
+   cache = disk_cache_create("test", "make_check", 0);
+
+   disk_cache_compute_key(cache, blob, sizeof(blob), blob_key);
+   disk_cache_compute_key(cache, string, sizeof(string), string_key);
+   disk_cache_put(cache, blob_key, blob, sizeof(blob), NULL);
+   disk_cache_put(cache, string_key, string, sizeof(string), NULL);
+   disk_cache_wait_for_idle(cache);
+   disk_cache_destroy(cache);
+
+   /* Only prefetched items should survive the files going away. */
+   cache = disk_cache_create("test", "make_check", 0);
+   disk_cache_prefetch(cache, (const cache_key *) &blob_key, 1);
+   disk_cache_wait_for_idle(cache);
+
+   err = rmrf_local(CACHE_TEST_TMP "/mesa-glsl-cache-dir");
+   expect_equal(err, 0, "Removing the cache directory");
+
+   expect_true(does_cache_contain(cache, blob_key),
+               "memory cache: disk_cache_get of prefetched item");
+   expect_true(!does_cache_contain(cache, string_key),
+               "memory cache: disk_cache_get of item not prefetched");
+
+   disk_cache_remove(cache, blob_key);
+   expect_true(!does_cache_contain(cache, blob_key),
+               "memory cache: disk_cache_remove");
+
+   disk_cache_destroy(cache);
+
+   setenv("MESA_DISK_CACHE_MEMORY_SIZE", "0", 1);
+}
 #endif /* ENABLE_SHADER_CACHE */
 
 int
@@ -501,12 +716,21 @@ main(void)
 #ifdef ENABLE_SHADER_CACHE
    int err;
 
+   /* Most tests check what made it to disk. */
+   setenv("MESA_DISK_CACHE_MEMORY_SIZE", "0", 1);
+
    test_disk_cache_create();
 
    test_put_and_get();
 
    test_put_key_and_get_key();
 
+   test_single_file();
+
+   test_memory_cache();
+
+   test_lru_eviction();
+
    err = rmrf_local(CACHE_TEST_TMP);
    expect_equal(err, 0, "Removing " CACHE_TEST_TMP " again");
 #endif /* ENABLE_SHADER_CACHE */
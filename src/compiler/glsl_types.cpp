@@ -26,6 +26,7 @@
 #include "compiler/glsl/glsl_parser_extras.h"
 #include "glsl_types.h"
 #include "util/hash_table.h"
+#include "util/u_atomic.h"
 #include "util/u_string.h"
 
 
@@ -43,6 +44,28 @@ hash_table *glsl_type::subroutine_types = NULL;
  */
 static uint32_t glsl_type_users = 0;
 
+/* Lock-free cache in front of array_types.
+ *
+ * Array types are by far the most looked up derived types, and they are
+ * looked up by every thread compiling shaders.  Lookups hitting the cache
+ * neither format a key nor take hash_mutex.  Types are only published once
+ * they are fully constructed, in the first free slot of a short probe
+ * sequence, and slots are only cleared once the last user is gone, so a
+ * slot that was read as filled keeps its type.
+ */
+#define ARRAY_TYPE_CACHE_SIZE 1024
+#define ARRAY_TYPE_CACHE_PROBES 8
+
+static const glsl_type *array_type_cache[ARRAY_TYPE_CACHE_SIZE];
+
+static unsigned
+array_type_cache_hash(const glsl_type *base, unsigned array_size,
+                      unsigned explicit_stride)
+{
+   return _mesa_hash_pointer(base) ^
+          (array_size * 0x9e3779b1u) ^ (explicit_stride * 0x85ebca6bu);
+}
+
 glsl_type::glsl_type(GLenum gl_type,
                      glsl_base_type base_type, unsigned vector_elements,
                      unsigned matrix_columns, const char *name,
@@ -504,6 +527,7 @@ glsl_type_singleton_decref()
    if (glsl_type::array_types != NULL) {
       _mesa_hash_table_destroy(glsl_type::array_types, hash_free_type_function);
       glsl_type::array_types = NULL;
+      memset(array_type_cache, 0, sizeof(array_type_cache));
    }
 
    if (glsl_type::struct_types != NULL) {
@@ -994,6 +1018,20 @@ glsl_type::get_array_instance(const glsl_type *base,
                               unsigned array_size,
                               unsigned explicit_stride)
 {
+   const unsigned hash =
+      array_type_cache_hash(base, array_size, explicit_stride);
+
+   for (unsigned i = 0; i < ARRAY_TYPE_CACHE_PROBES; i++) {
+      const glsl_type *t =
+         p_atomic_read(&array_type_cache[(hash + i) % ARRAY_TYPE_CACHE_SIZE]);
+      if (t == NULL)
+         break;
+
+      if (t->fields.array == base && t->length == array_size &&
+          t->explicit_stride == explicit_stride)
+         return t;
+   }
+
    /* Generate a name using the base type pointer in the key.  This is
     * done because the name of the base type may not be unique across
     * shaders.  For example, two shaders may have different record types
@@ -1023,9 +1061,19 @@ glsl_type::get_array_instance(const glsl_type *base,
    assert(((glsl_type *) entry->data)->length == array_size);
    assert(((glsl_type *) entry->data)->fields.array == base);
 
+   const glsl_type *t = (const glsl_type *) entry->data;
+   for (unsigned i = 0; i < ARRAY_TYPE_CACHE_PROBES; i++) {
+      const glsl_type *old =
+         (const glsl_type *) p_atomic_cmpxchg(
+            &array_type_cache[(hash + i) % ARRAY_TYPE_CACHE_SIZE],
+            (const glsl_type *) NULL, t);
+      if (old == NULL || old == t)
+         break;
+   }
+
    mtx_unlock(&glsl_type::hash_mutex);
 
-   return (glsl_type *) entry->data;
+   return t;
 }
 
 
@@ -66,6 +66,8 @@ nir_shader_create(void *mem_ctx,
    shader->num_uniforms = 0;
    shader->num_shared = 0;
 
+   shader->instr_ctx = ralloc_arena_context(shader);
+
    return shader;
 }
 
@@ -427,7 +429,7 @@ nir_alu_instr_create(nir_shader *shader, nir_op op)
    unsigned num_srcs = nir_op_infos[op].num_inputs;
    /* TODO: don't use rzalloc */
    nir_alu_instr *instr =
-      rzalloc_size(shader,
+      rzalloc_size(shader->instr_ctx,
                    sizeof(nir_alu_instr) + num_srcs * sizeof(nir_alu_src));
 
    instr_init(&instr->instr, nir_instr_type_alu);
@@ -443,7 +445,7 @@ nir_deref_instr *
 nir_deref_instr_create(nir_shader *shader, nir_deref_type deref_type)
 {
    nir_deref_instr *instr =
-      rzalloc_size(shader, sizeof(nir_deref_instr));
+      rzalloc_size(shader->instr_ctx, sizeof(nir_deref_instr));
 
    instr_init(&instr->instr, nir_instr_type_deref);
 
@@ -463,7 +465,7 @@ nir_deref_instr_create(nir_shader *shader, nir_deref_type deref_type)
 nir_jump_instr *
 nir_jump_instr_create(nir_shader *shader, nir_jump_type type)
 {
-   nir_jump_instr *instr = ralloc(shader, nir_jump_instr);
+   nir_jump_instr *instr = ralloc(shader->instr_ctx, nir_jump_instr);
    instr_init(&instr->instr, nir_instr_type_jump);
    instr->type = type;
    return instr;
@@ -474,7 +476,8 @@ nir_load_const_instr_create(nir_shader *shader, unsigned num_components,
                             unsigned bit_size)
 {
    nir_load_const_instr *instr =
-      rzalloc_size(shader, sizeof(*instr) + num_components * sizeof(*instr->value));
+      rzalloc_size(shader->instr_ctx,
+                   sizeof(*instr) + num_components * sizeof(*instr->value));
    instr_init(&instr->instr, nir_instr_type_load_const);
 
    nir_ssa_def_init(&instr->instr, &instr->def, num_components, bit_size, NULL);
@@ -488,7 +491,7 @@ nir_intrinsic_instr_create(nir_shader *shader, nir_intrinsic_op op)
    unsigned num_srcs = nir_intrinsic_infos[op].num_srcs;
    /* TODO: don't use rzalloc */
    nir_intrinsic_instr *instr =
-      rzalloc_size(shader,
+      rzalloc_size(shader->instr_ctx,
                   sizeof(nir_intrinsic_instr) + num_srcs * sizeof(nir_src));
 
    instr_init(&instr->instr, nir_instr_type_intrinsic);
@@ -508,7 +511,7 @@ nir_call_instr_create(nir_shader *shader, nir_function *callee)
 {
    const unsigned num_params = callee->num_params;
    nir_call_instr *instr =
-      rzalloc_size(shader, sizeof(*instr) +
+      rzalloc_size(shader->instr_ctx, sizeof(*instr) +
                    num_params * sizeof(instr->params[0]));
 
    instr_init(&instr->instr, nir_instr_type_call);
@@ -531,7 +534,7 @@ static int8_t default_tg4_offsets[4][2] =
 nir_tex_instr *
 nir_tex_instr_create(nir_shader *shader, unsigned num_srcs)
 {
-   nir_tex_instr *instr = rzalloc(shader, nir_tex_instr);
+   nir_tex_instr *instr = rzalloc(shader->instr_ctx, nir_tex_instr);
    instr_init(&instr->instr, nir_instr_type_tex);
 
    dest_init(&instr->dest);
@@ -599,7 +602,7 @@ nir_tex_instr_has_explicit_tg4_offsets(nir_tex_instr *tex)
 nir_phi_instr *
 nir_phi_instr_create(nir_shader *shader)
 {
-   nir_phi_instr *instr = ralloc(shader, nir_phi_instr);
+   nir_phi_instr *instr = ralloc(shader->instr_ctx, nir_phi_instr);
    instr_init(&instr->instr, nir_instr_type_phi);
 
    dest_init(&instr->dest);
@@ -610,7 +613,8 @@ nir_phi_instr_create(nir_shader *shader)
 nir_parallel_copy_instr *
 nir_parallel_copy_instr_create(nir_shader *shader)
 {
-   nir_parallel_copy_instr *instr = ralloc(shader, nir_parallel_copy_instr);
+   nir_parallel_copy_instr *instr =
+      ralloc(shader->instr_ctx, nir_parallel_copy_instr);
    instr_init(&instr->instr, nir_instr_type_parallel_copy);
 
    exec_list_make_empty(&instr->entries);
@@ -623,7 +627,7 @@ nir_ssa_undef_instr_create(nir_shader *shader,
                            unsigned num_components,
                            unsigned bit_size)
 {
-   nir_ssa_undef_instr *instr = ralloc(shader, nir_ssa_undef_instr);
+   nir_ssa_undef_instr *instr = ralloc(shader->instr_ctx, nir_ssa_undef_instr);
    instr_init(&instr->instr, nir_instr_type_ssa_undef);
 
    nir_ssa_def_init(&instr->instr, &instr->def, num_components, bit_size, NULL);
@@ -860,6 +864,8 @@ nir_instr_insert(nir_cursor cursor, nir_instr *instr)
 
    if (instr->type == nir_instr_type_jump)
       nir_handle_add_jump(instr->block);
+
+   nir_metadata_mark_changed(&instr->block->cf_node);
 }
 
 static bool
@@ -899,6 +905,8 @@ remove_defs_uses(nir_instr *instr)
 
 void nir_instr_remove_v(nir_instr *instr)
 {
+   nir_metadata_mark_changed(&instr->block->cf_node);
+
    remove_defs_uses(instr);
    exec_node_remove(&instr->node);
 
@@ -1339,6 +1347,26 @@ nir_src_is_dynamically_uniform(nir_src src)
    return false;
 }
 
+/**
+ * Returns true if the source is known to be dynamically uniform, either by
+ * nir_src_is_dynamically_uniform() or by divergence analysis, when the
+ * divergence metadata of the function is still valid.
+ */
+bool
+nir_src_is_known_uniform(nir_src src)
+{
+   if (nir_src_is_dynamically_uniform(src))
+      return true;
+
+   if (!src.is_ssa || src.ssa->parent_instr->block == NULL)
+      return false;
+
+   nir_function_impl *impl =
+      nir_cf_node_get_function(&src.ssa->parent_instr->block->cf_node);
+   return (impl->valid_metadata & nir_metadata_divergence) &&
+          !nir_src_is_divergent(src);
+}
+
 static void
 src_remove_all_uses(nir_src *src)
 {
@@ -1374,9 +1402,18 @@ src_add_all_uses(nir_src *src, nir_instr *parent_instr, nir_if *parent_if)
    }
 }
 
+static void
+instr_mark_changed(nir_instr *instr)
+{
+   if (instr->block)
+      nir_metadata_mark_changed(&instr->block->cf_node);
+}
+
 void
 nir_instr_rewrite_src(nir_instr *instr, nir_src *src, nir_src new_src)
 {
+   instr_mark_changed(instr);
+
    assert(!src_is_valid(src) || src->parent_instr == instr);
 
    src_remove_all_uses(src);
@@ -1389,6 +1426,8 @@ nir_instr_move_src(nir_instr *dest_instr, nir_src *dest, nir_src *src)
 {
    assert(!src_is_valid(dest) || dest->parent_instr == dest_instr);
 
+   instr_mark_changed(dest_instr);
+
    src_remove_all_uses(dest);
    src_remove_all_uses(src);
    *dest = *src;
@@ -1402,6 +1441,8 @@ nir_if_rewrite_condition(nir_if *if_stmt, nir_src new_src)
    nir_src *src = &if_stmt->condition;
    assert(!src_is_valid(src) || src->parent_if == if_stmt);
 
+   nir_metadata_mark_changed(&if_stmt->cf_node);
+
    src_remove_all_uses(src);
    *src = new_src;
    src_add_all_uses(src, NULL, if_stmt);
@@ -1410,6 +1451,8 @@ nir_if_rewrite_condition(nir_if *if_stmt, nir_src new_src)
 void
 nir_instr_rewrite_dest(nir_instr *instr, nir_dest *dest, nir_dest new_dest)
 {
+   instr_mark_changed(instr);
+
    if (dest->is_ssa) {
       /* We can only overwrite an SSA destination if it has no uses. */
       assert(list_empty(&dest->ssa.uses) && list_empty(&dest->ssa.if_uses));
@@ -1443,6 +1486,7 @@ nir_ssa_def_init(nir_instr *instr, nir_ssa_def *def,
    list_inithead(&def->if_uses);
    def->num_components = num_components;
    def->bit_size = bit_size;
+   def->divergent = true; /* This is the safer default */
 
    if (instr->block) {
       nir_function_impl *impl =
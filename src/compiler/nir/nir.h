@@ -556,6 +556,14 @@ typedef struct nir_ssa_def {
 
    /* The bit-size of each channel; must be one of 8, 16, 32, or 64 */
    uint8_t bit_size;
+
+   /**
+    * True if this value may differ between the invocations of a subgroup.
+    *
+    * Only meaningful while nir_metadata_divergence is valid, and
+    * conservatively true otherwise.
+    */
+   bool divergent;
 } nir_ssa_def;
 
 struct nir_src;
@@ -696,6 +704,13 @@ nir_src_is_const(nir_src src)
           src.ssa->parent_instr->type == nir_instr_type_load_const;
 }
 
+/** Register sources are always assumed to be divergent. */
+static inline bool
+nir_src_is_divergent(nir_src src)
+{
+   return !src.is_ssa || src.ssa->divergent;
+}
+
 int64_t nir_src_as_int(nir_src src);
 uint64_t nir_src_as_uint(nir_src src);
 bool nir_src_as_bool(nir_src src);
@@ -1988,6 +2003,28 @@ typedef struct {
    struct list_head loop_terminator_link;
 } nir_loop_terminator;
 
+/**
+ * A basic induction variable of a loop: a phi in the loop header which is
+ * initialized outside of the loop and updated by a binary ALU operation with
+ * a loop-invariant operand on each iteration.
+ */
+typedef struct {
+   /** The phi holding the value of the variable for the current iteration. */
+   nir_ssa_def *def;
+
+   /** Value of the variable when entering the loop, defined before it. */
+   nir_ssa_def *init;
+
+   /**
+    * Loop-invariant operand of ::update.  Unlike ::init, it may be computed
+    * inside the loop from loop-invariant values.
+    */
+   nir_ssa_def *step;
+
+   /** Computes the value for the next iteration from ::def and ::step. */
+   nir_alu_instr *update;
+} nir_loop_induction_variable;
+
 typedef struct {
    /* Estimated cost (in number of instructions) of the loop */
    unsigned instr_cost;
@@ -2014,6 +2051,10 @@ typedef struct {
 
    /* A list of loop_terminators terminating this loop. */
    struct list_head loop_terminator_list;
+
+   /* Basic induction variables of the loop */
+   nir_loop_induction_variable *induction_vars;
+   unsigned num_induction_vars;
 } nir_loop_info;
 
 typedef enum {
@@ -2043,6 +2084,14 @@ typedef enum {
    nir_metadata_live_ssa_defs = 0x4,
    nir_metadata_not_properly_reset = 0x8,
    nir_metadata_loop_analysis = 0x10,
+   nir_metadata_divergence = 0x20,
+
+   /** Set by nir_validate_shader() on the functions it checked.  Since it is
+    * dropped by nir_metadata_preserve() and by the core instruction and
+    * control-flow helpers, debug builds only validate again the functions
+    * that were changed since.
+    */
+   nir_metadata_validated = 0x40,
 } nir_metadata;
 
 typedef struct {
@@ -2237,6 +2286,17 @@ typedef enum {
    nir_lower_fp64_full_software = (1 << 9),
 } nir_lower_doubles_options;
 
+typedef enum {
+   /** Each subgroup only ever contains invocations of one primitive */
+   nir_divergence_single_prim_per_subgroup = (1 << 0),
+   /** Each subgroup only ever contains invocations of one patch */
+   nir_divergence_single_patch_per_tcs_subgroup = (1 << 1),
+   /** Each subgroup only ever contains invocations of one patch */
+   nir_divergence_single_patch_per_tes_subgroup = (1 << 2),
+   /** Each subgroup only ever contains invocations of one view */
+   nir_divergence_view_index_uniform = (1 << 3),
+} nir_divergence_options;
+
 typedef struct nir_shader_compiler_options {
    bool lower_fdiv;
    bool lower_ffma;
@@ -2390,8 +2450,18 @@ typedef struct nir_shader_compiler_options {
 
    unsigned max_unroll_iterations;
 
+   /**
+    * Largest factor by which nir_opt_loop_unroll() partially unrolls loops
+    * with a known trip count which are too large to be unrolled completely.
+    * 0 or 1 disables it.
+    */
+   unsigned max_partial_unroll_factor;
+
    nir_lower_int64_options lower_int64_options;
    nir_lower_doubles_options lower_doubles_options;
+
+   /** Options for nir_divergence_analysis() */
+   nir_divergence_options divergence_analysis_options;
 } nir_shader_compiler_options;
 
 typedef struct nir_shader {
@@ -2441,6 +2511,13 @@ typedef struct nir_shader {
     */
    void *constant_data;
    unsigned constant_data_size;
+
+   /** Arena context the instructions are allocated from.
+    *
+    * Instructions are carved out of it in the order they are created, and
+    * nir_sweep() moves the live ones to a new one in program order.
+    */
+   void *instr_ctx;
 } nir_shader;
 
 #define nir_foreach_function(func, shader) \
@@ -2516,6 +2593,13 @@ void nir_metadata_require(nir_function_impl *impl, nir_metadata required, ...);
 /** dirties all but the preserved metadata */
 void nir_metadata_preserve(nir_function_impl *impl, nir_metadata preserved);
 
+#ifndef NDEBUG
+/** marks the function containing \p node as needing to be validated again */
+void nir_metadata_mark_changed(nir_cf_node *node);
+#else
+static inline void nir_metadata_mark_changed(nir_cf_node *node) { (void) node; }
+#endif
+
 /** creates an instruction with default swizzle/writemask/etc. with NULL registers */
 nir_alu_instr *nir_alu_instr_create(nir_shader *shader, nir_op op);
 
@@ -2813,6 +2897,7 @@ NIR_SRC_AS_(intrinsic, nir_intrinsic_instr,
 NIR_SRC_AS_(deref, nir_deref_instr, nir_instr_type_deref, nir_instr_as_deref)
 
 bool nir_src_is_dynamically_uniform(nir_src src);
+bool nir_src_is_known_uniform(nir_src src);
 bool nir_srcs_equal(nir_src src1, nir_src src2);
 void nir_instr_rewrite_src(nir_instr *instr, nir_src *src, nir_src new_src);
 void nir_instr_move_src(nir_instr *dest_instr, nir_src *dest, nir_src *src);
@@ -2913,6 +2998,7 @@ void nir_print_deref(const nir_deref_instr *deref, FILE *fp);
 nir_alu_instr *nir_alu_instr_clone(nir_shader *s, const nir_alu_instr *orig);
 
 nir_shader *nir_shader_clone(void *mem_ctx, const nir_shader *s);
+nir_instr *nir_instr_clone(nir_shader *shader, const nir_instr *orig);
 nir_function_impl *nir_function_impl_clone(nir_shader *shader,
                                            const nir_function_impl *fi);
 nir_constant *nir_constant_clone(const nir_constant *c, nir_variable *var);
@@ -2922,6 +3008,7 @@ nir_shader *nir_shader_serialize_deserialize(void *mem_ctx, nir_shader *s);
 
 #ifndef NDEBUG
 void nir_validate_shader(nir_shader *shader, const char *when);
+void nir_validate_shader_changes(nir_shader *shader, const char *when);
 void nir_metadata_set_validation_flag(nir_shader *shader);
 void nir_metadata_check_validation_flag(nir_shader *shader);
 
@@ -2973,6 +3060,7 @@ should_print_nir(void)
 }
 #else
 static inline void nir_validate_shader(nir_shader *shader, const char *when) { (void) shader; (void)when; }
+static inline void nir_validate_shader_changes(nir_shader *shader, const char *when) { (void) shader; (void)when; }
 static inline void nir_metadata_set_validation_flag(nir_shader *shader) { (void) shader; }
 static inline void nir_metadata_check_validation_flag(nir_shader *shader) { (void) shader; }
 static inline bool should_skip_nir(UNUSED const char *pass_name) { return false; }
@@ -2981,13 +3069,13 @@ static inline bool should_serialize_deserialize_nir(void) { return false; }
 static inline bool should_print_nir(void) { return false; }
 #endif /* NDEBUG */
 
-#define _PASS(pass, nir, do_pass) do {                               \
+#define _PASS(pass, nir, validate, do_pass) do {                     \
    if (should_skip_nir(#pass)) {                                     \
       printf("skipping %s\n", #pass);                                \
       break;                                                         \
    }                                                                 \
    do_pass                                                           \
-   nir_validate_shader(nir, "after " #pass);                         \
+   validate(nir, "after " #pass);                                    \
    if (should_clone_nir()) {                                         \
       nir_shader *clone = nir_shader_clone(ralloc_parent(nir), nir); \
       ralloc_free(nir);                                              \
@@ -2999,7 +3087,11 @@ static inline bool should_print_nir(void) { return false; }
    }                                                                 \
 } while (0)
 
+/* Passes run with NIR_PASS are checked to reset the metadata of the
+ * functions they change, so only those need to be validated again.
+ */
 #define NIR_PASS(progress, nir, pass, ...) _PASS(pass, nir,          \
+   nir_validate_shader_changes,                                      \
    nir_metadata_set_validation_flag(nir);                            \
    if (should_print_nir())                                           \
       printf("%s\n", #pass);                                         \
@@ -3011,7 +3103,11 @@ static inline bool should_print_nir(void) { return false; }
    }                                                                 \
 )
 
+/* There is no progress to check NIR_PASS_V passes against, so the whole
+ * shader is validated after them.
+ */
 #define NIR_PASS_V(nir, pass, ...) _PASS(pass, nir,                  \
+   nir_validate_shader,                                              \
    if (should_print_nir())                                           \
       printf("%s\n", #pass);                                         \
    pass(nir, ##__VA_ARGS__);                                         \
@@ -3021,6 +3117,79 @@ static inline bool should_print_nir(void) { return false; }
 
 #define NIR_SKIP(name) should_skip_nir(#name)
 
+/** Statistics and skip state of one call site of NIR_LOOP_PASS. */
+typedef struct nir_pass_record {
+   const char *name;
+
+   /* The pass made no progress the last time it ran, when the manager was
+    * at clean_generation.
+    */
+   bool clean;
+   unsigned clean_generation;
+
+   unsigned runs;
+   unsigned skips;
+   unsigned progress;
+   int64_t time_ns;
+   int64_t start_ns;
+} nir_pass_record;
+
+/**
+ * Runs the passes of an optimization loop, skipping the ones which can't
+ * make progress.
+ *
+ * The generation is bumped every time a pass run through the manager
+ * makes progress.  A pass which made no progress at some generation is
+ * skipped until the generation changes, since its input is the same.
+ * This only holds if everything which changes the shader in the loop goes
+ * through NIR_LOOP_PASS, and the arguments given at each call site don't
+ * change from one iteration to the next.
+ *
+ * With NIR_DEBUG=pass_timing, the statistics of all the managers are
+ * printed to stderr at exit.  Times include the validation NIR_PASS does
+ * in debug builds.
+ */
+typedef struct nir_pass_manager {
+   struct hash_table *records;
+   unsigned generation;
+} nir_pass_manager;
+
+void nir_pass_manager_init(nir_pass_manager *pm);
+void nir_pass_manager_finish(nir_pass_manager *pm);
+
+nir_pass_record *nir_pass_manager_begin(nir_pass_manager *pm,
+                                        const void *site, const char *name);
+bool nir_pass_manager_end(nir_pass_manager *pm, nir_pass_record *record,
+                          bool progress);
+
+void nir_print_pass_timing(FILE *fp);
+
+#define NIR_LOOP_PASS(progress, pm, nir, pass, ...) do {             \
+   static const char _pass_site = 0;                                 \
+   nir_pass_record *_pass_record =                                   \
+      nir_pass_manager_begin(pm, &_pass_site, #pass);                \
+   if (_pass_record) {                                               \
+      bool _pass_progress = false;                                   \
+      NIR_PASS(_pass_progress, nir, pass, ##__VA_ARGS__);            \
+      if (nir_pass_manager_end(pm, _pass_record, _pass_progress))    \
+         progress = true;                                            \
+   }                                                                 \
+} while (0)
+
+/* Goes through the pass manager, but doesn't report progress to the loop.
+ * For passes which the loop doesn't need to wait for.
+ */
+#define NIR_LOOP_PASS_V(pm, nir, pass, ...) do {                     \
+   static const char _pass_site = 0;                                 \
+   nir_pass_record *_pass_record =                                   \
+      nir_pass_manager_begin(pm, &_pass_site, #pass);                \
+   if (_pass_record) {                                               \
+      bool _pass_progress = false;                                   \
+      NIR_PASS(_pass_progress, nir, pass, ##__VA_ARGS__);            \
+      nir_pass_manager_end(pm, _pass_record, _pass_progress);        \
+   }                                                                 \
+} while (0)
+
 void nir_calc_dominance_impl(nir_function_impl *impl);
 void nir_calc_dominance(nir_shader *shader);
 
@@ -3533,6 +3702,10 @@ void nir_live_ssa_defs_impl(nir_function_impl *impl);
 void nir_loop_analyze_impl(nir_function_impl *impl,
                            nir_variable_mode indirect_mask);
 
+void nir_divergence_analysis_impl(nir_function_impl *impl,
+                                  nir_divergence_options options);
+void nir_divergence_analysis(nir_shader *shader);
+
 bool nir_ssa_defs_interfere(nir_ssa_def *a, nir_ssa_def *b);
 
 bool nir_repair_ssa_impl(nir_function_impl *impl);
@@ -3588,6 +3761,28 @@ bool nir_opt_large_constants(nir_shader *shader,
                              glsl_type_size_align_func size_align,
                              unsigned threshold);
 
+/**
+ * Callback deciding whether two memory accesses can be combined into one.
+ *
+ * \param align           Alignment in bytes of the combined access.
+ * \param bit_size        Bit size of the components of both accesses.
+ * \param num_components  Number of components of the combined access.
+ * \param high_offset     Offset in bytes of high from low.
+ * \param low             The access with the lowest address.
+ * \param high            The other one.
+ */
+typedef bool (*nir_should_vectorize_mem_func)(unsigned align, unsigned bit_size,
+                                              unsigned num_components,
+                                              unsigned high_offset,
+                                              nir_intrinsic_instr *low,
+                                              nir_intrinsic_instr *high);
+
+bool nir_opt_load_store_vectorize(nir_shader *shader, nir_variable_mode modes,
+                                  nir_should_vectorize_mem_func callback);
+
+bool nir_opt_loop_strength_reduce(nir_shader *shader,
+                                  nir_variable_mode indirect_mask);
+
 bool nir_opt_loop_unroll(nir_shader *shader, nir_variable_mode indirect_mask);
 
 bool nir_opt_move_comparisons(nir_shader *shader);
@@ -3609,6 +3804,27 @@ bool nir_opt_undef(nir_shader *shader);
 
 bool nir_opt_conditional_discard(nir_shader *shader);
 
+typedef struct nir_schedule_options {
+   /* Number of 32-bit components of live SSA values above which the
+    * scheduler tries to reduce register pressure rather than hide latency.
+    * 0 means latency only.
+    */
+   unsigned threshold;
+
+   /* Bitmask of the stages in which load_input may read the memory
+    * written by store_output, so that they mustn't be reordered.
+    */
+   unsigned stages_with_shared_io_memory;
+
+   /* Number of cycles after which the result of the instruction can be
+    * used.  If NULL, texture fetches and memory loads get a rough default.
+    */
+   unsigned (*instr_delay_cb)(nir_instr *instr, void *data);
+   void *instr_delay_cb_data;
+} nir_schedule_options;
+
+bool nir_schedule(nir_shader *shader, const nir_schedule_options *options);
+
 void nir_strip(nir_shader *shader);
 
 void nir_sweep(nir_shader *shader);
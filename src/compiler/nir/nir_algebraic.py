@@ -918,8 +918,8 @@ class TreeAutomaton(object):
       # and one which can match as a wildcard or constant. These will be the
       # states of intrinsics/other instructions and load_const instructions,
       # respectively. The indices of these must match the definitions of
-      # WILDCARD_STATE and CONST_STATE below, so that the runtime C code can
-      # initialize things correctly.
+      # WILDCARD_STATE and CONST_STATE in nir_search.c, so that the runtime C
+      # code can initialize things correctly.
       self.states.add(frozenset((self.wildcard,)))
       self.states.add(frozenset((self.const,self.wildcard)))
       process_new_states()
@@ -962,47 +962,61 @@ _algebraic_pass_template = mako.template.Template("""
 #include "nir_search.h"
 #include "nir_search_helpers.h"
 
-#ifndef NIR_OPT_ALGEBRAIC_STRUCT_DEFS
-#define NIR_OPT_ALGEBRAIC_STRUCT_DEFS
+<% cache = {} %>
+% for xform in xforms:
+   ${xform.search.render(cache)}
+   ${xform.replace.render(cache)}
+% endfor
 
-struct transform {
-   const nir_search_expression *search;
-   const nir_search_value *replace;
-   unsigned condition_offset;
+static const struct transform ${pass_name}_transforms[] = {
+% for xform in xforms:
+   { ${xform.search.c_ptr(cache)}, ${xform.replace.c_value_ptr(cache)}, ${xform.condition_index} },
+% endfor
 };
 
-struct per_op_table {
-   const uint16_t *filter;
-   unsigned num_filtered_states;
-   const uint16_t *table;
+% for state_id, state_xforms in enumerate(automaton.state_patterns):
+% if state_xforms: # avoid emitting a 0-length array for MSVC
+static const uint16_t ${pass_name}_state${state_id}_xforms[] = {
+   ${', '.join(str(i) for i in state_xforms)}
 };
+% endif
+% endfor
 
-/* Note: these must match the start states created in
- * TreeAutomaton._build_table()
- */
-
-/* WILDCARD_STATE = 0 is set by zeroing the state array */
-static const uint16_t CONST_STATE = 1;
+static const uint16_t *const ${pass_name}_state_xforms[] = {
+% for state_id, state_xforms in enumerate(automaton.state_patterns):
+% if state_xforms:
+   ${pass_name}_state${state_id}_xforms,
+% else:
+   NULL,
+% endif
+% endfor
+};
 
-#endif
+static const uint16_t ${pass_name}_state_xform_counts[] = {
+% for state_xforms in automaton.state_patterns:
+   ${len(state_xforms)},
+% endfor
+};
 
-<% cache = {} %>
-% for xform in xforms:
-   ${xform.search.render(cache)}
-   ${xform.replace.render(cache)}
+% for op, op_xforms in sorted(search_op_xforms.items()):
+static const uint16_t ${pass_name}_${op}_xforms[] = {
+   ${', '.join(str(i) for i in op_xforms)}
+};
 % endfor
 
-% for state_id, state_xforms in enumerate(automaton.state_patterns):
-% if state_xforms: # avoid emitting a 0-length array for MSVC
-static const struct transform ${pass_name}_state${state_id}_xforms[] = {
-% for i in state_xforms:
-  { ${xforms[i].search.c_ptr(cache)}, ${xforms[i].replace.c_value_ptr(cache)}, ${xforms[i].condition_index} },
+static const uint16_t *const ${pass_name}_op_xforms[nir_num_search_ops] = {
+% for op in sorted(search_op_xforms):
+   [${get_c_opcode(op)}] = ${pass_name}_${op}_xforms,
 % endfor
 };
-% endif
+
+static const uint16_t ${pass_name}_op_xform_counts[nir_num_search_ops] = {
+% for op, op_xforms in sorted(search_op_xforms.items()):
+   [${get_c_opcode(op)}] = ${len(op_xforms)},
 % endfor
+};
 
-static const struct per_op_table ${pass_name}_table[nir_num_search_ops] = {
+static const struct per_op_table ${pass_name}_op_tables[nir_num_search_ops] = {
 % for op in automaton.opcodes:
    [${get_c_opcode(op)}] = {
       .filter = (uint16_t []) {
@@ -1026,117 +1040,14 @@ static const struct per_op_table ${pass_name}_table[nir_num_search_ops] = {
 % endfor
 };
 
-static void
-${pass_name}_pre_block(nir_block *block, uint16_t *states)
-{
-   nir_foreach_instr(instr, block) {
-      switch (instr->type) {
-      case nir_instr_type_alu: {
-         nir_alu_instr *alu = nir_instr_as_alu(instr);
-         nir_op op = alu->op;
-         uint16_t search_op = nir_search_op_for_nir_op(op);
-         const struct per_op_table *tbl = &${pass_name}_table[search_op];
-         if (tbl->num_filtered_states == 0)
-            continue;
-
-         /* Calculate the index into the transition table. Note the index
-          * calculated must match the iteration order of Python's
-          * itertools.product(), which was used to emit the transition
-          * table.
-          */
-         uint16_t index = 0;
-         for (unsigned i = 0; i < nir_op_infos[op].num_inputs; i++) {
-            index *= tbl->num_filtered_states;
-            index += tbl->filter[states[alu->src[i].src.ssa->index]];
-         }
-         states[alu->dest.dest.ssa.index] = tbl->table[index];
-         break;
-      }
-
-      case nir_instr_type_load_const: {
-         nir_load_const_instr *load_const = nir_instr_as_load_const(instr);
-         states[load_const->def.index] = CONST_STATE;
-         break;
-      }
-
-      default:
-         break;
-      }
-   }
-}
-
-static bool
-${pass_name}_block(nir_builder *build, nir_block *block,
-                   const uint16_t *states, const bool *condition_flags)
-{
-   bool progress = false;
-
-   nir_foreach_instr_reverse_safe(instr, block) {
-      if (instr->type != nir_instr_type_alu)
-         continue;
-
-      nir_alu_instr *alu = nir_instr_as_alu(instr);
-      if (!alu->dest.dest.is_ssa)
-         continue;
-
-      switch (states[alu->dest.dest.ssa.index]) {
-% for i in range(len(automaton.state_patterns)):
-      case ${i}:
-         % if automaton.state_patterns[i]:
-         for (unsigned i = 0; i < ARRAY_SIZE(${pass_name}_state${i}_xforms); i++) {
-            const struct transform *xform = &${pass_name}_state${i}_xforms[i];
-            if (condition_flags[xform->condition_offset] &&
-                nir_replace_instr(build, alu, xform->search, xform->replace)) {
-               progress = true;
-               break;
-            }
-         }
-         % endif
-         break;
-% endfor
-      default: assert(0);
-      }
-   }
-
-   return progress;
-}
-
-static bool
-${pass_name}_impl(nir_function_impl *impl, const bool *condition_flags)
-{
-   bool progress = false;
-
-   nir_builder build;
-   nir_builder_init(&build, impl);
-
-   /* Note: it's important here that we're allocating a zeroed array, since
-    * state 0 is the default state, which means we don't have to visit
-    * anything other than constants and ALU instructions.
-    */
-   uint16_t *states = calloc(impl->ssa_alloc, sizeof(*states));
-
-   nir_foreach_block(block, impl) {
-      ${pass_name}_pre_block(block, states);
-   }
-
-   nir_foreach_block_reverse(block, impl) {
-      progress |= ${pass_name}_block(&build, block, states, condition_flags);
-   }
-
-   free(states);
-
-   if (progress) {
-      nir_metadata_preserve(impl, nir_metadata_block_index |
-                                  nir_metadata_dominance);
-    } else {
-#ifndef NDEBUG
-      impl->valid_metadata &= ~nir_metadata_not_properly_reset;
-#endif
-    }
-
-   return progress;
-}
-
+static const nir_algebraic_table ${pass_name}_table = {
+   .transforms = ${pass_name}_transforms,
+   .op_tables = ${pass_name}_op_tables,
+   .state_xforms = ${pass_name}_state_xforms,
+   .state_xform_counts = ${pass_name}_state_xform_counts,
+   .op_xforms = ${pass_name}_op_xforms,
+   .op_xform_counts = ${pass_name}_op_xform_counts,
+};
 
 bool
 ${pass_name}(nir_shader *shader)
@@ -1153,20 +1064,23 @@ ${pass_name}(nir_shader *shader)
    % endfor
 
    nir_foreach_function(function, shader) {
-      if (function->impl)
-         progress |= ${pass_name}_impl(function->impl, condition_flags);
+      if (function->impl) {
+         progress |= nir_algebraic_impl(function->impl, condition_flags,
+                                        &${pass_name}_table);
+      }
    }
 
    return progress;
 }
 """)
 
-      
-
 class AlgebraicPass(object):
    def __init__(self, pass_name, transforms):
       self.xforms = []
-      self.opcode_xforms = defaultdict(lambda : [])
+      # Indices of the transforms of each search opcode, for the tree walking
+      # matcher.  Like the automaton, this maps sized conversion opcodes like
+      # f2b1 to the search opcode.
+      self.search_op_xforms = defaultdict(lambda : [])
       self.pass_name = pass_name
 
       error = False
@@ -1183,14 +1097,11 @@ class AlgebraicPass(object):
                error = True
                continue
 
+         opcode = xform.search.opcode
+         if opcode.rstrip('0123456789') in conv_opcode_types:
+            opcode = opcode.rstrip('0123456789')
+         self.search_op_xforms[opcode].append(len(self.xforms))
          self.xforms.append(xform)
-         if xform.search.opcode in conv_opcode_types:
-            dst_type = conv_opcode_types[xform.search.opcode]
-            for size in type_sizes(dst_type):
-               sized_opcode = xform.search.opcode + str(size)
-               self.opcode_xforms[sized_opcode].append(xform)
-         else:
-            self.opcode_xforms[xform.search.opcode].append(xform)
 
       self.automaton = TreeAutomaton(self.xforms)
 
@@ -1201,7 +1112,7 @@ class AlgebraicPass(object):
    def render(self):
       return _algebraic_pass_template.render(pass_name=self.pass_name,
                                              xforms=self.xforms,
-                                             opcode_xforms=self.opcode_xforms,
+                                             search_op_xforms=self.search_op_xforms,
                                              condition_list=condition_list,
                                              automaton=self.automaton,
                                              get_c_opcode=get_c_opcode,
@@ -85,6 +85,11 @@ _lookup_ptr(clone_state *state, const void *ptr, bool global)
    if (!state->global_clone && global)
       return (void *)ptr;
 
+   if (!state->remap_table) {
+      assert(state->allow_remap_fallback);
+      return (void *)ptr;
+   }
+
    entry = _mesa_hash_table_search(state->remap_table, ptr);
    if (!entry) {
       assert(state->allow_remap_fallback);
@@ -97,7 +102,8 @@ _lookup_ptr(clone_state *state, const void *ptr, bool global)
 static void
 add_remap(clone_state *state, void *nptr, const void *ptr)
 {
-   _mesa_hash_table_insert(state->remap_table, ptr, nptr);
+   if (state->remap_table)
+      _mesa_hash_table_insert(state->remap_table, ptr, nptr);
 }
 
 static void *
@@ -517,6 +523,54 @@ clone_instr(clone_state *state, const nir_instr *instr)
    }
 }
 
+static bool
+get_ssa_def(nir_ssa_def *def, void *state)
+{
+   *(nir_ssa_def **) state = def;
+   return true;
+}
+
+/**
+ * Clones a single instruction, which isn't inserted anywhere.  Its sources
+ * are the same as the original's, including those of phis, so its SSA def
+ * also takes over the original's divergence.
+ */
+nir_instr *
+nir_instr_clone(nir_shader *shader, const nir_instr *orig)
+{
+   clone_state state = {
+      .allow_remap_fallback = true,
+      .ns = shader,
+   };
+   nir_instr *ninstr;
+
+   if (orig->type != nir_instr_type_phi) {
+      ninstr = clone_instr(&state, orig);
+   } else {
+      const nir_phi_instr *phi = nir_instr_as_phi(orig);
+      nir_phi_instr *nphi = nir_phi_instr_create(shader);
+
+      __clone_dst(&state, &nphi->instr, &nphi->dest, &phi->dest);
+
+      nir_foreach_phi_src(src, phi) {
+         nir_phi_src *nsrc = ralloc(nphi, nir_phi_src);
+         nsrc->pred = src->pred;
+         __clone_src(&state, &nphi->instr, &nsrc->src, &src->src);
+         exec_list_push_tail(&nphi->srcs, &nsrc->node);
+      }
+
+      ninstr = &nphi->instr;
+   }
+
+   nir_ssa_def *def = NULL, *ndef = NULL;
+   nir_foreach_ssa_def((nir_instr *) orig, get_ssa_def, &def);
+   nir_foreach_ssa_def(ninstr, get_ssa_def, &ndef);
+   if (def)
+      ndef->divergent = def->divergent;
+
+   return ninstr;
+}
+
 static nir_block *
 clone_block(clone_state *state, struct exec_list *cf_list, const nir_block *blk)
 {
@@ -236,7 +236,7 @@ insert_phi_undef(nir_block *block, nir_block *pred)
 
       nir_phi_instr *phi = nir_instr_as_phi(instr);
       nir_ssa_undef_instr *undef =
-         nir_ssa_undef_instr_create(ralloc_parent(phi),
+         nir_ssa_undef_instr_create(impl->function->shader,
                                     phi->dest.ssa.num_components,
                                     phi->dest.ssa.bit_size);
       nir_instr_insert_before_cf_list(&impl->body, &undef->instr);
@@ -574,6 +574,7 @@ nir_cf_node_insert(nir_cursor cursor, nir_cf_node *node)
    nir_block *before, *after;
 
    split_block_cursor(cursor, &before, &after);
+   nir_metadata_mark_changed(&before->cf_node);
 
    if (node->type == nir_cf_node_block) {
       nir_block *block = nir_cf_node_as_block(node);
@@ -709,6 +710,7 @@ nir_cf_reinsert(nir_cf_list *cf_list, nir_cursor cursor)
       return;
 
    split_block_cursor(cursor, &before, &after);
+   nir_metadata_mark_changed(&before->cf_node);
 
    foreach_list_typed_safe(nir_cf_node, node, node, &cf_list->list) {
       exec_node_remove(&node->node);
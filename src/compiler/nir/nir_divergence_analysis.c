@@ -0,0 +1,574 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+
+/**
+ * Divergence analysis
+ *
+ * Determines which SSA values may differ between the invocations of a
+ * subgroup, and stores the result in nir_ssa_def::divergent.  Values start
+ * out uniform and are only ever marked divergent, so the analysis just
+ * iterates until nothing changes.
+ *
+ * Besides data dependencies, control flow can make a value divergent:
+ *
+ *  - A phi at the end of an if is divergent if the condition is.
+ *  - A phi at the top of a loop is divergent if the loop has a continue
+ *    under divergent control flow.
+ *  - A phi after a loop is divergent if the loop has a break under
+ *    divergent control flow.  Because NIR isn't in LCSSA form, any other
+ *    value defined in such a loop and used after it is divergent as well,
+ *    since invocations may have left the loop at different iterations.
+ *
+ * The result is kept as nir_metadata_divergence.
+ */
+
+struct divergence_state {
+   nir_divergence_options options;
+   gl_shader_stage stage;
+
+   /** Whether some if between here and the innermost loop is divergent */
+   bool divergent_cf;
+
+   /** Whether the innermost loop has a divergent continue or break */
+   bool divergent_continue;
+   bool divergent_break;
+
+   /** Whether the loop just visited has a divergent break */
+   bool divergent_loop_exit;
+};
+
+static bool
+visit_cf_list(struct exec_list *list, struct divergence_state *state);
+
+static bool
+mark_divergent(nir_ssa_def *def, bool divergent)
+{
+   if (!divergent || def->divergent)
+      return false;
+
+   def->divergent = true;
+   return true;
+}
+
+static bool
+clear_divergent(nir_ssa_def *def, UNUSED void *state)
+{
+   def->divergent = false;
+   return true;
+}
+
+static bool
+srcs_divergent(nir_intrinsic_instr *instr)
+{
+   unsigned num_srcs = nir_intrinsic_infos[instr->intrinsic].num_srcs;
+
+   for (unsigned i = 0; i < num_srcs; i++) {
+      if (nir_src_is_divergent(instr->src[i]))
+         return true;
+   }
+
+   return false;
+}
+
+static bool
+visit_alu(nir_alu_instr *instr)
+{
+   if (!instr->dest.dest.is_ssa)
+      return false;
+
+   bool divergent = false;
+
+   for (unsigned i = 0; i < nir_op_infos[instr->op].num_inputs; i++)
+      divergent |= nir_src_is_divergent(instr->src[i].src);
+
+   return mark_divergent(&instr->dest.dest.ssa, divergent);
+}
+
+static bool
+input_divergent(nir_intrinsic_instr *instr, struct divergence_state *state)
+{
+   /* Only patch inputs to the TES can be the same for a whole subgroup. */
+   if (state->stage == MESA_SHADER_TESS_EVAL &&
+       (state->options & nir_divergence_single_patch_per_tes_subgroup))
+      return srcs_divergent(instr);
+
+   return true;
+}
+
+static bool
+output_divergent(nir_intrinsic_instr *instr, struct divergence_state *state)
+{
+   /* Only patch outputs of the TCS can be the same for a whole subgroup. */
+   if (state->stage == MESA_SHADER_TESS_CTRL &&
+       (state->options & nir_divergence_single_patch_per_tcs_subgroup))
+      return srcs_divergent(instr);
+
+   return true;
+}
+
+static bool
+load_deref_divergent(nir_intrinsic_instr *instr,
+                     struct divergence_state *state)
+{
+   nir_deref_instr *deref = nir_src_as_deref(instr->src[0]);
+
+   switch (deref->mode) {
+   case nir_var_uniform:
+   case nir_var_mem_ubo:
+   case nir_var_mem_ssbo:
+   case nir_var_mem_shared:
+   case nir_var_mem_global:
+      return nir_src_is_divergent(instr->src[0]);
+   case nir_var_shader_in:
+      return input_divergent(instr, state);
+   case nir_var_shader_out:
+      return output_divergent(instr, state);
+   default:
+      /* Temporaries are written separately by each invocation. */
+      return true;
+   }
+}
+
+static bool
+visit_intrinsic(nir_intrinsic_instr *instr, struct divergence_state *state)
+{
+   if (!nir_intrinsic_infos[instr->intrinsic].has_dest)
+      return false;
+
+   if (!instr->dest.is_ssa)
+      return false;
+
+   const nir_divergence_options options = state->options;
+   const gl_shader_stage stage = state->stage;
+   bool divergent;
+
+   switch (instr->intrinsic) {
+   /* Uniform for the whole draw or dispatch */
+   case nir_intrinsic_load_subgroup_size:
+   case nir_intrinsic_load_num_subgroups:
+   case nir_intrinsic_load_subgroup_id:
+   case nir_intrinsic_load_work_group_id:
+   case nir_intrinsic_load_num_work_groups:
+   case nir_intrinsic_load_local_group_size:
+   case nir_intrinsic_load_work_dim:
+   case nir_intrinsic_load_first_vertex:
+   case nir_intrinsic_load_base_vertex:
+   case nir_intrinsic_load_is_indexed_draw:
+   case nir_intrinsic_load_base_instance:
+   case nir_intrinsic_load_draw_id:
+   case nir_intrinsic_load_user_clip_plane:
+   case nir_intrinsic_load_patch_vertices_in:
+   case nir_intrinsic_load_alpha_ref_float:
+   case nir_intrinsic_load_viewport_x_scale:
+   case nir_intrinsic_load_viewport_y_scale:
+   case nir_intrinsic_load_viewport_z_scale:
+   case nir_intrinsic_load_viewport_z_offset:
+   case nir_intrinsic_load_viewport_scale:
+   case nir_intrinsic_load_viewport_offset:
+   case nir_intrinsic_load_blend_const_color_r_float:
+   case nir_intrinsic_load_blend_const_color_g_float:
+   case nir_intrinsic_load_blend_const_color_b_float:
+   case nir_intrinsic_load_blend_const_color_a_float:
+   case nir_intrinsic_load_blend_const_color_rgba:
+   case nir_intrinsic_load_blend_const_color_rgba8888_unorm:
+   case nir_intrinsic_load_blend_const_color_aaaa8888_unorm:
+   /* Subgroup operations returning the same value to every invocation */
+   case nir_intrinsic_ballot:
+   case nir_intrinsic_first_invocation:
+   case nir_intrinsic_read_first_invocation:
+   case nir_intrinsic_vote_any:
+   case nir_intrinsic_vote_all:
+   case nir_intrinsic_vote_feq:
+   case nir_intrinsic_vote_ieq:
+      divergent = false;
+      break;
+
+   case nir_intrinsic_reduce:
+      divergent = nir_intrinsic_cluster_size(instr) != 0;
+      break;
+
+   case nir_intrinsic_read_invocation:
+      divergent = nir_src_is_divergent(instr->src[1]);
+      break;
+
+   /* Same value for every invocation loading the same address */
+   case nir_intrinsic_load_uniform:
+   case nir_intrinsic_load_ubo:
+   case nir_intrinsic_load_push_constant:
+   case nir_intrinsic_load_constant:
+   case nir_intrinsic_load_kernel_input:
+   case nir_intrinsic_load_ssbo:
+   case nir_intrinsic_load_shared:
+   case nir_intrinsic_load_global:
+   case nir_intrinsic_get_buffer_size:
+   case nir_intrinsic_deref_buffer_array_length:
+   case nir_intrinsic_vulkan_resource_index:
+   case nir_intrinsic_vulkan_resource_reindex:
+   case nir_intrinsic_load_vulkan_descriptor:
+   case nir_intrinsic_image_deref_load:
+   case nir_intrinsic_image_load:
+   case nir_intrinsic_bindless_image_load:
+   case nir_intrinsic_image_deref_size:
+   case nir_intrinsic_image_size:
+   case nir_intrinsic_bindless_image_size:
+   case nir_intrinsic_image_deref_samples:
+   case nir_intrinsic_image_samples:
+   case nir_intrinsic_bindless_image_samples:
+   case nir_intrinsic_image_deref_load_param_intel:
+   case nir_intrinsic_load_sample_pos_from_id:
+   case nir_intrinsic_ballot_bitfield_extract:
+   case nir_intrinsic_ballot_bit_count_reduce:
+   case nir_intrinsic_ballot_find_lsb:
+   case nir_intrinsic_ballot_find_msb:
+      divergent = srcs_divergent(instr);
+      break;
+
+   case nir_intrinsic_load_deref:
+      divergent = load_deref_divergent(instr, state);
+      break;
+
+   case nir_intrinsic_load_input:
+      divergent = input_divergent(instr, state);
+      break;
+
+   case nir_intrinsic_load_output:
+      divergent = output_divergent(instr, state);
+      break;
+
+   case nir_intrinsic_load_primitive_id:
+      if (stage == MESA_SHADER_TESS_CTRL)
+         divergent = !(options & nir_divergence_single_patch_per_tcs_subgroup);
+      else if (stage == MESA_SHADER_TESS_EVAL)
+         divergent = !(options & nir_divergence_single_patch_per_tes_subgroup);
+      else if (stage == MESA_SHADER_FRAGMENT)
+         divergent = !(options & nir_divergence_single_prim_per_subgroup);
+      else
+         divergent = true;
+      break;
+
+   case nir_intrinsic_load_front_face:
+   case nir_intrinsic_load_layer_id:
+      divergent = stage != MESA_SHADER_FRAGMENT ||
+                  !(options & nir_divergence_single_prim_per_subgroup);
+      break;
+
+   case nir_intrinsic_load_view_index:
+      divergent = !(options & nir_divergence_view_index_uniform);
+      break;
+
+   case nir_intrinsic_load_tess_level_outer:
+   case nir_intrinsic_load_tess_level_inner:
+      if (stage == MESA_SHADER_TESS_CTRL)
+         divergent = !(options & nir_divergence_single_patch_per_tcs_subgroup);
+      else if (stage == MESA_SHADER_TESS_EVAL)
+         divergent = !(options & nir_divergence_single_patch_per_tes_subgroup);
+      else
+         divergent = true;
+      break;
+
+   default:
+      /* Per-invocation system values and inputs, atomics, scratch,
+       * shuffles and scans, and anything we don't know about.
+       */
+      divergent = true;
+      break;
+   }
+
+   return mark_divergent(&instr->dest.ssa, divergent);
+}
+
+static bool
+visit_tex(nir_tex_instr *instr)
+{
+   if (!instr->dest.is_ssa)
+      return false;
+
+   bool divergent = false;
+
+   for (unsigned i = 0; i < instr->num_srcs; i++)
+      divergent |= nir_src_is_divergent(instr->src[i].src);
+
+   return mark_divergent(&instr->dest.ssa, divergent);
+}
+
+static bool
+visit_deref(nir_deref_instr *instr)
+{
+   if (!instr->dest.is_ssa)
+      return false;
+
+   bool divergent = false;
+
+   if (instr->deref_type != nir_deref_type_var)
+      divergent |= nir_src_is_divergent(instr->parent);
+
+   if (instr->deref_type == nir_deref_type_array ||
+       instr->deref_type == nir_deref_type_ptr_as_array)
+      divergent |= nir_src_is_divergent(instr->arr.index);
+
+   return mark_divergent(&instr->dest.ssa, divergent);
+}
+
+static void
+visit_jump(nir_jump_instr *jump, struct divergence_state *state)
+{
+   /* After a divergent continue, the invocations that took it reach the
+    * next break one iteration later than the others.
+    */
+   if (jump->type == nir_jump_break &&
+       (state->divergent_cf || state->divergent_continue))
+      state->divergent_break = true;
+   else if (jump->type == nir_jump_continue && state->divergent_cf)
+      state->divergent_continue = true;
+}
+
+static bool
+visit_phi(nir_phi_instr *phi, bool cf_divergent)
+{
+   if (!phi->dest.is_ssa)
+      return false;
+
+   bool divergent = cf_divergent;
+
+   nir_foreach_phi_src(src, phi)
+      divergent |= nir_src_is_divergent(src->src);
+
+   return mark_divergent(&phi->dest.ssa, divergent);
+}
+
+static bool
+visit_block(nir_block *block, struct divergence_state *state,
+            bool phis_divergent)
+{
+   bool progress = false;
+
+   nir_foreach_instr(instr, block) {
+      switch (instr->type) {
+      case nir_instr_type_alu:
+         progress |= visit_alu(nir_instr_as_alu(instr));
+         break;
+      case nir_instr_type_intrinsic:
+         progress |= visit_intrinsic(nir_instr_as_intrinsic(instr), state);
+         break;
+      case nir_instr_type_tex:
+         progress |= visit_tex(nir_instr_as_tex(instr));
+         break;
+      case nir_instr_type_deref:
+         progress |= visit_deref(nir_instr_as_deref(instr));
+         break;
+      case nir_instr_type_phi:
+         progress |= visit_phi(nir_instr_as_phi(instr), phis_divergent);
+         break;
+      case nir_instr_type_jump:
+         visit_jump(nir_instr_as_jump(instr), state);
+         break;
+      case nir_instr_type_load_const:
+      case nir_instr_type_ssa_undef:
+      case nir_instr_type_call:
+      case nir_instr_type_parallel_copy:
+         break;
+      }
+   }
+
+   return progress;
+}
+
+static bool
+visit_if(nir_if *if_stmt, struct divergence_state *state)
+{
+   bool progress = false;
+   bool old_divergent_cf = state->divergent_cf;
+
+   state->divergent_cf |= nir_src_is_divergent(if_stmt->condition);
+
+   progress |= visit_cf_list(&if_stmt->then_list, state);
+   progress |= visit_cf_list(&if_stmt->else_list, state);
+
+   state->divergent_cf = old_divergent_cf;
+
+   return progress;
+}
+
+struct loop_defs_state {
+   unsigned first_index;
+   unsigned last_index;
+   bool progress;
+};
+
+static bool
+is_block_outside_loop(nir_block *block, struct loop_defs_state *state)
+{
+   return block->index < state->first_index ||
+          block->index > state->last_index;
+}
+
+static bool
+mark_def_used_outside_loop(nir_ssa_def *def, void *void_state)
+{
+   struct loop_defs_state *state = void_state;
+
+   if (def->divergent)
+      return true;
+
+   nir_foreach_use(src, def) {
+      if (is_block_outside_loop(src->parent_instr->block, state)) {
+         def->divergent = true;
+         state->progress = true;
+         return true;
+      }
+   }
+
+   nir_foreach_if_use(src, def) {
+      nir_cf_node *prev = nir_cf_node_prev(&src->parent_if->cf_node);
+      if (is_block_outside_loop(nir_cf_node_as_block(prev), state)) {
+         def->divergent = true;
+         state->progress = true;
+         return true;
+      }
+   }
+
+   return true;
+}
+
+static bool
+visit_loop(nir_loop *loop, struct divergence_state *state)
+{
+   bool progress = false;
+   struct divergence_state loop_state = *state;
+
+   /* Every invocation entering the loop runs its first iteration. */
+   loop_state.divergent_cf = false;
+   loop_state.divergent_continue = false;
+   loop_state.divergent_break = false;
+
+   /* The header phis depend on the continues after them, so go around until
+    * nothing changes.
+    */
+   nir_block *header = nir_loop_first_block(loop);
+   bool loop_progress, divergent_continue;
+   do {
+      divergent_continue = loop_state.divergent_continue;
+      loop_progress = visit_block(header, &loop_state, divergent_continue);
+      loop_progress |= visit_cf_list(&loop->body, &loop_state);
+      progress |= loop_progress;
+   } while (loop_progress ||
+            divergent_continue != loop_state.divergent_continue);
+
+   /* Invocations may have left the loop at different iterations, so they
+    * may disagree on the last value of anything defined in it.
+    */
+   if (loop_state.divergent_break) {
+      struct loop_defs_state defs_state = {
+         .first_index = header->index,
+         .last_index = nir_loop_last_block(loop)->index,
+         .progress = false,
+      };
+
+      nir_foreach_block_in_cf_node(block, &loop->cf_node) {
+         nir_foreach_instr(instr, block)
+            nir_foreach_ssa_def(instr, mark_def_used_outside_loop, &defs_state);
+      }
+
+      progress |= defs_state.progress;
+   }
+
+   state->divergent_loop_exit = loop_state.divergent_break;
+
+   return progress;
+}
+
+static bool
+visit_cf_list(struct exec_list *list, struct divergence_state *state)
+{
+   bool progress = false;
+
+   foreach_list_typed(nir_cf_node, node, node, list) {
+      switch (node->type) {
+      case nir_cf_node_block: {
+         nir_block *block = nir_cf_node_as_block(node);
+         nir_cf_node *prev = nir_cf_node_prev(node);
+         bool phis_divergent = false;
+
+         /* Loop headers are visited by visit_loop() */
+         if (prev == NULL && node->parent->type == nir_cf_node_loop)
+            break;
+
+         if (prev && prev->type == nir_cf_node_if) {
+            nir_if *if_stmt = nir_cf_node_as_if(prev);
+            phis_divergent = nir_src_is_divergent(if_stmt->condition);
+         } else if (prev && prev->type == nir_cf_node_loop) {
+            phis_divergent = state->divergent_loop_exit;
+         }
+
+         progress |= visit_block(block, state, phis_divergent);
+         break;
+      }
+      case nir_cf_node_if:
+         progress |= visit_if(nir_cf_node_as_if(node), state);
+         break;
+      case nir_cf_node_loop:
+         progress |= visit_loop(nir_cf_node_as_loop(node), state);
+         break;
+      case nir_cf_node_function:
+         unreachable("Invalid CF node type");
+      }
+   }
+
+   return progress;
+}
+
+void
+nir_divergence_analysis_impl(nir_function_impl *impl,
+                             nir_divergence_options options)
+{
+   struct divergence_state state = {
+      .options = options,
+      .stage = impl->function->shader->info.stage,
+   };
+
+   nir_metadata_require(impl, nir_metadata_block_index);
+
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr(instr, block)
+         nir_foreach_ssa_def(instr, clear_divergent, NULL);
+   }
+
+   while (visit_cf_list(&impl->body, &state))
+      ;
+
+   impl->valid_metadata |= nir_metadata_divergence;
+}
+
+void
+nir_divergence_analysis(nir_shader *shader)
+{
+   nir_divergence_options options =
+      shader->options ? shader->options->divergence_analysis_options : 0;
+
+   nir_foreach_function(function, shader) {
+      if (function->impl)
+         nir_divergence_analysis_impl(function->impl, options);
+   }
+}
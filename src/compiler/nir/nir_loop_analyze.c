@@ -215,6 +215,24 @@ is_var_phi(nir_loop_variable *var)
    return var->def->parent_instr->type == nir_instr_type_phi;
 }
 
+static inline bool
+is_var_loop_invariant(nir_loop_variable *var)
+{
+   return !var->in_loop || var->type == invariant;
+}
+
+/* Whether the variable is a basic induction variable starting from and
+ * stepped by constants.  Only those have a known trip count, and index
+ * arrays with constants once the loop is unrolled.
+ */
+static inline bool
+is_constant_induction_var(nir_loop_variable *var)
+{
+   return var->type == basic_induction &&
+          is_var_constant(var->ind->def_outside_loop) &&
+          is_var_constant(var->ind->invariant);
+}
+
 static inline bool
 mark_invariant(nir_ssa_def *def, loop_info_state *state)
 {
@@ -274,6 +292,22 @@ compute_invariance_information(loop_info_state *state)
    }
 }
 
+static void
+add_induction_var(nir_loop_info *info, nir_loop_variable *var,
+                  nir_basic_induction_var *biv)
+{
+   info->induction_vars =
+      reralloc(info, info->induction_vars, nir_loop_induction_variable,
+               info->num_induction_vars + 1);
+
+   nir_loop_induction_variable *iv =
+      &info->induction_vars[info->num_induction_vars++];
+   iv->def = var->def;
+   iv->init = biv->def_outside_loop->def;
+   iv->step = biv->invariant->def;
+   iv->update = nir_instr_as_alu(biv->alu_def->def->parent_instr);
+}
+
 static bool
 compute_induction_information(loop_info_state *state)
 {
@@ -353,23 +387,29 @@ compute_induction_information(loop_info_state *state)
                biv->alu_op = alu->op;
 
                for (unsigned i = 0; i < 2; i++) {
-                  /* Is one of the operands const, and the other the phi */
-                  if (alu->src[i].src.ssa->parent_instr->type == nir_instr_type_load_const &&
+                  /* Is one of the operands loop invariant, and the other the
+                   * phi.  The step doesn't need to be a constant, a value
+                   * computed outside of the loop (in an outer loop, for
+                   * example) is just as good.
+                   */
+                  nir_loop_variable *src_i =
+                     get_loop_var(alu->src[i].src.ssa, state);
+                  if (is_var_loop_invariant(src_i) &&
                       alu->src[1-i].src.ssa == &phi->dest.ssa)
-                     biv->invariant = get_loop_var(alu->src[i].src.ssa, state);
+                     biv->invariant = src_i;
                }
             }
          }
       }
 
-      if (biv->alu_def && biv->def_outside_loop && biv->invariant &&
-          is_var_constant(biv->def_outside_loop)) {
-         assert(is_var_constant(biv->invariant));
+      if (biv->alu_def && biv->def_outside_loop && biv->invariant) {
          biv->alu_def->type = basic_induction;
          biv->alu_def->ind = biv;
          var->type = basic_induction;
          var->ind = biv;
 
+         add_induction_var(state->loop->info, var, biv);
+
          found_induction_var = true;
       } else {
          ralloc_free(biv);
@@ -457,9 +497,9 @@ find_loop_terminators(loop_info_state *state)
 }
 
 /* This function looks for an array access within a loop that uses an
- * induction variable for the array index. If found it returns the size of the
- * array, otherwise 0 is returned. If we find an induction var we pass it back
- * to the caller via array_index_out.
+ * induction variable with a constant start and step for the array index. If
+ * found it returns the size of the array, otherwise 0 is returned. If we find
+ * an induction var we pass it back to the caller via array_index_out.
  */
 static unsigned
 find_array_access_via_induction(loop_info_state *state,
@@ -473,7 +513,7 @@ find_array_access_via_induction(loop_info_state *state,
       assert(d->arr.index.is_ssa);
       nir_loop_variable *array_index = get_loop_var(d->arr.index.ssa, state);
 
-      if (array_index->type != basic_induction)
+      if (!is_constant_induction_var(array_index))
          continue;
 
       if (array_index_out)
@@ -929,6 +969,14 @@ find_trip_count(loop_info_state *state)
 
       terminator->induction_rhs = !limit_rhs;
 
+      /* Trip counts can only be computed for induction variables starting
+       * from and stepped by constants.
+       */
+      if (!is_constant_induction_var(basic_ind)) {
+         trip_count_known = false;
+         continue;
+      }
+
       /* Attempt to find a constant limit for the loop */
       nir_const_value limit_val;
       if (is_var_constant(limit)) {
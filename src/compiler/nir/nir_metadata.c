@@ -47,6 +47,12 @@ nir_metadata_require(nir_function_impl *impl, nir_metadata required, ...)
       nir_loop_analyze_impl(impl, va_arg(ap, nir_variable_mode));
       va_end(ap);
    }
+   if (NEEDS_UPDATE(nir_metadata_divergence)) {
+      const nir_shader_compiler_options *options =
+         impl->function->shader->options;
+      nir_divergence_analysis_impl(impl, options ?
+                                   options->divergence_analysis_options : 0);
+   }
 
 #undef NEEDS_UPDATE
 
@@ -60,6 +66,19 @@ nir_metadata_preserve(nir_function_impl *impl, nir_metadata preserved)
 }
 
 #ifndef NDEBUG
+void
+nir_metadata_mark_changed(nir_cf_node *node)
+{
+   /* Control flow that was extracted, or instructions that weren't inserted
+    * yet, don't belong to any function.
+    */
+   while (node && node->type != nir_cf_node_function)
+      node = node->parent;
+
+   if (node)
+      nir_cf_node_as_function(node)->valid_metadata &= ~nir_metadata_validated;
+}
+
 /**
  * Make sure passes properly invalidate metadata (part 1).
  *
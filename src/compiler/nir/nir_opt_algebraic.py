@@ -321,6 +321,31 @@ optimizations = [
    (('flt', ('i2f', a), 0.0), ('ilt', a, 0)),
    (('flt', 0.0, ('i2f', a)), ('ilt', 0, a)),
 
+   # Patterns conditioned on the ranges found by nir_range_analysis.c.  NaN
+   # is outside of every range, so the patterns that don't hold for NaN are
+   # inexact.
+   (('fabs', 'a(is_not_negative)'), a),
+   (('fabs', 'a(is_not_positive)'), ('fneg', a)),
+   (('fsat', 'a(is_not_positive)'), 0.0),
+   (('~fmax', 'a(is_not_negative)', 0.0), a),
+   (('~fmin', 'a(is_not_positive)', 0.0), a),
+   (('~fmin', 'a(is_not_negative)', 1.0), ('fsat', a), '!options->lower_fsat'),
+   (('fne', 'a(is_not_zero)', 0.0), True),
+   (('feq', 'a(is_not_zero)', 0.0), False),
+   (('flt', 'a(is_not_negative)', 'b(is_not_positive)'), False),
+   (('~fge', 'a(is_not_negative)', 'b(is_not_positive)'), True),
+   (('~flt', 'a(is_not_positive)', 'b(is_gt_zero)'), True),
+   (('~fge', 'a(is_not_positive)', 'b(is_gt_zero)'), False),
+   (('ffloor', 'a(is_integral)'), a),
+   (('fceil', 'a(is_integral)'), a),
+   (('ftrunc', 'a(is_integral)'), a),
+   (('fround_even', 'a(is_integral)'), a),
+   (('~ffract', 'a(is_integral)'), 0.0),
+   (('imax', 'a(is_not_negative)', 0), a),
+   (('imin', 'a(is_not_positive)', 0), a),
+   (('imin', 'a(is_not_negative)', 0), 0),
+   (('imax', 'a(is_not_positive)', 0), 0),
+
    # 0.0 < fabs(a)
    # fabs(a) > 0.0
    # fabs(a) != 0.0 because fabs(a) must be >= 0
@@ -0,0 +1,738 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "nir_builder.h"
+
+#include "util/bitscan.h"
+#include "util/u_dynarray.h"
+#include "util/u_math.h"
+
+/* Combine loads and stores of adjacent memory into wider accesses.
+ *
+ * Scalarized SPIR-V and GLSL end up with one load_ssbo (or store_ssbo,
+ * load_shared, ...) per component of every vector, each of which becomes a
+ * memory message of its own in the back-end.  This per-block pass finds
+ * accesses to the same resource whose offsets only differ by a constant and
+ * replaces them with a single access covering both of them, as long as the
+ * driver callback accepts the resulting bit size, number of components and
+ * alignment.
+ *
+ * A load is combined into the earlier of the two loads and a store into the
+ * later of the two stores, so the access that moves must not cross anything
+ * that may alias it.  Accesses with the same resource and the same
+ * non-constant offset only alias when their ranges overlap, ACCESS_RESTRICT
+ * accesses to different resources never alias, and anything else in the
+ * same mode is assumed to (SSBOs and global memory being the same mode as far
+ * as this pass is concerned).  Barriers and calls stop everything, deref
+ * intrinsics use the mode of their deref, and other intrinsics with side
+ * effects are assumed to access any buffer memory.
+ */
+
+/* Alignment reported when nothing limits it, the offset of a fully constant
+ * access being 0 for example.
+ */
+#define MAX_ALIGN 256
+
+#define MEMORY_MODES (nir_var_mem_ubo | nir_var_mem_ssbo | \
+                      nir_var_mem_shared | nir_var_mem_global)
+
+struct intrinsic_info {
+   nir_variable_mode mode;
+   bool is_load;
+   bool is_atomic;
+
+   /* Index of the resource, offset and stored value sources, -1 if none. */
+   int resource_src;
+   int offset_src;
+   int value_src;
+};
+
+static const struct intrinsic_info *
+get_info(nir_intrinsic_op op)
+{
+   switch (op) {
+#define INFO(mode, op, load, atomic, res, off, val)                           \
+   case nir_intrinsic_##op: {                                                 \
+      static const struct intrinsic_info op##_info = {                        \
+         mode, load, atomic, res, off, val                                    \
+      };                                                                      \
+      return &op##_info;                                                      \
+   }
+#define LOAD(mode, op, res, off) \
+   INFO(mode, load_##op, true, false, res, off, -1)
+#define STORE(mode, op, res, off, val) \
+   INFO(mode, store_##op, false, false, res, off, val)
+#define ATOMIC(mode, type, op, res, off) \
+   INFO(mode, type##_atomic_##op, false, true, res, off, -1)
+#define ATOMICS(mode, type, res, off)        \
+   ATOMIC(mode, type, add, res, off)         \
+   ATOMIC(mode, type, imin, res, off)        \
+   ATOMIC(mode, type, umin, res, off)        \
+   ATOMIC(mode, type, imax, res, off)        \
+   ATOMIC(mode, type, umax, res, off)        \
+   ATOMIC(mode, type, and, res, off)         \
+   ATOMIC(mode, type, or, res, off)          \
+   ATOMIC(mode, type, xor, res, off)         \
+   ATOMIC(mode, type, exchange, res, off)    \
+   ATOMIC(mode, type, comp_swap, res, off)   \
+   ATOMIC(mode, type, fadd, res, off)        \
+   ATOMIC(mode, type, fmin, res, off)        \
+   ATOMIC(mode, type, fmax, res, off)        \
+   ATOMIC(mode, type, fcomp_swap, res, off)
+   LOAD(nir_var_mem_ubo, ubo, 0, 1)
+   LOAD(nir_var_mem_ssbo, ssbo, 0, 1)
+   STORE(nir_var_mem_ssbo, ssbo, 1, 2, 0)
+   LOAD(nir_var_mem_shared, shared, -1, 0)
+   STORE(nir_var_mem_shared, shared, -1, 1, 0)
+   LOAD(nir_var_mem_global, global, -1, 0)
+   STORE(nir_var_mem_global, global, -1, 1, 0)
+   ATOMICS(nir_var_mem_ssbo, ssbo, 0, 1)
+   ATOMICS(nir_var_mem_shared, shared, -1, 0)
+   ATOMICS(nir_var_mem_global, global, -1, 0)
+#undef ATOMICS
+#undef ATOMIC
+#undef STORE
+#undef LOAD
+#undef INFO
+   default:
+      return NULL;
+   }
+}
+
+/* A memory access, or anything else that has to be ordered with them. */
+struct entry {
+   nir_intrinsic_instr *intrin;
+
+   /* NULL unless the address is known, i.e. intrin is a load, store or
+    * atomic handled by the pass.
+    */
+   const struct intrinsic_info *info;
+
+   /* Set once the access has been combined into another one. */
+   bool removed;
+
+   /* Modes this may read and write, SSBOs and global memory always go
+    * together.
+    */
+   nir_variable_mode read_modes;
+   nir_variable_mode write_modes;
+
+   /* The address is resource + base + offset, the base being the
+    * non-constant part of the offset source (NULL if it is constant) and the
+    * offset the constant part, including the BASE index.
+    */
+   nir_ssa_def *resource;
+   nir_ssa_def *base;
+   unsigned base_comp;
+   int64_t offset;
+
+   unsigned bit_size;
+   unsigned num_components;
+   unsigned align;
+   enum gl_access_qualifier access;
+};
+
+struct vectorize_ctx {
+   nir_variable_mode modes;
+   nir_should_vectorize_mem_func callback;
+
+   /* Entries of the current block, in program order. */
+   struct util_dynarray entries;
+
+   void *lin_ctx;
+   nir_builder b;
+};
+
+static unsigned
+get_index(const nir_intrinsic_instr *intrin, nir_intrinsic_index_flag flag)
+{
+   const nir_intrinsic_info *info = &nir_intrinsic_infos[intrin->intrinsic];
+   if (!info->index_map[flag])
+      return 0;
+   return intrin->const_index[info->index_map[flag] - 1];
+}
+
+static nir_variable_mode
+get_alias_modes(nir_variable_mode modes)
+{
+   /* Global addresses may point into SSBOs. */
+   if (modes & (nir_var_mem_ssbo | nir_var_mem_global))
+      modes |= nir_var_mem_ssbo | nir_var_mem_global;
+   return modes & MEMORY_MODES;
+}
+
+static unsigned
+entry_size(const struct entry *entry)
+{
+   return entry->num_components * (entry->bit_size / 8);
+}
+
+static unsigned
+lowest_bit_align(uint64_t value)
+{
+   if (value == 0)
+      return MAX_ALIGN;
+   return MIN2(1ull << (ffsll(value) - 1), MAX_ALIGN);
+}
+
+/* Split an offset into a non-constant base and the constant added to it by
+ * a chain of iadds.
+ */
+static void
+parse_offset(struct entry *entry, nir_ssa_def *def, unsigned comp)
+{
+   int64_t offset = 0;
+
+   while (true) {
+      if (def->parent_instr->type == nir_instr_type_load_const) {
+         offset += nir_src_comp_as_int(nir_src_for_ssa(def), comp);
+         def = NULL;
+         break;
+      }
+
+      if (def->parent_instr->type != nir_instr_type_alu)
+         break;
+
+      nir_alu_instr *alu = nir_instr_as_alu(def->parent_instr);
+      if (alu->op != nir_op_iadd || !alu->src[0].src.is_ssa ||
+          !alu->src[1].src.is_ssa || alu->src[0].negate || alu->src[1].negate)
+         break;
+
+      unsigned const_src;
+      if (nir_src_is_const(alu->src[1].src))
+         const_src = 1;
+      else if (nir_src_is_const(alu->src[0].src))
+         const_src = 0;
+      else
+         break;
+
+      offset += nir_src_comp_as_int(alu->src[const_src].src,
+                                    alu->src[const_src].swizzle[comp]);
+      def = alu->src[!const_src].src.ssa;
+      comp = alu->src[!const_src].swizzle[comp];
+   }
+
+   entry->base = def;
+   entry->base_comp = comp;
+   entry->offset = offset;
+}
+
+/* Alignment of the base, as far as it can be told from an imul or ishl by a
+ * constant.
+ */
+static unsigned
+get_base_align(nir_ssa_def *def, unsigned comp)
+{
+   if (def->parent_instr->type != nir_instr_type_alu)
+      return 1;
+
+   nir_alu_instr *alu = nir_instr_as_alu(def->parent_instr);
+   if (alu->op == nir_op_imul) {
+      for (unsigned i = 0; i < 2; i++) {
+         if (nir_src_is_const(alu->src[i].src)) {
+            return lowest_bit_align(
+               nir_src_comp_as_uint(alu->src[i].src, alu->src[i].swizzle[comp]));
+         }
+      }
+   } else if (alu->op == nir_op_ishl && nir_src_is_const(alu->src[1].src)) {
+      uint64_t shift =
+         nir_src_comp_as_uint(alu->src[1].src, alu->src[1].swizzle[comp]);
+      return shift < util_logbase2(MAX_ALIGN) ? 1u << shift : MAX_ALIGN;
+   }
+
+   return 1;
+}
+
+static struct entry *
+create_entry(struct vectorize_ctx *ctx, nir_intrinsic_instr *intrin,
+             const struct intrinsic_info *info)
+{
+   struct entry *entry = linear_zalloc_child(ctx->lin_ctx, sizeof(*entry));
+   entry->intrin = intrin;
+
+   /* Only SSA values can be compared or combined. */
+   if (!intrin->src[info->offset_src].is_ssa ||
+       (info->resource_src >= 0 && !intrin->src[info->resource_src].is_ssa) ||
+       (info->value_src >= 0 && !intrin->src[info->value_src].is_ssa) ||
+       (info->value_src < 0 && !intrin->dest.is_ssa))
+      info = NULL;
+
+   if (!info) {
+      entry->read_modes = entry->write_modes = MEMORY_MODES;
+      return entry;
+   }
+
+   entry->info = info;
+   entry->read_modes = info->is_load || info->is_atomic ?
+                       get_alias_modes(info->mode) : 0;
+   entry->write_modes = !info->is_load ? get_alias_modes(info->mode) : 0;
+   entry->access = get_index(intrin, NIR_INTRINSIC_ACCESS);
+
+   if (info->resource_src >= 0)
+      entry->resource = intrin->src[info->resource_src].ssa;
+
+   parse_offset(entry, intrin->src[info->offset_src].ssa, 0);
+   entry->offset += (int) get_index(intrin, NIR_INTRINSIC_BASE);
+
+   if (info->value_src >= 0) {
+      entry->bit_size = intrin->src[info->value_src].ssa->bit_size;
+      entry->num_components = intrin->num_components;
+   } else {
+      entry->bit_size = intrin->dest.ssa.bit_size;
+      entry->num_components = intrin->dest.ssa.num_components;
+   }
+
+   /* Scalar accesses are always naturally aligned. */
+   unsigned align = lowest_bit_align(entry->offset);
+   if (entry->base)
+      align = MIN2(align, get_base_align(entry->base, entry->base_comp));
+   align = MAX2(align, entry->bit_size / 8);
+   if (get_index(intrin, NIR_INTRINSIC_ALIGN_MUL))
+      align = MAX2(align, nir_intrinsic_align(intrin));
+   entry->align = MIN2(align, MAX_ALIGN);
+
+   return entry;
+}
+
+static nir_variable_mode
+get_deref_modes(nir_intrinsic_instr *intrin)
+{
+   const nir_intrinsic_info *info = &nir_intrinsic_infos[intrin->intrinsic];
+   nir_variable_mode modes = 0;
+
+   for (unsigned i = 0; i < info->num_srcs; i++) {
+      if (!intrin->src[i].is_ssa ||
+          intrin->src[i].ssa->parent_instr->type != nir_instr_type_deref)
+         continue;
+
+      nir_deref_instr *deref = nir_src_as_deref(intrin->src[i]);
+      /* Images are uniforms, but may be texel buffers backed by an SSBO. */
+      if (deref->mode == nir_var_uniform)
+         modes |= nir_var_mem_ssbo;
+      else
+         modes |= deref->mode;
+   }
+
+   return modes;
+}
+
+/* Returns an entry for an instruction that is neither a load, store nor
+ * atomic the pass knows about, or NULL if it doesn't access memory.
+ */
+static struct entry *
+create_other_entry(struct vectorize_ctx *ctx, nir_instr *instr)
+{
+   nir_variable_mode read_modes, write_modes;
+
+   if (instr->type == nir_instr_type_call) {
+      read_modes = write_modes = MEMORY_MODES;
+   } else if (instr->type == nir_instr_type_intrinsic) {
+      nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+      const nir_intrinsic_info *info =
+         &nir_intrinsic_infos[intrin->intrinsic];
+
+      switch (intrin->intrinsic) {
+      case nir_intrinsic_memory_barrier_atomic_counter:
+      case nir_intrinsic_memory_barrier_buffer:
+      case nir_intrinsic_memory_barrier_image:
+         read_modes = write_modes = nir_var_mem_ssbo;
+         break;
+
+      case nir_intrinsic_memory_barrier_shared:
+         read_modes = write_modes = nir_var_mem_shared;
+         break;
+
+      case nir_intrinsic_barrier:
+      case nir_intrinsic_group_memory_barrier:
+      case nir_intrinsic_memory_barrier:
+      case nir_intrinsic_begin_invocation_interlock:
+      case nir_intrinsic_end_invocation_interlock:
+         read_modes = write_modes = MEMORY_MODES;
+         break;
+
+      case nir_intrinsic_store_output:
+      case nir_intrinsic_store_per_vertex_output:
+         return NULL;
+
+      default:
+         if (info->flags & NIR_INTRINSIC_CAN_REORDER)
+            return NULL;
+
+         read_modes = get_deref_modes(intrin);
+         if (!read_modes)
+            read_modes = MEMORY_MODES;
+         write_modes = info->flags & NIR_INTRINSIC_CAN_ELIMINATE ?
+                       0 : read_modes;
+         break;
+      }
+   } else {
+      return NULL;
+   }
+
+   read_modes = get_alias_modes(read_modes);
+   write_modes = get_alias_modes(write_modes);
+   if (!read_modes && !write_modes)
+      return NULL;
+
+   struct entry *entry = linear_zalloc_child(ctx->lin_ctx, sizeof(*entry));
+   entry->read_modes = read_modes;
+   entry->write_modes = write_modes;
+   return entry;
+}
+
+static bool
+resources_equal(nir_ssa_def *a, nir_ssa_def *b)
+{
+   if (a == b)
+      return true;
+   if (!a || !b || a->num_components != 1 || b->num_components != 1)
+      return false;
+
+   /* Constant indices aren't always CSE'd yet. */
+   nir_src a_src = nir_src_for_ssa(a), b_src = nir_src_for_ssa(b);
+   return nir_src_is_const(a_src) && nir_src_is_const(b_src) &&
+          nir_src_as_uint(a_src) == nir_src_as_uint(b_src);
+}
+
+static bool
+may_alias(const struct entry *a, const struct entry *b)
+{
+   if (!(a->write_modes & (b->read_modes | b->write_modes)) &&
+       !(b->write_modes & a->read_modes))
+      return false;
+
+   if (!a->info || !b->info || ((a->access | b->access) & ACCESS_VOLATILE))
+      return true;
+
+   if (resources_equal(a->resource, b->resource) && a->base == b->base &&
+       a->base_comp == b->base_comp && a->info->mode == b->info->mode) {
+      return a->offset < b->offset + entry_size(b) &&
+             b->offset < a->offset + entry_size(a);
+   }
+
+   if (a->resource && b->resource &&
+       !resources_equal(a->resource, b->resource) &&
+       (a->access & b->access & ACCESS_RESTRICT))
+      return false;
+
+   return true;
+}
+
+static bool
+can_vectorize(struct vectorize_ctx *ctx, const struct entry *entry)
+{
+   return entry->info && !entry->info->is_atomic &&
+          (entry->info->mode & ctx->modes) &&
+          !(entry->access & ACCESS_VOLATILE);
+}
+
+/* Whether the stored value of entry can be moved down to the end of the
+ * block's entries.
+ */
+static bool
+can_move_store_down(struct vectorize_ctx *ctx, unsigned index)
+{
+   struct entry **entries = ctx->entries.data;
+   unsigned num_entries = util_dynarray_num_elements(&ctx->entries,
+                                                     struct entry *);
+
+   for (unsigned i = index + 1; i < num_entries; i++) {
+      if (!entries[i]->removed && may_alias(entries[i], entries[index]))
+         return false;
+   }
+
+   return true;
+}
+
+static nir_ssa_def *
+get_adjusted_offset(nir_builder *b, struct entry *entry, int64_t offset)
+{
+   nir_ssa_def *def = entry->intrin->src[entry->info->offset_src].ssa;
+   if (offset == entry->offset)
+      return def;
+   return nir_iadd_imm(b, def, offset - entry->offset);
+}
+
+static nir_intrinsic_instr *
+create_combined(nir_builder *b, struct entry *from, int64_t offset,
+                unsigned num_components, unsigned align)
+{
+   nir_intrinsic_instr *intrin = from->intrin;
+   const nir_intrinsic_info *info = &nir_intrinsic_infos[intrin->intrinsic];
+
+   nir_intrinsic_instr *new_intrin =
+      nir_intrinsic_instr_create(b->shader, intrin->intrinsic);
+   new_intrin->num_components = num_components;
+
+   for (unsigned i = 0; i < info->num_srcs; i++)
+      new_intrin->src[i] = nir_src_for_ssa(intrin->src[i].ssa);
+   new_intrin->src[from->info->offset_src] =
+      nir_src_for_ssa(get_adjusted_offset(b, from, offset));
+
+   memcpy(new_intrin->const_index, intrin->const_index,
+          sizeof(intrin->const_index));
+   if (info->index_map[NIR_INTRINSIC_ALIGN_MUL])
+      nir_intrinsic_set_align(new_intrin, align, 0);
+
+   return new_intrin;
+}
+
+/* Combines the loads of first and second into a new load in place of first.
+ * The entry of first is updated to match it.
+ */
+static void
+combine_loads(struct vectorize_ctx *ctx, struct entry *first,
+              struct entry *second, int64_t offset,
+              unsigned num_components, unsigned align)
+{
+   nir_builder *b = &ctx->b;
+   b->cursor = nir_before_instr(&first->intrin->instr);
+
+   nir_intrinsic_instr *new_intrin =
+      create_combined(b, first, offset, num_components, align);
+   nir_ssa_dest_init(&new_intrin->instr, &new_intrin->dest, num_components,
+                     first->bit_size, NULL);
+   nir_builder_instr_insert(b, &new_intrin->instr);
+
+   struct entry *entries[2] = { first, second };
+   for (unsigned i = 0; i < 2; i++) {
+      struct entry *entry = entries[i];
+      unsigned start = (entry->offset - offset) / (entry->bit_size / 8);
+      nir_component_mask_t mask =
+         BITFIELD_MASK(entry->num_components) << start;
+
+      nir_ssa_def *data = nir_channels(b, &new_intrin->dest.ssa, mask);
+      nir_ssa_def_rewrite_uses(&entry->intrin->dest.ssa,
+                               nir_src_for_ssa(data));
+      nir_instr_remove(&entry->intrin->instr);
+   }
+
+   first->intrin = new_intrin;
+   first->offset = offset;
+   first->num_components = num_components;
+   first->align = align;
+}
+
+/* Combines the stores of first and second into a new store in place of
+ * second, second taking precedence where they overlap.  The entry of second
+ * is updated to match it.
+ */
+static bool
+combine_stores(struct vectorize_ctx *ctx, struct entry *first,
+               struct entry *second, int64_t offset,
+               unsigned num_components, unsigned align)
+{
+   const unsigned comp_size = first->bit_size / 8;
+   struct entry *sources[NIR_MAX_VEC_COMPONENTS];
+   unsigned channels[NIR_MAX_VEC_COMPONENTS];
+
+   /* Back-ends can't be expected to handle holes in the write mask. */
+   for (unsigned i = 0; i < num_components; i++) {
+      sources[i] = NULL;
+
+      struct entry *entries[2] = { second, first };
+      for (unsigned j = 0; j < 2 && !sources[i]; j++) {
+         int64_t comp_offset = offset + i * comp_size - entries[j]->offset;
+         if (comp_offset < 0 || comp_offset >= entry_size(entries[j]))
+            continue;
+
+         unsigned channel = comp_offset / comp_size;
+         if (nir_intrinsic_write_mask(entries[j]->intrin) & (1 << channel)) {
+            sources[i] = entries[j];
+            channels[i] = channel;
+         }
+      }
+
+      if (!sources[i])
+         return false;
+   }
+
+   nir_builder *b = &ctx->b;
+   b->cursor = nir_before_instr(&second->intrin->instr);
+
+   nir_ssa_def *comps[NIR_MAX_VEC_COMPONENTS];
+   for (unsigned i = 0; i < num_components; i++) {
+      nir_ssa_def *value =
+         sources[i]->intrin->src[sources[i]->info->value_src].ssa;
+      comps[i] = nir_channel(b, value, channels[i]);
+   }
+   nir_ssa_def *data = nir_vec(b, comps, num_components);
+
+   nir_intrinsic_instr *new_intrin =
+      create_combined(b, second, offset, num_components, align);
+   new_intrin->src[second->info->value_src] = nir_src_for_ssa(data);
+   nir_intrinsic_set_write_mask(new_intrin, BITFIELD_MASK(num_components));
+   nir_builder_instr_insert(b, &new_intrin->instr);
+
+   nir_instr_remove(&first->intrin->instr);
+   nir_instr_remove(&second->intrin->instr);
+
+   second->intrin = new_intrin;
+   second->offset = offset;
+   second->num_components = num_components;
+   second->align = align;
+   return true;
+}
+
+static bool
+try_combine(struct vectorize_ctx *ctx, struct entry *first,
+            struct entry *second)
+{
+   if (first->info != second->info ||
+       !resources_equal(first->resource, second->resource) ||
+       first->base != second->base ||
+       first->base_comp != second->base_comp ||
+       first->bit_size != second->bit_size ||
+       first->access != second->access)
+      return false;
+
+   const unsigned comp_size = first->bit_size / 8;
+   struct entry *low = first->offset <= second->offset ? first : second;
+   struct entry *high = low == first ? second : first;
+
+   uint64_t high_offset = high->offset - low->offset;
+   if (high_offset % comp_size || high_offset > entry_size(low))
+      return false;
+
+   int64_t end = MAX2(low->offset + entry_size(low),
+                      high->offset + entry_size(high));
+   unsigned num_components = (end - low->offset) / comp_size;
+   if (num_components > NIR_MAX_VEC_COMPONENTS)
+      return false;
+
+   if (!ctx->callback(low->align, first->bit_size, num_components,
+                      high_offset, low->intrin, high->intrin))
+      return false;
+
+   if (first->info->is_load) {
+      combine_loads(ctx, first, second, low->offset, num_components,
+                    low->align);
+      return true;
+   } else {
+      return combine_stores(ctx, first, second, low->offset, num_components,
+                            low->align);
+   }
+}
+
+/* Tries to combine entry with an earlier access.  Returns whether it was
+ * combined into an earlier load, in which case it's gone.
+ */
+static bool
+vectorize_entry(struct vectorize_ctx *ctx, struct entry *entry,
+                bool *progress)
+{
+   struct entry **entries = ctx->entries.data;
+   unsigned num_entries = util_dynarray_num_elements(&ctx->entries,
+                                                     struct entry *);
+
+   for (unsigned i = num_entries; i-- > 0;) {
+      struct entry *other = entries[i];
+      if (other->removed)
+         continue;
+
+      if (can_vectorize(ctx, other) &&
+          (entry->info->is_load || can_move_store_down(ctx, i)) &&
+          try_combine(ctx, other, entry)) {
+         *progress = true;
+         if (entry->info->is_load)
+            return true;
+
+         other->removed = true;
+         continue;
+      }
+
+      /* A load can't move up past anything that may write to it, and
+       * nothing moves past barriers.
+       */
+      if ((!other->info || entry->info->is_load) && may_alias(other, entry))
+         break;
+   }
+
+   return false;
+}
+
+static bool
+process_block(struct vectorize_ctx *ctx, nir_block *block)
+{
+   bool progress = false;
+
+   util_dynarray_clear(&ctx->entries);
+
+   nir_foreach_instr_safe(instr, block) {
+      const struct intrinsic_info *info = NULL;
+      if (instr->type == nir_instr_type_intrinsic)
+         info = get_info(nir_instr_as_intrinsic(instr)->intrinsic);
+
+      struct entry *entry;
+      if (info) {
+         entry = create_entry(ctx, nir_instr_as_intrinsic(instr), info);
+         if (can_vectorize(ctx, entry) &&
+             vectorize_entry(ctx, entry, &progress))
+            continue;
+      } else {
+         entry = create_other_entry(ctx, instr);
+         if (!entry)
+            continue;
+      }
+
+      util_dynarray_append(&ctx->entries, struct entry *, entry);
+   }
+
+   return progress;
+}
+
+bool
+nir_opt_load_store_vectorize(nir_shader *shader, nir_variable_mode modes,
+                             nir_should_vectorize_mem_func callback)
+{
+   void *mem_ctx = ralloc_arena_context(NULL);
+   struct vectorize_ctx ctx = {
+      .modes = modes,
+      .callback = callback,
+      .lin_ctx = linear_zalloc_parent(mem_ctx, 0),
+   };
+   util_dynarray_init(&ctx.entries, mem_ctx);
+
+   bool progress = false;
+
+   nir_foreach_function(function, shader) {
+      if (!function->impl)
+         continue;
+
+      nir_builder_init(&ctx.b, function->impl);
+
+      bool impl_progress = false;
+      nir_foreach_block(block, function->impl)
+         impl_progress |= process_block(&ctx, block);
+
+      if (impl_progress) {
+         nir_metadata_preserve(function->impl, nir_metadata_block_index |
+                                               nir_metadata_dominance);
+         progress = true;
+      }
+   }
+
+   ralloc_free(mem_ctx);
+   return progress;
+}
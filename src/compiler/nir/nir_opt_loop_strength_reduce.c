@@ -0,0 +1,370 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "nir_builder.h"
+
+/**
+ * \file nir_opt_loop_strength_reduce.c
+ *
+ * Strength reduction of the expressions of induction variables.
+ *
+ * Loops walking through memory usually compute their addresses as a linear
+ * function of the loop counter:
+ *
+ *    loop {
+ *       i = phi(init, i_next)
+ *       ...
+ *       offset = i * stride + base
+ *       ...
+ *       i_next = i + step
+ *    }
+ *
+ * When stride and base are loop invariant, such expressions are replaced by
+ * an induction variable of their own, which is stepped by an addition:
+ *
+ *    offset_init = init * stride + base
+ *    offset_step = step * stride
+ *    loop {
+ *       i = phi(init, i_next)
+ *       offset = phi(offset_init, offset_next)
+ *       ...
+ *       i_next = i + step
+ *       offset_next = offset + offset_step
+ *    }
+ *
+ * Multiplications and left shifts of the induction variable are handled,
+ * along with the addition of an invariant following them.  Only integer
+ * induction variables stepped by an addition are considered, as the rewrite
+ * relies on integer arithmetic wrapping around.
+ */
+
+static bool
+is_defined_before_loop(nir_ssa_def *def, nir_loop *loop)
+{
+   /* A value defined before the loop and used inside of it dominates the
+    * loop header, and so the end of the block preceding the loop.
+    */
+   return def->parent_instr->block->index <
+          nir_loop_first_block(loop)->index;
+}
+
+static bool
+is_in_loop(nir_instr *instr, nir_loop *loop)
+{
+   return instr->block->index >= nir_loop_first_block(loop)->index &&
+          instr->block->index <= nir_loop_last_block(loop)->index;
+}
+
+static bool
+has_source_mods(nir_alu_instr *alu)
+{
+   if (alu->dest.saturate)
+      return true;
+
+   for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++) {
+      if (alu->src[i].abs || alu->src[i].negate)
+         return true;
+   }
+
+   return false;
+}
+
+/**
+ * Whether source \p src of \p alu can be computed before the loop.
+ */
+static bool
+is_src_available(nir_alu_instr *alu, unsigned src, nir_loop *loop)
+{
+   return nir_src_is_const(alu->src[src].src) ||
+          is_defined_before_loop(alu->src[src].src.ssa, loop);
+}
+
+/**
+ * Returns the value of source \p src of \p alu at the cursor of \p b, which
+ * is before the loop.  Constants are rematerialized there as they may be
+ * defined inside the loop.
+ */
+static nir_ssa_def *
+get_src_before_loop(nir_builder *b, nir_alu_instr *alu, unsigned src)
+{
+   if (nir_src_is_const(alu->src[src].src)) {
+      nir_load_const_instr *load =
+         nir_instr_as_load_const(alu->src[src].src.ssa->parent_instr);
+      return nir_build_imm(b, 1, load->def.bit_size,
+                           &load->value[alu->src[src].swizzle[0]]);
+   }
+
+   return nir_ssa_for_alu_src(b, alu, src);
+}
+
+/**
+ * Checks that \p iv is stepped by an addition on every iteration and returns
+ * the index of the source of its update that is the step, or -1.
+ */
+static int
+get_step_src(nir_loop *loop, nir_block *preheader,
+             nir_loop_induction_variable *iv)
+{
+   nir_alu_instr *update = iv->update;
+
+   if (update->op != nir_op_iadd || iv->def->num_components != 1 ||
+       has_source_mods(update))
+      return -1;
+
+   nir_instr *phi_instr = iv->def->parent_instr;
+   if (phi_instr->block != nir_loop_first_block(loop))
+      return -1;
+
+   /* Every iteration has to go through the update, so that the value of the
+    * reduced variable can be stepped next to it.
+    */
+   nir_foreach_phi_src(src, nir_instr_as_phi(phi_instr)) {
+      if (src->pred == preheader)
+         continue;
+
+      if (src->src.ssa != &update->dest.dest.ssa ||
+          !nir_block_dominates(update->instr.block, src->pred))
+         return -1;
+   }
+
+   int step_src = update->src[0].src.ssa == iv->def ? 1 : 0;
+   if (update->src[1 - step_src].src.ssa != iv->def ||
+       !is_src_available(update, step_src, loop))
+      return -1;
+
+   return step_src;
+}
+
+/**
+ * Checks whether \p alu is a multiplication or left shift of the induction
+ * variable by a loop invariant and returns the index of the source that is
+ * the factor, or -1.
+ */
+static int
+get_factor_src(nir_alu_instr *alu, nir_loop *loop, nir_ssa_def *iv_def)
+{
+   if (has_source_mods(alu) || alu->dest.dest.ssa.num_components != 1)
+      return -1;
+
+   switch (alu->op) {
+   case nir_op_imul:
+      for (unsigned i = 0; i < 2; i++) {
+         if (alu->src[1 - i].src.ssa == iv_def &&
+             is_src_available(alu, i, loop))
+            return i;
+      }
+      return -1;
+
+   case nir_op_ishl:
+      if (alu->src[0].src.ssa == iv_def && is_src_available(alu, 1, loop))
+         return 1;
+      return -1;
+
+   default:
+      return -1;
+   }
+}
+
+/**
+ * If the only use of \p alu is an addition of a loop invariant, returns that
+ * addition and the index of its invariant source in \p offset_src.
+ */
+static nir_alu_instr *
+get_offset_add(nir_alu_instr *alu, nir_loop *loop, unsigned *offset_src)
+{
+   if (!list_is_singular(&alu->dest.dest.ssa.uses) ||
+       !list_empty(&alu->dest.dest.ssa.if_uses))
+      return NULL;
+
+   nir_src *use = list_first_entry(&alu->dest.dest.ssa.uses, nir_src,
+                                   use_link);
+   if (use->parent_instr->type != nir_instr_type_alu)
+      return NULL;
+
+   /* The addition is replaced by a scalar phi, so it can't be a vector
+    * addition of the broadcast product.
+    */
+   nir_alu_instr *add = nir_instr_as_alu(use->parent_instr);
+   if (add->op != nir_op_iadd || has_source_mods(add) ||
+       add->dest.dest.ssa.num_components != 1 ||
+       !is_in_loop(&add->instr, loop))
+      return NULL;
+
+   for (unsigned i = 0; i < 2; i++) {
+      if (add->src[1 - i].src.ssa == &alu->dest.dest.ssa &&
+          add->src[1 - i].swizzle[0] == 0 &&
+          is_src_available(add, i, loop)) {
+         *offset_src = i;
+         return add;
+      }
+   }
+
+   return NULL;
+}
+
+static bool
+reduce_induction_var(nir_builder *b, nir_loop *loop, nir_block *preheader,
+                     nir_loop_induction_variable *iv)
+{
+   int step_src = get_step_src(loop, preheader, iv);
+   if (step_src < 0)
+      return false;
+
+   nir_phi_instr *iv_phi = nir_instr_as_phi(iv->def->parent_instr);
+   bool progress = false;
+
+   nir_foreach_use_safe(use, iv->def) {
+      if (use->parent_instr->type != nir_instr_type_alu ||
+          !is_in_loop(use->parent_instr, loop))
+         continue;
+
+      nir_alu_instr *alu = nir_instr_as_alu(use->parent_instr);
+      int factor_src = get_factor_src(alu, loop, iv->def);
+      if (factor_src < 0)
+         continue;
+
+      unsigned offset_src = 0;
+      nir_alu_instr *add = get_offset_add(alu, loop, &offset_src);
+
+      /* Compute the initial value and the step of the new variable before
+       * the loop.
+       */
+      b->cursor = nir_after_block_before_jump(preheader);
+
+      nir_ssa_def *factor = get_src_before_loop(b, alu, factor_src);
+      nir_ssa_def *init =
+         nir_build_alu(b, alu->op, iv->init, factor, NULL, NULL);
+      nir_ssa_def *step =
+         nir_build_alu(b, alu->op, get_src_before_loop(b, iv->update, step_src),
+                       factor, NULL, NULL);
+      if (add)
+         init = nir_iadd(b, init, get_src_before_loop(b, add, offset_src));
+
+      nir_phi_instr *phi = nir_phi_instr_create(b->shader);
+      nir_ssa_dest_init(&phi->instr, &phi->dest, 1, init->bit_size, NULL);
+
+      /* Step it next to the induction variable. */
+      b->cursor = nir_after_instr(&iv->update->instr);
+      nir_ssa_def *next = nir_iadd(b, &phi->dest.ssa, step);
+
+      nir_foreach_phi_src(src, iv_phi) {
+         nir_phi_src *phi_src = ralloc(phi, nir_phi_src);
+         phi_src->pred = src->pred;
+         phi_src->src = nir_src_for_ssa(src->pred == preheader ? init : next);
+         exec_list_push_tail(&phi->srcs, &phi_src->node);
+      }
+
+      nir_instr_insert(nir_before_block(iv_phi->instr.block), &phi->instr);
+
+      nir_alu_instr *reduced = add ? add : alu;
+      nir_ssa_def_rewrite_uses(&reduced->dest.dest.ssa,
+                               nir_src_for_ssa(&phi->dest.ssa));
+      nir_instr_remove(&reduced->instr);
+      if (add)
+         nir_instr_remove(&alu->instr);
+
+      progress = true;
+   }
+
+   return progress;
+}
+
+static bool
+process_loops(nir_builder *b, nir_cf_node *cf_node)
+{
+   bool progress = false;
+
+   switch (cf_node->type) {
+   case nir_cf_node_block:
+      return false;
+   case nir_cf_node_if: {
+      nir_if *nif = nir_cf_node_as_if(cf_node);
+      foreach_list_typed(nir_cf_node, nested_node, node, &nif->then_list)
+         progress |= process_loops(b, nested_node);
+      foreach_list_typed(nir_cf_node, nested_node, node, &nif->else_list)
+         progress |= process_loops(b, nested_node);
+      return progress;
+   }
+   case nir_cf_node_loop:
+      break;
+   default:
+      unreachable("unknown cf node type");
+   }
+
+   nir_loop *loop = nir_cf_node_as_loop(cf_node);
+   foreach_list_typed(nir_cf_node, nested_node, node, &loop->body)
+      progress |= process_loops(b, nested_node);
+
+   nir_block *preheader = nir_cf_node_as_block(nir_cf_node_prev(cf_node));
+   for (unsigned i = 0; i < loop->info->num_induction_vars; i++) {
+      progress |= reduce_induction_var(b, loop, preheader,
+                                       &loop->info->induction_vars[i]);
+   }
+
+   return progress;
+}
+
+static bool
+nir_opt_loop_strength_reduce_impl(nir_function_impl *impl,
+                                  nir_variable_mode indirect_mask)
+{
+   bool progress = false;
+
+   nir_metadata_require(impl, nir_metadata_block_index |
+                              nir_metadata_dominance |
+                              nir_metadata_loop_analysis, indirect_mask);
+
+   nir_builder b;
+   nir_builder_init(&b, impl);
+
+   foreach_list_typed(nir_cf_node, node, node, &impl->body)
+      progress |= process_loops(&b, node);
+
+   if (progress) {
+      nir_metadata_preserve(impl, nir_metadata_block_index |
+                                  nir_metadata_dominance);
+   }
+
+   return progress;
+}
+
+/**
+ * indirect_mask is only used for the loop analysis, it should match the one
+ * given to nir_opt_loop_unroll() so that they can share it.
+ */
+bool
+nir_opt_loop_strength_reduce(nir_shader *shader,
+                             nir_variable_mode indirect_mask)
+{
+   bool progress = false;
+
+   nir_foreach_function(function, shader) {
+      if (function->impl) {
+         progress |= nir_opt_loop_strength_reduce_impl(function->impl,
+                                                       indirect_mask);
+      }
+   }
+
+   return progress;
+}
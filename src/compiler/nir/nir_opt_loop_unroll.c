@@ -36,6 +36,13 @@
  */
 #define LOOP_UNROLL_LIMIT 26
 
+/* Loops too large to be unrolled completely are partially unrolled by the
+ * largest factor which keeps the unrolled body under this many instructions.
+ * The larger the loop, the less its branching and induction variable updates
+ * matter.
+ */
+#define PARTIAL_UNROLL_LIMIT 128
+
 /* Prepare this loop for unrolling by first converting to lcssa and then
  * converting the phis from the top level of the loop body to regs.
  * Partially converting out of SSA allows us to unroll the loop without having
@@ -770,6 +777,110 @@ partial_unroll(nir_shader *shader, nir_loop *loop, unsigned trip_count)
    _mesa_hash_table_destroy(remap_table, NULL);
 }
 
+/**
+ * Partially unroll a loop with a known trip count and a single terminator,
+ * by a factor dividing the trip count.  The terminator is only kept in the
+ * first copy of the loop body, as it can't exit the loop in the others.
+ *
+ *     loop {
+ *         ...header...
+ *         if (cond) break;
+ *         ...body...
+ *     }
+ *
+ * With a factor of 3, the output will be:
+ *
+ *     loop {
+ *         ...header...
+ *         if (cond) break;
+ *         ...body... ...header... ...body... ...header... ...body...
+ *     }
+ */
+static void
+factor_unroll(nir_loop *loop, unsigned factor)
+{
+   nir_loop_terminator *terminator = loop->info->limiting_terminator;
+   assert(list_length(&loop->info->loop_terminator_list) == 1);
+   assert(nir_is_trivial_loop_if(terminator->nif, terminator->break_block));
+
+   loop_prepare_for_unroll(loop);
+
+   nir_block *first_break_block;
+   nir_block *first_continue_block;
+   get_first_blocks_in_terminator(terminator, &first_break_block,
+                                  &first_continue_block);
+
+   /* Move the continue from branch of the terminator to the loop body */
+   nir_cf_list continue_from_lst;
+   nir_cf_extract(&continue_from_lst, nir_before_block(first_continue_block),
+                  nir_after_block(terminator->continue_from_block));
+   nir_cf_reinsert(&continue_from_lst,
+                   nir_after_cf_node(&terminator->nif->cf_node));
+
+   /* Pluck out the loop header and body */
+   nir_cf_list lp_header;
+   nir_cf_extract(&lp_header, nir_before_block(nir_loop_first_block(loop)),
+                  nir_before_cf_node(&terminator->nif->cf_node));
+
+   nir_cf_list lp_body;
+   nir_cf_extract(&lp_body, nir_after_cf_node(&terminator->nif->cf_node),
+                  nir_after_block(nir_loop_last_block(loop)));
+
+   struct hash_table *remap_table = _mesa_pointer_hash_table_create(NULL);
+
+   /* Clone the loop body after the terminator, then the header and the body
+    * again for each other copy.
+    */
+   nir_cf_list_clone_and_reinsert(&lp_body, &loop->cf_node,
+                                  nir_after_cf_list(&loop->body),
+                                  remap_table);
+
+   for (unsigned i = 1; i < factor; i++) {
+      nir_cf_list_clone_and_reinsert(&lp_header, &loop->cf_node,
+                                     nir_after_cf_list(&loop->body),
+                                     remap_table);
+      nir_cf_list_clone_and_reinsert(&lp_body, &loop->cf_node,
+                                     nir_after_cf_list(&loop->body),
+                                     remap_table);
+   }
+
+   /* Put the original header back in front of the terminator */
+   nir_cf_reinsert(&lp_header, nir_before_cf_node(&terminator->nif->cf_node));
+   nir_cf_delete(&lp_body);
+
+   loop->partially_unrolled = true;
+
+   _mesa_hash_table_destroy(remap_table, NULL);
+}
+
+/**
+ * Returns the factor by which a loop, which is too large to be unrolled
+ * completely, should be partially unrolled, or 1 if it shouldn't be.
+ */
+static unsigned
+get_unroll_factor(nir_shader *shader, nir_loop *loop)
+{
+   nir_loop_info *li = loop->info;
+
+   if (loop->control == nir_loop_control_dont_unroll ||
+       loop->partially_unrolled || !li->exact_trip_count_known ||
+       list_length(&li->loop_terminator_list) != 1)
+      return 1;
+
+   /* Only factors dividing the trip count let us drop the terminator from
+    * all the copies of the loop body but the first.
+    */
+   unsigned factor = shader->options->max_partial_unroll_factor;
+   for (; factor > 1; factor--) {
+      if (li->max_trip_count % factor == 0 &&
+          li->max_trip_count / factor >= 2 &&
+          li->instr_cost * factor <= PARTIAL_UNROLL_LIMIT)
+         break;
+   }
+
+   return MAX2(factor, 1);
+}
+
 /*
  * Returns true if we should unroll the loop, otherwise false.
  */
@@ -866,8 +977,20 @@ process_loops(nir_shader *sh, nir_cf_node *cf_node, bool *has_nested_loop_out)
       if (has_nested_loop || !loop->info->limiting_terminator)
          goto exit;
 
-      if (!check_unrolling_restrictions(sh, loop))
+      /* Partially unrolled loops were too large to be unrolled completely,
+       * even if they now have fewer iterations.
+       */
+      if (loop->partially_unrolled)
+         goto exit;
+
+      if (!check_unrolling_restrictions(sh, loop)) {
+         unsigned factor = get_unroll_factor(sh, loop);
+         if (factor > 1) {
+            factor_unroll(loop, factor);
+            progress = true;
+         }
          goto exit;
+      }
 
       if (loop->info->exact_trip_count_known) {
          simple_unroll(loop);
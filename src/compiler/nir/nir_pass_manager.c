@@ -0,0 +1,211 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "nir.h"
+#include "c11/threads.h"
+#include "util/debug.h"
+#include "util/os_time.h"
+#include "util/simple_mtx.h"
+
+enum {
+   NIR_DEBUG_PASS_TIMING = 1 << 0,
+};
+
+static const struct debug_control nir_debug_control[] = {
+   { "pass_timing", NIR_DEBUG_PASS_TIMING },
+   { NULL, 0 },
+};
+
+static uint64_t nir_debug;
+static once_flag nir_debug_once = ONCE_FLAG_INIT;
+
+/* Totals of all the managers, by pass name. */
+static struct hash_table *pass_timing;
+static simple_mtx_t pass_timing_mtx = _SIMPLE_MTX_INITIALIZER_NP;
+
+static void
+print_pass_timing_at_exit(void)
+{
+   nir_print_pass_timing(stderr);
+}
+
+static void
+nir_debug_init(void)
+{
+   nir_debug = parse_debug_string(getenv("NIR_DEBUG"), nir_debug_control);
+
+   if (nir_debug & NIR_DEBUG_PASS_TIMING) {
+      pass_timing = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
+                                            _mesa_key_string_equal);
+      atexit(print_pass_timing_at_exit);
+   }
+}
+
+void
+nir_pass_manager_init(nir_pass_manager *pm)
+{
+   call_once(&nir_debug_once, nir_debug_init);
+
+   pm->records = _mesa_pointer_hash_table_create(NULL);
+   pm->generation = 0;
+}
+
+static void
+add_pass_timing(const nir_pass_record *record)
+{
+   struct hash_entry *entry =
+      _mesa_hash_table_search(pass_timing, record->name);
+   nir_pass_record *total;
+
+   if (entry) {
+      total = entry->data;
+   } else {
+      total = rzalloc(pass_timing, nir_pass_record);
+      total->name = ralloc_strdup(total, record->name);
+      _mesa_hash_table_insert(pass_timing, total->name, total);
+   }
+
+   total->runs += record->runs;
+   total->skips += record->skips;
+   total->progress += record->progress;
+   total->time_ns += record->time_ns;
+}
+
+void
+nir_pass_manager_finish(nir_pass_manager *pm)
+{
+   if (pass_timing) {
+      simple_mtx_lock(&pass_timing_mtx);
+      hash_table_foreach(pm->records, entry)
+         add_pass_timing(entry->data);
+      simple_mtx_unlock(&pass_timing_mtx);
+   }
+
+   _mesa_hash_table_destroy(pm->records, NULL);
+   pm->records = NULL;
+}
+
+/**
+ * Returns the record of the pass to run at \p site, or NULL if it can be
+ * skipped.
+ */
+nir_pass_record *
+nir_pass_manager_begin(nir_pass_manager *pm, const void *site,
+                       const char *name)
+{
+   struct hash_entry *entry = _mesa_hash_table_search(pm->records, site);
+   nir_pass_record *record;
+
+   if (entry) {
+      record = entry->data;
+   } else {
+      record = rzalloc(pm->records, nir_pass_record);
+      record->name = name;
+      _mesa_hash_table_insert(pm->records, site, record);
+   }
+
+   if (record->clean && record->clean_generation == pm->generation) {
+      record->skips++;
+      return NULL;
+   }
+
+   record->start_ns = os_time_get_nano();
+   return record;
+}
+
+/**
+ * Records the result of a pass started with nir_pass_manager_begin(), and
+ * returns its progress.
+ */
+bool
+nir_pass_manager_end(nir_pass_manager *pm, nir_pass_record *record,
+                     bool progress)
+{
+   record->time_ns += os_time_get_nano() - record->start_ns;
+   record->runs++;
+
+   if (progress) {
+      record->progress++;
+      record->clean = false;
+      pm->generation++;
+   } else {
+      record->clean = true;
+      record->clean_generation = pm->generation;
+   }
+
+   return progress;
+}
+
+static int
+compare_time(const void *a, const void *b)
+{
+   const nir_pass_record *ra = *(const nir_pass_record **) a;
+   const nir_pass_record *rb = *(const nir_pass_record **) b;
+
+   if (ra->time_ns != rb->time_ns)
+      return ra->time_ns < rb->time_ns ? 1 : -1;
+   return strcmp(ra->name, rb->name);
+}
+
+/**
+ * Prints the totals of all the pass managers finished so far, slowest
+ * pass first.  Only collected with NIR_DEBUG=pass_timing.
+ */
+void
+nir_print_pass_timing(FILE *fp)
+{
+   if (!pass_timing)
+      return;
+
+   simple_mtx_lock(&pass_timing_mtx);
+
+   unsigned count = _mesa_hash_table_num_entries(pass_timing);
+   nir_pass_record **records = malloc(count * sizeof(*records));
+   int64_t total_ns = 0;
+   unsigned i = 0;
+
+   hash_table_foreach(pass_timing, entry) {
+      records[i++] = entry->data;
+      total_ns += ((nir_pass_record *) entry->data)->time_ns;
+   }
+   qsort(records, count, sizeof(*records), compare_time);
+
+   fprintf(fp, "%-32s %8s %8s %8s %10s %6s\n",
+           "pass", "runs", "skipped", "progress", "time (ms)", "%");
+   for (i = 0; i < count; i++) {
+      fprintf(fp, "%-32s %8u %8u %8u %10.2f %6.1f\n",
+              records[i]->name, records[i]->runs, records[i]->skips,
+              records[i]->progress, records[i]->time_ns / 1e6,
+              total_ns ? 100.0 * records[i]->time_ns / total_ns : 0.0);
+   }
+   fprintf(fp, "%-32s %8s %8s %8s %10.2f\n", "total", "", "", "",
+           total_ns / 1e6);
+
+   free(records);
+
+   simple_mtx_unlock(&pass_timing_mtx);
+}
@@ -0,0 +1,439 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include "nir.h"
+#include "nir_range_analysis.h"
+#include "util/hash_table.h"
+
+/**
+ * Analyzes the sign of values, and whether they are integers.
+ *
+ * Signs are tracked as the set of the classes (negative, zero, positive) a
+ * value may fall in, which makes combining them a matter of looking at
+ * every pair of classes.  The results for each instruction are cached, by
+ * instruction and by the type it is read as.
+ */
+
+#define NEG  (1 << 0)
+#define ZERO (1 << 1)
+#define POS  (1 << 2)
+#define ANY  (NEG | ZERO | POS)
+
+struct range {
+   unsigned signs;
+   bool is_integral;
+};
+
+static const unsigned range_signs[] = {
+   [unknown] = ANY,
+   [lt_zero] = NEG,
+   [le_zero] = NEG | ZERO,
+   [gt_zero] = POS,
+   [ge_zero] = POS | ZERO,
+   [ne_zero] = NEG | POS,
+   [eq_zero] = ZERO,
+};
+
+static enum ssa_ranges
+signs_to_range(unsigned signs)
+{
+   for (unsigned i = unknown + 1; i <= last_range; i++) {
+      if (range_signs[i] == signs)
+         return i;
+   }
+
+   return unknown;
+}
+
+static struct range
+unknown_range(void)
+{
+   return (struct range) { ANY, false };
+}
+
+/* Applies \p op to every pair of sign classes of a and b */
+static unsigned
+combine_signs(unsigned a, unsigned b, unsigned (*op)(unsigned, unsigned))
+{
+   unsigned result = 0;
+
+   for (unsigned i = NEG; i <= POS; i <<= 1) {
+      for (unsigned j = NEG; j <= POS; j <<= 1) {
+         if ((a & i) && (b & j))
+            result |= op(i, j);
+      }
+   }
+
+   return result;
+}
+
+static unsigned
+add_signs(unsigned a, unsigned b)
+{
+   if (a == ZERO)
+      return b;
+   if (b == ZERO || a == b)
+      return a;
+   return ANY;
+}
+
+/* The product of two non-zero values may underflow to zero. */
+static unsigned
+mul_signs(unsigned a, unsigned b)
+{
+   if (a == ZERO || b == ZERO)
+      return ZERO;
+   return (a == b ? POS : NEG) | ZERO;
+}
+
+static unsigned
+max_signs(unsigned a, unsigned b)
+{
+   return MAX2(a, b);
+}
+
+static unsigned
+min_signs(unsigned a, unsigned b)
+{
+   return MIN2(a, b);
+}
+
+static unsigned
+neg_signs(unsigned a)
+{
+   return (a & ZERO) | ((a & NEG) ? POS : 0) | ((a & POS) ? NEG : 0);
+}
+
+static unsigned
+abs_signs(unsigned a)
+{
+   return (a & ZERO) | ((a & (NEG | POS)) ? POS : 0);
+}
+
+static struct range
+analyze_constant(const nir_alu_instr *instr, unsigned src,
+                 nir_alu_type use_type)
+{
+   struct range r = { 0, true };
+
+   for (unsigned i = 0; i < nir_ssa_alu_instr_src_components(instr, src); i++) {
+      const unsigned comp = instr->src[src].swizzle[i];
+
+      switch (use_type) {
+      case nir_type_float: {
+         const double d = nir_src_comp_as_float(instr->src[src].src, comp);
+
+         if (isnan(d))
+            return unknown_range();
+
+         r.signs |= d < 0.0 ? NEG : d > 0.0 ? POS : ZERO;
+         r.is_integral &= floor(d) == d;
+         break;
+      }
+      case nir_type_int: {
+         const int64_t v = nir_src_comp_as_int(instr->src[src].src, comp);
+         r.signs |= v < 0 ? NEG : v > 0 ? POS : ZERO;
+         break;
+      }
+      case nir_type_uint: {
+         const uint64_t v = nir_src_comp_as_uint(instr->src[src].src, comp);
+         r.signs |= v > 0 ? POS : ZERO;
+         break;
+      }
+      default:
+         return unknown_range();
+      }
+   }
+
+   return r;
+}
+
+static struct range
+analyze_expression(const nir_alu_instr *instr, unsigned src,
+                   struct hash_table *ht, nir_alu_type use_type);
+
+static struct range
+analyze_float_alu(const nir_alu_instr *alu, struct hash_table *ht)
+{
+   struct range r = unknown_range();
+   struct range a, b, c;
+
+   switch (alu->op) {
+   case nir_op_b2f16:
+   case nir_op_b2f32:
+   case nir_op_b2f64:
+      r = (struct range) { ZERO | POS, true };
+      break;
+
+   case nir_op_u2f16:
+   case nir_op_u2f32:
+   case nir_op_u2f64:
+      r = (struct range) { ZERO | POS, true };
+      break;
+
+   case nir_op_i2f16:
+   case nir_op_i2f32:
+   case nir_op_i2f64:
+      r = analyze_expression(alu, 0, ht, nir_type_int);
+      r.is_integral = true;
+      break;
+
+   case nir_op_fneg:
+      r = analyze_expression(alu, 0, ht, nir_type_float);
+      r.signs = neg_signs(r.signs);
+      break;
+
+   case nir_op_fabs:
+      r = analyze_expression(alu, 0, ht, nir_type_float);
+      r.signs = abs_signs(r.signs);
+      break;
+
+   case nir_op_fsign:
+      r = analyze_expression(alu, 0, ht, nir_type_float);
+      r.is_integral = true;
+      break;
+
+   case nir_op_fsat:
+      a = analyze_expression(alu, 0, ht, nir_type_float);
+      r.signs = (a.signs & POS) | ((a.signs & (NEG | ZERO)) ? ZERO : 0);
+      r.is_integral = a.is_integral;
+      break;
+
+   case nir_op_fadd:
+      a = analyze_expression(alu, 0, ht, nir_type_float);
+      b = analyze_expression(alu, 1, ht, nir_type_float);
+      r.signs = combine_signs(a.signs, b.signs, add_signs);
+      r.is_integral = a.is_integral && b.is_integral;
+      break;
+
+   case nir_op_fmul:
+   case nir_op_ffma:
+      a = analyze_expression(alu, 0, ht, nir_type_float);
+      b = analyze_expression(alu, 1, ht, nir_type_float);
+
+      /* a * a is never negative */
+      if (nir_alu_srcs_equal(alu, alu, 0, 1))
+         r.signs = abs_signs(a.signs) | (a.signs & (NEG | POS) ? ZERO : 0);
+      else
+         r.signs = combine_signs(a.signs, b.signs, mul_signs);
+      r.is_integral = a.is_integral && b.is_integral;
+
+      if (alu->op == nir_op_ffma) {
+         c = analyze_expression(alu, 2, ht, nir_type_float);
+         r.signs = combine_signs(r.signs, c.signs, add_signs);
+         r.is_integral &= c.is_integral;
+      }
+      break;
+
+   case nir_op_fmax:
+   case nir_op_fmin:
+      a = analyze_expression(alu, 0, ht, nir_type_float);
+      b = analyze_expression(alu, 1, ht, nir_type_float);
+      r.signs = combine_signs(a.signs, b.signs,
+                              alu->op == nir_op_fmax ? max_signs : min_signs);
+      r.is_integral = a.is_integral && b.is_integral;
+      break;
+
+   case nir_op_ffloor:
+      a = analyze_expression(alu, 0, ht, nir_type_float);
+      r.signs = a.signs | ((a.signs & POS) ? ZERO : 0);
+      r.is_integral = true;
+      break;
+
+   case nir_op_fceil:
+      a = analyze_expression(alu, 0, ht, nir_type_float);
+      r.signs = a.signs | ((a.signs & NEG) ? ZERO : 0);
+      r.is_integral = true;
+      break;
+
+   case nir_op_ftrunc:
+   case nir_op_fround_even:
+      a = analyze_expression(alu, 0, ht, nir_type_float);
+      r.signs = a.signs | ((a.signs & (NEG | POS)) ? ZERO : 0);
+      r.is_integral = true;
+      break;
+
+   case nir_op_frcp:
+      /* Large values have a denormal reciprocal, which may be flushed. */
+      a = analyze_expression(alu, 0, ht, nir_type_float);
+      r.signs = ((a.signs & (NEG | POS)) ? (a.signs & (NEG | POS)) | ZERO : 0) |
+                ((a.signs & ZERO) ? NEG | POS : 0);
+      break;
+
+   case nir_op_fsqrt:
+      a = analyze_expression(alu, 0, ht, nir_type_float);
+      r.signs = (a.signs & ZERO) | ((a.signs & (NEG | POS)) ? POS : 0);
+      break;
+
+   case nir_op_frsq:
+      a = analyze_expression(alu, 0, ht, nir_type_float);
+      r.signs = (a.signs & ZERO) ? ANY : POS;
+      break;
+
+   case nir_op_fexp2:
+   case nir_op_ffract:
+      r.signs = ZERO | POS;
+      break;
+
+   default:
+      break;
+   }
+
+   return r;
+}
+
+static struct range
+analyze_int_alu(const nir_alu_instr *alu, struct hash_table *ht)
+{
+   struct range r = unknown_range();
+   struct range a, b;
+
+   switch (alu->op) {
+   case nir_op_b2i8:
+   case nir_op_b2i16:
+   case nir_op_b2i32:
+   case nir_op_b2i64:
+      r.signs = ZERO | POS;
+      break;
+
+   case nir_op_imax:
+   case nir_op_imin:
+      a = analyze_expression(alu, 0, ht, nir_type_int);
+      b = analyze_expression(alu, 1, ht, nir_type_int);
+      r.signs = combine_signs(a.signs, b.signs,
+                              alu->op == nir_op_imax ? max_signs : min_signs);
+      break;
+
+   case nir_op_iand:
+      /* The sign bit is clear if it is clear in either source */
+      a = analyze_expression(alu, 0, ht, nir_type_int);
+      b = analyze_expression(alu, 1, ht, nir_type_int);
+      if (!(a.signs & NEG) || !(b.signs & NEG))
+         r.signs = ZERO | POS;
+      break;
+
+   case nir_op_ushr:
+      if (nir_src_is_const(alu->src[1].src)) {
+         const unsigned bit_size = nir_dest_bit_size(alu->dest.dest);
+         bool shifts = true;
+
+         for (unsigned i = 0; i < nir_ssa_alu_instr_src_components(alu, 1); i++) {
+            const unsigned comp = alu->src[1].swizzle[i];
+            shifts &= (nir_src_comp_as_uint(alu->src[1].src, comp) &
+                       (bit_size - 1)) != 0;
+         }
+
+         if (shifts)
+            r.signs = ZERO | POS;
+      }
+      break;
+
+   default:
+      break;
+   }
+
+   r.is_integral = true;
+   return r;
+}
+
+static struct range
+analyze_expression(const nir_alu_instr *instr, unsigned src,
+                   struct hash_table *ht, nir_alu_type use_type)
+{
+   const nir_alu_src *alu_src = &instr->src[src];
+
+   if (!alu_src->src.is_ssa)
+      return unknown_range();
+
+   struct range r;
+
+   if (nir_src_is_const(alu_src->src)) {
+      r = analyze_constant(instr, src, use_type);
+   } else if (alu_src->src.ssa->parent_instr->type != nir_instr_type_alu ||
+              (use_type != nir_type_float && use_type != nir_type_int &&
+               use_type != nir_type_uint)) {
+      r = unknown_range();
+   } else {
+      const nir_alu_instr *alu =
+         nir_instr_as_alu(alu_src->src.ssa->parent_instr);
+
+      /* Instructions are at least 4-byte aligned, which leaves room for the
+       * type in the key.
+       */
+      const unsigned type_bits = use_type == nir_type_float ? 0 :
+                                 use_type == nir_type_int ? 1 : 2;
+      const void *key = (const void *)((uintptr_t) alu | type_bits);
+
+      struct hash_entry *he = _mesa_hash_table_search(ht, key);
+      if (he != NULL) {
+         const uintptr_t packed = (uintptr_t) he->data;
+         r.signs = packed & ANY;
+         r.is_integral = (packed >> 3) & 1;
+      } else {
+         if (alu->op == nir_op_mov) {
+            r = analyze_expression(alu, 0, ht, use_type);
+         } else if (alu->op == nir_op_bcsel) {
+            struct range a = analyze_expression(alu, 1, ht, use_type);
+            struct range b = analyze_expression(alu, 2, ht, use_type);
+            r.signs = a.signs | b.signs;
+            r.is_integral = a.is_integral && b.is_integral;
+         } else if (use_type == nir_type_float) {
+            r = analyze_float_alu(alu, ht);
+         } else if (use_type == nir_type_int) {
+            r = analyze_int_alu(alu, ht);
+         } else {
+            r = (struct range) { ZERO | POS, true };
+         }
+
+         const uintptr_t packed = r.signs | ((uintptr_t) r.is_integral << 3);
+         _mesa_hash_table_insert(ht, key, (void *) packed);
+      }
+   }
+
+   if (use_type == nir_type_float) {
+      if (alu_src->abs)
+         r.signs = abs_signs(r.signs);
+      if (alu_src->negate)
+         r.signs = neg_signs(r.signs);
+   } else if (alu_src->abs || alu_src->negate) {
+      r = unknown_range();
+   }
+
+   return r;
+}
+
+struct ssa_result_range
+nir_analyze_range(struct hash_table *range_ht,
+                  const nir_alu_instr *instr, unsigned src)
+{
+   const nir_alu_type use_type =
+      nir_alu_type_get_base_type(nir_op_infos[instr->op].input_types[src]);
+
+   const struct range r = analyze_expression(instr, src, range_ht, use_type);
+
+   return (struct ssa_result_range) {
+      .range = signs_to_range(r.signs),
+      .is_integral = r.is_integral,
+   };
+}
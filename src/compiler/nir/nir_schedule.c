@@ -0,0 +1,630 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "util/dag.h"
+#include "util/u_dynarray.h"
+#include "util/u_math.h"
+
+/* Pre-register-allocation list scheduler.
+ *
+ * The instructions of each block, other than its phis and final jump, are
+ * put in a dependency DAG and scheduled top-down.  While fewer values than
+ * nir_schedule_options::threshold are live, the ready instruction which
+ * stalls the least is picked, and among those the one with the longest
+ * path to the end of the block, which issues loads and texture fetches as
+ * early as possible.  Above the threshold, the instruction which frees the
+ * most registers (or allocates the fewest) is picked instead.
+ *
+ * The latency model comes from the driver, through
+ * nir_schedule_options::instr_delay_cb, with a rough default otherwise.
+ * Register pressure is counted in 32-bit components of SSA values, using
+ * the liveness information for what is live across the block.
+ */
+
+typedef struct {
+   struct dag_node dag; /* must be first */
+
+   nir_instr *instr;
+
+   /* Cycles after which the result of the instruction is available. */
+   unsigned delay;
+
+   /* Length in cycles of the longest dependency chain from the instruction
+    * to the end of the block.
+    */
+   unsigned max_delay;
+
+   /* Earliest cycle the instruction can issue without stalling. */
+   unsigned ready_time;
+
+   /* Size of the value the instruction defines, 0 if it isn't used. */
+   unsigned def_size;
+} sched_node;
+
+enum sched_mem_class {
+   SCHED_MEM_NONE,
+   /* Reads memory or depends on the set of live invocations: can be
+    * reordered with other reads, but not with side effects.
+    */
+   SCHED_MEM_READ,
+   /* Writes memory or changes the set of live invocations. */
+   SCHED_MEM_SIDE_EFFECT,
+};
+
+typedef struct {
+   const nir_schedule_options *options;
+   gl_shader_stage stage;
+
+   void *mem_ctx;
+
+   nir_block *block;
+   nir_if *following_if;
+
+   struct dag *dag;
+
+   /* In block order, instr->index - num_phis indexes them. */
+   sched_node *nodes;
+   unsigned num_phis;
+
+   /* Indexed by SSA def index: uses by the instructions of the block which
+    * aren't scheduled yet, counting each instruction once.
+    */
+   unsigned *remaining_uses;
+
+   /* Indexed by SSA def index: last instruction stamp the def was seen
+    * from, to only count it once per instruction.
+    */
+   unsigned *seen_stamp;
+   unsigned stamp;
+
+   /* Indexed by live index: sizes of the SSA defs. */
+   unsigned *live_sizes;
+   unsigned num_live_indices;
+
+   /* For the dependencies of the block being built. */
+   sched_node *last_side_effect;
+   sched_node *last_reg_access;
+   struct util_dynarray reads;
+
+   unsigned pressure;
+   unsigned time;
+} sched_state;
+
+/* Edges carry the number of cycles the child has to wait after its parent
+ * issued.
+ */
+#define ORDER_LATENCY 1
+
+static void
+add_edge(sched_node *parent, sched_node *child, unsigned latency)
+{
+   dag_add_edge(&parent->dag, &child->dag, (void *) (uintptr_t) latency);
+}
+
+static unsigned
+edge_latency(const struct dag_edge *edge)
+{
+   return (uintptr_t) edge->data;
+}
+
+static unsigned
+ssa_def_size(const nir_ssa_def *def)
+{
+   return def->num_components * DIV_ROUND_UP(def->bit_size, 32);
+}
+
+static unsigned
+default_instr_delay(nir_instr *instr)
+{
+   switch (instr->type) {
+   case nir_instr_type_tex:
+      return 50;
+
+   case nir_instr_type_intrinsic:
+      switch (nir_instr_as_intrinsic(instr)->intrinsic) {
+      case nir_intrinsic_load_ubo:
+      case nir_intrinsic_load_ssbo:
+      case nir_intrinsic_load_global:
+      case nir_intrinsic_load_shared:
+      case nir_intrinsic_load_scratch:
+      case nir_intrinsic_load_constant:
+      case nir_intrinsic_image_deref_load:
+      case nir_intrinsic_image_load:
+      case nir_intrinsic_bindless_image_load:
+         return 20;
+      case nir_intrinsic_load_deref: {
+         nir_deref_instr *deref =
+            nir_src_as_deref(nir_instr_as_intrinsic(instr)->src[0]);
+         return deref->mode & (nir_var_function_temp | nir_var_shader_temp) ?
+                1 : 20;
+      }
+      default:
+         return 1;
+      }
+
+   default:
+      return 1;
+   }
+}
+
+static enum sched_mem_class
+get_mem_class(sched_state *state, nir_instr *instr)
+{
+   switch (instr->type) {
+   case nir_instr_type_tex:
+      /* Implicit derivatives depend on the neighbouring invocations. */
+      return SCHED_MEM_READ;
+
+   case nir_instr_type_alu:
+      switch (nir_instr_as_alu(instr)->op) {
+      case nir_op_fddx:
+      case nir_op_fddy:
+      case nir_op_fddx_fine:
+      case nir_op_fddy_fine:
+      case nir_op_fddx_coarse:
+      case nir_op_fddy_coarse:
+         return SCHED_MEM_READ;
+      default:
+         return SCHED_MEM_NONE;
+      }
+
+   case nir_instr_type_intrinsic: {
+      nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+      unsigned flags = nir_intrinsic_infos[intrin->intrinsic].flags;
+
+      switch (intrin->intrinsic) {
+      case nir_intrinsic_load_input:
+      case nir_intrinsic_load_per_vertex_input:
+      case nir_intrinsic_load_interpolated_input:
+         if (state->options->stages_with_shared_io_memory &
+             (1 << state->stage))
+            return SCHED_MEM_READ;
+         break;
+      default:
+         break;
+      }
+
+      if (flags & NIR_INTRINSIC_CAN_REORDER)
+         return SCHED_MEM_NONE;
+      if (flags & NIR_INTRINSIC_CAN_ELIMINATE)
+         return SCHED_MEM_READ;
+      return SCHED_MEM_SIDE_EFFECT;
+   }
+
+   case nir_instr_type_call:
+      return SCHED_MEM_SIDE_EFFECT;
+
+   default:
+      return SCHED_MEM_NONE;
+   }
+}
+
+static bool
+is_live_out(sched_state *state, nir_ssa_def *def)
+{
+   if (BITSET_TEST(state->block->live_out, def->live_index))
+      return true;
+
+   return state->following_if && state->following_if->condition.is_ssa &&
+          state->following_if->condition.ssa == def;
+}
+
+static bool
+has_reg_dest(nir_dest *dest, void *data)
+{
+   *(bool *) data |= !dest->is_ssa;
+   return true;
+}
+
+static bool
+get_ssa_def(nir_ssa_def *def, void *data)
+{
+   *(nir_ssa_def **) data = def;
+   return true;
+}
+
+static nir_ssa_def *
+instr_ssa_def(nir_instr *instr)
+{
+   nir_ssa_def *def = NULL;
+   nir_foreach_ssa_def(instr, get_ssa_def, &def);
+   return def;
+}
+
+struct src_state {
+   sched_state *state;
+   sched_node *node;
+   int delta;
+   bool has_reg;
+};
+
+static bool
+add_ssa_dep(nir_src *src, void *data)
+{
+   struct src_state *s = data;
+   sched_state *state = s->state;
+
+   if (!src->is_ssa) {
+      s->has_reg = true;
+      return true;
+   }
+
+   nir_instr *parent = src->ssa->parent_instr;
+   if (parent->block == state->block && parent->type != nir_instr_type_phi) {
+      sched_node *parent_node = &state->nodes[parent->index - state->num_phis];
+      add_edge(parent_node, s->node, parent_node->delay);
+   }
+
+   if (state->seen_stamp[src->ssa->index] != state->stamp) {
+      state->seen_stamp[src->ssa->index] = state->stamp;
+      state->remaining_uses[src->ssa->index]++;
+   }
+
+   return true;
+}
+
+static bool
+update_src_pressure(nir_src *src, void *data)
+{
+   struct src_state *s = data;
+   sched_state *state = s->state;
+
+   if (!src->is_ssa ||
+       state->seen_stamp[src->ssa->index] == state->stamp)
+      return true;
+   state->seen_stamp[src->ssa->index] = state->stamp;
+
+   nir_ssa_def *def = src->ssa;
+   if (state->remaining_uses[def->index] == 1 && !is_live_out(state, def))
+      s->delta -= state->live_sizes[def->live_index];
+
+   return true;
+}
+
+/* How many registers scheduling the node allocates, minus how many it
+ * frees by being the last use of its sources.
+ */
+static int
+pressure_delta(sched_state *state, sched_node *node)
+{
+   struct src_state s = {
+      .state = state,
+      .node = node,
+      .delta = node->def_size,
+   };
+
+   state->stamp++;
+   nir_foreach_src(node->instr, update_src_pressure, &s);
+
+   return s.delta;
+}
+
+static bool
+release_src(nir_src *src, void *data)
+{
+   sched_state *state = data;
+
+   if (!src->is_ssa ||
+       state->seen_stamp[src->ssa->index] == state->stamp)
+      return true;
+   state->seen_stamp[src->ssa->index] = state->stamp;
+
+   state->remaining_uses[src->ssa->index]--;
+
+   return true;
+}
+
+static void
+build_dag(sched_state *state, sched_node *nodes, unsigned num_nodes)
+{
+   state->last_side_effect = NULL;
+   state->last_reg_access = NULL;
+   util_dynarray_clear(&state->reads);
+
+   for (unsigned i = 0; i < num_nodes; i++) {
+      sched_node *node = &nodes[i];
+      nir_instr *instr = node->instr;
+
+      struct src_state s = { .state = state, .node = node };
+      state->stamp++;
+      nir_foreach_src(instr, add_ssa_dep, &s);
+
+      /* Registers aren't tracked individually, the few passes that run
+       * with them just don't get anything reordered around them.
+       */
+      nir_foreach_dest(instr, has_reg_dest, &s.has_reg);
+      if (s.has_reg) {
+         if (state->last_reg_access)
+            add_edge(state->last_reg_access, node, ORDER_LATENCY);
+         state->last_reg_access = node;
+      }
+
+      switch (get_mem_class(state, instr)) {
+      case SCHED_MEM_READ:
+         if (state->last_side_effect)
+            add_edge(state->last_side_effect, node, ORDER_LATENCY);
+         util_dynarray_append(&state->reads, sched_node *, node);
+         break;
+
+      case SCHED_MEM_SIDE_EFFECT:
+         if (state->last_side_effect)
+            add_edge(state->last_side_effect, node, ORDER_LATENCY);
+         util_dynarray_foreach(&state->reads, sched_node *, read)
+            add_edge(*read, node, ORDER_LATENCY);
+         util_dynarray_clear(&state->reads);
+         state->last_side_effect = node;
+         break;
+
+      case SCHED_MEM_NONE:
+         break;
+      }
+   }
+
+   /* Edges always go forward in the block. */
+   for (unsigned i = num_nodes; i-- > 0;) {
+      sched_node *node = &nodes[i];
+
+      node->max_delay = node->delay;
+      util_dynarray_foreach(&node->dag.edges, struct dag_edge, edge) {
+         sched_node *child = (sched_node *) edge->child;
+         node->max_delay = MAX2(node->max_delay,
+                                edge_latency(edge) + child->max_delay);
+      }
+   }
+}
+
+static sched_node *
+choose_node(sched_state *state)
+{
+   bool pressure_mode = state->options->threshold &&
+                        state->pressure >= state->options->threshold;
+   sched_node *best = NULL;
+   unsigned best_stall = 0;
+   int best_delta = 0;
+
+   list_for_each_entry(sched_node, node, &state->dag->heads, dag.link) {
+      unsigned stall = node->ready_time > state->time ?
+                       node->ready_time - state->time : 0;
+      int delta = pressure_mode ? pressure_delta(state, node) : 0;
+
+      if (best) {
+         if (delta != best_delta) {
+            if (delta > best_delta)
+               continue;
+         } else if (stall != best_stall) {
+            if (stall > best_stall)
+               continue;
+         } else if (node->max_delay <= best->max_delay) {
+            /* Heads are in program order, keep it on ties. */
+            if (node->max_delay < best->max_delay ||
+                node->instr->index > best->instr->index)
+               continue;
+         }
+      }
+
+      best = node;
+      best_stall = stall;
+      best_delta = delta;
+   }
+
+   return best;
+}
+
+static void
+schedule_node(sched_state *state, sched_node *node)
+{
+   unsigned issue_time = MAX2(state->time, node->ready_time);
+   state->time = issue_time + 1;
+
+   util_dynarray_foreach(&node->dag.edges, struct dag_edge, edge) {
+      sched_node *child = (sched_node *) edge->child;
+      child->ready_time = MAX2(child->ready_time,
+                               issue_time + edge_latency(edge));
+   }
+
+   state->pressure += pressure_delta(state, node);
+
+   state->stamp++;
+   nir_foreach_src(node->instr, release_src, state);
+
+   dag_prune_head(state->dag, &node->dag);
+}
+
+static bool
+schedule_block(sched_state *state, nir_block *block)
+{
+   nir_instr *jump = NULL;
+   unsigned num_nodes = 0;
+
+   nir_foreach_instr(instr, block) {
+      switch (instr->type) {
+      case nir_instr_type_phi:
+         break;
+      case nir_instr_type_jump:
+         jump = instr;
+         break;
+      case nir_instr_type_parallel_copy:
+         return false;
+      default:
+         num_nodes++;
+         break;
+      }
+   }
+
+   if (num_nodes < 2)
+      return false;
+
+   void *mem_ctx = ralloc_context(state->mem_ctx);
+   sched_node *nodes = rzalloc_array(mem_ctx, sched_node, num_nodes);
+
+   state->block = block;
+   state->following_if = nir_block_get_following_if(block);
+   state->dag = dag_create(mem_ctx);
+   state->nodes = nodes;
+   state->num_phis = 0;
+   state->pressure = 0;
+   state->time = 0;
+
+   unsigned i = 0, index = 0;
+   nir_foreach_instr(instr, block) {
+      /* Maps to the node, and keeps track of the original order for ties. */
+      instr->index = index++;
+
+      if (instr->type == nir_instr_type_phi) {
+         state->num_phis++;
+         continue;
+      }
+
+      if (instr == jump)
+         continue;
+
+      sched_node *node = &nodes[i++];
+      node->instr = instr;
+      node->delay = state->options->instr_delay_cb ?
+         state->options->instr_delay_cb(instr,
+                                        state->options->instr_delay_cb_data) :
+         default_instr_delay(instr);
+
+      nir_ssa_def *def = instr_ssa_def(instr);
+      if (def && instr->type != nir_instr_type_ssa_undef &&
+          (!list_empty(&def->uses) || !list_empty(&def->if_uses)))
+         node->def_size = ssa_def_size(def);
+
+      dag_init_node(state->dag, &node->dag);
+   }
+
+   build_dag(state, nodes, num_nodes);
+
+   /* Everything live into the block occupies registers from the start,
+    * including the phi destinations, which liveness puts in the live-in set.
+    */
+   for (unsigned idx = 1; idx < state->num_live_indices; idx++) {
+      if (BITSET_TEST(block->live_in, idx))
+         state->pressure += state->live_sizes[idx];
+   }
+
+   nir_instr **order = ralloc_array(mem_ctx, nir_instr *, num_nodes);
+   bool progress = false;
+
+   for (i = 0; i < num_nodes; i++) {
+      sched_node *node = choose_node(state);
+      schedule_node(state, node);
+
+      order[i] = node->instr;
+      progress |= node != &nodes[i];
+   }
+
+   if (progress) {
+      for (i = 0; i < num_nodes; i++) {
+         exec_node_remove(&order[i]->node);
+         if (jump)
+            exec_node_insert_node_before(&jump->node, &order[i]->node);
+         else
+            exec_list_push_tail(&block->instr_list, &order[i]->node);
+      }
+   }
+
+   ralloc_free(mem_ctx);
+
+   return progress;
+}
+
+static bool
+record_live_size(nir_ssa_def *def, void *data)
+{
+   sched_state *state = data;
+
+   state->live_sizes[def->live_index] = def->live_index ?
+                                        ssa_def_size(def) : 0;
+   state->num_live_indices = MAX2(state->num_live_indices,
+                                  def->live_index + 1);
+
+   return true;
+}
+
+static bool
+schedule_impl(sched_state *state, nir_function_impl *impl)
+{
+   bool progress = false;
+
+   nir_index_ssa_defs(impl);
+   nir_metadata_require(impl, nir_metadata_block_index |
+                              nir_metadata_live_ssa_defs);
+
+   void *mem_ctx = ralloc_context(state->mem_ctx);
+
+   /* Live indices are a subset of the SSA indices, plus 0 for undefs. */
+   state->live_sizes = rzalloc_array(mem_ctx, unsigned, impl->ssa_alloc + 1);
+   state->num_live_indices = 1;
+   state->remaining_uses = rzalloc_array(mem_ctx, unsigned, impl->ssa_alloc);
+   state->seen_stamp = rzalloc_array(mem_ctx, unsigned, impl->ssa_alloc);
+   state->stamp = 0;
+   util_dynarray_init(&state->reads, mem_ctx);
+
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr(instr, block)
+         nir_foreach_ssa_def(instr, record_live_size, state);
+   }
+
+   nir_foreach_block(block, impl)
+      progress |= schedule_block(state, block);
+
+   ralloc_free(mem_ctx);
+
+   /* Instructions only move within their block. */
+   if (progress) {
+      nir_metadata_preserve(impl, nir_metadata_block_index |
+                                  nir_metadata_dominance |
+                                  nir_metadata_live_ssa_defs);
+   }
+
+   return progress;
+}
+
+/**
+ * Reorders the instructions within each block of the shader, to hide the
+ * latency of memory accesses and texture fetches while keeping the number
+ * of live values under options->threshold.  Meant to run late, right
+ * before the backend translates out of NIR.
+ */
+bool
+nir_schedule(nir_shader *shader, const nir_schedule_options *options)
+{
+   bool progress = false;
+
+   sched_state state = {
+      .options = options,
+      .stage = shader->info.stage,
+      .mem_ctx = ralloc_context(NULL),
+   };
+
+   nir_foreach_function(function, shader) {
+      if (function->impl)
+         progress |= schedule_impl(&state, function->impl);
+   }
+
+   ralloc_free(state.mem_ctx);
+
+   return progress;
+}
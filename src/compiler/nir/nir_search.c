@@ -28,11 +28,35 @@
 #include <inttypes.h>
 #include "nir_search.h"
 #include "nir_builder.h"
+#include "nir_worklist.h"
+#include "c11/threads.h"
 #include "util/half_float.h"
+#include "util/hash_table.h"
 
 #define NIR_SEARCH_MAX_COMM_OPS 4
 
+/* These must match the start states created in TreeAutomaton._build_table().
+ * WILDCARD_STATE is also what zeroing the state array sets.
+ */
+#define WILDCARD_STATE 0
+#define CONST_STATE 1
+
+static nir_algebraic_matcher algebraic_matcher;
+static once_flag algebraic_matcher_once = ONCE_FLAG_INIT;
+
+static void
+algebraic_matcher_init(void)
+{
+   const char *matcher = getenv("NIR_ALGEBRAIC_MATCHER");
+
+   algebraic_matcher = matcher && strcmp(matcher, "tree_walk") == 0 ?
+      nir_algebraic_matcher_tree_walk : nir_algebraic_matcher_automaton;
+}
+
 struct match_state {
+   /* Cache for the value range conditions, see nir_range_analysis.h */
+   struct hash_table *range_ht;
+
    bool inexact_match;
    bool has_exact_alu;
    uint8_t comm_op_direction;
@@ -40,6 +64,26 @@ struct match_state {
    nir_alu_src variables[NIR_SEARCH_MAX_VARIABLES];
 };
 
+struct algebraic_state {
+   nir_builder build;
+   const bool *condition_flags;
+   const nir_algebraic_table *table;
+   bool use_automaton;
+
+   /* Automaton state of every SSA def, by index */
+   uint16_t *states;
+   unsigned num_states;
+
+   /* ALU instructions left to match */
+   nir_instr_worklist *worklist;
+
+   /* Instructions whose state changed, and whose users need updating */
+   nir_instr_worklist *automaton_worklist;
+
+   /* Ranges found by nir_analyze_range(), for the whole impl */
+   struct hash_table *range_ht;
+};
+
 static bool
 match_expression(const nir_search_expression *expr, nir_alu_instr *instr,
                  unsigned num_components, const uint8_t *swizzle,
@@ -296,7 +340,8 @@ match_value(const nir_search_value *value, nir_alu_instr *instr, unsigned src,
              instr->src[src].src.ssa->parent_instr->type != nir_instr_type_load_const)
             return false;
 
-         if (var->cond && !var->cond(instr, src, num_components, new_swizzle))
+         if (var->cond && !var->cond(state->range_ht, instr,
+                                     src, num_components, new_swizzle))
             return false;
 
          if (var->type != nir_type_invalid &&
@@ -612,11 +657,112 @@ MAYBE_UNUSED static void dump_value(const nir_search_value *val)
       printf("@%d", val->bit_size);
 }
 
-nir_ssa_def *
-nir_replace_instr(nir_builder *build, nir_alu_instr *instr,
-                  const nir_search_expression *search,
-                  const nir_search_value *replace)
+/**
+ * Compute the automaton state of \instr from the states of its sources.
+ *
+ * \return Whether the state changed.
+ */
+static inline bool
+update_automaton_state(struct algebraic_state *alg, nir_instr *instr)
 {
+   switch (instr->type) {
+   case nir_instr_type_alu: {
+      nir_alu_instr *alu = nir_instr_as_alu(instr);
+      nir_op op = alu->op;
+      const struct per_op_table *tbl =
+         &alg->table->op_tables[nir_search_op_for_nir_op(op)];
+
+      if (tbl->num_filtered_states == 0 || !alu->dest.dest.is_ssa)
+         return false;
+
+      /* Calculate the index into the transition table. Note the index
+       * calculated must match the iteration order of Python's
+       * itertools.product(), which was used to emit the transition
+       * table.
+       */
+      uint16_t index = 0;
+      for (unsigned i = 0; i < nir_op_infos[op].num_inputs; i++) {
+         index *= tbl->num_filtered_states;
+         index += tbl->filter[alg->states[alu->src[i].src.ssa->index]];
+      }
+
+      uint16_t *state = &alg->states[alu->dest.dest.ssa.index];
+      if (*state == tbl->table[index])
+         return false;
+
+      *state = tbl->table[index];
+      return true;
+   }
+
+   case nir_instr_type_load_const: {
+      nir_load_const_instr *load_const = nir_instr_as_load_const(instr);
+      uint16_t *state = &alg->states[load_const->def.index];
+      if (*state == CONST_STATE)
+         return false;
+
+      *state = CONST_STATE;
+      return true;
+   }
+
+   default:
+      return false;
+   }
+}
+
+static void
+grow_automaton_states(struct algebraic_state *alg)
+{
+   unsigned ssa_alloc = alg->build.impl->ssa_alloc;
+
+   if (ssa_alloc <= alg->num_states)
+      return;
+
+   unsigned num_states = MAX2(ssa_alloc, alg->num_states * 2);
+   alg->states = realloc(alg->states, num_states * sizeof(*alg->states));
+   memset(alg->states + alg->num_states, 0,
+          (num_states - alg->num_states) * sizeof(*alg->states));
+   alg->num_states = num_states;
+}
+
+/**
+ * Queue the users of \def for matching again, and bring the automaton
+ * states of everything that depends on it up to date.
+ */
+static void
+requeue_users(struct algebraic_state *alg, nir_ssa_def *def)
+{
+   nir_foreach_use(src, def) {
+      nir_instr *user = src->parent_instr;
+
+      if (user->type != nir_instr_type_alu)
+         continue;
+
+      /* The user may match even in the same state, if a constant changed. */
+      nir_instr_worklist_push_tail(alg->worklist, user);
+
+      if (alg->use_automaton && update_automaton_state(alg, user))
+         nir_instr_worklist_push_tail(alg->automaton_worklist, user);
+   }
+
+   nir_foreach_instr_in_worklist(instr, alg->automaton_worklist) {
+      nir_alu_instr *alu = nir_instr_as_alu(instr);
+
+      nir_foreach_use(src, &alu->dest.dest.ssa) {
+         if (update_automaton_state(alg, src->parent_instr)) {
+            nir_instr_worklist_push_tail(alg->worklist, src->parent_instr);
+            nir_instr_worklist_push_tail(alg->automaton_worklist,
+                                         src->parent_instr);
+         }
+      }
+   }
+}
+
+static bool
+replace_instr(struct algebraic_state *alg, nir_alu_instr *instr,
+              const nir_search_expression *search,
+              const nir_search_value *replace)
+{
+   nir_builder *build = &alg->build;
    uint8_t swizzle[NIR_MAX_VEC_COMPONENTS] = { 0 };
 
    for (unsigned i = 0; i < instr->dest.dest.ssa.num_components; ++i)
@@ -625,6 +771,7 @@ nir_replace_instr(nir_builder *build, nir_alu_instr *instr,
    assert(instr->dest.dest.is_ssa);
 
    struct match_state state;
+   state.range_ht = alg->range_ht;
    state.inexact_match = false;
    state.has_exact_alu = false;
 
@@ -647,7 +794,7 @@ nir_replace_instr(nir_builder *build, nir_alu_instr *instr,
       }
    }
    if (!found)
-      return NULL;
+      return false;
 
 #if 0
    printf("matched: ");
@@ -657,19 +804,46 @@ nir_replace_instr(nir_builder *build, nir_alu_instr *instr,
    printf(" ssa_%d\n", instr->dest.dest.ssa.index);
 #endif
 
+   if (!alg->worklist) {
+      alg->worklist = nir_instr_worklist_create();
+      alg->automaton_worklist = nir_instr_worklist_create();
+   }
+
+   nir_instr *prev = nir_instr_prev(&instr->instr);
    build->cursor = nir_before_instr(&instr->instr);
 
-   nir_alu_src val = construct_value(build, replace,
-                                     instr->dest.dest.ssa.num_components,
+   unsigned num_components = instr->dest.dest.ssa.num_components;
+   nir_alu_src val = construct_value(build, replace, num_components,
                                      instr->dest.dest.ssa.bit_size,
                                      &state, &instr->instr);
 
-   /* Inserting a mov may be unnecessary.  However, it's much easier to
-    * simply let copy propagation clean this up than to try to go through
-    * and rewrite swizzles ourselves.
+   /* If the replacement is an SSA value as is, use it directly rather than
+    * through a mov, so that its new users can be matched against it right
+    * away.  Otherwise, let copy propagation clean the mov up; that's much
+    * easier than going through and rewriting swizzles ourselves.
+    */
+   bool is_identity = val.src.ssa->num_components == num_components;
+   for (unsigned i = 0; i < num_components; i++)
+      is_identity &= val.swizzle[i] == i;
+
+   nir_ssa_def *ssa_val = is_identity ? val.src.ssa :
+      nir_mov_alu(build, val, num_components);
+
+   /* Classify the new instructions, which are all right before this one,
+    * sources first, and queue them for matching.
     */
-   nir_ssa_def *ssa_val =
-      nir_mov_alu(build, val, instr->dest.dest.ssa.num_components);
+   if (alg->use_automaton)
+      grow_automaton_states(alg);
+
+   for (nir_instr *new_instr = prev ? nir_instr_next(prev) :
+                               nir_block_first_instr(instr->instr.block);
+        new_instr != &instr->instr; new_instr = nir_instr_next(new_instr)) {
+      if (alg->use_automaton)
+         update_automaton_state(alg, new_instr);
+      if (new_instr->type == nir_instr_type_alu)
+         nir_instr_worklist_push_tail(alg->worklist, new_instr);
+   }
+
    nir_ssa_def_rewrite_uses(&instr->dest.dest.ssa, nir_src_for_ssa(ssa_val));
 
    /* We know this one has no more uses because we just rewrote them all,
@@ -678,5 +852,105 @@ nir_replace_instr(nir_builder *build, nir_alu_instr *instr,
     */
    nir_instr_remove(&instr->instr);
 
-   return ssa_val;
+   requeue_users(alg, ssa_val);
+
+   return true;
+}
+
+static inline bool
+algebraic_instr(struct algebraic_state *alg, nir_alu_instr *alu)
+{
+   const nir_algebraic_table *table = alg->table;
+   const uint16_t *xforms;
+   unsigned num_xforms;
+
+   if (!alu->dest.dest.is_ssa)
+      return false;
+
+   if (alg->use_automaton) {
+      uint16_t state = alg->states[alu->dest.dest.ssa.index];
+      xforms = table->state_xforms[state];
+      num_xforms = table->state_xform_counts[state];
+   } else {
+      uint16_t search_op = nir_search_op_for_nir_op(alu->op);
+      xforms = table->op_xforms[search_op];
+      num_xforms = table->op_xform_counts[search_op];
+   }
+
+   for (unsigned i = 0; i < num_xforms; i++) {
+      const struct transform *xform = &table->transforms[xforms[i]];
+      if (alg->condition_flags[xform->condition_offset] &&
+          replace_instr(alg, alu, xform->search, xform->replace))
+         return true;
+   }
+
+   return false;
+}
+
+bool
+nir_algebraic_impl(nir_function_impl *impl, const bool *condition_flags,
+                   const nir_algebraic_table *table)
+{
+   struct algebraic_state alg;
+   bool progress = false;
+
+   nir_builder_init(&alg.build, impl);
+   alg.condition_flags = condition_flags;
+   alg.table = table;
+   call_once(&algebraic_matcher_once, algebraic_matcher_init);
+   alg.use_automaton = algebraic_matcher == nir_algebraic_matcher_automaton;
+   alg.states = NULL;
+   alg.num_states = 0;
+   alg.worklist = NULL;
+   alg.automaton_worklist = NULL;
+   alg.range_ht = _mesa_pointer_hash_table_create(NULL);
+
+   /* Sources are visited before their users, except for phis which are
+    * left in the wildcard state.
+    */
+   if (alg.use_automaton) {
+      grow_automaton_states(&alg);
+
+      nir_foreach_block(block, impl) {
+         nir_foreach_instr(instr, block)
+            update_automaton_state(&alg, instr);
+      }
+   }
+
+   /* Match the last instructions first, so that the largest expressions
+    * are replaced before their subexpressions.  The instructions a
+    * replacement adds or affects are queued, and matched at the end.
+    */
+   nir_foreach_block_reverse(block, impl) {
+      nir_foreach_instr_reverse_safe(instr, block) {
+         if (instr->type == nir_instr_type_alu)
+            progress |= algebraic_instr(&alg, nir_instr_as_alu(instr));
+      }
+   }
+
+   if (alg.worklist) {
+      nir_foreach_instr_in_worklist(instr, alg.worklist) {
+         /* Replaced instructions may still be on the worklist. */
+         if (instr->node.next == NULL)
+            continue;
+
+         progress |= algebraic_instr(&alg, nir_instr_as_alu(instr));
+      }
+
+      nir_instr_worklist_destroy(alg.worklist);
+      nir_instr_worklist_destroy(alg.automaton_worklist);
+   }
+   free(alg.states);
+   _mesa_hash_table_destroy(alg.range_ht, NULL);
+
+   if (progress) {
+      nir_metadata_preserve(impl, nir_metadata_block_index |
+                                  nir_metadata_dominance);
+   } else {
+#ifndef NDEBUG
+      impl->valid_metadata &= ~nir_metadata_not_properly_reset;
+#endif
+   }
+
+   return progress;
 }
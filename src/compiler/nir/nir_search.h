@@ -93,8 +93,9 @@ typedef struct {
     * variables to require, for example, power-of-two in order for the search
     * to match.
     */
-   bool (*cond)(nir_alu_instr *instr, unsigned src,
-                unsigned num_components, const uint8_t *swizzle);
+   bool (*cond)(struct hash_table *range_ht, nir_alu_instr *instr,
+                unsigned src, unsigned num_components,
+                const uint8_t *swizzle);
 } nir_search_variable;
 
 typedef struct {
@@ -170,9 +171,61 @@ NIR_DEFINE_CAST(nir_search_value_as_expression, nir_search_value,
                 nir_search_expression, value,
                 type, nir_search_value_expression)
 
-nir_ssa_def *
-nir_replace_instr(struct nir_builder *b, nir_alu_instr *instr,
-                  const nir_search_expression *search,
-                  const nir_search_value *replace);
+struct transform {
+   const nir_search_expression *search;
+   const nir_search_value *replace;
+   unsigned condition_offset;
+};
+
+/* Transition table of the automaton for one nir_search_op.  The state of an
+ * instruction is table[i0 * n^(k-1) + i1 * n^(k-2) + ... + ik-1], where ij is
+ * filter[state of source j] and n is num_filtered_states.
+ */
+struct per_op_table {
+   const uint16_t *filter;
+   unsigned num_filtered_states;
+   const uint16_t *table;
+};
+
+/* Everything nir_algebraic.py generates for one pass, see nir_algebraic.py
+ * for how the automaton is built.
+ */
+typedef struct {
+   const struct transform *transforms;
+
+   /* Indexed by nir_search_op */
+   const struct per_op_table *op_tables;
+
+   /* Indices in transforms of the transforms to try on an instruction in
+    * each state of the automaton.
+    */
+   const uint16_t *const *state_xforms;
+   const uint16_t *state_xform_counts;
+
+   /* Indices in transforms of the transforms of each nir_search_op, for the
+    * tree walking matcher.
+    */
+   const uint16_t *const *op_xforms;
+   const uint16_t *op_xform_counts;
+} nir_algebraic_table;
+
+typedef enum {
+   /* Classify instructions with the automaton, and only try the transforms
+    * that can match their state.
+    */
+   nir_algebraic_matcher_automaton,
+
+   /* Try every transform of the instruction's opcode. */
+   nir_algebraic_matcher_tree_walk,
+} nir_algebraic_matcher;
+
+/* The automaton is always used, unless NIR_ALGEBRAIC_MATCHER=tree_walk is
+ * set, which is only meant for benchmarking and for debugging the automaton.
+ * The variable is read once per process.
+ */
+
+bool
+nir_algebraic_impl(nir_function_impl *impl, const bool *condition_flags,
+                   const nir_algebraic_table *table);
 
 #endif /* _NIR_SEARCH_ */
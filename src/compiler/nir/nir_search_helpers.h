@@ -28,11 +28,13 @@
 #define _NIR_SEARCH_HELPERS_
 
 #include "nir.h"
+#include "nir_range_analysis.h"
 #include "util/bitscan.h"
 #include <math.h>
 
 static inline bool
-is_pos_power_of_two(nir_alu_instr *instr, unsigned src, unsigned num_components,
+is_pos_power_of_two(UNUSED struct hash_table *ht, nir_alu_instr *instr,
+                    unsigned src, unsigned num_components,
                     const uint8_t *swizzle)
 {
    /* only constant srcs: */
@@ -62,7 +64,8 @@ is_pos_power_of_two(nir_alu_instr *instr, unsigned src, unsigned num_components,
 }
 
 static inline bool
-is_neg_power_of_two(nir_alu_instr *instr, unsigned src, unsigned num_components,
+is_neg_power_of_two(UNUSED struct hash_table *ht, nir_alu_instr *instr,
+                    unsigned src, unsigned num_components,
                     const uint8_t *swizzle)
 {
    /* only constant srcs: */
@@ -86,8 +89,8 @@ is_neg_power_of_two(nir_alu_instr *instr, unsigned src, unsigned num_components,
 }
 
 static inline bool
-is_zero_to_one(nir_alu_instr *instr, unsigned src, unsigned num_components,
-               const uint8_t *swizzle)
+is_zero_to_one(UNUSED struct hash_table *ht, nir_alu_instr *instr,
+               unsigned src, unsigned num_components, const uint8_t *swizzle)
 {
    /* only constant srcs: */
    if (!nir_src_is_const(instr->src[src].src))
@@ -116,8 +119,8 @@ is_zero_to_one(nir_alu_instr *instr, unsigned src, unsigned num_components,
  * 1 while this function tests 0 < src < 1.
  */
 static inline bool
-is_gt_0_and_lt_1(nir_alu_instr *instr, unsigned src, unsigned num_components,
-                 const uint8_t *swizzle)
+is_gt_0_and_lt_1(UNUSED struct hash_table *ht, nir_alu_instr *instr,
+                 unsigned src, unsigned num_components, const uint8_t *swizzle)
 {
    /* only constant srcs: */
    if (!nir_src_is_const(instr->src[src].src))
@@ -140,8 +143,8 @@ is_gt_0_and_lt_1(nir_alu_instr *instr, unsigned src, unsigned num_components,
 }
 
 static inline bool
-is_not_const_zero(nir_alu_instr *instr, unsigned src, unsigned num_components,
-                  const uint8_t *swizzle)
+is_not_const_zero(UNUSED struct hash_table *ht, nir_alu_instr *instr,
+                  unsigned src, unsigned num_components, const uint8_t *swizzle)
 {
    if (nir_src_as_const_value(instr->src[src].src) == NULL)
       return true;
@@ -167,15 +170,17 @@ is_not_const_zero(nir_alu_instr *instr, unsigned src, unsigned num_components,
 }
 
 static inline bool
-is_not_const(nir_alu_instr *instr, unsigned src, UNUSED unsigned num_components,
+is_not_const(UNUSED struct hash_table *ht, nir_alu_instr *instr,
+             unsigned src, UNUSED unsigned num_components,
              UNUSED const uint8_t *swizzle)
 {
    return !nir_src_is_const(instr->src[src].src);
 }
 
 static inline bool
-is_not_fmul(nir_alu_instr *instr, unsigned src,
-            UNUSED unsigned num_components, UNUSED const uint8_t *swizzle)
+is_not_fmul(struct hash_table *ht, nir_alu_instr *instr,
+            unsigned src, UNUSED unsigned num_components,
+            UNUSED const uint8_t *swizzle)
 {
    nir_alu_instr *src_alu =
       nir_src_as_alu_instr(instr->src[src].src);
@@ -184,11 +189,67 @@ is_not_fmul(nir_alu_instr *instr, unsigned src,
       return true;
 
    if (src_alu->op == nir_op_fneg)
-      return is_not_fmul(src_alu, 0, 0, NULL);
+      return is_not_fmul(ht, src_alu, 0, 0, NULL);
 
    return src_alu->op != nir_op_fmul;
 }
 
+/* Conditions on the sign of a value, as found by nir_analyze_range() */
+
+static inline bool
+is_lt_zero(struct hash_table *ht, nir_alu_instr *instr, unsigned src,
+           UNUSED unsigned num_components, UNUSED const uint8_t *swizzle)
+{
+   const struct ssa_result_range r = nir_analyze_range(ht, instr, src);
+
+   return r.range == lt_zero;
+}
+
+static inline bool
+is_gt_zero(struct hash_table *ht, nir_alu_instr *instr, unsigned src,
+           UNUSED unsigned num_components, UNUSED const uint8_t *swizzle)
+{
+   const struct ssa_result_range r = nir_analyze_range(ht, instr, src);
+
+   return r.range == gt_zero;
+}
+
+static inline bool
+is_not_zero(struct hash_table *ht, nir_alu_instr *instr, unsigned src,
+            UNUSED unsigned num_components, UNUSED const uint8_t *swizzle)
+{
+   const struct ssa_result_range r = nir_analyze_range(ht, instr, src);
+
+   return r.range == lt_zero || r.range == gt_zero || r.range == ne_zero;
+}
+
+static inline bool
+is_not_negative(struct hash_table *ht, nir_alu_instr *instr, unsigned src,
+                UNUSED unsigned num_components, UNUSED const uint8_t *swizzle)
+{
+   const struct ssa_result_range r = nir_analyze_range(ht, instr, src);
+
+   return r.range == ge_zero || r.range == gt_zero || r.range == eq_zero;
+}
+
+static inline bool
+is_not_positive(struct hash_table *ht, nir_alu_instr *instr, unsigned src,
+                UNUSED unsigned num_components, UNUSED const uint8_t *swizzle)
+{
+   const struct ssa_result_range r = nir_analyze_range(ht, instr, src);
+
+   return r.range == le_zero || r.range == lt_zero || r.range == eq_zero;
+}
+
+static inline bool
+is_integral(struct hash_table *ht, nir_alu_instr *instr, unsigned src,
+            UNUSED unsigned num_components, UNUSED const uint8_t *swizzle)
+{
+   const struct ssa_result_range r = nir_analyze_range(ht, instr, src);
+
+   return r.is_integral;
+}
+
 static inline bool
 is_used_once(nir_alu_instr *instr)
 {
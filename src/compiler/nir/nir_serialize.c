@@ -25,6 +25,12 @@
 #include "nir_control_flow.h"
 #include "util/u_dynarray.h"
 
+/* The serialized shader starts with these two words.  The version has to be
+ * bumped whenever the encoding changes.
+ */
+#define NIR_SERIALIZE_MAGIC 0x5352494e /* "NIRS" */
+#define NIR_SERIALIZE_VERSION 2
+
 typedef struct {
    size_t blob_offset;
    nir_ssa_def *src;
@@ -40,7 +46,11 @@ typedef struct {
    struct hash_table *remap_table;
 
    /* the next index to assign to a NIR in-memory object */
-   uintptr_t next_idx;
+   uint32_t next_idx;
+
+   /* maps types and strings to their index in the type and string tables */
+   struct hash_table *type_table;
+   struct hash_table *string_table;
 
    /* Array of write_phi_fixup structs representing phi sources that need to
     * be resolved in the second pass.
@@ -54,14 +64,20 @@ typedef struct {
    struct blob_reader *blob;
 
    /* the next index to assign to a NIR in-memory object */
-   uintptr_t next_idx;
+   uint32_t next_idx;
 
    /* The length of the index -> object table */
-   uintptr_t idx_table_len;
+   uint32_t idx_table_len;
 
    /* map from index to deserialized pointer */
    void **idx_table;
 
+   /* Types and strings in the order they were first written.  The strings
+    * point into the blob.
+    */
+   struct util_dynarray types;
+   struct util_dynarray strings;
+
    /* List of phi sources. */
    struct list_head phi_srcs;
 
@@ -70,11 +86,11 @@ typedef struct {
 static void
 write_add_object(write_ctx *ctx, const void *obj)
 {
-   uintptr_t index = ctx->next_idx++;
-   _mesa_hash_table_insert(ctx->remap_table, obj, (void *) index);
+   uint32_t index = ctx->next_idx++;
+   _mesa_hash_table_insert(ctx->remap_table, obj, (void *)(uintptr_t) index);
 }
 
-static uintptr_t
+static uint32_t
 write_lookup_object(write_ctx *ctx, const void *obj)
 {
    struct hash_entry *entry = _mesa_hash_table_search(ctx->remap_table, obj);
@@ -85,7 +101,7 @@ write_lookup_object(write_ctx *ctx, const void *obj)
 static void
 write_object(write_ctx *ctx, const void *obj)
 {
-   blob_write_intptr(ctx->blob, write_lookup_object(ctx, obj));
+   blob_write_uint32(ctx->blob, write_lookup_object(ctx, obj));
 }
 
 static void
@@ -96,7 +112,7 @@ read_add_object(read_ctx *ctx, void *obj)
 }
 
 static void *
-read_lookup_object(read_ctx *ctx, uintptr_t idx)
+read_lookup_object(read_ctx *ctx, uint32_t idx)
 {
    assert(idx < ctx->idx_table_len);
    return ctx->idx_table[idx];
@@ -105,7 +121,88 @@ read_lookup_object(read_ctx *ctx, uintptr_t idx)
 static void *
 read_object(read_ctx *ctx)
 {
-   return read_lookup_object(ctx, blob_read_intptr(ctx->blob));
+   return read_lookup_object(ctx, blob_read_uint32(ctx->blob));
+}
+
+/* Types are only encoded the first time they are written.  After that, we
+ * write their index in the table plus one, 0 meaning that the encoding
+ * follows.
+ */
+static void
+write_type(write_ctx *ctx, const struct glsl_type *type)
+{
+   assert(type);
+   struct hash_entry *entry = _mesa_hash_table_search(ctx->type_table, type);
+   if (entry) {
+      blob_write_uint32(ctx->blob, (uintptr_t) entry->data);
+      return;
+   }
+
+   blob_write_uint32(ctx->blob, 0);
+   encode_type_to_blob(ctx->blob, type);
+
+   uintptr_t index = ctx->type_table->entries + 1;
+   _mesa_hash_table_insert(ctx->type_table, type, (void *) index);
+}
+
+static const struct glsl_type *
+read_type(read_ctx *ctx)
+{
+   uint32_t index = blob_read_uint32(ctx->blob);
+   if (index > 0) {
+      assert(index <= util_dynarray_num_elements(&ctx->types,
+                                                 const struct glsl_type *));
+      return *util_dynarray_element(&ctx->types, const struct glsl_type *,
+                                    index - 1);
+   }
+
+   const struct glsl_type *type = decode_type_from_blob(ctx->blob);
+   util_dynarray_append(&ctx->types, const struct glsl_type *, type);
+   return type;
+}
+
+/* Same thing for strings, which can be NULL: we write 0 for NULL, 1 followed
+ * by the string the first time it is written, and its index in the table
+ * plus two after that.
+ */
+static void
+write_string(write_ctx *ctx, const char *str)
+{
+   if (str == NULL) {
+      blob_write_uint32(ctx->blob, 0);
+      return;
+   }
+
+   struct hash_entry *entry = _mesa_hash_table_search(ctx->string_table, str);
+   if (entry) {
+      blob_write_uint32(ctx->blob, (uintptr_t) entry->data);
+      return;
+   }
+
+   blob_write_uint32(ctx->blob, 1);
+   blob_write_string(ctx->blob, str);
+
+   uintptr_t index = ctx->string_table->entries + 2;
+   _mesa_hash_table_insert(ctx->string_table, str, (void *) index);
+}
+
+/* The string points into the blob, callers copy it if they keep it. */
+static const char *
+read_string(read_ctx *ctx)
+{
+   uint32_t index = blob_read_uint32(ctx->blob);
+   if (index == 0)
+      return NULL;
+
+   if (index > 1) {
+      assert(index - 2 < util_dynarray_num_elements(&ctx->strings,
+                                                    const char *));
+      return *util_dynarray_element(&ctx->strings, const char *, index - 2);
+   }
+
+   const char *str = blob_read_string(ctx->blob);
+   util_dynarray_append(&ctx->strings, const char *, str);
+   return str;
 }
 
 static void
@@ -131,28 +228,45 @@ read_constant(read_ctx *ctx, nir_variable *nvar)
    return c;
 }
 
+union packed_var {
+   uint32_t u32;
+   struct {
+      unsigned has_constant_initializer:1;
+      unsigned has_interface_type:1;
+      unsigned num_state_slots:14;
+      unsigned num_members:16;
+   } u;
+};
+
 static void
 write_variable(write_ctx *ctx, const nir_variable *var)
 {
    write_add_object(ctx, var);
-   encode_type_to_blob(ctx->blob, var->type);
-   blob_write_uint32(ctx->blob, !!(var->name));
-   if (var->name)
-      blob_write_string(ctx->blob, var->name);
+   write_type(ctx, var->type);
+   write_string(ctx, var->name);
+
+   assert(var->num_state_slots < (1 << 14));
+   assert(var->num_members < (1 << 16));
+
+   STATIC_ASSERT(sizeof(union packed_var) == sizeof(uint32_t));
+   union packed_var flags;
+   flags.u32 = 0;
+   flags.u.has_constant_initializer = !!(var->constant_initializer);
+   flags.u.has_interface_type = !!(var->interface_type);
+   flags.u.num_state_slots = var->num_state_slots;
+   flags.u.num_members = var->num_members;
+   blob_write_uint32(ctx->blob, flags.u32);
+
    blob_write_bytes(ctx->blob, (uint8_t *) &var->data, sizeof(var->data));
-   blob_write_uint32(ctx->blob, var->num_state_slots);
    for (unsigned i = 0; i < var->num_state_slots; i++) {
       for (unsigned j = 0; j < STATE_LENGTH; j++)
          blob_write_uint32(ctx->blob, var->state_slots[i].tokens[j]);
       blob_write_uint32(ctx->blob, var->state_slots[i].swizzle);
    }
-   blob_write_uint32(ctx->blob, !!(var->constant_initializer));
    if (var->constant_initializer)
       write_constant(ctx, var->constant_initializer);
-   blob_write_uint32(ctx->blob, !!(var->interface_type));
    if (var->interface_type)
-      encode_type_to_blob(ctx->blob, var->interface_type);
-   blob_write_uint32(ctx->blob, var->num_members);
+      write_type(ctx, var->interface_type);
    if (var->num_members > 0) {
       blob_write_bytes(ctx->blob, (uint8_t *) var->members,
                        var->num_members * sizeof(*var->members));
@@ -165,16 +279,14 @@ read_variable(read_ctx *ctx)
    nir_variable *var = rzalloc(ctx->nir, nir_variable);
    read_add_object(ctx, var);
 
-   var->type = decode_type_from_blob(ctx->blob);
-   bool has_name = blob_read_uint32(ctx->blob);
-   if (has_name) {
-      const char *name = blob_read_string(ctx->blob);
-      var->name = ralloc_strdup(var, name);
-   } else {
-      var->name = NULL;
-   }
+   var->type = read_type(ctx);
+   var->name = ralloc_strdup(var, read_string(ctx));
+
+   union packed_var flags;
+   flags.u32 = blob_read_uint32(ctx->blob);
+
    blob_copy_bytes(ctx->blob, (uint8_t *) &var->data, sizeof(var->data));
-   var->num_state_slots = blob_read_uint32(ctx->blob);
+   var->num_state_slots = flags.u.num_state_slots;
    if (var->num_state_slots != 0) {
       var->state_slots = ralloc_array(var, nir_state_slot,
                                       var->num_state_slots);
@@ -184,17 +296,15 @@ read_variable(read_ctx *ctx)
          var->state_slots[i].swizzle = blob_read_uint32(ctx->blob);
       }
    }
-   bool has_const_initializer = blob_read_uint32(ctx->blob);
-   if (has_const_initializer)
+   if (flags.u.has_constant_initializer)
       var->constant_initializer = read_constant(ctx, var);
    else
       var->constant_initializer = NULL;
-   bool has_interface_type = blob_read_uint32(ctx->blob);
-   if (has_interface_type)
-      var->interface_type = decode_type_from_blob(ctx->blob);
+   if (flags.u.has_interface_type)
+      var->interface_type = read_type(ctx);
    else
       var->interface_type = NULL;
-   var->num_members = blob_read_uint32(ctx->blob);
+   var->num_members = flags.u.num_members;
    if (var->num_members > 0) {
       var->members = ralloc_array(var, struct nir_variable_data,
                                   var->num_members);
@@ -229,13 +339,10 @@ static void
 write_register(write_ctx *ctx, const nir_register *reg)
 {
    write_add_object(ctx, reg);
-   blob_write_uint32(ctx->blob, reg->num_components);
-   blob_write_uint32(ctx->blob, reg->bit_size);
+   blob_write_uint32(ctx->blob, reg->num_components | reg->bit_size << 8);
    blob_write_uint32(ctx->blob, reg->num_array_elems);
    blob_write_uint32(ctx->blob, reg->index);
-   blob_write_uint32(ctx->blob, !!(reg->name));
-   if (reg->name)
-      blob_write_string(ctx->blob, reg->name);
+   write_string(ctx, reg->name);
 }
 
 static nir_register *
@@ -243,17 +350,12 @@ read_register(read_ctx *ctx)
 {
    nir_register *reg = ralloc(ctx->nir, nir_register);
    read_add_object(ctx, reg);
-   reg->num_components = blob_read_uint32(ctx->blob);
-   reg->bit_size = blob_read_uint32(ctx->blob);
+   uint32_t val = blob_read_uint32(ctx->blob);
+   reg->num_components = val & 0xff;
+   reg->bit_size = val >> 8;
    reg->num_array_elems = blob_read_uint32(ctx->blob);
    reg->index = blob_read_uint32(ctx->blob);
-   bool has_name = blob_read_uint32(ctx->blob);
-   if (has_name) {
-      const char *name = blob_read_string(ctx->blob);
-      reg->name = ralloc_strdup(reg, name);
-   } else {
-      reg->name = NULL;
-   }
+   reg->name = ralloc_strdup(reg, read_string(ctx));
 
    list_inithead(&reg->uses);
    list_inithead(&reg->defs);
@@ -286,19 +388,16 @@ write_src(write_ctx *ctx, const nir_src *src)
 {
    /* Since sources are very frequent, we try to save some space when storing
     * them. In particular, we store whether the source is a register and
-    * whether the register has an indirect index in the low two bits. We can
-    * assume that the high two bits of the index are zero, since otherwise our
-    * address space would've been exhausted allocating the remap table!
+    * whether the register has an indirect index in the low two bits.
     */
    if (src->is_ssa) {
-      uintptr_t idx = write_lookup_object(ctx, src->ssa) << 2;
-      idx |= 1;
-      blob_write_intptr(ctx->blob, idx);
+      uint32_t idx = write_lookup_object(ctx, src->ssa);
+      assert(idx < (1u << 30));
+      blob_write_uint32(ctx->blob, idx << 2 | 1);
    } else {
-      uintptr_t idx = write_lookup_object(ctx, src->reg.reg) << 2;
-      if (src->reg.indirect)
-         idx |= 2;
-      blob_write_intptr(ctx->blob, idx);
+      uint32_t idx = write_lookup_object(ctx, src->reg.reg);
+      assert(idx < (1u << 30));
+      blob_write_uint32(ctx->blob, idx << 2 | !!(src->reg.indirect) << 1);
       blob_write_uint32(ctx->blob, src->reg.base_offset);
       if (src->reg.indirect) {
          write_src(ctx, src->reg.indirect);
@@ -309,8 +408,8 @@ write_src(write_ctx *ctx, const nir_src *src)
 static void
 read_src(read_ctx *ctx, nir_src *src, void *mem_ctx)
 {
-   uintptr_t val = blob_read_intptr(ctx->blob);
-   uintptr_t idx = val >> 2;
+   uint32_t val = blob_read_uint32(ctx->blob);
+   uint32_t idx = val >> 2;
    src->is_ssa = val & 0x1;
    if (src->is_ssa) {
       src->ssa = read_lookup_object(ctx, idx);
@@ -327,24 +426,114 @@ read_src(read_ctx *ctx, nir_src *src, void *mem_ctx)
    }
 }
 
-static void
-write_dest(write_ctx *ctx, const nir_dest *dst)
+union packed_dest {
+   uint8_t u8;
+   struct {
+      uint8_t is_ssa:1;
+      uint8_t has_name:1;
+      uint8_t num_components:3;
+      uint8_t bit_size:3; /* log2 */
+   } ssa;
+   struct {
+      uint8_t is_ssa:1;
+      uint8_t is_indirect:1;
+      uint8_t _pad:6;
+   } reg;
+};
+
+/* The first word of every instruction packs its type with the fields that
+ * are small enough, including how its destination is stored, which keeps the
+ * top byte in every layout.
+ */
+union packed_instr {
+   uint32_t u32;
+   struct {
+      unsigned instr_type:4;
+      unsigned _pad:20;
+      unsigned dest:8;
+   } any;
+   struct {
+      unsigned instr_type:4;
+      unsigned exact:1;
+      unsigned saturate:1;
+      unsigned writemask:4;
+      unsigned op:9;
+      unsigned plain_srcs:1; /* No source modifiers nor swizzles */
+      unsigned _pad:4;
+      unsigned dest:8;
+   } alu;
+   struct {
+      unsigned instr_type:4;
+      unsigned deref_type:3;
+      unsigned mode:16;
+      unsigned _pad:1;
+      unsigned dest:8;
+   } deref;
+   struct {
+      unsigned instr_type:4;
+      unsigned intrinsic:9;
+      unsigned num_components:3;
+      unsigned _pad:8;
+      unsigned dest:8;
+   } intrinsic;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_components:3;
+      unsigned bit_size:3; /* log2 */
+      unsigned _pad:22;
+   } load_const;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_components:3;
+      unsigned bit_size:3; /* log2 */
+      unsigned _pad:22;
+   } undef;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_srcs:4;
+      unsigned op:4;
+      unsigned _pad:12;
+      unsigned dest:8;
+   } tex;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_srcs:20;
+      unsigned dest:8;
+   } phi;
+   struct {
+      unsigned instr_type:4;
+      unsigned type:2;
+      unsigned _pad:26;
+   } jump;
+};
+
+static uint8_t
+pack_dest(const nir_dest *dst)
 {
-   uint32_t val = dst->is_ssa;
+   union packed_dest dest;
+   dest.u8 = 0;
+   dest.ssa.is_ssa = dst->is_ssa;
    if (dst->is_ssa) {
-      val |= !!(dst->ssa.name) << 1;
-      val |= dst->ssa.num_components << 2;
-      val |= dst->ssa.bit_size << 5;
+      assert(dst->ssa.num_components <= NIR_MAX_VEC_COMPONENTS);
+      dest.ssa.has_name = !!(dst->ssa.name);
+      dest.ssa.num_components = dst->ssa.num_components;
+      dest.ssa.bit_size = ffs(dst->ssa.bit_size) - 1;
    } else {
-      val |= !!(dst->reg.indirect) << 1;
+      dest.reg.is_indirect = !!(dst->reg.indirect);
    }
-   blob_write_uint32(ctx->blob, val);
+   return dest.u8;
+}
+
+/* Writes the part of the destination which doesn't fit in the header. */
+static void
+write_dest(write_ctx *ctx, const nir_dest *dst)
+{
    if (dst->is_ssa) {
       write_add_object(ctx, &dst->ssa);
       if (dst->ssa.name)
-         blob_write_string(ctx->blob, dst->ssa.name);
+         write_string(ctx, dst->ssa.name);
    } else {
-      blob_write_intptr(ctx->blob, write_lookup_object(ctx, dst->reg.reg));
+      write_object(ctx, dst->reg.reg);
       blob_write_uint32(ctx->blob, dst->reg.base_offset);
       if (dst->reg.indirect)
          write_src(ctx, dst->reg.indirect);
@@ -352,42 +541,69 @@ write_dest(write_ctx *ctx, const nir_dest *dst)
 }
 
 static void
-read_dest(read_ctx *ctx, nir_dest *dst, nir_instr *instr)
+read_dest(read_ctx *ctx, nir_dest *dst, nir_instr *instr,
+          union packed_instr header)
 {
-   uint32_t val = blob_read_uint32(ctx->blob);
-   bool is_ssa = val & 0x1;
-   if (is_ssa) {
-      bool has_name = val & 0x2;
-      unsigned num_components = (val >> 2) & 0x7;
-      unsigned bit_size = val >> 5;
-      char *name = has_name ? blob_read_string(ctx->blob) : NULL;
-      nir_ssa_dest_init(instr, dst, num_components, bit_size, name);
+   union packed_dest dest;
+   dest.u8 = header.any.dest;
+
+   if (dest.ssa.is_ssa) {
+      const char *name = dest.ssa.has_name ? read_string(ctx) : NULL;
+      nir_ssa_dest_init(instr, dst, dest.ssa.num_components,
+                        1 << dest.ssa.bit_size, name);
       read_add_object(ctx, &dst->ssa);
    } else {
-      bool is_indirect = val & 0x2;
       dst->reg.reg = read_object(ctx);
       dst->reg.base_offset = blob_read_uint32(ctx->blob);
-      if (is_indirect) {
+      if (dest.reg.is_indirect) {
          dst->reg.indirect = ralloc(instr, nir_src);
          read_src(ctx, dst->reg.indirect, instr);
       }
    }
 }
 
+static bool
+is_alu_src_plain(const nir_alu_src *src)
+{
+   if (src->negate || src->abs)
+      return false;
+
+   for (unsigned i = 0; i < NIR_MAX_VEC_COMPONENTS; i++) {
+      if (src->swizzle[i] != i)
+         return false;
+   }
+
+   return true;
+}
+
 static void
 write_alu(write_ctx *ctx, const nir_alu_instr *alu)
 {
-   blob_write_uint32(ctx->blob, alu->op);
-   uint32_t flags = alu->exact;
-   flags |= alu->dest.saturate << 1;
-   flags |= alu->dest.write_mask << 2;
-   blob_write_uint32(ctx->blob, flags);
+   unsigned num_srcs = nir_op_infos[alu->op].num_inputs;
+   bool plain_srcs = true;
+   for (unsigned i = 0; i < num_srcs; i++)
+      plain_srcs &= is_alu_src_plain(&alu->src[i]);
+
+   STATIC_ASSERT(nir_num_opcodes <= (1 << 9));
+   union packed_instr header;
+   header.u32 = 0;
+   header.alu.instr_type = alu->instr.type;
+   header.alu.exact = alu->exact;
+   header.alu.saturate = alu->dest.saturate;
+   header.alu.writemask = alu->dest.write_mask;
+   header.alu.op = alu->op;
+   header.alu.plain_srcs = plain_srcs;
+   header.alu.dest = pack_dest(&alu->dest.dest);
+   blob_write_uint32(ctx->blob, header.u32);
 
    write_dest(ctx, &alu->dest.dest);
 
-   for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++) {
+   for (unsigned i = 0; i < num_srcs; i++) {
       write_src(ctx, &alu->src[i].src);
-      flags = alu->src[i].negate;
+      if (plain_srcs)
+         continue;
+
+      uint32_t flags = alu->src[i].negate;
       flags |= alu->src[i].abs << 1;
       for (unsigned j = 0; j < 4; j++)
          flags |= alu->src[i].swizzle[j] << (2 + 2 * j);
@@ -396,21 +612,24 @@ write_alu(write_ctx *ctx, const nir_alu_instr *alu)
 }
 
 static nir_alu_instr *
-read_alu(read_ctx *ctx)
+read_alu(read_ctx *ctx, union packed_instr header)
 {
-   nir_op op = blob_read_uint32(ctx->blob);
+   nir_op op = header.alu.op;
    nir_alu_instr *alu = nir_alu_instr_create(ctx->nir, op);
 
-   uint32_t flags = blob_read_uint32(ctx->blob);
-   alu->exact = flags & 1;
-   alu->dest.saturate = flags & 2;
-   alu->dest.write_mask = flags >> 2;
+   alu->exact = header.alu.exact;
+   alu->dest.saturate = header.alu.saturate;
+   alu->dest.write_mask = header.alu.writemask;
 
-   read_dest(ctx, &alu->dest.dest, &alu->instr);
+   read_dest(ctx, &alu->dest.dest, &alu->instr, header);
 
+   /* nir_alu_instr_create() already set up identity swizzles. */
    for (unsigned i = 0; i < nir_op_infos[op].num_inputs; i++) {
       read_src(ctx, &alu->src[i].src, &alu->instr);
-      flags = blob_read_uint32(ctx->blob);
+      if (header.alu.plain_srcs)
+         continue;
+
+      uint32_t flags = blob_read_uint32(ctx->blob);
       alu->src[i].negate = flags & 1;
       alu->src[i].abs = flags & 2;
       for (unsigned j = 0; j < 4; j++)
@@ -423,11 +642,17 @@ read_alu(read_ctx *ctx)
 static void
 write_deref(write_ctx *ctx, const nir_deref_instr *deref)
 {
-   blob_write_uint32(ctx->blob, deref->deref_type);
+   assert(deref->mode < (1 << 16));
 
-   blob_write_uint32(ctx->blob, deref->mode);
-   encode_type_to_blob(ctx->blob, deref->type);
+   union packed_instr header;
+   header.u32 = 0;
+   header.deref.instr_type = deref->instr.type;
+   header.deref.deref_type = deref->deref_type;
+   header.deref.mode = deref->mode;
+   header.deref.dest = pack_dest(&deref->dest);
+   blob_write_uint32(ctx->blob, header.u32);
 
+   write_type(ctx, deref->type);
    write_dest(ctx, &deref->dest);
 
    if (deref->deref_type == nir_deref_type_var) {
@@ -461,15 +686,15 @@ write_deref(write_ctx *ctx, const nir_deref_instr *deref)
 }
 
 static nir_deref_instr *
-read_deref(read_ctx *ctx)
+read_deref(read_ctx *ctx, union packed_instr header)
 {
-   nir_deref_type deref_type = blob_read_uint32(ctx->blob);
+   nir_deref_type deref_type = header.deref.deref_type;
    nir_deref_instr *deref = nir_deref_instr_create(ctx->nir, deref_type);
 
-   deref->mode = blob_read_uint32(ctx->blob);
-   deref->type = decode_type_from_blob(ctx->blob);
+   deref->mode = header.deref.mode;
+   deref->type = read_type(ctx);
 
-   read_dest(ctx, &deref->dest, &deref->instr);
+   read_dest(ctx, &deref->dest, &deref->instr, header);
 
    if (deref_type == nir_deref_type_var) {
       deref->var = read_object(ctx);
@@ -506,14 +731,21 @@ read_deref(read_ctx *ctx)
 static void
 write_intrinsic(write_ctx *ctx, const nir_intrinsic_instr *intrin)
 {
-   blob_write_uint32(ctx->blob, intrin->intrinsic);
-
    unsigned num_srcs = nir_intrinsic_infos[intrin->intrinsic].num_srcs;
    unsigned num_indices = nir_intrinsic_infos[intrin->intrinsic].num_indices;
-
-   blob_write_uint32(ctx->blob, intrin->num_components);
-
-   if (nir_intrinsic_infos[intrin->intrinsic].has_dest)
+   bool has_dest = nir_intrinsic_infos[intrin->intrinsic].has_dest;
+
+   STATIC_ASSERT(nir_num_intrinsics <= (1 << 9));
+   union packed_instr header;
+   header.u32 = 0;
+   header.intrinsic.instr_type = intrin->instr.type;
+   header.intrinsic.intrinsic = intrin->intrinsic;
+   header.intrinsic.num_components = intrin->num_components;
+   if (has_dest)
+      header.intrinsic.dest = pack_dest(&intrin->dest);
+   blob_write_uint32(ctx->blob, header.u32);
+
+   if (has_dest)
       write_dest(ctx, &intrin->dest);
 
    for (unsigned i = 0; i < num_srcs; i++)
@@ -524,19 +756,18 @@ write_intrinsic(write_ctx *ctx, const nir_intrinsic_instr *intrin)
 }
 
 static nir_intrinsic_instr *
-read_intrinsic(read_ctx *ctx)
+read_intrinsic(read_ctx *ctx, union packed_instr header)
 {
-   nir_intrinsic_op op = blob_read_uint32(ctx->blob);
-
+   nir_intrinsic_op op = header.intrinsic.intrinsic;
    nir_intrinsic_instr *intrin = nir_intrinsic_instr_create(ctx->nir, op);
 
    unsigned num_srcs = nir_intrinsic_infos[op].num_srcs;
    unsigned num_indices = nir_intrinsic_infos[op].num_indices;
 
-   intrin->num_components = blob_read_uint32(ctx->blob);
+   intrin->num_components = header.intrinsic.num_components;
 
    if (nir_intrinsic_infos[op].has_dest)
-      read_dest(ctx, &intrin->dest, &intrin->instr);
+      read_dest(ctx, &intrin->dest, &intrin->instr, header);
 
    for (unsigned i = 0; i < num_srcs; i++)
       read_src(ctx, &intrin->src[i], &intrin->instr);
@@ -550,22 +781,39 @@ read_intrinsic(read_ctx *ctx)
 static void
 write_load_const(write_ctx *ctx, const nir_load_const_instr *lc)
 {
-   uint32_t val = lc->def.num_components;
-   val |= lc->def.bit_size << 3;
-   blob_write_uint32(ctx->blob, val);
-   blob_write_bytes(ctx->blob, lc->value, sizeof(*lc->value) * lc->def.num_components);
+   union packed_instr header;
+   header.u32 = 0;
+   header.load_const.instr_type = lc->instr.type;
+   header.load_const.num_components = lc->def.num_components;
+   header.load_const.bit_size = ffs(lc->def.bit_size) - 1;
+   blob_write_uint32(ctx->blob, header.u32);
+
+   /* Only write the bits of the values which are used. */
+   for (unsigned i = 0; i < lc->def.num_components; i++) {
+      if (lc->def.bit_size == 64)
+         blob_write_uint64(ctx->blob, lc->value[i].u64);
+      else
+         blob_write_uint32(ctx->blob, lc->value[i].u32);
+   }
+
    write_add_object(ctx, &lc->def);
 }
 
 static nir_load_const_instr *
-read_load_const(read_ctx *ctx)
+read_load_const(read_ctx *ctx, union packed_instr header)
 {
-   uint32_t val = blob_read_uint32(ctx->blob);
-
    nir_load_const_instr *lc =
-      nir_load_const_instr_create(ctx->nir, val & 0x7, val >> 3);
+      nir_load_const_instr_create(ctx->nir,
+                                  header.load_const.num_components,
+                                  1 << header.load_const.bit_size);
+
+   for (unsigned i = 0; i < lc->def.num_components; i++) {
+      if (lc->def.bit_size == 64)
+         lc->value[i].u64 = blob_read_uint64(ctx->blob);
+      else
+         lc->value[i].u32 = blob_read_uint32(ctx->blob);
+   }
 
-   blob_copy_bytes(ctx->blob, lc->value, sizeof(*lc->value) * lc->def.num_components);
    read_add_object(ctx, &lc->def);
    return lc;
 }
@@ -573,19 +821,22 @@ read_load_const(read_ctx *ctx)
 static void
 write_ssa_undef(write_ctx *ctx, const nir_ssa_undef_instr *undef)
 {
-   uint32_t val = undef->def.num_components;
-   val |= undef->def.bit_size << 3;
-   blob_write_uint32(ctx->blob, val);
+   union packed_instr header;
+   header.u32 = 0;
+   header.undef.instr_type = undef->instr.type;
+   header.undef.num_components = undef->def.num_components;
+   header.undef.bit_size = ffs(undef->def.bit_size) - 1;
+   blob_write_uint32(ctx->blob, header.u32);
+
    write_add_object(ctx, &undef->def);
 }
 
 static nir_ssa_undef_instr *
-read_ssa_undef(read_ctx *ctx)
+read_ssa_undef(read_ctx *ctx, union packed_instr header)
 {
-   uint32_t val = blob_read_uint32(ctx->blob);
-
    nir_ssa_undef_instr *undef =
-      nir_ssa_undef_instr_create(ctx->nir, val & 0x7, val >> 3);
+      nir_ssa_undef_instr_create(ctx->nir, header.undef.num_components,
+                                 1 << header.undef.bit_size);
 
    read_add_object(ctx, &undef->def);
    return undef;
@@ -601,19 +852,38 @@ union packed_tex_data {
       unsigned is_shadow:1;
       unsigned is_new_style_shadow:1;
       unsigned component:2;
-      unsigned unused:10; /* Mark unused for valgrind. */
+      unsigned has_tg4_offsets:1;
+      unsigned unused:9; /* Mark unused for valgrind. */
    } u;
 };
 
+static bool
+has_tg4_offsets(const nir_tex_instr *tex)
+{
+   for (unsigned i = 0; i < 4; i++) {
+      if (tex->tg4_offsets[i][0] || tex->tg4_offsets[i][1])
+         return true;
+   }
+   return false;
+}
+
 static void
 write_tex(write_ctx *ctx, const nir_tex_instr *tex)
 {
-   blob_write_uint32(ctx->blob, tex->num_srcs);
-   blob_write_uint32(ctx->blob, tex->op);
+   assert(tex->num_srcs < (1 << 4));
+   assert(tex->op < (1 << 4));
+
+   union packed_instr header;
+   header.u32 = 0;
+   header.tex.instr_type = tex->instr.type;
+   header.tex.num_srcs = tex->num_srcs;
+   header.tex.op = tex->op;
+   header.tex.dest = pack_dest(&tex->dest);
+   blob_write_uint32(ctx->blob, header.u32);
+
    blob_write_uint32(ctx->blob, tex->texture_index);
    blob_write_uint32(ctx->blob, tex->texture_array_size);
    blob_write_uint32(ctx->blob, tex->sampler_index);
-   blob_write_bytes(ctx->blob, tex->tg4_offsets, sizeof(tex->tg4_offsets));
 
    STATIC_ASSERT(sizeof(union packed_tex_data) == sizeof(uint32_t));
    union packed_tex_data packed = {
@@ -624,9 +894,13 @@ write_tex(write_ctx *ctx, const nir_tex_instr *tex)
       .u.is_shadow = tex->is_shadow,
       .u.is_new_style_shadow = tex->is_new_style_shadow,
       .u.component = tex->component,
+      .u.has_tg4_offsets = has_tg4_offsets(tex),
    };
    blob_write_uint32(ctx->blob, packed.u32);
 
+   if (packed.u.has_tg4_offsets)
+      blob_write_bytes(ctx->blob, tex->tg4_offsets, sizeof(tex->tg4_offsets));
+
    write_dest(ctx, &tex->dest);
    for (unsigned i = 0; i < tex->num_srcs; i++) {
       blob_write_uint32(ctx->blob, tex->src[i].src_type);
@@ -635,16 +909,15 @@ write_tex(write_ctx *ctx, const nir_tex_instr *tex)
 }
 
 static nir_tex_instr *
-read_tex(read_ctx *ctx)
+read_tex(read_ctx *ctx, union packed_instr header)
 {
-   unsigned num_srcs = blob_read_uint32(ctx->blob);
-   nir_tex_instr *tex = nir_tex_instr_create(ctx->nir, num_srcs);
+   nir_tex_instr *tex = nir_tex_instr_create(ctx->nir,
+                                             header.tex.num_srcs);
 
-   tex->op = blob_read_uint32(ctx->blob);
+   tex->op = header.tex.op;
    tex->texture_index = blob_read_uint32(ctx->blob);
    tex->texture_array_size = blob_read_uint32(ctx->blob);
    tex->sampler_index = blob_read_uint32(ctx->blob);
-   blob_copy_bytes(ctx->blob, tex->tg4_offsets, sizeof(tex->tg4_offsets));
 
    union packed_tex_data packed;
    packed.u32 = blob_read_uint32(ctx->blob);
@@ -656,7 +929,10 @@ read_tex(read_ctx *ctx)
    tex->is_new_style_shadow = packed.u.is_new_style_shadow;
    tex->component = packed.u.component;
 
-   read_dest(ctx, &tex->dest, &tex->instr);
+   if (packed.u.has_tg4_offsets)
+      blob_copy_bytes(ctx->blob, tex->tg4_offsets, sizeof(tex->tg4_offsets));
+
+   read_dest(ctx, &tex->dest, &tex->instr, header);
    for (unsigned i = 0; i < tex->num_srcs; i++) {
       tex->src[i].src_type = blob_read_uint32(ctx->blob);
       read_src(ctx, &tex->src[i].src, &tex->instr);
@@ -668,20 +944,28 @@ read_tex(read_ctx *ctx)
 static void
 write_phi(write_ctx *ctx, const nir_phi_instr *phi)
 {
+   unsigned num_srcs = exec_list_length(&phi->srcs);
+   assert(num_srcs < (1 << 20));
+
+   union packed_instr header;
+   header.u32 = 0;
+   header.phi.instr_type = phi->instr.type;
+   header.phi.num_srcs = num_srcs;
+   header.phi.dest = pack_dest(&phi->dest);
+   blob_write_uint32(ctx->blob, header.u32);
+
    /* Phi nodes are special, since they may reference SSA definitions and
-    * basic blocks that don't exist yet. We leave two empty uintptr_t's here,
+    * basic blocks that don't exist yet. We leave two empty uint32_t's here,
     * and then store enough information so that a later fixup pass can fill
     * them in correctly.
     */
    write_dest(ctx, &phi->dest);
 
-   blob_write_uint32(ctx->blob, exec_list_length(&phi->srcs));
-
    nir_foreach_phi_src(src, phi) {
       assert(src->src.is_ssa);
-      size_t blob_offset = blob_reserve_intptr(ctx->blob);
-      MAYBE_UNUSED size_t blob_offset2 = blob_reserve_intptr(ctx->blob);
-      assert(blob_offset + sizeof(uintptr_t) == blob_offset2);
+      size_t blob_offset = blob_reserve_uint32(ctx->blob);
+      MAYBE_UNUSED size_t blob_offset2 = blob_reserve_uint32(ctx->blob);
+      assert(blob_offset + sizeof(uint32_t) == blob_offset2);
       write_phi_fixup fixup = {
          .blob_offset = blob_offset,
          .src = src->src.ssa,
@@ -695,7 +979,7 @@ static void
 write_fixup_phis(write_ctx *ctx)
 {
    util_dynarray_foreach(&ctx->phi_fixups, write_phi_fixup, fixup) {
-      uintptr_t *blob_ptr = (uintptr_t *)(ctx->blob->data + fixup->blob_offset);
+      uint32_t *blob_ptr = (uint32_t *)(ctx->blob->data + fixup->blob_offset);
       blob_ptr[0] = write_lookup_object(ctx, fixup->src);
       blob_ptr[1] = write_lookup_object(ctx, fixup->block);
    }
@@ -704,13 +988,11 @@ write_fixup_phis(write_ctx *ctx)
 }
 
 static nir_phi_instr *
-read_phi(read_ctx *ctx, nir_block *blk)
+read_phi(read_ctx *ctx, nir_block *blk, union packed_instr header)
 {
    nir_phi_instr *phi = nir_phi_instr_create(ctx->nir);
 
-   read_dest(ctx, &phi->dest, &phi->instr);
-
-   unsigned num_srcs = blob_read_uint32(ctx->blob);
+   read_dest(ctx, &phi->dest, &phi->instr, header);
 
    /* For similar reasons as before, we just store the index directly into the
     * pointer, and let a later pass resolve the phi sources.
@@ -722,12 +1004,12 @@ read_phi(read_ctx *ctx, nir_block *blk)
     */
    nir_instr_insert_after_block(blk, &phi->instr);
 
-   for (unsigned i = 0; i < num_srcs; i++) {
+   for (unsigned i = 0; i < header.phi.num_srcs; i++) {
       nir_phi_src *src = ralloc(phi, nir_phi_src);
 
       src->src.is_ssa = true;
-      src->src.ssa = (nir_ssa_def *) blob_read_intptr(ctx->blob);
-      src->pred = (nir_block *) blob_read_intptr(ctx->blob);
+      src->src.ssa = (nir_ssa_def *)(uintptr_t) blob_read_uint32(ctx->blob);
+      src->pred = (nir_block *)(uintptr_t) blob_read_uint32(ctx->blob);
 
       /* Since we're not letting nir_insert_instr handle use/def stuff for us,
        * we have to set the parent_instr manually.  It doesn't really matter
@@ -764,21 +1046,30 @@ read_fixup_phis(read_ctx *ctx)
 static void
 write_jump(write_ctx *ctx, const nir_jump_instr *jmp)
 {
-   blob_write_uint32(ctx->blob, jmp->type);
+   union packed_instr header;
+   header.u32 = 0;
+   header.jump.instr_type = jmp->instr.type;
+   header.jump.type = jmp->type;
+   blob_write_uint32(ctx->blob, header.u32);
 }
 
 static nir_jump_instr *
-read_jump(read_ctx *ctx)
+read_jump(read_ctx *ctx, union packed_instr header)
 {
-   nir_jump_type type = blob_read_uint32(ctx->blob);
-   nir_jump_instr *jmp = nir_jump_instr_create(ctx->nir, type);
+   nir_jump_instr *jmp = nir_jump_instr_create(ctx->nir,
+                                               header.jump.type);
    return jmp;
 }
 
 static void
 write_call(write_ctx *ctx, const nir_call_instr *call)
 {
-   blob_write_intptr(ctx->blob, write_lookup_object(ctx, call->callee));
+   union packed_instr header;
+   header.u32 = 0;
+   header.any.instr_type = call->instr.type;
+   blob_write_uint32(ctx->blob, header.u32);
+
+   write_object(ctx, call->callee);
 
    for (unsigned i = 0; i < call->num_params; i++)
       write_src(ctx, &call->params[i]);
@@ -799,7 +1090,7 @@ read_call(read_ctx *ctx)
 static void
 write_instr(write_ctx *ctx, const nir_instr *instr)
 {
-   blob_write_uint32(ctx->blob, instr->type);
+   /* Every writer starts with its packed header. */
    switch (instr->type) {
    case nir_instr_type_alu:
       write_alu(ctx, nir_instr_as_alu(instr));
@@ -838,26 +1129,28 @@ write_instr(write_ctx *ctx, const nir_instr *instr)
 static void
 read_instr(read_ctx *ctx, nir_block *block)
 {
-   nir_instr_type type = blob_read_uint32(ctx->blob);
+   union packed_instr header;
+   header.u32 = blob_read_uint32(ctx->blob);
    nir_instr *instr;
-   switch (type) {
+
+   switch (header.any.instr_type) {
    case nir_instr_type_alu:
-      instr = &read_alu(ctx)->instr;
+      instr = &read_alu(ctx, header)->instr;
       break;
    case nir_instr_type_deref:
-      instr = &read_deref(ctx)->instr;
+      instr = &read_deref(ctx, header)->instr;
       break;
    case nir_instr_type_intrinsic:
-      instr = &read_intrinsic(ctx)->instr;
+      instr = &read_intrinsic(ctx, header)->instr;
       break;
    case nir_instr_type_load_const:
-      instr = &read_load_const(ctx)->instr;
+      instr = &read_load_const(ctx, header)->instr;
       break;
    case nir_instr_type_ssa_undef:
-      instr = &read_ssa_undef(ctx)->instr;
+      instr = &read_ssa_undef(ctx, header)->instr;
       break;
    case nir_instr_type_tex:
-      instr = &read_tex(ctx)->instr;
+      instr = &read_tex(ctx, header)->instr;
       break;
    case nir_instr_type_phi:
       /* Phi instructions are a bit of a special case when reading because we
@@ -865,10 +1158,10 @@ read_instr(read_ctx *ctx, nir_block *block)
        * for us.  Instead, we need to wait until all the blocks/instructions
        * are read so that we can set their sources up.
        */
-      read_phi(ctx, block);
+      read_phi(ctx, block, header);
       return;
    case nir_instr_type_jump:
-      instr = &read_jump(ctx)->instr;
+      instr = &read_jump(ctx, header)->instr;
       break;
    case nir_instr_type_call:
       instr = &read_call(ctx)->instr;
@@ -1041,9 +1334,7 @@ read_function_impl(read_ctx *ctx, nir_function *fxn)
 static void
 write_function(write_ctx *ctx, const nir_function *fxn)
 {
-   blob_write_uint32(ctx->blob, !!(fxn->name));
-   if (fxn->name)
-      blob_write_string(ctx->blob, fxn->name);
+   write_string(ctx, fxn->name);
 
    write_add_object(ctx, fxn);
 
@@ -1067,8 +1358,7 @@ write_function(write_ctx *ctx, const nir_function *fxn)
 static void
 read_function(read_ctx *ctx)
 {
-   bool has_name = blob_read_uint32(ctx->blob);
-   char *name = has_name ? blob_read_string(ctx->blob) : NULL;
+   const char *name = read_string(ctx);
 
    nir_function *fxn = nir_function_create(ctx->nir, name);
 
@@ -1091,23 +1381,20 @@ nir_serialize(struct blob *blob, const nir_shader *nir)
    write_ctx ctx;
    ctx.remap_table = _mesa_pointer_hash_table_create(NULL);
    ctx.next_idx = 0;
+   ctx.type_table = _mesa_pointer_hash_table_create(NULL);
+   ctx.string_table = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
+                                              _mesa_key_string_equal);
    ctx.blob = blob;
    ctx.nir = nir;
    util_dynarray_init(&ctx.phi_fixups, NULL);
 
-   size_t idx_size_offset = blob_reserve_intptr(blob);
+   blob_write_uint32(blob, NIR_SERIALIZE_MAGIC);
+   blob_write_uint32(blob, NIR_SERIALIZE_VERSION);
+   size_t idx_size_offset = blob_reserve_uint32(blob);
 
    struct shader_info info = nir->info;
-   uint32_t strings = 0;
-   if (info.name)
-      strings |= 0x1;
-   if (info.label)
-      strings |= 0x2;
-   blob_write_uint32(blob, strings);
-   if (info.name)
-      blob_write_string(blob, info.name);
-   if (info.label)
-      blob_write_string(blob, info.label);
+   write_string(&ctx, info.name);
+   write_string(&ctx, info.label);
    info.name = info.label = NULL;
    blob_write_bytes(blob, (uint8_t *) &info, sizeof(info));
 
@@ -1137,9 +1424,11 @@ nir_serialize(struct blob *blob, const nir_shader *nir)
    if (nir->constant_data_size > 0)
       blob_write_bytes(blob, nir->constant_data, nir->constant_data_size);
 
-   *(uintptr_t *)(blob->data + idx_size_offset) = ctx.next_idx;
+   blob_overwrite_uint32(blob, idx_size_offset, ctx.next_idx);
 
    _mesa_hash_table_destroy(ctx.remap_table, NULL);
+   _mesa_hash_table_destroy(ctx.type_table, NULL);
+   _mesa_hash_table_destroy(ctx.string_table, NULL);
    util_dynarray_fini(&ctx.phi_fixups);
 }
 
@@ -1149,23 +1438,31 @@ nir_deserialize(void *mem_ctx,
                 struct blob_reader *blob)
 {
    read_ctx ctx;
+
+   if (blob_read_uint32(blob) != NIR_SERIALIZE_MAGIC ||
+       blob_read_uint32(blob) != NIR_SERIALIZE_VERSION) {
+      blob->overrun = true;
+      return NULL;
+   }
+
    ctx.blob = blob;
    list_inithead(&ctx.phi_srcs);
-   ctx.idx_table_len = blob_read_intptr(blob);
-   ctx.idx_table = calloc(ctx.idx_table_len, sizeof(uintptr_t));
+   ctx.idx_table_len = blob_read_uint32(blob);
+   ctx.idx_table = calloc(ctx.idx_table_len, sizeof(void *));
    ctx.next_idx = 0;
+   util_dynarray_init(&ctx.types, NULL);
+   util_dynarray_init(&ctx.strings, NULL);
 
-   uint32_t strings = blob_read_uint32(blob);
-   char *name = (strings & 0x1) ? blob_read_string(blob) : NULL;
-   char *label = (strings & 0x2) ? blob_read_string(blob) : NULL;
+   const char *name = read_string(&ctx);
+   const char *label = read_string(&ctx);
 
    struct shader_info info;
    blob_copy_bytes(blob, (uint8_t *) &info, sizeof(info));
 
    ctx.nir = nir_shader_create(mem_ctx, info.stage, options, NULL);
 
-   info.name = name ? ralloc_strdup(ctx.nir, name) : NULL;
-   info.label = label ? ralloc_strdup(ctx.nir, label) : NULL;
+   info.name = ralloc_strdup(ctx.nir, name);
+   info.label = ralloc_strdup(ctx.nir, label);
 
    ctx.nir->info = info;
 
@@ -1198,10 +1495,22 @@ nir_deserialize(void *mem_ctx,
    }
 
    free(ctx.idx_table);
+   util_dynarray_fini(&ctx.types);
+   util_dynarray_fini(&ctx.strings);
 
    return ctx.nir;
 }
 
+bool
+nir_serialize_version_matches(const struct blob_reader *blob)
+{
+   struct blob_reader header = *blob;
+
+   return blob_read_uint32(&header) == NIR_SERIALIZE_MAGIC &&
+          blob_read_uint32(&header) == NIR_SERIALIZE_VERSION &&
+          !header.overrun;
+}
+
 nir_shader *
 nir_shader_serialize_deserialize(void *mem_ctx, nir_shader *s)
 {
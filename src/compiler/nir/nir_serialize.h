@@ -32,10 +32,19 @@ extern "C" {
 #endif
 
 void nir_serialize(struct blob *blob, const nir_shader *nir);
+
+/* Returns NULL, and marks the reader as overrun, if the blob wasn't written
+ * by this version of nir_serialize().
+ */
 nir_shader *nir_deserialize(void *mem_ctx,
                             const struct nir_shader_compiler_options *options,
                             struct blob_reader *blob);
 
+/* Whether nir_deserialize() would accept the blob's version, without
+ * reading the shader or moving the reader.
+ */
+bool nir_serialize_version_matches(const struct blob_reader *blob);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -33,6 +33,11 @@
  * The expectation is that drivers should call this when finished compiling the shader
  * (after any optimization, lowering, and so on).  However, it's also fine to call it
  * earlier, and even many times, trading CPU cycles for memory savings.
+ *
+ * The live instructions are moved to a new arena, in program order, and the SSA
+ * defs are renumbered in the same order.  Later passes then walk memory linearly,
+ * and can index dense arrays with the SSA def indices.  Pointers to instructions
+ * and SSA defs don't survive nir_sweep().
  */
 
 #define steal_list(mem_ctx, type, list) \
@@ -41,21 +46,50 @@
 static void sweep_cf_node(nir_shader *nir, nir_cf_node *cf_node);
 
 static bool
-sweep_src_indirect(nir_src *src, void *nir)
+get_ssa_def(nir_ssa_def *def, void *state)
 {
-   if (!src->is_ssa && src->reg.indirect)
-      ralloc_steal(nir, src->reg.indirect);
-
+   *(nir_ssa_def **) state = def;
    return true;
 }
 
-static bool
-sweep_dest_indirect(nir_dest *dest, void *nir)
+static void
+move_instr(nir_shader *nir, nir_instr *instr)
 {
-   if (!dest->is_ssa && dest->reg.indirect)
-      ralloc_steal(nir, dest->reg.indirect);
+   nir_instr *ninstr;
+
+   switch (instr->type) {
+   case nir_instr_type_jump: {
+      /* Removing or inserting a jump would update the CFG, just swap the
+       * new one in.  They have no sources or destinations.
+       */
+      nir_jump_instr *jump = nir_instr_as_jump(instr);
+      ninstr = &nir_jump_instr_create(nir, jump->type)->instr;
+      ninstr->block = instr->block;
+      exec_node_insert_node_before(&instr->node, &ninstr->node);
+      exec_node_remove(&instr->node);
+      return;
+   }
 
-   return true;
+   case nir_instr_type_parallel_copy:
+      /* These only exist in the middle of nir_convert_from_ssa(). */
+      ralloc_steal(nir->instr_ctx, instr);
+      return;
+
+   default:
+      break;
+   }
+
+   ninstr = nir_instr_clone(nir, instr);
+   ninstr->pass_flags = instr->pass_flags;
+   nir_instr_insert_before(instr, ninstr);
+
+   nir_ssa_def *def = NULL, *ndef = NULL;
+   nir_foreach_ssa_def(instr, get_ssa_def, &def);
+   nir_foreach_ssa_def(ninstr, get_ssa_def, &ndef);
+   if (def)
+      nir_ssa_def_rewrite_uses(def, nir_src_for_ssa(ndef));
+
+   nir_instr_remove(instr);
 }
 
 static void
@@ -63,8 +97,8 @@ sweep_block(nir_shader *nir, nir_block *block)
 {
    ralloc_steal(nir, block);
 
-   /* sweep_impl will mark all metadata invalid.  We can safely release all of
-    * this here.
+   /* sweep_impl will mark the liveness metadata invalid.  We can safely
+    * release all of this here.
     */
    ralloc_free(block->live_in);
    block->live_in = NULL;
@@ -72,12 +106,8 @@ sweep_block(nir_shader *nir, nir_block *block)
    ralloc_free(block->live_out);
    block->live_out = NULL;
 
-   nir_foreach_instr(instr, block) {
-      ralloc_steal(nir, instr);
-
-      nir_foreach_src(instr, sweep_src_indirect, nir);
-      nir_foreach_dest(instr, sweep_dest_indirect, nir);
-   }
+   nir_foreach_instr_safe(instr, block)
+      move_instr(nir, instr);
 }
 
 static void
@@ -136,8 +166,12 @@ sweep_impl(nir_shader *nir, nir_function_impl *impl)
 
    sweep_block(nir, impl->end_block);
 
-   /* Wipe out all the metadata, if any. */
-   nir_metadata_preserve(impl, nir_metadata_none);
+   nir_index_ssa_defs(impl);
+
+   /* Wipe out all the metadata, if any, but the divergence information,
+    * which the new SSA defs took over.
+    */
+   nir_metadata_preserve(impl, nir_metadata_divergence);
 }
 
 static void
@@ -158,6 +192,11 @@ nir_sweep(nir_shader *nir)
    /* First, move ownership of all the memory to a temporary context; assume dead. */
    ralloc_adopt(rubbish, nir);
 
+   /* The old instruction arena goes with it, the live instructions are moved
+    * to a new one.
+    */
+   nir->instr_ctx = ralloc_arena_context(nir);
+
    ralloc_steal(nir, (char *)nir->info.name);
    if (nir->info.label)
       ralloc_steal(nir, (char *)nir->info.label);
@@ -28,6 +28,7 @@
 #include "nir.h"
 #include "c11/threads.h"
 #include <assert.h>
+#include <string.h>
 
 /*
  * This file checks for invalid IR indicating a bug somewhere in the compiler.
@@ -1219,15 +1220,34 @@ dump_errors(validate_state *state, const char *when)
    abort();
 }
 
-void
-nir_validate_shader(nir_shader *shader, const char *when)
+enum validate_mode {
+   VALIDATE_NONE,
+   VALIDATE_CHANGES,
+   VALIDATE_FULL,
+};
+
+/* NIR_VALIDATE=false disables validation, NIR_VALIDATE=full validates
+ * every function after every pass, instead of only the ones it changed.
+ */
+static enum validate_mode
+get_validate_mode(void)
 {
-   static int should_validate = -1;
-   if (should_validate < 0)
-      should_validate = env_var_as_boolean("NIR_VALIDATE", true);
-   if (!should_validate)
-      return;
+   static int mode = -1;
+   if (mode < 0) {
+      const char *str = getenv("NIR_VALIDATE");
+      if (str && strcmp(str, "full") == 0)
+         mode = VALIDATE_FULL;
+      else if (env_var_as_boolean("NIR_VALIDATE", true))
+         mode = VALIDATE_CHANGES;
+      else
+         mode = VALIDATE_NONE;
+   }
+   return mode;
+}
 
+static void
+validate_shader(nir_shader *shader, const char *when, bool only_changes)
+{
    validate_state state;
    init_validate_state(&state);
 
@@ -1263,8 +1283,17 @@ nir_validate_shader(nir_shader *shader, const char *when)
      validate_var_decl(var, true, &state);
    }
 
+   /* The variable declarations are always checked, since they can be
+    * changed without touching any function, and functions can't be
+    * validated without them.  A function can only be skipped as a whole:
+    * SSA uses may be anywhere in it.
+    */
    exec_list_validate(&shader->functions);
    foreach_list_typed(nir_function, func, node, &shader->functions) {
+      if (only_changes && func->impl &&
+          (func->impl->valid_metadata & nir_metadata_validated))
+         continue;
+
       validate_function(func, &state);
    }
 
@@ -1272,6 +1301,34 @@ nir_validate_shader(nir_shader *shader, const char *when)
       dump_errors(&state, when);
 
    destroy_validate_state(&state);
+
+   nir_foreach_function(func, shader) {
+      if (func->impl)
+         func->impl->valid_metadata |= nir_metadata_validated;
+   }
+}
+
+void
+nir_validate_shader(nir_shader *shader, const char *when)
+{
+   if (get_validate_mode() == VALIDATE_NONE)
+      return;
+
+   validate_shader(shader, when, false);
+}
+
+/**
+ * Like nir_validate_shader(), but only validates the functions that changed
+ * since they were last validated, as tracked by nir_metadata_validated.
+ */
+void
+nir_validate_shader_changes(nir_shader *shader, const char *when)
+{
+   enum validate_mode mode = get_validate_mode();
+   if (mode == VALIDATE_NONE)
+      return;
+
+   validate_shader(shader, when, mode == VALIDATE_CHANGES);
 }
 
 #endif /* NDEBUG */
@@ -0,0 +1,481 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Compares the time nir_opt_algebraic takes with the automaton and with the
+ * tree walking matcher.
+ *
+ * The corpus is made of generated fragment shaders, with about as many ALU
+ * instructions, and the same mix of opcodes and constants, as what a typical
+ * shader-db run feeds nir_opt_algebraic.  Every shader goes through the
+ * usual optimization loop, and only the nir_opt_algebraic calls are timed.
+ *
+ *    algebraic_bench [number of shaders] [instructions per shader]
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "util/os_time.h"
+#include "util/rand_xor.h"
+
+#define NUM_RUNS 3
+
+/* The options of a typical scalar backend. */
+static const nir_shader_compiler_options options = {
+   .lower_sub = true,
+   .lower_fdiv = true,
+   .lower_scmp = true,
+   .lower_flrp16 = true,
+   .lower_flrp64 = true,
+   .lower_fmod16 = true,
+   .lower_fmod32 = true,
+   .lower_bitfield_extract = true,
+   .lower_bitfield_insert = true,
+   .lower_uadd_carry = true,
+   .lower_usub_borrow = true,
+   .lower_isign = true,
+   .lower_ldexp = true,
+   .lower_fpow = true,
+};
+
+static uint64_t seed[2];
+
+static unsigned
+rand_below(unsigned n)
+{
+   return rand_xorshift128plus(seed) % n;
+}
+
+static nir_ssa_def *
+rand_const(nir_builder *b)
+{
+   static const float values[] = {
+      0.0f, 1.0f, -1.0f, 0.5f, 2.0f, 255.0f, 1.0f / 255.0f, 3.14159265f,
+   };
+   float x = values[rand_below(ARRAY_SIZE(values))];
+
+   if (rand_below(4) == 0)
+      return nir_imm_float(b, x);
+
+   return nir_imm_vec4(b, x, x, x, x);
+}
+
+static nir_ssa_def *
+rand_int_const(nir_builder *b)
+{
+   static const int values[] = {
+      0, 1, -1, 2, 4, 16, 0xff, 0xffff,
+   };
+   return nir_imm_int(b, values[rand_below(ARRAY_SIZE(values))]);
+}
+
+/* Recently computed values are used a lot more than older ones. */
+static nir_ssa_def *
+pick(nir_ssa_def **values, unsigned num_values)
+{
+   unsigned distance = rand_below(4) == 0 ? rand_below(num_values) :
+                                            rand_below(MIN2(num_values, 4));
+   return values[num_values - 1 - distance];
+}
+
+static nir_ssa_def *
+pick_scalar(nir_builder *b, nir_ssa_def **values, unsigned num_values)
+{
+   nir_ssa_def *v = pick(values, num_values);
+   return v->num_components == 1 ? v : nir_channel(b, v, rand_below(4));
+}
+
+static nir_ssa_def *
+to_vec4(nir_builder *b, nir_ssa_def *v)
+{
+   return v->num_components == 4 ? v : nir_vec4(b, v, v, v, v);
+}
+
+static nir_ssa_def *
+pick_vec4(nir_builder *b, nir_ssa_def **values, unsigned num_values)
+{
+   return to_vec4(b, pick(values, num_values));
+}
+
+static nir_ssa_def *
+rand_float_op(nir_builder *b, nir_ssa_def **values, unsigned num_values)
+{
+   nir_ssa_def *x = pick_vec4(b, values, num_values);
+   nir_ssa_def *y = rand_below(3) == 0 ? to_vec4(b, rand_const(b)) :
+                                         pick_vec4(b, values, num_values);
+
+   switch (rand_below(24)) {
+   case 0: case 1: case 2: case 3:
+      return nir_fmul(b, x, y);
+   case 4: case 5: case 6:
+      return nir_fadd(b, x, y);
+   case 7: case 8:
+      return nir_ffma(b, x, y, pick_vec4(b, values, num_values));
+   case 9:
+      return nir_fsub(b, x, y);
+   case 10:
+      return nir_fneg(b, x);
+   case 11:
+      return nir_fabs(b, x);
+   case 12:
+      return nir_fsat(b, x);
+   case 13:
+      return nir_fmin(b, x, y);
+   case 14:
+      return nir_fmax(b, x, y);
+   case 15:
+      return nir_flrp(b, x, y, pick_vec4(b, values, num_values));
+   case 16: {
+      nir_ssa_def *d = nir_fdot4(b, x, y);
+      return rand_below(2) ? nir_frsq(b, d) : d;
+   }
+   case 17:
+      return nir_fsqrt(b, x);
+   case 18:
+      return nir_fpow(b, x, y);
+   case 19:
+      return nir_fexp2(b, nir_fmul(b, nir_flog2(b, x), y));
+   case 20:
+      return nir_bcsel(b, nir_flt(b, x, y), x, y);
+   case 21:
+      return nir_b2f32(b, nir_fge(b, x, y));
+   case 22:
+      return nir_ffract(b, x);
+   default:
+      return nir_fdiv(b, x, y);
+   }
+}
+
+static nir_ssa_def *
+rand_int_op(nir_builder *b, nir_ssa_def **values, unsigned num_values)
+{
+   nir_ssa_def *x = nir_f2i32(b, pick_scalar(b, values, num_values));
+   nir_ssa_def *y = rand_int_const(b);
+
+   switch (rand_below(8)) {
+   case 0:
+      x = nir_iand(b, x, y);
+      break;
+   case 1:
+      x = nir_ior(b, nir_ishl(b, x, nir_imm_int(b, 8)), y);
+      break;
+   case 2:
+      x = nir_ushr(b, x, nir_imm_int(b, rand_below(32)));
+      break;
+   case 3:
+      x = nir_iadd(b, x, y);
+      break;
+   case 4:
+      x = nir_imul(b, x, y);
+      break;
+   case 5:
+      x = nir_bcsel(b, nir_ieq(b, x, y), x, nir_ineg(b, x));
+      break;
+   case 6:
+      x = nir_inot(b, nir_inot(b, x));
+      break;
+   default:
+      x = nir_ixor(b, x, y);
+      break;
+   }
+
+   return nir_i2f32(b, x);
+}
+
+static nir_shader *
+generate_shader(unsigned num_instrs)
+{
+   nir_builder b;
+   nir_builder_init_simple_shader(&b, NULL, MESA_SHADER_FRAGMENT, &options);
+
+   const struct glsl_type *vec4 = glsl_vec4_type();
+   nir_ssa_def **values = ralloc_array(b.shader, nir_ssa_def *, num_instrs + 4);
+   unsigned num_values = 0;
+
+   for (unsigned i = 0; i < 4; i++) {
+      nir_variable *in = nir_variable_create(b.shader, nir_var_shader_in,
+                                             vec4, "in");
+      in->data.location = VARYING_SLOT_VAR0 + i;
+      values[num_values++] = nir_load_var(&b, in);
+   }
+
+   nir_variable *out = nir_variable_create(b.shader, nir_var_shader_out,
+                                           vec4, "out");
+   out->data.location = FRAG_RESULT_DATA0;
+
+   while (num_values < num_instrs + 4) {
+      nir_ssa_def *value;
+
+      /* Some conditional code, for the phis and the if conditions. */
+      if (rand_below(64) == 0) {
+         nir_ssa_def *cond = nir_flt(&b, pick_scalar(&b, values, num_values),
+                                     nir_imm_float(&b, 0.5f));
+         nir_if *nif = nir_push_if(&b, cond);
+         nir_ssa_def *then_val =
+            to_vec4(&b, rand_float_op(&b, values, num_values));
+         nir_push_else(&b, nif);
+         nir_ssa_def *else_val = pick_vec4(&b, values, num_values);
+         nir_pop_if(&b, nif);
+         value = nir_if_phi(&b, then_val, else_val);
+      } else if (rand_below(8) == 0) {
+         value = rand_int_op(&b, values, num_values);
+      } else {
+         value = rand_float_op(&b, values, num_values);
+      }
+
+      values[num_values++] = value;
+   }
+
+   /* Sum a few of the values so that most of the shader is live. */
+   nir_ssa_def *result = values[num_values - 1];
+   for (unsigned i = 0; i < num_values / 8; i++)
+      result = nir_fadd(&b, result, pick_vec4(&b, values, num_values));
+   nir_store_var(&b, out, result, 0xf);
+
+   nir_lower_vars_to_ssa(b.shader);
+   nir_lower_alu_to_scalar(b.shader, NULL);
+
+   return b.shader;
+}
+
+static unsigned
+count_alu_instrs(nir_shader *shader)
+{
+   unsigned count = 0;
+
+   nir_foreach_function(function, shader) {
+      if (!function->impl)
+         continue;
+
+      nir_foreach_block(block, function->impl) {
+         nir_foreach_instr(instr, block) {
+            if (instr->type == nir_instr_type_alu)
+               count++;
+         }
+      }
+   }
+
+   return count;
+}
+
+/* The usual optimization loop, returning the time spent in
+ * nir_opt_algebraic.
+ */
+static int64_t
+optimize(nir_shader *shader, unsigned *num_algebraic_calls)
+{
+   int64_t algebraic_time = 0;
+   bool progress;
+
+   do {
+      progress = false;
+
+      progress |= nir_copy_prop(shader);
+      progress |= nir_opt_remove_phis(shader);
+      progress |= nir_opt_dce(shader);
+      progress |= nir_opt_cse(shader);
+      progress |= nir_opt_peephole_select(shader, 8, true, true);
+
+      int64_t start = os_time_get_nano();
+      progress |= nir_opt_algebraic(shader);
+      algebraic_time += os_time_get_nano() - start;
+      (*num_algebraic_calls)++;
+
+      progress |= nir_opt_constant_folding(shader);
+      progress |= nir_opt_undef(shader);
+   } while (progress);
+
+   int64_t start = os_time_get_nano();
+   while (nir_opt_algebraic_late(shader)) {
+      algebraic_time += os_time_get_nano() - start;
+      nir_copy_prop(shader);
+      nir_opt_dce(shader);
+      nir_opt_cse(shader);
+      start = os_time_get_nano();
+   }
+   algebraic_time += os_time_get_nano() - start;
+
+   return algebraic_time;
+}
+
+struct result {
+   int64_t algebraic_time;
+   unsigned num_algebraic_calls;
+   unsigned num_alu_instrs;
+};
+
+/* The matcher is picked once per process from NIR_ALGEBRAIC_MATCHER, so
+ * each run optimizes the corpus in a child process and sends the results
+ * back through a pipe.
+ */
+static void
+run(nir_shader **corpus, unsigned num_shaders, const char *matcher,
+    struct result *results)
+{
+   struct result *run_results = calloc(num_shaders, sizeof(*run_results));
+   size_t size = num_shaders * sizeof(*run_results);
+   int fds[2];
+
+   if (!run_results || pipe(fds) != 0) {
+      perror("algebraic_bench");
+      exit(EXIT_FAILURE);
+   }
+
+   pid_t pid = fork();
+   if (pid < 0) {
+      perror("algebraic_bench");
+      exit(EXIT_FAILURE);
+   }
+
+   if (pid == 0) {
+      close(fds[0]);
+      setenv("NIR_ALGEBRAIC_MATCHER", matcher, 1);
+
+      for (unsigned i = 0; i < num_shaders; i++) {
+         nir_shader *shader = nir_shader_clone(NULL, corpus[i]);
+         unsigned num_calls = 0;
+
+         run_results[i].algebraic_time = optimize(shader, &num_calls);
+         run_results[i].num_algebraic_calls = num_calls;
+         run_results[i].num_alu_instrs = count_alu_instrs(shader);
+         ralloc_free(shader);
+      }
+
+      const char *data = (const char *) run_results;
+      for (size_t done = 0; done < size; ) {
+         ssize_t ret = write(fds[1], data + done, size - done);
+         if (ret <= 0)
+            _exit(EXIT_FAILURE);
+         done += ret;
+      }
+      _exit(EXIT_SUCCESS);
+   }
+
+   close(fds[1]);
+
+   char *data = (char *) run_results;
+   size_t done = 0;
+   while (done < size) {
+      ssize_t ret = read(fds[0], data + done, size - done);
+      if (ret <= 0)
+         break;
+      done += ret;
+   }
+   close(fds[0]);
+
+   int status;
+   if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+       WEXITSTATUS(status) != EXIT_SUCCESS || done != size) {
+      fprintf(stderr, "algebraic_bench: %s run failed\n", matcher);
+      exit(EXIT_FAILURE);
+   }
+
+   for (unsigned i = 0; i < num_shaders; i++) {
+      if (results[i].num_algebraic_calls == 0 ||
+          run_results[i].algebraic_time < results[i].algebraic_time)
+         results[i].algebraic_time = run_results[i].algebraic_time;
+      results[i].num_algebraic_calls = run_results[i].num_algebraic_calls;
+      results[i].num_alu_instrs = run_results[i].num_alu_instrs;
+   }
+
+   free(run_results);
+}
+
+static void
+print_results(const char *name, const struct result *results,
+              unsigned num_shaders)
+{
+   int64_t time = 0;
+   unsigned calls = 0, instrs = 0;
+
+   for (unsigned i = 0; i < num_shaders; i++) {
+      time += results[i].algebraic_time;
+      calls += results[i].num_algebraic_calls;
+      instrs += results[i].num_alu_instrs;
+   }
+
+   printf("%-10s %12.2f %12u %12u\n", name, time / 1e6, calls, instrs);
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned num_shaders = argc > 1 ? atoi(argv[1]) : 200;
+   unsigned num_instrs = argc > 2 ? atoi(argv[2]) : 300;
+
+   glsl_type_singleton_init_or_ref();
+
+   seed[0] = 0x5eed;
+   seed[1] = 0xa16eb7a1c;
+
+   nir_shader **corpus = calloc(num_shaders, sizeof(*corpus));
+   struct result *automaton = calloc(num_shaders, sizeof(*automaton));
+   struct result *tree_walk = calloc(num_shaders, sizeof(*tree_walk));
+   unsigned num_input_instrs = 0;
+
+   for (unsigned i = 0; i < num_shaders; i++) {
+      corpus[i] = generate_shader(num_instrs);
+      num_input_instrs += count_alu_instrs(corpus[i]);
+   }
+
+   /* Interleave the runs, and keep the fastest time of each shader. */
+   for (unsigned run_index = 0; run_index < NUM_RUNS; run_index++) {
+      run(corpus, num_shaders, "tree_walk", tree_walk);
+      run(corpus, num_shaders, "automaton", automaton);
+   }
+
+   unsigned num_different = 0;
+   int64_t automaton_time = 0, tree_walk_time = 0;
+   for (unsigned i = 0; i < num_shaders; i++) {
+      if (automaton[i].num_alu_instrs != tree_walk[i].num_alu_instrs)
+         num_different++;
+      automaton_time += automaton[i].algebraic_time;
+      tree_walk_time += tree_walk[i].algebraic_time;
+   }
+
+   printf("%u shaders, %u ALU instructions\n\n", num_shaders,
+          num_input_instrs);
+   printf("matcher        time (ms)        calls ALU instrs\n");
+   print_results("tree walk", tree_walk, num_shaders);
+   print_results("automaton", automaton, num_shaders);
+   printf("\nspeedup: %.2fx\n", (double) tree_walk_time / automaton_time);
+   if (num_different) {
+      printf("%u shaders optimized to a different number of instructions\n",
+             num_different);
+   }
+
+   for (unsigned i = 0; i < num_shaders; i++)
+      ralloc_free(corpus[i]);
+   free(corpus);
+   free(automaton);
+   free(tree_walk);
+
+   glsl_type_singleton_decref();
+
+   return 0;
+}
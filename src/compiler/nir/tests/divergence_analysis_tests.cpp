@@ -0,0 +1,275 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_divergence_analysis_test : public ::testing::Test {
+protected:
+   nir_divergence_analysis_test();
+   ~nir_divergence_analysis_test();
+
+   /* Builds a loop counting from 0, which breaks when the counter equals
+    * \p limit, under an if on \p limit.  Returns the counter incremented in
+    * the loop, which is used after it.
+    */
+   nir_ssa_def *build_counting_loop(nir_ssa_def *limit);
+
+   void run_analysis();
+
+   void *mem_ctx;
+
+   nir_builder *b;
+};
+
+nir_divergence_analysis_test::nir_divergence_analysis_test()
+{
+   mem_ctx = ralloc_context(NULL);
+   static const nir_shader_compiler_options options = { };
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_COMPUTE, &options);
+}
+
+nir_divergence_analysis_test::~nir_divergence_analysis_test()
+{
+   if (HasFailure()) {
+      printf("\nShader from the failed test:\n\n");
+      nir_print_shader(b->shader, stdout);
+   }
+
+   ralloc_free(mem_ctx);
+}
+
+nir_ssa_def *
+nir_divergence_analysis_test::build_counting_loop(nir_ssa_def *limit)
+{
+   nir_block *preheader = nir_cursor_current_block(b->cursor);
+   nir_ssa_def *zero = nir_imm_int(b, 0);
+
+   nir_phi_instr *phi = nir_phi_instr_create(b->shader);
+   nir_ssa_dest_init(&phi->instr, &phi->dest, 1, 32, NULL);
+
+   nir_loop *loop = nir_push_loop(b);
+
+   nir_ssa_def *next = nir_iadd(b, &phi->dest.ssa, nir_imm_int(b, 1));
+
+   nir_if *nif = nir_push_if(b, nir_ieq(b, next, limit));
+   nir_jump(b, nir_jump_break);
+   nir_pop_if(b, nif);
+
+   nir_block *latch = nir_cursor_current_block(b->cursor);
+   nir_pop_loop(b, loop);
+
+   nir_phi_src *src = ralloc(phi, nir_phi_src);
+   src->pred = preheader;
+   src->src = nir_src_for_ssa(zero);
+   exec_list_push_tail(&phi->srcs, &src->node);
+
+   src = ralloc(phi, nir_phi_src);
+   src->pred = latch;
+   src->src = nir_src_for_ssa(next);
+   exec_list_push_tail(&phi->srcs, &src->node);
+
+   nir_instr_insert(nir_before_block(nir_loop_first_block(loop)), &phi->instr);
+
+   return next;
+}
+
+void
+nir_divergence_analysis_test::run_analysis()
+{
+   nir_index_ssa_defs(b->impl);
+   nir_validate_shader(b->shader, NULL);
+   nir_divergence_analysis(b->shader);
+}
+
+} // namespace
+
+TEST_F(nir_divergence_analysis_test, system_values)
+{
+   nir_ssa_def *index = nir_load_local_invocation_index(b);
+   nir_ssa_def *group = nir_channel(b, nir_load_work_group_id(b), 0);
+   nir_ssa_def *size = nir_load_subgroup_size(b);
+
+   nir_ssa_def *uniform = nir_iadd(b, group, size);
+   nir_ssa_def *divergent = nir_iadd(b, uniform, index);
+
+   run_analysis();
+
+   EXPECT_TRUE(index->divergent);
+   EXPECT_FALSE(group->divergent);
+   EXPECT_FALSE(uniform->divergent);
+   EXPECT_TRUE(divergent->divergent);
+}
+
+TEST_F(nir_divergence_analysis_test, valid_metadata)
+{
+   nir_ssa_def *group = nir_channel(b, nir_load_work_group_id(b), 0);
+
+   EXPECT_FALSE(nir_src_is_known_uniform(nir_src_for_ssa(group)));
+
+   nir_metadata_require(b->impl, nir_metadata_divergence);
+
+   EXPECT_TRUE(nir_src_is_known_uniform(nir_src_for_ssa(group)));
+   EXPECT_FALSE(nir_src_is_dynamically_uniform(nir_src_for_ssa(group)));
+
+   nir_metadata_preserve(b->impl, nir_metadata_none);
+
+   EXPECT_FALSE(nir_src_is_known_uniform(nir_src_for_ssa(group)));
+}
+
+TEST_F(nir_divergence_analysis_test, subgroup_ops)
+{
+   nir_ssa_def *index = nir_load_local_invocation_index(b);
+
+   nir_intrinsic_instr *first =
+      nir_intrinsic_instr_create(b->shader,
+                                 nir_intrinsic_read_first_invocation);
+   first->num_components = 1;
+   first->src[0] = nir_src_for_ssa(index);
+   nir_ssa_dest_init(&first->instr, &first->dest, 1, 32, NULL);
+   nir_builder_instr_insert(b, &first->instr);
+
+   nir_intrinsic_instr *read =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_read_invocation);
+   read->num_components = 1;
+   read->src[0] = nir_src_for_ssa(index);
+   read->src[1] = nir_src_for_ssa(index);
+   nir_ssa_dest_init(&read->instr, &read->dest, 1, 32, NULL);
+   nir_builder_instr_insert(b, &read->instr);
+
+   run_analysis();
+
+   EXPECT_FALSE(first->dest.ssa.divergent);
+   EXPECT_TRUE(read->dest.ssa.divergent);
+}
+
+TEST_F(nir_divergence_analysis_test, uniform_if_phi)
+{
+   nir_ssa_def *group = nir_channel(b, nir_load_work_group_id(b), 0);
+
+   nir_if *nif = nir_push_if(b, nir_ieq(b, group, nir_imm_int(b, 0)));
+   nir_ssa_def *then_def = nir_imm_int(b, 1);
+   nir_push_else(b, nif);
+   nir_ssa_def *else_def = nir_imm_int(b, 2);
+   nir_pop_if(b, nif);
+   nir_ssa_def *phi = nir_if_phi(b, then_def, else_def);
+
+   run_analysis();
+
+   EXPECT_FALSE(phi->divergent);
+}
+
+TEST_F(nir_divergence_analysis_test, divergent_if_phi)
+{
+   nir_ssa_def *index = nir_load_local_invocation_index(b);
+
+   nir_if *nif = nir_push_if(b, nir_ieq(b, index, nir_imm_int(b, 0)));
+   nir_ssa_def *then_def = nir_imm_int(b, 1);
+   nir_push_else(b, nif);
+   nir_ssa_def *else_def = nir_imm_int(b, 2);
+   nir_pop_if(b, nif);
+   nir_ssa_def *phi = nir_if_phi(b, then_def, else_def);
+
+   run_analysis();
+
+   EXPECT_FALSE(then_def->divergent);
+   EXPECT_FALSE(else_def->divergent);
+   EXPECT_TRUE(phi->divergent);
+}
+
+TEST_F(nir_divergence_analysis_test, uniform_break)
+{
+   nir_ssa_def *group = nir_channel(b, nir_load_work_group_id(b), 0);
+   nir_ssa_def *counter = build_counting_loop(group);
+   nir_ssa_def *after = nir_iadd(b, counter, counter);
+
+   run_analysis();
+
+   EXPECT_FALSE(counter->divergent);
+   EXPECT_FALSE(after->divergent);
+}
+
+TEST_F(nir_divergence_analysis_test, divergent_break)
+{
+   nir_ssa_def *index = nir_load_local_invocation_index(b);
+   nir_ssa_def *counter = build_counting_loop(index);
+   nir_ssa_def *after = nir_iadd(b, counter, counter);
+
+   run_analysis();
+
+   /* Invocations leave the loop with different counters. */
+   EXPECT_TRUE(counter->divergent);
+   EXPECT_TRUE(after->divergent);
+}
+
+TEST_F(nir_divergence_analysis_test, divergent_continue)
+{
+   nir_ssa_def *index = nir_load_local_invocation_index(b);
+   nir_ssa_def *group = nir_channel(b, nir_load_work_group_id(b), 0);
+
+   nir_block *preheader = nir_cursor_current_block(b->cursor);
+   nir_ssa_def *zero = nir_imm_int(b, 0);
+
+   nir_phi_instr *phi = nir_phi_instr_create(b->shader);
+   nir_ssa_dest_init(&phi->instr, &phi->dest, 1, 32, NULL);
+
+   nir_loop *loop = nir_push_loop(b);
+
+   nir_if *nif = nir_push_if(b, nir_ieq(b, &phi->dest.ssa, group));
+   nir_jump(b, nir_jump_break);
+   nir_pop_if(b, nif);
+
+   /* Some invocations go around with 1 added, the others with 2. */
+   nir_ssa_def *one = nir_iadd(b, &phi->dest.ssa, nir_imm_int(b, 1));
+   nif = nir_push_if(b, nir_ieq(b, index, nir_imm_int(b, 0)));
+   nir_block *continue_block = nir_cursor_current_block(b->cursor);
+   nir_jump(b, nir_jump_continue);
+   nir_pop_if(b, nif);
+   nir_ssa_def *two = nir_iadd(b, &phi->dest.ssa, nir_imm_int(b, 2));
+   nir_ssa_def *invariant = nir_iadd(b, group, nir_imm_int(b, 3));
+   nir_block *latch = nir_cursor_current_block(b->cursor);
+
+   nir_pop_loop(b, loop);
+
+   nir_block *preds[] = { preheader, continue_block, latch };
+   nir_ssa_def *defs[] = { zero, one, two };
+   for (unsigned i = 0; i < 3; i++) {
+      nir_phi_src *src = ralloc(phi, nir_phi_src);
+      src->pred = preds[i];
+      src->src = nir_src_for_ssa(defs[i]);
+      exec_list_push_tail(&phi->srcs, &src->node);
+   }
+   nir_instr_insert(nir_before_block(nir_loop_first_block(loop)), &phi->instr);
+
+   run_analysis();
+
+   /* The invocations left after the continue still agree. */
+   EXPECT_FALSE(invariant->divergent);
+   EXPECT_TRUE(phi->dest.ssa.divergent);
+   EXPECT_TRUE(two->divergent);
+}
@@ -0,0 +1,556 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_load_store_vectorize_test : public ::testing::Test {
+protected:
+   nir_load_store_vectorize_test();
+   ~nir_load_store_vectorize_test();
+
+   nir_intrinsic_instr *create_load(nir_intrinsic_op op, nir_ssa_def *resource,
+                                    nir_ssa_def *offset,
+                                    unsigned bit_size = 32,
+                                    unsigned num_components = 1,
+                                    unsigned access = 0);
+   nir_intrinsic_instr *create_store(nir_intrinsic_op op, nir_ssa_def *resource,
+                                     nir_ssa_def *offset, nir_ssa_def *value,
+                                     unsigned access = 0);
+   nir_intrinsic_instr *create_barrier(nir_intrinsic_op op);
+
+   nir_intrinsic_instr *load_ssbo(unsigned binding, uint32_t offset,
+                                  unsigned num_components = 1) {
+      return create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, binding),
+                         nir_imm_int(b, offset), 32, num_components);
+   }
+
+   nir_intrinsic_instr *store_ssbo(unsigned binding, uint32_t offset,
+                                   nir_ssa_def *value) {
+      return create_store(nir_intrinsic_store_ssbo, nir_imm_int(b, binding),
+                          nir_imm_int(b, offset), value);
+   }
+
+   /* Keeps a loaded value alive without touching memory. */
+   void use(nir_intrinsic_instr *load);
+
+   bool run_vectorizer(nir_variable_mode modes =
+                          (nir_variable_mode)(nir_var_mem_ubo |
+                                              nir_var_mem_ssbo |
+                                              nir_var_mem_shared |
+                                              nir_var_mem_global));
+
+   unsigned count_intrinsics(nir_intrinsic_op intrinsic);
+   nir_intrinsic_instr *get_intrinsic(nir_intrinsic_op intrinsic,
+                                      unsigned index);
+
+   static bool should_vectorize(unsigned align, unsigned bit_size,
+                                unsigned num_components, unsigned high_offset,
+                                nir_intrinsic_instr *low,
+                                nir_intrinsic_instr *high);
+
+   void *mem_ctx;
+
+   nir_builder *b;
+   unsigned num_outputs;
+};
+
+nir_load_store_vectorize_test::nir_load_store_vectorize_test()
+{
+   mem_ctx = ralloc_context(NULL);
+   static const nir_shader_compiler_options options = { };
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_COMPUTE, &options);
+   num_outputs = 0;
+}
+
+nir_load_store_vectorize_test::~nir_load_store_vectorize_test()
+{
+   if (HasFailure()) {
+      printf("\nShader from the failed test:\n\n");
+      nir_print_shader(b->shader, stdout);
+   }
+
+   ralloc_free(mem_ctx);
+}
+
+nir_intrinsic_instr *
+nir_load_store_vectorize_test::create_load(nir_intrinsic_op op,
+                                           nir_ssa_def *resource,
+                                           nir_ssa_def *offset,
+                                           unsigned bit_size,
+                                           unsigned num_components,
+                                           unsigned access)
+{
+   nir_intrinsic_instr *load = nir_intrinsic_instr_create(b->shader, op);
+   const nir_intrinsic_info *info = &nir_intrinsic_infos[op];
+   unsigned src = 0;
+
+   if (resource)
+      load->src[src++] = nir_src_for_ssa(resource);
+   load->src[src++] = nir_src_for_ssa(offset);
+   load->num_components = num_components;
+   if (info->index_map[NIR_INTRINSIC_ALIGN_MUL])
+      nir_intrinsic_set_align(load, bit_size / 8, 0);
+   if (info->index_map[NIR_INTRINSIC_ACCESS])
+      nir_intrinsic_set_access(load, (gl_access_qualifier)access);
+
+   nir_ssa_dest_init(&load->instr, &load->dest, num_components, bit_size,
+                     NULL);
+   nir_builder_instr_insert(b, &load->instr);
+   return load;
+}
+
+nir_intrinsic_instr *
+nir_load_store_vectorize_test::create_store(nir_intrinsic_op op,
+                                            nir_ssa_def *resource,
+                                            nir_ssa_def *offset,
+                                            nir_ssa_def *value,
+                                            unsigned access)
+{
+   nir_intrinsic_instr *store = nir_intrinsic_instr_create(b->shader, op);
+   const nir_intrinsic_info *info = &nir_intrinsic_infos[op];
+   unsigned src = 0;
+
+   store->src[src++] = nir_src_for_ssa(value);
+   if (resource)
+      store->src[src++] = nir_src_for_ssa(resource);
+   store->src[src++] = nir_src_for_ssa(offset);
+   store->num_components = value->num_components;
+   nir_intrinsic_set_write_mask(store, BITFIELD_MASK(value->num_components));
+   nir_intrinsic_set_align(store, value->bit_size / 8, 0);
+   if (info->index_map[NIR_INTRINSIC_ACCESS])
+      nir_intrinsic_set_access(store, (gl_access_qualifier)access);
+
+   nir_builder_instr_insert(b, &store->instr);
+   return store;
+}
+
+nir_intrinsic_instr *
+nir_load_store_vectorize_test::create_barrier(nir_intrinsic_op op)
+{
+   nir_intrinsic_instr *barrier = nir_intrinsic_instr_create(b->shader, op);
+   nir_builder_instr_insert(b, &barrier->instr);
+   return barrier;
+}
+
+void
+nir_load_store_vectorize_test::use(nir_intrinsic_instr *load)
+{
+   nir_intrinsic_instr *store =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_store_output);
+   store->src[0] = nir_src_for_ssa(&load->dest.ssa);
+   store->src[1] = nir_src_for_ssa(nir_imm_int(b, 0));
+   store->num_components = load->dest.ssa.num_components;
+   nir_intrinsic_set_base(store, num_outputs++);
+   nir_intrinsic_set_write_mask(store,
+                                BITFIELD_MASK(load->dest.ssa.num_components));
+   nir_builder_instr_insert(b, &store->instr);
+}
+
+bool
+nir_load_store_vectorize_test::should_vectorize(unsigned align,
+                                                unsigned bit_size,
+                                                unsigned num_components,
+                                                unsigned high_offset,
+                                                nir_intrinsic_instr *low,
+                                                nir_intrinsic_instr *high)
+{
+   return align >= bit_size / 8 && num_components <= 4;
+}
+
+bool
+nir_load_store_vectorize_test::run_vectorizer(nir_variable_mode modes)
+{
+   nir_validate_shader(b->shader, NULL);
+   bool progress = nir_opt_load_store_vectorize(b->shader, modes,
+                                                should_vectorize);
+   nir_validate_shader(b->shader, NULL);
+
+   if (progress) {
+      nir_opt_constant_folding(b->shader);
+      nir_copy_prop(b->shader);
+      nir_opt_dce(b->shader);
+      nir_validate_shader(b->shader, NULL);
+   }
+
+   return progress;
+}
+
+unsigned
+nir_load_store_vectorize_test::count_intrinsics(nir_intrinsic_op intrinsic)
+{
+   unsigned count = 0;
+   nir_foreach_block(block, b->impl) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type != nir_instr_type_intrinsic)
+            continue;
+         nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+         if (intrin->intrinsic == intrinsic)
+            count++;
+      }
+   }
+   return count;
+}
+
+nir_intrinsic_instr *
+nir_load_store_vectorize_test::get_intrinsic(nir_intrinsic_op intrinsic,
+                                             unsigned index)
+{
+   nir_foreach_block(block, b->impl) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type != nir_instr_type_intrinsic)
+            continue;
+         nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+         if (intrin->intrinsic == intrinsic) {
+            if (index == 0)
+               return intrin;
+            index--;
+         }
+      }
+   }
+   return NULL;
+}
+
+/* Returns the load (or store) a use() ends up reading the value of. */
+static nir_intrinsic_instr *
+get_source_intrinsic(nir_intrinsic_instr *output, unsigned *swizzle)
+{
+   nir_ssa_def *def = output->src[0].ssa;
+   *swizzle = 0;
+   while (def->parent_instr->type == nir_instr_type_alu) {
+      nir_alu_instr *alu = nir_instr_as_alu(def->parent_instr);
+      *swizzle = alu->src[0].swizzle[*swizzle];
+      def = alu->src[0].src.ssa;
+   }
+   return nir_instr_as_intrinsic(def->parent_instr);
+}
+
+} // namespace
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_adjacent)
+{
+   use(load_ssbo(0, 0));
+   use(load_ssbo(0, 4));
+
+   EXPECT_TRUE(run_vectorizer());
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 1);
+   nir_intrinsic_instr *load = get_intrinsic(nir_intrinsic_load_ssbo, 0);
+   EXPECT_EQ(load->dest.ssa.num_components, 2);
+   EXPECT_EQ(nir_src_as_uint(load->src[1]), 0);
+
+   for (unsigned i = 0; i < 2; i++) {
+      unsigned swizzle;
+      nir_intrinsic_instr *output = get_intrinsic(nir_intrinsic_store_output, i);
+      EXPECT_EQ(get_source_intrinsic(output, &swizzle), load);
+      EXPECT_EQ(swizzle, i);
+   }
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_adjacent_reversed)
+{
+   use(load_ssbo(0, 4));
+   use(load_ssbo(0, 0));
+
+   EXPECT_TRUE(run_vectorizer());
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 1);
+   nir_intrinsic_instr *load = get_intrinsic(nir_intrinsic_load_ssbo, 0);
+   EXPECT_EQ(load->dest.ssa.num_components, 2);
+
+   for (unsigned i = 0; i < 2; i++) {
+      unsigned swizzle;
+      nir_intrinsic_instr *output = get_intrinsic(nir_intrinsic_store_output, i);
+      EXPECT_EQ(get_source_intrinsic(output, &swizzle), load);
+      EXPECT_EQ(swizzle, 1 - i);
+   }
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_adjacent_indirect)
+{
+   nir_ssa_def *index = nir_load_local_invocation_index(b);
+   nir_ssa_def *offset = nir_imul(b, index, nir_imm_int(b, 16));
+
+   use(create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), offset));
+   use(create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0),
+                   nir_iadd(b, offset, nir_imm_int(b, 4))));
+   use(create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0),
+                   nir_iadd(b, nir_imm_int(b, 8), offset)));
+
+   EXPECT_TRUE(run_vectorizer());
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 1);
+   nir_intrinsic_instr *load = get_intrinsic(nir_intrinsic_load_ssbo, 0);
+   EXPECT_EQ(load->dest.ssa.num_components, 3);
+   EXPECT_EQ(load->src[1].ssa, offset);
+   EXPECT_EQ(nir_intrinsic_align(load), 16);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_intersecting)
+{
+   use(load_ssbo(0, 0, 2));
+   use(load_ssbo(0, 4, 2));
+
+   EXPECT_TRUE(run_vectorizer());
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 1);
+   nir_intrinsic_instr *load = get_intrinsic(nir_intrinsic_load_ssbo, 0);
+   EXPECT_EQ(load->dest.ssa.num_components, 3);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_gap)
+{
+   use(load_ssbo(0, 0));
+   use(load_ssbo(0, 8));
+
+   EXPECT_FALSE(run_vectorizer());
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_too_large)
+{
+   for (unsigned i = 0; i < 5; i++)
+      use(load_ssbo(0, i * 4));
+
+   EXPECT_TRUE(run_vectorizer());
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+   EXPECT_EQ(get_intrinsic(nir_intrinsic_load_ssbo, 0)->dest.ssa.num_components, 4);
+   EXPECT_EQ(get_intrinsic(nir_intrinsic_load_ssbo, 1)->dest.ssa.num_components, 1);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_different_resource)
+{
+   use(load_ssbo(0, 0));
+   use(load_ssbo(1, 4));
+
+   EXPECT_FALSE(run_vectorizer());
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_volatile)
+{
+   use(load_ssbo(0, 0));
+   use(create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0),
+                   nir_imm_int(b, 4), 32, 1, ACCESS_VOLATILE));
+
+   EXPECT_FALSE(run_vectorizer());
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_mode_disabled)
+{
+   use(load_ssbo(0, 0));
+   use(load_ssbo(0, 4));
+
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ubo));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_aliasing_store_between)
+{
+   use(load_ssbo(0, 0));
+   store_ssbo(0, 4, nir_imm_int(b, 0));
+   use(load_ssbo(0, 4));
+
+   EXPECT_FALSE(run_vectorizer());
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_disjoint_store_between)
+{
+   use(load_ssbo(0, 0));
+   store_ssbo(0, 8, nir_imm_int(b, 0));
+   use(load_ssbo(0, 4));
+
+   EXPECT_TRUE(run_vectorizer());
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 1);
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 1);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_other_resource_store_between)
+{
+   use(load_ssbo(0, 0));
+   store_ssbo(1, 4, nir_imm_int(b, 0));
+   use(load_ssbo(0, 4));
+
+   EXPECT_FALSE(run_vectorizer());
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_restrict_store_between)
+{
+   use(create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0),
+                   nir_imm_int(b, 0), 32, 1, ACCESS_RESTRICT));
+   create_store(nir_intrinsic_store_ssbo, nir_imm_int(b, 1),
+                nir_imm_int(b, 4), nir_imm_int(b, 0), ACCESS_RESTRICT);
+   use(create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0),
+                   nir_imm_int(b, 4), 32, 1, ACCESS_RESTRICT));
+
+   EXPECT_TRUE(run_vectorizer());
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 1);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_global_store_between)
+{
+   use(load_ssbo(0, 0));
+   create_store(nir_intrinsic_store_global, NULL,
+                nir_imm_int64(b, 0x1000), nir_imm_int(b, 0));
+   use(load_ssbo(0, 4));
+
+   EXPECT_FALSE(run_vectorizer());
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_barrier_between)
+{
+   use(load_ssbo(0, 0));
+   create_barrier(nir_intrinsic_memory_barrier_buffer);
+   use(load_ssbo(0, 4));
+
+   EXPECT_FALSE(run_vectorizer());
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_shared_barrier_between)
+{
+   use(load_ssbo(0, 0));
+   create_barrier(nir_intrinsic_memory_barrier_shared);
+   use(load_ssbo(0, 4));
+
+   EXPECT_TRUE(run_vectorizer());
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 1);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_different_blocks)
+{
+   use(load_ssbo(0, 0));
+   nir_pop_if(b, nir_push_if(b, nir_imm_true(b)));
+   use(load_ssbo(0, 4));
+
+   EXPECT_FALSE(run_vectorizer());
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ubo_load_store_between)
+{
+   use(create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0),
+                   nir_imm_int(b, 0)));
+   store_ssbo(0, 4, nir_imm_int(b, 0));
+   create_barrier(nir_intrinsic_memory_barrier_buffer);
+   use(create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0),
+                   nir_imm_int(b, 4)));
+
+   EXPECT_TRUE(run_vectorizer());
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ubo), 1);
+}
+
+TEST_F(nir_load_store_vectorize_test, shared_load_base)
+{
+   nir_intrinsic_instr *load =
+      create_load(nir_intrinsic_load_shared, NULL, nir_imm_int(b, 0));
+   nir_intrinsic_set_base(load, 4);
+   use(load);
+   use(create_load(nir_intrinsic_load_shared, NULL, nir_imm_int(b, 0)));
+
+   EXPECT_TRUE(run_vectorizer());
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_shared), 1);
+   load = get_intrinsic(nir_intrinsic_load_shared, 0);
+   EXPECT_EQ(load->dest.ssa.num_components, 2);
+   EXPECT_EQ(nir_src_as_int(load->src[0]) + nir_intrinsic_base(load), 0);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_store_adjacent)
+{
+   store_ssbo(0, 0, nir_imm_int(b, 10));
+   store_ssbo(0, 4, nir_imm_int(b, 20));
+
+   EXPECT_TRUE(run_vectorizer());
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 1);
+   nir_intrinsic_instr *store = get_intrinsic(nir_intrinsic_store_ssbo, 0);
+   EXPECT_EQ(nir_intrinsic_write_mask(store), 0x3);
+   EXPECT_EQ(nir_src_as_uint(store->src[2]), 0);
+   ASSERT_TRUE(nir_src_is_const(store->src[0]));
+   EXPECT_EQ(nir_src_comp_as_uint(store->src[0], 0), 10);
+   EXPECT_EQ(nir_src_comp_as_uint(store->src[0], 1), 20);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_store_overlapping)
+{
+   store_ssbo(0, 0, nir_imm_ivec2(b, 10, 20));
+   store_ssbo(0, 4, nir_imm_int(b, 30));
+
+   EXPECT_TRUE(run_vectorizer());
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 1);
+   nir_intrinsic_instr *store = get_intrinsic(nir_intrinsic_store_ssbo, 0);
+   EXPECT_EQ(nir_intrinsic_write_mask(store), 0x3);
+   ASSERT_TRUE(nir_src_is_const(store->src[0]));
+   EXPECT_EQ(nir_src_comp_as_uint(store->src[0], 0), 10);
+   EXPECT_EQ(nir_src_comp_as_uint(store->src[0], 1), 30);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_store_aliasing_load_between)
+{
+   store_ssbo(0, 0, nir_imm_int(b, 10));
+   use(load_ssbo(0, 0));
+   store_ssbo(0, 4, nir_imm_int(b, 20));
+
+   EXPECT_FALSE(run_vectorizer());
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_store_disjoint_load_between)
+{
+   store_ssbo(0, 0, nir_imm_int(b, 10));
+   use(load_ssbo(0, 8));
+   store_ssbo(0, 4, nir_imm_int(b, 20));
+
+   EXPECT_TRUE(run_vectorizer());
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 1);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_store_atomic_between)
+{
+   store_ssbo(0, 0, nir_imm_int(b, 10));
+
+   nir_intrinsic_instr *atomic =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_ssbo_atomic_add);
+   atomic->src[0] = nir_src_for_ssa(nir_imm_int(b, 0));
+   atomic->src[1] = nir_src_for_ssa(nir_imm_int(b, 0));
+   atomic->src[2] = nir_src_for_ssa(nir_imm_int(b, 1));
+   nir_ssa_dest_init(&atomic->instr, &atomic->dest, 1, 32, NULL);
+   nir_builder_instr_insert(b, &atomic->instr);
+
+   store_ssbo(0, 4, nir_imm_int(b, 20));
+
+   EXPECT_FALSE(run_vectorizer());
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 2);
+}
@@ -0,0 +1,412 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+/* The state of a "for (i = init; i < limit; i += step)" loop being built. */
+struct counted_loop {
+   nir_variable *counter;
+   nir_loop *loop;
+   nir_ssa_def *i;
+};
+
+class nir_loop_unroll_test : public ::testing::Test {
+protected:
+   nir_loop_unroll_test();
+   ~nir_loop_unroll_test();
+
+   nir_ssa_def *load_ubo(unsigned offset);
+   void store(nir_ssa_def *offset, nir_ssa_def *value);
+
+   counted_loop begin_loop(nir_ssa_def *init, nir_ssa_def *limit);
+   void end_loop(counted_loop *cl, nir_ssa_def *step);
+
+   /* Lowers the counters to SSA once the shader has been built. */
+   void finish();
+
+   nir_loop_info *analyze(nir_loop *loop);
+   void optimize();
+
+   unsigned count_intrinsics(nir_loop *loop, nir_intrinsic_op op);
+   unsigned count_alu(nir_loop *loop, nir_op op);
+   unsigned count_phis(nir_block *block);
+   unsigned count_ifs(nir_loop *loop);
+
+   void *mem_ctx;
+
+   nir_shader_compiler_options options;
+   nir_builder *b;
+};
+
+nir_loop_unroll_test::nir_loop_unroll_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   memset(&options, 0, sizeof(options));
+   options.max_unroll_iterations = 32;
+   options.max_partial_unroll_factor = 4;
+
+   mem_ctx = ralloc_context(NULL);
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_COMPUTE, &options);
+}
+
+nir_loop_unroll_test::~nir_loop_unroll_test()
+{
+   if (HasFailure()) {
+      printf("\nShader from the failed test:\n\n");
+      nir_print_shader(b->shader, stdout);
+   }
+
+   ralloc_free(mem_ctx);
+
+   glsl_type_singleton_decref();
+}
+
+nir_ssa_def *
+nir_loop_unroll_test::load_ubo(unsigned offset)
+{
+   nir_intrinsic_instr *load =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_load_ubo);
+   load->src[0] = nir_src_for_ssa(nir_imm_int(b, 0));
+   load->src[1] = nir_src_for_ssa(nir_imm_int(b, offset));
+   load->num_components = 1;
+   nir_intrinsic_set_align(load, 4, 0);
+   nir_ssa_dest_init(&load->instr, &load->dest, 1, 32, NULL);
+   nir_builder_instr_insert(b, &load->instr);
+   return &load->dest.ssa;
+}
+
+void
+nir_loop_unroll_test::store(nir_ssa_def *offset, nir_ssa_def *value)
+{
+   nir_intrinsic_instr *store =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_store_ssbo);
+   store->src[0] = nir_src_for_ssa(value);
+   store->src[1] = nir_src_for_ssa(nir_imm_int(b, 0));
+   store->src[2] = nir_src_for_ssa(offset);
+   store->num_components = value->num_components;
+   nir_intrinsic_set_write_mask(store, BITFIELD_MASK(value->num_components));
+   nir_intrinsic_set_align(store, 4, 0);
+   nir_builder_instr_insert(b, &store->instr);
+}
+
+counted_loop
+nir_loop_unroll_test::begin_loop(nir_ssa_def *init, nir_ssa_def *limit)
+{
+   counted_loop cl;
+
+   cl.counter = nir_local_variable_create(b->impl, glsl_int_type(), "i");
+   nir_store_var(b, cl.counter, init, 0x1);
+
+   cl.loop = nir_push_loop(b);
+   cl.i = nir_load_var(b, cl.counter);
+   nir_push_if(b, nir_ige(b, cl.i, limit));
+   nir_jump(b, nir_jump_break);
+   nir_pop_if(b, NULL);
+
+   return cl;
+}
+
+void
+nir_loop_unroll_test::end_loop(counted_loop *cl, nir_ssa_def *step)
+{
+   nir_store_var(b, cl->counter, nir_iadd(b, cl->i, step), 0x1);
+   nir_pop_loop(b, cl->loop);
+}
+
+void
+nir_loop_unroll_test::finish()
+{
+   NIR_PASS_V(b->shader, nir_lower_vars_to_ssa);
+   NIR_PASS_V(b->shader, nir_copy_prop);
+   NIR_PASS_V(b->shader, nir_opt_dce);
+}
+
+nir_loop_info *
+nir_loop_unroll_test::analyze(nir_loop *loop)
+{
+   nir_metadata_require(b->impl, nir_metadata_loop_analysis, nir_var_all);
+   return loop->info;
+}
+
+void
+nir_loop_unroll_test::optimize()
+{
+   bool progress;
+   do {
+      progress = false;
+      NIR_PASS(progress, b->shader, nir_copy_prop);
+      NIR_PASS(progress, b->shader, nir_opt_remove_phis);
+      NIR_PASS(progress, b->shader, nir_opt_algebraic);
+      NIR_PASS(progress, b->shader, nir_opt_constant_folding);
+      NIR_PASS(progress, b->shader, nir_opt_dce);
+   } while (progress);
+}
+
+unsigned
+nir_loop_unroll_test::count_intrinsics(nir_loop *loop, nir_intrinsic_op op)
+{
+   unsigned count = 0;
+   nir_foreach_block_in_cf_node(block, &loop->cf_node) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type == nir_instr_type_intrinsic &&
+             nir_instr_as_intrinsic(instr)->intrinsic == op)
+            count++;
+      }
+   }
+   return count;
+}
+
+unsigned
+nir_loop_unroll_test::count_alu(nir_loop *loop, nir_op op)
+{
+   unsigned count = 0;
+   nir_foreach_block_in_cf_node(block, &loop->cf_node) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type == nir_instr_type_alu &&
+             nir_instr_as_alu(instr)->op == op)
+            count++;
+      }
+   }
+   return count;
+}
+
+unsigned
+nir_loop_unroll_test::count_phis(nir_block *block)
+{
+   unsigned count = 0;
+   nir_foreach_instr(instr, block) {
+      if (instr->type == nir_instr_type_phi)
+         count++;
+   }
+   return count;
+}
+
+unsigned
+nir_loop_unroll_test::count_ifs(nir_loop *loop)
+{
+   unsigned count = 0;
+   foreach_list_typed(nir_cf_node, node, node, &loop->body) {
+      if (node->type == nir_cf_node_if)
+         count++;
+   }
+   return count;
+}
+
+} // namespace
+
+TEST_F(nir_loop_unroll_test, induction_var_with_invariant_init_and_step)
+{
+   nir_ssa_def *init = load_ubo(0);
+   nir_ssa_def *step = load_ubo(4);
+
+   counted_loop cl = begin_loop(init, nir_imm_int(b, 100));
+   store(cl.i, cl.i);
+   end_loop(&cl, step);
+   finish();
+
+   nir_loop_info *info = analyze(cl.loop);
+
+   ASSERT_EQ(info->num_induction_vars, 1);
+   nir_loop_induction_variable *iv = &info->induction_vars[0];
+   EXPECT_EQ(iv->def->parent_instr->type, nir_instr_type_phi);
+   EXPECT_EQ(iv->def->parent_instr->block, nir_loop_first_block(cl.loop));
+   EXPECT_EQ(iv->init, init);
+   EXPECT_EQ(iv->step, step);
+   EXPECT_EQ(iv->update->op, nir_op_iadd);
+
+   /* Without constants the trip count can't be computed. */
+   EXPECT_FALSE(info->exact_trip_count_known);
+}
+
+TEST_F(nir_loop_unroll_test, nested_induction_var)
+{
+   nir_ssa_def *step = load_ubo(0);
+
+   counted_loop outer = begin_loop(nir_imm_int(b, 0), nir_imm_int(b, 8));
+   counted_loop inner = begin_loop(outer.i, nir_imm_int(b, 64));
+   store(inner.i, inner.i);
+   end_loop(&inner, step);
+   end_loop(&outer, nir_imm_int(b, 1));
+   finish();
+
+   nir_loop_info *inner_info = analyze(inner.loop);
+   nir_loop_info *outer_info = outer.loop->info;
+
+   /* The inner counter starts from the outer one. */
+   ASSERT_EQ(inner_info->num_induction_vars, 1);
+   ASSERT_EQ(outer_info->num_induction_vars, 1);
+   EXPECT_EQ(inner_info->induction_vars[0].init,
+             outer_info->induction_vars[0].def);
+   EXPECT_EQ(inner_info->induction_vars[0].step, step);
+
+   EXPECT_TRUE(outer_info->exact_trip_count_known);
+   EXPECT_EQ(outer_info->max_trip_count, 8);
+}
+
+TEST_F(nir_loop_unroll_test, non_unit_stride_trip_count)
+{
+   counted_loop cl = begin_loop(nir_imm_int(b, 2), nir_imm_int(b, 30));
+   store(cl.i, cl.i);
+   end_loop(&cl, nir_imm_int(b, 4));
+   finish();
+
+   nir_loop_info *info = analyze(cl.loop);
+
+   /* 2, 6, 10, 14, 18, 22, 26 */
+   EXPECT_TRUE(info->exact_trip_count_known);
+   EXPECT_EQ(info->max_trip_count, 7);
+}
+
+TEST_F(nir_loop_unroll_test, force_unroll_array_access_needs_constant_step)
+{
+   nir_variable *arr =
+      nir_variable_create(b->shader, nir_var_mem_shared,
+                          glsl_array_type(glsl_int_type(), 16, 0), "arr");
+
+   /* Unrolling turns the indirect accesses into direct ones... */
+   counted_loop cl = begin_loop(nir_imm_int(b, 0), nir_imm_int(b, 16));
+   nir_store_deref(b, nir_build_deref_array(b, nir_build_deref_var(b, arr),
+                                            cl.i), cl.i, 0x1);
+   end_loop(&cl, nir_imm_int(b, 1));
+
+   /* ...but not without a constant step. */
+   nir_ssa_def *step = load_ubo(0);
+   counted_loop cl2 = begin_loop(nir_imm_int(b, 0), nir_imm_int(b, 16));
+   nir_store_deref(b, nir_build_deref_array(b, nir_build_deref_var(b, arr),
+                                            cl2.i), cl2.i, 0x1);
+   end_loop(&cl2, step);
+   finish();
+
+   EXPECT_TRUE(analyze(cl.loop)->force_unroll);
+   EXPECT_FALSE(analyze(cl2.loop)->force_unroll);
+   EXPECT_EQ(analyze(cl2.loop)->num_induction_vars, 1);
+}
+
+TEST_F(nir_loop_unroll_test, partial_unroll_by_factor)
+{
+   nir_ssa_def *base = load_ubo(0);
+
+   counted_loop cl = begin_loop(nir_imm_int(b, 0), nir_imm_int(b, 64));
+   store(nir_iadd(b, nir_ishl(b, cl.i, nir_imm_int(b, 2)), base), cl.i);
+   end_loop(&cl, nir_imm_int(b, 1));
+   finish();
+
+   /* Too many iterations to unroll completely. */
+   EXPECT_TRUE(nir_opt_loop_unroll(b->shader, nir_var_all));
+   nir_validate_shader(b->shader, "after nir_opt_loop_unroll");
+
+   EXPECT_TRUE(cl.loop->partially_unrolled);
+   EXPECT_EQ(count_intrinsics(cl.loop, nir_intrinsic_store_ssbo), 4);
+   EXPECT_EQ(count_ifs(cl.loop), 1);
+
+   /* The counter is now stepped by 4 on each iteration. */
+   optimize();
+   nir_loop_info *info = analyze(cl.loop);
+   EXPECT_TRUE(info->exact_trip_count_known);
+   EXPECT_EQ(info->max_trip_count, 16);
+
+   EXPECT_FALSE(nir_opt_loop_unroll(b->shader, nir_var_all));
+}
+
+TEST_F(nir_loop_unroll_test, no_partial_unroll_without_dividing_factor)
+{
+   counted_loop cl = begin_loop(nir_imm_int(b, 0), nir_imm_int(b, 67));
+   store(cl.i, cl.i);
+   end_loop(&cl, nir_imm_int(b, 1));
+   finish();
+
+   EXPECT_FALSE(nir_opt_loop_unroll(b->shader, nir_var_all));
+   EXPECT_EQ(count_intrinsics(cl.loop, nir_intrinsic_store_ssbo), 1);
+}
+
+TEST_F(nir_loop_unroll_test, strength_reduce_address)
+{
+   nir_ssa_def *base = load_ubo(0);
+   nir_ssa_def *stride = load_ubo(4);
+
+   counted_loop cl = begin_loop(nir_imm_int(b, 0), nir_imm_int(b, 1000));
+   store(nir_iadd(b, nir_imul(b, cl.i, stride), base), cl.i);
+   store(nir_ishl(b, cl.i, nir_imm_int(b, 4)), cl.i);
+   end_loop(&cl, nir_imm_int(b, 3));
+   finish();
+
+   EXPECT_TRUE(nir_opt_loop_strength_reduce(b->shader, nir_var_all));
+   nir_validate_shader(b->shader, "after nir_opt_loop_strength_reduce");
+
+   /* Both addresses got an induction variable of their own. */
+   EXPECT_EQ(count_alu(cl.loop, nir_op_imul), 0);
+   EXPECT_EQ(count_alu(cl.loop, nir_op_ishl), 0);
+   EXPECT_EQ(count_phis(nir_loop_first_block(cl.loop)), 3);
+
+   /* Which are still strength reduced induction variables. */
+   nir_loop_info *info = analyze(cl.loop);
+   EXPECT_EQ(info->num_induction_vars, 3);
+   EXPECT_FALSE(nir_opt_loop_strength_reduce(b->shader, nir_var_all));
+}
+
+TEST_F(nir_loop_unroll_test, strength_reduce_vector_offset)
+{
+   nir_ssa_def *offset = nir_imm_ivec2(b, 16, 32);
+
+   counted_loop cl = begin_loop(nir_imm_int(b, 0), nir_imm_int(b, 1000));
+   nir_ssa_def *addr = nir_imul(b, cl.i, nir_imm_int(b, 12));
+   static const unsigned xx[] = { 0, 0 };
+   nir_ssa_def *addrs = nir_iadd(b, nir_swizzle(b, addr, xx, 2), offset);
+   store(nir_channel(b, addrs, 0), nir_channel(b, addrs, 1));
+   end_loop(&cl, nir_imm_int(b, 1));
+   finish();
+
+   EXPECT_TRUE(nir_opt_loop_strength_reduce(b->shader, nir_var_all));
+   nir_validate_shader(b->shader, "after nir_opt_loop_strength_reduce");
+
+   /* Only the multiplication is reduced, the vector addition stays. */
+   EXPECT_EQ(count_alu(cl.loop, nir_op_imul), 0);
+   EXPECT_EQ(count_alu(cl.loop, nir_op_iadd), 3);
+   EXPECT_EQ(count_phis(nir_loop_first_block(cl.loop)), 2);
+}
+
+TEST_F(nir_loop_unroll_test, strength_reduce_nested_loop)
+{
+   nir_ssa_def *step = load_ubo(0);
+
+   counted_loop outer = begin_loop(nir_imm_int(b, 0), nir_imm_int(b, 8));
+   counted_loop inner = begin_loop(outer.i, nir_imm_int(b, 64));
+   store(nir_imul(b, inner.i, nir_imm_int(b, 12)), inner.i);
+   end_loop(&inner, step);
+   end_loop(&outer, nir_imm_int(b, 1));
+   finish();
+
+   EXPECT_TRUE(nir_opt_loop_strength_reduce(b->shader, nir_var_all));
+   nir_validate_shader(b->shader, "after nir_opt_loop_strength_reduce");
+
+   EXPECT_EQ(count_alu(inner.loop, nir_op_imul), 0);
+   EXPECT_EQ(count_phis(nir_loop_first_block(inner.loop)), 2);
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_pass_manager_test : public ::testing::Test {
+protected:
+   nir_pass_manager_test();
+   ~nir_pass_manager_test();
+
+   nir_pass_record *record(const char *name);
+
+   void *mem_ctx;
+
+   nir_builder *b;
+   nir_pass_manager pm;
+};
+
+static const nir_shader_compiler_options options = { };
+
+nir_pass_manager_test::nir_pass_manager_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   mem_ctx = ralloc_context(NULL);
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_COMPUTE, &options);
+
+   nir_pass_manager_init(&pm);
+}
+
+nir_pass_manager_test::~nir_pass_manager_test()
+{
+   if (HasFailure()) {
+      printf("\nShader from the failed test:\n\n");
+      nir_print_shader(b->shader, stdout);
+   }
+
+   nir_pass_manager_finish(&pm);
+
+   ralloc_free(mem_ctx);
+
+   glsl_type_singleton_decref();
+}
+
+nir_pass_record *
+nir_pass_manager_test::record(const char *name)
+{
+   hash_table_foreach(pm.records, entry) {
+      nir_pass_record *record = (nir_pass_record *) entry->data;
+      if (strcmp(record->name, name) == 0)
+         return record;
+   }
+   return NULL;
+}
+
+/* Makes progress until shader->info.num_textures gets to 0. */
+static bool
+count_down(nir_shader *shader)
+{
+   if (shader->info.num_textures == 0)
+      return false;
+
+   shader->info.num_textures--;
+   nir_metadata_preserve(nir_shader_get_entrypoint(shader), nir_metadata_none);
+   return true;
+}
+
+static bool
+never_progress(nir_shader *shader)
+{
+   return false;
+}
+
+} // namespace
+
+TEST_F(nir_pass_manager_test, skip_until_change)
+{
+   b->shader->info.num_textures = 3;
+
+   bool progress;
+   unsigned iterations = 0;
+   do {
+      progress = false;
+      NIR_LOOP_PASS(progress, &pm, b->shader, count_down);
+      NIR_LOOP_PASS(progress, &pm, b->shader, never_progress);
+      iterations++;
+   } while (progress);
+
+   EXPECT_EQ(iterations, 4u);
+   EXPECT_EQ(b->shader->info.num_textures, 0u);
+
+   /* Nothing changed between the third and the fourth run of
+    * never_progress.
+    */
+   EXPECT_EQ(record("count_down")->runs, 4u);
+   EXPECT_EQ(record("count_down")->progress, 3u);
+   EXPECT_EQ(record("never_progress")->runs, 3u);
+   EXPECT_EQ(record("never_progress")->skips, 1u);
+}
+
+TEST_F(nir_pass_manager_test, rerun_after_later_change)
+{
+   b->shader->info.num_textures = 1;
+
+   bool progress;
+   do {
+      progress = false;
+      NIR_LOOP_PASS(progress, &pm, b->shader, never_progress);
+      NIR_LOOP_PASS(progress, &pm, b->shader, count_down);
+   } while (progress);
+
+   /* count_down changed the shader after never_progress ran. */
+   EXPECT_EQ(record("never_progress")->runs, 2u);
+   EXPECT_EQ(record("never_progress")->skips, 0u);
+   EXPECT_EQ(record("count_down")->runs, 2u);
+}
+
+TEST_F(nir_pass_manager_test, call_sites_are_separate)
+{
+   b->shader->info.num_textures = 2;
+
+   bool progress;
+   do {
+      progress = false;
+      NIR_LOOP_PASS(progress, &pm, b->shader, count_down);
+      NIR_LOOP_PASS_V(&pm, b->shader, count_down);
+   } while (progress);
+
+   /* Each call site of the same pass has its own record. */
+   EXPECT_EQ(b->shader->info.num_textures, 0u);
+   EXPECT_EQ(_mesa_hash_table_num_entries(pm.records), 2u);
+}
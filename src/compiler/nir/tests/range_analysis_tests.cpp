@@ -0,0 +1,182 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "nir_range_analysis.h"
+#include "util/hash_table.h"
+
+namespace {
+
+class nir_range_analysis_test : public ::testing::Test {
+protected:
+   nir_range_analysis_test();
+   ~nir_range_analysis_test();
+
+   /* Analyzes \p def as a float or an integer source. */
+   struct ssa_result_range float_range(nir_ssa_def *def);
+   struct ssa_result_range int_range(nir_ssa_def *def);
+
+   nir_ssa_def *input(unsigned i);
+
+   void *mem_ctx;
+   struct hash_table *range_ht;
+
+   nir_builder *b;
+};
+
+nir_range_analysis_test::nir_range_analysis_test()
+{
+   mem_ctx = ralloc_context(NULL);
+   static const nir_shader_compiler_options options = { };
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_COMPUTE, &options);
+   range_ht = _mesa_pointer_hash_table_create(mem_ctx);
+}
+
+nir_range_analysis_test::~nir_range_analysis_test()
+{
+   ralloc_free(mem_ctx);
+}
+
+nir_ssa_def *
+nir_range_analysis_test::input(unsigned i)
+{
+   nir_intrinsic_instr *load =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_load_uniform);
+   load->num_components = 1;
+   load->src[0] = nir_src_for_ssa(nir_imm_int(b, 0));
+   nir_intrinsic_set_base(load, i * 4);
+   nir_ssa_dest_init(&load->instr, &load->dest, 1, 32, NULL);
+   nir_builder_instr_insert(b, &load->instr);
+   return &load->dest.ssa;
+}
+
+struct ssa_result_range
+nir_range_analysis_test::float_range(nir_ssa_def *def)
+{
+   nir_ssa_def *use = nir_fneg(b, def);
+   return nir_analyze_range(range_ht,
+                            nir_instr_as_alu(use->parent_instr), 0);
+}
+
+struct ssa_result_range
+nir_range_analysis_test::int_range(nir_ssa_def *def)
+{
+   nir_ssa_def *use = nir_ineg(b, def);
+   return nir_analyze_range(range_ht,
+                            nir_instr_as_alu(use->parent_instr), 0);
+}
+
+} // namespace
+
+TEST_F(nir_range_analysis_test, constants)
+{
+   EXPECT_EQ(gt_zero, float_range(nir_imm_float(b, 2.5f)).range);
+   EXPECT_EQ(lt_zero, float_range(nir_imm_float(b, -1.0f)).range);
+   EXPECT_EQ(eq_zero, float_range(nir_imm_float(b, 0.0f)).range);
+   EXPECT_EQ(lt_zero, int_range(nir_imm_int(b, -7)).range);
+
+   EXPECT_TRUE(float_range(nir_imm_float(b, 3.0f)).is_integral);
+   EXPECT_FALSE(float_range(nir_imm_float(b, 0.5f)).is_integral);
+
+   nir_ssa_def *vec = nir_imm_vec2(b, 1.0f, 0.0f);
+   EXPECT_EQ(ge_zero, float_range(vec).range);
+   EXPECT_EQ(gt_zero, float_range(nir_channel(b, vec, 0)).range);
+}
+
+TEST_F(nir_range_analysis_test, unary)
+{
+   nir_ssa_def *x = input(0);
+
+   EXPECT_EQ(unknown, float_range(x).range);
+   EXPECT_EQ(ge_zero, float_range(nir_fabs(b, x)).range);
+   EXPECT_EQ(le_zero, float_range(nir_fneg(b, nir_fabs(b, x))).range);
+   EXPECT_EQ(ge_zero, float_range(nir_fsat(b, x)).range);
+   EXPECT_EQ(ge_zero, float_range(nir_fsqrt(b, x)).range);
+   EXPECT_EQ(eq_zero, float_range(nir_fsat(b, nir_fneg(b, nir_fabs(b, x)))).range);
+
+   struct ssa_result_range r = float_range(nir_b2f32(b, nir_ieq(b, x, x)));
+   EXPECT_EQ(ge_zero, r.range);
+   EXPECT_TRUE(r.is_integral);
+
+   EXPECT_TRUE(float_range(nir_ffloor(b, x)).is_integral);
+   EXPECT_TRUE(float_range(nir_i2f32(b, x)).is_integral);
+   EXPECT_EQ(ge_zero, float_range(nir_u2f32(b, x)).range);
+}
+
+TEST_F(nir_range_analysis_test, binary)
+{
+   nir_ssa_def *x = input(0);
+   nir_ssa_def *y = input(1);
+   nir_ssa_def *pos = nir_fadd(b, nir_fabs(b, x), nir_imm_float(b, 1.0f));
+
+   EXPECT_EQ(gt_zero, float_range(pos).range);
+   EXPECT_EQ(unknown, float_range(nir_fadd(b, pos, nir_fneg(b, pos))).range);
+   EXPECT_EQ(ge_zero, float_range(nir_fmul(b, x, x)).range);
+   EXPECT_EQ(unknown, float_range(nir_fmul(b, x, y)).range);
+   EXPECT_EQ(le_zero, float_range(nir_fmul(b, pos, nir_fneg(b, pos))).range);
+   EXPECT_EQ(gt_zero, float_range(nir_fmax(b, x, pos)).range);
+   EXPECT_EQ(le_zero, float_range(nir_fmin(b, x, nir_imm_float(b, 0.0f))).range);
+   EXPECT_EQ(ge_zero, float_range(nir_bcsel(b, nir_ieq(b, x, y), pos,
+                                            nir_imm_float(b, 0.0f))).range);
+
+   EXPECT_EQ(ge_zero, int_range(nir_iand(b, x, nir_imm_int(b, 0xff))).range);
+   EXPECT_EQ(ge_zero, int_range(nir_ushr(b, x, nir_imm_int(b, 1))).range);
+   EXPECT_EQ(unknown, int_range(nir_ushr(b, x, nir_imm_int(b, 32))).range);
+   EXPECT_EQ(gt_zero, int_range(nir_imax(b, x, nir_imm_int(b, 1))).range);
+}
+
+TEST_F(nir_range_analysis_test, algebraic)
+{
+   nir_ssa_def *x = input(0);
+   nir_ssa_def *cond = nir_ieq(b, x, nir_imm_int(b, 0));
+
+   nir_ssa_def *abs = nir_fabs(b, nir_b2f32(b, cond));
+   nir_ssa_def *floor = nir_ffloor(b, nir_i2f32(b, x));
+
+   nir_intrinsic_instr *store =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_store_ssbo);
+   store->num_components = 2;
+   store->src[0] = nir_src_for_ssa(nir_vec2(b, abs, floor));
+   store->src[1] = nir_src_for_ssa(nir_imm_int(b, 0));
+   store->src[2] = nir_src_for_ssa(nir_imm_int(b, 0));
+   nir_intrinsic_set_write_mask(store, 0x3);
+   nir_builder_instr_insert(b, &store->instr);
+
+   ASSERT_TRUE(nir_opt_algebraic(b->shader));
+   nir_opt_dce(b->shader);
+
+   nir_foreach_block(block, b->impl) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type != nir_instr_type_alu)
+            continue;
+
+         nir_op op = nir_instr_as_alu(instr)->op;
+         EXPECT_NE(op, nir_op_fabs);
+         EXPECT_NE(op, nir_op_ffloor);
+      }
+   }
+}
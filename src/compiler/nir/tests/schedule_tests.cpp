@@ -0,0 +1,236 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_schedule_test : public ::testing::Test {
+protected:
+   nir_schedule_test();
+   ~nir_schedule_test();
+
+   nir_ssa_def *load(nir_intrinsic_op op, unsigned offset);
+   nir_intrinsic_instr *store(unsigned offset, nir_ssa_def *value);
+
+   /* Position of the instruction in its block. */
+   unsigned position(nir_instr *instr);
+
+   /* Largest number of components of values live at once in the block. */
+   unsigned max_live(nir_block *block);
+
+   bool schedule(unsigned threshold);
+
+   void *mem_ctx;
+
+   nir_builder *b;
+};
+
+static const nir_shader_compiler_options options = { };
+
+nir_schedule_test::nir_schedule_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   mem_ctx = ralloc_context(NULL);
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_COMPUTE, &options);
+}
+
+nir_schedule_test::~nir_schedule_test()
+{
+   if (HasFailure()) {
+      printf("\nShader from the failed test:\n\n");
+      nir_print_shader(b->shader, stdout);
+   }
+
+   ralloc_free(mem_ctx);
+
+   glsl_type_singleton_decref();
+}
+
+nir_ssa_def *
+nir_schedule_test::load(nir_intrinsic_op op, unsigned offset)
+{
+   nir_intrinsic_instr *load = nir_intrinsic_instr_create(b->shader, op);
+   load->src[0] = nir_src_for_ssa(nir_imm_int(b, 0));
+   load->src[1] = nir_src_for_ssa(nir_imm_int(b, offset));
+   load->num_components = 4;
+   nir_intrinsic_set_align(load, 4, 0);
+   nir_ssa_dest_init(&load->instr, &load->dest, 4, 32, NULL);
+   nir_builder_instr_insert(b, &load->instr);
+   return &load->dest.ssa;
+}
+
+nir_intrinsic_instr *
+nir_schedule_test::store(unsigned offset, nir_ssa_def *value)
+{
+   nir_intrinsic_instr *store =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_store_ssbo);
+   store->src[0] = nir_src_for_ssa(value);
+   store->src[1] = nir_src_for_ssa(nir_imm_int(b, 0));
+   store->src[2] = nir_src_for_ssa(nir_imm_int(b, offset));
+   store->num_components = value->num_components;
+   nir_intrinsic_set_write_mask(store, BITFIELD_MASK(value->num_components));
+   nir_intrinsic_set_align(store, 4, 0);
+   nir_builder_instr_insert(b, &store->instr);
+   return store;
+}
+
+unsigned
+nir_schedule_test::position(nir_instr *instr)
+{
+   unsigned pos = 0;
+   nir_foreach_instr(other, instr->block) {
+      if (other == instr)
+         return pos;
+      pos++;
+   }
+   return ~0u;
+}
+
+static bool
+is_counted(nir_ssa_def *def)
+{
+   /* Constants are left out, backends usually fold them. */
+   return def->parent_instr->type != nir_instr_type_load_const;
+}
+
+unsigned
+nir_schedule_test::max_live(nir_block *block)
+{
+   unsigned live = 0, max = 0;
+
+   nir_foreach_instr(instr, block) {
+      if (instr->type == nir_instr_type_alu) {
+         nir_alu_instr *alu = nir_instr_as_alu(instr);
+         for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++) {
+            nir_ssa_def *def = alu->src[i].src.ssa;
+            if (!is_counted(def))
+               continue;
+
+            /* Free the sources this is the last use of. */
+            bool used_later = false;
+            nir_foreach_use(use, def) {
+               if (use->parent_instr->block != block ||
+                   position(use->parent_instr) > position(instr))
+                  used_later = true;
+            }
+            if (!used_later)
+               live -= def->num_components;
+         }
+
+         live += alu->dest.dest.ssa.num_components;
+      } else if (instr->type == nir_instr_type_intrinsic) {
+         nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+         if (nir_intrinsic_infos[intrin->intrinsic].has_dest)
+            live += intrin->dest.ssa.num_components;
+      }
+
+      max = MAX2(max, live);
+   }
+
+   return max;
+}
+
+bool
+nir_schedule_test::schedule(unsigned threshold)
+{
+   nir_schedule_options schedule_options = { };
+   schedule_options.threshold = threshold;
+
+   bool progress = nir_schedule(b->shader, &schedule_options);
+   nir_validate_shader(b->shader, "after nir_schedule");
+   return progress;
+}
+
+} // namespace
+
+TEST_F(nir_schedule_test, load_before_independent_alu)
+{
+   nir_ssa_def *a = load(nir_intrinsic_load_ubo, 0);
+   nir_ssa_def *x = nir_fmul(b, a, a);
+   x = nir_fadd(b, x, a);
+   x = nir_fmul(b, x, x);
+   x = nir_fadd(b, x, a);
+   nir_ssa_def *c = load(nir_intrinsic_load_ubo, 16);
+   store(0, nir_fadd(b, x, c));
+
+   nir_instr *first_alu = x->parent_instr;
+   nir_foreach_instr(instr, nir_start_block(b->impl)) {
+      if (instr->type == nir_instr_type_alu) {
+         first_alu = instr;
+         break;
+      }
+   }
+
+   EXPECT_TRUE(schedule(0));
+
+   /* The second load is issued before the chain of ALU that doesn't
+    * depend on it, so its latency is hidden.
+    */
+   EXPECT_LT(position(c->parent_instr), position(first_alu));
+   EXPECT_LT(position(a->parent_instr), position(c->parent_instr));
+}
+
+TEST_F(nir_schedule_test, load_not_moved_above_store)
+{
+   nir_ssa_def *a = load(nir_intrinsic_load_ubo, 0);
+   nir_intrinsic_instr *st = store(0, a);
+   nir_ssa_def *x = nir_fmul(b, a, a);
+   x = nir_fadd(b, x, a);
+   x = nir_fmul(b, x, x);
+   nir_ssa_def *c = load(nir_intrinsic_load_ssbo, 0);
+   store(16, nir_fadd(b, x, c));
+
+   schedule(0);
+
+   EXPECT_LT(position(&st->instr), position(c->parent_instr));
+}
+
+TEST_F(nir_schedule_test, pressure_threshold)
+{
+   /* Sum of 8 vec4 loads, each one loaded right before being added. */
+   nir_ssa_def *sum = load(nir_intrinsic_load_ubo, 0);
+   for (unsigned i = 1; i < 8; i++)
+      sum = nir_fadd(b, sum, load(nir_intrinsic_load_ubo, i * 16));
+   store(0, sum);
+
+   nir_shader *clone = nir_shader_clone(mem_ctx, b->shader);
+
+   /* Without a threshold, all the loads get hoisted to the top. */
+   EXPECT_TRUE(schedule(0));
+   unsigned latency_max_live = max_live(nir_start_block(b->impl));
+   EXPECT_EQ(latency_max_live, 32u);
+
+   b->shader = clone;
+   b->impl = nir_shader_get_entrypoint(clone);
+
+   schedule(12);
+   unsigned pressure_max_live = max_live(nir_start_block(b->impl));
+   EXPECT_LE(pressure_max_live, 16u);
+}
@@ -0,0 +1,319 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Measures the size of serialized NIR and the throughput of nir_serialize
+ * and nir_deserialize.
+ *
+ * The corpus is made of generated fragment shaders looking like what the
+ * state tracker stores in the shader cache: not yet scalarized, with the
+ * inputs, uniforms and textures still accessed through derefs, and a bit of
+ * control flow.  Every shader is serialized and deserialized a few times,
+ * and the fastest time of each is kept.
+ *
+ *    serialize_bench [number of shaders] [instructions per shader]
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "nir_serialize.h"
+#include "util/os_time.h"
+#include "util/rand_xor.h"
+
+#define NUM_RUNS 5
+
+static const nir_shader_compiler_options options = {
+   .lower_sub = true,
+   .lower_fdiv = true,
+};
+
+static uint64_t seed[2];
+
+static unsigned
+rand_below(unsigned n)
+{
+   return rand_xorshift128plus(seed) % n;
+}
+
+/* Recently computed values are used a lot more than older ones. */
+static nir_ssa_def *
+pick(nir_ssa_def **values, unsigned num_values)
+{
+   unsigned distance = rand_below(4) == 0 ? rand_below(num_values) :
+                                            rand_below(MIN2(num_values, 4));
+   return values[num_values - 1 - distance];
+}
+
+static nir_ssa_def *
+rand_op(nir_builder *b, nir_ssa_def **values, unsigned num_values)
+{
+   nir_ssa_def *x = pick(values, num_values);
+   nir_ssa_def *y = pick(values, num_values);
+
+   switch (rand_below(12)) {
+   case 0: case 1: case 2:
+      return nir_fmul(b, x, y);
+   case 3: case 4:
+      return nir_fadd(b, x, y);
+   case 5:
+      return nir_ffma(b, x, y, pick(values, num_values));
+   case 6:
+      return nir_fneg(b, x);
+   case 7:
+      return nir_fmax(b, nir_fabs(b, x), y);
+   case 8:
+      return nir_vec4(b, nir_channel(b, x, 1), nir_channel(b, y, 0),
+                         nir_channel(b, x, 3), nir_channel(b, y, 2));
+   case 9:
+      return nir_fmul(b, x, nir_imm_vec4(b, 0.5f, 1.0f, 2.0f, 4.0f));
+   case 10:
+      return nir_bcsel(b, nir_flt(b, x, y), x, y);
+   default: {
+      nir_ssa_def *d = nir_fdot4(b, x, y);
+      return nir_vec4(b, d, d, d, d);
+   }
+   }
+}
+
+static nir_ssa_def *
+rand_uniform_load(nir_builder *b, nir_variable *ubo_array,
+                  nir_ssa_def **values, unsigned num_values)
+{
+   nir_deref_instr *deref = nir_build_deref_var(b, ubo_array);
+   nir_ssa_def *x = nir_channel(b, pick(values, num_values), 0);
+   nir_ssa_def *index = nir_iand(b, nir_f2i32(b, x), nir_imm_int(b, 15));
+   return nir_load_deref(b, nir_build_deref_array(b, deref, index));
+}
+
+static nir_ssa_def *
+rand_texture(nir_builder *b, nir_variable *sampler,
+             nir_ssa_def **values, unsigned num_values)
+{
+   nir_deref_instr *deref = nir_build_deref_var(b, sampler);
+   nir_tex_instr *tex = nir_tex_instr_create(b->shader, 3);
+
+   tex->op = nir_texop_tex;
+   tex->sampler_dim = GLSL_SAMPLER_DIM_2D;
+   tex->dest_type = nir_type_float;
+   tex->coord_components = 2;
+   tex->src[0].src_type = nir_tex_src_coord;
+   tex->src[0].src =
+      nir_src_for_ssa(nir_channels(b, pick(values, num_values), 0x3));
+   tex->src[1].src_type = nir_tex_src_texture_deref;
+   tex->src[1].src = nir_src_for_ssa(&deref->dest.ssa);
+   tex->src[2].src_type = nir_tex_src_sampler_deref;
+   tex->src[2].src = nir_src_for_ssa(&deref->dest.ssa);
+
+   nir_ssa_dest_init(&tex->instr, &tex->dest, 4, 32, NULL);
+   nir_builder_instr_insert(b, &tex->instr);
+
+   return &tex->dest.ssa;
+}
+
+static nir_shader *
+generate_shader(unsigned num_instrs)
+{
+   nir_builder b;
+   nir_builder_init_simple_shader(&b, NULL, MESA_SHADER_FRAGMENT, &options);
+
+   const struct glsl_type *vec4 = glsl_vec4_type();
+   nir_ssa_def **values = ralloc_array(b.shader, nir_ssa_def *, num_instrs + 4);
+   unsigned num_values = 0;
+
+   for (unsigned i = 0; i < 4; i++) {
+      nir_variable *in = nir_variable_create(b.shader, nir_var_shader_in,
+                                             vec4, "in");
+      in->data.location = VARYING_SLOT_VAR0 + i;
+      values[num_values++] = nir_load_var(&b, in);
+   }
+
+   nir_variable *ubo_array =
+      nir_variable_create(b.shader, nir_var_uniform,
+                          glsl_array_type(vec4, 16, 0), "constants");
+   nir_variable *sampler =
+      nir_variable_create(b.shader, nir_var_uniform,
+                          glsl_sampler_type(GLSL_SAMPLER_DIM_2D, false, false,
+                                            GLSL_TYPE_FLOAT), "tex");
+   nir_variable *out = nir_variable_create(b.shader, nir_var_shader_out,
+                                           vec4, "color");
+   out->data.location = FRAG_RESULT_DATA0;
+
+   while (num_values < num_instrs + 4) {
+      nir_ssa_def *value;
+
+      switch (rand_below(48)) {
+      case 0: {
+         nir_ssa_def *x = nir_channel(&b, pick(values, num_values), 0);
+         nir_ssa_def *cond = nir_flt(&b, x, nir_imm_float(&b, 0.5f));
+         nir_if *nif = nir_push_if(&b, cond);
+         nir_ssa_def *then_val = rand_op(&b, values, num_values);
+         nir_push_else(&b, nif);
+         nir_ssa_def *else_val = pick(values, num_values);
+         nir_pop_if(&b, nif);
+         value = nir_if_phi(&b, then_val, else_val);
+         break;
+      }
+      case 1: case 2: case 3:
+         value = rand_uniform_load(&b, ubo_array, values, num_values);
+         break;
+      case 4:
+         value = rand_texture(&b, sampler, values, num_values);
+         break;
+      default:
+         value = rand_op(&b, values, num_values);
+         break;
+      }
+
+      values[num_values++] = value;
+   }
+
+   nir_store_var(&b, out, values[num_values - 1], 0xf);
+   nir_validate_shader(b.shader, "after generating the shader");
+
+   return b.shader;
+}
+
+static unsigned
+count_instrs(nir_shader *shader)
+{
+   unsigned count = 0;
+
+   nir_foreach_function(function, shader) {
+      if (!function->impl)
+         continue;
+
+      nir_foreach_block(block, function->impl) {
+         nir_foreach_instr(instr, block)
+            count++;
+      }
+   }
+
+   return count;
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned num_shaders = argc > 1 ? atoi(argv[1]) : 200;
+   unsigned num_instrs = argc > 2 ? atoi(argv[2]) : 500;
+
+   glsl_type_singleton_init_or_ref();
+
+   seed[0] = 0x5eed;
+   seed[1] = 0xa16eb7a1c;
+
+   nir_shader **corpus = calloc(num_shaders, sizeof(*corpus));
+   nir_shader **loaded = calloc(num_shaders, sizeof(*loaded));
+   struct blob *blobs = calloc(num_shaders, sizeof(*blobs));
+   int64_t *write_times = calloc(num_shaders, sizeof(*write_times));
+   int64_t *read_times = calloc(num_shaders, sizeof(*read_times));
+   unsigned total_instrs = 0;
+   size_t total_size = 0;
+   bool ok = true;
+
+   for (unsigned i = 0; i < num_shaders; i++) {
+      corpus[i] = generate_shader(num_instrs);
+      total_instrs += count_instrs(corpus[i]);
+   }
+
+   for (unsigned run = 0; run < NUM_RUNS; run++) {
+      for (unsigned i = 0; i < num_shaders; i++) {
+         struct blob blob;
+         blob_init(&blob);
+
+         int64_t start = os_time_get_nano();
+         nir_serialize(&blob, corpus[i]);
+         int64_t time = os_time_get_nano() - start;
+
+         if (run == 0 || time < write_times[i])
+            write_times[i] = time;
+
+         if (run == 0) {
+            blobs[i] = blob;
+            total_size += blob.size;
+         } else {
+            if (blob.size != blobs[i].size ||
+                memcmp(blob.data, blobs[i].data, blob.size) != 0)
+               ok = false;
+            blob_finish(&blob);
+         }
+      }
+
+      /* Keep the shaders around until the end of the run, like the ones
+       * loaded from the shader cache are.
+       */
+      for (unsigned i = 0; i < num_shaders; i++) {
+         struct blob_reader reader;
+         blob_reader_init(&reader, blobs[i].data, blobs[i].size);
+
+         int64_t start = os_time_get_nano();
+         loaded[i] = nir_deserialize(NULL, &options, &reader);
+         int64_t time = os_time_get_nano() - start;
+
+         if (run == 0 || time < read_times[i])
+            read_times[i] = time;
+
+         if (reader.overrun || reader.current != reader.end)
+            ok = false;
+      }
+
+      for (unsigned i = 0; i < num_shaders; i++)
+         ralloc_free(loaded[i]);
+   }
+
+   int64_t write_time = 0, read_time = 0;
+   for (unsigned i = 0; i < num_shaders; i++) {
+      write_time += write_times[i];
+      read_time += read_times[i];
+   }
+
+   printf("%u shaders, %u instructions\n\n", num_shaders, total_instrs);
+   printf("size:        %10.2f KB  %8.2f bytes/instruction\n",
+          total_size / 1e3, (double) total_size / total_instrs);
+   printf("serialize:   %10.2f ms  %8.1f MB/s %8.1f Minstr/s\n",
+          write_time / 1e6, total_size / 1e6 / (write_time / 1e9),
+          total_instrs / 1e6 / (write_time / 1e9));
+   printf("deserialize: %10.2f ms  %8.1f MB/s %8.1f Minstr/s\n",
+          read_time / 1e6, total_size / 1e6 / (read_time / 1e9),
+          total_instrs / 1e6 / (read_time / 1e9));
+   if (!ok)
+      printf("\nserialization isn't deterministic or doesn't round-trip\n");
+
+   for (unsigned i = 0; i < num_shaders; i++) {
+      ralloc_free(corpus[i]);
+      blob_finish(&blobs[i]);
+   }
+   free(corpus);
+   free(loaded);
+   free(blobs);
+   free(write_times);
+   free(read_times);
+
+   glsl_type_singleton_decref();
+
+   return ok ? 0 : 1;
+}
@@ -0,0 +1,326 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "nir_serialize.h"
+
+namespace {
+
+class nir_serialize_test : public ::testing::Test {
+protected:
+   nir_serialize_test();
+   ~nir_serialize_test();
+
+   /* Serializes the shader, deserializes it and checks that serializing the
+    * result gives the same blob again.
+    */
+   nir_shader *round_trip();
+
+   void *mem_ctx;
+
+   nir_builder *b;
+};
+
+static const nir_shader_compiler_options options = { };
+
+nir_serialize_test::nir_serialize_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   mem_ctx = ralloc_context(NULL);
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_FRAGMENT, &options);
+}
+
+nir_serialize_test::~nir_serialize_test()
+{
+   if (HasFailure()) {
+      printf("\nShader from the failed test:\n\n");
+      nir_print_shader(b->shader, stdout);
+   }
+
+   ralloc_free(mem_ctx);
+
+   glsl_type_singleton_decref();
+}
+
+nir_shader *
+nir_serialize_test::round_trip()
+{
+   nir_validate_shader(b->shader, "before serialization");
+
+   struct blob blob, blob2;
+   blob_init(&blob);
+   blob_init(&blob2);
+   nir_serialize(&blob, b->shader);
+
+   struct blob_reader reader;
+   blob_reader_init(&reader, blob.data, blob.size);
+   nir_shader *shader = nir_deserialize(mem_ctx, &options, &reader);
+   EXPECT_FALSE(reader.overrun);
+   EXPECT_EQ(reader.current, reader.end);
+
+   nir_validate_shader(shader, "after deserialization");
+
+   nir_serialize(&blob2, shader);
+   EXPECT_EQ(blob.size, blob2.size);
+   EXPECT_TRUE(blob.size == blob2.size &&
+               memcmp(blob.data, blob2.data, blob.size) == 0);
+
+   blob_finish(&blob);
+   blob_finish(&blob2);
+
+   /* This moves the instructions to a new arena. */
+   nir_sweep(shader);
+   nir_validate_shader(shader, "after nir_sweep");
+
+   return shader;
+}
+
+static nir_alu_instr *
+find_alu(nir_shader *shader, nir_op op)
+{
+   nir_foreach_block(block, nir_shader_get_entrypoint(shader)) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type == nir_instr_type_alu &&
+             nir_instr_as_alu(instr)->op == op)
+            return nir_instr_as_alu(instr);
+      }
+   }
+   return NULL;
+}
+
+} // namespace
+
+TEST_F(nir_serialize_test, alu_modifiers)
+{
+   nir_ssa_def *x = nir_imm_vec4(b, 1.0, 2.0, 3.0, 4.0);
+   nir_ssa_def *y = nir_fadd(b, x, x);
+   nir_alu_instr *add = nir_instr_as_alu(y->parent_instr);
+   add->exact = true;
+   add->dest.saturate = true;
+   add->src[0].negate = true;
+   add->src[1].abs = true;
+   add->src[1].swizzle[0] = 3;
+   add->src[1].swizzle[3] = 0;
+   nir_fmul(b, y, y)->name = ralloc_strdup(b->shader, "product");
+
+   nir_shader *shader = round_trip();
+
+   add = find_alu(shader, nir_op_fadd);
+   ASSERT_NE(add, nullptr);
+   EXPECT_TRUE(add->exact);
+   EXPECT_TRUE(add->dest.saturate);
+   EXPECT_TRUE(add->src[0].negate);
+   EXPECT_FALSE(add->src[0].abs);
+   EXPECT_TRUE(add->src[1].abs);
+   EXPECT_EQ(add->src[1].swizzle[0], 3);
+   EXPECT_EQ(add->src[1].swizzle[1], 1);
+   EXPECT_EQ(add->src[1].swizzle[3], 0);
+
+   nir_alu_instr *mul = find_alu(shader, nir_op_fmul);
+   ASSERT_NE(mul, nullptr);
+   EXPECT_STREQ(mul->dest.dest.ssa.name, "product");
+   EXPECT_EQ(mul->src[0].src.ssa, &add->dest.dest.ssa);
+}
+
+TEST_F(nir_serialize_test, constants)
+{
+   nir_ssa_def *d = nir_imm_double(b, -0.25);
+   nir_ssa_def *i = nir_imm_ivec4(b, 1, -2, 0x7fffffff, 4);
+   nir_ssa_def *bits = nir_iadd(b, nir_imm_intN_t(b, 0x1234, 16),
+                                nir_imm_intN_t(b, -1, 16));
+   nir_fadd(b, d, nir_ssa_undef(b, 1, 64));
+   nir_iadd(b, i, nir_ssa_undef(b, 4, 32));
+   nir_u2u32(b, bits);
+
+   nir_shader *shader = round_trip();
+
+   nir_alu_instr *add = find_alu(shader, nir_op_fadd);
+   ASSERT_NE(add, nullptr);
+   nir_load_const_instr *lc =
+      nir_instr_as_load_const(add->src[0].src.ssa->parent_instr);
+   EXPECT_EQ(lc->def.bit_size, 64);
+   EXPECT_EQ(lc->value[0].f64, -0.25);
+   EXPECT_EQ(add->src[1].src.ssa->parent_instr->type,
+             nir_instr_type_ssa_undef);
+   EXPECT_EQ(add->src[1].src.ssa->bit_size, 64);
+}
+
+TEST_F(nir_serialize_test, vars_and_textures)
+{
+   const glsl_type *vec4 = glsl_vec4_type();
+   nir_variable *in = nir_variable_create(b->shader, nir_var_shader_in,
+                                          vec4, "in");
+   nir_variable *array =
+      nir_variable_create(b->shader, nir_var_uniform,
+                          glsl_array_type(vec4, 8, 0), "array");
+   nir_variable *sampler =
+      nir_variable_create(b->shader, nir_var_uniform,
+                          glsl_sampler_type(GLSL_SAMPLER_DIM_2D, false, false,
+                                            GLSL_TYPE_FLOAT), "tex");
+   nir_variable *out = nir_variable_create(b->shader, nir_var_shader_out,
+                                           vec4, "out");
+
+   nir_ssa_def *coord = nir_load_var(b, in);
+   nir_ssa_def *index = nir_f2i32(b, nir_channel(b, coord, 2));
+   nir_ssa_def *value =
+      nir_load_deref(b, nir_build_deref_array(b, nir_build_deref_var(b, array),
+                                              index));
+
+   nir_deref_instr *deref = nir_build_deref_var(b, sampler);
+   nir_tex_instr *tex = nir_tex_instr_create(b->shader, 3);
+   tex->op = nir_texop_tg4;
+   tex->sampler_dim = GLSL_SAMPLER_DIM_2D;
+   tex->dest_type = nir_type_float;
+   tex->coord_components = 2;
+   tex->component = 2;
+   tex->tg4_offsets[1][0] = -3;
+   tex->tg4_offsets[3][1] = 7;
+   tex->src[0].src_type = nir_tex_src_coord;
+   tex->src[0].src = nir_src_for_ssa(nir_channels(b, coord, 0x3));
+   tex->src[1].src_type = nir_tex_src_texture_deref;
+   tex->src[1].src = nir_src_for_ssa(&deref->dest.ssa);
+   tex->src[2].src_type = nir_tex_src_sampler_deref;
+   tex->src[2].src = nir_src_for_ssa(&deref->dest.ssa);
+   nir_ssa_dest_init(&tex->instr, &tex->dest, 4, 32, NULL);
+   nir_builder_instr_insert(b, &tex->instr);
+
+   nir_store_var(b, out, nir_fmul(b, value, &tex->dest.ssa), 0xf);
+
+   nir_shader *shader = round_trip();
+
+   EXPECT_EQ(exec_list_length(&shader->inputs), 1);
+   EXPECT_EQ(exec_list_length(&shader->uniforms), 2);
+   EXPECT_EQ(exec_list_length(&shader->outputs), 1);
+
+   unsigned num_tex = 0, num_array_derefs = 0;
+   nir_foreach_block(block, nir_shader_get_entrypoint(shader)) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type == nir_instr_type_tex) {
+            nir_tex_instr *t = nir_instr_as_tex(instr);
+            EXPECT_EQ(t->op, nir_texop_tg4);
+            EXPECT_EQ(t->num_srcs, 3);
+            EXPECT_EQ(t->component, 2);
+            EXPECT_EQ(t->tg4_offsets[1][0], -3);
+            EXPECT_EQ(t->tg4_offsets[3][1], 7);
+            num_tex++;
+         } else if (instr->type == nir_instr_type_deref &&
+                    nir_instr_as_deref(instr)->deref_type ==
+                       nir_deref_type_array) {
+            nir_deref_instr *d = nir_instr_as_deref(instr);
+            EXPECT_EQ(d->type, vec4);
+            EXPECT_EQ(d->mode, nir_var_uniform);
+            EXPECT_STREQ(nir_deref_instr_parent(d)->var->name, "array");
+            num_array_derefs++;
+         }
+      }
+   }
+   EXPECT_EQ(num_tex, 1);
+   EXPECT_EQ(num_array_derefs, 1);
+}
+
+TEST_F(nir_serialize_test, loop_phis_and_registers)
+{
+   nir_register *reg = nir_local_reg_create(b->impl);
+   reg->num_components = 1;
+   reg->bit_size = 32;
+   reg->name = ralloc_strdup(reg, "reg");
+
+   nir_ssa_def *zero = nir_imm_int(b, 0);
+   nir_phi_instr *phi = nir_phi_instr_create(b->shader);
+   nir_ssa_dest_init(&phi->instr, &phi->dest, 1, 32, "counter");
+   nir_block *preheader = nir_cursor_current_block(b->cursor);
+
+   nir_loop *loop = nir_push_loop(b);
+   nir_ssa_def *next = nir_iadd(b, &phi->dest.ssa, nir_imm_int(b, 1));
+
+   nir_alu_instr *mov = nir_alu_instr_create(b->shader, nir_op_mov);
+   mov->dest.dest = nir_dest_for_reg(reg);
+   mov->dest.write_mask = 0x1;
+   mov->src[0].src = nir_src_for_ssa(next);
+   nir_builder_instr_insert(b, &mov->instr);
+
+   nir_push_if(b, nir_ieq(b, next, nir_imm_int(b, 16)));
+   nir_jump(b, nir_jump_break);
+   nir_pop_if(b, NULL);
+   nir_block *continue_block = nir_cursor_current_block(b->cursor);
+   nir_pop_loop(b, loop);
+
+   nir_phi_src *src = ralloc(phi, nir_phi_src);
+   src->pred = preheader;
+   src->src = nir_src_for_ssa(zero);
+   exec_list_push_tail(&phi->srcs, &src->node);
+   src = ralloc(phi, nir_phi_src);
+   src->pred = continue_block;
+   src->src = nir_src_for_ssa(next);
+   exec_list_push_tail(&phi->srcs, &src->node);
+   nir_instr_insert(nir_before_block(nir_loop_first_block(loop)), &phi->instr);
+
+   nir_mov(b, nir_load_reg(b, reg));
+
+   nir_shader *shader = round_trip();
+
+   nir_function_impl *impl = nir_shader_get_entrypoint(shader);
+   EXPECT_EQ(exec_list_length(&impl->registers), 1);
+   nir_register *new_reg =
+      exec_node_data(nir_register, exec_list_get_head(&impl->registers), node);
+   EXPECT_STREQ(new_reg->name, "reg");
+   EXPECT_EQ(list_length(&new_reg->defs), 1);
+   EXPECT_EQ(list_length(&new_reg->uses), 1);
+
+   nir_loop *new_loop = nir_cf_node_as_loop(
+      nir_cf_node_next(&nir_start_block(impl)->cf_node));
+   nir_block *header = nir_loop_first_block(new_loop);
+   nir_phi_instr *new_phi = nir_instr_as_phi(nir_block_first_instr(header));
+   EXPECT_STREQ(new_phi->dest.ssa.name, "counter");
+   EXPECT_EQ(exec_list_length(&new_phi->srcs), 2);
+   nir_foreach_phi_src(phi_src, new_phi) {
+      EXPECT_TRUE(phi_src->pred == nir_start_block(impl) ||
+                  phi_src->pred == nir_loop_last_block(new_loop));
+   }
+}
+
+TEST_F(nir_serialize_test, version_mismatch)
+{
+   struct blob blob;
+   blob_init(&blob);
+   nir_serialize(&blob, b->shader);
+
+   struct blob_reader reader;
+   blob_reader_init(&reader, blob.data, blob.size);
+   EXPECT_TRUE(nir_serialize_version_matches(&reader));
+
+   /* Corrupt the version */
+   ((uint32_t *) blob.data)[1] ^= 0xff;
+
+   EXPECT_FALSE(nir_serialize_version_matches(&reader));
+   EXPECT_EQ(reader.current, blob.data);
+   EXPECT_EQ(nir_deserialize(mem_ctx, &options, &reader), nullptr);
+   EXPECT_TRUE(reader.overrun);
+
+   blob_finish(&blob);
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_sweep_test : public ::testing::Test {
+protected:
+   nir_sweep_test();
+   ~nir_sweep_test();
+
+   /* Prints the shader to a string, which the caller frees. */
+   char *print();
+
+   void *mem_ctx;
+
+   nir_builder *b;
+};
+
+static const nir_shader_compiler_options options = { };
+
+nir_sweep_test::nir_sweep_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   mem_ctx = ralloc_context(NULL);
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_COMPUTE, &options);
+}
+
+nir_sweep_test::~nir_sweep_test()
+{
+   if (HasFailure()) {
+      printf("\nShader from the failed test:\n\n");
+      nir_print_shader(b->shader, stdout);
+   }
+
+   ralloc_free(mem_ctx);
+
+   glsl_type_singleton_decref();
+}
+
+char *
+nir_sweep_test::print()
+{
+   FILE *f = tmpfile();
+   nir_print_shader(b->shader, f);
+
+   long size = ftell(f);
+   char *str = (char *) calloc(size + 1, 1);
+   rewind(f);
+   EXPECT_EQ(fread(str, 1, size, f), (size_t) size);
+   fclose(f);
+
+   return str;
+}
+
+static bool
+get_ssa_def(nir_ssa_def *def, void *state)
+{
+   *(nir_ssa_def **) state = def;
+   return true;
+}
+
+} // namespace
+
+TEST_F(nir_sweep_test, loop)
+{
+   nir_variable *out = nir_variable_create(b->shader, nir_var_mem_shared,
+                                           glsl_uint_type(), "out");
+   nir_ssa_def *x = nir_load_local_invocation_index(b);
+
+   /* A dead instruction, which isn't moved. */
+   nir_instr *dead = nir_iadd(b, x, x)->parent_instr;
+
+   nir_ssa_def *zero = nir_imm_int(b, 0);
+   nir_block *start = nir_cursor_current_block(b->cursor);
+
+   nir_phi_instr *phi = nir_phi_instr_create(b->shader);
+   nir_ssa_dest_init(&phi->instr, &phi->dest, 1, 32, "i");
+
+   nir_loop *loop = nir_push_loop(b);
+   nir_push_if(b, nir_uge(b, &phi->dest.ssa, x));
+   nir_jump(b, nir_jump_break);
+   nir_pop_if(b, NULL);
+   nir_ssa_def *next = nir_iadd(b, &phi->dest.ssa, nir_imm_int(b, 1));
+   nir_pop_loop(b, loop);
+
+   nir_phi_src *src = ralloc(phi, nir_phi_src);
+   src->pred = start;
+   src->src = nir_src_for_ssa(zero);
+   exec_list_push_tail(&phi->srcs, &src->node);
+   src = ralloc(phi, nir_phi_src);
+   src->pred = nir_loop_last_block(loop);
+   src->src = nir_src_for_ssa(next);
+   exec_list_push_tail(&phi->srcs, &src->node);
+   nir_instr_insert(nir_before_block(nir_loop_first_block(loop)), &phi->instr);
+
+   nir_store_var(b, out, &phi->dest.ssa, 0x1);
+
+   nir_instr_remove(dead);
+   nir_index_ssa_defs(b->impl);
+   nir_validate_shader(b->shader, "before nir_sweep");
+   char *before = print();
+
+   nir_sweep(b->shader);
+   nir_validate_shader(b->shader, "after nir_sweep");
+   EXPECT_NE(nir_block_first_instr(nir_loop_first_block(loop)), &phi->instr);
+
+   /* Only the instructions moved, so the shader prints the same. */
+   char *after = print();
+   EXPECT_STREQ(before, after);
+   free(before);
+   free(after);
+
+   /* The SSA defs are numbered in program order, without holes. */
+   unsigned index = 0;
+   nir_foreach_block(block, b->impl) {
+      nir_foreach_instr(instr, block) {
+         nir_ssa_def *def = NULL;
+         nir_foreach_ssa_def(instr, get_ssa_def, &def);
+         if (def) {
+            EXPECT_EQ(def->index, index++);
+         }
+      }
+   }
+   EXPECT_EQ(b->impl->ssa_alloc, index);
+}
+
+TEST_F(nir_sweep_test, divergence)
+{
+   nir_variable *uniform = nir_variable_create(b->shader, nir_var_mem_shared,
+                                               glsl_uint_type(), "uniform");
+   nir_variable *divergent = nir_variable_create(b->shader,
+                                                 nir_var_mem_shared,
+                                                 glsl_uint_type(),
+                                                 "divergent");
+   nir_ssa_def *group = nir_channel(b, nir_load_work_group_id(b), 0);
+   nir_ssa_def *index = nir_load_local_invocation_index(b);
+
+   nir_store_var(b, uniform, nir_iadd(b, group, group), 0x1);
+   nir_store_var(b, divergent, nir_iadd(b, group, index), 0x1);
+
+   /* Like brw_postprocess_nir, analyze right before the final sweep. */
+   nir_divergence_analysis(b->shader);
+   nir_sweep(b->shader);
+   nir_validate_shader(b->shader, "after nir_sweep");
+
+   EXPECT_TRUE(b->impl->valid_metadata & nir_metadata_divergence);
+
+   unsigned num_stores = 0;
+   nir_foreach_block(block, b->impl) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type != nir_instr_type_intrinsic)
+            continue;
+
+         nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+         if (intrin->intrinsic != nir_intrinsic_store_deref)
+            continue;
+
+         nir_variable *var = nir_intrinsic_get_var(intrin, 0);
+         EXPECT_EQ(nir_src_is_known_uniform(intrin->src[1]),
+                   var == uniform);
+         num_stores++;
+      }
+   }
+   EXPECT_EQ(num_stores, 2u);
+}
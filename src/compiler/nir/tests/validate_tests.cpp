@@ -0,0 +1,146 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+
+/* nir_validate_shader() does nothing in release builds. */
+#ifndef NDEBUG
+
+namespace {
+
+class nir_validate_test : public ::testing::Test {
+protected:
+   nir_validate_test();
+   ~nir_validate_test();
+
+   void store(nir_ssa_def *value)
+   {
+      nir_variable *var = nir_variable_create(b->shader, nir_var_mem_shared,
+                                              glsl_uint_type(), "out");
+      nir_store_var(b, var, value, 0x1);
+   }
+
+   bool validated()
+   {
+      return b->impl->valid_metadata & nir_metadata_validated;
+   }
+
+   void *mem_ctx;
+
+   nir_builder *b;
+};
+
+static const nir_shader_compiler_options options = { };
+
+nir_validate_test::nir_validate_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   mem_ctx = ralloc_context(NULL);
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_COMPUTE, &options);
+}
+
+nir_validate_test::~nir_validate_test()
+{
+   ralloc_free(mem_ctx);
+
+   glsl_type_singleton_decref();
+}
+
+} // namespace
+
+TEST_F(nir_validate_test, flag_set)
+{
+   nir_ssa_def *x = nir_load_local_invocation_index(b);
+   store(nir_iadd(b, x, x));
+
+   EXPECT_FALSE(validated());
+   nir_validate_shader(b->shader, NULL);
+   EXPECT_TRUE(validated());
+}
+
+TEST_F(nir_validate_test, builder_drops_flag)
+{
+   nir_ssa_def *x = nir_load_local_invocation_index(b);
+
+   nir_validate_shader(b->shader, NULL);
+   nir_iadd(b, x, x);
+   EXPECT_FALSE(validated());
+}
+
+TEST_F(nir_validate_test, rewrite_uses_drops_flag)
+{
+   nir_ssa_def *x = nir_load_local_invocation_index(b);
+   nir_ssa_def *y = nir_iadd(b, x, x);
+   store(y);
+
+   nir_validate_shader(b->shader, NULL);
+   nir_ssa_def_rewrite_uses(y, nir_src_for_ssa(x));
+   EXPECT_FALSE(validated());
+
+   nir_validate_shader(b->shader, NULL);
+   nir_instr_remove(y->parent_instr);
+   EXPECT_FALSE(validated());
+}
+
+TEST_F(nir_validate_test, cf_insert_drops_flag)
+{
+   nir_ssa_def *x = nir_load_local_invocation_index(b);
+
+   nir_validate_shader(b->shader, NULL);
+   nir_push_if(b, nir_ieq(b, x, nir_imm_int(b, 0)));
+   nir_pop_if(b, NULL);
+   EXPECT_FALSE(validated());
+}
+
+TEST_F(nir_validate_test, pass_progress)
+{
+   nir_ssa_def *x = nir_load_local_invocation_index(b);
+   nir_ssa_def *y = nir_iadd(b, x, x);
+   store(y);
+
+   /* Passes that don't make progress leave the flag alone. */
+   nir_validate_shader(b->shader, NULL);
+   bool progress = false;
+   NIR_PASS(progress, b->shader, nir_opt_dce);
+   EXPECT_FALSE(progress);
+   EXPECT_TRUE(validated());
+
+   /* Passes that do reset it with nir_metadata_preserve(), and the shader
+    * is validated again afterwards.
+    */
+   nir_iadd(b, y, y);
+   nir_validate_shader(b->shader, NULL);
+   nir_metadata_set_validation_flag(b->shader);
+   EXPECT_TRUE(nir_opt_dce(b->shader));
+   EXPECT_FALSE(validated());
+   nir_metadata_check_validation_flag(b->shader);
+   nir_validate_shader_changes(b->shader, NULL);
+   EXPECT_TRUE(validated());
+}
+
+#endif /* NDEBUG */
@@ -111,6 +111,28 @@ ir3_key_lowers_nir(const struct ir3_shader_key *key)
 
 #define OPT_V(nir, pass, ...) NIR_PASS_V(nir, pass, ##__VA_ARGS__)
 
+/* Like OPT and OPT_V, for the passes of ir3_optimize_loop(), which get
+ * skipped when nothing changed since they last ran without progress:
+ */
+#define LOOP_OPT(nir, pass, ...) ({                             \
+   bool this_progress = false;                                  \
+   NIR_LOOP_PASS(this_progress, &pm, nir, pass, ##__VA_ARGS__); \
+   this_progress;                                               \
+})
+
+#define LOOP_OPT_V(nir, pass, ...) NIR_LOOP_PASS_V(&pm, nir, pass, ##__VA_ARGS__)
+
+static bool
+ir3_nir_should_vectorize_mem(unsigned align, unsigned bit_size,
+		unsigned num_components, unsigned high_offset,
+		nir_intrinsic_instr *low, nir_intrinsic_instr *high)
+{
+	/* ldgb/ldib and stgb/stib, as well as the ldg used for UBOs, take
+	 * vectors of up to four dwords:
+	 */
+	return bit_size == 32 && align >= 4 && num_components <= 4;
+}
+
 static void
 ir3_optimize_loop(nir_shader *s)
 {
@@ -120,36 +142,39 @@ ir3_optimize_loop(nir_shader *s)
 		(s->options->lower_flrp32 ? 32 : 0) |
 		(s->options->lower_flrp64 ? 64 : 0);
 
+	nir_pass_manager pm;
+	nir_pass_manager_init(&pm);
+
 	do {
 		progress = false;
 
-		OPT_V(s, nir_lower_vars_to_ssa);
-		progress |= OPT(s, nir_opt_copy_prop_vars);
-		progress |= OPT(s, nir_opt_dead_write_vars);
-		progress |= OPT(s, nir_lower_alu_to_scalar, NULL);
-		progress |= OPT(s, nir_lower_phis_to_scalar);
+		LOOP_OPT_V(s, nir_lower_vars_to_ssa);
+		progress |= LOOP_OPT(s, nir_opt_copy_prop_vars);
+		progress |= LOOP_OPT(s, nir_opt_dead_write_vars);
+		progress |= LOOP_OPT(s, nir_lower_alu_to_scalar, NULL);
+		progress |= LOOP_OPT(s, nir_lower_phis_to_scalar);
 
-		progress |= OPT(s, nir_copy_prop);
-		progress |= OPT(s, nir_opt_dce);
-		progress |= OPT(s, nir_opt_cse);
+		progress |= LOOP_OPT(s, nir_copy_prop);
+		progress |= LOOP_OPT(s, nir_opt_dce);
+		progress |= LOOP_OPT(s, nir_opt_cse);
 		static int gcm = -1;
 		if (gcm == -1)
 			gcm = env_var_as_unsigned("GCM", 0);
 		if (gcm == 1)
-			progress |= OPT(s, nir_opt_gcm, true);
+			progress |= LOOP_OPT(s, nir_opt_gcm, true);
 		else if (gcm == 2)
-			progress |= OPT(s, nir_opt_gcm, false);
-		progress |= OPT(s, nir_opt_peephole_select, 16, true, true);
-		progress |= OPT(s, nir_opt_intrinsics);
-		progress |= OPT(s, nir_opt_algebraic);
-		progress |= OPT(s, nir_opt_constant_folding);
+			progress |= LOOP_OPT(s, nir_opt_gcm, false);
+		progress |= LOOP_OPT(s, nir_opt_peephole_select, 16, true, true);
+		progress |= LOOP_OPT(s, nir_opt_intrinsics);
+		progress |= LOOP_OPT(s, nir_opt_algebraic);
+		progress |= LOOP_OPT(s, nir_opt_constant_folding);
 
 		if (lower_flrp != 0) {
-			if (OPT(s, nir_lower_flrp,
+			if (LOOP_OPT(s, nir_lower_flrp,
 					lower_flrp,
 					false /* always_precise */,
 					s->options->lower_ffma)) {
-				OPT(s, nir_opt_constant_folding);
+				LOOP_OPT(s, nir_opt_constant_folding);
 				progress = true;
 			}
 
@@ -159,21 +184,24 @@ ir3_optimize_loop(nir_shader *s)
 			lower_flrp = 0;
 		}
 
-		progress |= OPT(s, nir_opt_dead_cf);
-		if (OPT(s, nir_opt_trivial_continues)) {
+		progress |= LOOP_OPT(s, nir_opt_dead_cf);
+		if (LOOP_OPT(s, nir_opt_trivial_continues)) {
 			progress |= true;
 			/* If nir_opt_trivial_continues makes progress, then we need to clean
 			 * things up if we want any hope of nir_opt_if or nir_opt_loop_unroll
 			 * to make progress.
 			 */
-			OPT(s, nir_copy_prop);
-			OPT(s, nir_opt_dce);
+			LOOP_OPT(s, nir_copy_prop);
+			LOOP_OPT(s, nir_opt_dce);
 		}
-		progress |= OPT(s, nir_opt_if, false);
-		progress |= OPT(s, nir_opt_remove_phis);
-		progress |= OPT(s, nir_opt_undef);
+		progress |= LOOP_OPT(s, nir_opt_if, false);
+		progress |= LOOP_OPT(s, nir_opt_loop_strength_reduce, 0);
+		progress |= LOOP_OPT(s, nir_opt_remove_phis);
+		progress |= LOOP_OPT(s, nir_opt_undef);
 
 	} while (progress);
+
+	nir_pass_manager_finish(&pm);
 }
 
 struct nir_shader *
@@ -218,6 +246,12 @@ ir3_optimize_nir(struct ir3_shader *shader, nir_shader *s,
 	}
 
 	OPT_V(s, nir_lower_regs_to_ssa);
+
+	/* combine scalar UBO/SSBO accesses before they are turned into the ir3
+	 * specific intrinsics:
+	 */
+	OPT_V(s, nir_opt_load_store_vectorize, nir_var_mem_ubo | nir_var_mem_ssbo,
+			ir3_nir_should_vectorize_mem);
 	OPT_V(s, ir3_nir_lower_io_offsets);
 
 	if (key) {
@@ -65,6 +65,7 @@ struct draw_context;
 struct draw_stage;
 struct vbuf_render;
 struct tgsi_exec_machine;
+struct tgsi_exec_machine_wide;
 struct tgsi_sampler;
 struct tgsi_image;
 struct tgsi_buffer;
@@ -266,7 +267,7 @@ struct draw_context
 
       /** Fields for TGSI interpreter / execution */
       struct {
-         struct tgsi_exec_machine *machine;
+         struct tgsi_exec_machine_wide *machine;
 
          struct tgsi_sampler *sampler;
          struct tgsi_image *image;
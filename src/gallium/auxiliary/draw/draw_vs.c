@@ -45,6 +45,7 @@
 
 #include "tgsi/tgsi_dump.h"
 #include "tgsi/tgsi_exec.h"
+#include "tgsi/tgsi_exec_wide.h"
 
 DEBUG_GET_ONCE_BOOL_OPTION(gallium_dump_vs, "GALLIUM_DUMP_VS", FALSE)
 
@@ -150,7 +151,7 @@ draw_vs_init( struct draw_context *draw )
    draw->dump_vs = debug_get_option_gallium_dump_vs();
 
    if (!draw->llvm) {
-      draw->vs.tgsi.machine = tgsi_exec_machine_create(PIPE_SHADER_VERTEX);
+      draw->vs.tgsi.machine = tgsi_exec_machine_wide_create(PIPE_SHADER_VERTEX);
       if (!draw->vs.tgsi.machine)
          return FALSE;
    }
@@ -176,7 +177,7 @@ draw_vs_destroy( struct draw_context *draw )
       translate_cache_destroy(draw->vs.emit_cache);
 
    if (!draw->llvm)
-      tgsi_exec_machine_destroy(draw->vs.tgsi.machine);
+      tgsi_exec_machine_wide_destroy(draw->vs.tgsi.machine);
 }
 
 
@@ -42,11 +42,12 @@
 #include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_scan.h"
 #include "tgsi/tgsi_exec.h"
+#include "tgsi/tgsi_exec_wide.h"
 
 
 struct exec_vertex_shader {
    struct draw_vertex_shader base;
-   struct tgsi_exec_machine *machine;
+   struct tgsi_exec_machine_wide *machine;
 };
 
 
@@ -70,11 +71,11 @@ vs_exec_prepare(struct draw_vertex_shader *shader,
     * Avoid rebinding when possible.
     */
    if (evs->machine->Tokens != shader->state.tokens) {
-      tgsi_exec_machine_bind_shader(evs->machine,
-                                    shader->state.tokens,
-                                    draw->vs.tgsi.sampler,
-                                    draw->vs.tgsi.image,
-                                    draw->vs.tgsi.buffer);
+      tgsi_exec_machine_wide_bind_shader(evs->machine,
+                                         shader->state.tokens,
+                                         draw->vs.tgsi.sampler,
+                                         draw->vs.tgsi.image,
+                                         draw->vs.tgsi.buffer);
    }
 }
 
@@ -97,19 +98,19 @@ vs_exec_run_linear(struct draw_vertex_shader *shader,
                    const unsigned *fetch_elts)
 {
    struct exec_vertex_shader *evs = exec_vertex_shader(shader);
-   struct tgsi_exec_machine *machine = evs->machine;
+   struct tgsi_exec_machine_wide *machine = evs->machine;
    unsigned int i, j;
    unsigned slot;
    boolean clamp_vertex_color = shader->draw->rasterizer->clamp_vertex_color;
 
    debug_assert(!shader->draw->llvm);
-   tgsi_exec_set_constant_buffers(machine, PIPE_MAX_CONSTANT_BUFFERS,
-                                  constants, const_size);
+   tgsi_exec_wide_set_constant_buffers(machine, PIPE_MAX_CONSTANT_BUFFERS,
+                                       constants, const_size);
 
    if (shader->info.uses_instanceid) {
       unsigned i = machine->SysSemanticToIndex[TGSI_SEMANTIC_INSTANCEID];
       assert(i < ARRAY_SIZE(machine->SystemValue));
-      for (j = 0; j < TGSI_QUAD_SIZE; j++)
+      for (j = 0; j < TGSI_EXEC_WIDE_WIDTH; j++)
          machine->SystemValue[i].xyzw[0].i[j] = shader->draw->instance_id;
    }
 
@@ -165,7 +166,7 @@ vs_exec_run_linear(struct draw_vertex_shader *shader,
 
       machine->NonHelperMask = (1 << max_vertices) - 1;
       /* run interpreter */
-      tgsi_exec_machine_run(machine, 0);
+      tgsi_exec_machine_wide_run(machine, 0);
 
       /* Unswizzle all output results.
        */
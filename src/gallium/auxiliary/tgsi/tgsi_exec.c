@@ -74,11 +74,28 @@
 #define TILE_BOTTOM_LEFT  2
 #define TILE_BOTTOM_RIGHT 3
 
+/**
+ * Number of lanes executed by one machine run.  This file is built with
+ * the default of one quad for the regular machine and is included again
+ * by tgsi_exec_wide.c with TGSI_EXEC_WIDTH = TGSI_EXEC_WIDE_WIDTH.  The
+ * width must be a multiple of TGSI_QUAD_SIZE; derivatives and the sampler,
+ * image and buffer interfaces still operate on one quad at a time.
+ */
+#ifndef TGSI_EXEC_WIDTH
+#define TGSI_EXEC_WIDTH TGSI_QUAD_SIZE
+#endif
+
+/** Execution mask with all lanes enabled */
+#define TGSI_EXEC_FULL_MASK ((uint)(~0ull >> (64 - TGSI_EXEC_WIDTH)))
+
+/** The bits of an execution mask belonging to the quad starting at lane q */
+#define TGSI_EXEC_QUAD_MASK(mask, q) (((mask) >> (q)) & 0xf)
+
 union tgsi_double_channel {
-   double d[TGSI_QUAD_SIZE];
-   unsigned u[TGSI_QUAD_SIZE][2];
-   uint64_t u64[TGSI_QUAD_SIZE];
-   int64_t i64[TGSI_QUAD_SIZE];
+   double d[TGSI_EXEC_WIDTH];
+   unsigned u[TGSI_EXEC_WIDTH][2];
+   uint64_t u64[TGSI_EXEC_WIDTH];
+   int64_t i64[TGSI_EXEC_WIDTH];
 };
 
 struct tgsi_double_vector {
@@ -90,40 +107,32 @@ static void
 micro_abs(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->f[0] = fabsf(src->f[0]);
-   dst->f[1] = fabsf(src->f[1]);
-   dst->f[2] = fabsf(src->f[2]);
-   dst->f[3] = fabsf(src->f[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = fabsf(src->f[i]);
 }
 
 static void
 micro_arl(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->i[0] = (int)floorf(src->f[0]);
-   dst->i[1] = (int)floorf(src->f[1]);
-   dst->i[2] = (int)floorf(src->f[2]);
-   dst->i[3] = (int)floorf(src->f[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = (int)floorf(src->f[i]);
 }
 
 static void
 micro_arr(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->i[0] = (int)floorf(src->f[0] + 0.5f);
-   dst->i[1] = (int)floorf(src->f[1] + 0.5f);
-   dst->i[2] = (int)floorf(src->f[2] + 0.5f);
-   dst->i[3] = (int)floorf(src->f[3] + 0.5f);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = (int)floorf(src->f[i] + 0.5f);
 }
 
 static void
 micro_ceil(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src)
 {
-   dst->f[0] = ceilf(src->f[0]);
-   dst->f[1] = ceilf(src->f[1]);
-   dst->f[2] = ceilf(src->f[2]);
-   dst->f[3] = ceilf(src->f[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = ceilf(src->f[i]);
 }
 
 static void
@@ -132,229 +141,193 @@ micro_cmp(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src1,
           const union tgsi_exec_channel *src2)
 {
-   dst->f[0] = src0->f[0] < 0.0f ? src1->f[0] : src2->f[0];
-   dst->f[1] = src0->f[1] < 0.0f ? src1->f[1] : src2->f[1];
-   dst->f[2] = src0->f[2] < 0.0f ? src1->f[2] : src2->f[2];
-   dst->f[3] = src0->f[3] < 0.0f ? src1->f[3] : src2->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->f[i] < 0.0f ? src1->f[i] : src2->f[i];
 }
 
 static void
 micro_cos(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->f[0] = cosf(src->f[0]);
-   dst->f[1] = cosf(src->f[1]);
-   dst->f[2] = cosf(src->f[2]);
-   dst->f[3] = cosf(src->f[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = cosf(src->f[i]);
 }
 
 static void
 micro_d2f(union tgsi_exec_channel *dst,
           const union tgsi_double_channel *src)
 {
-   dst->f[0] = (float)src->d[0];
-   dst->f[1] = (float)src->d[1];
-   dst->f[2] = (float)src->d[2];
-   dst->f[3] = (float)src->d[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = (float)src->d[i];
 }
 
 static void
 micro_d2i(union tgsi_exec_channel *dst,
           const union tgsi_double_channel *src)
 {
-   dst->i[0] = (int)src->d[0];
-   dst->i[1] = (int)src->d[1];
-   dst->i[2] = (int)src->d[2];
-   dst->i[3] = (int)src->d[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = (int)src->d[i];
 }
 
 static void
 micro_d2u(union tgsi_exec_channel *dst,
           const union tgsi_double_channel *src)
 {
-   dst->u[0] = (unsigned)src->d[0];
-   dst->u[1] = (unsigned)src->d[1];
-   dst->u[2] = (unsigned)src->d[2];
-   dst->u[3] = (unsigned)src->d[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = (unsigned)src->d[i];
 }
 static void
 micro_dabs(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->d[0] = src->d[0] >= 0.0 ? src->d[0] : -src->d[0];
-   dst->d[1] = src->d[1] >= 0.0 ? src->d[1] : -src->d[1];
-   dst->d[2] = src->d[2] >= 0.0 ? src->d[2] : -src->d[2];
-   dst->d[3] = src->d[3] >= 0.0 ? src->d[3] : -src->d[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = src->d[i] >= 0.0 ? src->d[i] : -src->d[i];
 }
 
 static void
 micro_dadd(union tgsi_double_channel *dst,
           const union tgsi_double_channel *src)
 {
-   dst->d[0] = src[0].d[0] + src[1].d[0];
-   dst->d[1] = src[0].d[1] + src[1].d[1];
-   dst->d[2] = src[0].d[2] + src[1].d[2];
-   dst->d[3] = src[0].d[3] + src[1].d[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = src[0].d[i] + src[1].d[i];
 }
 
 static void
 micro_ddiv(union tgsi_double_channel *dst,
           const union tgsi_double_channel *src)
 {
-   dst->d[0] = src[0].d[0] / src[1].d[0];
-   dst->d[1] = src[0].d[1] / src[1].d[1];
-   dst->d[2] = src[0].d[2] / src[1].d[2];
-   dst->d[3] = src[0].d[3] / src[1].d[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = src[0].d[i] / src[1].d[i];
 }
 
 static void
 micro_ddx(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->f[0] =
-   dst->f[1] =
-   dst->f[2] =
-   dst->f[3] = src->f[TILE_BOTTOM_RIGHT] - src->f[TILE_BOTTOM_LEFT];
+   for (unsigned q = 0; q < TGSI_EXEC_WIDTH; q += TGSI_QUAD_SIZE) {
+      const float d = src->f[q + TILE_BOTTOM_RIGHT] - src->f[q + TILE_BOTTOM_LEFT];
+      dst->f[q + 0] =
+      dst->f[q + 1] =
+      dst->f[q + 2] =
+      dst->f[q + 3] = d;
+   }
 }
 
 static void
 micro_ddy(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->f[0] =
-   dst->f[1] =
-   dst->f[2] =
-   dst->f[3] = src->f[TILE_BOTTOM_LEFT] - src->f[TILE_TOP_LEFT];
+   for (unsigned q = 0; q < TGSI_EXEC_WIDTH; q += TGSI_QUAD_SIZE) {
+      const float d = src->f[q + TILE_BOTTOM_LEFT] - src->f[q + TILE_TOP_LEFT];
+      dst->f[q + 0] =
+      dst->f[q + 1] =
+      dst->f[q + 2] =
+      dst->f[q + 3] = d;
+   }
 }
 
 static void
 micro_dmul(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->d[0] = src[0].d[0] * src[1].d[0];
-   dst->d[1] = src[0].d[1] * src[1].d[1];
-   dst->d[2] = src[0].d[2] * src[1].d[2];
-   dst->d[3] = src[0].d[3] * src[1].d[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = src[0].d[i] * src[1].d[i];
 }
 
 static void
 micro_dmax(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->d[0] = src[0].d[0] > src[1].d[0] ? src[0].d[0] : src[1].d[0];
-   dst->d[1] = src[0].d[1] > src[1].d[1] ? src[0].d[1] : src[1].d[1];
-   dst->d[2] = src[0].d[2] > src[1].d[2] ? src[0].d[2] : src[1].d[2];
-   dst->d[3] = src[0].d[3] > src[1].d[3] ? src[0].d[3] : src[1].d[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = src[0].d[i] > src[1].d[i] ? src[0].d[i] : src[1].d[i];
 }
 
 static void
 micro_dmin(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->d[0] = src[0].d[0] < src[1].d[0] ? src[0].d[0] : src[1].d[0];
-   dst->d[1] = src[0].d[1] < src[1].d[1] ? src[0].d[1] : src[1].d[1];
-   dst->d[2] = src[0].d[2] < src[1].d[2] ? src[0].d[2] : src[1].d[2];
-   dst->d[3] = src[0].d[3] < src[1].d[3] ? src[0].d[3] : src[1].d[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = src[0].d[i] < src[1].d[i] ? src[0].d[i] : src[1].d[i];
 }
 
 static void
 micro_dneg(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->d[0] = -src->d[0];
-   dst->d[1] = -src->d[1];
-   dst->d[2] = -src->d[2];
-   dst->d[3] = -src->d[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = -src->d[i];
 }
 
 static void
 micro_dslt(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->u[0][0] = src[0].d[0] < src[1].d[0] ? ~0U : 0U;
-   dst->u[1][0] = src[0].d[1] < src[1].d[1] ? ~0U : 0U;
-   dst->u[2][0] = src[0].d[2] < src[1].d[2] ? ~0U : 0U;
-   dst->u[3][0] = src[0].d[3] < src[1].d[3] ? ~0U : 0U;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i][0] = src[0].d[i] < src[1].d[i] ? ~0U : 0U;
 }
 
 static void
 micro_dsne(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->u[0][0] = src[0].d[0] != src[1].d[0] ? ~0U : 0U;
-   dst->u[1][0] = src[0].d[1] != src[1].d[1] ? ~0U : 0U;
-   dst->u[2][0] = src[0].d[2] != src[1].d[2] ? ~0U : 0U;
-   dst->u[3][0] = src[0].d[3] != src[1].d[3] ? ~0U : 0U;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i][0] = src[0].d[i] != src[1].d[i] ? ~0U : 0U;
 }
 
 static void
 micro_dsge(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->u[0][0] = src[0].d[0] >= src[1].d[0] ? ~0U : 0U;
-   dst->u[1][0] = src[0].d[1] >= src[1].d[1] ? ~0U : 0U;
-   dst->u[2][0] = src[0].d[2] >= src[1].d[2] ? ~0U : 0U;
-   dst->u[3][0] = src[0].d[3] >= src[1].d[3] ? ~0U : 0U;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i][0] = src[0].d[i] >= src[1].d[i] ? ~0U : 0U;
 }
 
 static void
 micro_dseq(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->u[0][0] = src[0].d[0] == src[1].d[0] ? ~0U : 0U;
-   dst->u[1][0] = src[0].d[1] == src[1].d[1] ? ~0U : 0U;
-   dst->u[2][0] = src[0].d[2] == src[1].d[2] ? ~0U : 0U;
-   dst->u[3][0] = src[0].d[3] == src[1].d[3] ? ~0U : 0U;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i][0] = src[0].d[i] == src[1].d[i] ? ~0U : 0U;
 }
 
 static void
 micro_drcp(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->d[0] = 1.0 / src->d[0];
-   dst->d[1] = 1.0 / src->d[1];
-   dst->d[2] = 1.0 / src->d[2];
-   dst->d[3] = 1.0 / src->d[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = 1.0 / src->d[i];
 }
 
 static void
 micro_dsqrt(union tgsi_double_channel *dst,
             const union tgsi_double_channel *src)
 {
-   dst->d[0] = sqrt(src->d[0]);
-   dst->d[1] = sqrt(src->d[1]);
-   dst->d[2] = sqrt(src->d[2]);
-   dst->d[3] = sqrt(src->d[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = sqrt(src->d[i]);
 }
 
 static void
 micro_drsq(union tgsi_double_channel *dst,
           const union tgsi_double_channel *src)
 {
-   dst->d[0] = 1.0 / sqrt(src->d[0]);
-   dst->d[1] = 1.0 / sqrt(src->d[1]);
-   dst->d[2] = 1.0 / sqrt(src->d[2]);
-   dst->d[3] = 1.0 / sqrt(src->d[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = 1.0 / sqrt(src->d[i]);
 }
 
 static void
 micro_dmad(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->d[0] = src[0].d[0] * src[1].d[0] + src[2].d[0];
-   dst->d[1] = src[0].d[1] * src[1].d[1] + src[2].d[1];
-   dst->d[2] = src[0].d[2] * src[1].d[2] + src[2].d[2];
-   dst->d[3] = src[0].d[3] * src[1].d[3] + src[2].d[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = src[0].d[i] * src[1].d[i] + src[2].d[i];
 }
 
 static void
 micro_dfrac(union tgsi_double_channel *dst,
             const union tgsi_double_channel *src)
 {
-   dst->d[0] = src->d[0] - floor(src->d[0]);
-   dst->d[1] = src->d[1] - floor(src->d[1]);
-   dst->d[2] = src->d[2] - floor(src->d[2]);
-   dst->d[3] = src->d[3] - floor(src->d[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = src->d[i] - floor(src->d[i]);
 }
 
 static void
@@ -362,10 +335,8 @@ micro_dldexp(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src0,
              union tgsi_exec_channel *src1)
 {
-   dst->d[0] = ldexp(src0->d[0], src1->i[0]);
-   dst->d[1] = ldexp(src0->d[1], src1->i[1]);
-   dst->d[2] = ldexp(src0->d[2], src1->i[2]);
-   dst->d[3] = ldexp(src0->d[3], src1->i[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = ldexp(src0->d[i], src1->i[i]);
 }
 
 static void
@@ -373,10 +344,8 @@ micro_dfracexp(union tgsi_double_channel *dst,
                union tgsi_exec_channel *dst_exp,
                const union tgsi_double_channel *src)
 {
-   dst->d[0] = frexp(src->d[0], &dst_exp->i[0]);
-   dst->d[1] = frexp(src->d[1], &dst_exp->i[1]);
-   dst->d[2] = frexp(src->d[2], &dst_exp->i[2]);
-   dst->d[3] = frexp(src->d[3], &dst_exp->i[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = frexp(src->d[i], &dst_exp->i[i]);
 }
 
 static void
@@ -384,17 +353,15 @@ micro_exp2(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src)
 {
 #if FAST_MATH
-   dst->f[0] = util_fast_exp2(src->f[0]);
-   dst->f[1] = util_fast_exp2(src->f[1]);
-   dst->f[2] = util_fast_exp2(src->f[2]);
-   dst->f[3] = util_fast_exp2(src->f[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = util_fast_exp2(src->f[i]);
 #else
 #if DEBUG
    /* Inf is okay for this instruction, so clamp it to silence assertions. */
    uint i;
    union tgsi_exec_channel clamped;
 
-   for (i = 0; i < 4; i++) {
+   for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
       if (src->f[i] > 127.99999f) {
          clamped.f[i] = 127.99999f;
       } else if (src->f[i] < -126.99999f) {
@@ -406,10 +373,8 @@ micro_exp2(union tgsi_exec_channel *dst,
    src = &clamped;
 #endif /* DEBUG */
 
-   dst->f[0] = powf(2.0f, src->f[0]);
-   dst->f[1] = powf(2.0f, src->f[1]);
-   dst->f[2] = powf(2.0f, src->f[2]);
-   dst->f[3] = powf(2.0f, src->f[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = powf(2.0f, src->f[i]);
 #endif /* FAST_MATH */
 }
 
@@ -417,60 +382,48 @@ static void
 micro_f2d(union tgsi_double_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->d[0] = (double)src->f[0];
-   dst->d[1] = (double)src->f[1];
-   dst->d[2] = (double)src->f[2];
-   dst->d[3] = (double)src->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = (double)src->f[i];
 }
 
 static void
 micro_flr(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->f[0] = floorf(src->f[0]);
-   dst->f[1] = floorf(src->f[1]);
-   dst->f[2] = floorf(src->f[2]);
-   dst->f[3] = floorf(src->f[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = floorf(src->f[i]);
 }
 
 static void
 micro_frc(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->f[0] = src->f[0] - floorf(src->f[0]);
-   dst->f[1] = src->f[1] - floorf(src->f[1]);
-   dst->f[2] = src->f[2] - floorf(src->f[2]);
-   dst->f[3] = src->f[3] - floorf(src->f[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src->f[i] - floorf(src->f[i]);
 }
 
 static void
 micro_i2d(union tgsi_double_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->d[0] = (double)src->i[0];
-   dst->d[1] = (double)src->i[1];
-   dst->d[2] = (double)src->i[2];
-   dst->d[3] = (double)src->i[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = (double)src->i[i];
 }
 
 static void
 micro_iabs(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src)
 {
-   dst->i[0] = src->i[0] >= 0 ? src->i[0] : -src->i[0];
-   dst->i[1] = src->i[1] >= 0 ? src->i[1] : -src->i[1];
-   dst->i[2] = src->i[2] >= 0 ? src->i[2] : -src->i[2];
-   dst->i[3] = src->i[3] >= 0 ? src->i[3] : -src->i[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = src->i[i] >= 0 ? src->i[i] : -src->i[i];
 }
 
 static void
 micro_ineg(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src)
 {
-   dst->i[0] = -src->i[0];
-   dst->i[1] = -src->i[1];
-   dst->i[2] = -src->i[2];
-   dst->i[3] = -src->i[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = -src->i[i];
 }
 
 static void
@@ -478,15 +431,11 @@ micro_lg2(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
 #if FAST_MATH
-   dst->f[0] = util_fast_log2(src->f[0]);
-   dst->f[1] = util_fast_log2(src->f[1]);
-   dst->f[2] = util_fast_log2(src->f[2]);
-   dst->f[3] = util_fast_log2(src->f[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = util_fast_log2(src->f[i]);
 #else
-   dst->f[0] = logf(src->f[0]) * 1.442695f;
-   dst->f[1] = logf(src->f[1]) * 1.442695f;
-   dst->f[2] = logf(src->f[2]) * 1.442695f;
-   dst->f[3] = logf(src->f[3]) * 1.442695f;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = logf(src->f[i]) * 1.442695f;
 #endif
 }
 
@@ -496,10 +445,8 @@ micro_lrp(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src1,
           const union tgsi_exec_channel *src2)
 {
-   dst->f[0] = src0->f[0] * (src1->f[0] - src2->f[0]) + src2->f[0];
-   dst->f[1] = src0->f[1] * (src1->f[1] - src2->f[1]) + src2->f[1];
-   dst->f[2] = src0->f[2] * (src1->f[2] - src2->f[2]) + src2->f[2];
-   dst->f[3] = src0->f[3] * (src1->f[3] - src2->f[3]) + src2->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->f[i] * (src1->f[i] - src2->f[i]) + src2->f[i];
 }
 
 static void
@@ -508,20 +455,16 @@ micro_mad(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src1,
           const union tgsi_exec_channel *src2)
 {
-   dst->f[0] = src0->f[0] * src1->f[0] + src2->f[0];
-   dst->f[1] = src0->f[1] * src1->f[1] + src2->f[1];
-   dst->f[2] = src0->f[2] * src1->f[2] + src2->f[2];
-   dst->f[3] = src0->f[3] * src1->f[3] + src2->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->f[i] * src1->f[i] + src2->f[i];
 }
 
 static void
 micro_mov(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->u[0] = src->u[0];
-   dst->u[1] = src->u[1];
-   dst->u[2] = src->u[2];
-   dst->u[3] = src->u[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src->u[i];
 }
 
 static void
@@ -529,25 +472,19 @@ micro_rcp(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
 #if 0 /* for debugging */
-   assert(src->f[0] != 0.0f);
-   assert(src->f[1] != 0.0f);
-   assert(src->f[2] != 0.0f);
-   assert(src->f[3] != 0.0f);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      assert(src->f[i] != 0.0f);
 #endif
-   dst->f[0] = 1.0f / src->f[0];
-   dst->f[1] = 1.0f / src->f[1];
-   dst->f[2] = 1.0f / src->f[2];
-   dst->f[3] = 1.0f / src->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = 1.0f / src->f[i];
 }
 
 static void
 micro_rnd(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->f[0] = _mesa_roundevenf(src->f[0]);
-   dst->f[1] = _mesa_roundevenf(src->f[1]);
-   dst->f[2] = _mesa_roundevenf(src->f[2]);
-   dst->f[3] = _mesa_roundevenf(src->f[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = _mesa_roundevenf(src->f[i]);
 }
 
 static void
@@ -555,25 +492,19 @@ micro_rsq(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
 #if 0 /* for debugging */
-   assert(src->f[0] != 0.0f);
-   assert(src->f[1] != 0.0f);
-   assert(src->f[2] != 0.0f);
-   assert(src->f[3] != 0.0f);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      assert(src->f[i] != 0.0f);
 #endif
-   dst->f[0] = 1.0f / sqrtf(src->f[0]);
-   dst->f[1] = 1.0f / sqrtf(src->f[1]);
-   dst->f[2] = 1.0f / sqrtf(src->f[2]);
-   dst->f[3] = 1.0f / sqrtf(src->f[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = 1.0f / sqrtf(src->f[i]);
 }
 
 static void
 micro_sqrt(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src)
 {
-   dst->f[0] = sqrtf(src->f[0]);
-   dst->f[1] = sqrtf(src->f[1]);
-   dst->f[2] = sqrtf(src->f[2]);
-   dst->f[3] = sqrtf(src->f[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = sqrtf(src->f[i]);
 }
 
 static void
@@ -581,10 +512,8 @@ micro_seq(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
-   dst->f[0] = src0->f[0] == src1->f[0] ? 1.0f : 0.0f;
-   dst->f[1] = src0->f[1] == src1->f[1] ? 1.0f : 0.0f;
-   dst->f[2] = src0->f[2] == src1->f[2] ? 1.0f : 0.0f;
-   dst->f[3] = src0->f[3] == src1->f[3] ? 1.0f : 0.0f;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->f[i] == src1->f[i] ? 1.0f : 0.0f;
 }
 
 static void
@@ -592,30 +521,24 @@ micro_sge(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
-   dst->f[0] = src0->f[0] >= src1->f[0] ? 1.0f : 0.0f;
-   dst->f[1] = src0->f[1] >= src1->f[1] ? 1.0f : 0.0f;
-   dst->f[2] = src0->f[2] >= src1->f[2] ? 1.0f : 0.0f;
-   dst->f[3] = src0->f[3] >= src1->f[3] ? 1.0f : 0.0f;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->f[i] >= src1->f[i] ? 1.0f : 0.0f;
 }
 
 static void
 micro_sgn(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->f[0] = src->f[0] < 0.0f ? -1.0f : src->f[0] > 0.0f ? 1.0f : 0.0f;
-   dst->f[1] = src->f[1] < 0.0f ? -1.0f : src->f[1] > 0.0f ? 1.0f : 0.0f;
-   dst->f[2] = src->f[2] < 0.0f ? -1.0f : src->f[2] > 0.0f ? 1.0f : 0.0f;
-   dst->f[3] = src->f[3] < 0.0f ? -1.0f : src->f[3] > 0.0f ? 1.0f : 0.0f;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src->f[i] < 0.0f ? -1.0f : src->f[i] > 0.0f ? 1.0f : 0.0f;
 }
 
 static void
 micro_isgn(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->i[0] = src->i[0] < 0 ? -1 : src->i[0] > 0 ? 1 : 0;
-   dst->i[1] = src->i[1] < 0 ? -1 : src->i[1] > 0 ? 1 : 0;
-   dst->i[2] = src->i[2] < 0 ? -1 : src->i[2] > 0 ? 1 : 0;
-   dst->i[3] = src->i[3] < 0 ? -1 : src->i[3] > 0 ? 1 : 0;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = src->i[i] < 0 ? -1 : src->i[i] > 0 ? 1 : 0;
 }
 
 static void
@@ -623,20 +546,16 @@ micro_sgt(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
-   dst->f[0] = src0->f[0] > src1->f[0] ? 1.0f : 0.0f;
-   dst->f[1] = src0->f[1] > src1->f[1] ? 1.0f : 0.0f;
-   dst->f[2] = src0->f[2] > src1->f[2] ? 1.0f : 0.0f;
-   dst->f[3] = src0->f[3] > src1->f[3] ? 1.0f : 0.0f;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->f[i] > src1->f[i] ? 1.0f : 0.0f;
 }
 
 static void
 micro_sin(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->f[0] = sinf(src->f[0]);
-   dst->f[1] = sinf(src->f[1]);
-   dst->f[2] = sinf(src->f[2]);
-   dst->f[3] = sinf(src->f[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = sinf(src->f[i]);
 }
 
 static void
@@ -644,10 +563,8 @@ micro_sle(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
-   dst->f[0] = src0->f[0] <= src1->f[0] ? 1.0f : 0.0f;
-   dst->f[1] = src0->f[1] <= src1->f[1] ? 1.0f : 0.0f;
-   dst->f[2] = src0->f[2] <= src1->f[2] ? 1.0f : 0.0f;
-   dst->f[3] = src0->f[3] <= src1->f[3] ? 1.0f : 0.0f;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->f[i] <= src1->f[i] ? 1.0f : 0.0f;
 }
 
 static void
@@ -655,10 +572,8 @@ micro_slt(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
-   dst->f[0] = src0->f[0] < src1->f[0] ? 1.0f : 0.0f;
-   dst->f[1] = src0->f[1] < src1->f[1] ? 1.0f : 0.0f;
-   dst->f[2] = src0->f[2] < src1->f[2] ? 1.0f : 0.0f;
-   dst->f[3] = src0->f[3] < src1->f[3] ? 1.0f : 0.0f;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->f[i] < src1->f[i] ? 1.0f : 0.0f;
 }
 
 static void
@@ -666,220 +581,176 @@ micro_sne(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
-   dst->f[0] = src0->f[0] != src1->f[0] ? 1.0f : 0.0f;
-   dst->f[1] = src0->f[1] != src1->f[1] ? 1.0f : 0.0f;
-   dst->f[2] = src0->f[2] != src1->f[2] ? 1.0f : 0.0f;
-   dst->f[3] = src0->f[3] != src1->f[3] ? 1.0f : 0.0f;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->f[i] != src1->f[i] ? 1.0f : 0.0f;
 }
 
 static void
 micro_trunc(union tgsi_exec_channel *dst,
             const union tgsi_exec_channel *src)
 {
-   dst->f[0] = truncf(src->f[0]);
-   dst->f[1] = truncf(src->f[1]);
-   dst->f[2] = truncf(src->f[2]);
-   dst->f[3] = truncf(src->f[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = truncf(src->f[i]);
 }
 
 static void
 micro_u2d(union tgsi_double_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->d[0] = (double)src->u[0];
-   dst->d[1] = (double)src->u[1];
-   dst->d[2] = (double)src->u[2];
-   dst->d[3] = (double)src->u[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = (double)src->u[i];
 }
 
 static void
 micro_i64abs(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->i64[0] = src->i64[0] >= 0.0 ? src->i64[0] : -src->i64[0];
-   dst->i64[1] = src->i64[1] >= 0.0 ? src->i64[1] : -src->i64[1];
-   dst->i64[2] = src->i64[2] >= 0.0 ? src->i64[2] : -src->i64[2];
-   dst->i64[3] = src->i64[3] >= 0.0 ? src->i64[3] : -src->i64[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i64[i] = src->i64[i] >= 0.0 ? src->i64[i] : -src->i64[i];
 }
 
 static void
 micro_i64sgn(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->i64[0] = src->i64[0] < 0 ? -1 : src->i64[0] > 0 ? 1 : 0;
-   dst->i64[1] = src->i64[1] < 0 ? -1 : src->i64[1] > 0 ? 1 : 0;
-   dst->i64[2] = src->i64[2] < 0 ? -1 : src->i64[2] > 0 ? 1 : 0;
-   dst->i64[3] = src->i64[3] < 0 ? -1 : src->i64[3] > 0 ? 1 : 0;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i64[i] = src->i64[i] < 0 ? -1 : src->i64[i] > 0 ? 1 : 0;
 }
 
 static void
 micro_i64neg(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->i64[0] = -src->i64[0];
-   dst->i64[1] = -src->i64[1];
-   dst->i64[2] = -src->i64[2];
-   dst->i64[3] = -src->i64[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i64[i] = -src->i64[i];
 }
 
 static void
 micro_u64seq(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->u[0][0] = src[0].u64[0] == src[1].u64[0] ? ~0U : 0U;
-   dst->u[1][0] = src[0].u64[1] == src[1].u64[1] ? ~0U : 0U;
-   dst->u[2][0] = src[0].u64[2] == src[1].u64[2] ? ~0U : 0U;
-   dst->u[3][0] = src[0].u64[3] == src[1].u64[3] ? ~0U : 0U;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i][0] = src[0].u64[i] == src[1].u64[i] ? ~0U : 0U;
 }
 
 static void
 micro_u64sne(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->u[0][0] = src[0].u64[0] != src[1].u64[0] ? ~0U : 0U;
-   dst->u[1][0] = src[0].u64[1] != src[1].u64[1] ? ~0U : 0U;
-   dst->u[2][0] = src[0].u64[2] != src[1].u64[2] ? ~0U : 0U;
-   dst->u[3][0] = src[0].u64[3] != src[1].u64[3] ? ~0U : 0U;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i][0] = src[0].u64[i] != src[1].u64[i] ? ~0U : 0U;
 }
 
 static void
 micro_i64slt(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->u[0][0] = src[0].i64[0] < src[1].i64[0] ? ~0U : 0U;
-   dst->u[1][0] = src[0].i64[1] < src[1].i64[1] ? ~0U : 0U;
-   dst->u[2][0] = src[0].i64[2] < src[1].i64[2] ? ~0U : 0U;
-   dst->u[3][0] = src[0].i64[3] < src[1].i64[3] ? ~0U : 0U;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i][0] = src[0].i64[i] < src[1].i64[i] ? ~0U : 0U;
 }
 
 static void
 micro_u64slt(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->u[0][0] = src[0].u64[0] < src[1].u64[0] ? ~0U : 0U;
-   dst->u[1][0] = src[0].u64[1] < src[1].u64[1] ? ~0U : 0U;
-   dst->u[2][0] = src[0].u64[2] < src[1].u64[2] ? ~0U : 0U;
-   dst->u[3][0] = src[0].u64[3] < src[1].u64[3] ? ~0U : 0U;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i][0] = src[0].u64[i] < src[1].u64[i] ? ~0U : 0U;
 }
 
 static void
 micro_i64sge(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->u[0][0] = src[0].i64[0] >= src[1].i64[0] ? ~0U : 0U;
-   dst->u[1][0] = src[0].i64[1] >= src[1].i64[1] ? ~0U : 0U;
-   dst->u[2][0] = src[0].i64[2] >= src[1].i64[2] ? ~0U : 0U;
-   dst->u[3][0] = src[0].i64[3] >= src[1].i64[3] ? ~0U : 0U;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i][0] = src[0].i64[i] >= src[1].i64[i] ? ~0U : 0U;
 }
 
 static void
 micro_u64sge(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->u[0][0] = src[0].u64[0] >= src[1].u64[0] ? ~0U : 0U;
-   dst->u[1][0] = src[0].u64[1] >= src[1].u64[1] ? ~0U : 0U;
-   dst->u[2][0] = src[0].u64[2] >= src[1].u64[2] ? ~0U : 0U;
-   dst->u[3][0] = src[0].u64[3] >= src[1].u64[3] ? ~0U : 0U;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i][0] = src[0].u64[i] >= src[1].u64[i] ? ~0U : 0U;
 }
 
 static void
 micro_u64max(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->u64[0] = src[0].u64[0] > src[1].u64[0] ? src[0].u64[0] : src[1].u64[0];
-   dst->u64[1] = src[0].u64[1] > src[1].u64[1] ? src[0].u64[1] : src[1].u64[1];
-   dst->u64[2] = src[0].u64[2] > src[1].u64[2] ? src[0].u64[2] : src[1].u64[2];
-   dst->u64[3] = src[0].u64[3] > src[1].u64[3] ? src[0].u64[3] : src[1].u64[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u64[i] = src[0].u64[i] > src[1].u64[i] ? src[0].u64[i] : src[1].u64[i];
 }
 
 static void
 micro_i64max(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->i64[0] = src[0].i64[0] > src[1].i64[0] ? src[0].i64[0] : src[1].i64[0];
-   dst->i64[1] = src[0].i64[1] > src[1].i64[1] ? src[0].i64[1] : src[1].i64[1];
-   dst->i64[2] = src[0].i64[2] > src[1].i64[2] ? src[0].i64[2] : src[1].i64[2];
-   dst->i64[3] = src[0].i64[3] > src[1].i64[3] ? src[0].i64[3] : src[1].i64[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i64[i] = src[0].i64[i] > src[1].i64[i] ? src[0].i64[i] : src[1].i64[i];
 }
 
 static void
 micro_u64min(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->u64[0] = src[0].u64[0] < src[1].u64[0] ? src[0].u64[0] : src[1].u64[0];
-   dst->u64[1] = src[0].u64[1] < src[1].u64[1] ? src[0].u64[1] : src[1].u64[1];
-   dst->u64[2] = src[0].u64[2] < src[1].u64[2] ? src[0].u64[2] : src[1].u64[2];
-   dst->u64[3] = src[0].u64[3] < src[1].u64[3] ? src[0].u64[3] : src[1].u64[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u64[i] = src[0].u64[i] < src[1].u64[i] ? src[0].u64[i] : src[1].u64[i];
 }
 
 static void
 micro_i64min(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->i64[0] = src[0].i64[0] < src[1].i64[0] ? src[0].i64[0] : src[1].i64[0];
-   dst->i64[1] = src[0].i64[1] < src[1].i64[1] ? src[0].i64[1] : src[1].i64[1];
-   dst->i64[2] = src[0].i64[2] < src[1].i64[2] ? src[0].i64[2] : src[1].i64[2];
-   dst->i64[3] = src[0].i64[3] < src[1].i64[3] ? src[0].i64[3] : src[1].i64[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i64[i] = src[0].i64[i] < src[1].i64[i] ? src[0].i64[i] : src[1].i64[i];
 }
 
 static void
 micro_u64add(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->u64[0] = src[0].u64[0] + src[1].u64[0];
-   dst->u64[1] = src[0].u64[1] + src[1].u64[1];
-   dst->u64[2] = src[0].u64[2] + src[1].u64[2];
-   dst->u64[3] = src[0].u64[3] + src[1].u64[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u64[i] = src[0].u64[i] + src[1].u64[i];
 }
 
 static void
 micro_u64mul(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->u64[0] = src[0].u64[0] * src[1].u64[0];
-   dst->u64[1] = src[0].u64[1] * src[1].u64[1];
-   dst->u64[2] = src[0].u64[2] * src[1].u64[2];
-   dst->u64[3] = src[0].u64[3] * src[1].u64[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u64[i] = src[0].u64[i] * src[1].u64[i];
 }
 
 static void
 micro_u64div(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->u64[0] = src[1].u64[0] ? src[0].u64[0] / src[1].u64[0] : ~0ull;
-   dst->u64[1] = src[1].u64[1] ? src[0].u64[1] / src[1].u64[1] : ~0ull;
-   dst->u64[2] = src[1].u64[2] ? src[0].u64[2] / src[1].u64[2] : ~0ull;
-   dst->u64[3] = src[1].u64[3] ? src[0].u64[3] / src[1].u64[3] : ~0ull;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u64[i] = src[1].u64[i] ? src[0].u64[i] / src[1].u64[i] : ~0ull;
 }
 
 static void
 micro_i64div(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->i64[0] = src[1].i64[0] ? src[0].i64[0] / src[1].i64[0] : 0;
-   dst->i64[1] = src[1].i64[1] ? src[0].i64[1] / src[1].i64[1] : 0;
-   dst->i64[2] = src[1].i64[2] ? src[0].i64[2] / src[1].i64[2] : 0;
-   dst->i64[3] = src[1].i64[3] ? src[0].i64[3] / src[1].i64[3] : 0;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i64[i] = src[1].i64[i] ? src[0].i64[i] / src[1].i64[i] : 0;
 }
 
 static void
 micro_u64mod(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->u64[0] = src[1].u64[0] ? src[0].u64[0] % src[1].u64[0] : ~0ull;
-   dst->u64[1] = src[1].u64[1] ? src[0].u64[1] % src[1].u64[1] : ~0ull;
-   dst->u64[2] = src[1].u64[2] ? src[0].u64[2] % src[1].u64[2] : ~0ull;
-   dst->u64[3] = src[1].u64[3] ? src[0].u64[3] % src[1].u64[3] : ~0ull;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u64[i] = src[1].u64[i] ? src[0].u64[i] % src[1].u64[i] : ~0ull;
 }
 
 static void
 micro_i64mod(union tgsi_double_channel *dst,
              const union tgsi_double_channel *src)
 {
-   dst->i64[0] = src[1].i64[0] ? src[0].i64[0] % src[1].i64[0] : ~0ll;
-   dst->i64[1] = src[1].i64[1] ? src[0].i64[1] % src[1].i64[1] : ~0ll;
-   dst->i64[2] = src[1].i64[2] ? src[0].i64[2] % src[1].i64[2] : ~0ll;
-   dst->i64[3] = src[1].i64[3] ? src[0].i64[3] % src[1].i64[3] : ~0ll;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i64[i] = src[1].i64[i] ? src[0].i64[i] % src[1].i64[i] : ~0ll;
 }
 
 static void
@@ -888,14 +759,10 @@ micro_u64shl(union tgsi_double_channel *dst,
              union tgsi_exec_channel *src1)
 {
    unsigned masked_count;
-   masked_count = src1->u[0] & 0x3f;
-   dst->u64[0] = src0->u64[0] << masked_count;
-   masked_count = src1->u[1] & 0x3f;
-   dst->u64[1] = src0->u64[1] << masked_count;
-   masked_count = src1->u[2] & 0x3f;
-   dst->u64[2] = src0->u64[2] << masked_count;
-   masked_count = src1->u[3] & 0x3f;
-   dst->u64[3] = src0->u64[3] << masked_count;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++) {
+      masked_count = src1->u[i] & 0x3f;
+      dst->u64[i] = src0->u64[i] << masked_count;
+   }
 }
 
 static void
@@ -904,14 +771,10 @@ micro_i64shr(union tgsi_double_channel *dst,
              union tgsi_exec_channel *src1)
 {
    unsigned masked_count;
-   masked_count = src1->u[0] & 0x3f;
-   dst->i64[0] = src0->i64[0] >> masked_count;
-   masked_count = src1->u[1] & 0x3f;
-   dst->i64[1] = src0->i64[1] >> masked_count;
-   masked_count = src1->u[2] & 0x3f;
-   dst->i64[2] = src0->i64[2] >> masked_count;
-   masked_count = src1->u[3] & 0x3f;
-   dst->i64[3] = src0->i64[3] >> masked_count;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++) {
+      masked_count = src1->u[i] & 0x3f;
+      dst->i64[i] = src0->i64[i] >> masked_count;
+   }
 }
 
 static void
@@ -920,14 +783,10 @@ micro_u64shr(union tgsi_double_channel *dst,
              union tgsi_exec_channel *src1)
 {
    unsigned masked_count;
-   masked_count = src1->u[0] & 0x3f;
-   dst->u64[0] = src0->u64[0] >> masked_count;
-   masked_count = src1->u[1] & 0x3f;
-   dst->u64[1] = src0->u64[1] >> masked_count;
-   masked_count = src1->u[2] & 0x3f;
-   dst->u64[2] = src0->u64[2] >> masked_count;
-   masked_count = src1->u[3] & 0x3f;
-   dst->u64[3] = src0->u64[3] >> masked_count;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++) {
+      masked_count = src1->u[i] & 0x3f;
+      dst->u64[i] = src0->u64[i] >> masked_count;
+   }
 }
 
 enum tgsi_exec_datatype {
@@ -970,20 +829,25 @@ static const struct {
       MACH->ExecMask = MACH->CondMask & MACH->LoopMask & MACH->ContMask & MACH->Switch.mask & MACH->FuncMask
 
 
-static const union tgsi_exec_channel ZeroVec =
-   { { 0.0, 0.0, 0.0, 0.0 } };
+/** Initializer for a channel with all lanes set to the same value */
+#define SPLAT4(x) x, x, x, x
+#if TGSI_EXEC_WIDTH == 4
+#define CHANNEL_SPLAT(x) { { SPLAT4(x) } }
+#elif TGSI_EXEC_WIDTH == 8
+#define CHANNEL_SPLAT(x) { { SPLAT4(x), SPLAT4(x) } }
+#elif TGSI_EXEC_WIDTH == 16
+#define CHANNEL_SPLAT(x) { { SPLAT4(x), SPLAT4(x), SPLAT4(x), SPLAT4(x) } }
+#else
+#error "unsupported TGSI_EXEC_WIDTH"
+#endif
 
-static const union tgsi_exec_channel OneVec = {
-   {1.0f, 1.0f, 1.0f, 1.0f}
-};
+static const union tgsi_exec_channel ZeroVec = CHANNEL_SPLAT(0.0f);
 
-static const union tgsi_exec_channel P128Vec = {
-   {128.0f, 128.0f, 128.0f, 128.0f}
-};
+static const union tgsi_exec_channel OneVec = CHANNEL_SPLAT(1.0f);
 
-static const union tgsi_exec_channel M128Vec = {
-   {-128.0f, -128.0f, -128.0f, -128.0f}
-};
+static const union tgsi_exec_channel P128Vec = CHANNEL_SPLAT(128.0f);
+
+static const union tgsi_exec_channel M128Vec = CHANNEL_SPLAT(-128.0f);
 
 
 /**
@@ -995,10 +859,8 @@ static const union tgsi_exec_channel M128Vec = {
 static inline void
 check_inf_or_nan(const union tgsi_exec_channel *chan)
 {
-   assert(!util_is_inf_or_nan((chan)->f[0]));
-   assert(!util_is_inf_or_nan((chan)->f[1]));
-   assert(!util_is_inf_or_nan((chan)->f[2]));
-   assert(!util_is_inf_or_nan((chan)->f[3]));
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      assert(!util_is_inf_or_nan((chan)->f[i]));
 }
 
 
@@ -1046,6 +908,7 @@ tgsi_exec_set_constant_buffers(struct tgsi_exec_machine *mach,
 }
 
 
+#ifndef TGSI_EXEC_WIDE_IMPL
 /**
  * Check if there's a potential src/dst register data dependency when
  * using SOA execution.
@@ -1098,6 +961,7 @@ tgsi_check_soa_dependencies(const struct tgsi_full_instruction *inst)
    }
    return FALSE;
 }
+#endif /* !TGSI_EXEC_WIDE_IMPL */
 
 
 /**
@@ -1307,6 +1171,10 @@ tgsi_exec_machine_create(enum pipe_shader_type shader_type)
    struct tgsi_exec_machine *mach;
    uint i;
 
+   /* Interpolation and derivatives only know about a single quad. */
+   assert(TGSI_EXEC_WIDTH == TGSI_QUAD_SIZE ||
+          shader_type != PIPE_SHADER_FRAGMENT);
+
    mach = align_malloc( sizeof *mach, 16 );
    if (!mach)
       goto fail;
@@ -1331,7 +1199,7 @@ tgsi_exec_machine_create(enum pipe_shader_type shader_type)
    }
 
    /* Setup constants needed by the SSE2 executor. */
-   for( i = 0; i < 4; i++ ) {
+   for( i = 0; i < TGSI_EXEC_WIDTH; i++ ) {
       mach->Temps[TGSI_EXEC_TEMP_00000000_I].xyzw[TGSI_EXEC_TEMP_00000000_C].u[i] = 0x00000000;
       mach->Temps[TGSI_EXEC_TEMP_7FFFFFFF_I].xyzw[TGSI_EXEC_TEMP_7FFFFFFF_C].u[i] = 0x7FFFFFFF;
       mach->Temps[TGSI_EXEC_TEMP_80000000_I].xyzw[TGSI_EXEC_TEMP_80000000_C].u[i] = 0x80000000;
@@ -1384,10 +1252,8 @@ micro_add(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
-   dst->f[0] = src0->f[0] + src1->f[0];
-   dst->f[1] = src0->f[1] + src1->f[1];
-   dst->f[2] = src0->f[2] + src1->f[2];
-   dst->f[3] = src0->f[3] + src1->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->f[i] + src1->f[i];
 }
 
 static void
@@ -1396,17 +1262,10 @@ micro_div(
    const union tgsi_exec_channel *src0,
    const union tgsi_exec_channel *src1 )
 {
-   if (src1->f[0] != 0) {
-      dst->f[0] = src0->f[0] / src1->f[0];
-   }
-   if (src1->f[1] != 0) {
-      dst->f[1] = src0->f[1] / src1->f[1];
-   }
-   if (src1->f[2] != 0) {
-      dst->f[2] = src0->f[2] / src1->f[2];
-   }
-   if (src1->f[3] != 0) {
-      dst->f[3] = src0->f[3] / src1->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++) {
+      if (src1->f[i] != 0) {
+         dst->f[i] = src0->f[i] / src1->f[i];
+      }
    }
 }
 
@@ -1418,10 +1277,8 @@ micro_lt(
    const union tgsi_exec_channel *src2,
    const union tgsi_exec_channel *src3 )
 {
-   dst->f[0] = src0->f[0] < src1->f[0] ? src2->f[0] : src3->f[0];
-   dst->f[1] = src0->f[1] < src1->f[1] ? src2->f[1] : src3->f[1];
-   dst->f[2] = src0->f[2] < src1->f[2] ? src2->f[2] : src3->f[2];
-   dst->f[3] = src0->f[3] < src1->f[3] ? src2->f[3] : src3->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->f[i] < src1->f[i] ? src2->f[i] : src3->f[i];
 }
 
 static void
@@ -1429,10 +1286,8 @@ micro_max(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
-   dst->f[0] = src0->f[0] > src1->f[0] ? src0->f[0] : src1->f[0];
-   dst->f[1] = src0->f[1] > src1->f[1] ? src0->f[1] : src1->f[1];
-   dst->f[2] = src0->f[2] > src1->f[2] ? src0->f[2] : src1->f[2];
-   dst->f[3] = src0->f[3] > src1->f[3] ? src0->f[3] : src1->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->f[i] > src1->f[i] ? src0->f[i] : src1->f[i];
 }
 
 static void
@@ -1440,10 +1295,8 @@ micro_min(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
-   dst->f[0] = src0->f[0] < src1->f[0] ? src0->f[0] : src1->f[0];
-   dst->f[1] = src0->f[1] < src1->f[1] ? src0->f[1] : src1->f[1];
-   dst->f[2] = src0->f[2] < src1->f[2] ? src0->f[2] : src1->f[2];
-   dst->f[3] = src0->f[3] < src1->f[3] ? src0->f[3] : src1->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->f[i] < src1->f[i] ? src0->f[i] : src1->f[i];
 }
 
 static void
@@ -1451,10 +1304,8 @@ micro_mul(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
-   dst->f[0] = src0->f[0] * src1->f[0];
-   dst->f[1] = src0->f[1] * src1->f[1];
-   dst->f[2] = src0->f[2] * src1->f[2];
-   dst->f[3] = src0->f[3] * src1->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->f[i] * src1->f[i];
 }
 
 static void
@@ -1462,10 +1313,8 @@ micro_neg(
    union tgsi_exec_channel *dst,
    const union tgsi_exec_channel *src )
 {
-   dst->f[0] = -src->f[0];
-   dst->f[1] = -src->f[1];
-   dst->f[2] = -src->f[2];
-   dst->f[3] = -src->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = -src->f[i];
 }
 
 static void
@@ -1475,15 +1324,11 @@ micro_pow(
    const union tgsi_exec_channel *src1 )
 {
 #if FAST_MATH
-   dst->f[0] = util_fast_pow( src0->f[0], src1->f[0] );
-   dst->f[1] = util_fast_pow( src0->f[1], src1->f[1] );
-   dst->f[2] = util_fast_pow( src0->f[2], src1->f[2] );
-   dst->f[3] = util_fast_pow( src0->f[3], src1->f[3] );
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = util_fast_pow( src0->f[i], src1->f[i] );
 #else
-   dst->f[0] = powf( src0->f[0], src1->f[0] );
-   dst->f[1] = powf( src0->f[1], src1->f[1] );
-   dst->f[2] = powf( src0->f[2], src1->f[2] );
-   dst->f[3] = powf( src0->f[3], src1->f[3] );
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = powf( src0->f[i], src1->f[i] );
 #endif
 }
 
@@ -1492,10 +1337,8 @@ micro_ldexp(union tgsi_exec_channel *dst,
             const union tgsi_exec_channel *src0,
             const union tgsi_exec_channel *src1)
 {
-   dst->f[0] = ldexpf(src0->f[0], src1->i[0]);
-   dst->f[1] = ldexpf(src0->f[1], src1->i[1]);
-   dst->f[2] = ldexpf(src0->f[2], src1->i[2]);
-   dst->f[3] = ldexpf(src0->f[3], src1->i[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = ldexpf(src0->f[i], src1->i[i]);
 }
 
 static void
@@ -1503,10 +1346,8 @@ micro_sub(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
-   dst->f[0] = src0->f[0] - src1->f[0];
-   dst->f[1] = src0->f[1] - src1->f[1];
-   dst->f[2] = src0->f[2] - src1->f[2];
-   dst->f[3] = src0->f[3] - src1->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->f[i] - src1->f[i];
 }
 
 static void
@@ -1523,7 +1364,7 @@ fetch_src_file_channel(const struct tgsi_exec_machine *mach,
 
    switch (file) {
    case TGSI_FILE_CONSTANT:
-      for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
          assert(index2D->i[i] >= 0 && index2D->i[i] < PIPE_MAX_CONSTANT_BUFFERS);
          assert(mach->Consts[index2D->i[i]]);
 
@@ -1552,7 +1393,7 @@ fetch_src_file_channel(const struct tgsi_exec_machine *mach,
       break;
 
    case TGSI_FILE_INPUT:
-      for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
          /*
          if (PIPE_SHADER_GEOMETRY == mach->ShaderType) {
             debug_printf("Fetching Input[%d] (2d=%d, 1d=%d)\n",
@@ -1570,13 +1411,13 @@ fetch_src_file_channel(const struct tgsi_exec_machine *mach,
       /* XXX no swizzling at this point.  Will be needed if we put
        * gl_FragCoord, for example, in a sys value register.
        */
-      for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
          chan->u[i] = mach->SystemValue[index->i[i]].xyzw[swizzle].u[i];
       }
       break;
 
    case TGSI_FILE_TEMPORARY:
-      for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
          assert(index->i[i] < TGSI_EXEC_NUM_TEMPS);
          assert(index2D->i[i] == 0);
 
@@ -1585,7 +1426,7 @@ fetch_src_file_channel(const struct tgsi_exec_machine *mach,
       break;
 
    case TGSI_FILE_IMMEDIATE:
-      for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
          assert(index->i[i] >= 0 && index->i[i] < (int)mach->ImmLimit);
          assert(index2D->i[i] == 0);
 
@@ -1594,7 +1435,7 @@ fetch_src_file_channel(const struct tgsi_exec_machine *mach,
       break;
 
    case TGSI_FILE_ADDRESS:
-      for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
          assert(index->i[i] >= 0);
          assert(index2D->i[i] == 0);
 
@@ -1604,7 +1445,7 @@ fetch_src_file_channel(const struct tgsi_exec_machine *mach,
 
    case TGSI_FILE_OUTPUT:
       /* vertex/fragment output vars can be read too */
-      for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
          assert(index->i[i] >= 0);
          assert(index2D->i[i] == 0);
 
@@ -1614,7 +1455,7 @@ fetch_src_file_channel(const struct tgsi_exec_machine *mach,
 
    default:
       assert(0);
-      for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
          chan->u[i] = 0;
       }
    }
@@ -1635,10 +1476,8 @@ get_index_registers(const struct tgsi_exec_machine *mach,
     *       file = Register.File
     *       [1] = Register.Index
     */
-   index->i[0] =
-   index->i[1] =
-   index->i[2] =
-   index->i[3] = reg->Register.Index;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      index->i[i] = reg->Register.Index;
 
    /* There is an extra source register that indirectly subscripts
     * a register file. The direct index now becomes an offset
@@ -1657,10 +1496,8 @@ get_index_registers(const struct tgsi_exec_machine *mach,
       uint i;
 
       /* which address register (always zero now) */
-      index2.i[0] =
-      index2.i[1] =
-      index2.i[2] =
-      index2.i[3] = reg->Indirect.Index;
+      for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+         index2.i[i] = reg->Indirect.Index;
       /* get current value of address register[swizzle] */
       swizzle = reg->Indirect.Swizzle;
       fetch_src_file_channel(mach,
@@ -1671,15 +1508,13 @@ get_index_registers(const struct tgsi_exec_machine *mach,
                              &indir_index);
 
       /* add value of address register to the offset */
-      index->i[0] += indir_index.i[0];
-      index->i[1] += indir_index.i[1];
-      index->i[2] += indir_index.i[2];
-      index->i[3] += indir_index.i[3];
+      for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+         index->i[i] += indir_index.i[i];
 
       /* for disabled execution channels, zero-out the index to
        * avoid using a potential garbage value.
        */
-      for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
          if ((execmask & (1 << i)) == 0)
             index->i[i] = 0;
       }
@@ -1694,10 +1529,8 @@ get_index_registers(const struct tgsi_exec_machine *mach,
     *       [3] = Dimension.Index
     */
    if (reg->Register.Dimension) {
-      index2D->i[0] =
-      index2D->i[1] =
-      index2D->i[2] =
-      index2D->i[3] = reg->Dimension.Index;
+      for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+         index2D->i[i] = reg->Dimension.Index;
 
       /* Again, the second subscript index can be addressed indirectly
        * identically to the first one.
@@ -1716,10 +1549,8 @@ get_index_registers(const struct tgsi_exec_machine *mach,
          const uint execmask = mach->ExecMask;
          uint i;
 
-         index2.i[0] =
-         index2.i[1] =
-         index2.i[2] =
-         index2.i[3] = reg->DimIndirect.Index;
+         for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+            index2.i[i] = reg->DimIndirect.Index;
 
          swizzle = reg->DimIndirect.Swizzle;
          fetch_src_file_channel(mach,
@@ -1729,15 +1560,13 @@ get_index_registers(const struct tgsi_exec_machine *mach,
                                 &ZeroVec,
                                 &indir_index);
 
-         index2D->i[0] += indir_index.i[0];
-         index2D->i[1] += indir_index.i[1];
-         index2D->i[2] += indir_index.i[2];
-         index2D->i[3] += indir_index.i[3];
+         for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+            index2D->i[i] += indir_index.i[i];
 
          /* for disabled execution channels, zero-out the index to
           * avoid using a potential garbage value.
           */
-         for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+         for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
             if ((execmask & (1 << i)) == 0) {
                index2D->i[i] = 0;
             }
@@ -1749,10 +1578,8 @@ get_index_registers(const struct tgsi_exec_machine *mach,
        * by a dimension register and continue the saga.
        */
    } else {
-      index2D->i[0] =
-      index2D->i[1] =
-      index2D->i[2] =
-      index2D->i[3] = 0;
+      for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+         index2D->i[i] = 0;
    }
 }
 
@@ -1839,10 +1666,8 @@ store_dest_dstret(struct tgsi_exec_machine *mach,
       uint swizzle;
 
       /* which address register (always zero for now) */
-      index.i[0] =
-      index.i[1] =
-      index.i[2] =
-      index.i[3] = reg->Indirect.Index;
+      for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+         index.i[i] = reg->Indirect.Index;
 
       /* get current value of address register[swizzle] */
       swizzle = reg->Indirect.Swizzle;
@@ -1868,10 +1693,8 @@ store_dest_dstret(struct tgsi_exec_machine *mach,
     *       [3] = Dimension.Index
     */
    if (reg->Register.Dimension) {
-      index2D.i[0] =
-      index2D.i[1] =
-      index2D.i[2] =
-      index2D.i[3] = reg->Dimension.Index;
+      for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+         index2D.i[i] = reg->Dimension.Index;
 
       /* Again, the second subscript index can be addressed indirectly
        * identically to the first one.
@@ -1891,10 +1714,8 @@ store_dest_dstret(struct tgsi_exec_machine *mach,
          unsigned swizzle;
          uint i;
 
-         index2.i[0] =
-         index2.i[1] =
-         index2.i[2] =
-         index2.i[3] = reg->DimIndirect.Index;
+         for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+            index2.i[i] = reg->DimIndirect.Index;
 
          swizzle = reg->DimIndirect.Swizzle;
          fetch_src_file_channel(mach,
@@ -1904,15 +1725,13 @@ store_dest_dstret(struct tgsi_exec_machine *mach,
                                 &ZeroVec,
                                 &indir_index);
 
-         index2D.i[0] += indir_index.i[0];
-         index2D.i[1] += indir_index.i[1];
-         index2D.i[2] += indir_index.i[2];
-         index2D.i[3] += indir_index.i[3];
+         for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+            index2D.i[i] += indir_index.i[i];
 
          /* for disabled execution channels, zero-out the index to
           * avoid using a potential garbage value.
           */
-         for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+         for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
             if ((execmask & (1 << i)) == 0) {
                index2D.i[i] = 0;
             }
@@ -1924,10 +1743,8 @@ store_dest_dstret(struct tgsi_exec_machine *mach,
        * by a dimension register and continue the saga.
        */
    } else {
-      index2D.i[0] =
-      index2D.i[1] =
-      index2D.i[2] =
-      index2D.i[3] = 0;
+      for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+         index2D.i[i] = 0;
    }
 
    switch (reg->Register.File) {
@@ -1945,7 +1762,7 @@ store_dest_dstret(struct tgsi_exec_machine *mach,
                    reg->Register.Index);
       if (PIPE_SHADER_GEOMETRY == mach->ShaderType) {
          debug_printf("STORING OUT[%d] mask(%d), = (", offset + index, execmask);
-         for (i = 0; i < TGSI_QUAD_SIZE; i++)
+         for (i = 0; i < TGSI_EXEC_WIDTH; i++)
             if (execmask & (1 << i))
                debug_printf("%f, ", chan->f[i]);
          debug_printf(")\n");
@@ -1988,7 +1805,7 @@ store_dest_double(struct tgsi_exec_machine *mach,
       return;
 
    /* doubles path */
-   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+   for (i = 0; i < TGSI_EXEC_WIDTH; i++)
       if (execmask & (1 << i))
          dst->i[i] = chan->i[i];
 }
@@ -2010,12 +1827,12 @@ store_dest(struct tgsi_exec_machine *mach,
       return;
 
    if (!inst->Instruction.Saturate) {
-      for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++)
          if (execmask & (1 << i))
             dst->i[i] = chan->i[i];
    }
    else {
-      for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++)
          if (execmask & (1 << i)) {
             if (chan->f[i] < 0.0f)
                dst->f[i] = 0.0f;
@@ -2066,7 +1883,7 @@ exec_kill_if(struct tgsi_exec_machine *mach,
       uniquemask |= 1 << swizzle;
 
       FETCH(&r[0], 0, chan_index);
-      for (i = 0; i < 4; i++)
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++)
          if (r[0].f[i] < 0.0f)
             kilmask |= 1 << i;
    }
@@ -2154,10 +1971,11 @@ conditional_emit_primitive(struct tgsi_exec_machine *mach)
 
 
 /*
- * Fetch four texture samples using STR texture coordinates.
+ * Fetch texture samples using STR texture coordinates, one quad at a time.
+ * Quads with no active lanes are skipped, and their results left undefined.
  */
 static void
-fetch_texel( struct tgsi_sampler *sampler,
+fetch_texel( struct tgsi_exec_machine *mach,
              const unsigned sview_idx,
              const unsigned sampler_idx,
              const union tgsi_exec_channel *s,
@@ -2165,7 +1983,7 @@ fetch_texel( struct tgsi_sampler *sampler,
              const union tgsi_exec_channel *p,
              const union tgsi_exec_channel *c0,
              const union tgsi_exec_channel *c1,
-             float derivs[3][2][TGSI_QUAD_SIZE],
+             float derivs[3][2][TGSI_EXEC_WIDTH],
              const int8_t offset[3],
              enum tgsi_sampler_control control,
              union tgsi_exec_channel *r,
@@ -2173,18 +1991,34 @@ fetch_texel( struct tgsi_sampler *sampler,
              union tgsi_exec_channel *b,
              union tgsi_exec_channel *a )
 {
-   uint j;
+   struct tgsi_sampler *sampler = mach->Sampler;
+   const uint execmask = mach->ExecMask;
+   uint j, q;
    float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
+   float quad_derivs[3][2][TGSI_QUAD_SIZE];
 
-   /* FIXME: handle explicit derivs, offsets */
-   sampler->get_samples(sampler, sview_idx, sampler_idx,
-                        s->f, t->f, p->f, c0->f, c1->f, derivs, offset, control, rgba);
+   for (q = 0; q < TGSI_EXEC_WIDTH; q += TGSI_QUAD_SIZE) {
+      if (!TGSI_EXEC_QUAD_MASK(execmask, q))
+         continue;
+
+      if (control == TGSI_SAMPLER_DERIVS_EXPLICIT) {
+         for (j = 0; j < 3; j++) {
+            memcpy(quad_derivs[j][0], &derivs[j][0][q], sizeof(quad_derivs[j][0]));
+            memcpy(quad_derivs[j][1], &derivs[j][1][q], sizeof(quad_derivs[j][1]));
+         }
+      }
 
-   for (j = 0; j < 4; j++) {
-      r->f[j] = rgba[0][j];
-      g->f[j] = rgba[1][j];
-      b->f[j] = rgba[2][j];
-      a->f[j] = rgba[3][j];
+      /* FIXME: handle explicit derivs, offsets */
+      sampler->get_samples(sampler, sview_idx, sampler_idx,
+                           &s->f[q], &t->f[q], &p->f[q], &c0->f[q], &c1->f[q],
+                           quad_derivs, offset, control, rgba);
+
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         r->f[q + j] = rgba[0][j];
+         g->f[q + j] = rgba[1][j];
+         b->f[q + j] = rgba[2][j];
+         a->f[q + j] = rgba[3][j];
+      }
    }
 }
 
@@ -2207,7 +2041,8 @@ fetch_texel_offsets(struct tgsi_exec_machine *mach,
    if (inst->Texture.NumOffsets == 1) {
       union tgsi_exec_channel index;
       union tgsi_exec_channel offset[3];
-      index.i[0] = index.i[1] = index.i[2] = index.i[3] = inst->TexOffsets[0].Index;
+      for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+         index.i[i] = inst->TexOffsets[0].Index;
       fetch_src_file_channel(mach, inst->TexOffsets[0].File,
                              inst->TexOffsets[0].SwizzleX, &index, &ZeroVec, &offset[0]);
       fetch_src_file_channel(mach, inst->TexOffsets[0].File,
@@ -2233,19 +2068,13 @@ fetch_assign_deriv_channel(struct tgsi_exec_machine *mach,
                            const struct tgsi_full_instruction *inst,
                            unsigned regdsrcx,
                            unsigned chan,
-                           float derivs[2][TGSI_QUAD_SIZE])
+                           float derivs[2][TGSI_EXEC_WIDTH])
 {
    union tgsi_exec_channel d;
    FETCH(&d, regdsrcx, chan);
-   derivs[0][0] = d.f[0];
-   derivs[0][1] = d.f[1];
-   derivs[0][2] = d.f[2];
-   derivs[0][3] = d.f[3];
+   memcpy(derivs[0], d.f, sizeof(derivs[0]));
    FETCH(&d, regdsrcx + 1, chan);
-   derivs[1][0] = d.f[0];
-   derivs[1][1] = d.f[1];
-   derivs[1][2] = d.f[2];
-   derivs[1][3] = d.f[3];
+   memcpy(derivs[1], d.f, sizeof(derivs[1]));
 }
 
 static uint
@@ -2259,10 +2088,8 @@ fetch_sampler_unit(struct tgsi_exec_machine *mach,
       const struct tgsi_full_src_register *reg = &inst->Src[sampler];
       union tgsi_exec_channel indir_index, index2;
       const uint execmask = mach->ExecMask;
-      index2.i[0] =
-      index2.i[1] =
-      index2.i[2] =
-      index2.i[3] = reg->Indirect.Index;
+      for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+         index2.i[i] = reg->Indirect.Index;
 
       fetch_src_file_channel(mach,
                              reg->Indirect.File,
@@ -2270,7 +2097,7 @@ fetch_sampler_unit(struct tgsi_exec_machine *mach,
                              &index2,
                              &ZeroVec,
                              &indir_index);
-      for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
          if (execmask & (1 << i)) {
             unit = inst->Src[sampler].Register.Index + indir_index.i[i];
             break;
@@ -2374,7 +2201,7 @@ exec_tex(struct tgsi_exec_machine *mach,
       args[shadow_ref] = &r[shadow_ref];
    }
 
-   fetch_texel(mach->Sampler, unit, unit,
+   fetch_texel(mach, unit, unit,
          args[0], args[1], args[2], args[3], args[4],
          NULL, offsets, control,
          &r[0], &r[1], &r[2], &r[3]);     /* R, G, B, A */
@@ -2426,14 +2253,16 @@ exec_lodq(struct tgsi_exec_machine *mach,
    for (i = dim; i < ARRAY_SIZE(coords); i++) {
       args[i] = &ZeroVec;
    }
-   mach->Sampler->query_lod(mach->Sampler, resource_unit, sampler_unit,
-                            args[0]->f,
-                            args[1]->f,
-                            args[2]->f,
-                            args[3]->f,
-                            TGSI_SAMPLER_LOD_NONE,
-                            r[0].f,
-                            r[1].f);
+   for (i = 0; i < TGSI_EXEC_WIDTH; i += TGSI_QUAD_SIZE) {
+      mach->Sampler->query_lod(mach->Sampler, resource_unit, sampler_unit,
+                               &args[0]->f[i],
+                               &args[1]->f[i],
+                               &args[2]->f[i],
+                               &args[3]->f[i],
+                               TGSI_SAMPLER_LOD_NONE,
+                               &r[0].f[i],
+                               &r[1].f[i]);
+   }
 
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_X) {
       store_dest(mach, &r[0], &inst->Dst[0], inst, TGSI_CHAN_X,
@@ -2479,7 +2308,7 @@ exec_txd(struct tgsi_exec_machine *mach,
          const struct tgsi_full_instruction *inst)
 {
    union tgsi_exec_channel r[4];
-   float derivs[3][2][TGSI_QUAD_SIZE];
+   float derivs[3][2][TGSI_EXEC_WIDTH];
    uint chan;
    uint unit;
    int8_t offsets[3];
@@ -2494,7 +2323,7 @@ exec_txd(struct tgsi_exec_machine *mach,
 
       fetch_assign_deriv_channel(mach, inst, 1, TGSI_CHAN_X, derivs[0]);
 
-      fetch_texel(mach->Sampler, unit, unit,
+      fetch_texel(mach, unit, unit,
                   &r[0], &ZeroVec, &ZeroVec, &ZeroVec, &ZeroVec,   /* S, T, P, C, LOD */
                   derivs, offsets, TGSI_SAMPLER_DERIVS_EXPLICIT,
                   &r[0], &r[1], &r[2], &r[3]);           /* R, G, B, A */
@@ -2510,7 +2339,7 @@ exec_txd(struct tgsi_exec_machine *mach,
 
       fetch_assign_deriv_channel(mach, inst, 1, TGSI_CHAN_X, derivs[0]);
 
-      fetch_texel(mach->Sampler, unit, unit,
+      fetch_texel(mach, unit, unit,
                   &r[0], &r[1], &r[2], &ZeroVec, &ZeroVec,   /* S, T, P, C, LOD */
                   derivs, offsets, TGSI_SAMPLER_DERIVS_EXPLICIT,
                   &r[0], &r[1], &r[2], &r[3]);           /* R, G, B, A */
@@ -2524,7 +2353,7 @@ exec_txd(struct tgsi_exec_machine *mach,
       fetch_assign_deriv_channel(mach, inst, 1, TGSI_CHAN_X, derivs[0]);
       fetch_assign_deriv_channel(mach, inst, 1, TGSI_CHAN_Y, derivs[1]);
 
-      fetch_texel(mach->Sampler, unit, unit,
+      fetch_texel(mach, unit, unit,
                   &r[0], &r[1], &ZeroVec, &ZeroVec, &ZeroVec,   /* S, T, P, C, LOD */
                   derivs, offsets, TGSI_SAMPLER_DERIVS_EXPLICIT,
                   &r[0], &r[1], &r[2], &r[3]);           /* R, G, B, A */
@@ -2544,7 +2373,7 @@ exec_txd(struct tgsi_exec_machine *mach,
       fetch_assign_deriv_channel(mach, inst, 1, TGSI_CHAN_X, derivs[0]);
       fetch_assign_deriv_channel(mach, inst, 1, TGSI_CHAN_Y, derivs[1]);
 
-      fetch_texel(mach->Sampler, unit, unit,
+      fetch_texel(mach, unit, unit,
                   &r[0], &r[1], &r[2], &r[3], &ZeroVec,   /* inputs */
                   derivs, offsets, TGSI_SAMPLER_DERIVS_EXPLICIT,
                   &r[0], &r[1], &r[2], &r[3]);     /* outputs */
@@ -2564,7 +2393,7 @@ exec_txd(struct tgsi_exec_machine *mach,
       fetch_assign_deriv_channel(mach, inst, 1, TGSI_CHAN_Y, derivs[1]);
       fetch_assign_deriv_channel(mach, inst, 1, TGSI_CHAN_Z, derivs[2]);
 
-      fetch_texel(mach->Sampler, unit, unit,
+      fetch_texel(mach, unit, unit,
                   &r[0], &r[1], &r[2], &r[3], &ZeroVec,   /* inputs */
                   derivs, offsets, TGSI_SAMPLER_DERIVS_EXPLICIT,
                   &r[0], &r[1], &r[2], &r[3]);     /* outputs */
@@ -2590,7 +2419,7 @@ exec_txf(struct tgsi_exec_machine *mach,
    uint chan;
    uint unit;
    float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
-   int j;
+   int j, q;
    int8_t offsets[3];
    unsigned target;
 
@@ -2633,14 +2462,20 @@ exec_txf(struct tgsi_exec_machine *mach,
       break;
    }      
 
-   mach->Sampler->get_texel(mach->Sampler, unit, r[0].i, r[1].i, r[2].i, r[3].i,
-                            offsets, rgba);
+   for (q = 0; q < TGSI_EXEC_WIDTH; q += TGSI_QUAD_SIZE) {
+      if (!TGSI_EXEC_QUAD_MASK(mach->ExecMask, q))
+         continue;
+
+      mach->Sampler->get_texel(mach->Sampler, unit,
+                               &r[0].i[q], &r[1].i[q], &r[2].i[q], &r[3].i[q],
+                               offsets, rgba);
 
-   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-      r[0].f[j] = rgba[0][j];
-      r[1].f[j] = rgba[1][j];
-      r[2].f[j] = rgba[2][j];
-      r[3].f[j] = rgba[3][j];
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         r[0].f[q + j] = rgba[0][j];
+         r[1].f[q + j] = rgba[1][j];
+         r[2].f[q + j] = rgba[2][j];
+         r[3].f[q + j] = rgba[3][j];
+      }
    }
 
    if (inst->Instruction.Opcode == TGSI_OPCODE_SAMPLE_I ||
@@ -2684,7 +2519,7 @@ exec_txq(struct tgsi_exec_machine *mach,
    /* XXX: This interface can't return per-pixel values */
    mach->Sampler->get_dims(mach->Sampler, unit, src.i[0], result);
 
-   for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+   for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
       for (j = 0; j < 4; j++) {
          r[j].i[i] = result[j];
       }
@@ -2743,13 +2578,13 @@ exec_sample(struct tgsi_exec_machine *mach,
    case TGSI_TEXTURE_1D:
       if (compare) {
          FETCH(&r[2], 3, TGSI_CHAN_X);
-         fetch_texel(mach->Sampler, resource_unit, sampler_unit,
+         fetch_texel(mach, resource_unit, sampler_unit,
                      &r[0], &ZeroVec, &r[2], &ZeroVec, lod, /* S, T, P, C, LOD */
                      NULL, offsets, control,
                      &r[0], &r[1], &r[2], &r[3]);     /* R, G, B, A */
       }
       else {
-         fetch_texel(mach->Sampler, resource_unit, sampler_unit,
+         fetch_texel(mach, resource_unit, sampler_unit,
                      &r[0], &ZeroVec, &ZeroVec, &ZeroVec, lod, /* S, T, P, C, LOD */
                      NULL, offsets, control,
                      &r[0], &r[1], &r[2], &r[3]);     /* R, G, B, A */
@@ -2762,13 +2597,13 @@ exec_sample(struct tgsi_exec_machine *mach,
       FETCH(&r[1], 0, TGSI_CHAN_Y);
       if (compare) {
          FETCH(&r[2], 3, TGSI_CHAN_X);
-         fetch_texel(mach->Sampler, resource_unit, sampler_unit,
+         fetch_texel(mach, resource_unit, sampler_unit,
                      &r[0], &r[1], &r[2], &ZeroVec, lod,    /* S, T, P, C, LOD */
                      NULL, offsets, control,
                      &r[0], &r[1], &r[2], &r[3]);  /* outputs */
       }
       else {
-         fetch_texel(mach->Sampler, resource_unit, sampler_unit,
+         fetch_texel(mach, resource_unit, sampler_unit,
                      &r[0], &r[1], &ZeroVec, &ZeroVec, lod,    /* S, T, P, C, LOD */
                      NULL, offsets, control,
                      &r[0], &r[1], &r[2], &r[3]);  /* outputs */
@@ -2782,13 +2617,13 @@ exec_sample(struct tgsi_exec_machine *mach,
       FETCH(&r[2], 0, TGSI_CHAN_Z);
       if(compare) {
          FETCH(&r[3], 3, TGSI_CHAN_X);
-         fetch_texel(mach->Sampler, resource_unit, sampler_unit,
+         fetch_texel(mach, resource_unit, sampler_unit,
                      &r[0], &r[1], &r[2], &r[3], lod,
                      NULL, offsets, control,
                      &r[0], &r[1], &r[2], &r[3]);
       }
       else {
-         fetch_texel(mach->Sampler, resource_unit, sampler_unit,
+         fetch_texel(mach, resource_unit, sampler_unit,
                      &r[0], &r[1], &r[2], &ZeroVec, lod,
                      NULL, offsets, control,
                      &r[0], &r[1], &r[2], &r[3]);
@@ -2801,13 +2636,13 @@ exec_sample(struct tgsi_exec_machine *mach,
       FETCH(&r[3], 0, TGSI_CHAN_W);
       if(compare) {
          FETCH(&r[4], 3, TGSI_CHAN_X);
-         fetch_texel(mach->Sampler, resource_unit, sampler_unit,
+         fetch_texel(mach, resource_unit, sampler_unit,
                      &r[0], &r[1], &r[2], &r[3], &r[4],
                      NULL, offsets, control,
                      &r[0], &r[1], &r[2], &r[3]);
       }
       else {
-         fetch_texel(mach->Sampler, resource_unit, sampler_unit,
+         fetch_texel(mach, resource_unit, sampler_unit,
                      &r[0], &r[1], &r[2], &r[3], lod,
                      NULL, offsets, control,
                      &r[0], &r[1], &r[2], &r[3]);
@@ -2839,7 +2674,7 @@ exec_sample_d(struct tgsi_exec_machine *mach,
    const uint resource_unit = inst->Src[1].Register.Index;
    const uint sampler_unit = inst->Src[2].Register.Index;
    union tgsi_exec_channel r[4];
-   float derivs[3][2][TGSI_QUAD_SIZE];
+   float derivs[3][2][TGSI_EXEC_WIDTH];
    uint chan;
    unsigned char swizzles[4];
    int8_t offsets[3];
@@ -2857,7 +2692,7 @@ exec_sample_d(struct tgsi_exec_machine *mach,
 
       fetch_assign_deriv_channel(mach, inst, 3, TGSI_CHAN_X, derivs[0]);
 
-      fetch_texel(mach->Sampler, resource_unit, sampler_unit,
+      fetch_texel(mach, resource_unit, sampler_unit,
                   &r[0], &r[1], &ZeroVec, &ZeroVec, &ZeroVec,   /* S, T, P, C, LOD */
                   derivs, offsets, TGSI_SAMPLER_DERIVS_EXPLICIT,
                   &r[0], &r[1], &r[2], &r[3]);           /* R, G, B, A */
@@ -2873,7 +2708,7 @@ exec_sample_d(struct tgsi_exec_machine *mach,
       fetch_assign_deriv_channel(mach, inst, 3, TGSI_CHAN_X, derivs[0]);
       fetch_assign_deriv_channel(mach, inst, 3, TGSI_CHAN_Y, derivs[1]);
 
-      fetch_texel(mach->Sampler, resource_unit, sampler_unit,
+      fetch_texel(mach, resource_unit, sampler_unit,
                   &r[0], &r[1], &r[2], &ZeroVec, &ZeroVec,   /* inputs */
                   derivs, offsets, TGSI_SAMPLER_DERIVS_EXPLICIT,
                   &r[0], &r[1], &r[2], &r[3]);     /* outputs */
@@ -2891,7 +2726,7 @@ exec_sample_d(struct tgsi_exec_machine *mach,
       fetch_assign_deriv_channel(mach, inst, 3, TGSI_CHAN_Y, derivs[1]);
       fetch_assign_deriv_channel(mach, inst, 3, TGSI_CHAN_Z, derivs[2]);
 
-      fetch_texel(mach->Sampler, resource_unit, sampler_unit,
+      fetch_texel(mach, resource_unit, sampler_unit,
                   &r[0], &r[1], &r[2], &r[3], &ZeroVec,
                   derivs, offsets, TGSI_SAMPLER_DERIVS_EXPLICIT,
                   &r[0], &r[1], &r[2], &r[3]);
@@ -2959,10 +2794,8 @@ interp_linear_offset(
    const float dadx = mach->InterpCoefs[attrib].dadx[chan];
    const float dady = mach->InterpCoefs[attrib].dady[chan];
    const float delta = ofs_x * dadx + ofs_y * dady;
-   out_chan->f[0] += delta;
-   out_chan->f[1] += delta;
-   out_chan->f[2] += delta;
-   out_chan->f[3] += delta;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      out_chan->f[i] += delta;
 }
 
 static void
@@ -3371,7 +3204,7 @@ exec_pk2h(struct tgsi_exec_machine *mach,
 
    fetch_source(mach, &arg[0], &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    fetch_source(mach, &arg[1], &inst->Src[0], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
-   for (chan = 0; chan < TGSI_QUAD_SIZE; chan++) {
+   for (chan = 0; chan < TGSI_EXEC_WIDTH; chan++) {
       dst.u[chan] = util_float_to_half(arg[0].f[chan]) |
          (util_float_to_half(arg[1].f[chan]) << 16);
    }
@@ -3390,7 +3223,7 @@ exec_up2h(struct tgsi_exec_machine *mach,
    union tgsi_exec_channel arg, dst[2];
 
    fetch_source(mach, &arg, &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_UINT);
-   for (chan = 0; chan < TGSI_QUAD_SIZE; chan++) {
+   for (chan = 0; chan < TGSI_EXEC_WIDTH; chan++) {
       dst[0].f[chan] = util_half_to_float(arg.u[chan] & 0xffff);
       dst[1].f[chan] = util_half_to_float(arg.u[chan] >> 16);
    }
@@ -3407,10 +3240,8 @@ micro_ucmp(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src1,
            const union tgsi_exec_channel *src2)
 {
-   dst->f[0] = src0->u[0] ? src1->f[0] : src2->f[0];
-   dst->f[1] = src0->u[1] ? src1->f[1] : src2->f[1];
-   dst->f[2] = src0->u[2] ? src1->f[2] : src2->f[2];
-   dst->f[3] = src0->u[3] ? src1->f[3] : src2->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = src0->u[i] ? src1->f[i] : src2->f[i];
 }
 
 static void
@@ -3604,17 +3435,10 @@ exec_case(struct tgsi_exec_machine *mach,
 
    fetch_source(mach, &src, &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_UINT);
 
-   if (mach->Switch.selector.u[0] == src.u[0]) {
-      mask |= 0x1;
-   }
-   if (mach->Switch.selector.u[1] == src.u[1]) {
-      mask |= 0x2;
-   }
-   if (mach->Switch.selector.u[2] == src.u[2]) {
-      mask |= 0x4;
-   }
-   if (mach->Switch.selector.u[3] == src.u[3]) {
-      mask |= 0x8;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++) {
+      if (mach->Switch.selector.u[i] == src.u[i]) {
+         mask |= 1 << i;
+      }
    }
 
    mach->Switch.defaultMask |= mask;
@@ -3670,7 +3494,7 @@ fetch_double_channel(struct tgsi_exec_machine *mach,
    fetch_source_d(mach, &src[0], reg, chan_0);
    fetch_source_d(mach, &src[1], reg, chan_1);
 
-   for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+   for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
       chan->u[i][0] = src[0].u[i];
       chan->u[i][1] = src[1].u[i];
    }
@@ -3696,14 +3520,14 @@ store_double_channel(struct tgsi_exec_machine *mach,
    const uint execmask = mach->ExecMask;
 
    if (!inst->Instruction.Saturate) {
-      for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++)
          if (execmask & (1 << i)) {
             dst[0].u[i] = chan->u[i][0];
             dst[1].u[i] = chan->u[i][1];
          }
    }
    else {
-      for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++)
          if (execmask & (1 << i)) {
             if (chan->d[i] < 0.0)
                temp.d[i] = 0.0;
@@ -3934,19 +3758,19 @@ exec_load_img(struct tgsi_exec_machine *mach,
    union tgsi_exec_channel r[4], sample_r;
    uint unit;
    int sample;
-   int i, j;
+   int i, j, q;
    int dim;
    uint chan;
    float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
    struct tgsi_image_params params;
    int kilmask = mach->Temps[TEMP_KILMASK_I].xyzw[TEMP_KILMASK_C].u[0];
+   uint execmask = mach->ExecMask & mach->NonHelperMask & ~kilmask;
 
    unit = fetch_sampler_unit(mach, inst, 0);
    dim = get_image_coord_dim(inst->Memory.Texture);
    sample = get_image_coord_sample(inst->Memory.Texture);
    assert(dim <= 3);
 
-   params.execmask = mach->ExecMask & mach->NonHelperMask & ~kilmask;
    params.unit = unit;
    params.tgsi_tex_instr = inst->Memory.Texture;
    params.format = inst->Memory.Format;
@@ -3958,14 +3782,20 @@ exec_load_img(struct tgsi_exec_machine *mach,
    if (sample)
       IFETCH(&sample_r, 1, TGSI_CHAN_X + sample);
 
-   mach->Image->load(mach->Image, &params,
-                     r[0].i, r[1].i, r[2].i, sample_r.i,
-                     rgba);
-   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-      r[0].f[j] = rgba[0][j];
-      r[1].f[j] = rgba[1][j];
-      r[2].f[j] = rgba[2][j];
-      r[3].f[j] = rgba[3][j];
+   for (q = 0; q < TGSI_EXEC_WIDTH; q += TGSI_QUAD_SIZE) {
+      params.execmask = TGSI_EXEC_QUAD_MASK(execmask, q);
+      if (!params.execmask)
+         continue;
+
+      mach->Image->load(mach->Image, &params,
+                        &r[0].i[q], &r[1].i[q], &r[2].i[q], &sample_r.i[q],
+                        rgba);
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         r[0].f[q + j] = rgba[0][j];
+         r[1].f[q + j] = rgba[1][j];
+         r[2].f[q + j] = rgba[2][j];
+         r[3].f[q + j] = rgba[3][j];
+      }
    }
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
@@ -3980,25 +3810,31 @@ exec_load_buf(struct tgsi_exec_machine *mach,
 {
    union tgsi_exec_channel r[4];
    uint unit;
-   int j;
+   int j, q;
    uint chan;
    float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
    struct tgsi_buffer_params params;
    int kilmask = mach->Temps[TEMP_KILMASK_I].xyzw[TEMP_KILMASK_C].u[0];
+   uint execmask = mach->ExecMask & mach->NonHelperMask & ~kilmask;
 
    unit = fetch_sampler_unit(mach, inst, 0);
 
-   params.execmask = mach->ExecMask & mach->NonHelperMask & ~kilmask;
    params.unit = unit;
    IFETCH(&r[0], 1, TGSI_CHAN_X);
 
-   mach->Buffer->load(mach->Buffer, &params,
-                      r[0].i, rgba);
-   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-      r[0].f[j] = rgba[0][j];
-      r[1].f[j] = rgba[1][j];
-      r[2].f[j] = rgba[2][j];
-      r[3].f[j] = rgba[3][j];
+   for (q = 0; q < TGSI_EXEC_WIDTH; q += TGSI_QUAD_SIZE) {
+      params.execmask = TGSI_EXEC_QUAD_MASK(execmask, q);
+      if (!params.execmask)
+         continue;
+
+      mach->Buffer->load(mach->Buffer, &params,
+                         &r[0].i[q], rgba);
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         r[0].f[q + j] = rgba[0][j];
+         r[1].f[q + j] = rgba[1][j];
+         r[2].f[q + j] = rgba[2][j];
+         r[3].f[q + j] = rgba[3][j];
+      }
    }
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
@@ -4024,7 +3860,7 @@ exec_load_mem(struct tgsi_exec_machine *mach,
    offset = r[0].u[0];
    ptr += offset;
 
-   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+   for (j = 0; j < TGSI_EXEC_WIDTH; j++) {
       for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
          if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
             memcpy(&r[chan].u[j], ptr + (4 * chan), 4);
@@ -4060,10 +3896,8 @@ fetch_store_img_unit(struct tgsi_exec_machine *mach,
    if (dst->Register.Indirect) {
       union tgsi_exec_channel indir_index, index2;
       const uint execmask = mach->ExecMask;
-      index2.i[0] =
-      index2.i[1] =
-      index2.i[2] =
-      index2.i[3] = dst->Indirect.Index;
+      for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+         index2.i[i] = dst->Indirect.Index;
 
       fetch_src_file_channel(mach,
                              dst->Indirect.File,
@@ -4071,7 +3905,7 @@ fetch_store_img_unit(struct tgsi_exec_machine *mach,
                              &index2,
                              &ZeroVec,
                              &indir_index);
-      for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
          if (execmask & (1 << i)) {
             unit = dst->Register.Index + indir_index.i[i];
             break;
@@ -4093,15 +3927,15 @@ exec_store_img(struct tgsi_exec_machine *mach,
    struct tgsi_image_params params;
    int dim;
    int sample;
-   int i, j;
+   int i, j, q;
    uint unit;
    int kilmask = mach->Temps[TEMP_KILMASK_I].xyzw[TEMP_KILMASK_C].u[0];
+   uint execmask = mach->ExecMask & mach->NonHelperMask & ~kilmask;
    unit = fetch_store_img_unit(mach, &inst->Dst[0]);
    dim = get_image_coord_dim(inst->Memory.Texture);
    sample = get_image_coord_sample(inst->Memory.Texture);
    assert(dim <= 3);
 
-   params.execmask = mach->ExecMask & mach->NonHelperMask & ~kilmask;
    params.unit = unit;
    params.tgsi_tex_instr = inst->Memory.Texture;
    params.format = inst->Memory.Format;
@@ -4116,16 +3950,22 @@ exec_store_img(struct tgsi_exec_machine *mach,
    if (sample)
       IFETCH(&sample_r, 0, TGSI_CHAN_X + sample);
 
-   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-      rgba[0][j] = value[0].f[j];
-      rgba[1][j] = value[1].f[j];
-      rgba[2][j] = value[2].f[j];
-      rgba[3][j] = value[3].f[j];
-   }
+   for (q = 0; q < TGSI_EXEC_WIDTH; q += TGSI_QUAD_SIZE) {
+      params.execmask = TGSI_EXEC_QUAD_MASK(execmask, q);
+      if (!params.execmask)
+         continue;
 
-   mach->Image->store(mach->Image, &params,
-                      r[0].i, r[1].i, r[2].i, sample_r.i,
-                      rgba);
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         rgba[0][j] = value[0].f[q + j];
+         rgba[1][j] = value[1].f[q + j];
+         rgba[2][j] = value[2].f[q + j];
+         rgba[3][j] = value[3].f[q + j];
+      }
+
+      mach->Image->store(mach->Image, &params,
+                         &r[0].i[q], &r[1].i[q], &r[2].i[q], &sample_r.i[q],
+                         rgba);
+   }
 }
 
 static void
@@ -4136,13 +3976,13 @@ exec_store_buf(struct tgsi_exec_machine *mach,
    union tgsi_exec_channel value[4];
    float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
    struct tgsi_buffer_params params;
-   int i, j;
+   int i, j, q;
    uint unit;
    int kilmask = mach->Temps[TEMP_KILMASK_I].xyzw[TEMP_KILMASK_C].u[0];
+   uint execmask = mach->ExecMask & mach->NonHelperMask & ~kilmask;
 
    unit = fetch_store_img_unit(mach, &inst->Dst[0]);
 
-   params.execmask = mach->ExecMask & mach->NonHelperMask & ~kilmask;
    params.unit = unit;
    params.writemask = inst->Dst[0].Register.WriteMask;
 
@@ -4151,16 +3991,22 @@ exec_store_buf(struct tgsi_exec_machine *mach,
       FETCH(&value[i], 1, TGSI_CHAN_X + i);
    }
 
-   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-      rgba[0][j] = value[0].f[j];
-      rgba[1][j] = value[1].f[j];
-      rgba[2][j] = value[2].f[j];
-      rgba[3][j] = value[3].f[j];
-   }
+   for (q = 0; q < TGSI_EXEC_WIDTH; q += TGSI_QUAD_SIZE) {
+      params.execmask = TGSI_EXEC_QUAD_MASK(execmask, q);
+      if (!params.execmask)
+         continue;
 
-   mach->Buffer->store(mach->Buffer, &params,
-                      r[0].i,
-                      rgba);
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         rgba[0][j] = value[0].f[q + j];
+         rgba[1][j] = value[1].f[q + j];
+         rgba[2][j] = value[2].f[q + j];
+         rgba[3][j] = value[3].f[q + j];
+      }
+
+      mach->Buffer->store(mach->Buffer, &params,
+                          &r[0].i[q],
+                          rgba);
+   }
 }
 
 static void
@@ -4184,7 +4030,7 @@ exec_store_mem(struct tgsi_exec_machine *mach,
       return;
    ptr += r[0].u[0];
 
-   for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+   for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
       if (execmask & (1 << i)) {
          for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
             if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
@@ -4218,15 +4064,15 @@ exec_atomop_img(struct tgsi_exec_machine *mach,
    struct tgsi_image_params params;
    int dim;
    int sample;
-   int i, j;
+   int i, j, q;
    uint unit, chan;
    int kilmask = mach->Temps[TEMP_KILMASK_I].xyzw[TEMP_KILMASK_C].u[0];
+   uint execmask = mach->ExecMask & mach->NonHelperMask & ~kilmask;
    unit = fetch_sampler_unit(mach, inst, 0);
    dim = get_image_coord_dim(inst->Memory.Texture);
    sample = get_image_coord_sample(inst->Memory.Texture);
    assert(dim <= 3);
 
-   params.execmask = mach->ExecMask & mach->NonHelperMask & ~kilmask;
    params.unit = unit;
    params.tgsi_tex_instr = inst->Memory.Texture;
    params.format = inst->Memory.Format;
@@ -4243,30 +4089,36 @@ exec_atomop_img(struct tgsi_exec_machine *mach,
    if (sample)
       IFETCH(&sample_r, 1, TGSI_CHAN_X + sample);
 
-   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-      rgba[0][j] = value[0].f[j];
-      rgba[1][j] = value[1].f[j];
-      rgba[2][j] = value[2].f[j];
-      rgba[3][j] = value[3].f[j];
-   }
-   if (inst->Instruction.Opcode == TGSI_OPCODE_ATOMCAS) {
+   for (q = 0; q < TGSI_EXEC_WIDTH; q += TGSI_QUAD_SIZE) {
+      params.execmask = TGSI_EXEC_QUAD_MASK(execmask, q);
+      if (!params.execmask)
+         continue;
+
       for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-         rgba2[0][j] = value2[0].f[j];
-         rgba2[1][j] = value2[1].f[j];
-         rgba2[2][j] = value2[2].f[j];
-         rgba2[3][j] = value2[3].f[j];
+         rgba[0][j] = value[0].f[q + j];
+         rgba[1][j] = value[1].f[q + j];
+         rgba[2][j] = value[2].f[q + j];
+         rgba[3][j] = value[3].f[q + j];
+      }
+      if (inst->Instruction.Opcode == TGSI_OPCODE_ATOMCAS) {
+         for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+            rgba2[0][j] = value2[0].f[q + j];
+            rgba2[1][j] = value2[1].f[q + j];
+            rgba2[2][j] = value2[2].f[q + j];
+            rgba2[3][j] = value2[3].f[q + j];
+         }
       }
-   }
 
-   mach->Image->op(mach->Image, &params, inst->Instruction.Opcode,
-                   r[0].i, r[1].i, r[2].i, sample_r.i,
-                   rgba, rgba2);
+      mach->Image->op(mach->Image, &params, inst->Instruction.Opcode,
+                      &r[0].i[q], &r[1].i[q], &r[2].i[q], &sample_r.i[q],
+                      rgba, rgba2);
 
-   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-      r[0].f[j] = rgba[0][j];
-      r[1].f[j] = rgba[1][j];
-      r[2].f[j] = rgba[2][j];
-      r[3].f[j] = rgba[3][j];
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         r[0].f[q + j] = rgba[0][j];
+         r[1].f[q + j] = rgba[1][j];
+         r[2].f[q + j] = rgba[2][j];
+         r[3].f[q + j] = rgba[3][j];
+      }
    }
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
@@ -4284,13 +4136,13 @@ exec_atomop_buf(struct tgsi_exec_machine *mach,
    float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
    float rgba2[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
    struct tgsi_buffer_params params;
-   int i, j;
+   int i, j, q;
    uint unit, chan;
    int kilmask = mach->Temps[TEMP_KILMASK_I].xyzw[TEMP_KILMASK_C].u[0];
+   uint execmask = mach->ExecMask & mach->NonHelperMask & ~kilmask;
 
    unit = fetch_sampler_unit(mach, inst, 0);
 
-   params.execmask = mach->ExecMask & mach->NonHelperMask & ~kilmask;
    params.unit = unit;
    params.writemask = inst->Dst[0].Register.WriteMask;
 
@@ -4302,30 +4154,36 @@ exec_atomop_buf(struct tgsi_exec_machine *mach,
          FETCH(&value2[i], 3, TGSI_CHAN_X + i);
    }
 
-   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-      rgba[0][j] = value[0].f[j];
-      rgba[1][j] = value[1].f[j];
-      rgba[2][j] = value[2].f[j];
-      rgba[3][j] = value[3].f[j];
-   }
-   if (inst->Instruction.Opcode == TGSI_OPCODE_ATOMCAS) {
+   for (q = 0; q < TGSI_EXEC_WIDTH; q += TGSI_QUAD_SIZE) {
+      params.execmask = TGSI_EXEC_QUAD_MASK(execmask, q);
+      if (!params.execmask)
+         continue;
+
       for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-         rgba2[0][j] = value2[0].f[j];
-         rgba2[1][j] = value2[1].f[j];
-         rgba2[2][j] = value2[2].f[j];
-         rgba2[3][j] = value2[3].f[j];
+         rgba[0][j] = value[0].f[q + j];
+         rgba[1][j] = value[1].f[q + j];
+         rgba[2][j] = value[2].f[q + j];
+         rgba[3][j] = value[3].f[q + j];
+      }
+      if (inst->Instruction.Opcode == TGSI_OPCODE_ATOMCAS) {
+         for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+            rgba2[0][j] = value2[0].f[q + j];
+            rgba2[1][j] = value2[1].f[q + j];
+            rgba2[2][j] = value2[2].f[q + j];
+            rgba2[3][j] = value2[3].f[q + j];
+         }
       }
-   }
 
-   mach->Buffer->op(mach->Buffer, &params, inst->Instruction.Opcode,
-                   r[0].i,
-                   rgba, rgba2);
+      mach->Buffer->op(mach->Buffer, &params, inst->Instruction.Opcode,
+                       &r[0].i[q],
+                       rgba, rgba2);
 
-   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-      r[0].f[j] = rgba[0][j];
-      r[1].f[j] = rgba[1][j];
-      r[2].f[j] = rgba[2][j];
-      r[3].f[j] = rgba[3][j];
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         r[0].f[q + j] = rgba[0][j];
+         r[1].f[q + j] = rgba[1][j];
+         r[2].f[q + j] = rgba[2][j];
+         r[3].f[q + j] = rgba[3][j];
+      }
    }
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
@@ -4399,7 +4257,7 @@ exec_atomop_mem(struct tgsi_exec_machine *mach,
    default:
       break;
    }
-   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+   for (i = 0; i < TGSI_EXEC_WIDTH; i++)
       if (execmask & (1 << i))
          memcpy(ptr, &val, 4);
 
@@ -4442,7 +4300,7 @@ exec_resq_img(struct tgsi_exec_machine *mach,
 
    mach->Image->get_dims(mach->Image, &params, result);
 
-   for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+   for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
       for (j = 0; j < 4; j++) {
          r[j].i[i] = result[j];
       }
@@ -4474,7 +4332,7 @@ exec_resq_buf(struct tgsi_exec_machine *mach,
 
    mach->Buffer->get_dims(mach->Buffer, &params, &result);
 
-   for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+   for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
       r[0].i[i] = result;
    }
 
@@ -4500,100 +4358,80 @@ static void
 micro_f2u64(union tgsi_double_channel *dst,
             const union tgsi_exec_channel *src)
 {
-   dst->u64[0] = (uint64_t)src->f[0];
-   dst->u64[1] = (uint64_t)src->f[1];
-   dst->u64[2] = (uint64_t)src->f[2];
-   dst->u64[3] = (uint64_t)src->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u64[i] = (uint64_t)src->f[i];
 }
 
 static void
 micro_f2i64(union tgsi_double_channel *dst,
             const union tgsi_exec_channel *src)
 {
-   dst->i64[0] = (int64_t)src->f[0];
-   dst->i64[1] = (int64_t)src->f[1];
-   dst->i64[2] = (int64_t)src->f[2];
-   dst->i64[3] = (int64_t)src->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i64[i] = (int64_t)src->f[i];
 }
 
 static void
 micro_u2i64(union tgsi_double_channel *dst,
             const union tgsi_exec_channel *src)
 {
-   dst->u64[0] = (uint64_t)src->u[0];
-   dst->u64[1] = (uint64_t)src->u[1];
-   dst->u64[2] = (uint64_t)src->u[2];
-   dst->u64[3] = (uint64_t)src->u[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u64[i] = (uint64_t)src->u[i];
 }
 
 static void
 micro_i2i64(union tgsi_double_channel *dst,
             const union tgsi_exec_channel *src)
 {
-   dst->i64[0] = (int64_t)src->i[0];
-   dst->i64[1] = (int64_t)src->i[1];
-   dst->i64[2] = (int64_t)src->i[2];
-   dst->i64[3] = (int64_t)src->i[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i64[i] = (int64_t)src->i[i];
 }
 
 static void
 micro_d2u64(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->u64[0] = (uint64_t)src->d[0];
-   dst->u64[1] = (uint64_t)src->d[1];
-   dst->u64[2] = (uint64_t)src->d[2];
-   dst->u64[3] = (uint64_t)src->d[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u64[i] = (uint64_t)src->d[i];
 }
 
 static void
 micro_d2i64(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->i64[0] = (int64_t)src->d[0];
-   dst->i64[1] = (int64_t)src->d[1];
-   dst->i64[2] = (int64_t)src->d[2];
-   dst->i64[3] = (int64_t)src->d[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i64[i] = (int64_t)src->d[i];
 }
 
 static void
 micro_u642d(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->d[0] = (double)src->u64[0];
-   dst->d[1] = (double)src->u64[1];
-   dst->d[2] = (double)src->u64[2];
-   dst->d[3] = (double)src->u64[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = (double)src->u64[i];
 }
 
 static void
 micro_i642d(union tgsi_double_channel *dst,
            const union tgsi_double_channel *src)
 {
-   dst->d[0] = (double)src->i64[0];
-   dst->d[1] = (double)src->i64[1];
-   dst->d[2] = (double)src->i64[2];
-   dst->d[3] = (double)src->i64[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->d[i] = (double)src->i64[i];
 }
 
 static void
 micro_u642f(union tgsi_exec_channel *dst,
             const union tgsi_double_channel *src)
 {
-   dst->f[0] = (float)src->u64[0];
-   dst->f[1] = (float)src->u64[1];
-   dst->f[2] = (float)src->u64[2];
-   dst->f[3] = (float)src->u64[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = (float)src->u64[i];
 }
 
 static void
 micro_i642f(union tgsi_exec_channel *dst,
             const union tgsi_double_channel *src)
 {
-   dst->f[0] = (float)src->i64[0];
-   dst->f[1] = (float)src->i64[1];
-   dst->f[2] = (float)src->i64[2];
-   dst->f[3] = (float)src->i64[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = (float)src->i64[i];
 }
 
 static void
@@ -4646,20 +4484,16 @@ static void
 micro_i2f(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->f[0] = (float)src->i[0];
-   dst->f[1] = (float)src->i[1];
-   dst->f[2] = (float)src->i[2];
-   dst->f[3] = (float)src->i[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = (float)src->i[i];
 }
 
 static void
 micro_not(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->u[0] = ~src->u[0];
-   dst->u[1] = ~src->u[1];
-   dst->u[2] = ~src->u[2];
-   dst->u[3] = ~src->u[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = ~src->u[i];
 }
 
 static void
@@ -4668,14 +4502,10 @@ micro_shl(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src1)
 {
    unsigned masked_count;
-   masked_count = src1->u[0] & 0x1f;
-   dst->u[0] = src0->u[0] << masked_count;
-   masked_count = src1->u[1] & 0x1f;
-   dst->u[1] = src0->u[1] << masked_count;
-   masked_count = src1->u[2] & 0x1f;
-   dst->u[2] = src0->u[2] << masked_count;
-   masked_count = src1->u[3] & 0x1f;
-   dst->u[3] = src0->u[3] << masked_count;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++) {
+      masked_count = src1->u[i] & 0x1f;
+      dst->u[i] = src0->u[i] << masked_count;
+   }
 }
 
 static void
@@ -4683,10 +4513,8 @@ micro_and(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src0->u[0] & src1->u[0];
-   dst->u[1] = src0->u[1] & src1->u[1];
-   dst->u[2] = src0->u[2] & src1->u[2];
-   dst->u[3] = src0->u[3] & src1->u[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->u[i] & src1->u[i];
 }
 
 static void
@@ -4694,10 +4522,8 @@ micro_or(union tgsi_exec_channel *dst,
          const union tgsi_exec_channel *src0,
          const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src0->u[0] | src1->u[0];
-   dst->u[1] = src0->u[1] | src1->u[1];
-   dst->u[2] = src0->u[2] | src1->u[2];
-   dst->u[3] = src0->u[3] | src1->u[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->u[i] | src1->u[i];
 }
 
 static void
@@ -4705,10 +4531,8 @@ micro_xor(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src0->u[0] ^ src1->u[0];
-   dst->u[1] = src0->u[1] ^ src1->u[1];
-   dst->u[2] = src0->u[2] ^ src1->u[2];
-   dst->u[3] = src0->u[3] ^ src1->u[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->u[i] ^ src1->u[i];
 }
 
 static void
@@ -4716,20 +4540,16 @@ micro_mod(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
-   dst->i[0] = src1->i[0] ? src0->i[0] % src1->i[0] : ~0;
-   dst->i[1] = src1->i[1] ? src0->i[1] % src1->i[1] : ~0;
-   dst->i[2] = src1->i[2] ? src0->i[2] % src1->i[2] : ~0;
-   dst->i[3] = src1->i[3] ? src0->i[3] % src1->i[3] : ~0;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = src1->i[i] ? src0->i[i] % src1->i[i] : ~0;
 }
 
 static void
 micro_f2i(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->i[0] = (int)src->f[0];
-   dst->i[1] = (int)src->f[1];
-   dst->i[2] = (int)src->f[2];
-   dst->i[3] = (int)src->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = (int)src->f[i];
 }
 
 static void
@@ -4737,10 +4557,8 @@ micro_fseq(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src0->f[0] == src1->f[0] ? ~0 : 0;
-   dst->u[1] = src0->f[1] == src1->f[1] ? ~0 : 0;
-   dst->u[2] = src0->f[2] == src1->f[2] ? ~0 : 0;
-   dst->u[3] = src0->f[3] == src1->f[3] ? ~0 : 0;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->f[i] == src1->f[i] ? ~0 : 0;
 }
 
 static void
@@ -4748,10 +4566,8 @@ micro_fsge(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src0->f[0] >= src1->f[0] ? ~0 : 0;
-   dst->u[1] = src0->f[1] >= src1->f[1] ? ~0 : 0;
-   dst->u[2] = src0->f[2] >= src1->f[2] ? ~0 : 0;
-   dst->u[3] = src0->f[3] >= src1->f[3] ? ~0 : 0;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->f[i] >= src1->f[i] ? ~0 : 0;
 }
 
 static void
@@ -4759,10 +4575,8 @@ micro_fslt(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src0->f[0] < src1->f[0] ? ~0 : 0;
-   dst->u[1] = src0->f[1] < src1->f[1] ? ~0 : 0;
-   dst->u[2] = src0->f[2] < src1->f[2] ? ~0 : 0;
-   dst->u[3] = src0->f[3] < src1->f[3] ? ~0 : 0;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->f[i] < src1->f[i] ? ~0 : 0;
 }
 
 static void
@@ -4770,10 +4584,8 @@ micro_fsne(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src0->f[0] != src1->f[0] ? ~0 : 0;
-   dst->u[1] = src0->f[1] != src1->f[1] ? ~0 : 0;
-   dst->u[2] = src0->f[2] != src1->f[2] ? ~0 : 0;
-   dst->u[3] = src0->f[3] != src1->f[3] ? ~0 : 0;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->f[i] != src1->f[i] ? ~0 : 0;
 }
 
 static void
@@ -4781,10 +4593,8 @@ micro_idiv(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->i[0] = src1->i[0] ? src0->i[0] / src1->i[0] : 0;
-   dst->i[1] = src1->i[1] ? src0->i[1] / src1->i[1] : 0;
-   dst->i[2] = src1->i[2] ? src0->i[2] / src1->i[2] : 0;
-   dst->i[3] = src1->i[3] ? src0->i[3] / src1->i[3] : 0;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = src1->i[i] ? src0->i[i] / src1->i[i] : 0;
 }
 
 static void
@@ -4792,10 +4602,8 @@ micro_imax(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->i[0] = src0->i[0] > src1->i[0] ? src0->i[0] : src1->i[0];
-   dst->i[1] = src0->i[1] > src1->i[1] ? src0->i[1] : src1->i[1];
-   dst->i[2] = src0->i[2] > src1->i[2] ? src0->i[2] : src1->i[2];
-   dst->i[3] = src0->i[3] > src1->i[3] ? src0->i[3] : src1->i[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = src0->i[i] > src1->i[i] ? src0->i[i] : src1->i[i];
 }
 
 static void
@@ -4803,10 +4611,8 @@ micro_imin(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->i[0] = src0->i[0] < src1->i[0] ? src0->i[0] : src1->i[0];
-   dst->i[1] = src0->i[1] < src1->i[1] ? src0->i[1] : src1->i[1];
-   dst->i[2] = src0->i[2] < src1->i[2] ? src0->i[2] : src1->i[2];
-   dst->i[3] = src0->i[3] < src1->i[3] ? src0->i[3] : src1->i[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = src0->i[i] < src1->i[i] ? src0->i[i] : src1->i[i];
 }
 
 static void
@@ -4814,10 +4620,8 @@ micro_isge(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->i[0] = src0->i[0] >= src1->i[0] ? -1 : 0;
-   dst->i[1] = src0->i[1] >= src1->i[1] ? -1 : 0;
-   dst->i[2] = src0->i[2] >= src1->i[2] ? -1 : 0;
-   dst->i[3] = src0->i[3] >= src1->i[3] ? -1 : 0;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = src0->i[i] >= src1->i[i] ? -1 : 0;
 }
 
 static void
@@ -4826,14 +4630,10 @@ micro_ishr(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src1)
 {
    unsigned masked_count;
-   masked_count = src1->i[0] & 0x1f;
-   dst->i[0] = src0->i[0] >> masked_count;
-   masked_count = src1->i[1] & 0x1f;
-   dst->i[1] = src0->i[1] >> masked_count;
-   masked_count = src1->i[2] & 0x1f;
-   dst->i[2] = src0->i[2] >> masked_count;
-   masked_count = src1->i[3] & 0x1f;
-   dst->i[3] = src0->i[3] >> masked_count;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++) {
+      masked_count = src1->i[i] & 0x1f;
+      dst->i[i] = src0->i[i] >> masked_count;
+   }
 }
 
 static void
@@ -4841,30 +4641,24 @@ micro_islt(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->i[0] = src0->i[0] < src1->i[0] ? -1 : 0;
-   dst->i[1] = src0->i[1] < src1->i[1] ? -1 : 0;
-   dst->i[2] = src0->i[2] < src1->i[2] ? -1 : 0;
-   dst->i[3] = src0->i[3] < src1->i[3] ? -1 : 0;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = src0->i[i] < src1->i[i] ? -1 : 0;
 }
 
 static void
 micro_f2u(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->u[0] = (uint)src->f[0];
-   dst->u[1] = (uint)src->f[1];
-   dst->u[2] = (uint)src->f[2];
-   dst->u[3] = (uint)src->f[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = (uint)src->f[i];
 }
 
 static void
 micro_u2f(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->f[0] = (float)src->u[0];
-   dst->f[1] = (float)src->u[1];
-   dst->f[2] = (float)src->u[2];
-   dst->f[3] = (float)src->u[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->f[i] = (float)src->u[i];
 }
 
 static void
@@ -4872,10 +4666,8 @@ micro_uadd(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src0->u[0] + src1->u[0];
-   dst->u[1] = src0->u[1] + src1->u[1];
-   dst->u[2] = src0->u[2] + src1->u[2];
-   dst->u[3] = src0->u[3] + src1->u[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->u[i] + src1->u[i];
 }
 
 static void
@@ -4883,10 +4675,8 @@ micro_udiv(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src1->u[0] ? src0->u[0] / src1->u[0] : ~0u;
-   dst->u[1] = src1->u[1] ? src0->u[1] / src1->u[1] : ~0u;
-   dst->u[2] = src1->u[2] ? src0->u[2] / src1->u[2] : ~0u;
-   dst->u[3] = src1->u[3] ? src0->u[3] / src1->u[3] : ~0u;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src1->u[i] ? src0->u[i] / src1->u[i] : ~0u;
 }
 
 static void
@@ -4895,10 +4685,8 @@ micro_umad(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src1,
            const union tgsi_exec_channel *src2)
 {
-   dst->u[0] = src0->u[0] * src1->u[0] + src2->u[0];
-   dst->u[1] = src0->u[1] * src1->u[1] + src2->u[1];
-   dst->u[2] = src0->u[2] * src1->u[2] + src2->u[2];
-   dst->u[3] = src0->u[3] * src1->u[3] + src2->u[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->u[i] * src1->u[i] + src2->u[i];
 }
 
 static void
@@ -4906,10 +4694,8 @@ micro_umax(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src0->u[0] > src1->u[0] ? src0->u[0] : src1->u[0];
-   dst->u[1] = src0->u[1] > src1->u[1] ? src0->u[1] : src1->u[1];
-   dst->u[2] = src0->u[2] > src1->u[2] ? src0->u[2] : src1->u[2];
-   dst->u[3] = src0->u[3] > src1->u[3] ? src0->u[3] : src1->u[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->u[i] > src1->u[i] ? src0->u[i] : src1->u[i];
 }
 
 static void
@@ -4917,10 +4703,8 @@ micro_umin(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src0->u[0] < src1->u[0] ? src0->u[0] : src1->u[0];
-   dst->u[1] = src0->u[1] < src1->u[1] ? src0->u[1] : src1->u[1];
-   dst->u[2] = src0->u[2] < src1->u[2] ? src0->u[2] : src1->u[2];
-   dst->u[3] = src0->u[3] < src1->u[3] ? src0->u[3] : src1->u[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->u[i] < src1->u[i] ? src0->u[i] : src1->u[i];
 }
 
 static void
@@ -4928,10 +4712,8 @@ micro_umod(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src1->u[0] ? src0->u[0] % src1->u[0] : ~0u;
-   dst->u[1] = src1->u[1] ? src0->u[1] % src1->u[1] : ~0u;
-   dst->u[2] = src1->u[2] ? src0->u[2] % src1->u[2] : ~0u;
-   dst->u[3] = src1->u[3] ? src0->u[3] % src1->u[3] : ~0u;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src1->u[i] ? src0->u[i] % src1->u[i] : ~0u;
 }
 
 static void
@@ -4939,10 +4721,8 @@ micro_umul(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src0->u[0] * src1->u[0];
-   dst->u[1] = src0->u[1] * src1->u[1];
-   dst->u[2] = src0->u[2] * src1->u[2];
-   dst->u[3] = src0->u[3] * src1->u[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->u[i] * src1->u[i];
 }
 
 static void
@@ -4951,10 +4731,8 @@ micro_imul_hi(union tgsi_exec_channel *dst,
               const union tgsi_exec_channel *src1)
 {
 #define I64M(x, y) ((((int64_t)x) * ((int64_t)y)) >> 32)
-   dst->i[0] = I64M(src0->i[0], src1->i[0]);
-   dst->i[1] = I64M(src0->i[1], src1->i[1]);
-   dst->i[2] = I64M(src0->i[2], src1->i[2]);
-   dst->i[3] = I64M(src0->i[3], src1->i[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = I64M(src0->i[i], src1->i[i]);
 #undef I64M
 }
 
@@ -4964,10 +4742,8 @@ micro_umul_hi(union tgsi_exec_channel *dst,
               const union tgsi_exec_channel *src1)
 {
 #define U64M(x, y) ((((uint64_t)x) * ((uint64_t)y)) >> 32)
-   dst->u[0] = U64M(src0->u[0], src1->u[0]);
-   dst->u[1] = U64M(src0->u[1], src1->u[1]);
-   dst->u[2] = U64M(src0->u[2], src1->u[2]);
-   dst->u[3] = U64M(src0->u[3], src1->u[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = U64M(src0->u[i], src1->u[i]);
 #undef U64M
 }
 
@@ -4976,10 +4752,8 @@ micro_useq(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src0->u[0] == src1->u[0] ? ~0 : 0;
-   dst->u[1] = src0->u[1] == src1->u[1] ? ~0 : 0;
-   dst->u[2] = src0->u[2] == src1->u[2] ? ~0 : 0;
-   dst->u[3] = src0->u[3] == src1->u[3] ? ~0 : 0;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->u[i] == src1->u[i] ? ~0 : 0;
 }
 
 static void
@@ -4987,10 +4761,8 @@ micro_usge(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src0->u[0] >= src1->u[0] ? ~0 : 0;
-   dst->u[1] = src0->u[1] >= src1->u[1] ? ~0 : 0;
-   dst->u[2] = src0->u[2] >= src1->u[2] ? ~0 : 0;
-   dst->u[3] = src0->u[3] >= src1->u[3] ? ~0 : 0;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->u[i] >= src1->u[i] ? ~0 : 0;
 }
 
 static void
@@ -4999,14 +4771,10 @@ micro_ushr(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src1)
 {
    unsigned masked_count;
-   masked_count = src1->u[0] & 0x1f;
-   dst->u[0] = src0->u[0] >> masked_count;
-   masked_count = src1->u[1] & 0x1f;
-   dst->u[1] = src0->u[1] >> masked_count;
-   masked_count = src1->u[2] & 0x1f;
-   dst->u[2] = src0->u[2] >> masked_count;
-   masked_count = src1->u[3] & 0x1f;
-   dst->u[3] = src0->u[3] >> masked_count;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++) {
+      masked_count = src1->u[i] & 0x1f;
+      dst->u[i] = src0->u[i] >> masked_count;
+   }
 }
 
 static void
@@ -5014,10 +4782,8 @@ micro_uslt(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src0->u[0] < src1->u[0] ? ~0 : 0;
-   dst->u[1] = src0->u[1] < src1->u[1] ? ~0 : 0;
-   dst->u[2] = src0->u[2] < src1->u[2] ? ~0 : 0;
-   dst->u[3] = src0->u[3] < src1->u[3] ? ~0 : 0;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->u[i] < src1->u[i] ? ~0 : 0;
 }
 
 static void
@@ -5025,20 +4791,16 @@ micro_usne(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
-   dst->u[0] = src0->u[0] != src1->u[0] ? ~0 : 0;
-   dst->u[1] = src0->u[1] != src1->u[1] ? ~0 : 0;
-   dst->u[2] = src0->u[2] != src1->u[2] ? ~0 : 0;
-   dst->u[3] = src0->u[3] != src1->u[3] ? ~0 : 0;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = src0->u[i] != src1->u[i] ? ~0 : 0;
 }
 
 static void
 micro_uarl(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src)
 {
-   dst->i[0] = src->u[0];
-   dst->i[1] = src->u[1];
-   dst->i[2] = src->u[2];
-   dst->i[3] = src->u[3];
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = src->u[i];
 }
 
 /**
@@ -5051,7 +4813,7 @@ micro_ibfe(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src2)
 {
    int i;
-   for (i = 0; i < 4; i++) {
+   for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
       int width = src2->i[i];
       int offset = src1->i[i] & 0x1f;
       if (width == 32 && offset == 0) {
@@ -5078,7 +4840,7 @@ micro_ubfe(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src2)
 {
    int i;
-   for (i = 0; i < 4; i++) {
+   for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
       int width = src2->u[i];
       int offset = src1->u[i] & 0x1f;
       if (width == 32 && offset == 0) {
@@ -5106,7 +4868,7 @@ micro_bfi(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src3)
 {
    int i;
-   for (i = 0; i < 4; i++) {
+   for (i = 0; i < TGSI_EXEC_WIDTH; i++) {
       int width = src3->u[i];
       int offset = src2->u[i] & 0x1f;
       if (width == 32) {
@@ -5122,50 +4884,40 @@ static void
 micro_brev(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src)
 {
-   dst->u[0] = util_bitreverse(src->u[0]);
-   dst->u[1] = util_bitreverse(src->u[1]);
-   dst->u[2] = util_bitreverse(src->u[2]);
-   dst->u[3] = util_bitreverse(src->u[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = util_bitreverse(src->u[i]);
 }
 
 static void
 micro_popc(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src)
 {
-   dst->u[0] = util_bitcount(src->u[0]);
-   dst->u[1] = util_bitcount(src->u[1]);
-   dst->u[2] = util_bitcount(src->u[2]);
-   dst->u[3] = util_bitcount(src->u[3]);
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->u[i] = util_bitcount(src->u[i]);
 }
 
 static void
 micro_lsb(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
-   dst->i[0] = ffs(src->u[0]) - 1;
-   dst->i[1] = ffs(src->u[1]) - 1;
-   dst->i[2] = ffs(src->u[2]) - 1;
-   dst->i[3] = ffs(src->u[3]) - 1;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = ffs(src->u[i]) - 1;
 }
 
 static void
 micro_imsb(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src)
 {
-   dst->i[0] = util_last_bit_signed(src->i[0]) - 1;
-   dst->i[1] = util_last_bit_signed(src->i[1]) - 1;
-   dst->i[2] = util_last_bit_signed(src->i[2]) - 1;
-   dst->i[3] = util_last_bit_signed(src->i[3]) - 1;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = util_last_bit_signed(src->i[i]) - 1;
 }
 
 static void
 micro_umsb(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src)
 {
-   dst->i[0] = util_last_bit(src->u[0]) - 1;
-   dst->i[1] = util_last_bit(src->u[1]) - 1;
-   dst->i[2] = util_last_bit(src->u[2]) - 1;
-   dst->i[3] = util_last_bit(src->u[3]) - 1;
+   for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++)
+      dst->i[i] = util_last_bit(src->u[i]) - 1;
 }
 
 
@@ -5633,17 +5385,10 @@ exec_instruction(
       mach->CondStack[mach->CondStackTop++] = mach->CondMask;
       FETCH( &r[0], 0, TGSI_CHAN_X );
       /* update CondMask */
-      if( ! r[0].f[0] ) {
-         mach->CondMask &= ~0x1;
-      }
-      if( ! r[0].f[1] ) {
-         mach->CondMask &= ~0x2;
-      }
-      if( ! r[0].f[2] ) {
-         mach->CondMask &= ~0x4;
-      }
-      if( ! r[0].f[3] ) {
-         mach->CondMask &= ~0x8;
+      for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++) {
+         if( ! r[0].f[i] ) {
+            mach->CondMask &= ~(1 << i);
+         }
       }
       UPDATE_EXEC_MASK(mach);
       /* Todo: If CondMask==0, jump to ELSE */
@@ -5655,17 +5400,10 @@ exec_instruction(
       mach->CondStack[mach->CondStackTop++] = mach->CondMask;
       IFETCH( &r[0], 0, TGSI_CHAN_X );
       /* update CondMask */
-      if( ! r[0].u[0] ) {
-         mach->CondMask &= ~0x1;
-      }
-      if( ! r[0].u[1] ) {
-         mach->CondMask &= ~0x2;
-      }
-      if( ! r[0].u[2] ) {
-         mach->CondMask &= ~0x4;
-      }
-      if( ! r[0].u[3] ) {
-         mach->CondMask &= ~0x8;
+      for (unsigned i = 0; i < TGSI_EXEC_WIDTH; i++) {
+         if( ! r[0].u[i] ) {
+            mach->CondMask &= ~(1 << i);
+         }
       }
       UPDATE_EXEC_MASK(mach);
       /* Todo: If CondMask==0, jump to ELSE */
@@ -6335,7 +6073,7 @@ exec_instruction(
 static void
 tgsi_exec_machine_setup_masks(struct tgsi_exec_machine *mach)
 {
-   uint default_mask = 0xf;
+   uint default_mask = TGSI_EXEC_FULL_MASK;
 
    mach->Temps[TEMP_KILMASK_I].xyzw[TEMP_KILMASK_C].u[0] = 0;
    mach->Temps[TEMP_OUTPUT_I].xyzw[TEMP_OUTPUT_C].u[0] = 0;
@@ -6425,7 +6163,7 @@ tgsi_exec_machine_run( struct tgsi_exec_machine *mach, int start_pc )
 
                memcpy(&temps[i], &mach->Temps[i], sizeof(temps[i]));
                debug_printf("TEMP[%2u] = ", i);
-               for (j = 0; j < 4; j++) {
+               for (j = 0; j < TGSI_EXEC_WIDTH; j++) {
                   if (j > 0) {
                      debug_printf("           ");
                   }
@@ -6444,7 +6182,7 @@ tgsi_exec_machine_run( struct tgsi_exec_machine *mach, int start_pc )
 
                   memcpy(&outputs[i], &mach->Outputs[i], sizeof(outputs[i]));
                   debug_printf("OUT[%2u] =  ", i);
-                  for (j = 0; j < 4; j++) {
+                  for (j = 0; j < TGSI_EXEC_WIDTH; j++) {
                      if (j > 0) {
                         debug_printf("           ");
                      }
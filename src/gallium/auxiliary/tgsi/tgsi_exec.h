@@ -68,24 +68,6 @@ extern "C" {
    TGSI_FOR_EACH_CHANNEL( CHAN )\
       TGSI_IF_IS_DST1_CHANNEL_ENABLED( INST, CHAN )
 
-/**
-  * Registers may be treated as float, signed int or unsigned int.
-  */
-union tgsi_exec_channel
-{
-   float    f[TGSI_QUAD_SIZE];
-   int      i[TGSI_QUAD_SIZE];
-   unsigned u[TGSI_QUAD_SIZE];
-};
-
-/**
-  * A vector[RGBA] of channels[4 pixels]
-  */
-struct tgsi_exec_vector
-{
-   union tgsi_exec_channel xyzw[TGSI_NUM_CHANNELS];
-};
-
 /**
  * For fragment programs, information for computing fragment input
  * values from plane equation of the triangle/line.
@@ -333,14 +315,6 @@ struct tgsi_call_record
 };
 
 
-/* Switch-case block state. */
-struct tgsi_switch_record {
-   uint mask;                          /**< execution mask */
-   union tgsi_exec_channel selector;   /**< a value case statements are compared to */
-   uint defaultMask;                   /**< non-execute mask for default case */
-};
-
-
 enum tgsi_break_type {
    TGSI_EXEC_BREAK_INSIDE_LOOP,
    TGSI_EXEC_BREAK_INSIDE_SWITCH
@@ -351,163 +325,18 @@ enum tgsi_break_type {
 
 typedef float float4[4];
 
-struct tgsi_exec_machine;
-
-typedef void (* apply_sample_offset_func)(
-   const struct tgsi_exec_machine *mach,
-   unsigned attrib,
-   unsigned chan,
-   float ofs_x,
-   float ofs_y,
-   union tgsi_exec_channel *out_chan);
-
-/**
- * Run-time virtual machine state for executing TGSI shader.
+/* Declare the one-quad machine: union tgsi_exec_channel, struct
+ * tgsi_exec_machine and the tgsi_exec_machine_*() entrypoints.
  */
-struct tgsi_exec_machine
-{
-   /* Total = program temporaries + internal temporaries
-    */
-   struct tgsi_exec_vector       Temps[TGSI_EXEC_NUM_TEMPS +
-                                       TGSI_EXEC_NUM_TEMP_EXTRAS];
-
-   unsigned                       ImmsReserved;
-   float4                         *Imms;
-
-   struct tgsi_exec_vector       *Inputs;
-   struct tgsi_exec_vector       *Outputs;
-   apply_sample_offset_func           *InputSampleOffsetApply;
-
-   /* System values */
-   unsigned                      SysSemanticToIndex[TGSI_SEMANTIC_COUNT];
-   struct tgsi_exec_vector       SystemValue[TGSI_MAX_MISC_INPUTS];
-
-   struct tgsi_exec_vector       *Addrs;
-
-   struct tgsi_sampler           *Sampler;
-
-   struct tgsi_image             *Image;
-   struct tgsi_buffer            *Buffer;
-   unsigned                      ImmLimit;
-
-   const void *Consts[PIPE_MAX_CONSTANT_BUFFERS];
-   unsigned ConstsSize[PIPE_MAX_CONSTANT_BUFFERS];
-
-   const struct tgsi_token       *Tokens;   /**< Declarations, instructions */
-   enum pipe_shader_type         ShaderType; /**< PIPE_SHADER_x */
-
-   /* GEOMETRY processor only. */
-   unsigned                      *Primitives[TGSI_MAX_VERTEX_STREAMS];
-   unsigned                      *PrimitiveOffsets[TGSI_MAX_VERTEX_STREAMS];
-   unsigned                       NumOutputs;
-   unsigned                       MaxGeometryShaderOutputs;
-   unsigned                       MaxOutputVertices;
-
-   /* FRAGMENT processor only. */
-   const struct tgsi_interp_coef *InterpCoefs;
-   struct tgsi_exec_vector       QuadPos;
-   float                         Face;    /**< +1 if front facing, -1 if back facing */
-   bool                          flatshade_color;
-
-   /* Compute Only */
-   void                          *LocalMem;
-   unsigned                      LocalMemSize;
-
-   /* See GLSL 4.50 specification for definition of helper invocations */
-   uint NonHelperMask;  /**< non-helpers */
-   /* Conditional execution masks */
-   uint CondMask;  /**< For IF/ELSE/ENDIF */
-   uint LoopMask;  /**< For BGNLOOP/ENDLOOP */
-   uint ContMask;  /**< For loop CONT statements */
-   uint FuncMask;  /**< For function calls */
-   uint ExecMask;  /**< = CondMask & LoopMask */
-
-   /* Current switch-case state. */
-   struct tgsi_switch_record Switch;
-
-   /* Current break type. */
-   enum tgsi_break_type BreakType;
-
-   /** Condition mask stack (for nested conditionals) */
-   uint CondStack[TGSI_EXEC_MAX_COND_NESTING];
-   int CondStackTop;
-
-   /** Loop mask stack (for nested loops) */
-   uint LoopStack[TGSI_EXEC_MAX_LOOP_NESTING];
-   int LoopStackTop;
-
-   /** Loop label stack */
-   uint LoopLabelStack[TGSI_EXEC_MAX_LOOP_NESTING];
-   int LoopLabelStackTop;
-
-   /** Loop continue mask stack (see comments in tgsi_exec.c) */
-   uint ContStack[TGSI_EXEC_MAX_LOOP_NESTING];
-   int ContStackTop;
-
-   /** Switch case stack */
-   struct tgsi_switch_record SwitchStack[TGSI_EXEC_MAX_SWITCH_NESTING];
-   int SwitchStackTop;
-
-   enum tgsi_break_type BreakStack[TGSI_EXEC_MAX_BREAK_STACK];
-   int BreakStackTop;
-
-   /** Function execution mask stack (for executing subroutine code) */
-   uint FuncStack[TGSI_EXEC_MAX_CALL_NESTING];
-   int FuncStackTop;
-
-   /** Function call stack for saving/restoring the program counter */
-   struct tgsi_call_record CallStack[TGSI_EXEC_MAX_CALL_NESTING];
-   int CallStackTop;
-
-   struct tgsi_full_instruction *Instructions;
-   uint NumInstructions;
-
-   struct tgsi_full_declaration *Declarations;
-   uint NumDeclarations;
-
-   struct tgsi_declaration_sampler_view
-      SamplerViews[PIPE_MAX_SHADER_SAMPLER_VIEWS];
-
-   boolean UsedGeometryShader;
-
-   int pc;
-};
-
-struct tgsi_exec_machine *
-tgsi_exec_machine_create(enum pipe_shader_type shader_type);
-
-void
-tgsi_exec_machine_destroy(struct tgsi_exec_machine *mach);
-
-
-void 
-tgsi_exec_machine_bind_shader(
-   struct tgsi_exec_machine *mach,
-   const struct tgsi_token *tokens,
-   struct tgsi_sampler *sampler,
-   struct tgsi_image *image,
-   struct tgsi_buffer *buffer);
-
-uint
-tgsi_exec_machine_run(
-   struct tgsi_exec_machine *mach, int start_pc );
-
-
-void
-tgsi_exec_machine_free_data(struct tgsi_exec_machine *mach);
+#define TGSI_EXEC_WIDTH TGSI_QUAD_SIZE
+#include "tgsi_exec_machine_tmp.h"
+#undef TGSI_EXEC_WIDTH
 
 
 boolean
 tgsi_check_soa_dependencies(const struct tgsi_full_instruction *inst);
 
 
-extern void
-tgsi_exec_set_constant_buffers(struct tgsi_exec_machine *mach,
-                               unsigned num_bufs,
-                               const void **bufs,
-                               const unsigned *buf_sizes);
-
-
 static inline int
 tgsi_exec_get_shader_param(enum pipe_shader_cap param)
 {
@@ -0,0 +1,90 @@
+/**************************************************************************
+ * 
+ * Copyright 2007-2008 VMware, Inc.
+ * All Rights Reserved.
+ * Copyright 2009-2010 VMware, Inc.  All rights Reserved.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ **************************************************************************/
+
+/*
+ * Wide TGSI machine.
+ *
+ * The same interpreter as tgsi_exec.h, but every register holds
+ * TGSI_EXEC_WIDE_WIDTH lanes instead of one quad, so a single dispatch of
+ * each instruction processes that many vertices.  It is meant for vertex
+ * shaders; fragment shaders need the quad machine for derivatives and
+ * interpolation.  Samplers, images and buffers are still called one quad
+ * at a time.
+ *
+ * The types and entrypoints are the ones of tgsi_exec.h with a _wide
+ * suffix: struct tgsi_exec_machine_wide, union tgsi_exec_channel_wide,
+ * tgsi_exec_machine_wide_run(), ...
+ */
+
+#ifndef TGSI_EXEC_WIDE_H
+#define TGSI_EXEC_WIDE_H
+
+#include "tgsi_exec.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#define TGSI_EXEC_WIDE_WIDTH 16
+
+#define tgsi_exec_channel              tgsi_exec_channel_wide
+#define tgsi_exec_vector               tgsi_exec_vector_wide
+#define tgsi_switch_record             tgsi_switch_record_wide
+#define apply_sample_offset_func       apply_sample_offset_func_wide
+#define tgsi_exec_machine              tgsi_exec_machine_wide
+#define tgsi_exec_machine_create       tgsi_exec_machine_wide_create
+#define tgsi_exec_machine_destroy      tgsi_exec_machine_wide_destroy
+#define tgsi_exec_machine_bind_shader  tgsi_exec_machine_wide_bind_shader
+#define tgsi_exec_machine_run          tgsi_exec_machine_wide_run
+#define tgsi_exec_machine_free_data    tgsi_exec_machine_wide_free_data
+#define tgsi_exec_set_constant_buffers tgsi_exec_wide_set_constant_buffers
+
+#define TGSI_EXEC_WIDTH TGSI_EXEC_WIDE_WIDTH
+#include "tgsi_exec_machine_tmp.h"
+
+/* tgsi_exec_wide.c keeps the renames to build tgsi_exec.c with them. */
+#ifndef TGSI_EXEC_WIDE_IMPL
+#undef TGSI_EXEC_WIDTH
+#undef tgsi_exec_channel
+#undef tgsi_exec_vector
+#undef tgsi_switch_record
+#undef apply_sample_offset_func
+#undef tgsi_exec_machine
+#undef tgsi_exec_machine_create
+#undef tgsi_exec_machine_destroy
+#undef tgsi_exec_machine_bind_shader
+#undef tgsi_exec_machine_run
+#undef tgsi_exec_machine_free_data
+#undef tgsi_exec_set_constant_buffers
+#endif
+
+#if defined __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* TGSI_EXEC_WIDE_H */
@@ -32,6 +32,7 @@
 
 #include "pipe/p_config.h"
 #include "pipe/p_state.h"
+#include "util/u_cpu_detect.h"
 #include "translate.h"
 
 struct translate *translate_create( const struct translate_key *key )
@@ -39,6 +40,14 @@ struct translate *translate_create( const struct translate_key *key )
    struct translate *translate = NULL;
 
 #if defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)
+   util_cpu_detect();
+   if (util_cpu_caps.has_avx && util_cpu_caps.has_avx2 &&
+       util_cpu_caps.has_f16c) {
+      translate = translate_avx2_create( key );
+      if (translate)
+         return translate;
+   }
+
    translate = translate_sse2_create( key );
    if (translate)
       return translate;
@@ -0,0 +1,701 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Vertex fetch/convert using AVX2 gathers.
+ *
+ * Eight vertices are processed at a time.  Each attribute in a common
+ * format (float, half-float, 8/16-bit normalized or scaled integers and
+ * the 10_10_10_2 packed formats) is fetched with 32-bit gathers, unpacked
+ * and converted to float in SoA form, and transposed back into the output
+ * vertices.  Per-instance attributes are fetched once per run.
+ *
+ * The conversions produce exactly the same results as the u_format
+ * fetch_rgba_float functions that translate_generic.c uses.
+ *
+ * This file must be built with -mavx2 -mf16c; otherwise only a stub is
+ * compiled.  Callers have to check util_cpu_caps before creating a
+ * translate object here (see translate_create()).
+ */
+
+
+#include "pipe/p_config.h"
+#include "pipe/p_compiler.h"
+#include "util/u_memory.h"
+#include "util/u_math.h"
+#include "util/u_format.h"
+
+#include "translate.h"
+
+
+#if (defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)) && \
+    defined(__AVX2__) && defined(__F16C__)
+
+#include <immintrin.h>
+
+
+#define AVX2_WIDTH 8
+
+/* Largest plain format block, in bytes. */
+#define AVX2_MAX_ELEMENT_SIZE 32
+
+
+typedef void (*fetch_func)(void *dst,
+                           const uint8_t *src,
+                           unsigned i, unsigned j);
+
+
+enum avx2_fetch_kind {
+   AVX2_FETCH_GATHER,      /**< vectorized gather and convert to float */
+   AVX2_FETCH_COPY,        /**< input format == output format */
+   AVX2_FETCH_SCALAR,      /**< u_format fetch, one vertex at a time */
+   AVX2_FETCH_INSTANCE_ID
+};
+
+enum avx2_chan_type {
+   AVX2_CHAN_VOID,
+   AVX2_CHAN_FLOAT32,
+   AVX2_CHAN_HALF,
+   AVX2_CHAN_UNSIGNED,
+   AVX2_CHAN_SIGNED
+};
+
+
+struct translate_avx2_element {
+   enum avx2_fetch_kind kind;
+
+   unsigned buffer;
+   unsigned input_offset;
+   unsigned instance_divisor;
+   unsigned output_offset;
+
+   /** Bytes written per output vertex. */
+   unsigned output_size;
+
+   /** AVX2_FETCH_GATHER: the dwords to gather and how to unpack them. */
+   unsigned nr_dwords;
+   unsigned dword_offset[4];
+   struct {
+      enum avx2_chan_type type;
+      unsigned dword;
+      unsigned shl, shr;
+      float scale;
+   } chan[4];
+   unsigned char swizzle[4];
+   unsigned nr_outputs;
+
+   /** AVX2_FETCH_SCALAR */
+   fetch_func fetch;
+
+   /** AVX2_FETCH_INSTANCE_ID: emit as float rather than as an integer. */
+   boolean instance_id_float;
+
+   const uint8_t *input_ptr;
+   unsigned input_stride;
+   unsigned max_index;
+};
+
+
+struct translate_avx2 {
+   struct translate translate;
+
+   unsigned nr_elements;
+   struct translate_avx2_element element[TRANSLATE_MAX_ATTRIBS];
+};
+
+
+static inline struct translate_avx2 *
+translate_avx2(struct translate *translate)
+{
+   return (struct translate_avx2 *)translate;
+}
+
+
+/**
+ * Gather one dword per lane from base + off.  The byte offsets are 64-bit
+ * so that index * stride can never overflow.
+ */
+static inline __m256i
+avx2_gather(const uint8_t *base, __m256i off_lo, __m256i off_hi)
+{
+   __m128i lo = _mm256_i64gather_epi32((const int *)base, off_lo, 1);
+   __m128i hi = _mm256_i64gather_epi32((const int *)base, off_hi, 1);
+
+   return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+
+static inline __m256
+avx2_unpack_chan(const struct translate_avx2_element *e,
+                 unsigned c, const __m256i *dwords)
+{
+   __m256i v = dwords[e->chan[c].dword];
+   __m128i shl = _mm_cvtsi32_si128(e->chan[c].shl);
+   __m128i shr = _mm_cvtsi32_si128(e->chan[c].shr);
+
+   switch (e->chan[c].type) {
+   case AVX2_CHAN_FLOAT32:
+      return _mm256_castsi256_ps(v);
+   case AVX2_CHAN_HALF:
+      v = _mm256_srl_epi32(_mm256_sll_epi32(v, shl), shr);
+      /* Narrow to 16 bits per lane; packus works within 128-bit lanes, so
+       * pull the two low qwords together afterwards.
+       */
+      v = _mm256_packus_epi32(v, v);
+      v = _mm256_permute4x64_epi64(v, 0x08);
+      return _mm256_cvtph_ps(_mm256_castsi256_si128(v));
+   case AVX2_CHAN_UNSIGNED:
+      v = _mm256_srl_epi32(_mm256_sll_epi32(v, shl), shr);
+      return _mm256_mul_ps(_mm256_cvtepi32_ps(v),
+                           _mm256_set1_ps(e->chan[c].scale));
+   case AVX2_CHAN_SIGNED:
+      v = _mm256_sra_epi32(_mm256_sll_epi32(v, shl), shr);
+      return _mm256_mul_ps(_mm256_cvtepi32_ps(v),
+                           _mm256_set1_ps(e->chan[c].scale));
+   case AVX2_CHAN_VOID:
+   default:
+      return _mm256_setzero_ps();
+   }
+}
+
+
+static inline void
+avx2_store_vertex(__m128 v, unsigned nr_outputs, uint8_t *dst)
+{
+   switch (nr_outputs) {
+   case 4:
+      _mm_storeu_ps((float *)dst, v);
+      break;
+   case 3:
+      _mm_storel_pi((__m64 *)dst, v);
+      _mm_store_ss((float *)dst + 2, _mm_movehl_ps(v, v));
+      break;
+   case 2:
+      _mm_storel_pi((__m64 *)dst, v);
+      break;
+   case 1:
+      _mm_store_ss((float *)dst, v);
+      break;
+   }
+}
+
+
+/**
+ * Fetch and convert one gathered element for up to eight vertices.
+ */
+static inline void
+avx2_fetch_gather(const struct translate_avx2_element *e,
+                  __m256i idx, boolean clamp,
+                  unsigned n, uint8_t *dst, unsigned dst_stride)
+{
+   const __m256 zero = _mm256_setzero_ps();
+   const __m256 one = _mm256_set1_ps(1.0f);
+   const __m256i stride = _mm256_set1_epi64x(e->input_stride);
+   __m256i off_lo, off_hi;
+   __m256i dwords[4];
+   __m256 chan[4], out[4];
+   __m256 t0, t1, t2, t3;
+   __m256 v[4];
+   unsigned i;
+
+   if (clamp)
+      idx = _mm256_min_epu32(idx, _mm256_set1_epi32(e->max_index));
+
+   off_lo = _mm256_cvtepu32_epi64(_mm256_castsi256_si128(idx));
+   off_hi = _mm256_cvtepu32_epi64(_mm256_extracti128_si256(idx, 1));
+   off_lo = _mm256_mul_epu32(off_lo, stride);
+   off_hi = _mm256_mul_epu32(off_hi, stride);
+
+   for (i = 0; i < e->nr_dwords; i++)
+      dwords[i] = avx2_gather(e->input_ptr + e->dword_offset[i],
+                              off_lo, off_hi);
+
+   for (i = 0; i < 4; i++)
+      chan[i] = avx2_unpack_chan(e, i, dwords);
+
+   for (i = 0; i < 4; i++) {
+      unsigned swz = e->swizzle[i];
+
+      if (swz <= PIPE_SWIZZLE_W)
+         out[i] = chan[swz];
+      else if (swz == PIPE_SWIZZLE_1)
+         out[i] = one;
+      else
+         out[i] = zero;
+   }
+
+   /* SoA -> AoS.  v[k] holds vertex k in its low half and vertex k + 4 in
+    * its high half.
+    */
+   t0 = _mm256_unpacklo_ps(out[0], out[1]);
+   t1 = _mm256_unpackhi_ps(out[0], out[1]);
+   t2 = _mm256_unpacklo_ps(out[2], out[3]);
+   t3 = _mm256_unpackhi_ps(out[2], out[3]);
+   v[0] = _mm256_shuffle_ps(t0, t2, 0x44);
+   v[1] = _mm256_shuffle_ps(t0, t2, 0xee);
+   v[2] = _mm256_shuffle_ps(t1, t3, 0x44);
+   v[3] = _mm256_shuffle_ps(t1, t3, 0xee);
+
+   for (i = 0; i < n; i++) {
+      __m128 vert = i < 4 ? _mm256_castps256_ps128(v[i])
+                          : _mm256_extractf128_ps(v[i - 4], 1);
+      avx2_store_vertex(vert, e->nr_outputs, dst);
+      dst += dst_stride;
+   }
+}
+
+
+/**
+ * Produce the output of a per-vertex element for a single vertex.
+ */
+static inline void
+avx2_fetch_one(const struct translate_avx2_element *e,
+               unsigned index, unsigned instance_id, uint8_t *dst)
+{
+   const uint8_t *src;
+   float data[4];
+
+   switch (e->kind) {
+   case AVX2_FETCH_GATHER:
+      avx2_fetch_gather(e, _mm256_set1_epi32(index), FALSE, 1, dst, 0);
+      break;
+   case AVX2_FETCH_COPY:
+      src = e->input_ptr + (ptrdiff_t)e->input_stride * index;
+      memcpy(dst, src, e->output_size);
+      break;
+   case AVX2_FETCH_SCALAR:
+      src = e->input_ptr + (ptrdiff_t)e->input_stride * index;
+      e->fetch(data, src, 0, 0);
+      memcpy(dst, data, e->output_size);
+      break;
+   case AVX2_FETCH_INSTANCE_ID:
+      if (e->instance_id_float) {
+         data[0] = (float)instance_id;
+         memcpy(dst, data, 4);
+      } else {
+         memcpy(dst, &instance_id, 4);
+      }
+      break;
+   }
+}
+
+
+/**
+ * Elements that don't vary across the vertices of a run -- instanced
+ * attributes and the instance id -- are fetched up front, and only copied
+ * into each vertex.
+ */
+static inline void
+avx2_fetch_constants(const struct translate_avx2 *tp,
+                     unsigned start_instance,
+                     unsigned instance_id,
+                     uint8_t (*constants)[AVX2_MAX_ELEMENT_SIZE])
+{
+   unsigned i;
+
+   for (i = 0; i < tp->nr_elements; i++) {
+      const struct translate_avx2_element *e = &tp->element[i];
+
+      if (e->kind == AVX2_FETCH_INSTANCE_ID) {
+         avx2_fetch_one(e, 0, instance_id, constants[i]);
+      }
+      else if (e->instance_divisor) {
+         /* XXX no clamping, like translate_generic */
+         unsigned index = start_instance + instance_id / e->instance_divisor;
+         avx2_fetch_one(e, index, instance_id, constants[i]);
+      }
+   }
+}
+
+
+static inline void
+avx2_run_batch(const struct translate_avx2 *tp,
+               __m256i idx, unsigned n,
+               uint8_t (*constants)[AVX2_MAX_ELEMENT_SIZE],
+               uint8_t *vert)
+{
+   const unsigned output_stride = tp->translate.key.output_stride;
+   uint32_t elts[AVX2_WIDTH];
+   boolean have_elts = FALSE;
+   unsigned i, j;
+
+   for (i = 0; i < tp->nr_elements; i++) {
+      const struct translate_avx2_element *e = &tp->element[i];
+      uint8_t *dst = vert + e->output_offset;
+
+      if (e->kind == AVX2_FETCH_INSTANCE_ID || e->instance_divisor) {
+         for (j = 0; j < n; j++) {
+            memcpy(dst, constants[i], e->output_size);
+            dst += output_stride;
+         }
+      }
+      else if (e->kind == AVX2_FETCH_GATHER) {
+         avx2_fetch_gather(e, idx, TRUE, n, dst, output_stride);
+      }
+      else {
+         if (!have_elts) {
+            _mm256_storeu_si256((__m256i *)elts, idx);
+            have_elts = TRUE;
+         }
+         for (j = 0; j < n; j++) {
+            avx2_fetch_one(e, MIN2(elts[j], e->max_index), 0, dst);
+            dst += output_stride;
+         }
+      }
+   }
+}
+
+
+/**
+ * Load up to eight indices.  A partial batch repeats the last index, so
+ * the gathers never touch anything the scalar path wouldn't.
+ */
+#define AVX2_LOAD_ELTS(elts, n, load)                       \
+   do {                                                     \
+      if ((n) == AVX2_WIDTH) {                              \
+         idx = load(elts);                                  \
+      } else {                                              \
+         unsigned tmp_[AVX2_WIDTH];                         \
+         unsigned k_;                                       \
+         for (k_ = 0; k_ < AVX2_WIDTH; k_++)                \
+            tmp_[k_] = (elts)[MIN2(k_, (n) - 1)];           \
+         idx = _mm256_loadu_si256((const __m256i *)tmp_);   \
+      }                                                     \
+   } while (0)
+
+#define AVX2_LOAD_ELTS32(p) _mm256_loadu_si256((const __m256i *)(p))
+#define AVX2_LOAD_ELTS16(p) \
+   _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(p)))
+#define AVX2_LOAD_ELTS8(p) \
+   _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(p)))
+
+
+#define AVX2_RUN_ELTS(NAME, TYPE, LOAD)                                 \
+static void PIPE_CDECL                                                  \
+NAME(struct translate *translate,                                       \
+     const TYPE *elts,                                                  \
+     unsigned count,                                                    \
+     unsigned start_instance,                                           \
+     unsigned instance_id,                                              \
+     void *output_buffer)                                               \
+{                                                                       \
+   const struct translate_avx2 *tp = translate_avx2(translate);         \
+   uint8_t constants[TRANSLATE_MAX_ATTRIBS][AVX2_MAX_ELEMENT_SIZE];     \
+   uint8_t *vert = output_buffer;                                       \
+   unsigned i;                                                          \
+                                                                        \
+   avx2_fetch_constants(tp, start_instance, instance_id, constants);    \
+                                                                        \
+   for (i = 0; i < count; i += AVX2_WIDTH) {                            \
+      unsigned n = MIN2(count - i, AVX2_WIDTH);                         \
+      __m256i idx;                                                      \
+                                                                        \
+      AVX2_LOAD_ELTS(elts + i, n, LOAD);                                \
+      avx2_run_batch(tp, idx, n, constants, vert);                      \
+      vert += n * translate->key.output_stride;                         \
+   }                                                                    \
+}
+
+AVX2_RUN_ELTS(avx2_run_elts, unsigned, AVX2_LOAD_ELTS32)
+AVX2_RUN_ELTS(avx2_run_elts16, uint16_t, AVX2_LOAD_ELTS16)
+AVX2_RUN_ELTS(avx2_run_elts8, uint8_t, AVX2_LOAD_ELTS8)
+
+
+static void PIPE_CDECL
+avx2_run(struct translate *translate,
+         unsigned start,
+         unsigned count,
+         unsigned start_instance,
+         unsigned instance_id,
+         void *output_buffer)
+{
+   const struct translate_avx2 *tp = translate_avx2(translate);
+   uint8_t constants[TRANSLATE_MAX_ATTRIBS][AVX2_MAX_ELEMENT_SIZE];
+   const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+   uint8_t *vert = output_buffer;
+   unsigned i;
+
+   if (!count)
+      return;
+
+   avx2_fetch_constants(tp, start_instance, instance_id, constants);
+
+   for (i = 0; i < count; i += AVX2_WIDTH) {
+      unsigned n = MIN2(count - i, AVX2_WIDTH);
+      __m256i idx = _mm256_add_epi32(_mm256_set1_epi32(start + i), lane);
+
+      if (n < AVX2_WIDTH)
+         idx = _mm256_min_epu32(idx, _mm256_set1_epi32(start + count - 1));
+
+      avx2_run_batch(tp, idx, n, constants, vert);
+      vert += n * translate->key.output_stride;
+   }
+}
+
+
+static void
+avx2_set_buffer(struct translate *translate,
+                unsigned buf,
+                const void *ptr,
+                unsigned stride,
+                unsigned max_index)
+{
+   struct translate_avx2 *tp = translate_avx2(translate);
+   unsigned i;
+
+   for (i = 0; i < tp->nr_elements; i++) {
+      if (tp->element[i].buffer == buf) {
+         tp->element[i].input_ptr = ((const uint8_t *)ptr +
+                                     tp->element[i].input_offset);
+         tp->element[i].input_stride = stride;
+         tp->element[i].max_index = max_index;
+      }
+   }
+}
+
+
+static void
+avx2_release(struct translate *translate)
+{
+   FREE(translate);
+}
+
+
+static unsigned
+float32_output_channels(enum pipe_format format)
+{
+   switch (format) {
+   case PIPE_FORMAT_R32_FLOAT:
+      return 1;
+   case PIPE_FORMAT_R32G32_FLOAT:
+      return 2;
+   case PIPE_FORMAT_R32G32B32_FLOAT:
+      return 3;
+   case PIPE_FORMAT_R32G32B32A32_FLOAT:
+      return 4;
+   default:
+      return 0;
+   }
+}
+
+
+/**
+ * Work out how to gather and unpack the input format with 32-bit
+ * gathers.  Every channel has to be contained in a dword that lies
+ * entirely within the element, so that no gather reads past the end of
+ * a vertex buffer.
+ */
+static boolean
+init_gather_element(struct translate_avx2_element *e,
+                    const struct util_format_description *desc)
+{
+   const unsigned size = desc->block.bits / 8;
+   unsigned type = UTIL_FORMAT_TYPE_VOID;
+   unsigned i, j;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+       desc->block.width != 1 || desc->block.height != 1 ||
+       (desc->block.bits & 7) || size < 4 || size > 16)
+      return FALSE;
+
+   e->nr_dwords = 0;
+
+   for (i = 0; i < 4; i++) {
+      const struct util_format_channel_description *chan = &desc->channel[i];
+      unsigned offset, bit;
+
+      e->chan[i].type = AVX2_CHAN_VOID;
+      if (i >= desc->nr_channels || chan->type == UTIL_FORMAT_TYPE_VOID)
+         continue;
+
+      /* All the non-void channels must share the same type. */
+      if (type != UTIL_FORMAT_TYPE_VOID && chan->type != type)
+         return FALSE;
+      type = chan->type;
+
+      if (chan->pure_integer)
+         return FALSE;
+
+      switch (chan->type) {
+      case UTIL_FORMAT_TYPE_FLOAT:
+         if (chan->size == 32)
+            e->chan[i].type = AVX2_CHAN_FLOAT32;
+         else if (chan->size == 16)
+            e->chan[i].type = AVX2_CHAN_HALF;
+         else
+            return FALSE;
+         e->chan[i].scale = 1.0f;
+         break;
+      case UTIL_FORMAT_TYPE_UNSIGNED:
+      case UTIL_FORMAT_TYPE_SIGNED:
+         /* Larger channels are converted via double by u_format. */
+         if (chan->size > 16)
+            return FALSE;
+         e->chan[i].type = chan->type == UTIL_FORMAT_TYPE_SIGNED ?
+                           AVX2_CHAN_SIGNED : AVX2_CHAN_UNSIGNED;
+         if (!chan->normalized)
+            e->chan[i].scale = 1.0f;
+         else if (chan->type == UTIL_FORMAT_TYPE_SIGNED)
+            e->chan[i].scale = 1.0f / ((1 << (chan->size - 1)) - 1);
+         else
+            e->chan[i].scale = 1.0f / ((1 << chan->size) - 1);
+         break;
+      default:
+         return FALSE;
+      }
+
+      offset = MIN2(chan->shift / 8, size - 4);
+      bit = chan->shift - offset * 8;
+      if (bit + chan->size > 32)
+         return FALSE;
+
+      for (j = 0; j < e->nr_dwords; j++) {
+         if (e->dword_offset[j] == offset)
+            break;
+      }
+      if (j == e->nr_dwords)
+         e->dword_offset[e->nr_dwords++] = offset;
+
+      e->chan[i].dword = j;
+      e->chan[i].shl = 32 - bit - chan->size;
+      e->chan[i].shr = 32 - chan->size;
+   }
+
+   if (type == UTIL_FORMAT_TYPE_VOID)
+      return FALSE;
+
+   for (i = 0; i < 4; i++) {
+      e->swizzle[i] = desc->swizzle[i];
+      if (e->swizzle[i] <= PIPE_SWIZZLE_W &&
+          e->chan[e->swizzle[i]].type == AVX2_CHAN_VOID)
+         e->swizzle[i] = PIPE_SWIZZLE_0;
+   }
+
+   return TRUE;
+}
+
+
+struct translate *
+translate_avx2_create(const struct translate_key *key)
+{
+   struct translate_avx2 *tp = CALLOC_STRUCT(translate_avx2);
+   unsigned nr_gathers = 0;
+   unsigned i;
+
+   if (!tp)
+      return NULL;
+
+   assert(key->nr_elements <= TRANSLATE_MAX_ATTRIBS);
+
+   tp->translate.key = *key;
+   tp->translate.release = avx2_release;
+   tp->translate.set_buffer = avx2_set_buffer;
+   tp->translate.run_elts = avx2_run_elts;
+   tp->translate.run_elts16 = avx2_run_elts16;
+   tp->translate.run_elts8 = avx2_run_elts8;
+   tp->translate.run = avx2_run;
+
+   for (i = 0; i < key->nr_elements; i++) {
+      const struct translate_element *elem = &key->element[i];
+      struct translate_avx2_element *e = &tp->element[i];
+      const struct util_format_description *input_desc;
+      unsigned nr_outputs;
+
+      e->buffer = elem->input_buffer;
+      e->input_offset = elem->input_offset;
+      e->instance_divisor = elem->instance_divisor;
+      e->output_offset = elem->output_offset;
+
+      if (elem->type == TRANSLATE_ELEMENT_INSTANCE_ID) {
+         e->kind = AVX2_FETCH_INSTANCE_ID;
+         e->output_size = 4;
+         e->instance_divisor = 0;
+         if (elem->output_format == PIPE_FORMAT_R32_FLOAT)
+            e->instance_id_float = TRUE;
+         else if (elem->output_format != PIPE_FORMAT_R32_USCALED &&
+                  elem->output_format != PIPE_FORMAT_R32_SSCALED)
+            goto fail;
+         continue;
+      }
+
+      input_desc = util_format_description(elem->input_format);
+      if (!input_desc)
+         goto fail;
+
+      if (elem->input_format == elem->output_format &&
+          input_desc->block.width == 1 &&
+          input_desc->block.height == 1 &&
+          !(input_desc->block.bits & 7) &&
+          input_desc->block.bits / 8 <= AVX2_MAX_ELEMENT_SIZE) {
+         e->kind = AVX2_FETCH_COPY;
+         e->output_size = input_desc->block.bits / 8;
+         continue;
+      }
+
+      nr_outputs = float32_output_channels(elem->output_format);
+      if (!nr_outputs)
+         goto fail;
+
+      e->nr_outputs = nr_outputs;
+      e->output_size = nr_outputs * 4;
+
+      if (init_gather_element(e, input_desc)) {
+         e->kind = AVX2_FETCH_GATHER;
+         if (!e->instance_divisor)
+            nr_gathers++;
+         continue;
+      }
+
+      if (input_desc->channel[0].pure_integer ||
+          !input_desc->fetch_rgba_float)
+         goto fail;
+
+      e->kind = AVX2_FETCH_SCALAR;
+      e->fetch = (fetch_func)input_desc->fetch_rgba_float;
+   }
+
+   /* Nothing to vectorize; the SSE or generic paths do at least as well. */
+   if (!nr_gathers)
+      goto fail;
+
+   tp->nr_elements = key->nr_elements;
+
+   return &tp->translate;
+
+fail:
+   FREE(tp);
+   return NULL;
+}
+
+
+#else
+
+struct translate *
+translate_avx2_create(const struct translate_key *key)
+{
+   return NULL;
+}
+
+#endif
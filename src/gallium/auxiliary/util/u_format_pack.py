@@ -621,13 +621,13 @@ def generate_pack_kernel(format, src_channel, src_native_type):
         print_channels(format, pack_into_union)
 
 
-def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
+def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix, name_suffix = ''):
     '''Generate the function to unpack pixels from a particular format'''
 
     name = format.short_name()
 
     print('static inline void')
-    print('util_format_%s_unpack_%s(%s *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, dst_suffix, dst_native_type))
+    print('util_format_%s_unpack_%s%s(%s *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, dst_suffix, name_suffix, dst_native_type))
     print('{')
 
     if is_format_supported(format):
@@ -650,13 +650,13 @@ def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
     print()
     
 
-def generate_format_pack(format, src_channel, src_native_type, src_suffix):
+def generate_format_pack(format, src_channel, src_native_type, src_suffix, name_suffix = ''):
     '''Generate the function to pack pixels to a particular format'''
 
     name = format.short_name()
 
     print('static inline void')
-    print('util_format_%s_pack_%s(uint8_t *dst_row, unsigned dst_stride, const %s *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, src_suffix, src_native_type))
+    print('util_format_%s_pack_%s%s(uint8_t *dst_row, unsigned dst_stride, const %s *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, src_suffix, name_suffix, src_native_type))
     print('{')
     
     if is_format_supported(format):
@@ -695,6 +695,185 @@ def generate_format_fetch(format, dst_channel, dst_native_type, dst_suffix):
     print()
 
 
+def is_rgba8_unorm(format):
+    '''Whether the format is four 8-bit unorm (or padding) channels.'''
+
+    if format.layout != PLAIN or format.colorspace != RGB:
+        return False
+    if format.block_width != 1 or format.block_height != 1 or format.block_size() != 32:
+        return False
+    if format.nr_channels() != 4:
+        return False
+    for channel in format.le_channels:
+        if channel.size != 8:
+            return False
+        if channel.type != VOID and not (channel.type == UNSIGNED and channel.norm):
+            return False
+    return True
+
+
+def is_rgba32_float(format):
+    '''Whether the format is four 32-bit float channels in RGBA order.'''
+
+    if format.layout != PLAIN or format.colorspace != RGB:
+        return False
+    for i in range(4):
+        channel = format.le_channels[i]
+        if channel.type != FLOAT or channel.size != 32 or channel.shift != 32*i:
+            return False
+        if format.le_swizzles[i] != i:
+            return False
+    return True
+
+
+def simd_unpack_rgba_8unorm(format):
+    '''Describe the SIMD version of unpack_rgba_8unorm for a format.
+
+    Returns None if there is none, otherwise a (kernel, src_bytes, pattern,
+    or_mask) tuple, where pattern is the per pixel byte shuffle described in
+    u_format_simd.h.'''
+
+    if is_rgba8_unorm(format):
+        pattern = 0
+        or_mask = 0
+        for i in range(4):
+            swizzle = format.le_swizzles[i]
+            if swizzle < 4:
+                channel = format.le_channels[swizzle]
+                assert channel.type != VOID
+                index = channel.shift // 8
+            else:
+                index = 0x80
+                if swizzle == SWIZZLE_1:
+                    or_mask |= 0xff << (8*i)
+            pattern |= index << (8*i)
+        return ('shuffle_rows', 4, pattern, or_mask)
+
+    if is_rgba32_float(format):
+        return ('float_to_rgba8_rows', 16, 0x03020100, None)
+
+    return None
+
+
+def simd_pack_rgba_float(format):
+    '''Describe the SIMD version of pack_rgba_float for a format, or return
+    None if there is none.'''
+
+    if is_rgba8_unorm(format):
+        inv_swizzle = inv_swizzles(format.le_swizzles)
+        pattern = 0
+        for i in range(4):
+            channel = format.le_channels[i]
+            if channel.type == VOID or inv_swizzle[i] is None:
+                index = 0x80
+            else:
+                index = inv_swizzle[i]
+            pattern |= index << channel.shift
+        return ('float_to_rgba8_rows', 16, pattern, None)
+
+    return None
+
+
+def generate_simd_variant(format, func, src_type, isa, kernel, src_bytes, pattern, or_mask):
+    '''Generate the SSE4.1 or AVX2 version of a row conversion function.  The
+    columns that don't fill a whole vector are left to the generic one.'''
+
+    name = format.short_name()
+    if src_type == 'float':
+        src_arg = '(const uint8_t *)src_row'
+        src_tail = 'src_row + x * %u' % (src_bytes // 4)
+    else:
+        src_arg = 'src_row'
+        src_tail = 'src_row + x * %u' % src_bytes
+
+    args = '0x%08x' % pattern
+    if or_mask is not None:
+        args += ', 0x%08x' % or_mask
+
+    print('static UTIL_FORMAT_%s void' % isa.upper())
+    print('util_format_%s_%s_%s(uint8_t *dst_row, unsigned dst_stride, const %s *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, func, isa, src_type))
+    print('{')
+    print('   unsigned x = util_format_%s_%s(dst_row, dst_stride, %s, src_stride, width, height, %s);' % (kernel, isa, src_arg, args))
+    print('   if (x < width)')
+    print('      util_format_%s_%s_generic(dst_row + x * 4, dst_stride, %s, src_stride, width - x, height);' % (name, func, src_tail))
+    print('}')
+    print()
+
+
+def generate_simd(formats):
+    '''Generate the SIMD versions of the hot row conversion functions, and the
+    functions dispatching to them at run time.'''
+
+    funcs = []
+    for format in formats:
+        if is_format_hand_written(format) or not is_format_supported(format):
+            continue
+        if format.is_pure_unsigned() or format.is_pure_signed():
+            continue
+        simd = simd_unpack_rgba_8unorm(format)
+        if simd is not None:
+            funcs.append((format, 'unpack_rgba_8unorm', 'uint8_t', simd))
+        simd = simd_pack_rgba_float(format)
+        if simd is not None:
+            funcs.append((format, 'pack_rgba_float', 'float', simd))
+
+    variants = (
+        ('avx2', 'util_cpu_caps.has_avx && util_cpu_caps.has_avx2'),
+        ('sse41', 'util_cpu_caps.has_sse4_1'),
+        ('generic', None),
+    )
+
+    print('#ifdef UTIL_FORMAT_SIMD')
+    print()
+    for format, func, src_type, simd in funcs:
+        for isa, caps in variants:
+            if caps is not None:
+                generate_simd_variant(format, func, src_type, isa, *simd)
+
+    print('static struct {')
+    for format, func, src_type, simd in funcs:
+        print('   util_format_%s_func %s_%s;' % (func, format.short_name(), func))
+    print('} util_format_simd_dispatch;')
+    print()
+    print('static once_flag util_format_simd_once = ONCE_FLAG_INIT;')
+    print()
+    print('static void')
+    print('util_format_simd_init(void)')
+    print('{')
+    print('   util_cpu_detect();')
+    print()
+    for i in range(len(variants)):
+        variant, caps = variants[i]
+        if i == 0:
+            print('   if (%s) {' % caps)
+        elif caps is not None:
+            print('   else if (%s) {' % caps)
+        else:
+            print('   else {')
+        for format, func, src_type, simd in funcs:
+            name = format.short_name()
+            print('      util_format_simd_dispatch.%s_%s = &util_format_%s_%s_%s;' % (name, func, name, func, variant))
+        print('   }')
+    print('}')
+    print()
+    print('#endif /* UTIL_FORMAT_SIMD */')
+    print()
+
+    for format, func, src_type, simd in funcs:
+        name = format.short_name()
+        print('static void')
+        print('util_format_%s_%s(uint8_t *dst_row, unsigned dst_stride, const %s *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, func, src_type))
+        print('{')
+        print('#ifdef UTIL_FORMAT_SIMD')
+        print('   call_once(&util_format_simd_once, util_format_simd_init);')
+        print('   util_format_simd_dispatch.%s_%s(dst_row, dst_stride, src_row, src_stride, width, height);' % (name, func))
+        print('#else')
+        print('   util_format_%s_%s_generic(dst_row, dst_stride, src_row, src_stride, width, height);' % (name, func))
+        print('#endif')
+        print('}')
+        print()
+
+
 def is_format_hand_written(format):
     return format.layout in ('s3tc', 'rgtc', 'etc', 'bptc', 'astc', 'atc', 'subsampled', 'other') or format.colorspace == ZS
 
@@ -709,6 +888,9 @@ def generate(formats):
     print('#include "util/format_srgb.h"')
     print('#include "u_format_yuv.h"')
     print('#include "u_format_zs.h"')
+    print('#include "u_format_simd.h"')
+    print('#include "util/u_cpu_detect.h"')
+    print('#include "c11/threads.h"')
     print()
 
     for format in formats:
@@ -751,13 +933,16 @@ def generate(formats):
                 suffix = 'rgba_float'
 
                 generate_format_unpack(format, channel, native_type, suffix)
-                generate_format_pack(format, channel, native_type, suffix)
+                generate_format_pack(format, channel, native_type, suffix,
+                                     '_generic' if simd_pack_rgba_float(format) else '')
                 generate_format_fetch(format, channel, native_type, suffix)
 
                 channel = Channel(UNSIGNED, True, False, 8)
                 native_type = 'uint8_t'
                 suffix = 'rgba_8unorm'
 
-                generate_format_unpack(format, channel, native_type, suffix)
+                generate_format_unpack(format, channel, native_type, suffix,
+                                       '_generic' if simd_unpack_rgba_8unorm(format) else '')
                 generate_format_pack(format, channel, native_type, suffix)
 
+    generate_simd(formats)
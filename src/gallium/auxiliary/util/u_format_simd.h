@@ -0,0 +1,262 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * SSE4.1 and AVX2 row conversion kernels used by the generated
+ * u_format_table.c for the most common formats.
+ *
+ * The kernels only handle whole groups of 4 (SSE4.1) or 8 (AVX2) pixels
+ * and return how many columns they converted; the generated code
+ * finishes the remaining columns with the scalar functions.  They give
+ * bit-identical results to the scalar code.
+ *
+ * The kernels are compiled with function target attributes, so that
+ * u_format_table.c itself doesn't need any special compiler flags.
+ * Which version gets called is decided at run time, from util_cpu_caps.
+ */
+
+#ifndef U_FORMAT_SIMD_H_
+#define U_FORMAT_SIMD_H_
+
+
+#include "pipe/p_config.h"
+#include "pipe/p_compiler.h"
+
+
+#if (defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)) && \
+    (defined(__clang__) || \
+     (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define UTIL_FORMAT_SIMD 1
+#endif
+
+
+#ifdef UTIL_FORMAT_SIMD
+
+#include <immintrin.h>
+
+
+#define UTIL_FORMAT_SSE41 __attribute__((target("sse4.1")))
+#define UTIL_FORMAT_AVX2 __attribute__((target("avx2")))
+
+
+typedef void
+(*util_format_unpack_rgba_8unorm_func)(uint8_t *dst_row, unsigned dst_stride,
+                                       const uint8_t *src_row, unsigned src_stride,
+                                       unsigned width, unsigned height);
+
+typedef void
+(*util_format_pack_rgba_float_func)(uint8_t *dst_row, unsigned dst_stride,
+                                    const float *src_row, unsigned src_stride,
+                                    unsigned width, unsigned height);
+
+
+/*
+ * Shuffles are described by one 32-bit pattern per pixel: byte i of the
+ * pattern is the index of the source byte that goes into destination
+ * byte i, or 0x80 to write zero.  The pattern is replicated to all the
+ * pixels of a vector.
+ */
+
+static inline UTIL_FORMAT_SSE41 __m128i
+util_format_shuffle_mask_sse41(uint32_t pattern)
+{
+   return _mm_add_epi8(_mm_set1_epi32(pattern),
+                       _mm_setr_epi32(0x00000000, 0x04040404,
+                                      0x08080808, 0x0c0c0c0c));
+}
+
+
+static inline UTIL_FORMAT_AVX2 __m256i
+util_format_shuffle_mask_avx2(uint32_t pattern)
+{
+   /* vpshufb works within 128-bit lanes, so both lanes are the same. */
+   return _mm256_add_epi8(_mm256_set1_epi32(pattern),
+                          _mm256_setr_epi32(0x00000000, 0x04040404,
+                                            0x08080808, 0x0c0c0c0c,
+                                            0x00000000, 0x04040404,
+                                            0x08080808, 0x0c0c0c0c));
+}
+
+
+/**
+ * Same as float_to_ubyte(), four floats at a time; the result is in the
+ * low byte of each dword.
+ */
+static inline UTIL_FORMAT_SSE41 __m128i
+util_format_float_to_ubyte_sse41(__m128 f)
+{
+   /* maxps returns the second operand for NaN, so any NaN becomes 0 like
+    * in float_to_ubyte(), and ±Inf clamp to 0 and 1.
+    */
+   f = _mm_max_ps(f, _mm_setzero_ps());
+   f = _mm_min_ps(f, _mm_set1_ps(1.0f));
+   f = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(255.0f / 256.0f)),
+                  _mm_set1_ps(32768.0f));
+   return _mm_and_si128(_mm_castps_si128(f), _mm_set1_epi32(0xff));
+}
+
+
+static inline UTIL_FORMAT_AVX2 __m256i
+util_format_float_to_ubyte_avx2(__m256 f)
+{
+   /* NaN becomes 0, see util_format_float_to_ubyte_sse41() */
+   f = _mm256_max_ps(f, _mm256_setzero_ps());
+   f = _mm256_min_ps(f, _mm256_set1_ps(1.0f));
+   f = _mm256_add_ps(_mm256_mul_ps(f, _mm256_set1_ps(255.0f / 256.0f)),
+                     _mm256_set1_ps(32768.0f));
+   return _mm256_and_si256(_mm256_castps_si256(f), _mm256_set1_epi32(0xff));
+}
+
+
+/**
+ * Shuffle 32-bit pixels, e.g. unpack any 4 x 8-bit unorm format to
+ * rgba_8unorm.  Bytes in or_mask are set afterwards, for the channels
+ * that are swizzled to one.
+ */
+static inline UTIL_FORMAT_SSE41 unsigned
+util_format_shuffle_rows_sse41(uint8_t *dst_row, unsigned dst_stride,
+                               const uint8_t *src_row, unsigned src_stride,
+                               unsigned width, unsigned height,
+                               uint32_t pattern, uint32_t or_mask)
+{
+   const __m128i shuffle = util_format_shuffle_mask_sse41(pattern);
+   const __m128i or_bits = _mm_set1_epi32(or_mask);
+   const unsigned simd_width = width & ~3;
+   unsigned x, y;
+
+   for (y = 0; y < height; ++y) {
+      for (x = 0; x < simd_width; x += 4) {
+         __m128i p = _mm_loadu_si128((const __m128i *)(src_row + x * 4));
+         p = _mm_or_si128(_mm_shuffle_epi8(p, shuffle), or_bits);
+         _mm_storeu_si128((__m128i *)(dst_row + x * 4), p);
+      }
+      dst_row += dst_stride;
+      src_row += src_stride;
+   }
+
+   return simd_width;
+}
+
+
+static inline UTIL_FORMAT_AVX2 unsigned
+util_format_shuffle_rows_avx2(uint8_t *dst_row, unsigned dst_stride,
+                              const uint8_t *src_row, unsigned src_stride,
+                              unsigned width, unsigned height,
+                              uint32_t pattern, uint32_t or_mask)
+{
+   const __m256i shuffle = util_format_shuffle_mask_avx2(pattern);
+   const __m256i or_bits = _mm256_set1_epi32(or_mask);
+   const unsigned simd_width = width & ~7;
+   unsigned x, y;
+
+   for (y = 0; y < height; ++y) {
+      for (x = 0; x < simd_width; x += 8) {
+         __m256i p = _mm256_loadu_si256((const __m256i *)(src_row + x * 4));
+         p = _mm256_or_si256(_mm256_shuffle_epi8(p, shuffle), or_bits);
+         _mm256_storeu_si256((__m256i *)(dst_row + x * 4), p);
+      }
+      dst_row += dst_stride;
+      src_row += src_stride;
+   }
+
+   return simd_width;
+}
+
+
+/**
+ * Convert pixels of four floats to 4 x 8-bit unorm pixels, with
+ * float_to_ubyte() rounding, and shuffle the result into place.
+ */
+static inline UTIL_FORMAT_SSE41 unsigned
+util_format_float_to_rgba8_rows_sse41(uint8_t *dst_row, unsigned dst_stride,
+                                      const uint8_t *src_row, unsigned src_stride,
+                                      unsigned width, unsigned height,
+                                      uint32_t pattern)
+{
+   const __m128i shuffle = util_format_shuffle_mask_sse41(pattern);
+   const unsigned simd_width = width & ~3;
+   unsigned x, y;
+
+   for (y = 0; y < height; ++y) {
+      const float *src = (const float *)src_row;
+
+      for (x = 0; x < simd_width; x += 4) {
+         __m128i p0 = util_format_float_to_ubyte_sse41(_mm_loadu_ps(src + 0));
+         __m128i p1 = util_format_float_to_ubyte_sse41(_mm_loadu_ps(src + 4));
+         __m128i p2 = util_format_float_to_ubyte_sse41(_mm_loadu_ps(src + 8));
+         __m128i p3 = util_format_float_to_ubyte_sse41(_mm_loadu_ps(src + 12));
+         __m128i p = _mm_packus_epi16(_mm_packus_epi32(p0, p1),
+                                      _mm_packus_epi32(p2, p3));
+         p = _mm_shuffle_epi8(p, shuffle);
+         _mm_storeu_si128((__m128i *)(dst_row + x * 4), p);
+         src += 16;
+      }
+      dst_row += dst_stride;
+      src_row += src_stride;
+   }
+
+   return simd_width;
+}
+
+
+static inline UTIL_FORMAT_AVX2 unsigned
+util_format_float_to_rgba8_rows_avx2(uint8_t *dst_row, unsigned dst_stride,
+                                     const uint8_t *src_row, unsigned src_stride,
+                                     unsigned width, unsigned height,
+                                     uint32_t pattern)
+{
+   const __m256i shuffle = util_format_shuffle_mask_avx2(pattern);
+   /* the packs below leave the pixels in 0 2 4 6 1 3 5 7 order */
+   const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+   const unsigned simd_width = width & ~7;
+   unsigned x, y;
+
+   for (y = 0; y < height; ++y) {
+      const float *src = (const float *)src_row;
+
+      for (x = 0; x < simd_width; x += 8) {
+         __m256i p0 = util_format_float_to_ubyte_avx2(_mm256_loadu_ps(src + 0));
+         __m256i p1 = util_format_float_to_ubyte_avx2(_mm256_loadu_ps(src + 8));
+         __m256i p2 = util_format_float_to_ubyte_avx2(_mm256_loadu_ps(src + 16));
+         __m256i p3 = util_format_float_to_ubyte_avx2(_mm256_loadu_ps(src + 24));
+         __m256i p = _mm256_packus_epi16(_mm256_packus_epi32(p0, p1),
+                                         _mm256_packus_epi32(p2, p3));
+         p = _mm256_permutevar8x32_epi32(p, order);
+         p = _mm256_shuffle_epi8(p, shuffle);
+         _mm256_storeu_si256((__m256i *)(dst_row + x * 4), p);
+         src += 32;
+      }
+      dst_row += dst_stride;
+      src_row += src_stride;
+   }
+
+   return simd_width;
+}
+
+
+#endif /* UTIL_FORMAT_SIMD */
+
+
+#endif /* U_FORMAT_SIMD_H_ */
@@ -0,0 +1,596 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \brief  Tile-binned, multithreaded quad rendering.
+ *
+ * Quads are binned per framebuffer tile in the batches the setup code
+ * produces them.  The per-primitive interpolation coefficients are copied
+ * once per primitive since setup overwrites them for the next one.
+ *
+ * The workers share the context's color/depth tile caches.  Those are
+ * direct mapped, so tiles are rendered in waves in which no two tiles map
+ * to the same cache position; a worker then only ever touches the cache
+ * entries of its own tile (see sp_tile_cache_begin_threaded()).
+ */
+
+#include "util/u_dynarray.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_queue.h"
+#include "tgsi/tgsi_exec.h"
+#include "sp_bin.h"
+#include "sp_context.h"
+#include "sp_limits.h"
+#include "sp_quad.h"
+#include "sp_quad_pipe.h"
+#include "sp_state.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_texture.h"
+#include "sp_tile_cache.h"
+
+
+/** Max number of quads in a batch (MAX_QUADS in sp_setup.c) */
+#define SP_BIN_MAX_QUADS 16
+
+/** Render the bins early once they hold this much data */
+#define SP_BIN_MAX_SIZE (16 * 1024 * 1024)
+
+/** No coefficients have been stored for the current primitive */
+#define SP_BIN_NO_PRIM (~0u)
+
+
+/**
+ * Interpolation coefficients of a primitive, copied from setup_context.
+ */
+struct sp_bin_prim {
+   struct tgsi_interp_coef posCoef;
+   struct tgsi_interp_coef coef[PIPE_MAX_SHADER_INPUTS]; /**< num_coefs used */
+};
+
+
+/**
+ * A batch of quads as it was passed to the quad pipeline by setup.
+ * Followed by nr sp_bin_quad records.
+ */
+struct sp_bin_cmd {
+   unsigned prim;   /**< offset of the sp_bin_prim in sp_bin::prims */
+   unsigned nr;
+};
+
+
+struct sp_bin_quad {
+   struct quad_header_input input;
+   unsigned mask;
+};
+
+
+/**
+ * Per worker thread state.
+ */
+struct sp_bin_thread {
+   struct tgsi_exec_machine *machine;
+   struct sp_quad_pipeline quad;
+
+   /** Copy of the context's fragment sampler, using the caches below */
+   struct sp_tgsi_sampler sampler;
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+
+   unsigned serial;   /**< sp_bin::serial the state was set up for */
+
+   struct quad_header quads[SP_BIN_MAX_QUADS];
+   struct quad_header *quad_ptrs[SP_BIN_MAX_QUADS];
+};
+
+
+struct sp_bin_job {
+   struct sp_bin *bin;
+   unsigned tile;
+   struct util_queue_fence fence;
+};
+
+
+struct sp_bin {
+   struct softpipe_context *softpipe;
+
+   struct util_queue queue;
+   unsigned num_threads;
+   struct sp_bin_thread *threads[SP_MAX_THREADS];
+
+   /** Incremented by state changes, tells the workers to revalidate */
+   unsigned serial;
+
+   /** Commands per framebuffer tile, row-major */
+   struct util_dynarray *tiles;
+   unsigned num_tiles;
+   unsigned tiles_x, tiles_y;
+
+   /** Indices of the tiles with a non-empty bin */
+   struct util_dynarray pending;
+
+   /** sp_bin_prim storage, only referenced by offset as it may move */
+   struct util_dynarray prims;
+   unsigned prim;
+   unsigned prim_size;
+
+   /** Total amount of binned data */
+   unsigned size;
+
+   /** One job per tile cache position, which limits the size of a wave */
+   struct sp_bin_job jobs[NUM_ENTRIES];
+};
+
+
+/**
+ * Set up a worker's machine, pipeline and texture caches for the
+ * current state.  Runs on the worker thread, the context state is
+ * only read.
+ */
+static void
+sp_bin_prepare_thread(struct sp_bin *bin, struct sp_bin_thread *thread)
+{
+   struct softpipe_context *sp = bin->softpipe;
+   unsigned i;
+
+   /* The texture tile caches are modified by lookups, so every worker
+    * samples through its own copies.
+    */
+   memcpy(&thread->sampler, sp->tgsi.sampler[PIPE_SHADER_FRAGMENT],
+          sizeof(thread->sampler));
+
+   for (i = 0; i < sp->num_sampler_views[PIPE_SHADER_FRAGMENT]; i++) {
+      struct pipe_sampler_view *view =
+         sp->sampler_views[PIPE_SHADER_FRAGMENT][i];
+      struct softpipe_tex_tile_cache *tc = thread->tex_cache[i];
+
+      if (!view)
+         continue;
+
+      sp_tex_tile_cache_set_sampler_view(tc, view);
+      if (tc->texture) {
+         struct softpipe_resource *spt = softpipe_resource(tc->texture);
+         if (spt->timestamp != tc->timestamp) {
+            sp_tex_tile_cache_validate_texture(tc);
+            tc->timestamp = spt->timestamp;
+         }
+      }
+
+      thread->sampler.sp_sview[i].cache = tc;
+   }
+
+   sp->fs_variant->prepare(sp->fs_variant,
+                           thread->machine,
+                           (struct tgsi_sampler *) &thread->sampler,
+                           (struct tgsi_image *)
+                              sp->tgsi.image[PIPE_SHADER_FRAGMENT],
+                           (struct tgsi_buffer *)
+                              sp->tgsi.buffer[PIPE_SHADER_FRAGMENT]);
+
+   sp_link_quad_pipeline(sp, &thread->quad);
+   thread->quad.first->begin(thread->quad.first);
+
+   thread->serial = bin->serial;
+}
+
+
+/**
+ * Run the binned quads of one tile through a worker's quad pipeline.
+ * Called via util_queue.
+ */
+static void
+sp_bin_render_tile(void *data, int thread_index)
+{
+   struct sp_bin_job *job = (struct sp_bin_job *) data;
+   struct sp_bin *bin = job->bin;
+   struct sp_bin_thread *thread = bin->threads[thread_index];
+   struct util_dynarray *cmds = &bin->tiles[job->tile];
+   const char *ptr = util_dynarray_begin(cmds);
+   const char *end = util_dynarray_end(cmds);
+
+   if (thread->serial != bin->serial)
+      sp_bin_prepare_thread(bin, thread);
+
+   while (ptr < end) {
+      const struct sp_bin_cmd *cmd = (const struct sp_bin_cmd *) ptr;
+      const struct sp_bin_quad *bq = (const struct sp_bin_quad *) (cmd + 1);
+      const struct sp_bin_prim *prim = (const struct sp_bin_prim *)
+         ((const char *) bin->prims.data + cmd->prim);
+      unsigned i;
+
+      for (i = 0; i < cmd->nr; i++) {
+         struct quad_header *quad = &thread->quads[i];
+
+         quad->input = bq[i].input;
+         quad->inout.mask = bq[i].mask;
+         quad->posCoef = &prim->posCoef;
+         quad->coef = prim->coef;
+         thread->quad_ptrs[i] = quad;
+      }
+
+      thread->quad.first->run(thread->quad.first, thread->quad_ptrs, cmd->nr);
+
+      ptr = (const char *) (bq + cmd->nr);
+   }
+
+   util_dynarray_clear(cmds);
+}
+
+
+/**
+ * Called before setup starts generating quads with the current state.
+ * \return TRUE if the quads should be binned, FALSE to render them
+ *         on the calling thread
+ */
+boolean
+sp_bin_prepare(struct sp_bin *bin)
+{
+   struct softpipe_context *sp = bin->softpipe;
+   const struct tgsi_shader_info *info = &sp->fs_variant->info;
+   const unsigned num_views = sp->num_sampler_views[PIPE_SHADER_FRAGMENT];
+   unsigned num_tiles, i, t;
+
+   assert(!bin->pending.size);
+
+   /* Stores and atomics from different tiles could land in a different
+    * order than on the serial path, and layered rendering would spread
+    * a bin over several tile cache positions.
+    */
+   if (info->writes_memory || sp->layer_slot > 0)
+      return FALSE;
+
+   for (t = 0; t < bin->num_threads; t++) {
+      struct sp_bin_thread *thread = bin->threads[t];
+
+      for (i = 0; i < num_views; i++) {
+         if (sp->sampler_views[PIPE_SHADER_FRAGMENT][i] &&
+             !thread->tex_cache[i]) {
+            thread->tex_cache[i] = sp_create_tex_tile_cache(&sp->pipe);
+            if (!thread->tex_cache[i])
+               return FALSE;
+         }
+      }
+   }
+
+   bin->tiles_x = DIV_ROUND_UP(sp->framebuffer.width, TILE_SIZE);
+   bin->tiles_y = DIV_ROUND_UP(sp->framebuffer.height, TILE_SIZE);
+
+   num_tiles = bin->tiles_x * bin->tiles_y;
+   if (num_tiles > bin->num_tiles) {
+      struct util_dynarray *tiles =
+         REALLOC(bin->tiles,
+                 bin->num_tiles * sizeof(struct util_dynarray),
+                 num_tiles * sizeof(struct util_dynarray));
+      if (!tiles)
+         return FALSE;
+
+      for (i = bin->num_tiles; i < num_tiles; i++)
+         util_dynarray_init(&tiles[i], NULL);
+
+      bin->tiles = tiles;
+      bin->num_tiles = num_tiles;
+   }
+
+   bin->prim_size = sizeof(struct tgsi_interp_coef) *
+                    (1 + info->file_max[TGSI_FILE_INPUT] + 1);
+   bin->prim = SP_BIN_NO_PRIM;
+
+   return TRUE;
+}
+
+
+/**
+ * Setup is starting a new primitive, its coefficients will change.
+ */
+void
+sp_bin_begin_prim(struct sp_bin *bin)
+{
+   bin->prim = SP_BIN_NO_PRIM;
+}
+
+
+/**
+ * Put a batch of quads into the bin of the tile they're in.
+ * All quads of a batch are within the same tile.
+ */
+void
+sp_bin_quads(struct sp_bin *bin, struct quad_header *quads[], unsigned nr)
+{
+   const unsigned tx = quads[0]->input.x0 / TILE_SIZE;
+   const unsigned ty = quads[0]->input.y0 / TILE_SIZE;
+   const unsigned tile = ty * bin->tiles_x + tx;
+   const unsigned size = sizeof(struct sp_bin_cmd) +
+                         nr * sizeof(struct sp_bin_quad);
+   struct util_dynarray *cmds = &bin->tiles[tile];
+   struct sp_bin_cmd *cmd;
+   struct sp_bin_quad *bq;
+   unsigned i;
+
+   assert(nr <= SP_BIN_MAX_QUADS);
+   assert(tx < bin->tiles_x && ty < bin->tiles_y);
+
+   if (bin->size + size > SP_BIN_MAX_SIZE)
+      sp_bin_flush(bin);
+
+   if (bin->prim == SP_BIN_NO_PRIM) {
+      struct sp_bin_prim *prim;
+
+      bin->prim = bin->prims.size;
+      prim = (struct sp_bin_prim *) util_dynarray_grow(&bin->prims,
+                                                        bin->prim_size);
+      memcpy(&prim->posCoef, quads[0]->posCoef, sizeof(prim->posCoef));
+      memcpy(prim->coef, quads[0]->coef,
+             bin->prim_size - sizeof(prim->posCoef));
+      bin->size += bin->prim_size;
+   }
+
+   if (!cmds->size)
+      util_dynarray_append(&bin->pending, unsigned, tile);
+
+   cmd = (struct sp_bin_cmd *) util_dynarray_grow(cmds, size);
+   cmd->prim = bin->prim;
+   cmd->nr = nr;
+
+   bq = (struct sp_bin_quad *) (cmd + 1);
+   for (i = 0; i < nr; i++) {
+      assert(quads[i]->input.x0 / TILE_SIZE == tx);
+      assert(quads[i]->input.y0 / TILE_SIZE == ty);
+      bq[i].input = quads[i]->input;
+      bq[i].mask = quads[i]->inout.mask;
+   }
+
+   bin->size += size;
+}
+
+
+/**
+ * Render all binned quads and wait for the workers to finish.
+ */
+void
+sp_bin_flush(struct sp_bin *bin)
+{
+   struct softpipe_context *sp = bin->softpipe;
+   struct softpipe_tile_cache *caches[PIPE_MAX_COLOR_BUFS + 1];
+   unsigned *tiles = (unsigned *) bin->pending.data;
+   unsigned num_tiles = util_dynarray_num_elements(&bin->pending, unsigned);
+   unsigned num_caches = 0, i;
+   boolean threaded = TRUE;
+
+   if (!num_tiles)
+      return;
+
+   for (i = 0; i < sp->framebuffer.nr_cbufs; i++) {
+      if (sp->framebuffer.cbufs[i])
+         caches[num_caches++] = sp->cbuf_cache[i];
+   }
+   if (sp->framebuffer.zsbuf)
+      caches[num_caches++] = sp->zsbuf_cache;
+
+   for (i = 0; i < num_caches; i++) {
+      if (!sp_tile_cache_begin_threaded(caches[i])) {
+         threaded = FALSE;
+         num_caches = i;
+         break;
+      }
+   }
+
+   if (threaded) {
+      STATIC_ASSERT(NUM_ENTRIES <= 64);
+
+      while (num_tiles) {
+         uint64_t used = 0;
+         unsigned num_jobs = 0, remaining = 0;
+
+         /* Start all tiles with a free cache position, defer the others
+          * to the next wave.  The order of tiles doesn't matter.
+          */
+         for (i = 0; i < num_tiles; i++) {
+            const unsigned tile = tiles[i];
+            const union tile_address addr =
+               tile_address((tile % bin->tiles_x) * TILE_SIZE,
+                            (tile / bin->tiles_x) * TILE_SIZE, 0);
+            const uint64_t bit = 1ull << sp_tile_cache_pos(addr);
+            struct sp_bin_job *job;
+
+            if (used & bit) {
+               tiles[remaining++] = tile;
+               continue;
+            }
+            used |= bit;
+
+            job = &bin->jobs[num_jobs++];
+            job->tile = tile;
+            util_queue_add_job(&bin->queue, job, &job->fence,
+                               sp_bin_render_tile, NULL);
+         }
+
+         for (i = 0; i < num_jobs; i++)
+            util_queue_fence_wait(&bin->jobs[i].fence);
+
+         num_tiles = remaining;
+      }
+   }
+   else {
+      /* Out of memory for the tile caches, render on this thread. */
+      for (i = 0; i < num_tiles; i++) {
+         bin->jobs[0].tile = tiles[i];
+         sp_bin_render_tile(&bin->jobs[0], 0);
+      }
+   }
+
+   for (i = 0; i < num_caches; i++)
+      sp_tile_cache_end_threaded(caches[i]);
+
+   util_dynarray_clear(&bin->pending);
+   util_dynarray_clear(&bin->prims);
+   bin->prim = SP_BIN_NO_PRIM;
+   bin->size = 0;
+}
+
+
+/**
+ * The state the workers were set up for has changed.
+ */
+void
+sp_bin_invalidate(struct sp_bin *bin)
+{
+   bin->serial++;
+}
+
+
+/**
+ * Drop the workers' references to the textures they sampled from, along
+ * with the tiles they cached.  Called on flush, with no binned quads.
+ */
+void
+sp_bin_release_textures(struct sp_bin *bin)
+{
+   unsigned t, i;
+
+   assert(!bin->pending.size);
+
+   for (t = 0; t < bin->num_threads; t++) {
+      struct sp_bin_thread *thread = bin->threads[t];
+
+      for (i = 0; i < ARRAY_SIZE(thread->tex_cache); i++) {
+         if (thread->tex_cache[i])
+            sp_tex_tile_cache_set_sampler_view(thread->tex_cache[i], NULL);
+      }
+   }
+
+   sp_bin_invalidate(bin);
+}
+
+
+static void
+sp_bin_destroy_thread(struct sp_bin_thread *thread)
+{
+   unsigned i;
+
+   sp_destroy_quad_pipeline(&thread->quad);
+
+   if (thread->machine)
+      tgsi_exec_machine_destroy(thread->machine);
+
+   for (i = 0; i < ARRAY_SIZE(thread->tex_cache); i++) {
+      if (thread->tex_cache[i]) {
+         sp_tex_tile_cache_set_sampler_view(thread->tex_cache[i], NULL);
+         sp_destroy_tex_tile_cache(thread->tex_cache[i]);
+      }
+   }
+
+   FREE(thread);
+}
+
+
+static struct sp_bin_thread *
+sp_bin_create_thread(struct softpipe_context *softpipe)
+{
+   struct sp_bin_thread *thread = CALLOC_STRUCT(sp_bin_thread);
+
+   if (!thread)
+      return NULL;
+
+   thread->machine = tgsi_exec_machine_create(PIPE_SHADER_FRAGMENT);
+   if (!thread->machine)
+      goto fail;
+
+   if (!sp_create_quad_pipeline(softpipe, thread->machine, &thread->quad))
+      goto fail;
+
+   return thread;
+
+fail:
+   sp_bin_destroy_thread(thread);
+   return NULL;
+}
+
+
+struct sp_bin *
+sp_bin_create(struct softpipe_context *softpipe, unsigned num_threads)
+{
+   struct sp_bin *bin = CALLOC_STRUCT(sp_bin);
+   unsigned i;
+
+   assert(num_threads > 0 && num_threads <= SP_MAX_THREADS);
+
+   if (!bin)
+      return NULL;
+
+   bin->softpipe = softpipe;
+   bin->prim = SP_BIN_NO_PRIM;
+   /* Workers start at serial 0, make sure they set up for the first draw */
+   bin->serial = 1;
+   util_dynarray_init(&bin->pending, NULL);
+   util_dynarray_init(&bin->prims, NULL);
+
+   for (i = 0; i < ARRAY_SIZE(bin->jobs); i++) {
+      bin->jobs[i].bin = bin;
+      util_queue_fence_init(&bin->jobs[i].fence);
+   }
+
+   for (i = 0; i < num_threads; i++) {
+      bin->threads[i] = sp_bin_create_thread(softpipe);
+      if (!bin->threads[i])
+         goto fail;
+      bin->num_threads++;
+   }
+
+   if (!util_queue_init(&bin->queue, "softpipe", NUM_ENTRIES, num_threads, 0))
+      goto fail;
+
+   return bin;
+
+fail:
+   sp_bin_destroy(bin);
+   return NULL;
+}
+
+
+void
+sp_bin_destroy(struct sp_bin *bin)
+{
+   unsigned i;
+
+   assert(!bin->pending.size);
+
+   if (util_queue_is_initialized(&bin->queue))
+      util_queue_destroy(&bin->queue);
+
+   for (i = 0; i < bin->num_threads; i++)
+      sp_bin_destroy_thread(bin->threads[i]);
+
+   for (i = 0; i < ARRAY_SIZE(bin->jobs); i++)
+      util_queue_fence_destroy(&bin->jobs[i].fence);
+
+   for (i = 0; i < bin->num_tiles; i++)
+      util_dynarray_fini(&bin->tiles[i]);
+   FREE(bin->tiles);
+
+   util_dynarray_fini(&bin->pending);
+   util_dynarray_fini(&bin->prims);
+
+   FREE(bin);
+}
@@ -0,0 +1,73 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \brief  Tile-binned, multithreaded quad rendering.
+ *
+ * When enabled (SOFTPIPE_NUM_THREADS > 0), primitive setup doesn't run
+ * the quad pipeline itself but sorts the quads it generates into bins,
+ * one per framebuffer tile (see sp_tile_cache.h).  At the end of each
+ * vbuf draw the bins are handed to a pool of worker threads.  Every
+ * worker owns its own TGSI machine, quad pipeline and texture caches,
+ * and renders whole tiles, so the quads of a tile are processed in
+ * exactly the same order and batches as on the serial path.
+ */
+
+#ifndef SP_BIN_H
+#define SP_BIN_H
+
+#include "pipe/p_compiler.h"
+
+
+struct softpipe_context;
+struct quad_header;
+struct sp_bin;
+
+
+struct sp_bin *
+sp_bin_create(struct softpipe_context *softpipe, unsigned num_threads);
+
+void
+sp_bin_destroy(struct sp_bin *bin);
+
+boolean
+sp_bin_prepare(struct sp_bin *bin);
+
+void
+sp_bin_begin_prim(struct sp_bin *bin);
+
+void
+sp_bin_quads(struct sp_bin *bin, struct quad_header *quads[], unsigned nr);
+
+void
+sp_bin_flush(struct sp_bin *bin);
+
+void
+sp_bin_invalidate(struct sp_bin *bin);
+
+void
+sp_bin_release_textures(struct sp_bin *bin);
+
+
+#endif /* SP_BIN_H */
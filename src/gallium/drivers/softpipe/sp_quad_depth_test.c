@@ -31,6 +31,7 @@
  */
 
 #include "pipe/p_defines.h"
+#include "util/u_atomic.h"
 #include "util/u_format.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
@@ -842,8 +843,11 @@ depth_test_quads_fallback(struct quad_stage *qs,
    }
 
    if (qs->softpipe->active_query_count) {
+      unsigned count = 0;
       for (i = 0; i < nr; i++) 
-         qs->softpipe->occlusion_count += mask_count[quads[i]->inout.mask];
+         count += mask_count[quads[i]->inout.mask];
+      /* may be running on several rasterizer threads */
+      p_atomic_add(&qs->softpipe->occlusion_count, count);
    }
 
    if (nr)
@@ -36,6 +36,7 @@
  * all the enabled attributes run contiguously.
  */
 
+#include "util/u_atomic.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "pipe/p_defines.h"
@@ -51,10 +52,19 @@ struct quad_shade_stage
 {
    struct quad_stage stage;  /**< base class */
 
-   /* no other fields at this time */
+   /** The interpreter this stage runs the fragment shader on */
+   struct tgsi_exec_machine *machine;
 };
 
 
+/** cast wrapper */
+static inline struct quad_shade_stage *
+quad_shade_stage(struct quad_stage *qs)
+{
+   return (struct quad_shade_stage *) qs;
+}
+
+
 /**
  * Execute fragment shader for the four fragments in the quad.
  * \return TRUE if quad is alive, FALSE if all four pixels are killed
@@ -63,11 +73,12 @@ static inline boolean
 shade_quad(struct quad_stage *qs, struct quad_header *quad)
 {
    struct softpipe_context *softpipe = qs->softpipe;
-   struct tgsi_exec_machine *machine = softpipe->fs_machine;
+   struct tgsi_exec_machine *machine = quad_shade_stage(qs)->machine;
 
    if (softpipe->active_statistics_queries) {
-      softpipe->pipeline_statistics.ps_invocations +=
-         util_bitcount(quad->inout.mask);         
+      /* may be running on several rasterizer threads */
+      p_atomic_add(&softpipe->pipeline_statistics.ps_invocations,
+                   util_bitcount(quad->inout.mask));
    }
 
    /* run shader */
@@ -106,7 +117,7 @@ shade_quads(struct quad_stage *qs,
             unsigned nr)
 {
    struct softpipe_context *softpipe = qs->softpipe;
-   struct tgsi_exec_machine *machine = softpipe->fs_machine;
+   struct tgsi_exec_machine *machine = quad_shade_stage(qs)->machine;
    unsigned i, nr_quads = 0;
 
    tgsi_exec_set_constant_buffers(machine, PIPE_MAX_CONSTANT_BUFFERS,
@@ -157,13 +168,15 @@ shade_destroy(struct quad_stage *qs)
 
 
 struct quad_stage *
-sp_quad_shade_stage( struct softpipe_context *softpipe )
+sp_quad_shade_stage( struct softpipe_context *softpipe,
+                     struct tgsi_exec_machine *machine )
 {
    struct quad_shade_stage *qss = CALLOC_STRUCT(quad_shade_stage);
    if (!qss)
       goto fail;
 
    qss->stage.softpipe = softpipe;
+   qss->machine = machine;
    qss->stage.begin = shade_begin;
    qss->stage.run = shade_quads;
    qss->stage.destroy = shade_destroy;
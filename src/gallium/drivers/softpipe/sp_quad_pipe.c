@@ -32,10 +32,75 @@
 
 
 static void
-insert_stage_at_head(struct softpipe_context *sp, struct quad_stage *quad)
+insert_stage_at_head(struct sp_quad_pipeline *pipeline,
+                     struct quad_stage *quad)
 {
-   quad->next = sp->quad.first;
-   sp->quad.first = quad;
+   quad->next = pipeline->first;
+   pipeline->first = quad;
+}
+
+
+/**
+ * Create the quad stages of a fragment pipeline.  The shade stage runs
+ * the fragment shader on the given machine.
+ */
+boolean
+sp_create_quad_pipeline(struct softpipe_context *sp,
+                        struct tgsi_exec_machine *machine,
+                        struct sp_quad_pipeline *quad)
+{
+   quad->shade = sp_quad_shade_stage(sp, machine);
+   quad->depth_test = sp_quad_depth_test_stage(sp);
+   quad->blend = sp_quad_blend_stage(sp);
+   quad->pstipple = sp_quad_polygon_stipple_stage(sp);
+   quad->first = NULL;
+
+   return quad->shade && quad->depth_test && quad->blend && quad->pstipple;
+}
+
+
+void
+sp_destroy_quad_pipeline(struct sp_quad_pipeline *quad)
+{
+   if (quad->shade)
+      quad->shade->destroy( quad->shade );
+
+   if (quad->depth_test)
+      quad->depth_test->destroy( quad->depth_test );
+
+   if (quad->blend)
+      quad->blend->destroy( quad->blend );
+
+   if (quad->pstipple)
+      quad->pstipple->destroy( quad->pstipple );
+
+   memset(quad, 0, sizeof(*quad));
+}
+
+
+/**
+ * Chain the stages of a pipeline according to the current state.
+ * sp_build_quad_pipeline() must have been called for that state.
+ */
+void
+sp_link_quad_pipeline(struct softpipe_context *sp,
+                      struct sp_quad_pipeline *quad)
+{
+   quad->first = quad->blend;
+
+   if (sp->early_depth) {
+      insert_stage_at_head( quad, quad->shade );
+      insert_stage_at_head( quad, quad->depth_test );
+   }
+   else {
+      insert_stage_at_head( quad, quad->depth_test );
+      insert_stage_at_head( quad, quad->shade );
+   }
+
+#if !DO_PSTIPPLE_IN_DRAW_MODULE && !DO_PSTIPPLE_IN_HELPER_MODULE
+   if (sp->rasterizer->poly_stipple_enable)
+      insert_stage_at_head( quad, quad->pstipple );
+#endif
 }
 
 
@@ -51,21 +116,8 @@ sp_build_quad_pipeline(struct softpipe_context *sp)
        !sp->fs_variant->info.writes_stencil) ||
       sp->fs_variant->info.properties[TGSI_PROPERTY_FS_EARLY_DEPTH_STENCIL];
 
-   sp->quad.first = sp->quad.blend;
-
    sp->early_depth = early_depth_test;
-   if (early_depth_test) {
-      insert_stage_at_head( sp, sp->quad.shade );
-      insert_stage_at_head( sp, sp->quad.depth_test );
-   }
-   else {
-      insert_stage_at_head( sp, sp->quad.depth_test );
-      insert_stage_at_head( sp, sp->quad.shade );
-   }
 
-#if !DO_PSTIPPLE_IN_DRAW_MODULE && !DO_PSTIPPLE_IN_HELPER_MODULE
-   if (sp->rasterizer->poly_stipple_enable)
-      insert_stage_at_head( sp, sp->quad.pstipple );
-#endif
+   sp_link_quad_pipeline(sp, &sp->quad);
 }
 
@@ -31,9 +31,12 @@
 #ifndef SP_QUAD_PIPE_H
 #define SP_QUAD_PIPE_H
 
+#include "pipe/p_compiler.h"
+
 
 struct softpipe_context;
 struct quad_header;
+struct tgsi_exec_machine;
 
 
 /**
@@ -55,9 +58,24 @@ struct quad_stage {
 };
 
 
+/**
+ * The set of quad stages making up one fragment processing pipeline.
+ * The context owns one of these; the binned rasterizer owns one per
+ * worker thread.
+ */
+struct sp_quad_pipeline {
+   struct quad_stage *shade;
+   struct quad_stage *depth_test;
+   struct quad_stage *blend;
+   struct quad_stage *pstipple;
+   struct quad_stage *first; /**< points to one of the above stages */
+};
+
+
 struct quad_stage *sp_quad_polygon_stipple_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_earlyz_stage( struct softpipe_context *softpipe );
-struct quad_stage *sp_quad_shade_stage( struct softpipe_context *softpipe );
+struct quad_stage *sp_quad_shade_stage( struct softpipe_context *softpipe,
+                                        struct tgsi_exec_machine *machine );
 struct quad_stage *sp_quad_alpha_test_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_stencil_test_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_depth_test_stage( struct softpipe_context *softpipe );
@@ -67,6 +85,12 @@ struct quad_stage *sp_quad_blend_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_colormask_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_output_stage( struct softpipe_context *softpipe );
 
+boolean sp_create_quad_pipeline(struct softpipe_context *sp,
+                                struct tgsi_exec_machine *machine,
+                                struct sp_quad_pipeline *quad);
+void sp_destroy_quad_pipeline(struct sp_quad_pipeline *quad);
+void sp_link_quad_pipeline(struct softpipe_context *sp,
+                           struct sp_quad_pipeline *quad);
 void sp_build_quad_pipeline(struct softpipe_context *sp);
 
 #endif /* SP_QUAD_PIPE_H */
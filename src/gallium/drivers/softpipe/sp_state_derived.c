@@ -32,6 +32,7 @@
 #include "pipe/p_shader_tokens.h"
 #include "draw/draw_context.h"
 #include "draw/draw_vertex.h"
+#include "sp_bin.h"
 #include "sp_context.h"
 #include "sp_screen.h"
 #include "sp_state.h"
@@ -442,6 +443,12 @@ softpipe_update_derived(struct softpipe_context *softpipe, unsigned prim)
       softpipe->dirty |= SP_NEW_TEXTURE;
    }
 
+   /* The tile binning workers copy the derived state when they start
+    * rendering, they need to set up again after any change.
+    */
+   if (softpipe->dirty && softpipe->bin)
+      sp_bin_invalidate(softpipe->bin);
+
 #if DO_PSTIPPLE_IN_HELPER_MODULE
    if (softpipe->dirty & SP_NEW_STIPPLE)
       /* before updating samplers! */
@@ -41,6 +41,7 @@
 #include "util/u_format.h"
 #include "util/u_memory.h"
 #include "util/u_inlines.h"
+#include "util/u_sse.h"
 #include "sp_quad.h"   /* only for #define QUAD_* tokens */
 #include "sp_tex_sample.h"
 #include "sp_texture.h"
@@ -1686,6 +1687,275 @@ img_filter_2d_linear(const struct sp_sampler_view *sp_sview,
 }
 
 
+/*
+ * Direct image filters: for a few common formats the texels are read
+ * straight from the texture's linear storage instead of going through
+ * the texture tile cache, which would convert a whole 64x64 tile to
+ * float on every miss.  The unpack functions produce exactly the same
+ * values as util_format's unpack_rgba_float, so results don't depend
+ * on which path was taken.
+ */
+
+static void
+unpack_texel_r8g8b8a8_unorm(const uint8_t *src, float *rgba)
+{
+#if defined(PIPE_ARCH_SSE)
+   const __m128i zero = _mm_setzero_si128();
+   __m128i texel;
+   int32_t value;
+
+   memcpy(&value, src, sizeof(value));
+   texel = _mm_cvtsi32_si128(value);
+   texel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(texel, zero), zero);
+   _mm_storeu_ps(rgba, _mm_mul_ps(_mm_cvtepi32_ps(texel),
+                                 _mm_set1_ps(1.0f / 255.0f)));
+#else
+   rgba[0] = ubyte_to_float(src[0]);
+   rgba[1] = ubyte_to_float(src[1]);
+   rgba[2] = ubyte_to_float(src[2]);
+   rgba[3] = ubyte_to_float(src[3]);
+#endif
+}
+
+
+static void
+unpack_texel_r8g8b8x8_unorm(const uint8_t *src, float *rgba)
+{
+   unpack_texel_r8g8b8a8_unorm(src, rgba);
+   rgba[3] = 1.0f;
+}
+
+
+static void
+unpack_texel_b8g8r8a8_unorm(const uint8_t *src, float *rgba)
+{
+#if defined(PIPE_ARCH_SSE)
+   __m128 texel;
+   unpack_texel_r8g8b8a8_unorm(src, rgba);
+   texel = _mm_loadu_ps(rgba);
+   _mm_storeu_ps(rgba, _mm_shuffle_ps(texel, texel, _MM_SHUFFLE(3, 0, 1, 2)));
+#else
+   rgba[0] = ubyte_to_float(src[2]);
+   rgba[1] = ubyte_to_float(src[1]);
+   rgba[2] = ubyte_to_float(src[0]);
+   rgba[3] = ubyte_to_float(src[3]);
+#endif
+}
+
+
+static void
+unpack_texel_b8g8r8x8_unorm(const uint8_t *src, float *rgba)
+{
+   unpack_texel_b8g8r8a8_unorm(src, rgba);
+   rgba[3] = 1.0f;
+}
+
+
+static void
+unpack_texel_r8_unorm(const uint8_t *src, float *rgba)
+{
+   rgba[0] = ubyte_to_float(src[0]);
+   rgba[1] = 0.0f;
+   rgba[2] = 0.0f;
+   rgba[3] = 1.0f;
+}
+
+
+static void
+unpack_texel_r32g32b32a32_float(const uint8_t *src, float *rgba)
+{
+   memcpy(rgba, src, 4 * sizeof(float));
+}
+
+
+static void
+unpack_texel_r32_float(const uint8_t *src, float *rgba)
+{
+   memcpy(rgba, src, sizeof(float));
+   rgba[1] = 0.0f;
+   rgba[2] = 0.0f;
+   rgba[3] = 1.0f;
+}
+
+
+/**
+ * Return the direct unpack function for a sampler view's format, or
+ * NULL if texels of the format have to be fetched through the tile cache.
+ */
+static unpack_texel_func
+get_unpack_texel_func(enum pipe_format format)
+{
+   switch (format) {
+   case PIPE_FORMAT_R8G8B8A8_UNORM:
+      return unpack_texel_r8g8b8a8_unorm;
+   case PIPE_FORMAT_R8G8B8X8_UNORM:
+      return unpack_texel_r8g8b8x8_unorm;
+   case PIPE_FORMAT_B8G8R8A8_UNORM:
+      return unpack_texel_b8g8r8a8_unorm;
+   case PIPE_FORMAT_B8G8R8X8_UNORM:
+      return unpack_texel_b8g8r8x8_unorm;
+   case PIPE_FORMAT_R8_UNORM:
+      return unpack_texel_r8_unorm;
+   case PIPE_FORMAT_R32G32B32A32_FLOAT:
+      return unpack_texel_r32g32b32a32_float;
+   case PIPE_FORMAT_R32_FLOAT:
+      return unpack_texel_r32_float;
+   default:
+      return NULL;
+   }
+}
+
+
+/**
+ * Location of one 2D image (mipmap level of the view's first layer)
+ * in the texture's linear storage.
+ */
+struct direct_image {
+   const uint8_t *data;
+   unsigned stride;
+   unsigned cpp;
+   int width;
+   int height;
+};
+
+
+static inline void
+get_direct_image(const struct sp_sampler_view *sp_sview, unsigned level,
+                 struct direct_image *img)
+{
+   const struct pipe_resource *texture = sp_sview->base.texture;
+   const struct softpipe_resource *spr =
+      (const struct softpipe_resource *) texture;
+
+   img->data = (const uint8_t *) spr->data + spr->level_offset[level] +
+               sp_sview->base.u.tex.first_layer * spr->img_stride[level];
+   img->stride = spr->stride[level];
+   img->cpp = sp_sview->texel_size;
+   img->width = u_minify(texture->width0, level);
+   img->height = u_minify(texture->height0, level);
+}
+
+
+/**
+ * Unpack the texel at (x, y) into 'texel', or return the border color
+ * if the coordinates are outside the image.
+ */
+static inline const float *
+get_texel_2d_direct(const struct sp_sampler_view *sp_sview,
+                    const struct sp_sampler *sp_samp,
+                    const struct direct_image *img,
+                    int x, int y, float *texel)
+{
+   if (x < 0 || x >= img->width || y < 0 || y >= img->height)
+      return sp_samp->base.border_color.f;
+
+   sp_sview->unpack_texel(img->data + y * img->stride + x * img->cpp, texel);
+   return texel;
+}
+
+
+/**
+ * Bilinear interpolation of four RGBA texels, all channels at once.
+ * Same operations in the same order as lerp_2d().
+ */
+static inline void
+lerp_2d_rgba(float a, float b, const float *tx[4], float *rgba)
+{
+#if defined(PIPE_ARCH_SSE)
+   PIPE_ALIGN_VAR(16) float result[4];
+   const __m128 va = _mm_set1_ps(a);
+   const __m128 vb = _mm_set1_ps(b);
+   const __m128 v00 = _mm_loadu_ps(tx[0]);
+   const __m128 v10 = _mm_loadu_ps(tx[1]);
+   const __m128 v01 = _mm_loadu_ps(tx[2]);
+   const __m128 v11 = _mm_loadu_ps(tx[3]);
+   const __m128 temp0 = _mm_add_ps(v00, _mm_mul_ps(va, _mm_sub_ps(v10, v00)));
+   const __m128 temp1 = _mm_add_ps(v01, _mm_mul_ps(va, _mm_sub_ps(v11, v01)));
+   int c;
+
+   _mm_store_ps(result,
+                _mm_add_ps(temp0, _mm_mul_ps(vb, _mm_sub_ps(temp1, temp0))));
+   for (c = 0; c < TGSI_NUM_CHANNELS; c++)
+      rgba[TGSI_NUM_CHANNELS*c] = result[c];
+#else
+   int c;
+
+   for (c = 0; c < TGSI_NUM_CHANNELS; c++)
+      rgba[TGSI_NUM_CHANNELS*c] = lerp_2d(a, b,
+                                          tx[0][c], tx[1][c],
+                                          tx[2][c], tx[3][c]);
+#endif
+}
+
+
+static void
+img_filter_2d_nearest_direct(const struct sp_sampler_view *sp_sview,
+                             const struct sp_sampler *sp_samp,
+                             const struct img_filter_args *args,
+                             float *rgba)
+{
+   PIPE_ALIGN_VAR(16) float texel[4];
+   struct direct_image img;
+   const float *out;
+   int x, y, c;
+
+   get_direct_image(sp_sview, args->level, &img);
+   assert(img.width > 0);
+   assert(img.height > 0);
+
+   sp_samp->nearest_texcoord_s(args->s, img.width, args->offset[0], &x);
+   sp_samp->nearest_texcoord_t(args->t, img.height, args->offset[1], &y);
+
+   out = get_texel_2d_direct(sp_sview, sp_samp, &img, x, y, texel);
+   for (c = 0; c < TGSI_NUM_CHANNELS; c++)
+      rgba[TGSI_NUM_CHANNELS*c] = out[c];
+
+   if (DEBUG_TEX) {
+      print_sample(__FUNCTION__, rgba);
+   }
+}
+
+
+static void
+img_filter_2d_linear_direct(const struct sp_sampler_view *sp_sview,
+                            const struct sp_sampler *sp_samp,
+                            const struct img_filter_args *args,
+                            float *rgba)
+{
+   PIPE_ALIGN_VAR(16) float texels[4][4];
+   struct direct_image img;
+   int x0, y0, x1, y1;
+   float xw, yw; /* weights */
+   const float *tx[4];
+   int c;
+
+   get_direct_image(sp_sview, args->level, &img);
+   assert(img.width > 0);
+   assert(img.height > 0);
+
+   sp_samp->linear_texcoord_s(args->s, img.width,  args->offset[0], &x0, &x1, &xw);
+   sp_samp->linear_texcoord_t(args->t, img.height, args->offset[1], &y0, &y1, &yw);
+
+   tx[0] = get_texel_2d_direct(sp_sview, sp_samp, &img, x0, y0, texels[0]);
+   tx[1] = get_texel_2d_direct(sp_sview, sp_samp, &img, x1, y0, texels[1]);
+   tx[2] = get_texel_2d_direct(sp_sview, sp_samp, &img, x0, y1, texels[2]);
+   tx[3] = get_texel_2d_direct(sp_sview, sp_samp, &img, x1, y1, texels[3]);
+
+   if (args->gather_only) {
+      for (c = 0; c < TGSI_NUM_CHANNELS; c++)
+         rgba[TGSI_NUM_CHANNELS*c] = get_gather_value(sp_sview, c,
+                                                      args->gather_comp,
+                                                      tx);
+   } else {
+      lerp_2d_rgba(xw, yw, tx, rgba);
+   }
+
+   if (DEBUG_TEX) {
+      print_sample(__FUNCTION__, rgba);
+   }
+}
+
+
 static void
 img_filter_2d_array_linear(const struct sp_sampler_view *sp_sview,
                            const struct sp_sampler *sp_samp,
@@ -3070,6 +3340,14 @@ get_img_filter(const struct sp_sampler_view *sp_sview,
       break;
    case PIPE_TEXTURE_2D:
    case PIPE_TEXTURE_RECT:
+      /* Read the texture directly if we can:
+       */
+      if (sp_sview->unpack_texel) {
+         if (filter == PIPE_TEX_FILTER_NEAREST)
+            return img_filter_2d_nearest_direct;
+         else
+            return img_filter_2d_linear_direct;
+      }
       /* Try for fast path:
        */
       if (!gather && sp_sview->pot2d &&
@@ -3153,7 +3431,8 @@ get_filters(const struct sp_sampler_view *sp_sview,
          *min = get_img_filter(sp_sview, &sp_samp->base,
                                PIPE_TEX_FILTER_LINEAR, true);
       }
-   } else if (sp_sview->pot2d & sp_samp->min_mag_equal_repeat_linear) {
+   } else if (sp_sview->pot2d & sp_samp->min_mag_equal_repeat_linear &&
+              !sp_sview->unpack_texel) {
       *funcs = &funcs_linear_2d_linear_repeat_POT;
    } else {
       *funcs = sp_samp->filter_funcs;
@@ -3633,6 +3912,14 @@ softpipe_create_sampler_view(struct pipe_context *pipe,
 
       sview->xpot = util_logbase2( resource->width0 );
       sview->ypot = util_logbase2( resource->height0 );
+
+      /* Bypass the tile cache for common formats of malloc'ed 2D textures */
+      if (spr->data && !spr->dt &&
+          (view->target == PIPE_TEXTURE_2D ||
+           view->target == PIPE_TEXTURE_RECT)) {
+         sview->unpack_texel = get_unpack_texel_func(view->format);
+         sview->texel_size = util_format_get_blocksize(view->format);
+      }
    }
 
    return (struct pipe_sampler_view *) sview;
@@ -103,6 +103,8 @@ typedef void (*fetch_func)(struct sp_sampler_view *sp_sview,
                            const int lod[TGSI_QUAD_SIZE], const int8_t offset[3],
                            float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE]);
 
+typedef void (*unpack_texel_func)(const uint8_t *src, float *rgba);
+
 
 struct sp_sampler_view
 {
@@ -117,6 +119,12 @@ struct sp_sampler_view
    boolean pot2d;
    boolean need_cube_convert;
 
+   /* For the direct (tile cache bypassing) 2D image filters, NULL if
+    * texels of this view's format must go through the tile cache:
+    */
+   unpack_texel_func unpack_texel;
+   unsigned texel_size;
+
    /* these are different per shader type */
    struct softpipe_tex_tile_cache *cache;
    compute_lambda_func compute_lambda;
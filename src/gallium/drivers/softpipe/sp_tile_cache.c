@@ -32,6 +32,7 @@
  *    Brian Paul
  */
 
+#include "util/u_atomic.h"
 #include "util/u_inlines.h"
 #include "util/u_format.h"
 #include "util/u_memory.h"
@@ -42,15 +43,6 @@ static struct softpipe_cached_tile *
 sp_alloc_tile(struct softpipe_tile_cache *tc);
 
 
-/**
- * Return the position in the cache for the tile that contains win pos (x,y).
- * We currently use a direct mapped cache so this is like a hack key.
- * At some point we should investige something more sophisticated, like
- * a LRU replacement policy.
- */
-#define CACHE_POS(x, y, l)                        \
-   (((x) + (y) * 5 + (l) * 10) % NUM_ENTRIES)
-
 
 static inline int addr_to_clear_pos(union tile_address addr)
 {
@@ -76,14 +68,20 @@ is_clear_flag_set(const uint *bitvec, union tile_address addr, unsigned max)
 
 /**
  * Mark the tile at (x,y) as not cleared.
+ * Neighbouring tiles share a flag word and may be fetched concurrently
+ * by the binned rasterizer, so the word is updated atomically.
  */
 static inline void
 clear_clear_flag(uint *bitvec, union tile_address addr, unsigned max)
 {
    int pos;
+   uint old, val;
    pos = addr_to_clear_pos(addr);
    assert(pos / 32 < max);
-   bitvec[pos / 32] &= ~(1 << (pos & 31));
+   do {
+      old = bitvec[pos / 32];
+      val = old & ~(1 << (pos & 31));
+   } while (p_atomic_cmpxchg(&bitvec[pos / 32], old, val) != old);
 }
    
 
@@ -516,11 +514,11 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
 {
    struct pipe_transfer *pt;
    /* cache pos/entry: */
-   const int pos = CACHE_POS(addr.bits.x,
-                             addr.bits.y, addr.bits.layer);
+   const int pos = sp_tile_cache_pos(addr);
    struct softpipe_cached_tile *tile = tc->entries[pos];
    int layer;
    if (!tile) {
+      assert(!tc->threaded);
       tile = sp_alloc_tile(tc);
       tc->entries[pos] = tile;
    }
@@ -615,12 +613,50 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
       }
    }
 
-   tc->last_tile = tile;
-   tc->last_tile_addr = addr;
+   /* the last tile shortcut is shared state, don't touch it from workers */
+   if (!tc->threaded) {
+      tc->last_tile = tile;
+      tc->last_tile_addr = addr;
+   }
    return tile;
 }
 
 
+/**
+ * Prepare the cache for concurrent access by the binned rasterizer.
+ * All cache entries get allocated up front so that workers never need
+ * to allocate or steal tiles.  The caller must ensure that no two
+ * threads access tiles mapping to the same cache position at once.
+ * \return FALSE if the entries couldn't be allocated
+ */
+boolean
+sp_tile_cache_begin_threaded(struct softpipe_tile_cache *tc)
+{
+   uint pos;
+
+   assert(!tc->threaded);
+
+   for (pos = 0; pos < ARRAY_SIZE(tc->entries); pos++) {
+      if (!tc->entries[pos]) {
+         tc->entries[pos] = MALLOC_STRUCT(softpipe_cached_tile);
+         if (!tc->entries[pos])
+            return FALSE;
+      }
+   }
+
+   tc->last_tile_addr.bits.invalid = 1;
+   tc->threaded = TRUE;
+   return TRUE;
+}
+
+
+void
+sp_tile_cache_end_threaded(struct softpipe_tile_cache *tc)
+{
+   tc->threaded = FALSE;
+}
+
+
 
 
 
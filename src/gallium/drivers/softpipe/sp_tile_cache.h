@@ -99,6 +99,12 @@ struct softpipe_tile_cache
 
    union tile_address last_tile_addr;
    struct softpipe_cached_tile *last_tile;  /**< most recently retrieved tile */
+
+   /**
+    * Set while the binned rasterizer's worker threads access the cache.
+    * Each worker then only touches the cache slots of its own tiles.
+    */
+   boolean threaded;
 };
 
 
@@ -127,6 +133,12 @@ extern struct softpipe_cached_tile *
 sp_find_cached_tile(struct softpipe_tile_cache *tc, 
                     union tile_address addr );
 
+extern boolean
+sp_tile_cache_begin_threaded(struct softpipe_tile_cache *tc);
+
+extern void
+sp_tile_cache_end_threaded(struct softpipe_tile_cache *tc);
+
 
 static inline union tile_address
 tile_address( unsigned x,
@@ -141,6 +153,16 @@ tile_address( unsigned x,
    return addr;
 }
 
+/**
+ * Return the position in the cache for the tile at the given address.
+ * We currently use a direct mapped cache so this is like a hash key.
+ */
+static inline unsigned
+sp_tile_cache_pos(union tile_address addr)
+{
+   return (addr.bits.x + addr.bits.y * 5 + addr.bits.layer * 10) % NUM_ENTRIES;
+}
+
 /* Quickly retrieve tile if it matches last lookup.
  */
 static inline struct softpipe_cached_tile *
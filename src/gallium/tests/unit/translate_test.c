@@ -29,6 +29,7 @@
 #include "util/u_format.h"
 #include "util/u_half.h"
 #include "util/u_cpu_detect.h"
+#include "util/os_time.h"
 #include "rtasm/rtasm_cpu.h"
 
 /* don't use this for serious use */
@@ -46,6 +47,95 @@ static double rand_double()
    return v;
 }
 
+static boolean
+cpu_has_avx2(void)
+{
+   return util_cpu_caps.has_avx && util_cpu_caps.has_avx2 &&
+          util_cpu_caps.has_f16c;
+}
+
+/*
+ * Vertex fetch throughput of the different backends, for a few common
+ * attribute formats, going through an index buffer like draw does.
+ */
+static int run_benchmark(void)
+{
+   static const enum pipe_format formats[] = {
+      PIPE_FORMAT_R32G32B32_FLOAT,
+      PIPE_FORMAT_R16G16B16A16_FLOAT,
+      PIPE_FORMAT_R8G8B8A8_UNORM,
+      PIPE_FORMAT_R16G16_SNORM,
+      PIPE_FORMAT_R10G10B10A2_SNORM,
+   };
+   static const struct {
+      const char *name;
+      struct translate *(*create)(const struct translate_key *key);
+   } backends[] = {
+      { "generic", translate_generic_create },
+      { "x86", translate_sse2_create },
+      { "avx2", translate_avx2_create },
+   };
+   const unsigned nr_verts = 1 << 16;
+   const unsigned iterations = 64;
+   unsigned char *input = align_malloc(nr_verts * 16, 64);
+   unsigned char *output = align_malloc(nr_verts * 16, 64);
+   unsigned *elts = align_malloc(nr_verts * sizeof *elts, 64);
+   struct translate_key key;
+   unsigned i, j, k;
+
+   memset(&key, 0, sizeof key);
+   key.nr_elements = 1;
+   key.output_stride = 16;
+   key.element[0].type = TRANSLATE_ELEMENT_NORMAL;
+   key.element[0].output_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+   for (i = 0; i < nr_verts * 16; ++i)
+      input[i] = rand();
+
+   /* mostly sequential, like the vertex cache friendly index buffers */
+   for (i = 0; i < nr_verts; ++i)
+      elts[i] = MIN2(i + (rand() % 16), nr_verts - 1);
+
+   for (i = 0; i < ARRAY_SIZE(formats); ++i) {
+      const struct util_format_description *desc =
+         util_format_description(formats[i]);
+
+      key.element[0].input_format = formats[i];
+
+      for (j = 0; j < ARRAY_SIZE(backends); ++j) {
+         struct translate *translate;
+         int64_t start, elapsed;
+
+         if (backends[j].create == translate_avx2_create && !cpu_has_avx2())
+            continue;
+
+         translate = backends[j].create(&key);
+         if (!translate)
+            continue;
+
+         translate->set_buffer(translate, 0, input,
+                               util_format_get_stride(formats[i], 1),
+                               nr_verts - 1);
+
+         start = os_time_get_nano();
+         for (k = 0; k < iterations; ++k)
+            translate->run_elts(translate, elts, nr_verts, 0, 0, output);
+         elapsed = os_time_get_nano() - start;
+
+         printf("%-24s %-8s %8.1f Mvertices/s\n",
+                desc->short_name, backends[j].name,
+                (double)nr_verts * iterations * 1000.0 / MAX2(elapsed, 1));
+
+         translate->release(translate);
+      }
+   }
+
+   align_free(elts);
+   align_free(output);
+   align_free(input);
+   return 0;
+}
+
 int main(int argc, char** argv)
 {
    struct translate *(*create_fn)(const struct translate_key *key) = 0;
@@ -118,6 +208,17 @@ int main(int argc, char** argv)
       util_cpu_caps.has_sse4_1 = 0;
       create_fn = translate_sse2_create;
    }
+   else if (!strcmp(argv[1], "avx2"))
+   {
+      if(!cpu_has_avx2())
+      {
+         printf("Error: CPU doesn't support AVX2\n");
+         return 2;
+      }
+      create_fn = translate_avx2_create;
+   }
+   else if (!strcmp(argv[1], "bench"))
+      return run_benchmark();
    else if (!strcmp(argv[1], "sse4.1"))
    {
       if(!util_cpu_caps.has_sse4_1 || !rtasm_cpu_has_sse())
@@ -130,7 +231,7 @@ int main(int argc, char** argv)
 
    if (!create_fn)
    {
-      printf("Usage: ./translate_test [default|generic|x86|nosse|sse|sse2|sse3|sse4.1]\n");
+      printf("Usage: ./translate_test [default|generic|x86|nosse|sse|sse2|sse3|sse4.1|avx2|bench]\n");
       return 2;
    }
 
@@ -29,11 +29,16 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <float.h>
+#include <math.h>
+#include <string.h>
 
 #include "util/u_half.h"
 #include "util/u_format.h"
 #include "util/u_format_tests.h"
 #include "util/u_format_s3tc.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_memory.h"
+#include "util/os_time.h"
 
 
 static boolean
@@ -709,6 +714,114 @@ test_format_norm_flags(const struct util_format_description *format_desc)
    return success;
 }
 
+#define ROWS_TEST_WIDTH 37
+#define ROWS_TEST_HEIGHT 3
+
+
+static boolean
+has_plain_rows(const struct util_format_description *format_desc)
+{
+   return format_desc->layout == UTIL_FORMAT_LAYOUT_PLAIN &&
+          format_desc->block.width == 1 &&
+          format_desc->block.height == 1 &&
+          !(format_desc->block.bits & 7);
+}
+
+
+/*
+ * Converting whole rows must give the same results as converting one pixel
+ * at a time, including for the columns left over by the SIMD versions.
+ */
+static boolean
+test_format_unpack_rgba_8unorm_rows(const struct util_format_description *format_desc)
+{
+   const unsigned bpp = format_desc->block.bits / 8;
+   const unsigned src_stride = ROWS_TEST_WIDTH * bpp + 4;
+   uint8_t packed[ROWS_TEST_HEIGHT * (ROWS_TEST_WIDTH * 16 + 4)];
+   uint8_t rows[ROWS_TEST_HEIGHT][ROWS_TEST_WIDTH][4];
+   uint8_t pixels[ROWS_TEST_HEIGHT][ROWS_TEST_WIDTH][4];
+   unsigned i, j;
+
+   if (!format_desc->unpack_rgba_8unorm || !has_plain_rows(format_desc) ||
+       bpp > 16)
+      return TRUE;
+
+   for (i = 0; i < sizeof packed; ++i)
+      packed[i] = (i * 7919 + (i >> 3) * 31) & 0xff;
+
+   format_desc->unpack_rgba_8unorm(&rows[0][0][0], sizeof rows[0],
+                                   packed, src_stride,
+                                   ROWS_TEST_WIDTH, ROWS_TEST_HEIGHT);
+
+   for (i = 0; i < ROWS_TEST_HEIGHT; ++i) {
+      for (j = 0; j < ROWS_TEST_WIDTH; ++j) {
+         format_desc->unpack_rgba_8unorm(pixels[i][j], 0,
+                                         packed + i * src_stride + j * bpp, 0,
+                                         1, 1);
+      }
+   }
+
+   if (memcmp(rows, pixels, sizeof rows)) {
+      printf("FAILED: %s rows differ from pixels\n", format_desc->short_name);
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+static boolean
+test_format_pack_rgba_float_rows(const struct util_format_description *format_desc)
+{
+   static const float special[] = { -1.0f, -0.0f, 0.0f, 0.5f, 1.0f, 2.0f,
+                                    1.0f / 255.0f, 254.5f / 255.0f,
+                                    NAN, -NAN, INFINITY, -INFINITY };
+   const unsigned bpp = format_desc->block.bits / 8;
+   const unsigned dst_stride = ROWS_TEST_WIDTH * bpp + 4;
+   float unpacked[ROWS_TEST_HEIGHT][ROWS_TEST_WIDTH][4];
+   uint8_t rows[ROWS_TEST_HEIGHT * (ROWS_TEST_WIDTH * 16 + 4)];
+   uint8_t pixels[ROWS_TEST_HEIGHT * (ROWS_TEST_WIDTH * 16 + 4)];
+   unsigned i, j, k;
+
+   if (!format_desc->pack_rgba_float || !has_plain_rows(format_desc) ||
+       bpp > 16)
+      return TRUE;
+
+   for (i = 0; i < ROWS_TEST_HEIGHT; ++i) {
+      for (j = 0; j < ROWS_TEST_WIDTH; ++j) {
+         for (k = 0; k < 4; ++k) {
+            unsigned n = (i * ROWS_TEST_WIDTH + j) * 4 + k;
+            if (n % 5 == 0)
+               unpacked[i][j][k] = special[(n / 5) % ARRAY_SIZE(special)];
+            else
+               unpacked[i][j][k] = (float)((n * 7919) % 1201) / 1000.0f - 0.1f;
+         }
+      }
+   }
+
+   memset(rows, 0, sizeof rows);
+   memset(pixels, 0, sizeof pixels);
+
+   format_desc->pack_rgba_float(rows, dst_stride,
+                                &unpacked[0][0][0], sizeof unpacked[0],
+                                ROWS_TEST_WIDTH, ROWS_TEST_HEIGHT);
+
+   for (i = 0; i < ROWS_TEST_HEIGHT; ++i) {
+      for (j = 0; j < ROWS_TEST_WIDTH; ++j) {
+         format_desc->pack_rgba_float(pixels + i * dst_stride + j * bpp, 0,
+                                      unpacked[i][j], 0, 1, 1);
+      }
+   }
+
+   if (memcmp(rows, pixels, sizeof rows)) {
+      printf("FAILED: %s rows differ from pixels\n", format_desc->short_name);
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
 typedef boolean
 (*test_func_t)(const struct util_format_description *format_desc,
                const struct util_format_test_case *test);
@@ -800,6 +913,8 @@ test_all(void)
       TEST_ONE_FUNC(pack_s_8uint);
 
       TEST_FORMAT_METADATA(norm_flags);
+      TEST_FORMAT_METADATA(unpack_rgba_8unorm_rows);
+      TEST_FORMAT_METADATA(pack_rgba_float_rows);
 
 #     undef TEST_ONE_FUNC
 #     undef TEST_ONE_FORMAT
@@ -809,10 +924,81 @@ test_all(void)
 }
 
 
+/*
+ * Row conversion throughput for the formats that matter most for texture
+ * uploads and readbacks.
+ */
+static void
+run_benchmark(void)
+{
+   static const enum pipe_format formats[] = {
+      PIPE_FORMAT_R8G8B8A8_UNORM,
+      PIPE_FORMAT_B8G8R8A8_UNORM,
+      PIPE_FORMAT_B8G8R8X8_UNORM,
+      PIPE_FORMAT_R32G32B32A32_FLOAT,
+      PIPE_FORMAT_R16G16B16A16_FLOAT,
+   };
+   const unsigned width = 1024, height = 256, iterations = 16;
+   const unsigned float_stride = width * 4 * sizeof(float);
+   uint8_t *packed = align_malloc(width * height * 16, 64);
+   uint8_t *unorm = align_malloc(width * height * 4, 64);
+   float *unpacked = align_malloc(height * float_stride, 64);
+   unsigned i, j;
+
+   for (i = 0; i < width * height * 16; ++i)
+      packed[i] = i * 7919;
+   for (i = 0; i < width * height * 4; ++i)
+      unpacked[i] = (float)(i % 1201) / 1000.0f;
+
+   for (i = 0; i < ARRAY_SIZE(formats); ++i) {
+      const struct util_format_description *format_desc =
+         util_format_description(formats[i]);
+      const unsigned stride = width * format_desc->block.bits / 8;
+      int64_t start, unpack_time, pack_time;
+
+      start = os_time_get_nano();
+      for (j = 0; j < iterations; ++j)
+         format_desc->unpack_rgba_8unorm(unorm, width * 4, packed, stride,
+                                         width, height);
+      unpack_time = os_time_get_nano() - start;
+
+      start = os_time_get_nano();
+      for (j = 0; j < iterations; ++j)
+         format_desc->pack_rgba_float(packed, stride, unpacked, float_stride,
+                                      width, height);
+      pack_time = os_time_get_nano() - start;
+
+      printf("%-20s unpack_rgba_8unorm %8.1f Mpixels/s  "
+             "pack_rgba_float %8.1f Mpixels/s\n",
+             format_desc->short_name,
+             (double)width * height * iterations * 1000.0 / MAX2(unpack_time, 1),
+             (double)width * height * iterations * 1000.0 / MAX2(pack_time, 1));
+   }
+
+   align_free(unpacked);
+   align_free(unorm);
+   align_free(packed);
+}
+
+
 int main(int argc, char **argv)
 {
    boolean success;
 
+   /* "bench [generic|sse4.1|avx2]" measures the row conversion functions,
+    * optionally restricting the SIMD versions that get picked.
+    */
+   if (argc > 1 && !strcmp(argv[1], "bench")) {
+      util_cpu_detect();
+      if (argc > 2 && strcmp(argv[2], "avx2")) {
+         util_cpu_caps.has_avx2 = 0;
+         if (strcmp(argv[2], "sse4.1"))
+            util_cpu_caps.has_sse4_1 = 0;
+      }
+      run_benchmark();
+      return 0;
+   }
+
    success = test_all();
 
    return success ? 0 : 1;
@@ -62,7 +62,8 @@
    .lower_unpack_snorm_4x8 = true,                                            \
    .lower_unpack_unorm_2x16 = true,                                           \
    .lower_unpack_unorm_4x8 = true,                                            \
-   .max_unroll_iterations = 32
+   .max_unroll_iterations = 32,                                               \
+   .max_partial_unroll_factor = 4
 
 static const struct nir_shader_compiler_options scalar_nir_options = {
    COMMON_OPTIONS,
@@ -85,6 +86,8 @@ static const struct nir_shader_compiler_options vector_nir_options = {
    .lower_extract_byte = true,
    .lower_extract_word = true,
    .max_unroll_iterations = 32,
+   /* Loops are only partially unrolled for the scalar backend. */
+   .max_partial_unroll_factor = 0,
 };
 
 struct brw_compiler *
@@ -258,7 +258,7 @@ fs_live_variables::compute_start_end()
 fs_live_variables::fs_live_variables(fs_visitor *v, const cfg_t *cfg)
    : v(v), cfg(cfg)
 {
-   mem_ctx = ralloc_context(NULL);
+   mem_ctx = ralloc_arena_context(NULL);
 
    num_vgrfs = v->alloc.count;
    num_vars = 0;
@@ -3580,7 +3580,7 @@ fs_visitor::nir_emit_fs_intrinsic(const fs_builder &bld,
          const fs_reg sample_src = retype(get_nir_src(instr->src[0]),
                                           BRW_REGISTER_TYPE_UD);
 
-         if (nir_src_is_dynamically_uniform(instr->src[0])) {
+         if (nir_src_is_known_uniform(instr->src[0])) {
             const fs_reg sample_id = bld.emit_uniformize(sample_src);
             const fs_reg msg_data = vgrf(glsl_type::uint_type);
             bld.exec_all().group(1, 0)
@@ -4751,6 +4751,13 @@ fs_visitor::nir_emit_intrinsic(const fs_builder &bld, nir_intrinsic_instr *instr
       unreachable("not reached");
 
    case nir_intrinsic_vote_any: {
+      /* All the live channels already agree */
+      if (nir_src_is_known_uniform(instr->src[0])) {
+         bld.MOV(retype(dest, BRW_REGISTER_TYPE_D),
+                 retype(get_nir_src(instr->src[0]), BRW_REGISTER_TYPE_D));
+         break;
+      }
+
       const fs_builder ubld = bld.exec_all().group(1, 0);
 
       /* The any/all predicates do not consider channel enables. To prevent
@@ -4783,6 +4790,12 @@ fs_visitor::nir_emit_intrinsic(const fs_builder &bld, nir_intrinsic_instr *instr
       break;
    }
    case nir_intrinsic_vote_all: {
+      if (nir_src_is_known_uniform(instr->src[0])) {
+         bld.MOV(retype(dest, BRW_REGISTER_TYPE_D),
+                 retype(get_nir_src(instr->src[0]), BRW_REGISTER_TYPE_D));
+         break;
+      }
+
       const fs_builder ubld = bld.exec_all().group(1, 0);
 
       /* The any/all predicates do not consider channel enables. To prevent
@@ -4816,6 +4829,13 @@ fs_visitor::nir_emit_intrinsic(const fs_builder &bld, nir_intrinsic_instr *instr
    }
    case nir_intrinsic_vote_feq:
    case nir_intrinsic_vote_ieq: {
+      /* A NaN isn't equal to itself, so only integers can skip the compare */
+      if (instr->intrinsic == nir_intrinsic_vote_ieq &&
+          nir_src_is_known_uniform(instr->src[0])) {
+         bld.MOV(retype(dest, BRW_REGISTER_TYPE_D), brw_imm_d(-1));
+         break;
+      }
+
       fs_reg value = get_nir_src(instr->src[0]);
       if (instr->intrinsic == nir_intrinsic_vote_feq) {
          const unsigned bit_size = nir_src_bit_size(instr->src[0]);
@@ -4883,6 +4903,12 @@ fs_visitor::nir_emit_intrinsic(const fs_builder &bld, nir_intrinsic_instr *instr
 
    case nir_intrinsic_read_invocation: {
       const fs_reg value = get_nir_src(instr->src[0]);
+
+      if (nir_src_is_known_uniform(instr->src[0])) {
+         bld.MOV(retype(dest, value.type), value);
+         break;
+      }
+
       const fs_reg invocation = get_nir_src(instr->src[1]);
       fs_reg tmp = bld.vgrf(value.type);
 
@@ -4895,7 +4921,10 @@ fs_visitor::nir_emit_intrinsic(const fs_builder &bld, nir_intrinsic_instr *instr
 
    case nir_intrinsic_read_first_invocation: {
       const fs_reg value = get_nir_src(instr->src[0]);
-      bld.MOV(retype(dest, value.type), bld.emit_uniformize(value));
+      if (nir_src_is_known_uniform(instr->src[0]))
+         bld.MOV(retype(dest, value.type), value);
+      else
+         bld.MOV(retype(dest, value.type), bld.emit_uniformize(value));
       break;
    }
 
@@ -514,6 +514,17 @@ brw_nir_lower_fs_outputs(nir_shader *nir)
    this_progress;                                          \
 })
 
+/* OPT for the passes of the optimization loop, skipped when nothing changed
+ * since they last ran without progress.
+ */
+#define LOOP_OPT(pass, ...) ({                                  \
+   bool this_progress = false;                                  \
+   NIR_LOOP_PASS(this_progress, &pm, nir, pass, ##__VA_ARGS__); \
+   if (this_progress)                                           \
+      progress = true;                                          \
+   this_progress;                                               \
+})
+
 static nir_variable_mode
 brw_nir_no_indirect_mask(const struct brw_compiler *compiler,
                          gl_shader_stage stage)
@@ -543,37 +554,40 @@ brw_nir_optimize(nir_shader *nir, const struct brw_compiler *compiler,
       (nir->options->lower_flrp32 ? 32 : 0) |
       (nir->options->lower_flrp64 ? 64 : 0);
 
+   nir_pass_manager pm;
+   nir_pass_manager_init(&pm);
+
    do {
       progress = false;
-      OPT(nir_split_array_vars, nir_var_function_temp);
-      OPT(nir_shrink_vec_array_vars, nir_var_function_temp);
-      OPT(nir_opt_deref);
-      OPT(nir_lower_vars_to_ssa);
+      LOOP_OPT(nir_split_array_vars, nir_var_function_temp);
+      LOOP_OPT(nir_shrink_vec_array_vars, nir_var_function_temp);
+      LOOP_OPT(nir_opt_deref);
+      LOOP_OPT(nir_lower_vars_to_ssa);
       if (allow_copies) {
          /* Only run this pass in the first call to brw_nir_optimize.  Later
           * calls assume that we've lowered away any copy_deref instructions
           * and we don't want to introduce any more.
           */
-         OPT(nir_opt_find_array_copies);
+         LOOP_OPT(nir_opt_find_array_copies);
       }
-      OPT(nir_opt_copy_prop_vars);
-      OPT(nir_opt_dead_write_vars);
-      OPT(nir_opt_combine_stores, nir_var_all);
+      LOOP_OPT(nir_opt_copy_prop_vars);
+      LOOP_OPT(nir_opt_dead_write_vars);
+      LOOP_OPT(nir_opt_combine_stores, nir_var_all);
 
       if (is_scalar) {
-         OPT(nir_lower_alu_to_scalar, NULL);
+         LOOP_OPT(nir_lower_alu_to_scalar, NULL);
       }
 
-      OPT(nir_copy_prop);
+      LOOP_OPT(nir_copy_prop);
 
       if (is_scalar) {
-         OPT(nir_lower_phis_to_scalar);
+         LOOP_OPT(nir_lower_phis_to_scalar);
       }
 
-      OPT(nir_copy_prop);
-      OPT(nir_opt_dce);
-      OPT(nir_opt_cse);
-      OPT(nir_opt_combine_stores, nir_var_all);
+      LOOP_OPT(nir_copy_prop);
+      LOOP_OPT(nir_opt_dce);
+      LOOP_OPT(nir_opt_cse);
+      LOOP_OPT(nir_opt_combine_stores, nir_var_all);
 
       /* Passing 0 to the peephole select pass causes it to convert
        * if-statements that contain only move instructions in the branches
@@ -595,24 +609,24 @@ brw_nir_optimize(nir_shader *nir, const struct brw_compiler *compiler,
       const bool is_vec4_tessellation = !is_scalar &&
          (nir->info.stage == MESA_SHADER_TESS_CTRL ||
           nir->info.stage == MESA_SHADER_TESS_EVAL);
-      OPT(nir_opt_peephole_select, 0, !is_vec4_tessellation, false);
-      OPT(nir_opt_peephole_select, 1, !is_vec4_tessellation,
-          compiler->devinfo->gen >= 6);
+      LOOP_OPT(nir_opt_peephole_select, 0, !is_vec4_tessellation, false);
+      LOOP_OPT(nir_opt_peephole_select, 1, !is_vec4_tessellation,
+               compiler->devinfo->gen >= 6);
 
-      OPT(nir_opt_intrinsics);
-      OPT(nir_opt_idiv_const, 32);
-      OPT(nir_opt_algebraic);
-      OPT(nir_opt_constant_folding);
+      LOOP_OPT(nir_opt_intrinsics);
+      LOOP_OPT(nir_opt_idiv_const, 32);
+      LOOP_OPT(nir_opt_algebraic);
+      LOOP_OPT(nir_opt_constant_folding);
 
       if (lower_flrp != 0) {
          /* To match the old behavior, set always_precise only for scalar
           * shader stages.
           */
-         if (OPT(nir_lower_flrp,
-                 lower_flrp,
-                 false /* always_precise */,
-                 compiler->devinfo->gen >= 6)) {
-            OPT(nir_opt_constant_folding);
+         if (LOOP_OPT(nir_lower_flrp,
+                      lower_flrp,
+                      false /* always_precise */,
+                      compiler->devinfo->gen >= 6)) {
+            LOOP_OPT(nir_opt_constant_folding);
          }
 
          /* Nothing should rematerialize any flrps, so we only need to do this
@@ -621,24 +635,30 @@ brw_nir_optimize(nir_shader *nir, const struct brw_compiler *compiler,
          lower_flrp = 0;
       }
 
-      OPT(nir_opt_dead_cf);
-      if (OPT(nir_opt_trivial_continues)) {
+      LOOP_OPT(nir_opt_dead_cf);
+      if (LOOP_OPT(nir_opt_trivial_continues)) {
          /* If nir_opt_trivial_continues makes progress, then we need to clean
           * things up if we want any hope of nir_opt_if or nir_opt_loop_unroll
           * to make progress.
           */
-         OPT(nir_copy_prop);
-         OPT(nir_opt_dce);
+         LOOP_OPT(nir_copy_prop);
+         LOOP_OPT(nir_opt_dce);
       }
-      OPT(nir_opt_if, false);
+      LOOP_OPT(nir_opt_if, false);
+      /* Before unrolling, so that the unrolled copies of the loop body step
+       * the reduced induction variables instead of recomputing them.
+       */
+      LOOP_OPT(nir_opt_loop_strength_reduce, indirect_mask);
       if (nir->options->max_unroll_iterations != 0) {
-         OPT(nir_opt_loop_unroll, indirect_mask);
+         LOOP_OPT(nir_opt_loop_unroll, indirect_mask);
       }
-      OPT(nir_opt_remove_phis);
-      OPT(nir_opt_undef);
-      OPT(nir_lower_pack);
+      LOOP_OPT(nir_opt_remove_phis);
+      LOOP_OPT(nir_opt_undef);
+      LOOP_OPT(nir_lower_pack);
    } while (progress);
 
+   nir_pass_manager_finish(&pm);
+
    /* Workaround Gfxbench unused local sampler variable which will trigger an
     * assert in the opt_large_constants pass.
     */
@@ -860,6 +880,36 @@ brw_nir_link_shaders(const struct brw_compiler *compiler,
    }
 }
 
+static bool
+brw_nir_should_vectorize_mem(unsigned align, unsigned bit_size,
+                             unsigned num_components, unsigned high_offset,
+                             nir_intrinsic_instr *low,
+                             nir_intrinsic_instr *high)
+{
+   /* 64-bit accesses are split back into 32-bit ones anyway, and UBO loads
+    * aren't split in NIR so don't make a mess for the back-end.
+    */
+   if (bit_size > 32)
+      return false;
+
+   /* Anything larger than a vec4 would be split again by
+    * brw_nir_lower_mem_access_bit_sizes.
+    */
+   if (num_components > 4)
+      return false;
+
+   /* Smaller types are only worth combining into whole, aligned dwords,
+    * which brw_nir_lower_mem_access_bit_sizes turns into 32-bit accesses.
+    */
+   if (bit_size < 32) {
+      if (low->intrinsic == nir_intrinsic_load_ubo || align < 4 ||
+          (num_components * bit_size) % 32 != 0)
+         return false;
+   }
+
+   return align >= bit_size / 8;
+}
+
 /* Prepare the given shader for codegen
  *
  * This function is intended to be called right before going into the actual
@@ -877,6 +927,13 @@ brw_postprocess_nir(nir_shader *nir, const struct brw_compiler *compiler,
 
    UNUSED bool progress; /* Written by OPT */
 
+   if (is_scalar) {
+      OPT(nir_opt_load_store_vectorize,
+          nir_var_mem_ubo | nir_var_mem_ssbo |
+          nir_var_mem_shared | nir_var_mem_global,
+          brw_nir_should_vectorize_mem);
+   }
+
    OPT(brw_nir_lower_mem_access_bit_sizes);
    OPT(nir_lower_int64, nir->options->lower_int64_options);
 
@@ -974,6 +1031,10 @@ brw_postprocess_nir(nir_shader *nir, const struct brw_compiler *compiler,
    if (devinfo->gen <= 5)
       brw_nir_analyze_boolean_resolves(nir);
 
+   /* Lets the scalar backend skip uniformizing values that already are. */
+   if (is_scalar)
+      nir_divergence_analysis(nir);
+
    nir_sweep(nir);
 
    if (unlikely(debug_enabled)) {
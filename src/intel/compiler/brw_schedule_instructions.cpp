@@ -531,7 +531,7 @@ public:
                          instruction_scheduler_mode mode)
    {
       this->bs = s;
-      this->mem_ctx = ralloc_context(NULL);
+      this->mem_ctx = ralloc_arena_context(NULL);
       this->grf_count = grf_count;
       this->hw_reg_count = hw_reg_count;
       this->instructions.make_empty();
@@ -184,7 +184,7 @@ vec4_live_variables::vec4_live_variables(const simple_allocator &alloc,
                                          cfg_t *cfg)
    : alloc(alloc), cfg(cfg)
 {
-   mem_ctx = ralloc_context(NULL);
+   mem_ctx = ralloc_arena_context(NULL);
 
    num_vars = alloc.total_size * 8;
    block_data = rzalloc_array(mem_ctx, struct block_data, cfg->num_blocks);
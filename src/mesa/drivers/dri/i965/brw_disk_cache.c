@@ -83,32 +83,28 @@ read_blob_program_data(struct blob_reader *binary, struct gl_program *prog,
       (binary->current == binary->end);
 }
 
-static bool
-read_and_upload(struct brw_context *brw, struct disk_cache *cache,
-                struct gl_program *prog, gl_shader_stage stage)
+static void
+populate_key(struct brw_context *brw, gl_shader_stage stage,
+             union brw_any_prog_key *prog_key)
 {
-   unsigned char binary_sha1[20];
-
-   union brw_any_prog_key prog_key;
-
    switch (stage) {
    case MESA_SHADER_VERTEX:
-      brw_vs_populate_key(brw, &prog_key.vs);
+      brw_vs_populate_key(brw, &prog_key->vs);
       break;
    case MESA_SHADER_TESS_CTRL:
-      brw_tcs_populate_key(brw, &prog_key.tcs);
+      brw_tcs_populate_key(brw, &prog_key->tcs);
       break;
    case MESA_SHADER_TESS_EVAL:
-      brw_tes_populate_key(brw, &prog_key.tes);
+      brw_tes_populate_key(brw, &prog_key->tes);
       break;
    case MESA_SHADER_GEOMETRY:
-      brw_gs_populate_key(brw, &prog_key.gs);
+      brw_gs_populate_key(brw, &prog_key->gs);
       break;
    case MESA_SHADER_FRAGMENT:
-      brw_wm_populate_key(brw, &prog_key.wm);
+      brw_wm_populate_key(brw, &prog_key->wm);
       break;
    case MESA_SHADER_COMPUTE:
-      brw_cs_populate_key(brw, &prog_key.cs);
+      brw_cs_populate_key(brw, &prog_key->cs);
       break;
    default:
       unreachable("Unsupported stage!");
@@ -116,9 +112,19 @@ read_and_upload(struct brw_context *brw, struct disk_cache *cache,
 
    /* We don't care what instance of the program it is for the disk cache hash
     * lookup, so set the id to 0 for the sha1 hashing. program_string_id will
-    * be set below.
+    * be set by the caller.
     */
-   brw_prog_key_set_id(&prog_key, stage, 0);
+   brw_prog_key_set_id(prog_key, stage, 0);
+}
+
+static bool
+read_and_upload(struct brw_context *brw, struct disk_cache *cache,
+                struct gl_program *prog, gl_shader_stage stage)
+{
+   unsigned char binary_sha1[20];
+
+   union brw_any_prog_key prog_key;
+   populate_key(brw, stage, &prog_key);
 
    gen_shader_sha1(prog, stage, &prog_key, binary_sha1);
 
@@ -259,6 +265,43 @@ fail:
    return false;
 }
 
+/**
+ * Start reading the binaries of the render stages that haven't been
+ * uploaded from or written to the disk cache yet, so that the
+ * brw_disk_cache_upload_program() calls for the later stages don't each
+ * wait on the disk in turn.
+ *
+ * The keys are computed from the current state, before the earlier stages
+ * are uploaded.  A key that changes with them (like the fragment shader's
+ * input slots on the VUE map) just misses.
+ */
+void
+brw_disk_cache_prefetch_render_programs(struct brw_context *brw)
+{
+   struct disk_cache *cache = brw->ctx.Cache;
+   if (cache == NULL || (brw->ctx._Shader->Flags & GLSL_CACHE_FALLBACK))
+      return;
+
+   cache_key keys[MESA_SHADER_FRAGMENT + 1];
+   unsigned num_keys = 0;
+
+   for (gl_shader_stage stage = MESA_SHADER_VERTEX;
+        stage <= MESA_SHADER_FRAGMENT; stage++) {
+      struct gl_program *prog = brw->ctx._Shader->CurrentProgram[stage];
+      if (prog == NULL || prog != brw->programs[stage] ||
+          prog->program_written_to_cache)
+         continue;
+
+      union brw_any_prog_key prog_key;
+      populate_key(brw, stage, &prog_key);
+      gen_shader_sha1(prog, stage, &prog_key, keys[num_keys++]);
+   }
+
+   /* A single stage is read just as fast by its own lookup. */
+   if (num_keys > 1)
+      disk_cache_prefetch(cache, keys, num_keys);
+}
+
 static void
 write_program_data(struct brw_context *brw, struct gl_program *prog,
                    void *key, struct brw_stage_prog_data *prog_data,
@@ -36,6 +36,7 @@
 #include "main/shaderapi.h"
 #include "main/shaderobj.h"
 #include "main/uniforms.h"
+#include "util/disk_cache.h"
 
 /**
  * Performs a compile of the shader stages even when we don't know
@@ -229,8 +230,26 @@ brw_link_shader(struct gl_context *ctx, struct gl_shader_program *shProg)
    unsigned int stage;
    struct shader_info *infos[MESA_SHADER_STAGES] = { 0, };
 
-   if (shProg->data->LinkStatus == LINKING_SKIPPED)
+   if (shProg->data->LinkStatus == LINKING_SKIPPED) {
+      for (stage = 0; stage < ARRAY_SIZE(shProg->_LinkedShaders); stage++) {
+         struct gl_linked_shader *shader = shProg->_LinkedShaders[stage];
+         if (!shader ||
+             brw_program_driver_blob_nir_is_readable(shader->Program))
+            continue;
+
+         /* Discard the item from the cache and fail with LinkStatus still
+          * LINKING_SKIPPED, so that the program is linked again from source.
+          */
+         if (ctx->_Shader->Flags & GLSL_CACHE_INFO) {
+            fprintf(stderr, "Error reading program from cache (incompatible "
+                    "NIR cache item)\n");
+         }
+         disk_cache_remove(ctx->Cache, shProg->data->sha1);
+         return GL_FALSE;
+      }
+
       return GL_TRUE;
+   }
 
    for (stage = 0; stage < ARRAY_SIZE(shProg->_LinkedShaders); stage++) {
       struct gl_linked_shader *shader = shProg->_LinkedShaders[stage];
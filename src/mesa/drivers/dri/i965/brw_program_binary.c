@@ -111,6 +111,34 @@ blob_has_part(void *blob, uint32_t size, enum driver_cache_blob_part part)
    } while (true);
 }
 
+/**
+ * Whether the NIR in the driver blob of a program loaded from the disk cache
+ * can be deserialized.  It's only deserialized when a stage's binary isn't in
+ * the cache, at draw time, which is too late to fall back to the source.
+ */
+bool
+brw_program_driver_blob_nir_is_readable(struct gl_program *prog)
+{
+   if (!prog->driver_cache_blob)
+      return true;
+
+   struct blob_reader reader;
+   blob_reader_init(&reader, prog->driver_cache_blob,
+                    prog->driver_cache_blob_size);
+
+   assert(blob_parts_valid(prog->driver_cache_blob,
+                           prog->driver_cache_blob_size));
+   do {
+      uint32_t part_type = blob_read_uint32(&reader);
+      if (part_type == END_PART)
+         return true;
+      uint32_t part_size = blob_read_uint32(&reader);
+      if (part_type == NIR_PART)
+         return nir_serialize_version_matches(&reader);
+      blob_skip_bytes(&reader, part_size);
+   } while (true);
+}
+
 static bool
 driver_blob_is_ready(void *blob, uint32_t size, bool with_gen_program)
 {
@@ -188,13 +216,15 @@ deserialize_gen_program(struct blob_reader *reader, struct gl_context *ctx,
    return true;
 }
 
-void
+bool
 brw_program_deserialize_driver_blob(struct gl_context *ctx,
                                     struct gl_program *prog,
                                     gl_shader_stage stage)
 {
    if (!prog->driver_cache_blob)
-      return;
+      return true;
+
+   bool nir_read = true;
 
    struct blob_reader reader;
    blob_reader_init(&reader, prog->driver_cache_blob,
@@ -219,6 +249,7 @@ brw_program_deserialize_driver_blob(struct gl_context *ctx,
          const struct nir_shader_compiler_options *options =
             ctx->Const.ShaderCompilerOptions[stage].NirOptions;
          prog->nir = nir_deserialize(NULL, options, &reader);
+         nir_read = prog->nir != NULL;
          break;
       }
       default:
@@ -230,17 +261,19 @@ brw_program_deserialize_driver_blob(struct gl_context *ctx,
    ralloc_free(prog->driver_cache_blob);
    prog->driver_cache_blob = NULL;
    prog->driver_cache_blob_size = 0;
+
+   return nir_read;
 }
 
 /* This is just a wrapper around brw_program_deserialize_nir() as i965
  * doesn't need gl_shader_program like other drivers do.
  */
-void
+bool
 brw_deserialize_program_binary(struct gl_context *ctx,
                                struct gl_shader_program *shProg,
                                struct gl_program *prog)
 {
-   brw_program_deserialize_driver_blob(ctx, prog, prog->info.stage);
+   return brw_program_deserialize_driver_blob(ctx, prog, prog->info.stage);
 }
 
 static void
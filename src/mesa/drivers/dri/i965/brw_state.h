@@ -155,6 +155,7 @@ void gen8_write_pma_stall_bits(struct brw_context *brw,
 void brw_disk_cache_init(struct intel_screen *screen);
 bool brw_disk_cache_upload_program(struct brw_context *brw,
                                    gl_shader_stage stage);
+void brw_disk_cache_prefetch_render_programs(struct brw_context *brw);
 void brw_disk_cache_write_compute_program(struct brw_context *brw);
 void brw_disk_cache_write_render_programs(struct brw_context *brw);
 
@@ -470,6 +470,8 @@ brw_upload_programs(struct brw_context *brw,
    const struct gen_device_info *devinfo = &brw->screen->devinfo;
 
    if (pipeline == BRW_RENDER_PIPELINE) {
+      brw_disk_cache_prefetch_render_programs(brw);
+
       brw_upload_vs_prog(brw);
       brw_upload_tess_programs(brw);
 
@@ -1221,7 +1221,7 @@ struct dd_function_table {
                                             struct gl_shader_program *shProg,
                                             struct gl_program *prog);
 
-   void (*ProgramBinaryDeserializeDriverBlob)(struct gl_context *ctx,
+   bool (*ProgramBinaryDeserializeDriverBlob)(struct gl_context *ctx,
                                               struct gl_shader_program *shProg,
                                               struct gl_program *prog);
    /*@}*/
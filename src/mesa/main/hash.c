@@ -37,7 +37,47 @@
 #include "errors.h"
 #include "glheader.h"
 #include "hash.h"
-#include "util/hash_table.h"
+#include "util/bitscan.h"
+#include "util/u_atomic.h"
+
+
+/**
+ * Array of the values of names 0 to size - 1.
+ *
+ * Writers hold the table mutex, and the slots and the Dense pointer are
+ * only accessed atomically, so readers don't need it.  Growing the array
+ * copies it and publishes the copy; the old array is only freed with the
+ * table, as readers may still be looking at it.  Since the size at least
+ * doubles every time, the old arrays add up to less than the current one.
+ */
+struct _mesa_HashDense {
+   GLuint size;
+   struct _mesa_HashDense *prev;
+   void *slots[];
+};
+
+/* Arrays this small are always used for the names they cover. */
+#define DENSE_MIN_SIZE 64
+#define DENSE_ALWAYS_SIZE 1024
+
+/* Larger ones only when they would be at least a quarter full, up to this
+ * size.
+ */
+#define DENSE_MAX_SIZE (64 * 1024)
+
+
+static struct _mesa_HashDense *
+dense_create(GLuint size, struct _mesa_HashDense *prev)
+{
+   struct _mesa_HashDense *dense =
+      calloc(1, sizeof(*dense) + size * sizeof(dense->slots[0]));
+
+   if (dense) {
+      dense->size = size;
+      dense->prev = prev;
+   }
+   return dense;
+}
 
 
 /**
@@ -51,15 +91,14 @@ _mesa_NewHashTable(void)
    struct _mesa_HashTable *table = CALLOC_STRUCT(_mesa_HashTable);
 
    if (table) {
-      table->ht = _mesa_hash_table_create(NULL, uint_key_hash,
-                                          uint_key_compare);
-      if (table->ht == NULL) {
+      table->Dense = dense_create(DENSE_MIN_SIZE, NULL);
+      if (!table->Dense || !_mesa_int_map_init(&table->map, NULL)) {
+         free(table->Dense);
          free(table);
          _mesa_error_no_memory(__func__);
          return NULL;
       }
 
-      _mesa_hash_table_set_deleted_key(table->ht, uint_key(DELETED_KEY_VALUE));
       /*
        * Needs to be recursive, since the callback in _mesa_HashWalk()
        * is allowed to call _mesa_HashRemove().
@@ -88,11 +127,16 @@ _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 {
    assert(table);
 
-   if (_mesa_hash_table_next_entry(table->ht, NULL) != NULL) {
+   if (_mesa_HashNumEntries(table) != 0) {
       _mesa_problem(NULL, "In _mesa_DeleteHashTable, found non-freed data");
    }
 
-   _mesa_hash_table_destroy(table->ht, NULL);
+   while (table->Dense) {
+      struct _mesa_HashDense *prev = table->Dense->prev;
+      free(table->Dense);
+      table->Dense = prev;
+   }
+   _mesa_int_map_fini(&table->map);
 
    mtx_destroy(&table->Mutex);
    free(table);
@@ -107,17 +151,16 @@ _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 static inline void *
 _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 {
-   const struct hash_entry *entry;
+   const struct _mesa_HashDense *dense = p_atomic_read(&table->Dense);
+   const struct int_map_entry *entry;
 
    assert(table);
    assert(key);
 
-   if (key == DELETED_KEY_VALUE)
-      return table->deleted_key_data;
+   if (key < dense->size)
+      return p_atomic_read(&dense->slots[key]);
 
-   entry = _mesa_hash_table_search_pre_hashed(table->ht,
-                                              uint_hash(key),
-                                              uint_key(key));
+   entry = _mesa_int_map_search(&table->map, key);
    if (!entry)
       return NULL;
 
@@ -136,7 +179,18 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 void *
 _mesa_HashLookup(struct _mesa_HashTable *table, GLuint key)
 {
+   const struct _mesa_HashDense *dense = p_atomic_read(&table->Dense);
    void *res;
+
+   /* Names below the size of the array are only ever stored there, so this
+    * is the same as a lookup under the mutex that would have happened
+    * before or after the writes racing with it.
+    */
+   if (key < dense->size) {
+      assert(key);
+      return p_atomic_read(&dense->slots[key]);
+   }
+
    _mesa_HashLockMutex(table);
    res = _mesa_HashLookup_unlocked(table, key);
    _mesa_HashUnlockMutex(table);
@@ -162,11 +216,45 @@ _mesa_HashLookupLocked(struct _mesa_HashTable *table, GLuint key)
 }
 
 
+/**
+ * Grow the dense array so that it covers \key, if that's worth it, moving
+ * the names it now covers out of the int_map.
+ */
+static void
+dense_grow(struct _mesa_HashTable *table, GLuint key)
+{
+   struct _mesa_HashDense *old = table->Dense;
+   struct _mesa_HashDense *dense;
+   GLuint size;
+
+   if (key >= DENSE_MAX_SIZE)
+      return;
+
+   size = 1u << util_last_bit(key);
+   if (size > DENSE_ALWAYS_SIZE &&
+       size > 4 * (_mesa_HashNumEntries(table) + 1))
+      return;
+
+   dense = dense_create(size, old);
+   if (!dense)
+      return;
+
+   memcpy(dense->slots, old->slots, old->size * sizeof(old->slots[0]));
+   int_map_foreach(&table->map, entry) {
+      if (entry->key < size) {
+         dense->slots[entry->key] = entry->data;
+         table->DenseEntries++;
+         _mesa_int_map_remove(&table->map, entry);
+      }
+   }
+
+   p_atomic_set(&table->Dense, dense);
+}
+
 static inline void
 _mesa_HashInsert_unlocked(struct _mesa_HashTable *table, GLuint key, void *data)
 {
-   uint32_t hash = uint_hash(key);
-   struct hash_entry *entry;
+   struct _mesa_HashDense *dense;
 
    assert(table);
    assert(key);
@@ -174,15 +262,19 @@ _mesa_HashInsert_unlocked(struct _mesa_HashTable *table, GLuint key, void *data)
    if (key > table->MaxKey)
       table->MaxKey = key;
 
-   if (key == DELETED_KEY_VALUE) {
-      table->deleted_key_data = data;
-   } else {
-      entry = _mesa_hash_table_search_pre_hashed(table->ht, hash, uint_key(key));
-      if (entry) {
-         entry->data = data;
-      } else {
-         _mesa_hash_table_insert_pre_hashed(table->ht, hash, uint_key(key), data);
-      }
+   if (key >= table->Dense->size)
+      dense_grow(table, key);
+
+   dense = table->Dense;
+   if (key < dense->size) {
+      /* A NULL value is the same as no entry. */
+      if (!dense->slots[key] && data)
+         table->DenseEntries++;
+      else if (dense->slots[key] && !data)
+         table->DenseEntries--;
+      p_atomic_set(&dense->slots[key], data);
+   } else if (!_mesa_int_map_insert(&table->map, key, data)) {
+      _mesa_error_no_memory(__func__);
    }
 }
 
@@ -234,7 +326,7 @@ _mesa_HashInsert(struct _mesa_HashTable *table, GLuint key, void *data)
 static inline void
 _mesa_HashRemove_unlocked(struct _mesa_HashTable *table, GLuint key)
 {
-   struct hash_entry *entry;
+   struct _mesa_HashDense *dense;
 
    assert(table);
    assert(key);
@@ -244,13 +336,14 @@ _mesa_HashRemove_unlocked(struct _mesa_HashTable *table, GLuint key)
     */
    assert(!table->InDeleteAll);
 
-   if (key == DELETED_KEY_VALUE) {
-      table->deleted_key_data = NULL;
+   dense = table->Dense;
+   if (key < dense->size) {
+      if (dense->slots[key]) {
+         table->DenseEntries--;
+         p_atomic_set(&dense->slots[key], NULL);
+      }
    } else {
-      entry = _mesa_hash_table_search_pre_hashed(table->ht,
-                                                 uint_hash(key),
-                                                 uint_key(key));
-      _mesa_hash_table_remove(table->ht, entry);
+      _mesa_int_map_remove_key(&table->map, key);
    }
 }
 
@@ -283,16 +376,22 @@ _mesa_HashDeleteAll(struct _mesa_HashTable *table,
                     void (*callback)(GLuint key, void *data, void *userData),
                     void *userData)
 {
+   struct _mesa_HashDense *dense;
+
    assert(callback);
    _mesa_HashLockMutex(table);
    table->InDeleteAll = GL_TRUE;
-   hash_table_foreach(table->ht, entry) {
-      callback((uintptr_t)entry->key, entry->data, userData);
-      _mesa_hash_table_remove(table->ht, entry);
+   dense = table->Dense;
+   for (GLuint key = 1; key < dense->size; key++) {
+      if (dense->slots[key]) {
+         callback(key, dense->slots[key], userData);
+         p_atomic_set(&dense->slots[key], NULL);
+      }
    }
-   if (table->deleted_key_data) {
-      callback(DELETED_KEY_VALUE, table->deleted_key_data, userData);
-      table->deleted_key_data = NULL;
+   table->DenseEntries = 0;
+   int_map_foreach(&table->map, entry) {
+      callback(entry->key, entry->data, userData);
+      _mesa_int_map_remove(&table->map, entry);
    }
    table->InDeleteAll = GL_FALSE;
    _mesa_HashUnlockMutex(table);
@@ -314,11 +413,17 @@ hash_walk_unlocked(const struct _mesa_HashTable *table,
    assert(table);
    assert(callback);
 
-   hash_table_foreach(table->ht, entry) {
-      callback((uintptr_t)entry->key, entry->data, userData);
+   /* The callback may remove entries, which just clears their slot in the
+    * dense array, and int_map allows while iterating.
+    */
+   const struct _mesa_HashDense *dense = table->Dense;
+   for (GLuint key = 1; key < dense->size; key++) {
+      if (dense->slots[key])
+         callback(key, dense->slots[key], userData);
+   }
+   int_map_foreach((struct int_map *) &table->map, entry) {
+      callback(entry->key, entry->data, userData);
    }
-   if (table->deleted_key_data)
-      callback(DELETED_KEY_VALUE, table->deleted_key_data, userData);
 }
 
 
@@ -357,8 +462,6 @@ debug_print_entry(GLuint key, void *data, void *userData)
 void
 _mesa_HashPrint(const struct _mesa_HashTable *table)
 {
-   if (table->deleted_key_data)
-      debug_print_entry(DELETED_KEY_VALUE, table->deleted_key_data, NULL);
    _mesa_HashWalk(table, debug_print_entry, NULL);
 }
 
@@ -415,12 +518,5 @@ _mesa_HashFindFreeKeyBlock(struct _mesa_HashTable *table, GLuint numKeys)
 GLuint
 _mesa_HashNumEntries(const struct _mesa_HashTable *table)
 {
-   GLuint count = 0;
-
-   if (table->deleted_key_data)
-      count++;
-
-   count += _mesa_hash_table_num_entries(table->ht);
-
-   return count;
+   return table->DenseEntries + _mesa_int_map_num_entries(&table->map);
 }
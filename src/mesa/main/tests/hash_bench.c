@@ -0,0 +1,146 @@
+/*
+ * Copyright © 2012 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Lookups of GL object names from several threads sharing one
+ * _mesa_HashTable, as contexts of a share group do.
+ *
+ * "lock-free" is _mesa_HashLookup(); "mutex" takes the table mutex around
+ * every lookup, as _mesa_HashLookup() used to.  The names are either
+ * handed out by glGen*() (and looked up in the dense array), or sparse
+ * names past it, which always go through the mutex.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "c11/threads.h"
+#include "main/hash.h"
+#include "util/os_time.h"
+
+#define NUM_NAMES 4096
+#define LOOKUPS_PER_THREAD (1 << 22)
+#define MAX_THREADS 8
+
+struct bench {
+   struct _mesa_HashTable *table;
+   const GLuint *names;
+   bool locked;
+   bool ok;
+};
+
+static int
+lookup_thread(void *data)
+{
+   struct bench *bench = data;
+   uint32_t seed = (uintptr_t) &seed;
+   bool ok = true;
+
+   for (unsigned i = 0; i < LOOKUPS_PER_THREAD; i++) {
+      seed = seed * 1103515245 + 12345;
+      unsigned index = (seed >> 8) % NUM_NAMES;
+      GLuint name = bench->names[index];
+      const GLuint *obj;
+
+      if (bench->locked) {
+         _mesa_HashLockMutex(bench->table);
+         obj = _mesa_HashLookupLocked(bench->table, name);
+         _mesa_HashUnlockMutex(bench->table);
+      } else {
+         obj = _mesa_HashLookup(bench->table, name);
+      }
+
+      ok &= obj == &bench->names[index];
+   }
+
+   /* Only ever cleared, so no need for atomics. */
+   if (!ok)
+      bench->ok = false;
+
+   return 0;
+}
+
+static double
+run(struct bench *bench, unsigned num_threads)
+{
+   thrd_t threads[MAX_THREADS];
+   int64_t start = os_time_get_nano();
+
+   for (unsigned i = 0; i < num_threads; i++)
+      thrd_create(&threads[i], lookup_thread, bench);
+   for (unsigned i = 0; i < num_threads; i++)
+      thrd_join(threads[i], NULL);
+
+   int64_t time = os_time_get_nano() - start;
+
+   /* Millions of lookups per second, all threads together. */
+   return (double) num_threads * LOOKUPS_PER_THREAD / (time / 1e3);
+}
+
+static void
+remove_name(GLuint key, void *data, void *userData)
+{
+}
+
+int
+main(int argc, char **argv)
+{
+   static GLuint names[NUM_NAMES];
+   static const char *const layouts[] = { "genned", "sparse" };
+   struct bench bench = { .names = names, .ok = true };
+
+   printf("Mlookups/s, all threads together\n\n");
+   printf("%-8s %-10s %8s %8s %8s %8s\n", "names", "path",
+          "1", "2", "4", "8");
+
+   for (unsigned l = 0; l < 2; l++) {
+      bench.table = _mesa_NewHashTable();
+      if (!bench.table)
+         return 1;
+
+      for (unsigned i = 0; i < NUM_NAMES; i++) {
+         if (l == 0)
+            names[i] = _mesa_HashFindFreeKeyBlock(bench.table, 1);
+         else
+            names[i] = 100000 + i * 7919;
+         _mesa_HashInsert(bench.table, names[i], &names[i]);
+      }
+
+      for (unsigned locked = 0; locked < 2; locked++) {
+         bench.locked = locked;
+         printf("%-8s %-10s", layouts[l], locked ? "mutex" : "lock-free");
+         for (unsigned threads = 1; threads <= MAX_THREADS; threads *= 2)
+            printf(" %8.1f", run(&bench, threads));
+         printf("\n");
+      }
+
+      _mesa_HashDeleteAll(bench.table, remove_name, NULL);
+      _mesa_DeleteHashTable(bench.table);
+   }
+
+   if (!bench.ok) {
+      fprintf(stderr, "lookups returned the wrong object\n");
+      return 1;
+   }
+
+   return 0;
+}
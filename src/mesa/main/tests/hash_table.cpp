@@ -0,0 +1,161 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "main/hash.h"
+
+namespace {
+
+class HashTableTest : public ::testing::Test {
+protected:
+   void SetUp()
+   {
+      table = _mesa_NewHashTable();
+      ASSERT_NE(table, (void *) NULL);
+   }
+
+   void TearDown()
+   {
+      _mesa_HashDeleteAll(table, ignore, NULL);
+      _mesa_DeleteHashTable(table);
+   }
+
+   static void ignore(GLuint key, void *data, void *userData)
+   {
+   }
+
+   void *value(GLuint key)
+   {
+      return (void *)(uintptr_t)(key * 16 + 8);
+   }
+
+   struct _mesa_HashTable *table;
+};
+
+void
+count_entry(GLuint key, void *data, void *userData)
+{
+   EXPECT_EQ(data, (void *)(uintptr_t)(key * 16 + 8));
+   (*(unsigned *) userData)++;
+}
+
+void
+remove_entry(GLuint key, void *data, void *userData)
+{
+   _mesa_HashRemove((struct _mesa_HashTable *) userData, key);
+}
+
+} /* anonymous namespace */
+
+TEST_F(HashTableTest, GennedNames)
+{
+   for (GLuint i = 0; i < 5000; i++) {
+      GLuint name = _mesa_HashFindFreeKeyBlock(table, 1);
+      EXPECT_EQ(name, i + 1);
+      _mesa_HashInsert(table, name, value(name));
+   }
+
+   for (GLuint name = 1; name <= 5000; name++)
+      EXPECT_EQ(_mesa_HashLookup(table, name), value(name));
+   EXPECT_EQ(_mesa_HashLookup(table, 5001), (void *) NULL);
+   EXPECT_EQ(_mesa_HashNumEntries(table), 5000u);
+
+   for (GLuint name = 1; name <= 5000; name += 2)
+      _mesa_HashRemove(table, name);
+   for (GLuint name = 1; name <= 5000; name++) {
+      EXPECT_EQ(_mesa_HashLookup(table, name),
+                name & 1 ? NULL : value(name));
+   }
+   EXPECT_EQ(_mesa_HashNumEntries(table), 2500u);
+}
+
+TEST_F(HashTableTest, SparseNames)
+{
+   static const GLuint names[] = { 3, 900, 70000, 1u << 31, ~0u - 100, ~0u };
+
+   for (unsigned i = 0; i < ARRAY_SIZE(names); i++)
+      _mesa_HashInsert(table, names[i], value(names[i]));
+
+   for (unsigned i = 0; i < ARRAY_SIZE(names); i++) {
+      EXPECT_EQ(_mesa_HashLookup(table, names[i]), value(names[i]));
+      EXPECT_EQ(_mesa_HashLookup(table, names[i] - 1), (void *) NULL);
+   }
+   EXPECT_EQ(_mesa_HashNumEntries(table), ARRAY_SIZE(names));
+
+   /* Replacing a value doesn't add an entry. */
+   _mesa_HashInsert(table, 70000, value(70000));
+   _mesa_HashInsert(table, 900, value(900));
+   EXPECT_EQ(_mesa_HashNumEntries(table), ARRAY_SIZE(names));
+
+   unsigned count = 0;
+   _mesa_HashWalk(table, count_entry, &count);
+   EXPECT_EQ(count, ARRAY_SIZE(names));
+}
+
+/* A name inserted before the names below it were genned ends up among
+ * them, and must still be found and walked once.
+ */
+TEST_F(HashTableTest, NamesCoveredLater)
+{
+   _mesa_HashInsert(table, 3000, value(3000));
+   for (GLuint name = 1; name <= 4000; name++) {
+      if (name != 3000)
+         _mesa_HashInsert(table, name, value(name));
+   }
+
+   for (GLuint name = 1; name <= 4000; name++)
+      EXPECT_EQ(_mesa_HashLookup(table, name), value(name));
+   EXPECT_EQ(_mesa_HashNumEntries(table), 4000u);
+
+   unsigned count = 0;
+   _mesa_HashWalk(table, count_entry, &count);
+   EXPECT_EQ(count, 4000u);
+}
+
+TEST_F(HashTableTest, RemoveWhileWalking)
+{
+   for (GLuint name = 1; name <= 2000; name++)
+      _mesa_HashInsert(table, name * 37, value(name * 37));
+
+   _mesa_HashWalk(table, remove_entry, table);
+
+   EXPECT_EQ(_mesa_HashNumEntries(table), 0u);
+   for (GLuint name = 1; name <= 2000; name++)
+      EXPECT_EQ(_mesa_HashLookup(table, name * 37), (void *) NULL);
+}
+
+TEST_F(HashTableTest, DeleteAll)
+{
+   for (GLuint name = 1; name <= 2000; name++) {
+      _mesa_HashInsert(table, name, value(name));
+      _mesa_HashInsert(table, name * 1000, value(name * 1000));
+   }
+
+   unsigned count = 0;
+   _mesa_HashDeleteAll(table, count_entry, &count);
+   EXPECT_EQ(count, 4000u - 2);
+   EXPECT_EQ(_mesa_HashNumEntries(table), 0u);
+   EXPECT_EQ(_mesa_HashLookup(table, 1), (void *) NULL);
+   EXPECT_EQ(_mesa_HashLookup(table, 2000000), (void *) NULL);
+}
@@ -3120,7 +3120,9 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 {
    unsigned int i;
    bool spirv = false;
+   bool relinking = false;
 
+relink:
    _mesa_clear_shader_program_data(ctx, prog);
 
    prog->data = _mesa_create_shader_program_data();
@@ -3165,6 +3167,15 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
    }
 
    if (prog->data->LinkStatus && !ctx->Driver.LinkShader(ctx, prog)) {
+      /* The driver couldn't use its part of the program found in the cache
+       * and discarded it.  Treat it as a cache miss: link again, which
+       * compiles the shaders from source.
+       */
+      if (prog->data->LinkStatus == LINKING_SKIPPED && !relinking) {
+         relinking = true;
+         goto relink;
+      }
+
       prog->data->LinkStatus = LINKING_FAILURE;
    }
 
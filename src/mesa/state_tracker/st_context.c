@@ -89,6 +89,7 @@
 
 
 DEBUG_GET_ONCE_BOOL_OPTION(mesa_mvp_dp4, "MESA_MVP_DP4", FALSE)
+DEBUG_GET_ONCE_BOOL_OPTION(mesa_parallel_link, "MESA_PARALLEL_LINK", TRUE)
 
 
 /**
@@ -442,6 +443,9 @@ st_destroy_context_priv(struct st_context *st, bool destroy_pipe)
    st_invalidate_readpix_cache(st);
    util_throttle_deinit(st->pipe->screen, &st->throttle);
 
+   if (st->has_link_queue)
+      util_queue_destroy(&st->link_queue);
+
    cso_destroy_context(st->cso_context);
 
    if (st->pipe && destroy_pipe)
@@ -644,6 +648,16 @@ st_create_context_priv(struct gl_context *ctx, struct pipe_context *pipe,
                       screen->get_param(screen,
                                         PIPE_CAP_MAX_TEXTURE_UPLOAD_MEMORY_BUDGET));
 
+   /* The link queue itself is only created once a program with more than
+    * one stage is linked, see st_link_nir().
+    */
+   st->parallel_link =
+      screen->get_shader_param(screen, PIPE_SHADER_VERTEX,
+                               PIPE_SHADER_CAP_PREFERRED_IR) ==
+      PIPE_SHADER_IR_NIR &&
+      util_cpu_caps.nr_cpus > 1 &&
+      debug_get_option_mesa_parallel_link();
+
    /* GL limits and extensions */
    st_init_limits(pipe->screen, &ctx->Const, &ctx->Extensions);
    st_init_extensions(pipe->screen, &ctx->Const,
@@ -35,6 +35,7 @@
 #include "state_tracker/st_atom.h"
 #include "util/u_helpers.h"
 #include "util/u_inlines.h"
+#include "util/u_queue.h"
 #include "util/list.h"
 #include "vbo/vbo.h"
 #include "util/list.h"
@@ -328,6 +329,14 @@ struct st_context
     */
    struct util_throttle throttle;
 
+   /* Threads converting and optimizing the stages of a GLSL program in
+    * parallel when it is linked to NIR, see st_link_nir().  parallel_link
+    * says whether the queue is still to be created.
+    */
+   struct util_queue link_queue;
+   bool has_link_queue;
+   bool parallel_link;
+
    struct {
       struct st_zombie_sampler_view_node list;
       mtx_t mutex;
@@ -57,6 +57,10 @@ st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
       return GL_TRUE;
    }
 
+   /* The cache item was unusable, let the caller link from source. */
+   if (prog->data->LinkStatus == LINKING_SKIPPED)
+      return GL_FALSE;
+
    assert(prog->data->LinkStatus);
 
    for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
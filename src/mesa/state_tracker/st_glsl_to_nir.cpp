@@ -48,6 +48,8 @@
 #include "compiler/glsl/ir.h"
 #include "compiler/glsl/ir_optimization.h"
 #include "compiler/glsl/string_to_uint_map.h"
+#include "util/simple_mtx.h"
+#include "util/u_cpu_detect.h"
 
 static int
 type_size(const struct glsl_type *type)
@@ -309,44 +311,52 @@ st_nir_opts(nir_shader *nir, bool scalar)
       (nir->options->lower_flrp32 ? 32 : 0) |
       (nir->options->lower_flrp64 ? 64 : 0);
 
+   nir_pass_manager pm;
+   nir_pass_manager_init(&pm);
+
    do {
       progress = false;
 
-      NIR_PASS_V(nir, nir_lower_vars_to_ssa);
+      NIR_LOOP_PASS_V(&pm, nir, nir_lower_vars_to_ssa);
 
       if (scalar) {
-         NIR_PASS_V(nir, nir_lower_alu_to_scalar, NULL);
-         NIR_PASS_V(nir, nir_lower_phis_to_scalar);
+         NIR_LOOP_PASS_V(&pm, nir, nir_lower_alu_to_scalar, NULL);
+         NIR_LOOP_PASS_V(&pm, nir, nir_lower_phis_to_scalar);
       }
 
-      NIR_PASS_V(nir, nir_lower_alu);
-      NIR_PASS_V(nir, nir_lower_pack);
-      NIR_PASS(progress, nir, nir_copy_prop);
-      NIR_PASS(progress, nir, nir_opt_remove_phis);
-      NIR_PASS(progress, nir, nir_opt_dce);
-      if (nir_opt_trivial_continues(nir)) {
+      NIR_LOOP_PASS_V(&pm, nir, nir_lower_alu);
+      NIR_LOOP_PASS_V(&pm, nir, nir_lower_pack);
+      NIR_LOOP_PASS(progress, &pm, nir, nir_copy_prop);
+      NIR_LOOP_PASS(progress, &pm, nir, nir_opt_remove_phis);
+      NIR_LOOP_PASS(progress, &pm, nir, nir_opt_dce);
+
+      bool trivial_continues_progress = false;
+      NIR_LOOP_PASS(trivial_continues_progress, &pm, nir,
+                    nir_opt_trivial_continues);
+      if (trivial_continues_progress) {
          progress = true;
-         NIR_PASS(progress, nir, nir_copy_prop);
-         NIR_PASS(progress, nir, nir_opt_dce);
+         NIR_LOOP_PASS(progress, &pm, nir, nir_copy_prop);
+         NIR_LOOP_PASS(progress, &pm, nir, nir_opt_dce);
       }
-      NIR_PASS(progress, nir, nir_opt_if, false);
-      NIR_PASS(progress, nir, nir_opt_dead_cf);
-      NIR_PASS(progress, nir, nir_opt_cse);
-      NIR_PASS(progress, nir, nir_opt_peephole_select, 8, true, true);
+      NIR_LOOP_PASS(progress, &pm, nir, nir_opt_if, false);
+      NIR_LOOP_PASS(progress, &pm, nir, nir_opt_dead_cf);
+      NIR_LOOP_PASS(progress, &pm, nir, nir_opt_cse);
+      NIR_LOOP_PASS(progress, &pm, nir, nir_opt_peephole_select,
+                    8, true, true);
 
-      NIR_PASS(progress, nir, nir_opt_algebraic);
-      NIR_PASS(progress, nir, nir_opt_constant_folding);
+      NIR_LOOP_PASS(progress, &pm, nir, nir_opt_algebraic);
+      NIR_LOOP_PASS(progress, &pm, nir, nir_opt_constant_folding);
 
       if (lower_flrp != 0) {
          bool lower_flrp_progress = false;
 
-         NIR_PASS(lower_flrp_progress, nir, nir_lower_flrp,
-                  lower_flrp,
-                  false /* always_precise */,
-                  nir->options->lower_ffma);
+         NIR_LOOP_PASS(lower_flrp_progress, &pm, nir, nir_lower_flrp,
+                       lower_flrp,
+                       false /* always_precise */,
+                       nir->options->lower_ffma);
          if (lower_flrp_progress) {
-            NIR_PASS(progress, nir,
-                     nir_opt_constant_folding);
+            NIR_LOOP_PASS(progress, &pm, nir,
+                          nir_opt_constant_folding);
             progress = true;
          }
 
@@ -356,12 +366,15 @@ st_nir_opts(nir_shader *nir, bool scalar)
          lower_flrp = 0;
       }
 
-      NIR_PASS(progress, nir, nir_opt_undef);
-      NIR_PASS(progress, nir, nir_opt_conditional_discard);
+      NIR_LOOP_PASS(progress, &pm, nir, nir_opt_undef);
+      NIR_LOOP_PASS(progress, &pm, nir, nir_opt_conditional_discard);
       if (nir->options->max_unroll_iterations) {
-         NIR_PASS(progress, nir, nir_opt_loop_unroll, (nir_variable_mode)0);
+         NIR_LOOP_PASS(progress, &pm, nir, nir_opt_loop_unroll,
+                       (nir_variable_mode)0);
       }
    } while (progress);
+
+   nir_pass_manager_finish(&pm);
 }
 
 /* First third of converting glsl_to_nir.. this leaves things in a pre-
@@ -406,7 +419,13 @@ st_glsl_to_nir(struct st_context *st, struct gl_program *prog,
    nir_shader *softfp64 = NULL;
    if (nir->info.uses_64bit &&
        (options->lower_doubles_options & nir_lower_fp64_full_software) != 0) {
+      /* This compiles GLSL, which isn't reentrant, while the stages of a
+       * program are converted in parallel.
+       */
+      static simple_mtx_t float64_funcs_mtx = _SIMPLE_MTX_INITIALIZER_NP;
+      simple_mtx_lock(&float64_funcs_mtx);
       softfp64 = glsl_float64_funcs_to_nir(st->ctx, options);
+      simple_mtx_unlock(&float64_funcs_mtx);
       ralloc_steal(ralloc_parent(nir), softfp64);
    }
 
@@ -618,7 +637,6 @@ st_nir_get_mesa_program(struct gl_context *ctx,
                         struct gl_shader_program *shader_program,
                         struct gl_linked_shader *shader)
 {
-   struct st_context *st = st_context(ctx);
    struct pipe_screen *pscreen = ctx->st->pipe->screen;
    struct gl_program *prog;
 
@@ -647,10 +665,32 @@ st_nir_get_mesa_program(struct gl_context *ctx,
 
    prog->ExternalSamplersUsed = gl_external_samplers(prog);
    _mesa_update_shader_textures_used(shader_program, prog);
+}
 
-   nir_shader *nir = st_glsl_to_nir(st, prog, shader_program, shader->Stage);
+/* Converting a stage to NIR and optimizing it only reads the context and
+ * the linked program, so the stages of a program are converted in parallel.
+ */
+struct st_glsl_to_nir_job {
+   struct st_context *st;
+   struct gl_shader_program *shader_program;
+   struct gl_linked_shader *shader;
+   bool is_scalar;
+   struct util_queue_fence fence;
+};
+
+static void
+st_glsl_to_nir_job_execute(void *data, int thread_index)
+{
+   struct st_glsl_to_nir_job *job = (struct st_glsl_to_nir_job *)data;
+   struct gl_program *prog = job->shader->Program;
+
+   nir_shader *nir = st_glsl_to_nir(job->st, prog, job->shader_program,
+                                    job->shader->Stage);
+
+   if (job->is_scalar) {
+      NIR_PASS_V(nir, nir_lower_load_const_to_scalar);
+   }
 
-   set_st_program(prog, shader_program, nir);
    prog->nir = nir;
 }
 
@@ -791,6 +831,8 @@ st_link_nir(struct gl_context *ctx,
    struct st_context *st = st_context(ctx);
    struct pipe_screen *screen = st->pipe->screen;
    bool is_scalar[MESA_SHADER_STAGES];
+   struct st_glsl_to_nir_job jobs[MESA_SHADER_STAGES];
+   unsigned num_jobs = 0;
 
    unsigned last_stage = 0;
    for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
@@ -806,11 +848,48 @@ st_link_nir(struct gl_context *ctx,
       st_nir_get_mesa_program(ctx, shader_program, shader);
       last_stage = i;
 
-      if (is_scalar[i]) {
-         NIR_PASS_V(shader->Program->nir, nir_lower_load_const_to_scalar);
+      struct st_glsl_to_nir_job *job = &jobs[num_jobs++];
+      job->st = st;
+      job->shader_program = shader_program;
+      job->shader = shader;
+      job->is_scalar = is_scalar[i];
+   }
+
+   /* The linking thread converts one of the stages itself, the others can
+    * be converted by up to one thread each.  Only try to create the threads
+    * once.
+    */
+   if (num_jobs > 1 && st->parallel_link) {
+      st->parallel_link = false;
+      st->has_link_queue =
+         util_queue_init(&st->link_queue, "st_link", MESA_SHADER_STAGES,
+                         MIN2(util_cpu_caps.nr_cpus - 1,
+                              MESA_SHADER_STAGES - 1), 0);
+   }
+
+   /* The last stage is converted on this thread while the queue takes care
+    * of the others.
+    */
+   for (unsigned i = 0; i < num_jobs; i++) {
+      util_queue_fence_init(&jobs[i].fence);
+
+      if (st->has_link_queue && i + 1 < num_jobs) {
+         util_queue_add_job(&st->link_queue, &jobs[i], &jobs[i].fence,
+                            st_glsl_to_nir_job_execute, NULL);
+      } else {
+         st_glsl_to_nir_job_execute(&jobs[i], 0);
       }
    }
 
+   for (unsigned i = 0; i < num_jobs; i++) {
+      struct gl_program *prog = jobs[i].shader->Program;
+
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+
+      set_st_program(prog, shader_program, prog->nir);
+   }
+
    /* Linking the stages in the opposite order (from fragment to vertex)
     * ensures that inter-shader outputs written to in an earlier stage
     * are eliminated if they are (transitively) not used in a later
@@ -37,19 +37,23 @@
 #include <pwd.h>
 #include <errno.h>
 #include <dirent.h>
-#include "zlib.h"
-
+#include <time.h>
 #include "util/crc32.h"
 #include "util/debug.h"
-#include "util/rand_xor.h"
+#include "util/hash_table.h"
+#include "util/list.h"
 #include "util/u_atomic.h"
 #include "util/u_queue.h"
 #include "util/mesa-sha1.h"
 #include "util/ralloc.h"
+#include "util/simple_mtx.h"
 #include "main/compiler.h"
 #include "main/errors.h"
 
 #include "disk_cache.h"
+#include "disk_cache_codec.h"
+#include "disk_cache_db.h"
+#include "disk_cache_lru.h"
 
 /* Number of bits to mask off from a cache key to get an index. */
 #define CACHE_INDEX_KEY_BITS 16
@@ -72,7 +76,20 @@
  * - There is no strict requirement that cache versions be backwards
  *   compatible but effort should be taken to limit disruption where possible.
  */
-#define CACHE_VERSION 1
+#define CACHE_VERSION 2
+
+/* Default size of the in-memory cache in front of the disk cache. */
+#define CACHE_DEFAULT_MEMORY_SIZE (16 * 1024 * 1024)
+
+/* Age in seconds after which a temporary file is assumed to have been left
+ * behind by a writer that died.
+ */
+#define CACHE_STALE_TMP_AGE (60 * 60)
+
+/* How often, in seconds, one of the processes using the cache walks the
+ * whole cache directory to remove stale files and fix the recorded size.
+ */
+#define CACHE_GC_INTERVAL (24 * 60 * 60)
 
 struct disk_cache {
    /* The path to the cache directory. */
@@ -82,9 +99,6 @@ struct disk_cache {
    /* Thread queue for compressing and writing cache entries to disk */
    struct util_queue cache_queue;
 
-   /* Seed for rand, which is used to pick a random directory */
-   uint64_t seed_xorshift128plus[2];
-
    /* A pointer to the mmapped index file within the cache directory. */
    uint8_t *index_mmap;
    size_t index_mmap_size;
@@ -98,12 +112,54 @@ struct disk_cache {
    /* Maximum size of all cached objects (in bytes). */
    uint64_t max_size;
 
+   /* Compression of the entries we write. */
+   enum disk_cache_codec codec;
+
+   /* Eviction order of the entries, NULL with single file storage.  Only
+    * filled with what's on disk once eviction is needed, see init_lru().
+    */
+   struct disk_cache_lru *lru;
+   bool lru_filled;
+   char *lru_path;
+   struct util_queue_fence gc_fence;
+
+   struct disk_cache_stats stats;
+
    /* Driver cache keys. */
    uint8_t *driver_keys_blob;
    size_t driver_keys_blob_size;
 
    disk_cache_put_cb blob_put_cb;
    disk_cache_get_cb blob_get_cb;
+
+   /* Single file storage, NULL when every entry has its own file. */
+   struct disk_cache_db *db;
+   struct util_queue_fence db_compaction_fence;
+
+   /* In-memory LRU cache of recently put, got or prefetched entries, in
+    * front of the disk.  The list is in most recently used first order.
+    */
+   simple_mtx_t mem_lock;
+   struct hash_table *mem_index;
+   struct list_head mem_lru;
+   uint64_t mem_size;
+   uint64_t mem_max_size;
+};
+
+struct mem_cache_entry {
+   struct list_head link;
+   cache_key key;
+   size_t size;
+   uint8_t data[];
+};
+
+struct disk_cache_prefetch_job {
+   struct util_queue_fence fence;
+
+   struct disk_cache *cache;
+
+   unsigned num_keys;
+   cache_key keys[];
 };
 
 struct disk_cache_put_job {
@@ -188,6 +244,187 @@ do {                                       \
    _dst += _src_size;                      \
 } while (0);
 
+/* Parse a size in bytes, optionally followed by 'K', 'M' or 'G'.  For
+ * compatibility, a bare number is in gigabytes.  Returns 0 if \str isn't
+ * a number.
+ */
+static uint64_t
+parse_size(const char *str)
+{
+   uint64_t size;
+   char *end;
+
+   size = strtoul(str, &end, 10);
+   if (end == str)
+      return 0;
+
+   switch (*end) {
+   case 'K':
+   case 'k':
+      return size * 1024;
+   case 'M':
+   case 'm':
+      return size * 1024*1024;
+   case '\0':
+   case 'G':
+   case 'g':
+   default:
+      return size * 1024*1024*1024;
+   }
+}
+
+static uint32_t
+key_hash(const void *key)
+{
+   /* Keys are SHA-1 hashes, any 32 bits of them will do. */
+   uint32_t hash;
+   memcpy(&hash, key, sizeof(hash));
+   return hash;
+}
+
+static bool
+key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, CACHE_KEY_SIZE) == 0;
+}
+
+static bool
+mem_cache_init(struct disk_cache *cache)
+{
+   const char *size_str = getenv("MESA_DISK_CACHE_MEMORY_SIZE");
+
+   cache->mem_max_size = size_str ? parse_size(size_str) :
+                                    CACHE_DEFAULT_MEMORY_SIZE;
+
+   simple_mtx_init(&cache->mem_lock, mtx_plain);
+   list_inithead(&cache->mem_lru);
+   cache->mem_index = _mesa_hash_table_create(cache, key_hash, key_equal);
+
+   return cache->mem_index != NULL;
+}
+
+static void
+mem_cache_finish(struct disk_cache *cache)
+{
+   list_for_each_entry_safe(struct mem_cache_entry, entry, &cache->mem_lru,
+                            link)
+      free(entry);
+
+   simple_mtx_destroy(&cache->mem_lock);
+}
+
+static void
+mem_cache_remove_locked(struct disk_cache *cache, struct hash_entry *entry)
+{
+   struct mem_cache_entry *mem_entry = entry->data;
+
+   _mesa_hash_table_remove(cache->mem_index, entry);
+   list_del(&mem_entry->link);
+   cache->mem_size -= mem_entry->size;
+   free(mem_entry);
+}
+
+static void
+mem_cache_put(struct disk_cache *cache, const cache_key key,
+              const void *data, size_t size)
+{
+   struct mem_cache_entry *mem_entry;
+   struct hash_entry *entry;
+
+   /* Don't let a single entry flush most of the cache. */
+   if (cache->mem_max_size == 0 || size > cache->mem_max_size / 4)
+      return;
+
+   mem_entry = malloc(sizeof(*mem_entry) + size);
+   if (!mem_entry)
+      return;
+
+   memcpy(mem_entry->key, key, CACHE_KEY_SIZE);
+   mem_entry->size = size;
+   memcpy(mem_entry->data, data, size);
+
+   simple_mtx_lock(&cache->mem_lock);
+
+   entry = _mesa_hash_table_search(cache->mem_index, key);
+   if (entry)
+      mem_cache_remove_locked(cache, entry);
+
+   while (cache->mem_size + size > cache->mem_max_size) {
+      struct mem_cache_entry *lru =
+         LIST_ENTRY(struct mem_cache_entry, cache->mem_lru.prev, link);
+
+      mem_cache_remove_locked(cache,
+                              _mesa_hash_table_search(cache->mem_index,
+                                                      lru->key));
+   }
+
+   _mesa_hash_table_insert(cache->mem_index, mem_entry->key, mem_entry);
+   list_add(&mem_entry->link, &cache->mem_lru);
+   cache->mem_size += size;
+
+   simple_mtx_unlock(&cache->mem_lock);
+}
+
+static void *
+mem_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
+{
+   struct mem_cache_entry *mem_entry;
+   struct hash_entry *entry;
+   void *data = NULL;
+
+   simple_mtx_lock(&cache->mem_lock);
+
+   entry = _mesa_hash_table_search(cache->mem_index, key);
+   if (entry) {
+      mem_entry = entry->data;
+
+      data = malloc(mem_entry->size);
+      if (data) {
+         memcpy(data, mem_entry->data, mem_entry->size);
+         *size = mem_entry->size;
+
+         list_del(&mem_entry->link);
+         list_add(&mem_entry->link, &cache->mem_lru);
+      }
+   }
+
+   simple_mtx_unlock(&cache->mem_lock);
+
+   return data;
+}
+
+static bool
+mem_cache_has(struct disk_cache *cache, const cache_key key)
+{
+   bool ret;
+
+   simple_mtx_lock(&cache->mem_lock);
+   ret = _mesa_hash_table_search(cache->mem_index, key) != NULL;
+   simple_mtx_unlock(&cache->mem_lock);
+
+   return ret;
+}
+
+static void
+mem_cache_remove(struct disk_cache *cache, const cache_key key)
+{
+   struct hash_entry *entry;
+
+   simple_mtx_lock(&cache->mem_lock);
+
+   entry = _mesa_hash_table_search(cache->mem_index, key);
+   if (entry)
+      mem_cache_remove_locked(cache, entry);
+
+   simple_mtx_unlock(&cache->mem_lock);
+}
+
+static bool
+gc_due(struct disk_cache *cache, void *mem_ctx);
+
+static void
+cache_gc(void *job, int thread_index);
+
 struct disk_cache *
 disk_cache_create(const char *gpu_name, const char *driver_id,
                   uint64_t driver_flags)
@@ -223,6 +460,10 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
    /* Assume failure. */
    cache->path_init_failed = true;
 
+   /* The in-memory cache also works when the cache directory doesn't. */
+   if (!mem_cache_init(cache))
+      goto fail;
+
    /* Determine path for cache based on the first defined name as follows:
     *
     *   $MESA_GLSL_CACHE_DIR
@@ -336,30 +577,8 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
    max_size = 0;
 
    max_size_str = getenv("MESA_GLSL_CACHE_MAX_SIZE");
-   if (max_size_str) {
-      char *end;
-      max_size = strtoul(max_size_str, &end, 10);
-      if (end == max_size_str) {
-         max_size = 0;
-      } else {
-         switch (*end) {
-         case 'K':
-         case 'k':
-            max_size *= 1024;
-            break;
-         case 'M':
-         case 'm':
-            max_size *= 1024*1024;
-            break;
-         case '\0':
-         case 'G':
-         case 'g':
-         default:
-            max_size *= 1024*1024*1024;
-            break;
-         }
-      }
-   }
+   if (max_size_str)
+      max_size = parse_size(max_size_str);
 
    /* Default to 1GB for maximum cache size. */
    if (max_size == 0) {
@@ -368,17 +587,49 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
 
    cache->max_size = max_size;
 
+   cache->codec = disk_cache_codec_from_env();
+
+   /* Pack all the entries in one file, rather than a file per entry.  If
+    * that file can't be used, fall back to the per-entry files.
+    */
+   if (env_var_as_boolean("MESA_DISK_CACHE_SINGLE_FILE", false)) {
+      cache->db = disk_cache_db_open(cache, cache->path, max_size);
+      if (cache->db)
+         util_queue_fence_init(&cache->db_compaction_fence);
+   }
+
+   if (!cache->db) {
+      const char *eviction = getenv("MESA_DISK_CACHE_EVICTION");
+      cache->lru = disk_cache_lru_create(cache,
+         eviction && strcmp(eviction, "lfu") == 0 ?
+            DISK_CACHE_EVICTION_LFU : DISK_CACHE_EVICTION_LRU);
+      cache->lru_path = ralloc_asprintf(cache, "%s/%s", cache->path,
+                                        DISK_CACHE_LRU_FILE_NAME);
+      if (!cache->lru || !cache->lru_path)
+         goto path_fail;
+   }
+
    /* 1 thread was chosen because we don't really care about getting things
     * to disk quickly just that it's not blocking other tasks.
     *
     * The queue will resize automatically when it's full, so adding new jobs
-    * doesn't stall.
+    * doesn't stall.  Prefetches are queued at high priority, since the
+    * application is about to need them, and garbage collection and
+    * compaction at low priority, so they don't hold up the puts.
     */
    util_queue_init(&cache->cache_queue, "disk$", 32, 1,
                    UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                   UTIL_QUEUE_INIT_WORK_STEALING |
                    UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY |
                    UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY);
 
+   util_queue_fence_init(&cache->gc_fence);
+   if (cache->lru && gc_due(cache, local)) {
+      util_queue_add_job_with_priority(&cache->cache_queue, cache,
+                                       &cache->gc_fence, cache_gc, NULL,
+                                       UTIL_QUEUE_PRIORITY_LOW);
+   }
+
    cache->path_init_failed = false;
 
  path_fail:
@@ -416,16 +667,16 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
    DRV_KEY_CPY(drv_key_blob, &ptr_size, ptr_size_size)
    DRV_KEY_CPY(drv_key_blob, &driver_flags, driver_flags_size)
 
-   /* Seed our rand function */
-   s_rand_xorshift128plus(cache->seed_xorshift128plus, true);
-
    ralloc_free(local);
 
    return cache;
 
  fail:
-   if (cache)
+   if (cache) {
+      if (cache->mem_index)
+         mem_cache_finish(cache);
       ralloc_free(cache);
+   }
    ralloc_free(local);
 
    return NULL;
@@ -436,9 +687,29 @@ disk_cache_destroy(struct disk_cache *cache)
 {
    if (cache && !cache->path_init_failed) {
       util_queue_destroy(&cache->cache_queue);
+      util_queue_fence_destroy(&cache->gc_fence);
       munmap(cache->index_mmap, cache->index_mmap_size);
+
+      /* Spare the next process a directory scan.  Without a complete index
+       * of our own, only add the entries we wrote to an index that is
+       * already there, a new one would be missing the others.
+       */
+      if (cache->lru &&
+          (cache->lru_filled ||
+           (disk_cache_lru_count(cache->lru) &&
+            access(cache->lru_path, F_OK) == 0)))
+         disk_cache_lru_save(cache->lru, cache->lru_path, true);
+      disk_cache_lru_destroy(cache->lru);
+
+      if (cache->db) {
+         util_queue_fence_destroy(&cache->db_compaction_fence);
+         disk_cache_db_close(cache->db);
+      }
    }
 
+   if (cache)
+      mem_cache_finish(cache);
+
    ralloc_free(cache);
 }
 
@@ -483,187 +754,216 @@ make_cache_file_directory(struct disk_cache *cache, const cache_key key)
    free(dir);
 }
 
-/* Given a directory path and predicate function, find the entry with
- * the oldest access time in that directory for which the predicate
- * returns true.
- *
- * Returns: A malloc'ed string for the path to the chosen file, (or
- * NULL on any error). The caller should free the string when
- * finished.
+static int
+hex_digit_value(char c)
+{
+   if (c >= '0' && c <= '9')
+      return c - '0';
+   if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+   return -1;
+}
+
+/* The inverse of get_cache_file(): get the key back from the names of the
+ * two-character subdirectory and the file in it.
  */
-static char *
-choose_lru_file_matching(const char *dir_path,
-                         bool (*predicate)(const char *dir_path,
-                                           const struct stat *,
-                                           const char *, const size_t))
+static bool
+parse_cache_file_name(const char *dir_name, const char *file_name,
+                      cache_key key)
 {
-   DIR *dir;
-   struct dirent *entry;
-   char *filename;
-   char *lru_name = NULL;
-   time_t lru_atime = 0;
+   char buf[2 * CACHE_KEY_SIZE];
 
-   dir = opendir(dir_path);
-   if (dir == NULL)
-      return NULL;
+   if (strlen(file_name) != 2 * CACHE_KEY_SIZE - 2)
+      return false;
+
+   memcpy(buf, dir_name, 2);
+   memcpy(buf + 2, file_name, 2 * CACHE_KEY_SIZE - 2);
+
+   for (unsigned i = 0; i < CACHE_KEY_SIZE; i++) {
+      int hi = hex_digit_value(buf[2 * i]);
+      int lo = hex_digit_value(buf[2 * i + 1]);
+      if (hi < 0 || lo < 0)
+         return false;
+      key[i] = hi << 4 | lo;
+   }
+
+   return true;
+}
 
-   while (1) {
-      entry = readdir(dir);
-      if (entry == NULL)
-         break;
-
-      struct stat sb;
-      if (fstatat(dirfd(dir), entry->d_name, &sb, 0) == 0) {
-         if (!lru_atime || (sb.st_atime < lru_atime)) {
-            size_t len = strlen(entry->d_name);
-
-            if (!predicate(dir_path, &sb, entry->d_name, len))
-               continue;
-
-            char *tmp = realloc(lru_name, len + 1);
-            if (tmp) {
-               lru_name = tmp;
-               memcpy(lru_name, entry->d_name, len + 1);
-               lru_atime = sb.st_atime;
-            }
+/* Walk the whole cache directory, adding every entry to the eviction index
+ * and removing the temporary files left behind by writers that died.  The
+ * recorded cache size is then set to what is actually on disk.
+ *
+ * This is only done by the daily garbage collection, and when there is no
+ * valid saved index.
+ */
+static void
+scan_cache_dir(struct disk_cache *cache)
+{
+   time_t now = time(NULL);
+   uint64_t total = 0;
+
+   for (unsigned i = 0; i < 256; i++) {
+      struct dirent *entry;
+      char dir_name[3];
+      char *dir_path;
+      DIR *dir;
+
+      snprintf(dir_name, sizeof(dir_name), "%02x", i);
+      if (asprintf(&dir_path, "%s/%s", cache->path, dir_name) == -1)
+         return;
+
+      dir = opendir(dir_path);
+      free(dir_path);
+      if (dir == NULL)
+         continue;
+
+      while ((entry = readdir(dir)) != NULL) {
+         size_t len = strlen(entry->d_name);
+         struct stat sb;
+         cache_key key;
+
+         if (fstatat(dirfd(dir), entry->d_name, &sb,
+                     AT_SYMLINK_NOFOLLOW) == -1 ||
+             !S_ISREG(sb.st_mode))
+            continue;
+
+         if (len >= 4 && strcmp(&entry->d_name[len - 4], ".tmp") == 0) {
+            if (now - sb.st_mtime > CACHE_STALE_TMP_AGE)
+               unlinkat(dirfd(dir), entry->d_name, 0);
+            continue;
          }
+
+         if (!parse_cache_file_name(dir_name, entry->d_name, key))
+            continue;
+
+         disk_cache_lru_add(cache->lru, key, sb.st_blocks * 512,
+                            sb.st_atime);
+         total += sb.st_blocks * 512;
       }
-   }
 
-   if (lru_name == NULL) {
       closedir(dir);
-      return NULL;
    }
 
-   if (asprintf(&filename, "%s/%s", dir_path, lru_name) < 0)
-      filename = NULL;
-
-   free(lru_name);
-   closedir(dir);
+   /* Other processes may be adding and evicting entries at the same time,
+    * but this is still a lot closer to the truth than a size that has been
+    * drifting for months.
+    */
+   p_atomic_set(cache->size, total);
+   cache->lru_filled = true;
+}
 
-   return filename;
+/* Fill the eviction index from the copy saved in the cache directory, or
+ * from the directory itself if that copy is missing or corrupt.  Evictions
+ * then just take the first entry of the index.
+ */
+static void
+init_lru(struct disk_cache *cache)
+{
+   if (disk_cache_lru_load(cache->lru, cache->lru_path))
+      cache->lru_filled = true;
+   else
+      scan_cache_dir(cache);
 }
 
-/* Is entry a regular file, and not having a name with a trailing
- * ".tmp"
+/* Evict the first entry of the eviction order.  Returns false if there's
+ * nothing left to evict.
  */
 static bool
-is_regular_non_tmp_file(const char *path, const struct stat *sb,
-                        const char *d_name, const size_t len)
+evict_lru_item(struct disk_cache *cache)
 {
-   if (!S_ISREG(sb->st_mode))
-      return false;
+   cache_key key;
+   uint64_t size;
+   int64_t atime;
+   struct stat sb;
 
-   if (len >= 4 && strcmp(&d_name[len-4], ".tmp") == 0)
-      return false;
+   while (disk_cache_lru_next(cache->lru, key, &size, &atime)) {
+      char *filename = get_cache_file(cache, key);
+      if (filename == NULL)
+         return false;
 
-   return true;
-}
+      if (stat(filename, &sb) == -1) {
+         /* Another process evicted it already. */
+         disk_cache_lru_remove(cache->lru, key);
+         free(filename);
+         continue;
+      }
 
-/* Returns the size of the deleted file, (or 0 on any error). */
-static size_t
-unlink_lru_file_from_directory(const char *path)
-{
-   struct stat sb;
-   char *filename;
+      /* Another process used it since we last looked, requeue it. */
+      if (sb.st_atime > atime) {
+         disk_cache_lru_add(cache->lru, key, sb.st_blocks * 512,
+                            sb.st_atime);
+         free(filename);
+         continue;
+      }
 
-   filename = choose_lru_file_matching(path, is_regular_non_tmp_file);
-   if (filename == NULL)
-      return 0;
+      unlink(filename);
+      free(filename);
+      disk_cache_lru_remove(cache->lru, key);
 
-   if (stat(filename, &sb) == -1) {
-      free (filename);
-      return 0;
+      p_atomic_add(cache->size, - (uint64_t)sb.st_blocks * 512);
+      p_atomic_inc(&cache->stats.evictions);
+      p_atomic_add(&cache->stats.bytes_evicted, (uint64_t)sb.st_blocks * 512);
+      return true;
    }
 
-   unlink(filename);
-   free (filename);
-
-   return sb.st_blocks * 512;
+   return false;
 }
 
-/* Is entry a directory with a two-character name, (and not the
- * special name of ".."). We also return false if the dir is empty.
+/* Whether it's time to garbage collect the cache directory again.  The
+ * time of the last collection is the modification time of the "gc" file.
  */
 static bool
-is_two_character_sub_directory(const char *path, const struct stat *sb,
-                               const char *d_name, const size_t len)
+gc_due(struct disk_cache *cache, void *mem_ctx)
 {
-   if (!S_ISDIR(sb->st_mode))
-      return false;
-
-   if (len != 2)
-      return false;
+   struct stat sb;
+   char *path;
+   int fd;
 
-   if (strcmp(d_name, "..") == 0)
+   path = ralloc_asprintf(mem_ctx, "%s/gc", cache->path);
+   if (path == NULL)
       return false;
 
-   char *subdir;
-   if (asprintf(&subdir, "%s/%s", path, d_name) == -1)
+   if (stat(path, &sb) == 0 && time(NULL) - sb.st_mtime < CACHE_GC_INTERVAL)
       return false;
-   DIR *dir = opendir(subdir);
-   free(subdir);
-
-   if (dir == NULL)
-     return false;
 
-   unsigned subdir_entries = 0;
-   struct dirent *d;
-   while ((d = readdir(dir)) != NULL) {
-      if(++subdir_entries > 2)
-         break;
-   }
-   closedir(dir);
-
-   /* If dir only contains '.' and '..' it must be empty */
-   if (subdir_entries <= 2)
+   /* Claim this collection, so that the processes starting at the same
+    * time don't all do it.
+    */
+   fd = open(path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+   if (fd == -1)
       return false;
+   futimens(fd, NULL);
+   close(fd);
 
    return true;
 }
 
 static void
-evict_lru_item(struct disk_cache *cache)
+cache_gc(void *job, int thread_index)
 {
-   char *dir_path;
-
-   /* With a reasonably-sized, full cache, (and with keys generated
-    * from a cryptographic hash), we can choose two random hex digits
-    * and reasonably expect the directory to exist with a file in it.
-    * Provides pseudo-LRU eviction to reduce checking all cache files.
-    */
-   uint64_t rand64 = rand_xorshift128plus(cache->seed_xorshift128plus);
-   if (asprintf(&dir_path, "%s/%02" PRIx64 , cache->path, rand64 & 0xff) < 0)
-      return;
-
-   size_t size = unlink_lru_file_from_directory(dir_path);
+   struct disk_cache *cache = (struct disk_cache *) job;
+   char *tmp_path;
+   struct stat sb;
 
-   free(dir_path);
+   scan_cache_dir(cache);
 
-   if (size) {
-      p_atomic_add(cache->size, - (uint64_t)size);
-      return;
-   }
+   while (*cache->size > cache->max_size && evict_lru_item(cache))
+      ;
 
-   /* In the case where the random choice of directory didn't find
-    * something, we choose the least recently accessed from the
-    * existing directories.
-    *
-    * Really, the only reason this code exists is to allow the unit
-    * tests to work, (which use an artificially-small cache to be able
-    * to force a single cached item to be evicted).
+   /* A process that died while saving the index blocks the others from
+    * saving theirs.
     */
-   dir_path = choose_lru_file_matching(cache->path,
-                                       is_two_character_sub_directory);
-   if (dir_path == NULL)
-      return;
-
-   size = unlink_lru_file_from_directory(dir_path);
-
-   free(dir_path);
-
-   if (size)
-      p_atomic_add(cache->size, - (uint64_t)size);
+   tmp_path = ralloc_asprintf(NULL, "%s.tmp", cache->lru_path);
+   if (tmp_path && stat(tmp_path, &sb) == 0 &&
+       time(NULL) - sb.st_mtime > CACHE_STALE_TMP_AGE)
+      unlink(tmp_path);
+   ralloc_free(tmp_path);
+
+   /* The scan found every entry, drop the ones the saved index still has
+    * for files that are gone.
+    */
+   disk_cache_lru_save(cache->lru, cache->lru_path, false);
 }
 
 void
@@ -671,6 +971,13 @@ disk_cache_remove(struct disk_cache *cache, const cache_key key)
 {
    struct stat sb;
 
+   mem_cache_remove(cache, key);
+
+   if (cache->db) {
+      disk_cache_db_remove(cache->db, key);
+      return;
+   }
+
    char *filename = get_cache_file(cache, key);
    if (filename == NULL) {
       return;
@@ -684,6 +991,8 @@ disk_cache_remove(struct disk_cache *cache, const cache_key key)
    unlink(filename);
    free(filename);
 
+   disk_cache_lru_remove(cache->lru, key);
+
    if (sb.st_blocks)
       p_atomic_add(cache->size, - (uint64_t)sb.st_blocks * 512);
 }
@@ -718,73 +1027,33 @@ write_all(int fd, const void *buf, size_t count)
    return done;
 }
 
-/* From the zlib docs:
- *    "If the memory is available, buffers sizes on the order of 128K or 256K
- *    bytes should be used."
- */
-#define BUFSIZE 256 * 1024
-
 /**
- * Compresses cache entry in memory and writes it to disk. Returns the size
- * of the data written to disk.
+ * Compresses the cache entry with the cache's codec.  Returns a malloc'ed
+ * buffer, or NULL if the entry doesn't compress and should be stored as it
+ * is.
  */
-static size_t
-deflate_and_write_to_disk(const void *in_data, size_t in_data_size, int dest,
-                          const char *filename)
+static void *
+compress_entry(struct disk_cache *cache, const void *data, size_t size,
+               size_t *compressed_size)
 {
-   unsigned char out[BUFSIZE];
-
-   /* allocate deflate state */
-   z_stream strm;
-   strm.zalloc = Z_NULL;
-   strm.zfree = Z_NULL;
-   strm.opaque = Z_NULL;
-   strm.next_in = (uint8_t *) in_data;
-   strm.avail_in = in_data_size;
-
-   int ret = deflateInit(&strm, Z_BEST_COMPRESSION);
-   if (ret != Z_OK)
-       return 0;
-
-   /* compress until end of in_data */
-   size_t compressed_size = 0;
-   int flush;
-   do {
-      int remaining = in_data_size - BUFSIZE;
-      flush = remaining > 0 ? Z_NO_FLUSH : Z_FINISH;
-      in_data_size -= BUFSIZE;
-
-      /* Run deflate() on input until the output buffer is not full (which
-       * means there is no more data to deflate).
-       */
-      do {
-         strm.avail_out = BUFSIZE;
-         strm.next_out = out;
-
-         ret = deflate(&strm, flush);    /* no bad return value */
-         assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
-
-         size_t have = BUFSIZE - strm.avail_out;
-         compressed_size += have;
+   size_t bound = disk_cache_compress_bound(cache->codec, size);
+   uint8_t *compressed;
 
-         ssize_t written = write_all(dest, out, have);
-         if (written == -1) {
-            (void)deflateEnd(&strm);
-            return 0;
-         }
-      } while (strm.avail_out == 0);
-
-      /* all input should be used */
-      assert(strm.avail_in == 0);
+   if (cache->codec == DISK_CACHE_CODEC_NONE || bound == 0)
+      return NULL;
 
-   } while (flush != Z_FINISH);
+   compressed = malloc(bound);
+   if (!compressed)
+      return NULL;
 
-   /* stream should be complete */
-   assert(ret == Z_STREAM_END);
+   *compressed_size = disk_cache_compress(cache->codec, data, size,
+                                          compressed, bound);
+   if (*compressed_size == 0 || *compressed_size >= size) {
+      free(compressed);
+      return NULL;
+   }
 
-   /* clean up and return */
-   (void)deflateEnd(&strm);
-   return compressed_size;
+   return compressed;
 }
 
 static struct disk_cache_put_job *
@@ -846,27 +1115,86 @@ destroy_put_job(void *job, int thread_index)
 struct cache_entry_file_data {
    uint32_t crc32;
    uint32_t uncompressed_size;
+
+   /* enum disk_cache_codec */
+   uint32_t codec;
 };
 
+static void
+compact_db(void *job, int thread_index)
+{
+   struct disk_cache *cache = (struct disk_cache *) job;
+
+   p_atomic_add(&cache->stats.evictions, disk_cache_db_compact(cache->db));
+}
+
+/**
+ * Compresses the entry and appends it to the cache database.  Entries that
+ * don't compress are stored as they are, and can be read straight from the
+ * mapped file.
+ */
+static void
+cache_put_db(struct disk_cache_put_job *dc_job)
+{
+   struct disk_cache *cache = dc_job->cache;
+   enum disk_cache_codec codec = cache->codec;
+   const void *data;
+   size_t size;
+
+   void *compressed = compress_entry(cache, dc_job->data, dc_job->size,
+                                     &size);
+   if (compressed) {
+      data = compressed;
+   } else {
+      codec = DISK_CACHE_CODEC_NONE;
+      data = dc_job->data;
+      size = dc_job->size;
+   }
+
+   disk_cache_db_put(cache->db, dc_job->key, codec,
+                     util_hash_crc32(dc_job->data, dc_job->size),
+                     dc_job->size, data, size);
+   free(compressed);
+
+   /* Compact in a separate job, unless one is queued already.  Only this
+    * thread queues compaction jobs, so checking the fence isn't racy.
+    */
+   if (disk_cache_db_needs_compaction(cache->db) &&
+       util_queue_fence_is_signalled(&cache->db_compaction_fence)) {
+      util_queue_add_job_with_priority(&cache->cache_queue, cache,
+                                       &cache->db_compaction_fence,
+                                       compact_db, NULL,
+                                       UTIL_QUEUE_PRIORITY_LOW);
+   }
+}
+
 static void
 cache_put(void *job, int thread_index)
 {
    assert(job);
 
    int fd = -1, fd_final = -1, err, ret;
-   unsigned i = 0;
    char *filename = NULL, *filename_tmp = NULL;
    struct disk_cache_put_job *dc_job = (struct disk_cache_put_job *) job;
+   struct disk_cache *cache = dc_job->cache;
+
+   if (cache->db) {
+      cache_put_db(dc_job);
+      return;
+   }
 
    filename = get_cache_file(dc_job->cache, dc_job->key);
    if (filename == NULL)
       goto done;
 
    /* If the cache is too large, evict something else first. */
-   while (*dc_job->cache->size + dc_job->size > dc_job->cache->max_size &&
-          i < 8) {
-      evict_lru_item(dc_job->cache);
-      i++;
+   if (*cache->size + dc_job->size > cache->max_size) {
+      if (!cache->lru_filled)
+         init_lru(cache);
+
+      while (*cache->size + dc_job->size > cache->max_size &&
+             evict_lru_item(cache))
+         ;
    }
 
    /* Write to a temporary file to allow for an atomic rename to the
@@ -958,13 +1286,19 @@ cache_put(void *job, int thread_index)
    /* Create CRC of the data. We will read this when restoring the cache and
     * use it to check for corruption.
     */
+   size_t compressed_size;
+   void *compressed = compress_entry(dc_job->cache, dc_job->data,
+                                     dc_job->size, &compressed_size);
+
    struct cache_entry_file_data cf_data;
    cf_data.crc32 = util_hash_crc32(dc_job->data, dc_job->size);
    cf_data.uncompressed_size = dc_job->size;
+   cf_data.codec = compressed ? dc_job->cache->codec : DISK_CACHE_CODEC_NONE;
 
    size_t cf_data_size = sizeof(cf_data);
    ret = write_all(fd, &cf_data, cf_data_size);
    if (ret == -1) {
+      free(compressed);
       unlink(filename_tmp);
       goto done;
    }
@@ -973,9 +1307,12 @@ cache_put(void *job, int thread_index)
     * rename them atomically to the destination filename, and also
     * perform an atomic increment of the total cache size.
     */
-   size_t file_size = deflate_and_write_to_disk(dc_job->data, dc_job->size,
-                                                fd, filename_tmp);
-   if (file_size == 0) {
+   if (compressed)
+      ret = write_all(fd, compressed, compressed_size);
+   else
+      ret = write_all(fd, dc_job->data, dc_job->size);
+   free(compressed);
+   if (ret == -1) {
       unlink(filename_tmp);
       goto done;
    }
@@ -993,6 +1330,8 @@ cache_put(void *job, int thread_index)
    }
 
    p_atomic_add(dc_job->cache->size, sb.st_blocks * 512);
+   disk_cache_lru_add(cache->lru, dc_job->key, sb.st_blocks * 512,
+                      sb.st_atime);
 
  done:
    if (fd_final != -1)
@@ -1011,6 +1350,11 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
                const void *data, size_t size,
                struct cache_item_metadata *cache_item_metadata)
 {
+   p_atomic_inc(&cache->stats.puts);
+   p_atomic_add(&cache->stats.bytes_written, size);
+
+   mem_cache_put(cache, key, data, size);
+
    if (cache->blob_put_cb) {
       cache->blob_put_cb(key, CACHE_KEY_SIZE, data, size);
       return;
@@ -1029,47 +1373,46 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
    }
 }
 
-/**
- * Decompresses cache entry, returns true if successful.
- */
-static bool
-inflate_cache_data(uint8_t *in_data, size_t in_data_size,
-                   uint8_t *out_data, size_t out_data_size)
+static void *
+cache_get_db(struct disk_cache *cache, const cache_key key, size_t *size)
 {
-   z_stream strm;
-
-   /* allocate inflate state */
-   strm.zalloc = Z_NULL;
-   strm.zfree = Z_NULL;
-   strm.opaque = Z_NULL;
-   strm.next_in = in_data;
-   strm.avail_in = in_data_size;
-   strm.next_out = out_data;
-   strm.avail_out = out_data_size;
-
-   int ret = inflateInit(&strm);
-   if (ret != Z_OK)
-      return false;
+   struct disk_cache_db_entry entry;
+   uint8_t *data;
 
-   ret = inflate(&strm, Z_NO_FLUSH);
-   assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+   if (!disk_cache_db_get(cache->db, key, &entry))
+      return NULL;
 
-   /* Unless there was an error we should have decompressed everything in one
-    * go as we know the uncompressed file size.
-    */
-   if (ret != Z_STREAM_END) {
-      (void)inflateEnd(&strm);
-      return false;
+   data = malloc(entry.uncompressed_size);
+   if (!data) {
+      disk_cache_db_release(cache->db);
+      return NULL;
    }
-   assert(strm.avail_out == 0);
 
-   /* clean up and return */
-   (void)inflateEnd(&strm);
-   return true;
+   /* The entry points into the mapped file, so uncompressed entries are
+    * copied out with no read() at all.
+    */
+   bool ok = disk_cache_decompress(entry.codec, entry.data, entry.size,
+                                   data, entry.uncompressed_size);
+   disk_cache_db_release(cache->db);
+   if (!ok)
+      goto fail;
+
+   /* Check the data for corruption */
+   if (entry.crc32 != util_hash_crc32(data, entry.uncompressed_size))
+      goto fail;
+
+   if (size)
+      *size = entry.uncompressed_size;
+
+   return data;
+
+ fail:
+   free(data);
+   return NULL;
 }
 
-void *
-disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
+static void *
+cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
 {
    int fd = -1, ret;
    struct stat sb;
@@ -1103,6 +1446,9 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
       return blob;
    }
 
+   if (cache->db)
+      return cache_get_db(cache, key, size);
+
    filename = get_cache_file(cache, key);
    if (filename == NULL)
       goto fail;
@@ -1177,8 +1523,9 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
 
    /* Uncompress the cache data */
    uncompressed_data = malloc(cf_data.uncompressed_size);
-   if (!inflate_cache_data(data, cache_data_size, uncompressed_data,
-                           cf_data.uncompressed_size))
+   if (!uncompressed_data ||
+       !disk_cache_decompress(cf_data.codec, data, cache_data_size,
+                              uncompressed_data, cf_data.uncompressed_size))
       goto fail;
 
    /* Check the data for corruption */
@@ -1211,6 +1558,116 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
    return NULL;
 }
 
+void *
+disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
+{
+   size_t data_size = 0;
+   void *data;
+
+   data = mem_cache_get(cache, key, &data_size);
+   if (data) {
+      p_atomic_inc(&cache->stats.memory_hits);
+   } else {
+      data = cache_get(cache, key, &data_size);
+      if (data)
+         mem_cache_put(cache, key, data, data_size);
+   }
+
+   if (data) {
+      p_atomic_inc(&cache->stats.hits);
+      p_atomic_add(&cache->stats.bytes_read, data_size);
+      if (cache->lru)
+         disk_cache_lru_touch(cache->lru, key);
+   } else {
+      p_atomic_inc(&cache->stats.misses);
+   }
+
+   if (size)
+      *size = data ? data_size : 0;
+
+   return data;
+}
+
+void
+disk_cache_get_stats(struct disk_cache *cache, struct disk_cache_stats *stats)
+{
+   stats->hits = p_atomic_read(&cache->stats.hits);
+   stats->memory_hits = p_atomic_read(&cache->stats.memory_hits);
+   stats->misses = p_atomic_read(&cache->stats.misses);
+   stats->puts = p_atomic_read(&cache->stats.puts);
+   stats->evictions = p_atomic_read(&cache->stats.evictions);
+   stats->bytes_read = p_atomic_read(&cache->stats.bytes_read);
+   stats->bytes_written = p_atomic_read(&cache->stats.bytes_written);
+   stats->bytes_evicted = p_atomic_read(&cache->stats.bytes_evicted);
+
+   if (cache->path_init_failed)
+      stats->size = 0;
+   else if (cache->db)
+      stats->size = disk_cache_db_size(cache->db);
+   else
+      stats->size = p_atomic_read(cache->size);
+   stats->max_size = cache->path_init_failed ? 0 : cache->max_size;
+}
+
+static void
+cache_prefetch(void *job, int thread_index)
+{
+   struct disk_cache_prefetch_job *dc_job =
+      (struct disk_cache_prefetch_job *) job;
+   struct disk_cache *cache = dc_job->cache;
+
+   for (unsigned i = 0; i < dc_job->num_keys; i++) {
+      size_t size;
+      void *data;
+
+      if (mem_cache_has(cache, dc_job->keys[i]))
+         continue;
+
+      data = cache_get(cache, dc_job->keys[i], &size);
+      if (data) {
+         mem_cache_put(cache, dc_job->keys[i], data, size);
+         free(data);
+      }
+   }
+}
+
+static void
+destroy_prefetch_job(void *job, int thread_index)
+{
+   free(job);
+}
+
+void
+disk_cache_prefetch(struct disk_cache *cache, const cache_key *keys,
+                    unsigned num_keys)
+{
+   struct disk_cache_prefetch_job *dc_job;
+
+   if (cache->path_init_failed || num_keys == 0)
+      return;
+
+   dc_job = malloc(sizeof(*dc_job) + num_keys * sizeof(cache_key));
+   if (!dc_job)
+      return;
+
+   dc_job->cache = cache;
+   dc_job->num_keys = num_keys;
+   memcpy(dc_job->keys, keys, num_keys * sizeof(cache_key));
+
+   util_queue_fence_init(&dc_job->fence);
+   util_queue_add_job_with_priority(&cache->cache_queue, dc_job,
+                                    &dc_job->fence, cache_prefetch,
+                                    destroy_prefetch_job,
+                                    UTIL_QUEUE_PRIORITY_HIGH);
+}
+
+void
+disk_cache_wait_for_idle(struct disk_cache *cache)
+{
+   if (!cache->path_init_failed)
+      util_queue_finish(&cache->cache_queue);
+}
+
 void
 disk_cache_put_key(struct disk_cache *cache, const cache_key key)
 {
@@ -32,6 +32,7 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <sys/stat.h>
 #include "util/mesa-sha1.h"
 
@@ -53,6 +54,27 @@ typedef uint8_t cache_key[CACHE_KEY_SIZE];
 #define CACHE_ITEM_TYPE_UNKNOWN  0x0
 #define CACHE_ITEM_TYPE_GLSL     0x1
 
+/* Activity of a disk_cache object since it was created. */
+struct disk_cache_stats {
+   uint64_t hits;
+   /* Hits served by the in-memory cache, included in hits. */
+   uint64_t memory_hits;
+   uint64_t misses;
+   uint64_t puts;
+   uint64_t evictions;
+
+   /* Uncompressed sizes of the items returned and stored. */
+   uint64_t bytes_read;
+   uint64_t bytes_written;
+
+   /* On-disk size of the evicted items. */
+   uint64_t bytes_evicted;
+
+   /* On-disk size of the whole cache, shared by all processes. */
+   uint64_t size;
+   uint64_t max_size;
+};
+
 typedef void
 (*disk_cache_put_cb) (const void *key, signed long keySize,
                       const void *value, signed long valueSize);
@@ -210,6 +232,32 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
 void *
 disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size);
 
+/**
+ * Start loading the items named by the \num_keys \keys from disk, in the
+ * background, so that later disk_cache_get() calls for them are served
+ * from memory.
+ *
+ * Items are kept in memory up to MESA_DISK_CACHE_MEMORY_SIZE bytes, least
+ * recently used first out.  Items that aren't in the cache are skipped.
+ */
+void
+disk_cache_prefetch(struct disk_cache *cache, const cache_key *keys,
+                    unsigned num_keys);
+
+/**
+ * Wait until all the pending disk_cache_put() and disk_cache_prefetch()
+ * work is done.
+ */
+void
+disk_cache_wait_for_idle(struct disk_cache *cache);
+
+/**
+ * Get the hit, miss and eviction counts of \cache, and the current size of
+ * the cache on disk.
+ */
+void
+disk_cache_get_stats(struct disk_cache *cache, struct disk_cache_stats *stats);
+
 /**
  * Store the name \key within the cache, (without any associated data).
  *
@@ -280,6 +328,25 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
    return NULL;
 }
 
+static inline void
+disk_cache_prefetch(struct disk_cache *cache, const cache_key *keys,
+                    unsigned num_keys)
+{
+   return;
+}
+
+static inline void
+disk_cache_wait_for_idle(struct disk_cache *cache)
+{
+   return;
+}
+
+static inline void
+disk_cache_get_stats(struct disk_cache *cache, struct disk_cache_stats *stats)
+{
+   memset(stats, 0, sizeof(*stats));
+}
+
 static inline void
 disk_cache_put_key(struct disk_cache *cache, const cache_key key)
 {
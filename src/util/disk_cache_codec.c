@@ -0,0 +1,243 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "zlib.h"
+
+#ifdef HAVE_ZSTD
+#include "zstd.h"
+#endif
+
+#ifdef HAVE_LZ4
+#include "lz4.h"
+#endif
+
+#include "util/macros.h"
+
+#include "disk_cache_codec.h"
+
+/* On shader binaries, level 1 output is about 5% larger than what zlib's
+ * best compression gives, but it is produced an order of magnitude faster.
+ */
+#define ZSTD_COMPRESSION_LEVEL 1
+
+static const char *const codec_names[] = {
+   [DISK_CACHE_CODEC_NONE] = "none",
+   [DISK_CACHE_CODEC_ZLIB] = "zlib",
+   [DISK_CACHE_CODEC_ZSTD] = "zstd",
+   [DISK_CACHE_CODEC_LZ4]  = "lz4",
+};
+
+const char *
+disk_cache_codec_name(enum disk_cache_codec codec)
+{
+   if (codec >= ARRAY_SIZE(codec_names))
+      return "unknown";
+   return codec_names[codec];
+}
+
+bool
+disk_cache_codec_supported(enum disk_cache_codec codec)
+{
+   switch (codec) {
+   case DISK_CACHE_CODEC_NONE:
+   case DISK_CACHE_CODEC_ZLIB:
+      return true;
+#ifdef HAVE_ZSTD
+   case DISK_CACHE_CODEC_ZSTD:
+      return true;
+#endif
+#ifdef HAVE_LZ4
+   case DISK_CACHE_CODEC_LZ4:
+      return true;
+#endif
+   default:
+      return false;
+   }
+}
+
+enum disk_cache_codec
+disk_cache_codec_from_env(void)
+{
+   const char *name = getenv("MESA_DISK_CACHE_CODEC");
+
+   if (!name)
+      return DISK_CACHE_DEFAULT_CODEC;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(codec_names); i++) {
+      if (strcmp(name, codec_names[i]) == 0) {
+         if (disk_cache_codec_supported(i))
+            return i;
+         break;
+      }
+   }
+
+   fprintf(stderr, "MESA_DISK_CACHE_CODEC=%s is not supported, using %s\n",
+           name, codec_names[DISK_CACHE_DEFAULT_CODEC]);
+   return DISK_CACHE_DEFAULT_CODEC;
+}
+
+size_t
+disk_cache_compress_bound(enum disk_cache_codec codec, size_t size)
+{
+   switch (codec) {
+   case DISK_CACHE_CODEC_NONE:
+      return size;
+   case DISK_CACHE_CODEC_ZLIB:
+      return compressBound(size);
+#ifdef HAVE_ZSTD
+   case DISK_CACHE_CODEC_ZSTD:
+      return ZSTD_compressBound(size);
+#endif
+#ifdef HAVE_LZ4
+   case DISK_CACHE_CODEC_LZ4:
+      if (size > LZ4_MAX_INPUT_SIZE)
+         return 0;
+      return LZ4_compressBound(size);
+#endif
+   default:
+      return 0;
+   }
+}
+
+size_t
+disk_cache_compress(enum disk_cache_codec codec,
+                    const void *in_data, size_t in_data_size,
+                    void *out_data, size_t out_data_size)
+{
+   switch (codec) {
+   case DISK_CACHE_CODEC_NONE:
+      if (in_data_size > out_data_size)
+         return 0;
+      memcpy(out_data, in_data, in_data_size);
+      return in_data_size;
+
+   case DISK_CACHE_CODEC_ZLIB: {
+      uLongf size = out_data_size;
+      if (compress2(out_data, &size, in_data, in_data_size,
+                    Z_BEST_COMPRESSION) != Z_OK)
+         return 0;
+      return size;
+   }
+
+#ifdef HAVE_ZSTD
+   case DISK_CACHE_CODEC_ZSTD: {
+      size_t size = ZSTD_compress(out_data, out_data_size,
+                                  in_data, in_data_size,
+                                  ZSTD_COMPRESSION_LEVEL);
+      if (ZSTD_isError(size))
+         return 0;
+      return size;
+   }
+#endif
+
+#ifdef HAVE_LZ4
+   case DISK_CACHE_CODEC_LZ4: {
+      if (in_data_size > LZ4_MAX_INPUT_SIZE)
+         return 0;
+      int size = LZ4_compress_default(in_data, out_data, in_data_size,
+                                      MIN2(out_data_size, INT_MAX));
+      return size > 0 ? size : 0;
+   }
+#endif
+
+   default:
+      return 0;
+   }
+}
+
+static bool
+inflate_data(const void *in_data, size_t in_data_size,
+             void *out_data, size_t out_data_size)
+{
+   z_stream strm;
+
+   /* allocate inflate state */
+   strm.zalloc = Z_NULL;
+   strm.zfree = Z_NULL;
+   strm.opaque = Z_NULL;
+   strm.next_in = (uint8_t *) in_data;
+   strm.avail_in = in_data_size;
+   strm.next_out = out_data;
+   strm.avail_out = out_data_size;
+
+   int ret = inflateInit(&strm);
+   if (ret != Z_OK)
+      return false;
+
+   ret = inflate(&strm, Z_NO_FLUSH);
+   assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+
+   /* Unless there was an error we should have decompressed everything in one
+    * go as we know the uncompressed file size.
+    */
+   if (ret != Z_STREAM_END) {
+      (void)inflateEnd(&strm);
+      return false;
+   }
+   assert(strm.avail_out == 0);
+
+   /* clean up and return */
+   (void)inflateEnd(&strm);
+   return true;
+}
+
+bool
+disk_cache_decompress(enum disk_cache_codec codec,
+                      const void *in_data, size_t in_data_size,
+                      void *out_data, size_t out_data_size)
+{
+   switch (codec) {
+   case DISK_CACHE_CODEC_NONE:
+      if (in_data_size != out_data_size)
+         return false;
+      memcpy(out_data, in_data, in_data_size);
+      return true;
+
+   case DISK_CACHE_CODEC_ZLIB:
+      return inflate_data(in_data, in_data_size, out_data, out_data_size);
+
+#ifdef HAVE_ZSTD
+   case DISK_CACHE_CODEC_ZSTD:
+      return ZSTD_decompress(out_data, out_data_size,
+                             in_data, in_data_size) == out_data_size;
+#endif
+
+#ifdef HAVE_LZ4
+   case DISK_CACHE_CODEC_LZ4:
+      if (in_data_size > INT_MAX || out_data_size > INT_MAX)
+         return false;
+      return LZ4_decompress_safe(in_data, out_data, in_data_size,
+                                 out_data_size) == (int) out_data_size;
+#endif
+
+   default:
+      return false;
+   }
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Compression of disk_cache entries.
+ *
+ * The codec used is recorded in every entry, so entries written with any
+ * supported codec can be read back whatever the current default is.  zlib
+ * is always available; zstd and LZ4 depend on the build.
+ */
+
+#ifndef DISK_CACHE_CODEC_H
+#define DISK_CACHE_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* These values are stored in the cache entries, don't change them. */
+enum disk_cache_codec {
+   DISK_CACHE_CODEC_NONE = 0,
+   DISK_CACHE_CODEC_ZLIB = 1,
+   DISK_CACHE_CODEC_ZSTD = 2,
+   DISK_CACHE_CODEC_LZ4  = 3,
+   DISK_CACHE_CODEC_COUNT,
+};
+
+/* Picked with the shader-cache-codec build option. */
+#ifndef DISK_CACHE_DEFAULT_CODEC
+#define DISK_CACHE_DEFAULT_CODEC DISK_CACHE_CODEC_ZLIB
+#endif
+
+const char *
+disk_cache_codec_name(enum disk_cache_codec codec);
+
+bool
+disk_cache_codec_supported(enum disk_cache_codec codec);
+
+/**
+ * The codec named by the MESA_DISK_CACHE_CODEC environment variable
+ * ("none", "zlib", "zstd" or "lz4"), or the build default.
+ */
+enum disk_cache_codec
+disk_cache_codec_from_env(void);
+
+/**
+ * Largest size \size bytes can compress to.
+ */
+size_t
+disk_cache_compress_bound(enum disk_cache_codec codec, size_t size);
+
+/**
+ * Compress \in_size bytes of \in_data into \out_data.
+ *
+ * \return The compressed size, or 0 on failure.
+ */
+size_t
+disk_cache_compress(enum disk_cache_codec codec,
+                    const void *in_data, size_t in_data_size,
+                    void *out_data, size_t out_data_size);
+
+/**
+ * Decompress \in_data, which must decompress to exactly \out_data_size
+ * bytes.
+ */
+bool
+disk_cache_decompress(enum disk_cache_codec codec,
+                      const void *in_data, size_t in_data_size,
+                      void *out_data, size_t out_data_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISK_CACHE_CODEC_H */
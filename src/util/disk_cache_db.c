@@ -0,0 +1,756 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifdef ENABLE_SHADER_CACHE
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "util/hash_table.h"
+#include "util/macros.h"
+#include "util/ralloc.h"
+#include "util/simple_mtx.h"
+
+#include "disk_cache_db.h"
+
+/* Bump the version whenever the layout of the file or of its entries
+ * changes.  Files with another version are thrown away.
+ */
+#define DISK_CACHE_DB_MAGIC "MESA_DB"
+#define DISK_CACHE_DB_VERSION 1
+
+#define DISK_CACHE_DB_ENTRY_MAGIC 0x4d444245
+
+/* Entry flags: the codec is stored in the low byte. */
+#define DISK_CACHE_DB_ENTRY_CODEC_MASK 0xff
+#define DISK_CACHE_DB_ENTRY_REMOVED    (1u << 31)
+
+/* Size of the first mapping of the file, later ones double in size. */
+#define DISK_CACHE_DB_MIN_MAP_SIZE (1024 * 1024)
+
+struct disk_cache_db_file_header {
+   char magic[8];
+   uint32_t version;
+   uint32_t pad;
+};
+
+/* Each entry is this header followed by the payload, padded to 8 bytes. */
+struct disk_cache_db_entry_header {
+   uint32_t magic;
+   uint32_t flags;
+   uint32_t size;
+   uint32_t uncompressed_size;
+   uint32_t crc32;
+   uint8_t key[CACHE_KEY_SIZE];
+};
+
+struct disk_cache_db_mapping {
+   struct disk_cache_db_mapping *next;
+   void *map;
+   size_t size;
+};
+
+struct disk_cache_db {
+   char *path;
+   char *tmp_path;
+   uint64_t max_size;
+
+   /* Protects everything below.  disk_cache_get() runs on the application
+    * threads, disk_cache_put() on the cache queue thread.
+    */
+   simple_mtx_t mutex;
+
+   int fd;
+   dev_t dev;
+   ino_t ino;
+
+   /* Read-only shared mapping of the file, which may be larger than the
+    * file itself.  Everything in the index points into it.
+    */
+   uint8_t *map;
+   size_t map_size;
+
+   /* Earlier mappings, kept around while disk_cache_db_get() may have
+    * handed out pointers into them.
+    */
+   struct disk_cache_db_mapping *old_mappings;
+
+   /* Entries returned by disk_cache_db_get() and not released yet. */
+   unsigned num_readers;
+
+   /* End of the last indexed entry. */
+   uint64_t file_size;
+
+   /* Space taken by removed and overwritten entries. */
+   uint64_t dead_size;
+
+   /* cache_key -> struct disk_cache_db_entry_header */
+   struct hash_table *index;
+};
+
+static uint32_t
+key_hash(const void *key)
+{
+   /* Keys are SHA-1 hashes, any 32 bits of them will do. */
+   uint32_t hash;
+   memcpy(&hash, key, sizeof(hash));
+   return hash;
+}
+
+static bool
+key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, CACHE_KEY_SIZE) == 0;
+}
+
+static uint64_t
+entry_total_size(uint32_t size)
+{
+   return (sizeof(struct disk_cache_db_entry_header) + (uint64_t) size + 7) &
+          ~(uint64_t) 7;
+}
+
+static bool
+write_all_at(int fd, const void *buf, size_t count, off_t offset)
+{
+   const uint8_t *in = buf;
+   ssize_t written;
+   size_t done;
+
+   for (done = 0; done < count; done += written) {
+      written = pwrite(fd, in + done, count - done, offset + done);
+      if (written == -1) {
+         if (errno == EINTR) {
+            written = 0;
+            continue;
+         }
+         return false;
+      }
+   }
+   return true;
+}
+
+static void
+retire_mapping(struct disk_cache_db *db)
+{
+   struct disk_cache_db_mapping *old;
+
+   if (!db->map)
+      return;
+
+   /* If this fails, leak the mapping rather than leave dangling pointers
+    * behind.
+    */
+   old = ralloc(db, struct disk_cache_db_mapping);
+   if (old) {
+      old->map = db->map;
+      old->size = db->map_size;
+      old->next = db->old_mappings;
+      db->old_mappings = old;
+   }
+
+   db->map = NULL;
+   db->map_size = 0;
+}
+
+/* Unmap the earlier mappings once no entry handed out can point into them
+ * anymore.
+ */
+static void
+release_old_mappings(struct disk_cache_db *db)
+{
+   struct disk_cache_db_mapping *old, *next;
+
+   if (db->num_readers)
+      return;
+
+   for (old = db->old_mappings; old; old = next) {
+      next = old->next;
+      munmap(old->map, old->size);
+      ralloc_free(old);
+   }
+   db->old_mappings = NULL;
+}
+
+/* Make sure the mapping covers the first \size bytes of the file. */
+static bool
+map_file(struct disk_cache_db *db, uint64_t size)
+{
+   size_t map_size;
+   uint8_t *map;
+
+   if (size <= db->map_size)
+      return true;
+
+   map_size = db->map_size ? db->map_size : DISK_CACHE_DB_MIN_MAP_SIZE;
+   while (map_size < size) {
+      if (map_size > SIZE_MAX / 2)
+         return false;
+      map_size *= 2;
+   }
+
+   /* Mapping past the end of the file is fine as long as we don't touch
+    * those pages, and saves remapping every time the file grows.
+    */
+   map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, db->fd, 0);
+   if (map == MAP_FAILED)
+      return false;
+
+   if (db->map) {
+      /* Move the index over to the new mapping. */
+      hash_table_foreach(db->index, entry) {
+         size_t offset = (const uint8_t *) entry->data - db->map;
+         struct disk_cache_db_entry_header *header =
+            (struct disk_cache_db_entry_header *) (map + offset);
+
+         entry->key = header->key;
+         entry->data = header;
+      }
+      retire_mapping(db);
+   }
+
+   db->map = map;
+   db->map_size = map_size;
+   return true;
+}
+
+static bool
+open_file(struct disk_cache_db *db)
+{
+   struct stat sb;
+   int fd;
+
+   fd = open(db->path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+   if (fd == -1)
+      return false;
+
+   if (fstat(fd, &sb) == -1) {
+      close(fd);
+      return false;
+   }
+
+   if (db->fd != -1)
+      close(db->fd);
+
+   db->fd = fd;
+   db->dev = sb.st_dev;
+   db->ino = sb.st_ino;
+
+   _mesa_hash_table_clear(db->index, NULL);
+   retire_mapping(db);
+   db->file_size = 0;
+   db->dead_size = 0;
+
+   return true;
+}
+
+/* Take a flock on the file, making sure it's still the one in the cache
+ * directory: it might have been replaced by a compaction while we were
+ * waiting for the lock.
+ */
+static bool
+lock_file(struct disk_cache_db *db, int operation)
+{
+   struct stat sb;
+
+   while (true) {
+      if (flock(db->fd, operation) == -1) {
+         if (errno == EINTR)
+            continue;
+         return false;
+      }
+
+      if (stat(db->path, &sb) == 0 &&
+          sb.st_dev == db->dev && sb.st_ino == db->ino)
+         return true;
+
+      flock(db->fd, LOCK_UN);
+      if (!open_file(db))
+         return false;
+   }
+}
+
+static void
+unlock_file(struct disk_cache_db *db)
+{
+   flock(db->fd, LOCK_UN);
+}
+
+/* Whether another process appended to the file or replaced it since we
+ * last looked.
+ */
+static bool
+file_changed(struct disk_cache_db *db)
+{
+   struct stat sb;
+
+   if (stat(db->path, &sb) == -1)
+      return false;
+
+   return sb.st_dev != db->dev || sb.st_ino != db->ino ||
+          (uint64_t) sb.st_size != db->file_size;
+}
+
+static void
+index_entry(struct disk_cache_db *db,
+            const struct disk_cache_db_entry_header *header)
+{
+   uint32_t hash = key_hash(header->key);
+   struct hash_entry *entry =
+      _mesa_hash_table_search_pre_hashed(db->index, hash, header->key);
+   bool removed = header->flags & DISK_CACHE_DB_ENTRY_REMOVED;
+
+   if (entry) {
+      const struct disk_cache_db_entry_header *old = entry->data;
+
+      db->dead_size += entry_total_size(old->size);
+      if (removed) {
+         _mesa_hash_table_remove(db->index, entry);
+      } else {
+         entry->key = header->key;
+         entry->data = (void *) header;
+      }
+   } else if (!removed) {
+      _mesa_hash_table_insert_pre_hashed(db->index, hash, header->key,
+                                         (void *) header);
+   }
+
+   if (removed)
+      db->dead_size += entry_total_size(header->size);
+}
+
+static bool
+replace_file_locked(struct disk_cache_db *db,
+                    const struct disk_cache_db_entry_header **entries,
+                    unsigned count);
+
+/* Index the entries appended since the last call.  Must be called with the
+ * file locked; only an exclusive lock allows fixing the file up.
+ */
+static bool
+refresh_locked(struct disk_cache_db *db, bool exclusive)
+{
+   const struct disk_cache_db_entry_header *header;
+   struct stat sb;
+   uint64_t size, offset;
+
+   if (fstat(db->fd, &sb) == -1)
+      return false;
+   size = sb.st_size;
+
+   if (db->file_size == 0) {
+      struct disk_cache_db_file_header file_header;
+
+      if (size == 0) {
+         if (!exclusive)
+            return false;
+
+         memset(&file_header, 0, sizeof(file_header));
+         memcpy(file_header.magic, DISK_CACHE_DB_MAGIC,
+                sizeof(DISK_CACHE_DB_MAGIC));
+         file_header.version = DISK_CACHE_DB_VERSION;
+         if (!write_all_at(db->fd, &file_header, sizeof(file_header), 0))
+            return false;
+         size = sizeof(file_header);
+      } else if (size < sizeof(file_header) ||
+                 pread(db->fd, &file_header, sizeof(file_header), 0) !=
+                 (ssize_t) sizeof(file_header) ||
+                 memcmp(file_header.magic, DISK_CACHE_DB_MAGIC,
+                        sizeof(DISK_CACHE_DB_MAGIC)) != 0 ||
+                 file_header.version != DISK_CACHE_DB_VERSION) {
+         /* Written by another version of Mesa, start over.  Other processes
+          * may still be reading it, so it has to be replaced rather than
+          * truncated.
+          */
+         if (!exclusive)
+            return false;
+         return replace_file_locked(db, NULL, 0);
+      }
+
+      db->file_size = sizeof(file_header);
+   }
+
+   if (size == db->file_size)
+      return true;
+
+   /* Only the end of the file past the last complete entry is ever
+    * truncated, so this can't happen unless someone else messed with it.
+    */
+   if (size < db->file_size)
+      return false;
+
+   if (!map_file(db, size))
+      return false;
+
+   offset = db->file_size;
+   while (size - offset >= sizeof(*header)) {
+      header = (const struct disk_cache_db_entry_header *) (db->map + offset);
+
+      if (header->magic != DISK_CACHE_DB_ENTRY_MAGIC ||
+          entry_total_size(header->size) > size - offset)
+         break;
+
+      index_entry(db, header);
+      offset += entry_total_size(header->size);
+   }
+   db->file_size = offset;
+
+   /* Anything left is from a process that died while appending. */
+   if (offset != size && exclusive) {
+      if (ftruncate(db->fd, offset) == -1)
+         return false;
+   }
+
+   return true;
+}
+
+static bool
+append_locked(struct disk_cache_db *db,
+              const struct disk_cache_db_entry_header *header,
+              const void *data)
+{
+   static const uint8_t zeros[8];
+   uint64_t offset = db->file_size;
+   size_t pad = entry_total_size(header->size) - sizeof(*header) -
+                header->size;
+
+   if (!write_all_at(db->fd, header, sizeof(*header), offset) ||
+       !write_all_at(db->fd, data, header->size, offset + sizeof(*header)) ||
+       !write_all_at(db->fd, zeros, pad,
+                     offset + sizeof(*header) + header->size)) {
+      /* If this fails too, the next writer drops the torn entry. */
+      MAYBE_UNUSED int ret = ftruncate(db->fd, offset);
+      return false;
+   }
+
+   return refresh_locked(db, true);
+}
+
+static int
+compare_entry_offset(const void *a, const void *b)
+{
+   uintptr_t entry_a = (uintptr_t) *(const void **) a;
+   uintptr_t entry_b = (uintptr_t) *(const void **) b;
+
+   return entry_a < entry_b ? -1 : entry_a > entry_b;
+}
+
+/* Write \entries to a new file, rename it over the current one and switch
+ * over to it.  Called, and returns, with the file locked exclusively.
+ */
+static bool
+replace_file_locked(struct disk_cache_db *db,
+                    const struct disk_cache_db_entry_header **entries,
+                    unsigned count)
+{
+   struct disk_cache_db_file_header file_header;
+   uint64_t offset;
+   bool ok;
+   int fd;
+
+   fd = open(db->tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+   if (fd == -1)
+      return false;
+
+   memset(&file_header, 0, sizeof(file_header));
+   memcpy(file_header.magic, DISK_CACHE_DB_MAGIC, sizeof(DISK_CACHE_DB_MAGIC));
+   file_header.version = DISK_CACHE_DB_VERSION;
+
+   ok = write_all_at(fd, &file_header, sizeof(file_header), 0);
+   offset = sizeof(file_header);
+
+   for (unsigned i = 0; ok && i < count; i++) {
+      uint64_t size = entry_total_size(entries[i]->size);
+
+      ok = write_all_at(fd, entries[i], size, offset);
+      offset += size;
+   }
+
+   close(fd);
+
+   if (!ok || rename(db->tmp_path, db->path) == -1) {
+      unlink(db->tmp_path);
+      return false;
+   }
+
+   /* Processes waiting for the lock on the old file will notice it was
+    * replaced and reopen it, like we do here.
+    */
+   if (!open_file(db))
+      return false;
+
+   return lock_file(db, LOCK_EX) && refresh_locked(db, true);
+}
+
+static bool
+needs_compaction_locked(struct disk_cache_db *db)
+{
+   return db->file_size > db->max_size ||
+          (db->file_size > DISK_CACHE_DB_MIN_MAP_SIZE &&
+           db->dead_size > db->file_size / 2);
+}
+
+struct disk_cache_db *
+disk_cache_db_open(void *mem_ctx, const char *dir, uint64_t max_size)
+{
+   struct disk_cache_db *db;
+   bool ok;
+
+   db = rzalloc(mem_ctx, struct disk_cache_db);
+   if (!db)
+      return NULL;
+
+   db->fd = -1;
+   db->max_size = max_size;
+   simple_mtx_init(&db->mutex, mtx_plain);
+
+   db->path = ralloc_asprintf(db, "%s/%s", dir, DISK_CACHE_DB_FILE_NAME);
+   db->tmp_path = ralloc_asprintf(db, "%s.tmp", db->path);
+   db->index = _mesa_hash_table_create(db, key_hash, key_equal);
+   if (!db->path || !db->tmp_path || !db->index)
+      goto fail;
+
+   if (!open_file(db) || !lock_file(db, LOCK_EX))
+      goto fail;
+
+   ok = refresh_locked(db, true);
+   unlock_file(db);
+   if (!ok)
+      goto fail;
+
+   return db;
+
+ fail:
+   disk_cache_db_close(db);
+   return NULL;
+}
+
+void
+disk_cache_db_close(struct disk_cache_db *db)
+{
+   if (!db)
+      return;
+
+   if (db->map)
+      munmap(db->map, db->map_size);
+   for (struct disk_cache_db_mapping *old = db->old_mappings; old;
+        old = old->next)
+      munmap(old->map, old->size);
+
+   if (db->fd != -1)
+      close(db->fd);
+
+   simple_mtx_destroy(&db->mutex);
+   ralloc_free(db);
+}
+
+bool
+disk_cache_db_put(struct disk_cache_db *db, const cache_key key,
+                  enum disk_cache_codec codec, uint32_t crc32,
+                  uint32_t uncompressed_size,
+                  const void *data, size_t size)
+{
+   struct disk_cache_db_entry_header header;
+   bool ret = false;
+
+   if (size > UINT32_MAX)
+      return false;
+
+   memset(&header, 0, sizeof(header));
+   header.magic = DISK_CACHE_DB_ENTRY_MAGIC;
+   header.flags = codec & DISK_CACHE_DB_ENTRY_CODEC_MASK;
+   header.size = size;
+   header.uncompressed_size = uncompressed_size;
+   header.crc32 = crc32;
+   memcpy(header.key, key, CACHE_KEY_SIZE);
+
+   simple_mtx_lock(&db->mutex);
+
+   release_old_mappings(db);
+
+   if (lock_file(db, LOCK_EX)) {
+      if (refresh_locked(db, true)) {
+         ret = _mesa_hash_table_search(db->index, key) != NULL ||
+               append_locked(db, &header, data);
+      }
+      unlock_file(db);
+   }
+
+   simple_mtx_unlock(&db->mutex);
+
+   return ret;
+}
+
+bool
+disk_cache_db_get(struct disk_cache_db *db, const cache_key key,
+                  struct disk_cache_db_entry *entry)
+{
+   const struct disk_cache_db_entry_header *header = NULL;
+   struct hash_entry *hash_entry;
+
+   simple_mtx_lock(&db->mutex);
+
+   hash_entry = _mesa_hash_table_search(db->index, key);
+   if (!hash_entry && file_changed(db)) {
+      if (lock_file(db, LOCK_SH)) {
+         refresh_locked(db, false);
+         unlock_file(db);
+      }
+      hash_entry = _mesa_hash_table_search(db->index, key);
+   }
+
+   if (hash_entry) {
+      header = hash_entry->data;
+
+      entry->data = header + 1;
+      entry->size = header->size;
+      entry->codec = header->flags & DISK_CACHE_DB_ENTRY_CODEC_MASK;
+      entry->uncompressed_size = header->uncompressed_size;
+      entry->crc32 = header->crc32;
+      db->num_readers++;
+   }
+
+   simple_mtx_unlock(&db->mutex);
+
+   return header != NULL;
+}
+
+void
+disk_cache_db_release(struct disk_cache_db *db)
+{
+   simple_mtx_lock(&db->mutex);
+   assert(db->num_readers > 0);
+   db->num_readers--;
+   simple_mtx_unlock(&db->mutex);
+}
+
+void
+disk_cache_db_remove(struct disk_cache_db *db, const cache_key key)
+{
+   struct disk_cache_db_entry_header header;
+
+   memset(&header, 0, sizeof(header));
+   header.magic = DISK_CACHE_DB_ENTRY_MAGIC;
+   header.flags = DISK_CACHE_DB_ENTRY_REMOVED;
+   memcpy(header.key, key, CACHE_KEY_SIZE);
+
+   simple_mtx_lock(&db->mutex);
+
+   release_old_mappings(db);
+
+   if (lock_file(db, LOCK_EX)) {
+      if (refresh_locked(db, true) &&
+          _mesa_hash_table_search(db->index, key))
+         append_locked(db, &header, NULL);
+      unlock_file(db);
+   }
+
+   simple_mtx_unlock(&db->mutex);
+}
+
+bool
+disk_cache_db_needs_compaction(struct disk_cache_db *db)
+{
+   bool ret;
+
+   simple_mtx_lock(&db->mutex);
+   ret = needs_compaction_locked(db);
+   simple_mtx_unlock(&db->mutex);
+
+   return ret;
+}
+
+unsigned
+disk_cache_db_compact(struct disk_cache_db *db)
+{
+   const struct disk_cache_db_entry_header **entries;
+   uint64_t live_size, target_size;
+   unsigned count, first = 0;
+
+   simple_mtx_lock(&db->mutex);
+
+   release_old_mappings(db);
+
+   if (!lock_file(db, LOCK_EX))
+      goto out;
+
+   /* Another process may have compacted the file already. */
+   if (!refresh_locked(db, true) || !needs_compaction_locked(db))
+      goto unlock;
+
+   count = db->index->entries;
+   entries = malloc(MAX2(count, 1) * sizeof(*entries));
+   if (!entries)
+      goto unlock;
+
+   count = 0;
+   live_size = sizeof(struct disk_cache_db_file_header);
+   hash_table_foreach(db->index, entry) {
+      entries[count++] = entry->data;
+      live_size += entry_total_size(((const struct disk_cache_db_entry_header *)
+                                     entry->data)->size);
+   }
+
+   /* Entries are appended, so the order in the file is the order in which
+    * they were added.  Keep the newest ones.
+    */
+   qsort(entries, count, sizeof(*entries), compare_entry_offset);
+
+   target_size = db->max_size / 4 * 3;
+   for (first = 0; first < count && live_size > target_size; first++)
+      live_size -= entry_total_size(entries[first]->size);
+
+   if (!replace_file_locked(db, entries + first, count - first))
+      first = 0;
+   free(entries);
+
+ unlock:
+   unlock_file(db);
+ out:
+   simple_mtx_unlock(&db->mutex);
+
+   return first;
+}
+
+uint64_t
+disk_cache_db_size(struct disk_cache_db *db)
+{
+   uint64_t size;
+
+   simple_mtx_lock(&db->mutex);
+   size = db->file_size;
+   simple_mtx_unlock(&db->mutex);
+
+   return size;
+}
+
+#endif /* ENABLE_SHADER_CACHE */
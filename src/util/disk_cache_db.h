@@ -0,0 +1,142 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Single file storage backend for disk_cache.
+ *
+ * All the entries of the cache are appended to one file, which every
+ * process using the cache maps read-only.  An in-memory hash table maps
+ * each cache key to its entry in the mapping, and is brought up to date
+ * with whatever other processes appended whenever a lookup misses.
+ *
+ * Appending takes an exclusive flock on the file, scanning it a shared
+ * one.  Removing an entry appends a tombstone.  Compaction writes the live
+ * entries to a new file and renames it over the old one, so processes
+ * that still have the old file mapped keep using it until they notice
+ * the new one.  Replaced mappings are released by the next put, remove
+ * or compaction once every entry handed out by disk_cache_db_get() has
+ * been released with disk_cache_db_release().
+ */
+
+#ifndef DISK_CACHE_DB_H
+#define DISK_CACHE_DB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "disk_cache.h"
+#include "disk_cache_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef ENABLE_SHADER_CACHE
+
+#define DISK_CACHE_DB_FILE_NAME "mesa_cache.db"
+
+struct disk_cache_db;
+
+struct disk_cache_db_entry {
+   /* Stored payload, pointing into the mapped file. */
+   const void *data;
+   uint32_t size;
+
+   enum disk_cache_codec codec;
+   uint32_t uncompressed_size;
+
+   /* CRC32 of the uncompressed data. */
+   uint32_t crc32;
+};
+
+/**
+ * Open (or create) the database file in directory \dir.  The file is
+ * compacted when it grows larger than \max_size bytes.
+ *
+ * Returns NULL on failure, in which case the caller should fall back to
+ * the one-file-per-entry layout.
+ */
+struct disk_cache_db *
+disk_cache_db_open(void *mem_ctx, const char *dir, uint64_t max_size);
+
+void
+disk_cache_db_close(struct disk_cache_db *db);
+
+/**
+ * Append an entry.  Nothing is written if another process already stored
+ * \key in the meantime.
+ */
+bool
+disk_cache_db_put(struct disk_cache_db *db, const cache_key key,
+                  enum disk_cache_codec codec, uint32_t crc32,
+                  uint32_t uncompressed_size,
+                  const void *data, size_t size);
+
+/**
+ * Look \key up.  On success, \entry points directly at the stored payload,
+ * which stays valid until disk_cache_db_release() is called.
+ */
+bool
+disk_cache_db_get(struct disk_cache_db *db, const cache_key key,
+                  struct disk_cache_db_entry *entry);
+
+/**
+ * Release an entry returned by disk_cache_db_get().
+ */
+void
+disk_cache_db_release(struct disk_cache_db *db);
+
+void
+disk_cache_db_remove(struct disk_cache_db *db, const cache_key key);
+
+/**
+ * Whether the file has grown past its maximum size, or is mostly made of
+ * removed and overwritten entries.
+ */
+bool
+disk_cache_db_needs_compaction(struct disk_cache_db *db);
+
+/**
+ * Rewrite the file with only its live entries, dropping the oldest ones
+ * if they don't fit in 3/4 of the maximum size.  This can take a while,
+ * disk_cache calls it from its queue thread.
+ *
+ * \return The number of entries dropped.
+ */
+unsigned
+disk_cache_db_compact(struct disk_cache_db *db);
+
+/**
+ * Size of the file, as of the last time it was scanned.
+ */
+uint64_t
+disk_cache_db_size(struct disk_cache_db *db);
+
+#endif /* ENABLE_SHADER_CACHE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISK_CACHE_DB_H */
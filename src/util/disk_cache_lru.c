@@ -0,0 +1,465 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifdef ENABLE_SHADER_CACHE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "util/crc32.h"
+#include "util/hash_table.h"
+#include "util/macros.h"
+#include "util/ralloc.h"
+#include "util/simple_mtx.h"
+
+#include "disk_cache_lru.h"
+
+/* Bump the version whenever the layout of the saved index changes.  Files
+ * with another version are ignored.
+ */
+#define DISK_CACHE_LRU_MAGIC "MESA_LRU"
+#define DISK_CACHE_LRU_VERSION 1
+
+/* The saved index is this header followed by \count entries. */
+struct disk_cache_lru_file_header {
+   char magic[8];
+   uint32_t version;
+   uint32_t count;
+   /* CRC32 of the entries. */
+   uint32_t crc32;
+   uint32_t pad;
+};
+
+struct disk_cache_lru_file_entry {
+   uint8_t key[CACHE_KEY_SIZE];
+   uint32_t hits;
+   uint64_t size;
+   int64_t atime;
+};
+
+struct disk_cache_lru_node {
+   cache_key key;
+   unsigned heap_index;
+   uint32_t hits;
+   uint64_t size;
+   int64_t atime;
+
+   /* Breaks ties between entries accessed within the same second. */
+   uint64_t seq;
+};
+
+struct disk_cache_lru {
+   enum disk_cache_eviction policy;
+
+   simple_mtx_t mutex;
+
+   struct hash_table *index;
+
+   /* Min-heap, the next entry to evict first. */
+   struct disk_cache_lru_node **heap;
+   unsigned heap_size;
+   unsigned heap_capacity;
+
+   uint64_t seq;
+};
+
+static uint32_t
+key_hash(const void *key)
+{
+   uint32_t hash;
+   memcpy(&hash, key, sizeof(hash));
+   return hash;
+}
+
+static bool
+key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, CACHE_KEY_SIZE) == 0;
+}
+
+static bool
+node_before(const struct disk_cache_lru *lru,
+            const struct disk_cache_lru_node *a,
+            const struct disk_cache_lru_node *b)
+{
+   if (lru->policy == DISK_CACHE_EVICTION_LFU && a->hits != b->hits)
+      return a->hits < b->hits;
+   if (a->atime != b->atime)
+      return a->atime < b->atime;
+   return a->seq < b->seq;
+}
+
+static void
+heap_set(struct disk_cache_lru *lru, unsigned i,
+         struct disk_cache_lru_node *node)
+{
+   lru->heap[i] = node;
+   node->heap_index = i;
+}
+
+static void
+sift_up(struct disk_cache_lru *lru, unsigned i)
+{
+   struct disk_cache_lru_node *node = lru->heap[i];
+
+   while (i > 0) {
+      unsigned parent = (i - 1) / 2;
+      if (!node_before(lru, node, lru->heap[parent]))
+         break;
+      heap_set(lru, i, lru->heap[parent]);
+      i = parent;
+   }
+   heap_set(lru, i, node);
+}
+
+static void
+sift_down(struct disk_cache_lru *lru, unsigned i)
+{
+   struct disk_cache_lru_node *node = lru->heap[i];
+
+   while (true) {
+      unsigned child = 2 * i + 1;
+      if (child >= lru->heap_size)
+         break;
+      if (child + 1 < lru->heap_size &&
+          node_before(lru, lru->heap[child + 1], lru->heap[child]))
+         child++;
+      if (!node_before(lru, lru->heap[child], node))
+         break;
+      heap_set(lru, i, lru->heap[child]);
+      i = child;
+   }
+   heap_set(lru, i, node);
+}
+
+/* Restore the heap order after \node's sort key changed. */
+static void
+reorder(struct disk_cache_lru *lru, struct disk_cache_lru_node *node)
+{
+   sift_up(lru, node->heap_index);
+   sift_down(lru, node->heap_index);
+}
+
+struct disk_cache_lru *
+disk_cache_lru_create(void *mem_ctx, enum disk_cache_eviction policy)
+{
+   struct disk_cache_lru *lru = rzalloc(mem_ctx, struct disk_cache_lru);
+   if (!lru)
+      return NULL;
+
+   lru->policy = policy;
+   lru->index = _mesa_hash_table_create(lru, key_hash, key_equal);
+   if (!lru->index) {
+      ralloc_free(lru);
+      return NULL;
+   }
+
+   simple_mtx_init(&lru->mutex, mtx_plain);
+
+   return lru;
+}
+
+void
+disk_cache_lru_destroy(struct disk_cache_lru *lru)
+{
+   if (!lru)
+      return;
+
+   for (unsigned i = 0; i < lru->heap_size; i++)
+      free(lru->heap[i]);
+   free(lru->heap);
+
+   simple_mtx_destroy(&lru->mutex);
+   ralloc_free(lru);
+}
+
+/* Add \key, or merge what we know about it if it is there already. */
+static void
+add_locked(struct disk_cache_lru *lru, const cache_key key,
+           uint64_t size, int64_t atime, uint32_t hits)
+{
+   struct disk_cache_lru_node *node;
+   struct hash_entry *entry;
+
+   entry = _mesa_hash_table_search(lru->index, key);
+   if (entry) {
+      node = entry->data;
+      node->size = size;
+      if (atime > node->atime || hits > node->hits) {
+         node->atime = MAX2(node->atime, atime);
+         node->hits = MAX2(node->hits, hits);
+         node->seq = ++lru->seq;
+         sift_down(lru, node->heap_index);
+      }
+      return;
+   }
+
+   if (lru->heap_size == lru->heap_capacity) {
+      unsigned capacity = MAX2(lru->heap_capacity * 2, 64);
+      struct disk_cache_lru_node **heap =
+         realloc(lru->heap, capacity * sizeof(*heap));
+      if (!heap)
+         return;
+      lru->heap = heap;
+      lru->heap_capacity = capacity;
+   }
+
+   node = calloc(1, sizeof(*node));
+   if (!node)
+      return;
+
+   memcpy(node->key, key, CACHE_KEY_SIZE);
+   node->size = size;
+   node->atime = atime;
+   node->hits = hits;
+   node->seq = ++lru->seq;
+
+   if (!_mesa_hash_table_insert(lru->index, node->key, node)) {
+      free(node);
+      return;
+   }
+
+   heap_set(lru, lru->heap_size++, node);
+   sift_up(lru, node->heap_index);
+}
+
+void
+disk_cache_lru_add(struct disk_cache_lru *lru, const cache_key key,
+                   uint64_t size, int64_t atime)
+{
+   simple_mtx_lock(&lru->mutex);
+   add_locked(lru, key, size, atime, 0);
+   simple_mtx_unlock(&lru->mutex);
+}
+
+void
+disk_cache_lru_touch(struct disk_cache_lru *lru, const cache_key key)
+{
+   struct disk_cache_lru_node *node;
+   struct hash_entry *entry;
+
+   simple_mtx_lock(&lru->mutex);
+
+   entry = _mesa_hash_table_search(lru->index, key);
+   if (entry) {
+      node = entry->data;
+      node->hits++;
+      node->atime = MAX2(node->atime, (int64_t) time(NULL));
+      node->seq = ++lru->seq;
+      sift_down(lru, node->heap_index);
+   }
+
+   simple_mtx_unlock(&lru->mutex);
+}
+
+void
+disk_cache_lru_remove(struct disk_cache_lru *lru, const cache_key key)
+{
+   struct disk_cache_lru_node *node, *last;
+   struct hash_entry *entry;
+
+   simple_mtx_lock(&lru->mutex);
+
+   entry = _mesa_hash_table_search(lru->index, key);
+   if (entry) {
+      node = entry->data;
+      _mesa_hash_table_remove(lru->index, entry);
+
+      last = lru->heap[--lru->heap_size];
+      if (last != node) {
+         heap_set(lru, node->heap_index, last);
+         reorder(lru, last);
+      }
+      free(node);
+   }
+
+   simple_mtx_unlock(&lru->mutex);
+}
+
+bool
+disk_cache_lru_next(struct disk_cache_lru *lru, cache_key key,
+                    uint64_t *size, int64_t *atime)
+{
+   bool found = false;
+
+   simple_mtx_lock(&lru->mutex);
+
+   if (lru->heap_size) {
+      memcpy(key, lru->heap[0]->key, CACHE_KEY_SIZE);
+      *size = lru->heap[0]->size;
+      *atime = lru->heap[0]->atime;
+      found = true;
+   }
+
+   simple_mtx_unlock(&lru->mutex);
+
+   return found;
+}
+
+unsigned
+disk_cache_lru_count(struct disk_cache_lru *lru)
+{
+   unsigned count;
+
+   simple_mtx_lock(&lru->mutex);
+   count = lru->heap_size;
+   simple_mtx_unlock(&lru->mutex);
+
+   return count;
+}
+
+/* Read the whole saved index at \path, checking that it is intact. */
+static struct disk_cache_lru_file_entry *
+read_file(const char *path, uint32_t *count)
+{
+   struct disk_cache_lru_file_header header;
+   struct disk_cache_lru_file_entry *entries;
+   size_t size;
+   FILE *file;
+
+   file = fopen(path, "rb");
+   if (!file)
+      return NULL;
+
+   if (fread(&header, sizeof(header), 1, file) != 1 ||
+       memcmp(header.magic, DISK_CACHE_LRU_MAGIC,
+              sizeof(header.magic)) != 0 ||
+       header.version != DISK_CACHE_LRU_VERSION) {
+      fclose(file);
+      return NULL;
+   }
+
+   size = (size_t) header.count * sizeof(*entries);
+   entries = malloc(MAX2(size, 1));
+   if (!entries ||
+       fread(entries, 1, size, file) != size ||
+       fgetc(file) != EOF ||
+       util_hash_crc32(entries, size) != header.crc32) {
+      free(entries);
+      fclose(file);
+      return NULL;
+   }
+
+   fclose(file);
+
+   *count = header.count;
+   return entries;
+}
+
+bool
+disk_cache_lru_load(struct disk_cache_lru *lru, const char *path)
+{
+   struct disk_cache_lru_file_entry *entries;
+   uint32_t count;
+
+   entries = read_file(path, &count);
+   if (!entries)
+      return false;
+
+   simple_mtx_lock(&lru->mutex);
+   for (uint32_t i = 0; i < count; i++) {
+      add_locked(lru, entries[i].key, entries[i].size, entries[i].atime,
+                 entries[i].hits);
+   }
+   simple_mtx_unlock(&lru->mutex);
+
+   free(entries);
+   return true;
+}
+
+bool
+disk_cache_lru_save(struct disk_cache_lru *lru, const char *path, bool merge)
+{
+   struct disk_cache_lru_file_header header;
+   struct disk_cache_lru_file_entry *entries;
+   char *tmp_path;
+   size_t size;
+   bool ok;
+   FILE *file;
+   int fd;
+
+   tmp_path = ralloc_asprintf(NULL, "%s.tmp", path);
+   if (!tmp_path)
+      return false;
+
+   /* Another process is saving its index, ours would only replace it. */
+   fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+   if (fd == -1) {
+      ralloc_free(tmp_path);
+      return false;
+   }
+
+   /* Entries written by other processes since we loaded the index may only
+    * be in the saved copy, keep them.
+    */
+   if (merge)
+      disk_cache_lru_load(lru, path);
+
+   simple_mtx_lock(&lru->mutex);
+
+   size = (size_t) lru->heap_size * sizeof(*entries);
+   entries = calloc(1, MAX2(size, 1));
+   if (entries) {
+      for (unsigned i = 0; i < lru->heap_size; i++) {
+         const struct disk_cache_lru_node *node = lru->heap[i];
+
+         memcpy(entries[i].key, node->key, CACHE_KEY_SIZE);
+         entries[i].hits = node->hits;
+         entries[i].size = node->size;
+         entries[i].atime = node->atime;
+      }
+
+      memset(&header, 0, sizeof(header));
+      memcpy(header.magic, DISK_CACHE_LRU_MAGIC, sizeof(header.magic));
+      header.version = DISK_CACHE_LRU_VERSION;
+      header.count = lru->heap_size;
+      header.crc32 = util_hash_crc32(entries, size);
+   }
+
+   simple_mtx_unlock(&lru->mutex);
+
+   file = entries ? fdopen(fd, "wb") : NULL;
+   if (file) {
+      ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+           fwrite(entries, 1, size, file) == size;
+      ok = fclose(file) == 0 && ok;
+   } else {
+      close(fd);
+      ok = false;
+   }
+
+   if (!ok || rename(tmp_path, path) == -1) {
+      unlink(tmp_path);
+      ok = false;
+   }
+
+   free(entries);
+   ralloc_free(tmp_path);
+   return ok;
+}
+
+#endif /* ENABLE_SHADER_CACHE */
@@ -0,0 +1,121 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Eviction order of the entries of the on-disk cache.
+ *
+ * Every entry the process knows about sits in a binary heap ordered by
+ * last access time, or by number of hits then last access time, so adding,
+ * touching, removing and finding the next entry to evict are all
+ * O(log n).  disk_cache fills it the first time it needs to evict, from
+ * the copy of the index saved in the cache directory, or with a scan of
+ * the cache directory when there is no valid copy.  It then keeps it up
+ * to date with the entries it writes and reads, and saves it back when
+ * it is done with the cache.
+ */
+
+#ifndef DISK_CACHE_LRU_H
+#define DISK_CACHE_LRU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "disk_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef ENABLE_SHADER_CACHE
+
+enum disk_cache_eviction {
+   /* Least recently used first. */
+   DISK_CACHE_EVICTION_LRU,
+   /* Least frequently used first, then least recently used. */
+   DISK_CACHE_EVICTION_LFU,
+};
+
+struct disk_cache_lru;
+
+struct disk_cache_lru *
+disk_cache_lru_create(void *mem_ctx, enum disk_cache_eviction policy);
+
+void
+disk_cache_lru_destroy(struct disk_cache_lru *lru);
+
+/**
+ * Add \key, of \size bytes on disk and last accessed at \atime (in seconds
+ * since the epoch).  If \key is already there, only its size is updated
+ * and its access time moved forward.
+ */
+void
+disk_cache_lru_add(struct disk_cache_lru *lru, const cache_key key,
+                   uint64_t size, int64_t atime);
+
+/**
+ * Record a hit on \key, if it's in the index.
+ */
+void
+disk_cache_lru_touch(struct disk_cache_lru *lru, const cache_key key);
+
+void
+disk_cache_lru_remove(struct disk_cache_lru *lru, const cache_key key);
+
+/**
+ * Find the next entry to evict, without removing it.
+ *
+ * \return false if the index is empty.
+ */
+bool
+disk_cache_lru_next(struct disk_cache_lru *lru, cache_key key,
+                    uint64_t *size, int64_t *atime);
+
+unsigned
+disk_cache_lru_count(struct disk_cache_lru *lru);
+
+#define DISK_CACHE_LRU_FILE_NAME "eviction_index"
+
+/**
+ * Add the entries of the index saved at \path.
+ *
+ * \return false if the file is missing or corrupt.
+ */
+bool
+disk_cache_lru_load(struct disk_cache_lru *lru, const char *path);
+
+/**
+ * Save the index at \path, replacing the file atomically.  With \merge,
+ * the entries already saved there by other processes are kept; without
+ * it, the index is expected to be complete, e.g. after a directory scan.
+ */
+bool
+disk_cache_lru_save(struct disk_cache_lru *lru, const char *path,
+                    bool merge);
+
+#endif /* ENABLE_SHADER_CACHE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISK_CACHE_LRU_H */
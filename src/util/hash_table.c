@@ -596,30 +596,11 @@ _mesa_pointer_hash_table_create(void *mem_ctx)
 }
 
 /**
- * Hash table wrapper which supports 64-bit keys.
+ * Hash table wrapper which supports 64-bit keys, stored inline in an
+ * int_map.
  *
  * TODO: unify all hash table implementations.
  */
-
-struct hash_key_u64 {
-   uint64_t value;
-};
-
-static uint32_t
-key_u64_hash(const void *key)
-{
-   return _mesa_hash_data(key, sizeof(struct hash_key_u64));
-}
-
-static bool
-key_u64_equals(const void *a, const void *b)
-{
-   const struct hash_key_u64 *aa = a;
-   const struct hash_key_u64 *bb = b;
-
-   return aa->value == bb->value;
-}
-
 struct hash_table_u64 *
 _mesa_hash_table_u64_create(void *mem_ctx)
 {
@@ -629,17 +610,11 @@ _mesa_hash_table_u64_create(void *mem_ctx)
    if (!ht)
       return NULL;
 
-   if (sizeof(void *) == 8) {
-      ht->table = _mesa_hash_table_create(mem_ctx, _mesa_hash_pointer,
-                                          _mesa_key_pointer_equal);
-   } else {
-      ht->table = _mesa_hash_table_create(mem_ctx, key_u64_hash,
-                                          key_u64_equals);
+   if (!_mesa_int_map_init(&ht->map, mem_ctx)) {
+      free(ht);
+      return NULL;
    }
 
-   if (ht->table)
-      _mesa_hash_table_set_deleted_key(ht->table, uint_key(DELETED_KEY_VALUE));
-
    return ht;
 }
 
@@ -650,22 +625,20 @@ _mesa_hash_table_u64_destroy(struct hash_table_u64 *ht,
    if (!ht)
       return;
 
-   if (ht->deleted_key_data) {
-      if (delete_function) {
-         struct hash_table *table = ht->table;
-         struct hash_entry deleted_entry;
-
+   if (delete_function) {
+      int_map_foreach(&ht->map, entry) {
          /* Create a fake entry for the delete function. */
-         deleted_entry.hash = table->key_hash_function(table->deleted_key);
-         deleted_entry.key = table->deleted_key;
-         deleted_entry.data = ht->deleted_key_data;
+         struct hash_entry fake_entry = {
+            .hash = entry->key,
+            .key = (void *)(uintptr_t)entry->key,
+            .data = entry->data,
+         };
 
-         delete_function(&deleted_entry);
+         delete_function(&fake_entry);
       }
-      ht->deleted_key_data = NULL;
    }
 
-   _mesa_hash_table_destroy(ht->table, delete_function);
+   _mesa_int_map_fini(&ht->map);
    free(ht);
 }
 
@@ -673,44 +646,14 @@ void
 _mesa_hash_table_u64_insert(struct hash_table_u64 *ht, uint64_t key,
                             void *data)
 {
-   if (key == DELETED_KEY_VALUE) {
-      ht->deleted_key_data = data;
-      return;
-   }
-
-   if (sizeof(void *) == 8) {
-      _mesa_hash_table_insert(ht->table, (void *)(uintptr_t)key, data);
-   } else {
-      struct hash_key_u64 *_key = CALLOC_STRUCT(hash_key_u64);
-
-      if (!_key)
-         return;
-      _key->value = key;
-
-      _mesa_hash_table_insert(ht->table, _key, data);
-   }
-}
-
-static struct hash_entry *
-hash_table_u64_search(struct hash_table_u64 *ht, uint64_t key)
-{
-   if (sizeof(void *) == 8) {
-      return _mesa_hash_table_search(ht->table, (void *)(uintptr_t)key);
-   } else {
-      struct hash_key_u64 _key = { .value = key };
-      return _mesa_hash_table_search(ht->table, &_key);
-   }
+   _mesa_int_map_insert(&ht->map, key, data);
 }
 
 void *
 _mesa_hash_table_u64_search(struct hash_table_u64 *ht, uint64_t key)
 {
-   struct hash_entry *entry;
+   struct int_map_entry *entry = _mesa_int_map_search(&ht->map, key);
 
-   if (key == DELETED_KEY_VALUE)
-      return ht->deleted_key_data;
-
-   entry = hash_table_u64_search(ht, key);
    if (!entry)
       return NULL;
 
@@ -720,23 +663,5 @@ _mesa_hash_table_u64_search(struct hash_table_u64 *ht, uint64_t key)
 void
 _mesa_hash_table_u64_remove(struct hash_table_u64 *ht, uint64_t key)
 {
-   struct hash_entry *entry;
-
-   if (key == DELETED_KEY_VALUE) {
-      ht->deleted_key_data = NULL;
-      return;
-   }
-
-   entry = hash_table_u64_search(ht, key);
-   if (!entry)
-      return;
-
-   if (sizeof(void *) == 8) {
-      _mesa_hash_table_remove(ht->table, entry);
-   } else {
-      struct hash_key *_key = (struct hash_key *)entry->key;
-
-      _mesa_hash_table_remove(ht->table, entry);
-      free(_key);
-   }
+   _mesa_int_map_remove_key(&ht->map, key);
 }
@@ -33,6 +33,7 @@
 #include <stdbool.h>
 #include "c99_compat.h"
 #include "macros.h"
+#include "int_map.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -170,10 +171,13 @@ hash_table_call_foreach(struct hash_table *ht,
 
 /**
  * Hash table wrapper which supports 64-bit keys.
+ *
+ * This is an int_map, which stores the keys inline; the key handed to the
+ * delete function of _mesa_hash_table_u64_destroy() is the 64-bit key cast
+ * to a pointer.
  */
 struct hash_table_u64 {
-   struct hash_table *table;
-   void *deleted_key_data;
+   struct int_map map;
 };
 
 struct hash_table_u64 *
@@ -0,0 +1,256 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "bitscan.h"
+#include "int_map.h"
+#include "ralloc.h"
+
+#define INITIAL_SIZE 16
+
+char _mesa_int_map_deleted_marker;
+
+static inline bool
+entry_is_free(const struct int_map_entry *entry)
+{
+   return entry->key == 0 && entry->data != &_mesa_int_map_deleted_marker;
+}
+
+static inline bool
+entry_is_present(const struct int_map_entry *entry)
+{
+   return entry->key != 0;
+}
+
+static bool
+alloc_table(struct int_map *map, void *mem_ctx, uint32_t size)
+{
+   struct int_map_entry *table = rzalloc_array(mem_ctx, struct int_map_entry,
+                                               size);
+   if (!table)
+      return false;
+
+   map->table = table;
+   map->size = size;
+   map->shift = 64 - (ffs(size) - 1);
+   map->entries = 0;
+   map->deleted_entries = 0;
+
+   return true;
+}
+
+bool
+_mesa_int_map_init(struct int_map *map, void *mem_ctx)
+{
+   map->has_zero_entry = false;
+   map->zero_entry.key = 0;
+   map->zero_entry.data = NULL;
+
+   return alloc_table(map, mem_ctx, INITIAL_SIZE);
+}
+
+void
+_mesa_int_map_fini(struct int_map *map)
+{
+   ralloc_free(map->table);
+   map->table = NULL;
+}
+
+struct int_map *
+_mesa_int_map_create(void *mem_ctx)
+{
+   struct int_map *map = ralloc(mem_ctx, struct int_map);
+   if (!map)
+      return NULL;
+
+   if (!_mesa_int_map_init(map, map)) {
+      ralloc_free(map);
+      return NULL;
+   }
+
+   return map;
+}
+
+void
+_mesa_int_map_destroy(struct int_map *map,
+                      void (*delete_function)(struct int_map_entry *entry))
+{
+   if (!map)
+      return;
+
+   if (delete_function) {
+      int_map_foreach(map, entry)
+         delete_function(entry);
+   }
+   ralloc_free(map);
+}
+
+void
+_mesa_int_map_clear(struct int_map *map,
+                    void (*delete_function)(struct int_map_entry *entry))
+{
+   if (delete_function) {
+      int_map_foreach(map, entry)
+         delete_function(entry);
+   }
+
+   memset(map->table, 0, map->size * sizeof(*map->table));
+   map->entries = 0;
+   map->deleted_entries = 0;
+   map->has_zero_entry = false;
+}
+
+static bool
+rehash(struct int_map *map, uint32_t size)
+{
+   struct int_map_entry *old_table = map->table;
+   uint32_t old_size = map->size;
+
+   if (!alloc_table(map, ralloc_parent(old_table), size))
+      return false;
+
+   uint32_t mask = map->size - 1;
+   for (uint32_t i = 0; i < old_size; i++) {
+      if (!entry_is_present(&old_table[i]))
+         continue;
+
+      uint32_t j = _mesa_int_map_index(map, old_table[i].key);
+      while (entry_is_present(&map->table[j]))
+         j = (j + 1) & mask;
+      map->table[j] = old_table[i];
+      map->entries++;
+   }
+
+   ralloc_free(old_table);
+   return true;
+}
+
+struct int_map_entry *
+_mesa_int_map_insert(struct int_map *map, uint64_t key, void *data)
+{
+   struct int_map_entry *entry, *tombstone = NULL;
+
+   if (key == 0) {
+      map->has_zero_entry = true;
+      map->zero_entry.data = data;
+      return &map->zero_entry;
+   }
+
+   /* Keep the table at most 3/4 full, tombstones included, so that probe
+    * sequences stay short.  If most of it is tombstones, just clean them
+    * up.
+    */
+   if ((map->entries + map->deleted_entries + 1) * 4 > map->size * 3) {
+      uint32_t size = map->entries * 2 >= map->size ? map->size * 2
+                                                    : map->size;
+      if (!rehash(map, size))
+         return NULL;
+   }
+
+   uint32_t mask = map->size - 1;
+   for (uint32_t i = _mesa_int_map_index(map, key); ; i = (i + 1) & mask) {
+      entry = &map->table[i];
+
+      if (entry->key == key) {
+         entry->data = data;
+         return entry;
+      }
+
+      if (entry_is_free(entry))
+         break;
+
+      if (!tombstone && !entry_is_present(entry))
+         tombstone = entry;
+   }
+
+   if (tombstone) {
+      entry = tombstone;
+      map->deleted_entries--;
+   }
+
+   entry->key = key;
+   entry->data = data;
+   map->entries++;
+
+   return entry;
+}
+
+void
+_mesa_int_map_remove(struct int_map *map, struct int_map_entry *entry)
+{
+   if (!entry)
+      return;
+
+   if (entry == &map->zero_entry) {
+      map->has_zero_entry = false;
+      map->zero_entry.data = NULL;
+      return;
+   }
+
+   assert(entry_is_present(entry));
+
+   /* No probe sequence goes past an entry followed by a free one, so it
+    * doesn't need a tombstone.
+    */
+   uint32_t next = (entry - map->table + 1) & (map->size - 1);
+
+   entry->key = 0;
+   if (entry_is_free(&map->table[next])) {
+      entry->data = NULL;
+   } else {
+      entry->data = &_mesa_int_map_deleted_marker;
+      map->deleted_entries++;
+   }
+   map->entries--;
+}
+
+void
+_mesa_int_map_remove_key(struct int_map *map, uint64_t key)
+{
+   _mesa_int_map_remove(map, _mesa_int_map_search(map, key));
+}
+
+struct int_map_entry *
+_mesa_int_map_next_entry(struct int_map *map, struct int_map_entry *entry)
+{
+   uint32_t i;
+
+   if (entry == NULL) {
+      if (map->has_zero_entry)
+         return &map->zero_entry;
+      i = 0;
+   } else if (entry == &map->zero_entry) {
+      i = 0;
+   } else {
+      i = entry - map->table + 1;
+   }
+
+   for (; i < map->size; i++) {
+      if (entry_is_present(&map->table[i]))
+         return &map->table[i];
+   }
+
+   return NULL;
+}
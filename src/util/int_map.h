@@ -0,0 +1,201 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Hash map and set with integer keys.
+ *
+ * The keys are stored in the table itself rather than behind key pointers,
+ * and hashed inline with a Fibonacci multiplicative hash, so a lookup is a
+ * multiply, a shift and a linear scan of consecutive entries, without any
+ * indirect call or extra cache miss.
+ *
+ * Key 0 marks unused entries, so its value is kept outside of the table.
+ * Removed entries are left as tombstones, which makes removal safe while
+ * iterating; insertion is not.
+ */
+
+#ifndef _INT_MAP_H
+#define _INT_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct int_map_entry {
+   uint64_t key;
+   void *data;
+};
+
+struct int_map {
+   struct int_map_entry *table;
+   /* Power of two. */
+   uint32_t size;
+   /* 64 - log2(size), to get the index from the top bits of the hash. */
+   uint32_t shift;
+   uint32_t entries;
+   uint32_t deleted_entries;
+
+   bool has_zero_entry;
+   struct int_map_entry zero_entry;
+};
+
+/* Data of the tombstones, which have key 0 like the unused entries. */
+extern char _mesa_int_map_deleted_marker;
+
+struct int_map *
+_mesa_int_map_create(void *mem_ctx);
+
+/**
+ * Initialize a map embedded in another structure.  The table is allocated
+ * out of \mem_ctx and released by _mesa_int_map_fini().
+ */
+bool
+_mesa_int_map_init(struct int_map *map, void *mem_ctx);
+
+void
+_mesa_int_map_fini(struct int_map *map);
+
+void
+_mesa_int_map_destroy(struct int_map *map,
+                      void (*delete_function)(struct int_map_entry *entry));
+
+void
+_mesa_int_map_clear(struct int_map *map,
+                    void (*delete_function)(struct int_map_entry *entry));
+
+static inline uint32_t
+_mesa_int_map_num_entries(const struct int_map *map)
+{
+   return map->entries + map->has_zero_entry;
+}
+
+static inline uint32_t
+_mesa_int_map_index(const struct int_map *map, uint64_t key)
+{
+   return (key * 0x9e3779b97f4a7c15ull) >> map->shift;
+}
+
+static inline struct int_map_entry *
+_mesa_int_map_search(struct int_map *map, uint64_t key)
+{
+   if (key == 0)
+      return map->has_zero_entry ? &map->zero_entry : NULL;
+
+   uint32_t mask = map->size - 1;
+   for (uint32_t i = _mesa_int_map_index(map, key); ; i = (i + 1) & mask) {
+      struct int_map_entry *entry = &map->table[i];
+
+      if (entry->key == key)
+         return entry;
+      if (entry->key == 0 && entry->data != &_mesa_int_map_deleted_marker)
+         return NULL;
+   }
+}
+
+/**
+ * Insert \key, or replace its data if it's already there.  Returns NULL on
+ * allocation failure.
+ */
+struct int_map_entry *
+_mesa_int_map_insert(struct int_map *map, uint64_t key, void *data);
+
+void
+_mesa_int_map_remove(struct int_map *map, struct int_map_entry *entry);
+
+void
+_mesa_int_map_remove_key(struct int_map *map, uint64_t key);
+
+struct int_map_entry *
+_mesa_int_map_next_entry(struct int_map *map, struct int_map_entry *entry);
+
+#define int_map_foreach(map, entry)                                     \
+   for (struct int_map_entry *entry = _mesa_int_map_next_entry(map, NULL); \
+        entry != NULL;                                                  \
+        entry = _mesa_int_map_next_entry(map, entry))
+
+/**
+ * Set of integers, an int_map without data.
+ */
+struct int_set {
+   struct int_map map;
+};
+
+static inline struct int_set *
+_mesa_int_set_create(void *mem_ctx)
+{
+   return (struct int_set *) _mesa_int_map_create(mem_ctx);
+}
+
+static inline void
+_mesa_int_set_destroy(struct int_set *set)
+{
+   _mesa_int_map_destroy(&set->map, NULL);
+}
+
+static inline void
+_mesa_int_set_clear(struct int_set *set)
+{
+   _mesa_int_map_clear(&set->map, NULL);
+}
+
+static inline uint32_t
+_mesa_int_set_num_entries(const struct int_set *set)
+{
+   return _mesa_int_map_num_entries(&set->map);
+}
+
+static inline bool
+_mesa_int_set_add(struct int_set *set, uint64_t key)
+{
+   return _mesa_int_map_insert(&set->map, key, NULL) != NULL;
+}
+
+static inline bool
+_mesa_int_set_contains(struct int_set *set, uint64_t key)
+{
+   return _mesa_int_map_search(&set->map, key) != NULL;
+}
+
+static inline void
+_mesa_int_set_remove(struct int_set *set, uint64_t key)
+{
+   _mesa_int_map_remove_key(&set->map, key);
+}
+
+#define int_set_foreach(set, key)                                          \
+   for (struct int_map_entry *_entry =                                     \
+           _mesa_int_map_next_entry(&(set)->map, NULL);                    \
+        _entry != NULL; _entry = NULL)                                     \
+      for (uint64_t key = _entry->key; _entry != NULL;                     \
+           _entry = _mesa_int_map_next_entry(&(set)->map, _entry),         \
+           key = _entry ? _entry->key : 0)
+
+#ifdef __cplusplus
+} /* extern C */
+#endif
+
+#endif /* _INT_MAP_H */
@@ -35,6 +35,19 @@ _CRTIMP int _vscprintf(const char *format, va_list argptr);
 #endif
 
 #include "ralloc.h"
+#include "u_atomic.h"
+
+/* Arenas hide the individual blocks from AddressSanitizer, hand out plain
+ * contexts instead when it is enabled.  GCC defines __SANITIZE_ADDRESS__,
+ * clang only reports it through __has_feature().
+ */
+#if defined(__SANITIZE_ADDRESS__)
+#define RALLOC_NO_ARENAS 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define RALLOC_NO_ARENAS 1
+#endif
+#endif
 
 #ifndef va_copy
 #ifdef __va_copy
@@ -76,12 +89,28 @@ struct
    struct ralloc_header *next;
 
    void (*destructor)(void *);
+
+   /* The arena the block was allocated from, or NULL if it was malloc'ed. */
+   struct ralloc_arena *arena;
 };
 
 typedef struct ralloc_header ralloc_header;
 
+/* Must match the alignment of struct ralloc_header. */
+#if defined(_MSC_VER) || !defined(__LP64__)
+#define HEADER_ALIGN 8
+#else
+#define HEADER_ALIGN 16
+#endif
+
 static void unlink_block(ralloc_header *info);
-static void unsafe_free(ralloc_header *info);
+static void unsafe_free(ralloc_header *info, struct ralloc_arena *parent_arena);
+static ralloc_header *arena_alloc(struct ralloc_arena *arena, size_t size);
+static ralloc_header *arena_resize(ralloc_header *old, size_t size);
+static void arena_reparent(ralloc_header *info,
+                           struct ralloc_arena *old_parent_arena,
+                           struct ralloc_arena *new_parent_arena);
+static void arena_unref(struct ralloc_arena *arena);
 
 static ralloc_header *
 get_header(const void *ptr)
@@ -116,14 +145,18 @@ ralloc_context(const void *ctx)
 void *
 ralloc_size(const void *ctx, size_t size)
 {
-   void *block = malloc(size + sizeof(ralloc_header));
+   ralloc_header *parent = ctx != NULL ? get_header(ctx) : NULL;
    ralloc_header *info;
-   ralloc_header *parent;
 
-   if (unlikely(block == NULL))
+   /* The children of arena blocks come from the same arena. */
+   if (parent != NULL && parent->arena != NULL)
+      info = arena_alloc(parent->arena, size);
+   else
+      info = malloc(size + sizeof(ralloc_header));
+
+   if (unlikely(info == NULL))
       return NULL;
 
-   info = (ralloc_header *) block;
    /* measurements have shown that calloc is slower (because of
     * the multiplication overflow checking?), so clear things
     * manually
@@ -133,8 +166,7 @@ ralloc_size(const void *ctx, size_t size)
    info->prev = NULL;
    info->next = NULL;
    info->destructor = NULL;
-
-   parent = ctx != NULL ? get_header(ctx) : NULL;
+   info->arena = parent != NULL ? parent->arena : NULL;
 
    add_child(parent, info);
 
@@ -163,7 +195,10 @@ resize(void *ptr, size_t size)
    ralloc_header *child, *old, *info;
 
    old = get_header(ptr);
-   info = realloc(old, size + sizeof(ralloc_header));
+   if (old->arena != NULL)
+      info = arena_resize(old, size);
+   else
+      info = realloc(old, size + sizeof(ralloc_header));
 
    if (info == NULL)
       return NULL;
@@ -253,13 +288,15 @@ void
 ralloc_free(void *ptr)
 {
    ralloc_header *info;
+   struct ralloc_arena *parent_arena;
 
    if (ptr == NULL)
       return;
 
    info = get_header(ptr);
+   parent_arena = info->parent != NULL ? info->parent->arena : NULL;
    unlink_block(info);
-   unsafe_free(info);
+   unsafe_free(info, parent_arena);
 }
 
 static void
@@ -281,28 +318,34 @@ unlink_block(ralloc_header *info)
    info->next = NULL;
 }
 
+/* parent_arena is the arena of the parent the block had, if any. */
 static void
-unsafe_free(ralloc_header *info)
+unsafe_free(ralloc_header *info, struct ralloc_arena *parent_arena)
 {
    /* Recursively free any children...don't waste time unlinking them. */
    ralloc_header *temp;
    while (info->child != NULL) {
       temp = info->child;
       info->child = temp->next;
-      unsafe_free(temp);
+      unsafe_free(temp, info->arena);
    }
 
    /* Free the block itself.  Call the destructor first, if any. */
    if (info->destructor != NULL)
       info->destructor(PTR_FROM_HEADER(info));
 
-   free(info);
+   /* Arena blocks are only freed with their arena. */
+   if (info->arena == NULL)
+      free(info);
+   else if (info->arena != parent_arena)
+      arena_unref(info->arena);
 }
 
 void
 ralloc_steal(const void *new_ctx, void *ptr)
 {
    ralloc_header *info, *parent;
+   struct ralloc_arena *old_parent_arena;
 
    if (unlikely(ptr == NULL))
       return;
@@ -310,9 +353,12 @@ ralloc_steal(const void *new_ctx, void *ptr)
    info = get_header(ptr);
    parent = new_ctx ? get_header(new_ctx) : NULL;
 
+   old_parent_arena = info->parent != NULL ? info->parent->arena : NULL;
    unlink_block(info);
 
    add_child(parent, info);
+   arena_reparent(info, old_parent_arena,
+                  parent != NULL ? parent->arena : NULL);
 }
 
 void
@@ -333,8 +379,10 @@ ralloc_adopt(const void *new_ctx, void *old_ctx)
    /* Set all the children's parent to new_ctx; get a pointer to the last child. */
    for (child = old_info->child; child->next != NULL; child = child->next) {
       child->parent = new_info;
+      arena_reparent(child, old_info->arena, new_info->arena);
    }
    child->parent = new_info;
+   arena_reparent(child, old_info->arena, new_info->arena);
 
    /* Connect the two lists together; parent them to new_ctx; make old_ctx empty. */
    child->next = new_info->child;
@@ -363,6 +411,220 @@ ralloc_set_destructor(const void *ptr, void(*destructor)(void *))
    info->destructor = destructor;
 }
 
+/***************************************************************************
+ * Arenas
+ ***************************************************************************
+ *
+ * An arena hands out the blocks allocated under its root, and under their
+ * children, from large chunks instead of calling malloc for each of them,
+ * and frees the chunks all at once.  Arena blocks are regular ralloc
+ * blocks otherwise: they can be freed (their destructors run, but their
+ * memory is only reclaimed with the arena), resized and stolen.
+ *
+ * A block whose parent isn't in its arena (the root, and blocks stolen
+ * into another context) holds a reference on the arena, which is freed
+ * when the last of them is freed.  Blocks stolen out of an arena thus stay
+ * valid, but keep all of it alive.
+ */
+
+#define MIN_ARENA_CHUNK_SIZE (8 * 1024)
+#define MAX_ARENA_CHUNK_SIZE (512 * 1024)
+
+struct ralloc_arena {
+   /* Number of blocks holding a reference on the arena. */
+   unsigned refcount;
+
+   /* Free space left in the current chunk. */
+   char *next;
+   char *end;
+
+   /* Size of the next chunk, doubled every time. */
+   size_t chunk_size;
+
+   struct arena_chunk *chunks;
+};
+
+struct arena_chunk {
+   struct arena_chunk *next;
+};
+
+/* Arena blocks are preceded by their size, which resize() needs. */
+struct arena_block {
+   size_t size;
+};
+
+#define CHUNK_HEADER_SIZE ALIGN_POT(sizeof(struct arena_chunk), HEADER_ALIGN)
+#define BLOCK_PREFIX_SIZE ALIGN_POT(sizeof(struct arena_block), HEADER_ALIGN)
+
+static struct arena_block *
+get_arena_block(ralloc_header *info)
+{
+   return (struct arena_block *) ((char *) info - BLOCK_PREFIX_SIZE);
+}
+
+static struct arena_chunk *
+add_arena_chunk(struct ralloc_arena *arena, size_t size)
+{
+   struct arena_chunk *chunk = malloc(CHUNK_HEADER_SIZE + size);
+
+   if (unlikely(chunk == NULL))
+      return NULL;
+
+   chunk->next = arena->chunks;
+   arena->chunks = chunk;
+
+   return chunk;
+}
+
+static ralloc_header *
+arena_alloc(struct ralloc_arena *arena, size_t size)
+{
+   struct arena_block *block;
+   size_t full_size;
+
+   if (unlikely(size > SIZE_MAX / 2))
+      return NULL;
+
+   full_size = BLOCK_PREFIX_SIZE + sizeof(ralloc_header) +
+               ALIGN_POT(size, HEADER_ALIGN);
+
+   if (unlikely(full_size > (size_t) (arena->end - arena->next))) {
+      struct arena_chunk *chunk;
+
+      /* Large blocks get a chunk of their own, so that the space left in
+       * the current one isn't wasted.
+       */
+      if (full_size > arena->chunk_size / 4) {
+         chunk = add_arena_chunk(arena, full_size);
+         if (unlikely(chunk == NULL))
+            return NULL;
+
+         block = (struct arena_block *) ((char *) chunk + CHUNK_HEADER_SIZE);
+         block->size = size;
+         return (ralloc_header *) ((char *) block + BLOCK_PREFIX_SIZE);
+      }
+
+      chunk = add_arena_chunk(arena, arena->chunk_size);
+      if (unlikely(chunk == NULL))
+         return NULL;
+
+      arena->next = (char *) chunk + CHUNK_HEADER_SIZE;
+      arena->end = arena->next + arena->chunk_size;
+      if (arena->chunk_size < MAX_ARENA_CHUNK_SIZE)
+         arena->chunk_size *= 2;
+   }
+
+   block = (struct arena_block *) arena->next;
+   block->size = size;
+   arena->next += full_size;
+
+   return (ralloc_header *) ((char *) block + BLOCK_PREFIX_SIZE);
+}
+
+/* Grows the block in place if it's the last one of the current chunk,
+ * otherwise moves it to a new block.
+ */
+static ralloc_header *
+arena_resize(ralloc_header *old, size_t size)
+{
+   struct ralloc_arena *arena = old->arena;
+   struct arena_block *block = get_arena_block(old);
+   char *data = PTR_FROM_HEADER(old);
+   ralloc_header *info;
+
+   if (data + ALIGN_POT(block->size, HEADER_ALIGN) == arena->next &&
+       size <= (size_t) (arena->end - data)) {
+      arena->next = data + ALIGN_POT(size, HEADER_ALIGN);
+      block->size = size;
+      return old;
+   }
+
+   info = arena_alloc(arena, size);
+   if (unlikely(info == NULL))
+      return NULL;
+
+   memcpy(info, old, sizeof(ralloc_header) + MIN2(size, block->size));
+   return info;
+}
+
+static void
+arena_unref(struct ralloc_arena *arena)
+{
+   struct arena_chunk *chunk, *next;
+
+   if (!p_atomic_dec_zero(&arena->refcount))
+      return;
+
+   /* The arena itself is in the first chunk, the last of the list. */
+   for (chunk = arena->chunks; chunk != NULL; chunk = next) {
+      next = chunk->next;
+      free(chunk);
+   }
+}
+
+/* Takes or drops the reference the block holds on its arena, if it moved
+ * in or out of it.
+ */
+static void
+arena_reparent(ralloc_header *info, struct ralloc_arena *old_parent_arena,
+               struct ralloc_arena *new_parent_arena)
+{
+   bool held, holds;
+
+   if (info->arena == NULL)
+      return;
+
+   held = old_parent_arena != info->arena;
+   holds = new_parent_arena != info->arena;
+
+   if (holds && !held)
+      p_atomic_inc(&info->arena->refcount);
+   else if (held && !holds)
+      arena_unref(info->arena);
+}
+
+void *
+ralloc_arena_context(const void *ctx)
+{
+#ifdef RALLOC_NO_ARENAS
+   /* Let ASan see the blocks one by one. */
+   return ralloc_context(ctx);
+#else
+   struct ralloc_arena *arena;
+   struct arena_chunk *chunk;
+   ralloc_header *info, *parent;
+
+   chunk = malloc(CHUNK_HEADER_SIZE + MIN_ARENA_CHUNK_SIZE);
+   if (unlikely(chunk == NULL))
+      return NULL;
+
+   arena = (struct ralloc_arena *) ((char *) chunk + CHUNK_HEADER_SIZE);
+   arena->refcount = 1;
+   arena->next = (char *) arena + ALIGN_POT(sizeof(*arena), HEADER_ALIGN);
+   arena->end = (char *) chunk + CHUNK_HEADER_SIZE + MIN_ARENA_CHUNK_SIZE;
+   arena->chunk_size = MIN_ARENA_CHUNK_SIZE * 2;
+   arena->chunks = chunk;
+   chunk->next = NULL;
+
+   info = arena_alloc(arena, 0);
+   info->parent = NULL;
+   info->child = NULL;
+   info->prev = NULL;
+   info->next = NULL;
+   info->destructor = NULL;
+   info->arena = arena;
+
+   parent = ctx != NULL ? get_header(ctx) : NULL;
+   add_child(parent, info);
+
+#ifndef NDEBUG
+   info->canary = CANARY;
+#endif
+
+   return PTR_FROM_HEADER(info);
+#endif
+}
+
 char *
 ralloc_strdup(const void *ctx, const char *str)
 {
@@ -91,6 +91,22 @@ extern "C" {
  */
 void *ralloc_context(const void *ctx);
 
+/**
+ * Allocate a new ralloc context backed by an arena.
+ *
+ * Everything allocated out of the context, directly or not, is carved out
+ * of large chunks of memory which are only released when the context is
+ * freed.  This is much cheaper than ralloc_context() for short-lived
+ * contexts with lots of small allocations, such as the temporary contexts
+ * of compiler passes, but the memory of the blocks freed in the meantime
+ * isn't reused.
+ *
+ * Blocks can still be stolen out of the context, at the cost of keeping the
+ * whole arena alive until they're freed too.  Like the rest of ralloc,
+ * allocating from the same arena from several threads isn't safe.
+ */
+void *ralloc_arena_context(const void *ctx);
+
 /**
  * Allocate memory chained off of the given context.
  *
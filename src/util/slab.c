@@ -22,12 +22,20 @@
  * USE OR OTHER DEALINGS IN THE SOFTWARE. */
 
 #include "slab.h"
+#include "debug.h"
 #include "macros.h"
 #include "u_atomic.h"
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 
+#if defined(__linux__)
+#include <sys/mman.h>
+#if defined(MADV_HUGEPAGE)
+#define SLAB_HUGE_PAGES
+#endif
+#endif
+
 #define SLAB_MAGIC_ALLOCATED 0xcafe4321
 #define SLAB_MAGIC_FREE 0x7ee01234
 
@@ -39,13 +47,22 @@
 #define CHECK_MAGIC(element, value)
 #endif
 
+/* Number of elements of another pool slab_free keeps before handing them
+ * back to it.
+ */
+#define SLAB_MAGAZINE_SIZE 32
+
+/* Huge pages slab pages are carved out of, when enabled. */
+#define SLAB_REGION_SIZE (2 * 1024 * 1024)
+
 /* One array element within a big buffer. */
 struct slab_element_header {
    /* The next element in the free or migrated list. */
    struct slab_element_header *next;
 
    /* This is either
-    * - a pointer to the child pool to which this element belongs, or
+    * - a pointer to the migrated list of the child pool to which this
+    *   element belongs, or
     * - a pointer to the orphaned page of the element, with the least
     *   significant bit set to 1.
     */
@@ -65,11 +82,44 @@ struct slab_page_header {
       /* Number of remaining, non-freed elements (for orphaned pages). */
       unsigned num_remaining;
    } u;
+
+   /* The huge page region the page was carved out of, or NULL if it was
+    * malloc'ed.
+    */
+   struct slab_region *region;
+
    /* Memory after the last member is dedicated to the page itself.
     * The allocated size is always larger than this structure.
     */
 };
 
+/* The elements freed with another pool than their own, pushed without
+ * locking by the pools freeing them and taken all at once by the owner.
+ *
+ * It is allocated separately from the child pool, and only freed with the
+ * parent, so that pools that read an element's owner just before the owner
+ * was destroyed can still look at it.
+ */
+struct slab_migrated_list {
+   struct slab_element_header *head;
+
+   /* Next list of a destroyed pool. */
+   struct slab_migrated_list *next_dead;
+};
+
+/* Head of the migrated list of a destroyed child pool. */
+#define SLAB_MIGRATED_CLOSED ((struct slab_element_header *)1)
+
+struct slab_region {
+   /* Pages carved out of the region, plus one while it's the parent's
+    * current region.
+    */
+   unsigned refcount;
+
+   /* Where the next page goes. */
+   unsigned offset;
+};
+
 
 static struct slab_element_header *
 slab_get_element(struct slab_parent_pool *parent,
@@ -79,6 +129,107 @@ slab_get_element(struct slab_parent_pool *parent,
           ((uint8_t*)&page[1] + (parent->element_size * index));
 }
 
+#ifdef SLAB_HUGE_PAGES
+static struct slab_region *
+slab_map_region(void)
+{
+   uint8_t *map, *region;
+   size_t head;
+
+   /* Transparent huge pages need a 2M aligned mapping. */
+   map = mmap(NULL, 2 * SLAB_REGION_SIZE, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (map == MAP_FAILED)
+      return NULL;
+
+   region = (uint8_t *) ALIGN_POT((uintptr_t) map, SLAB_REGION_SIZE);
+   head = region - map;
+   if (head)
+      munmap(map, head);
+   munmap(region + SLAB_REGION_SIZE, SLAB_REGION_SIZE - head);
+
+   madvise(region, SLAB_REGION_SIZE, MADV_HUGEPAGE);
+
+   return (struct slab_region *) region;
+}
+
+static void
+slab_region_unref(struct slab_region *region)
+{
+   if (p_atomic_dec_zero(&region->refcount))
+      munmap(region, SLAB_REGION_SIZE);
+}
+
+/* Carve a page out of the parent's current region. The parent mutex must
+ * be held.
+ */
+static struct slab_page_header *
+slab_region_alloc(struct slab_parent_pool *parent, size_t size)
+{
+   struct slab_region *region = parent->region;
+   struct slab_page_header *page;
+
+   size = ALIGN_POT(size, 64);
+
+   if (!region || region->offset + size > SLAB_REGION_SIZE) {
+      if (region)
+         slab_region_unref(region);
+
+      region = parent->region = slab_map_region();
+      if (!region)
+         return NULL;
+
+      region->refcount = 1;
+      region->offset = ALIGN_POT(sizeof(*region), 64);
+   }
+
+   page = (struct slab_page_header *) ((uint8_t *) region + region->offset);
+   page->region = region;
+   region->offset += size;
+   p_atomic_inc(&region->refcount);
+
+   return page;
+}
+#endif
+
+static struct slab_page_header *
+slab_alloc_page(struct slab_parent_pool *parent)
+{
+   size_t size = sizeof(struct slab_page_header) +
+                 parent->num_elements * parent->element_size;
+   struct slab_page_header *page;
+
+#ifdef SLAB_HUGE_PAGES
+   if (parent->huge_pages && size <= SLAB_REGION_SIZE / 4) {
+      mtx_lock(&parent->mutex);
+      page = slab_region_alloc(parent, size);
+      mtx_unlock(&parent->mutex);
+
+      if (page)
+         return page;
+   }
+#endif
+
+   page = malloc(size);
+   if (page)
+      page->region = NULL;
+
+   return page;
+}
+
+static void
+slab_free_page(struct slab_page_header *page)
+{
+#ifdef SLAB_HUGE_PAGES
+   if (page->region) {
+      slab_region_unref(page->region);
+      return;
+   }
+#endif
+
+   free(page);
+}
+
 /* The given object/element belongs to an orphaned page (i.e. the owning child
  * pool has been destroyed). Mark the element as freed and free the whole page
  * when no elements are left in it.
@@ -92,12 +243,16 @@ slab_free_orphaned(struct slab_element_header *elt)
 
    page = (struct slab_page_header *)(elt->owner & ~(intptr_t)1);
    if (!p_atomic_dec_return(&page->u.num_remaining))
-      free(page);
+      slab_free_page(page);
 }
 
 /**
  * Create a parent pool for the allocation of same-sized objects.
  *
+ * Pages are carved out of transparent huge pages if MESA_SLAB_HUGE_PAGES
+ * is set, which saves TLB misses when there are lots of them but keeps
+ * their memory around until all the pages of a huge page are freed.
+ *
  * \param item_size     Size of one object.
  * \param num_items     Number of objects to allocate at once.
  */
@@ -110,11 +265,25 @@ slab_create_parent(struct slab_parent_pool *parent,
    parent->element_size = ALIGN_POT(sizeof(struct slab_element_header) + item_size,
                                     sizeof(intptr_t));
    parent->num_elements = num_items;
+   parent->dead_lists = NULL;
+   parent->region = NULL;
+   parent->huge_pages = env_var_as_boolean("MESA_SLAB_HUGE_PAGES", false);
 }
 
 void
 slab_destroy_parent(struct slab_parent_pool *parent)
 {
+   while (parent->dead_lists) {
+      struct slab_migrated_list *list = parent->dead_lists;
+      parent->dead_lists = list->next_dead;
+      free(list);
+   }
+
+#ifdef SLAB_HUGE_PAGES
+   if (parent->region)
+      slab_region_unref(parent->region);
+#endif
+
    mtx_destroy(&parent->mutex);
 }
 
@@ -128,6 +297,61 @@ void slab_create_child(struct slab_child_pool *pool,
    pool->pages = NULL;
    pool->free = NULL;
    pool->migrated = NULL;
+   pool->magazine = NULL;
+   pool->magazine_tail = NULL;
+   pool->magazine_owner = NULL;
+   pool->magazine_count = 0;
+}
+
+/* Replace the head of a migrated list, and return the elements it had.
+ * p_atomic_xchg only handles pointers with the GCC atomic builtins, unlike
+ * p_atomic_cmpxchg.
+ */
+static struct slab_element_header *
+slab_migrated_exchange(struct slab_migrated_list *list,
+                       struct slab_element_header *head)
+{
+   struct slab_element_header *old, *cur = p_atomic_read(&list->head);
+
+   do {
+      old = cur;
+      cur = p_atomic_cmpxchg(&list->head, old, head);
+   } while (cur != old);
+
+   return old;
+}
+
+/* Hand the elements of another pool kept by slab_free back to it. */
+static void
+slab_flush_magazine(struct slab_child_pool *pool)
+{
+   struct slab_migrated_list *list = pool->magazine_owner;
+   struct slab_element_header *head, *old;
+
+   if (!pool->magazine)
+      return;
+
+   head = p_atomic_read(&list->head);
+   do {
+      if (head == SLAB_MIGRATED_CLOSED) {
+         /* The owner was destroyed, and orphaned the elements. */
+         while (pool->magazine) {
+            struct slab_element_header *elt = pool->magazine;
+            pool->magazine = elt->next;
+            slab_free_orphaned(elt);
+         }
+         break;
+      }
+
+      old = head;
+      pool->magazine_tail->next = old;
+      head = p_atomic_cmpxchg(&list->head, old, pool->magazine);
+   } while (head != old);
+
+   pool->magazine = NULL;
+   pool->magazine_tail = NULL;
+   pool->magazine_owner = NULL;
+   pool->magazine_count = 0;
 }
 
 /**
@@ -141,26 +365,37 @@ void slab_destroy_child(struct slab_child_pool *pool)
    if (!pool->parent)
       return; /* the slab probably wasn't even created */
 
-   mtx_lock(&pool->parent->mutex);
+   slab_flush_magazine(pool);
+
+   if (pool->migrated) {
+      struct slab_element_header *migrated;
 
-   while (pool->pages) {
-      struct slab_page_header *page = pool->pages;
-      pool->pages = page->u.next;
-      p_atomic_set(&page->u.num_remaining, pool->parent->num_elements);
+      while (pool->pages) {
+         struct slab_page_header *page = pool->pages;
+         pool->pages = page->u.next;
+         p_atomic_set(&page->u.num_remaining, pool->parent->num_elements);
 
-      for (unsigned i = 0; i < pool->parent->num_elements; ++i) {
-         struct slab_element_header *elt = slab_get_element(pool->parent, page, i);
-         p_atomic_set(&elt->owner, (intptr_t)page | 1);
+         for (unsigned i = 0; i < pool->parent->num_elements; ++i) {
+            struct slab_element_header *elt = slab_get_element(pool->parent, page, i);
+            p_atomic_set(&elt->owner, (intptr_t)page | 1);
+         }
       }
-   }
 
-   while (pool->migrated) {
-      struct slab_element_header *elt = pool->migrated;
-      pool->migrated = elt->next;
-      slab_free_orphaned(elt);
-   }
+      /* Pools that still see us as the owner of an element after this see
+       * the list closed, and re-read the owner, which is orphaned by now.
+       */
+      migrated = slab_migrated_exchange(pool->migrated, SLAB_MIGRATED_CLOSED);
+      while (migrated) {
+         struct slab_element_header *elt = migrated;
+         migrated = elt->next;
+         slab_free_orphaned(elt);
+      }
 
-   mtx_unlock(&pool->parent->mutex);
+      mtx_lock(&pool->parent->mutex);
+      pool->migrated->next_dead = pool->parent->dead_lists;
+      pool->parent->dead_lists = pool->migrated;
+      mtx_unlock(&pool->parent->mutex);
+   }
 
    while (pool->free) {
       struct slab_element_header *elt = pool->free;
@@ -175,15 +410,21 @@ void slab_destroy_child(struct slab_child_pool *pool)
 static bool
 slab_add_new_page(struct slab_child_pool *pool)
 {
-   struct slab_page_header *page = malloc(sizeof(struct slab_page_header) +
-      pool->parent->num_elements * pool->parent->element_size);
+   struct slab_page_header *page;
 
+   if (!pool->migrated) {
+      pool->migrated = calloc(1, sizeof(*pool->migrated));
+      if (!pool->migrated)
+         return false;
+   }
+
+   page = slab_alloc_page(pool->parent);
    if (!page)
       return false;
 
    for (unsigned i = 0; i < pool->parent->num_elements; ++i) {
       struct slab_element_header *elt = slab_get_element(pool->parent, page, i);
-      elt->owner = (intptr_t)pool;
+      elt->owner = (intptr_t)pool->migrated;
       assert(!(elt->owner & 1));
 
       elt->next = pool->free;
@@ -211,10 +452,8 @@ slab_alloc(struct slab_child_pool *pool)
       /* First, collect elements that belong to us but were freed from a
        * different child pool.
        */
-      mtx_lock(&pool->parent->mutex);
-      pool->free = pool->migrated;
-      pool->migrated = NULL;
-      mtx_unlock(&pool->parent->mutex);
+      if (pool->migrated && p_atomic_read(&pool->migrated->head))
+         pool->free = slab_migrated_exchange(pool->migrated, NULL);
 
       /* Now allocate a new page. */
       if (!pool->free && !slab_add_new_page(pool))
@@ -247,7 +486,9 @@ void slab_free(struct slab_child_pool *pool, void *ptr)
    CHECK_MAGIC(elt, SLAB_MAGIC_ALLOCATED);
    SET_MAGIC(elt, SLAB_MAGIC_FREE);
 
-   if (p_atomic_read(&elt->owner) == (intptr_t)pool) {
+   owner_int = p_atomic_read(&elt->owner);
+
+   if (owner_int == (intptr_t)pool->migrated) {
       /* This is the simple case: The caller guarantees that we can safely
        * access the free list.
        */
@@ -256,24 +497,25 @@ void slab_free(struct slab_child_pool *pool, void *ptr)
       return;
    }
 
-   /* The slow case: migration or an orphaned page. */
-   mtx_lock(&pool->parent->mutex);
+   if (owner_int & 1) {
+      slab_free_orphaned(elt);
+      return;
+   }
 
-   /* Note: we _must_ re-read elt->owner here because the owning child pool
-    * may have been destroyed by another thread in the meantime.
+   /* Migration: keep the elements freed for the same pool in a magazine,
+    * and hand them back all at once.
     */
-   owner_int = p_atomic_read(&elt->owner);
-
-   if (!(owner_int & 1)) {
-      struct slab_child_pool *owner = (struct slab_child_pool *)owner_int;
-      elt->next = owner->migrated;
-      owner->migrated = elt;
-      mtx_unlock(&pool->parent->mutex);
-   } else {
-      mtx_unlock(&pool->parent->mutex);
+   if (owner_int != (intptr_t)pool->magazine_owner ||
+       pool->magazine_count == SLAB_MAGAZINE_SIZE)
+      slab_flush_magazine(pool);
 
-      slab_free_orphaned(elt);
+   if (!pool->magazine) {
+      pool->magazine_tail = elt;
+      pool->magazine_owner = (struct slab_migrated_list *)owner_int;
    }
+   elt->next = pool->magazine;
+   pool->magazine = elt;
+   pool->magazine_count++;
 }
 
 /**
@@ -33,7 +33,10 @@
  * Allocations obtained from one child pool should usually be freed in the
  * same child pool. Freeing an allocation in a different child pool associated
  * to the same parent is allowed (and requires no locking by the caller), but
- * it is discouraged because it implies a performance penalty.
+ * it is slower, and the allocation only becomes available to its own pool
+ * again once the freeing pool hands it back: the freeing pool keeps a small
+ * magazine of the allocations of another pool, which it pushes to that pool
+ * at once without locking.
  *
  * For convenience and to ease the transition, there is also a set of wrapper
  * functions around a single parent-child pair.
@@ -42,15 +45,25 @@
 #ifndef SLAB_H
 #define SLAB_H
 
+#include <stdbool.h>
 #include "c11/threads.h"
 
 struct slab_element_header;
 struct slab_page_header;
+struct slab_migrated_list;
+struct slab_region;
 
 struct slab_parent_pool {
    mtx_t mutex;
    unsigned element_size;
    unsigned num_elements;
+
+   /* Migrated lists of the destroyed child pools. */
+   struct slab_migrated_list *dead_lists;
+
+   /* The huge page new pages are carved out of, if huge_pages is set. */
+   struct slab_region *region;
+   bool huge_pages;
 };
 
 struct slab_child_pool {
@@ -64,9 +77,18 @@ struct slab_child_pool {
    /* Elements that are owned by this pool but were freed with a different
     * pool as the argument to slab_free.
     *
-    * This list is protected by the parent mutex.
+    * Other pools push onto this list without locking, it is only allocated
+    * with the first page.
+    */
+   struct slab_migrated_list *migrated;
+
+   /* Elements of another pool, freed with this one, that haven't been
+    * pushed to the owner's migrated list yet.
     */
-   struct slab_element_header *migrated;
+   struct slab_element_header *magazine;
+   struct slab_element_header *magazine_tail;
+   struct slab_migrated_list *magazine_owner;
+   unsigned magazine_count;
 };
 
 void slab_create_parent(struct slab_parent_pool *parent,
@@ -0,0 +1,529 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "bitscan.h"
+#include "ralloc.h"
+#include "swiss_table.h"
+
+#define GROUP_WIDTH 16
+
+#define CTRL_EMPTY   ((int8_t) -128)
+#define CTRL_DELETED ((int8_t) -2)
+
+/* Full entries have the 7 bits of H2 in their control byte, so any
+ * negative value is an empty or deleted entry.
+ */
+static inline bool
+ctrl_is_full(int8_t ctrl)
+{
+   return ctrl >= 0;
+}
+
+/* The position of an entry is picked from the hash itself (H1), and the
+ * control byte from a scrambled copy, so that the two are independent even
+ * for weak hash functions.
+ */
+static inline uint32_t
+hash_h1(uint32_t hash)
+{
+   return hash;
+}
+
+static inline int8_t
+hash_h2(uint32_t hash)
+{
+   return (hash * 0x9e3779b1u) >> 25;
+}
+
+/* Bitmask of the control bytes of the group at \ctrl equal to \value. */
+static inline uint32_t
+group_match(const int8_t *ctrl, int8_t value)
+{
+#ifdef __SSE2__
+   __m128i group = _mm_loadu_si128((const __m128i *) ctrl);
+   return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(value)));
+#else
+   uint32_t mask = 0;
+   for (unsigned i = 0; i < GROUP_WIDTH; i++)
+      mask |= (uint32_t) (ctrl[i] == value) << i;
+   return mask;
+#endif
+}
+
+/* Bitmask of the empty or deleted entries of the group at \ctrl. */
+static inline uint32_t
+group_match_empty_or_deleted(const int8_t *ctrl)
+{
+#ifdef __SSE2__
+   __m128i group = _mm_loadu_si128((const __m128i *) ctrl);
+   return _mm_movemask_epi8(group);
+#else
+   uint32_t mask = 0;
+   for (unsigned i = 0; i < GROUP_WIDTH; i++)
+      mask |= (uint32_t) !ctrl_is_full(ctrl[i]) << i;
+   return mask;
+#endif
+}
+
+/* Visits every group of the table, starting from the one the hash points
+ * to.  The step grows by one group each time, which covers all positions
+ * since the size is a power of two.
+ */
+struct probe_seq {
+   uint32_t pos;
+   uint32_t step;
+   uint32_t mask;
+};
+
+static inline struct probe_seq
+probe_start(const struct swiss_table *st, uint32_t hash)
+{
+   struct probe_seq seq = {
+      .pos = hash_h1(hash) & (st->size - 1),
+      .step = 0,
+      .mask = st->size - 1,
+   };
+   return seq;
+}
+
+static inline void
+probe_next(struct probe_seq *seq)
+{
+   seq->step += GROUP_WIDTH;
+   seq->pos = (seq->pos + seq->step) & seq->mask;
+}
+
+static inline uint32_t
+max_entries(uint32_t size)
+{
+   /* 7/8 load factor. */
+   return size - size / 8;
+}
+
+/* The control bytes of the first group are repeated after the last entry,
+ * so that a group can be loaded at any position without wrapping around.
+ */
+static inline void
+set_ctrl(struct swiss_table *st, uint32_t i, int8_t ctrl)
+{
+   st->ctrl[i] = ctrl;
+   if (i < GROUP_WIDTH)
+      st->ctrl[st->size + i] = ctrl;
+}
+
+static inline uint32_t
+hash_u64(uint64_t x)
+{
+   /* The 64-bit finalizer of MurmurHash3. */
+   x ^= x >> 33;
+   x *= 0xff51afd7ed558ccdull;
+   x ^= x >> 33;
+   x *= 0xc4ceb9fe1a85ec53ull;
+   x ^= x >> 33;
+   return (uint32_t) x;
+}
+
+static ALWAYS_INLINE uint32_t
+hash_key(const struct swiss_table *st, const void *key,
+         enum swiss_table_key_type key_type)
+{
+   if (st->key_hash_function)
+      return st->key_hash_function(key);
+
+   switch (key_type) {
+   case SWISS_TABLE_KEY_POINTER:
+      return _mesa_hash_pointer(key);
+   case SWISS_TABLE_KEY_U64:
+      return hash_u64(*(const uint64_t *) key);
+   default:
+      unreachable("generic keys always have a hash function");
+   }
+}
+
+static ALWAYS_INLINE bool
+keys_equal(const struct swiss_table *st, const void *a, const void *b,
+           enum swiss_table_key_type key_type)
+{
+   switch (key_type) {
+   case SWISS_TABLE_KEY_POINTER:
+      return a == b;
+   case SWISS_TABLE_KEY_U64:
+      return *(const uint64_t *) a == *(const uint64_t *) b;
+   default:
+      return st->key_equals_function(a, b);
+   }
+}
+
+static bool
+swiss_table_alloc(struct swiss_table *st, uint32_t size)
+{
+   void *mem = ralloc_size(st, size * sizeof(struct hash_entry) +
+                               size + GROUP_WIDTH);
+   if (!mem)
+      return false;
+
+   st->entries = mem;
+   st->ctrl = (int8_t *) (st->entries + size);
+   st->size = size;
+   st->num_entries = 0;
+   st->growth_left = max_entries(size);
+   memset(st->ctrl, CTRL_EMPTY, size + GROUP_WIDTH);
+
+   return true;
+}
+
+static struct swiss_table *
+swiss_table_create(void *mem_ctx,
+                   uint32_t (*key_hash_function)(const void *key),
+                   bool (*key_equals_function)(const void *a, const void *b),
+                   enum swiss_table_key_type key_type)
+{
+   struct swiss_table *st = rzalloc(mem_ctx, struct swiss_table);
+   if (!st)
+      return NULL;
+
+   st->key_hash_function = key_hash_function;
+   st->key_equals_function = key_equals_function;
+   st->key_type = key_type;
+
+   if (!swiss_table_alloc(st, GROUP_WIDTH)) {
+      ralloc_free(st);
+      return NULL;
+   }
+
+   return st;
+}
+
+struct swiss_table *
+_mesa_swiss_table_create(void *mem_ctx,
+                         uint32_t (*key_hash_function)(const void *key),
+                         bool (*key_equals_function)(const void *a,
+                                                     const void *b))
+{
+   /* Pointer keys are compared inline, whatever the hash function. */
+   enum swiss_table_key_type key_type =
+      key_equals_function == _mesa_key_pointer_equal ?
+      SWISS_TABLE_KEY_POINTER : SWISS_TABLE_KEY_GENERIC;
+
+   return swiss_table_create(mem_ctx, key_hash_function, key_equals_function,
+                             key_type);
+}
+
+struct swiss_table *
+_mesa_pointer_swiss_table_create(void *mem_ctx)
+{
+   return swiss_table_create(mem_ctx, NULL, _mesa_key_pointer_equal,
+                             SWISS_TABLE_KEY_POINTER);
+}
+
+struct swiss_table *
+_mesa_u64_swiss_table_create(void *mem_ctx)
+{
+   return swiss_table_create(mem_ctx, NULL, NULL, SWISS_TABLE_KEY_U64);
+}
+
+struct swiss_table *
+_mesa_swiss_table_clone(struct swiss_table *src, void *dst_mem_ctx)
+{
+   struct swiss_table *st = ralloc(dst_mem_ctx, struct swiss_table);
+   if (!st)
+      return NULL;
+
+   *st = *src;
+   if (!swiss_table_alloc(st, src->size)) {
+      ralloc_free(st);
+      return NULL;
+   }
+
+   memcpy(st->entries, src->entries,
+          src->size * sizeof(struct hash_entry) + src->size + GROUP_WIDTH);
+   st->num_entries = src->num_entries;
+   st->growth_left = src->growth_left;
+
+   return st;
+}
+
+void
+_mesa_swiss_table_destroy(struct swiss_table *st,
+                          void (*delete_function)(struct hash_entry *entry))
+{
+   if (!st)
+      return;
+
+   if (delete_function) {
+      swiss_table_foreach(st, entry)
+         delete_function(entry);
+   }
+   ralloc_free(st);
+}
+
+void
+_mesa_swiss_table_clear(struct swiss_table *st,
+                        void (*delete_function)(struct hash_entry *entry))
+{
+   if (delete_function) {
+      swiss_table_foreach(st, entry)
+         delete_function(entry);
+   }
+
+   memset(st->ctrl, CTRL_EMPTY, st->size + GROUP_WIDTH);
+   st->num_entries = 0;
+   st->growth_left = max_entries(st->size);
+}
+
+static ALWAYS_INLINE struct hash_entry *
+search(struct swiss_table *st, uint32_t hash, const void *key,
+       enum swiss_table_key_type key_type)
+{
+   struct probe_seq seq = probe_start(st, hash);
+   int8_t h2 = hash_h2(hash);
+
+   while (true) {
+      const int8_t *group = st->ctrl + seq.pos;
+      unsigned match = group_match(group, h2);
+
+      while (match) {
+         uint32_t i = (seq.pos + u_bit_scan(&match)) & seq.mask;
+         struct hash_entry *entry = &st->entries[i];
+
+         if (entry->hash == hash &&
+             keys_equal(st, entry->key, key, key_type))
+            return entry;
+      }
+
+      /* An empty entry ends the probe sequence of every key that would
+       * have been inserted past it.
+       */
+      if (group_match(group, CTRL_EMPTY))
+         return NULL;
+
+      probe_next(&seq);
+   }
+}
+
+/* Position of the first empty or deleted entry on the probe sequence of
+ * \hash.
+ */
+static uint32_t
+find_free(const struct swiss_table *st, uint32_t hash)
+{
+   struct probe_seq seq = probe_start(st, hash);
+
+   while (true) {
+      unsigned match = group_match_empty_or_deleted(st->ctrl + seq.pos);
+      if (match)
+         return (seq.pos + u_bit_scan(&match)) & seq.mask;
+      probe_next(&seq);
+   }
+}
+
+static bool
+resize(struct swiss_table *st, uint32_t size)
+{
+   struct hash_entry *old_entries = st->entries;
+   int8_t *old_ctrl = st->ctrl;
+   uint32_t old_size = st->size;
+   uint32_t num_entries = st->num_entries;
+
+   if (!swiss_table_alloc(st, size))
+      return false;
+
+   for (uint32_t i = 0; i < old_size; i++) {
+      if (ctrl_is_full(old_ctrl[i])) {
+         uint32_t pos = find_free(st, old_entries[i].hash);
+         set_ctrl(st, pos, hash_h2(old_entries[i].hash));
+         st->entries[pos] = old_entries[i];
+      }
+   }
+
+   st->num_entries = num_entries;
+   st->growth_left -= num_entries;
+
+   ralloc_free(old_entries);
+   return true;
+}
+
+static ALWAYS_INLINE struct hash_entry *
+insert(struct swiss_table *st, uint32_t hash, const void *key, void *data,
+       enum swiss_table_key_type key_type)
+{
+   struct hash_entry *entry = search(st, hash, key, key_type);
+   uint32_t pos;
+
+   if (entry) {
+      entry->key = key;
+      entry->data = data;
+      return entry;
+   }
+
+   pos = find_free(st, hash);
+
+   /* Reusing a deleted entry doesn't make any probe sequence longer, only
+    * taking an empty one needs room to grow.
+    */
+   if (st->growth_left == 0 && st->ctrl[pos] != CTRL_DELETED) {
+      /* Mostly deleted entries, just clean them up. */
+      uint32_t size = st->num_entries < max_entries(st->size) / 2 ?
+                      st->size : st->size * 2;
+      if (!resize(st, size))
+         return NULL;
+      pos = find_free(st, hash);
+   }
+
+   if (st->ctrl[pos] == CTRL_EMPTY)
+      st->growth_left--;
+   st->num_entries++;
+
+   set_ctrl(st, pos, hash_h2(hash));
+   entry = &st->entries[pos];
+   entry->hash = hash;
+   entry->key = key;
+   entry->data = data;
+
+   return entry;
+}
+
+struct hash_entry *
+_mesa_swiss_table_search_pre_hashed(struct swiss_table *st, uint32_t hash,
+                                    const void *key)
+{
+   switch (st->key_type) {
+   case SWISS_TABLE_KEY_POINTER:
+      return search(st, hash, key, SWISS_TABLE_KEY_POINTER);
+   case SWISS_TABLE_KEY_U64:
+      return search(st, hash, key, SWISS_TABLE_KEY_U64);
+   default:
+      return search(st, hash, key, SWISS_TABLE_KEY_GENERIC);
+   }
+}
+
+struct hash_entry *
+_mesa_swiss_table_search(struct swiss_table *st, const void *key)
+{
+   switch (st->key_type) {
+   case SWISS_TABLE_KEY_POINTER:
+      return search(st, hash_key(st, key, SWISS_TABLE_KEY_POINTER), key,
+                    SWISS_TABLE_KEY_POINTER);
+   case SWISS_TABLE_KEY_U64:
+      return search(st, hash_key(st, key, SWISS_TABLE_KEY_U64), key,
+                    SWISS_TABLE_KEY_U64);
+   default:
+      return search(st, hash_key(st, key, SWISS_TABLE_KEY_GENERIC), key,
+                    SWISS_TABLE_KEY_GENERIC);
+   }
+}
+
+struct hash_entry *
+_mesa_swiss_table_insert_pre_hashed(struct swiss_table *st, uint32_t hash,
+                                    const void *key, void *data)
+{
+   switch (st->key_type) {
+   case SWISS_TABLE_KEY_POINTER:
+      return insert(st, hash, key, data, SWISS_TABLE_KEY_POINTER);
+   case SWISS_TABLE_KEY_U64:
+      return insert(st, hash, key, data, SWISS_TABLE_KEY_U64);
+   default:
+      return insert(st, hash, key, data, SWISS_TABLE_KEY_GENERIC);
+   }
+}
+
+struct hash_entry *
+_mesa_swiss_table_insert(struct swiss_table *st, const void *key, void *data)
+{
+   switch (st->key_type) {
+   case SWISS_TABLE_KEY_POINTER:
+      return insert(st, hash_key(st, key, SWISS_TABLE_KEY_POINTER), key, data,
+                    SWISS_TABLE_KEY_POINTER);
+   case SWISS_TABLE_KEY_U64:
+      return insert(st, hash_key(st, key, SWISS_TABLE_KEY_U64), key, data,
+                    SWISS_TABLE_KEY_U64);
+   default:
+      return insert(st, hash_key(st, key, SWISS_TABLE_KEY_GENERIC), key, data,
+                    SWISS_TABLE_KEY_GENERIC);
+   }
+}
+
+void
+_mesa_swiss_table_remove(struct swiss_table *st, struct hash_entry *entry)
+{
+   if (!entry)
+      return;
+
+   uint32_t pos = entry - st->entries;
+   assert(pos < st->size && ctrl_is_full(st->ctrl[pos]));
+
+   /* If there is no full group around the entry, no probe sequence went
+    * past it, and it can be marked empty again rather than deleted.
+    */
+   uint32_t empty_before =
+      group_match(st->ctrl + ((pos - GROUP_WIDTH) & (st->size - 1)),
+                  CTRL_EMPTY);
+   uint32_t empty_after = group_match(st->ctrl + pos, CTRL_EMPTY);
+
+   if (empty_before && empty_after &&
+       (ffs(empty_after) - 1) +
+       (GROUP_WIDTH - util_last_bit(empty_before)) < GROUP_WIDTH) {
+      set_ctrl(st, pos, CTRL_EMPTY);
+      st->growth_left++;
+   } else {
+      set_ctrl(st, pos, CTRL_DELETED);
+   }
+
+   st->num_entries--;
+}
+
+void
+_mesa_swiss_table_remove_key(struct swiss_table *st, const void *key)
+{
+   _mesa_swiss_table_remove(st, _mesa_swiss_table_search(st, key));
+}
+
+struct hash_entry *
+_mesa_swiss_table_next_entry(struct swiss_table *st, struct hash_entry *entry)
+{
+   uint32_t pos = entry ? entry - st->entries + 1 : 0;
+
+   /* Skip whole groups of empty entries at once.  The control bytes past
+    * the end are copies of the first group and have to be masked off.
+    */
+   while (pos < st->size) {
+      unsigned full = ~group_match_empty_or_deleted(st->ctrl + pos) &
+                      ((1u << GROUP_WIDTH) - 1);
+      if (st->size - pos < GROUP_WIDTH)
+         full &= (1u << (st->size - pos)) - 1;
+
+      if (full)
+         return &st->entries[pos + u_bit_scan(&full)];
+
+      pos += GROUP_WIDTH;
+   }
+
+   return NULL;
+}
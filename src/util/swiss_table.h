@@ -0,0 +1,147 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Open-addressing hash table with SIMD probing, after Google's "Swiss
+ * tables".
+ *
+ * Next to the array of entries is an array of control bytes, one per
+ * entry, holding 7 bits of the entry's hash or an empty/deleted marker.
+ * Lookups compare a group of 16 control bytes against the hash with a
+ * couple of SSE2 instructions and only look at the entries that match, so
+ * the key comparison function is rarely called for anything but the key
+ * being looked for.  Tables created for pointer and 64-bit integer keys
+ * compare and hash keys inline, without any indirect call.  32-bit integer
+ * keys go in pointer tables, cast to pointers.
+ *
+ * The interface follows the one of struct hash_table, down to the entries
+ * being struct hash_entry, so switching a user over is mostly a matter of
+ * renaming.  The differences are that keys may be NULL, and that there is
+ * no deleted key to set: removed entries are tracked in the control bytes.
+ */
+
+#ifndef _SWISS_TABLE_H
+#define _SWISS_TABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hash_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum swiss_table_key_type {
+   SWISS_TABLE_KEY_GENERIC,
+   /* Keys are compared as pointers, which includes integers cast to
+    * pointers.
+    */
+   SWISS_TABLE_KEY_POINTER,
+   /* Keys point to uint64_t values. */
+   SWISS_TABLE_KEY_U64,
+};
+
+struct swiss_table {
+   struct hash_entry *entries;
+   int8_t *ctrl;
+
+   /* NULL for the key types that are hashed inline. */
+   uint32_t (*key_hash_function)(const void *key);
+   bool (*key_equals_function)(const void *a, const void *b);
+   enum swiss_table_key_type key_type;
+
+   /* Power of two, at least one group. */
+   uint32_t size;
+   uint32_t num_entries;
+
+   /* Number of entries that can be added before the table has to grow,
+    * deleted entries included.
+    */
+   uint32_t growth_left;
+};
+
+struct swiss_table *
+_mesa_swiss_table_create(void *mem_ctx,
+                         uint32_t (*key_hash_function)(const void *key),
+                         bool (*key_equals_function)(const void *a,
+                                                     const void *b));
+
+/**
+ * Table of pointer keys, or of integer keys up to the size of a pointer
+ * cast to pointers.
+ */
+struct swiss_table *
+_mesa_pointer_swiss_table_create(void *mem_ctx);
+
+/**
+ * Table of 64-bit integer keys.  The keys are pointers to the integers,
+ * which have to stay around as long as they are in the table.
+ */
+struct swiss_table *
+_mesa_u64_swiss_table_create(void *mem_ctx);
+
+struct swiss_table *
+_mesa_swiss_table_clone(struct swiss_table *src, void *dst_mem_ctx);
+void _mesa_swiss_table_destroy(struct swiss_table *st,
+                               void (*delete_function)(struct hash_entry *entry));
+void _mesa_swiss_table_clear(struct swiss_table *st,
+                             void (*delete_function)(struct hash_entry *entry));
+
+static inline uint32_t _mesa_swiss_table_num_entries(struct swiss_table *st)
+{
+   return st->num_entries;
+}
+
+struct hash_entry *
+_mesa_swiss_table_insert(struct swiss_table *st, const void *key, void *data);
+struct hash_entry *
+_mesa_swiss_table_insert_pre_hashed(struct swiss_table *st, uint32_t hash,
+                                    const void *key, void *data);
+struct hash_entry *
+_mesa_swiss_table_search(struct swiss_table *st, const void *key);
+struct hash_entry *
+_mesa_swiss_table_search_pre_hashed(struct swiss_table *st, uint32_t hash,
+                                    const void *key);
+void _mesa_swiss_table_remove(struct swiss_table *st,
+                              struct hash_entry *entry);
+void _mesa_swiss_table_remove_key(struct swiss_table *st,
+                                  const void *key);
+
+struct hash_entry *_mesa_swiss_table_next_entry(struct swiss_table *st,
+                                                struct hash_entry *entry);
+
+/**
+ * Safe against removal of the current entry, but not against insertion
+ * (which may grow the table, making entry a dangling pointer).
+ */
+#define swiss_table_foreach(st, entry)                                      \
+   for (struct hash_entry *entry = _mesa_swiss_table_next_entry(st, NULL);  \
+        entry != NULL;                                                      \
+        entry = _mesa_swiss_table_next_entry(st, entry))
+
+#ifdef __cplusplus
+} /* extern C */
+#endif
+
+#endif /* _SWISS_TABLE_H */
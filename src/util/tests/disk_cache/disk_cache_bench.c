@@ -0,0 +1,242 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Measures disk_cache put and get throughput, and the size of the cache on
+ * disk, for every compression codec that was built in.
+ *
+ * The entries are slices of this executable, which compresses about as
+ * well as the shader binaries drivers store.  Puts are timed until the
+ * cache queue has written the last entry; gets are timed on a freshly
+ * created cache, with the files in the page cache.
+ *
+ * MESA_DISK_CACHE_SINGLE_FILE and MESA_GLSL_CACHE_MAX_SIZE apply as usual,
+ * the in-memory cache is disabled.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftw.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "util/disk_cache.h"
+#include "util/disk_cache_codec.h"
+#include "util/macros.h"
+#include "util/mesa-sha1.h"
+#include "util/os_time.h"
+
+#ifdef ENABLE_SHADER_CACHE
+
+#define BENCH_DIR "./disk-cache-bench-tmp"
+
+/* Don't take forever on huge debug builds. */
+#define MAX_DATA_SIZE (32 * 1024 * 1024)
+
+/* The executable is reused as many times as needed to get this much. */
+#define MIN_TOTAL_SIZE (16 * 1024 * 1024)
+
+struct entry {
+   cache_key key;
+   const uint8_t *data;
+   size_t size;
+};
+
+static uint64_t disk_usage;
+
+static int
+remove_entry(const char *path, const struct stat *sb, int typeflag,
+             struct FTW *ftwbuf)
+{
+   return remove(path);
+}
+
+static int
+add_disk_usage(const char *path, const struct stat *sb, int typeflag,
+               struct FTW *ftwbuf)
+{
+   /* The key index has a fixed size, whatever the codec. */
+   if (typeflag == FTW_F && strcmp(path + ftwbuf->base, "index") != 0)
+      disk_usage += (uint64_t) sb->st_blocks * 512;
+   return 0;
+}
+
+static uint8_t *
+read_file(const char *path, size_t *size)
+{
+   FILE *f = fopen(path, "rb");
+   uint8_t *data;
+
+   if (!f)
+      return NULL;
+
+   data = malloc(MAX_DATA_SIZE);
+   if (data)
+      *size = fread(data, 1, MAX_DATA_SIZE, f);
+   fclose(f);
+
+   return data;
+}
+
+static void
+wait_for_entry(struct disk_cache *cache, const cache_key key)
+{
+   struct timespec req = { 0, 1000000 };
+   void *result;
+
+   while (!(result = disk_cache_get(cache, key, NULL)))
+      nanosleep(&req, NULL);
+
+   free(result);
+}
+
+static bool
+run(enum disk_cache_codec codec, const struct entry *entries,
+    unsigned num_entries, size_t total_size)
+{
+   struct disk_cache *cache;
+   int64_t start, put_time, get_time;
+   bool ok = true;
+
+   nftw(BENCH_DIR, remove_entry, 64, FTW_DEPTH | FTW_PHYS);
+   setenv("MESA_DISK_CACHE_CODEC", disk_cache_codec_name(codec), 1);
+
+   cache = disk_cache_create("bench", "disk_cache_bench", 0);
+   if (!cache) {
+      fprintf(stderr, "failed to create the cache in " BENCH_DIR "\n");
+      return false;
+   }
+
+   start = os_time_get_nano();
+   for (unsigned i = 0; i < num_entries; i++) {
+      disk_cache_put(cache, entries[i].key, entries[i].data, entries[i].size,
+                     NULL);
+   }
+   /* The queue writes the entries in order. */
+   wait_for_entry(cache, entries[num_entries - 1].key);
+   put_time = os_time_get_nano() - start;
+
+   disk_cache_destroy(cache);
+   cache = disk_cache_create("bench", "disk_cache_bench", 0);
+
+   start = os_time_get_nano();
+   for (unsigned i = 0; i < num_entries; i++) {
+      size_t size;
+      void *result = disk_cache_get(cache, entries[i].key, &size);
+
+      if (!result || size != entries[i].size ||
+          memcmp(result, entries[i].data, size) != 0)
+         ok = false;
+      free(result);
+   }
+   get_time = os_time_get_nano() - start;
+
+   disk_cache_destroy(cache);
+
+   disk_usage = 0;
+   nftw(BENCH_DIR, add_disk_usage, 64, FTW_PHYS);
+
+   printf("%-6s %10.1f %10.1f %12.2f %8.2f%s\n",
+          disk_cache_codec_name(codec),
+          total_size / 1e6 / (put_time / 1e9),
+          total_size / 1e6 / (get_time / 1e9),
+          disk_usage / 1e6,
+          (double) total_size / disk_usage,
+          ok ? "" : "   MISMATCH");
+
+   return ok;
+}
+
+int
+main(int argc, char **argv)
+{
+   struct entry *entries;
+   unsigned num_entries = 0;
+   size_t data_size, total_size = 0;
+   uint8_t *data;
+   bool ok = true;
+
+   data = read_file("/proc/self/exe", &data_size);
+   if (!data)
+      data = read_file(argv[0], &data_size);
+   if (!data || data_size == 0) {
+      fprintf(stderr, "failed to read %s\n", argv[0]);
+      return 1;
+   }
+
+   /* Cut it into 4K to 64K entries, the usual size of shader binaries. */
+   unsigned passes = DIV_ROUND_UP(MIN_TOTAL_SIZE, data_size);
+   entries = calloc(passes * (data_size / 4096 + 1), sizeof(*entries));
+   if (!entries)
+      return 1;
+
+   for (unsigned pass = 0; pass < passes; pass++) {
+      for (size_t offset = 0; offset < data_size; num_entries++) {
+         struct entry *entry = &entries[num_entries];
+         struct mesa_sha1 ctx;
+
+         entry->data = data + offset;
+         entry->size = MIN2(4096 << (num_entries % 5), data_size - offset);
+
+         _mesa_sha1_init(&ctx);
+         _mesa_sha1_update(&ctx, &pass, sizeof(pass));
+         _mesa_sha1_update(&ctx, &offset, sizeof(offset));
+         _mesa_sha1_update(&ctx, entry->data, entry->size);
+         _mesa_sha1_final(&ctx, entry->key);
+
+         offset += entry->size;
+         total_size += entry->size;
+      }
+   }
+
+   setenv("MESA_GLSL_CACHE_DIR", BENCH_DIR, 1);
+   unsetenv("MESA_GLSL_CACHE_DISABLE");
+   setenv("MESA_DISK_CACHE_MEMORY_SIZE", "0", 1);
+
+   printf("%u entries, %.2f MB\n\n", num_entries, total_size / 1e6);
+   printf("codec  put (MB/s) get (MB/s) on disk (MB)    ratio\n");
+
+   for (unsigned codec = 0; codec < DISK_CACHE_CODEC_COUNT; codec++) {
+      if (disk_cache_codec_supported(codec))
+         ok &= run(codec, entries, num_entries, total_size);
+   }
+
+   nftw(BENCH_DIR, remove_entry, 64, FTW_DEPTH | FTW_PHYS);
+   free(entries);
+   free(data);
+
+   return ok ? 0 : 1;
+}
+
+#else
+
+int
+main(void)
+{
+   return 0;
+}
+
+#endif /* ENABLE_SHADER_CACHE */
@@ -0,0 +1,224 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Lookup latency of GL object names, in the struct hash_table setups
+ * _mesa_HashTable and hash_table_u64 used before (the name as its own hash,
+ * passed pre-hashed, or the 64-bit key as a pointer) and in struct int_map.
+ *
+ * Each lookup returns the name to look up next, which follows a random
+ * cycle through the table, so the time per lookup is its latency rather
+ * than its throughput, as for the lookups of a single bind call.
+ *
+ * The names are laid out as glGen* hands them out: contiguous, or
+ * fragmented by deleting blocks of names and generating new ones, or as
+ * 64-bit bindless handles.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hash_table.h"
+#include "int_map.h"
+#include "os_time.h"
+
+#define NUM_LOOKUPS (1 << 22)
+
+static volatile uint64_t sink;
+
+static uint32_t
+uint_key_hash(const void *key)
+{
+   return (uintptr_t) key;
+}
+
+static bool
+uint_key_compare(const void *a, const void *b)
+{
+   return a == b;
+}
+
+/* Links names[] into one random cycle: next[i] is the name looked up
+ * after names[i].
+ */
+static void
+make_cycle(const uint64_t *names, uint64_t *next, unsigned count)
+{
+   unsigned *order = malloc(count * sizeof(*order));
+
+   for (unsigned i = 0; i < count; i++)
+      order[i] = i;
+   for (unsigned i = count - 1; i > 0; i--) {
+      unsigned j = rand() % (i + 1);
+      unsigned tmp = order[i];
+      order[i] = order[j];
+      order[j] = tmp;
+   }
+   for (unsigned i = 0; i < count; i++)
+      next[order[i]] = names[order[(i + 1) % count]];
+
+   free(order);
+}
+
+/* With \gl_names, the table is set up as _mesa_HashTable did, otherwise
+ * as hash_table_u64 did on 64-bit platforms.
+ */
+static double
+bench_hash_table(const uint64_t *names, const uint64_t *next, unsigned count,
+                 bool gl_names)
+{
+   struct hash_table *ht;
+   uint64_t name = names[0];
+   int64_t start, time;
+
+   if (gl_names) {
+      ht = _mesa_hash_table_create(NULL, uint_key_hash, uint_key_compare);
+      for (unsigned i = 0; i < count; i++) {
+         _mesa_hash_table_insert_pre_hashed(ht, names[i],
+                                            (void *)(uintptr_t) names[i],
+                                            (void *) &next[i]);
+      }
+
+      start = os_time_get_nano();
+      for (unsigned i = 0; i < NUM_LOOKUPS; i++) {
+         struct hash_entry *entry =
+            _mesa_hash_table_search_pre_hashed(ht, name,
+                                               (void *)(uintptr_t) name);
+         name = *(const uint64_t *) entry->data;
+      }
+      time = os_time_get_nano() - start;
+   } else {
+      ht = _mesa_pointer_hash_table_create(NULL);
+      for (unsigned i = 0; i < count; i++) {
+         _mesa_hash_table_insert(ht, (void *)(uintptr_t) names[i],
+                                 (void *) &next[i]);
+      }
+
+      start = os_time_get_nano();
+      for (unsigned i = 0; i < NUM_LOOKUPS; i++) {
+         struct hash_entry *entry =
+            _mesa_hash_table_search(ht, (void *)(uintptr_t) name);
+         name = *(const uint64_t *) entry->data;
+      }
+      time = os_time_get_nano() - start;
+   }
+
+   sink = name;
+   _mesa_hash_table_destroy(ht, NULL);
+
+   return (double) time / NUM_LOOKUPS;
+}
+
+static double
+bench_int_map(const uint64_t *names, const uint64_t *next, unsigned count)
+{
+   struct int_map *map = _mesa_int_map_create(NULL);
+   uint64_t name = names[0];
+
+   for (unsigned i = 0; i < count; i++)
+      _mesa_int_map_insert(map, names[i], (void *) &next[i]);
+
+   int64_t start = os_time_get_nano();
+   for (unsigned i = 0; i < NUM_LOOKUPS; i++) {
+      struct int_map_entry *entry = _mesa_int_map_search(map, name);
+      name = *(const uint64_t *) entry->data;
+   }
+   int64_t time = os_time_get_nano() - start;
+
+   sink = name;
+   _mesa_int_map_destroy(map, NULL);
+
+   return (double) time / NUM_LOOKUPS;
+}
+
+enum layout {
+   CONTIGUOUS,
+   FRAGMENTED,
+   HANDLES,
+};
+
+static const char *const layout_names[] = {
+   [CONTIGUOUS] = "contiguous",
+   [FRAGMENTED] = "fragmented",
+   [HANDLES]    = "bindless handles",
+};
+
+static void
+make_names(enum layout layout, uint64_t *names, unsigned count)
+{
+   switch (layout) {
+   case CONTIGUOUS:
+      for (unsigned i = 0; i < count; i++)
+         names[i] = i + 1;
+      break;
+   case FRAGMENTED:
+      /* Generate names in blocks of 100 and delete every other half
+       * block, so the names left are spread over twice the range.
+       */
+      for (unsigned i = 0; i < count; i++)
+         names[i] = (i / 50) * 100 + i % 50 + 1;
+      break;
+   case HANDLES:
+      /* Descriptor addresses, 64 bytes apart. */
+      for (unsigned i = 0; i < count; i++)
+         names[i] = 0x7f0000000000ull + (uint64_t) i * 64;
+      break;
+   }
+}
+
+int
+main(int argc, char **argv)
+{
+   static const unsigned counts[] = { 64, 1024, 16384, 262144 };
+   unsigned max_count = counts[ARRAY_SIZE(counts) - 1];
+   uint64_t *names = malloc(max_count * sizeof(*names));
+   uint64_t *next = malloc(max_count * sizeof(*next));
+
+   if (!names || !next)
+      return 1;
+
+   srand(1);
+
+   printf("ns per dependent lookup\n\n");
+   printf("%-18s %8s %12s %12s\n", "names", "count", "hash_table",
+          "int_map");
+
+   for (unsigned l = 0; l < ARRAY_SIZE(layout_names); l++) {
+      for (unsigned c = 0; c < ARRAY_SIZE(counts); c++) {
+         make_names(l, names, counts[c]);
+         make_cycle(names, next, counts[c]);
+
+         double ht_time = bench_hash_table(names, next, counts[c],
+                                           l != HANDLES);
+         double map_time = bench_int_map(names, next, counts[c]);
+
+         printf("%-18s %8u %12.1f %12.1f\n", layout_names[l], counts[c],
+                ht_time, map_time);
+      }
+   }
+
+   free(names);
+   free(next);
+
+   return 0;
+}
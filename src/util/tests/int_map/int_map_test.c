@@ -0,0 +1,153 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "int_map.h"
+
+#define NUM_KEYS 4096
+
+static unsigned delete_count;
+
+static void
+count_delete(struct int_map_entry *entry)
+{
+   delete_count++;
+}
+
+/* Random churn checked against a plain array, keys 0 and all-ones
+ * included.
+ */
+static void
+test_churn(void)
+{
+   struct int_map *map = _mesa_int_map_create(NULL);
+   static void *expected[NUM_KEYS];
+   uint64_t keys[NUM_KEYS];
+   uint32_t seed = 1;
+
+   for (unsigned i = 0; i < NUM_KEYS; i++)
+      keys[i] = (uint64_t) (i + 1) << 32 | i;
+   keys[1] = 0;
+   keys[2] = ~0ull;
+
+   for (unsigned it = 0; it < 200000; it++) {
+      seed = seed * 1103515245 + 12345;
+      unsigned k = (seed >> 8) % NUM_KEYS;
+      struct int_map_entry *entry;
+
+      switch ((seed >> 4) & 3) {
+      case 0:
+      case 1:
+         entry = _mesa_int_map_insert(map, keys[k], &keys[k]);
+         assert(entry && entry->key == keys[k]);
+         expected[k] = &keys[k];
+         break;
+      case 2:
+         _mesa_int_map_remove_key(map, keys[k]);
+         expected[k] = NULL;
+         break;
+      default:
+         entry = _mesa_int_map_search(map, keys[k]);
+         assert((entry ? entry->data : NULL) == expected[k]);
+         break;
+      }
+   }
+
+   unsigned count = 0, present = 0;
+   int_map_foreach(map, entry) {
+      assert(entry->data == expected[(uint64_t *) entry->data - keys]);
+      count++;
+   }
+   for (unsigned i = 0; i < NUM_KEYS; i++)
+      present += expected[i] != NULL;
+   assert(count == present);
+   assert(_mesa_int_map_num_entries(map) == present);
+
+   _mesa_int_map_destroy(map, count_delete);
+   assert(delete_count == present);
+}
+
+/* Removing every entry while iterating visits each one once. */
+static void
+test_remove_while_iterating(void)
+{
+   struct int_map *map = _mesa_int_map_create(NULL);
+   unsigned count = 0;
+
+   for (uint64_t i = 0; i < NUM_KEYS; i++)
+      _mesa_int_map_insert(map, i, NULL);
+
+   int_map_foreach(map, entry) {
+      _mesa_int_map_remove(map, entry);
+      count++;
+   }
+   assert(count == NUM_KEYS);
+   assert(_mesa_int_map_num_entries(map) == 0);
+   assert(!_mesa_int_map_next_entry(map, NULL));
+
+   _mesa_int_map_destroy(map, NULL);
+}
+
+static void
+test_set(void)
+{
+   struct int_set *set = _mesa_int_set_create(NULL);
+   uint64_t sum = 0;
+
+   for (uint64_t i = 0; i < NUM_KEYS; i += 2)
+      _mesa_int_set_add(set, i);
+   _mesa_int_set_add(set, 0);
+
+   for (uint64_t i = 0; i < NUM_KEYS; i++)
+      assert(_mesa_int_set_contains(set, i) == !(i & 1));
+   assert(_mesa_int_set_num_entries(set) == NUM_KEYS / 2);
+
+   int_set_foreach(set, key)
+      sum += key;
+   assert(sum == (uint64_t) (NUM_KEYS / 2) * (NUM_KEYS / 2 - 1));
+
+   _mesa_int_set_remove(set, 0);
+   assert(!_mesa_int_set_contains(set, 0));
+
+   _mesa_int_set_clear(set);
+   assert(_mesa_int_set_num_entries(set) == 0);
+
+   _mesa_int_set_destroy(set);
+}
+
+int
+main(int argc, char **argv)
+{
+   (void) argc;
+   (void) argv;
+
+   test_churn();
+   test_remove_while_iterating();
+   test_set();
+
+   return 0;
+}
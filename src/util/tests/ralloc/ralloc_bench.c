@@ -0,0 +1,96 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Compares ralloc_context() and ralloc_arena_context() on the allocation
+ * pattern of a compiler pass: a temporary context holding many small
+ * blocks, a few growing arrays and a hash set, freed all at once.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "ralloc.h"
+#include "set.h"
+#include "os_time.h"
+
+#define ITERATIONS 2000
+
+static unsigned
+run_pass(void *(*create_context)(const void *), unsigned blocks)
+{
+   void *ctx = create_context(NULL);
+   struct set *set = _mesa_pointer_set_create(ctx);
+   uint32_t *array = ralloc_array(ctx, uint32_t, 4);
+   unsigned array_size = 4;
+   unsigned sum;
+
+   for (unsigned i = 0; i < blocks; i++) {
+      /* Per-instruction and per-variable state, 16 to 128 bytes. */
+      uint32_t *block = ralloc_array(ctx, uint32_t, 4 + i % 29);
+      block[0] = i;
+      _mesa_set_add(set, block);
+
+      if (i % 8 == 0) {
+         uint32_t *child = ralloc_array(block, uint32_t, 8);
+         child[0] = i;
+      }
+
+      if (i == array_size) {
+         array_size *= 2;
+         array = reralloc(ctx, array, uint32_t, array_size);
+      }
+      array[i] = i;
+   }
+
+   sum = array[blocks / 2] + set->entries;
+   ralloc_free(ctx);
+
+   return sum;
+}
+
+static void
+bench(const char *name, void *(*create_context)(const void *),
+      unsigned blocks)
+{
+   unsigned sum = 0;
+   int64_t start = os_time_get_nano();
+
+   for (unsigned i = 0; i < ITERATIONS; i++)
+      sum += run_pass(create_context, blocks);
+
+   printf("%-8s %6u blocks: %8.2f us/pass (%u)\n", name, blocks,
+          (os_time_get_nano() - start) / 1e3 / ITERATIONS, sum);
+}
+
+int
+main(void)
+{
+   static const unsigned sizes[] = { 16, 256, 4096, 32768 };
+
+   for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+      bench("malloc", ralloc_context, sizes[i]);
+      bench("arena", ralloc_arena_context, sizes[i]);
+   }
+
+   return 0;
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ralloc.h"
+
+static unsigned destroyed;
+
+static void
+count_destructor(void *ptr)
+{
+   destroyed++;
+}
+
+static uint32_t *
+alloc_filled(const void *ctx, unsigned count, uint32_t value)
+{
+   uint32_t *data = ralloc_array(ctx, uint32_t, count);
+
+   assert(data);
+   for (unsigned i = 0; i < count; i++)
+      data[i] = value + i;
+   ralloc_set_destructor(data, count_destructor);
+   return data;
+}
+
+static void
+check_filled(const uint32_t *data, unsigned count, uint32_t value)
+{
+   for (unsigned i = 0; i < count; i++)
+      assert(data[i] == value + i);
+}
+
+/* Lots of blocks of all sizes, some of them freed or resized. */
+static void
+test_alloc(void)
+{
+   void *ctx = ralloc_arena_context(NULL);
+   uint32_t *blocks[1000];
+
+   destroyed = 0;
+   /* Every third block is a child of one of the blocks resized below. */
+   for (unsigned i = 0; i < 1000; i++) {
+      void *parent = i % 3 == 0 && i >= 20 ? blocks[i / 20 * 10] : ctx;
+
+      blocks[i] = alloc_filled(parent, i * 7 % 5000, i);
+      assert(((uintptr_t) blocks[i] & (sizeof(void *) - 1)) == 0);
+   }
+
+   for (unsigned i = 0; i < 1000; i += 10) {
+      unsigned count = i * 7 % 5000;
+
+      /* The last block grows in place, the others move. */
+      blocks[i] = reralloc(ralloc_parent(blocks[i]), blocks[i], uint32_t,
+                           count * 2 + 1);
+      for (unsigned j = count; j < count * 2 + 1; j++)
+         blocks[i][j] = i + j;
+      check_filled(blocks[i], count * 2 + 1, i);
+   }
+
+   for (unsigned i = 1; i < 1000; i += 10) {
+      ralloc_free(blocks[i]);
+      blocks[i] = NULL;
+   }
+
+   for (unsigned i = 0; i < 1000; i++) {
+      if (blocks[i] && i % 10 != 0)
+         check_filled(blocks[i], i * 7 % 5000, i);
+   }
+
+   /* Children of moved blocks must have followed them. */
+   for (unsigned i = 0; i < 1000; i++) {
+      if (blocks[i] && i % 3 == 0 && i >= 20)
+         assert(ralloc_parent(blocks[i]) == blocks[i / 20 * 10]);
+   }
+
+   ralloc_free(ctx);
+   assert(destroyed == 1000);
+}
+
+/* Blocks stolen out of the arena outlive its context. */
+static void
+test_steal_out(void)
+{
+   void *malloc_ctx = ralloc_context(NULL);
+   void *ctx = ralloc_arena_context(NULL);
+   uint32_t *kept = alloc_filled(ctx, 100, 1);
+   uint32_t *child = alloc_filled(kept, 100, 2);
+   uint32_t *back;
+
+   destroyed = 0;
+   for (unsigned i = 0; i < 100; i++)
+      alloc_filled(ctx, 100, i);
+
+   ralloc_steal(malloc_ctx, kept);
+   ralloc_free(ctx);
+   assert(destroyed == 100);
+
+   check_filled(kept, 100, 1);
+   check_filled(child, 100, 2);
+   assert(ralloc_parent(child) == kept);
+
+   /* Still part of the arena, so allocated from it. */
+   back = alloc_filled(kept, 10, 3);
+   check_filled(back, 10, 3);
+
+   ralloc_free(malloc_ctx);
+   assert(destroyed == 103);
+}
+
+/* Stealing back and forth, and into another arena. */
+static void
+test_steal_around(void)
+{
+   void *ctx = ralloc_arena_context(NULL);
+   void *other = ralloc_arena_context(NULL);
+   void *malloc_ctx = ralloc_context(NULL);
+   uint32_t *a = alloc_filled(ctx, 10, 1);
+   uint32_t *b = alloc_filled(malloc_ctx, 10, 2);
+
+   destroyed = 0;
+   ralloc_steal(malloc_ctx, a);
+   ralloc_steal(ctx, a);
+   ralloc_steal(other, a);
+   ralloc_steal(ctx, b);
+   ralloc_steal(NULL, b);
+   ralloc_steal(other, b);
+
+   ralloc_free(ctx);
+   ralloc_free(malloc_ctx);
+   assert(destroyed == 0);
+   check_filled(a, 10, 1);
+   check_filled(b, 10, 2);
+
+   ralloc_free(other);
+   assert(destroyed == 2);
+}
+
+static void
+test_adopt(void)
+{
+   void *ctx = ralloc_arena_context(NULL);
+   void *malloc_ctx = ralloc_context(NULL);
+   void *other = ralloc_context(NULL);
+
+   destroyed = 0;
+   for (unsigned i = 0; i < 10; i++) {
+      alloc_filled(ctx, 10, i);
+      alloc_filled(malloc_ctx, 10, i);
+   }
+
+   ralloc_adopt(malloc_ctx, ctx);
+   ralloc_free(ctx);
+   assert(destroyed == 0);
+
+   ralloc_adopt(other, malloc_ctx);
+   ralloc_free(malloc_ctx);
+   assert(destroyed == 0);
+
+   ralloc_free(other);
+   assert(destroyed == 20);
+}
+
+/* Arenas nested in arenas and in plain contexts. */
+static void
+test_nested(void)
+{
+   void *malloc_ctx = ralloc_context(NULL);
+   void *ctx = ralloc_arena_context(malloc_ctx);
+   void *inner = ralloc_arena_context(ctx);
+   char *str;
+
+   destroyed = 0;
+   alloc_filled(inner, 1000, 0);
+   alloc_filled(ctx, 1000, 0);
+   str = ralloc_strdup(inner, "foo");
+   ralloc_asprintf_append(&str, "%s%u", "bar", 42);
+   assert(strcmp(str, "foobar42") == 0);
+
+   ralloc_free(inner);
+   assert(destroyed == 1);
+
+   inner = ralloc_arena_context(ctx);
+   alloc_filled(inner, 1000, 0);
+
+   ralloc_free(malloc_ctx);
+   assert(destroyed == 3);
+}
+
+int
+main(void)
+{
+   test_alloc();
+   test_steal_out();
+   test_steal_around();
+   test_adopt();
+   test_nested();
+
+   return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Measures slab allocations freed by the same child pool, and allocations
+ * handed over to another thread that frees them with its own pool, the way
+ * the threaded context frees transfers.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "c11/threads.h"
+#include "os_time.h"
+#include "slab.h"
+
+#define ITEM_SIZE 128
+#define BATCH_SIZE 64
+#define NUM_BATCHES 100000
+
+static struct slab_parent_pool parent;
+
+/* One batch of items in flight between the two threads. */
+static mtx_t mutex;
+static cnd_t cond;
+static void *batch[BATCH_SIZE];
+static bool batch_full;
+static bool done;
+
+static int
+consumer_func(void *data)
+{
+   struct slab_child_pool pool;
+   void *items[BATCH_SIZE];
+
+   slab_create_child(&pool, &parent);
+
+   for (;;) {
+      mtx_lock(&mutex);
+      while (!batch_full && !done)
+         cnd_wait(&cond, &mutex);
+      if (!batch_full) {
+         mtx_unlock(&mutex);
+         break;
+      }
+      memcpy(items, batch, sizeof(items));
+      batch_full = false;
+      cnd_broadcast(&cond);
+      mtx_unlock(&mutex);
+
+      for (unsigned i = 0; i < BATCH_SIZE; i++)
+         slab_free(&pool, items[i]);
+   }
+
+   slab_destroy_child(&pool);
+   return 0;
+}
+
+static void
+bench_cross_thread(void)
+{
+   struct slab_child_pool pool;
+   void *items[BATCH_SIZE];
+   thrd_t consumer;
+   int64_t start;
+
+   slab_create_child(&pool, &parent);
+   mtx_init(&mutex, mtx_plain);
+   cnd_init(&cond);
+   batch_full = done = false;
+   thrd_create(&consumer, consumer_func, NULL);
+
+   start = os_time_get_nano();
+   for (unsigned n = 0; n < NUM_BATCHES; n++) {
+      for (unsigned i = 0; i < BATCH_SIZE; i++)
+         items[i] = slab_alloc(&pool);
+
+      mtx_lock(&mutex);
+      while (batch_full)
+         cnd_wait(&cond, &mutex);
+      memcpy(batch, items, sizeof(items));
+      batch_full = true;
+      cnd_broadcast(&cond);
+      mtx_unlock(&mutex);
+   }
+
+   mtx_lock(&mutex);
+   done = true;
+   cnd_broadcast(&cond);
+   mtx_unlock(&mutex);
+   thrd_join(consumer, NULL);
+
+   printf("cross-thread free: %6.1f ns/item\n",
+          (double) (os_time_get_nano() - start) / NUM_BATCHES / BATCH_SIZE);
+
+   slab_destroy_child(&pool);
+   cnd_destroy(&cond);
+   mtx_destroy(&mutex);
+}
+
+static void
+bench_local(void)
+{
+   struct slab_child_pool pool;
+   void *items[BATCH_SIZE];
+   int64_t start;
+
+   slab_create_child(&pool, &parent);
+
+   start = os_time_get_nano();
+   for (unsigned n = 0; n < NUM_BATCHES; n++) {
+      for (unsigned i = 0; i < BATCH_SIZE; i++)
+         items[i] = slab_alloc(&pool);
+      for (unsigned i = 0; i < BATCH_SIZE; i++)
+         slab_free(&pool, items[i]);
+   }
+
+   printf("local free:        %6.1f ns/item\n",
+          (double) (os_time_get_nano() - start) / NUM_BATCHES / BATCH_SIZE);
+
+   slab_destroy_child(&pool);
+}
+
+int
+main(void)
+{
+   slab_create_parent(&parent, ITEM_SIZE, 64);
+
+   bench_local();
+   bench_cross_thread();
+
+   slab_destroy_parent(&parent);
+   return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Stress test of slab allocations freed by other threads' child pools,
+ * with child pools destroyed and recreated while their allocations are
+ * still in flight.  Allocations are stamped with an id checked when they
+ * are freed, which catches elements handed out twice.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "c11/threads.h"
+#include "slab.h"
+#include "u_atomic.h"
+
+#define NUM_THREADS 4
+#define QUEUE_SIZE 256
+#define ITERATIONS 200000
+
+struct item {
+   uint64_t id;
+   uint64_t check;
+   char pad[24];
+};
+
+/* Items sent to a thread, which frees them. */
+struct queue {
+   mtx_t mutex;
+   struct item *items[QUEUE_SIZE];
+   unsigned count;
+};
+
+static struct slab_parent_pool parent;
+static struct queue queues[NUM_THREADS];
+static unsigned errors;
+
+static uint64_t
+stamp(uint64_t id)
+{
+   return id * 0x9e3779b97f4a7c15ull ^ 0xdeadbeef;
+}
+
+static void
+free_item(struct slab_child_pool *pool, struct item *item)
+{
+   if (item->check != stamp(item->id))
+      p_atomic_inc(&errors);
+   item->check = 0;
+   slab_free(pool, item);
+}
+
+static void
+drain_queue(struct slab_child_pool *pool, struct queue *queue)
+{
+   mtx_lock(&queue->mutex);
+   for (unsigned i = 0; i < queue->count; i++)
+      free_item(pool, queue->items[i]);
+   queue->count = 0;
+   mtx_unlock(&queue->mutex);
+}
+
+static int
+thread_func(void *data)
+{
+   unsigned index = (uintptr_t) data;
+   struct slab_child_pool pool;
+   uint32_t seed = index + 1;
+
+   slab_create_child(&pool, &parent);
+
+   for (unsigned i = 0; i < ITERATIONS; i++) {
+      struct item *item = slab_alloc(&pool);
+      struct queue *queue;
+
+      if (!item) {
+         p_atomic_inc(&errors);
+         break;
+      }
+
+      item->id = (uint64_t) index << 32 | i;
+      item->check = stamp(item->id);
+
+      seed = seed * 1103515245 + 12345;
+
+      /* Some are freed locally, the others by another thread. */
+      if ((seed >> 16) % 4 == 0) {
+         free_item(&pool, item);
+      } else {
+         queue = &queues[(index + 1 + (seed >> 8) % (NUM_THREADS - 1)) %
+                         NUM_THREADS];
+         mtx_lock(&queue->mutex);
+         if (queue->count < QUEUE_SIZE) {
+            queue->items[queue->count++] = item;
+            item = NULL;
+         }
+         mtx_unlock(&queue->mutex);
+
+         if (item)
+            free_item(&pool, item);
+      }
+
+      if (i % 16 == 0)
+         drain_queue(&pool, &queues[index]);
+
+      /* Interleave the threads even on a single CPU. */
+      if (i % 64 == 0)
+         thrd_yield();
+
+      /* Orphan the pages of the items still in flight. */
+      if (i % 10000 == 9999) {
+         slab_destroy_child(&pool);
+         slab_create_child(&pool, &parent);
+      }
+   }
+
+   /* The other threads may still send items, which the main thread
+    * frees.
+    */
+   drain_queue(&pool, &queues[index]);
+   slab_destroy_child(&pool);
+
+   return 0;
+}
+
+static void
+run(void)
+{
+   struct slab_child_pool pool;
+   thrd_t threads[NUM_THREADS];
+
+   slab_create_parent(&parent, sizeof(struct item), 64);
+   for (unsigned i = 0; i < NUM_THREADS; i++)
+      mtx_init(&queues[i].mutex, mtx_plain);
+
+   for (unsigned i = 0; i < NUM_THREADS; i++)
+      thrd_create(&threads[i], thread_func, (void *)(uintptr_t) i);
+   for (unsigned i = 0; i < NUM_THREADS; i++)
+      thrd_join(threads[i], NULL);
+
+   slab_create_child(&pool, &parent);
+   for (unsigned i = 0; i < NUM_THREADS; i++) {
+      drain_queue(&pool, &queues[i]);
+      mtx_destroy(&queues[i].mutex);
+   }
+   slab_destroy_child(&pool);
+
+   slab_destroy_parent(&parent);
+}
+
+int
+main(void)
+{
+   run();
+
+   setenv("MESA_SLAB_HUGE_PAGES", "true", 1);
+   run();
+
+   if (errors) {
+      fprintf(stderr, "%u corrupted or failed allocations\n", errors);
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "swiss_table.h"
+
+#define SIZE 100
+
+/* Every key collides, entries only differ by their keys. */
+static uint32_t
+bad_hash(const void *key)
+{
+   return 0xdeadbeef;
+}
+
+int
+main(int argc, char **argv)
+{
+   struct swiss_table *st;
+   struct hash_entry *entry;
+   char keys[SIZE][8];
+   unsigned i;
+
+   (void) argc;
+   (void) argv;
+
+   st = _mesa_swiss_table_create(NULL, bad_hash, _mesa_key_string_equal);
+
+   for (i = 0; i < SIZE; i++) {
+      snprintf(keys[i], sizeof(keys[i]), "%u", i);
+      _mesa_swiss_table_insert(st, keys[i], keys[i]);
+   }
+
+   for (i = 0; i < SIZE; i++) {
+      char key[8];
+      snprintf(key, sizeof(key), "%u", i);
+      entry = _mesa_swiss_table_search(st, key);
+      assert(entry && entry->data == keys[i]);
+   }
+
+   /* Removing entries in the middle of the chain doesn't hide the ones
+    * after them.
+    */
+   for (i = 0; i < SIZE; i += 2)
+      _mesa_swiss_table_remove_key(st, keys[i]);
+
+   for (i = 0; i < SIZE; i++) {
+      entry = _mesa_swiss_table_search(st, keys[i]);
+      assert((entry != NULL) == (i & 1));
+   }
+   assert(_mesa_swiss_table_num_entries(st) == SIZE / 2);
+
+   _mesa_swiss_table_destroy(st, NULL);
+
+   return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <string.h>
+#include "swiss_table.h"
+
+#define SIZE 10000
+
+static uint32_t
+key_value(const void *key)
+{
+   return *(const uint32_t *)key;
+}
+
+static bool
+uint32_t_key_equals(const void *a, const void *b)
+{
+   return key_value(a) == key_value(b);
+}
+
+int
+main(int argc, char **argv)
+{
+   struct swiss_table *st;
+   struct hash_entry *entry;
+   uint32_t keys[SIZE];
+   uint32_t i;
+
+   (void) argc;
+   (void) argv;
+
+   st = _mesa_swiss_table_create(NULL, key_value, uint32_t_key_equals);
+
+   /* Keep a sliding window of 100 entries, so that the table is mostly
+    * deleted entries unless they get cleaned up.
+    */
+   for (i = 0; i < SIZE; i++) {
+      keys[i] = i;
+
+      _mesa_swiss_table_insert(st, keys + i, NULL);
+
+      if (i >= 100) {
+         uint32_t delete_value = i - 100;
+         entry = _mesa_swiss_table_search(st, &delete_value);
+         assert(entry);
+         _mesa_swiss_table_remove(st, entry);
+      }
+   }
+
+   /* Make sure that all our entries were present at the end. */
+   for (i = SIZE - 100; i < SIZE; i++) {
+      entry = _mesa_swiss_table_search(st, keys + i);
+      assert(entry);
+      assert(key_value(entry->key) == i);
+   }
+
+   /* Make sure that no extra entries got in */
+   swiss_table_foreach(st, entry) {
+      assert(key_value(entry->key) >= SIZE - 100 &&
+             key_value(entry->key) < SIZE);
+   }
+   assert(_mesa_swiss_table_num_entries(st) == 100);
+
+   /* The table shouldn't have grown to hold the deleted entries. */
+   assert(st->size <= 256);
+
+   _mesa_swiss_table_destroy(st, NULL);
+
+   return 0;
+}
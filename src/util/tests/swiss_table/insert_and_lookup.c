@@ -0,0 +1,95 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <string.h>
+#include "swiss_table.h"
+
+#define SIZE 10000
+
+static uint32_t
+key_value(const void *key)
+{
+   return *(const uint32_t *)key;
+}
+
+static bool
+uint32_t_key_equals(const void *a, const void *b)
+{
+   return key_value(a) == key_value(b);
+}
+
+int
+main(int argc, char **argv)
+{
+   struct swiss_table *st;
+   struct hash_entry *entry;
+   uint32_t keys[SIZE];
+   uint32_t i, count;
+
+   (void) argc;
+   (void) argv;
+
+   st = _mesa_swiss_table_create(NULL, key_value, uint32_t_key_equals);
+
+   for (i = 0; i < SIZE; i++) {
+      keys[i] = i;
+      entry = _mesa_swiss_table_insert(st, keys + i, keys + i);
+      assert(entry && entry->key == keys + i);
+   }
+   assert(_mesa_swiss_table_num_entries(st) == SIZE);
+
+   for (i = 0; i < SIZE; i++) {
+      entry = _mesa_swiss_table_search(st, keys + i);
+      assert(entry);
+      assert(key_value(entry->key) == i);
+      assert(entry->data == keys + i);
+   }
+
+   i = SIZE;
+   assert(!_mesa_swiss_table_search(st, &i));
+
+   /* Inserting an existing key replaces its data. */
+   entry = _mesa_swiss_table_insert(st, keys + 42, NULL);
+   assert(entry->data == NULL);
+   assert(_mesa_swiss_table_num_entries(st) == SIZE);
+
+   /* Iteration visits every entry once. */
+   count = 0;
+   swiss_table_foreach(st, entry) {
+      assert(key_value(entry->key) < SIZE);
+      count++;
+   }
+   assert(count == SIZE);
+
+   _mesa_swiss_table_clear(st, NULL);
+   assert(_mesa_swiss_table_num_entries(st) == 0);
+   assert(!_mesa_swiss_table_search(st, keys));
+   assert(!_mesa_swiss_table_next_entry(st, NULL));
+
+   _mesa_swiss_table_destroy(st, NULL);
+
+   return 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Compares struct swiss_table with struct hash_table: insertion, lookups
+ * of present and missing keys, removal and iteration, for pointer keys and
+ * for keys compared through a callback.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hash_table.h"
+#include "os_time.h"
+#include "swiss_table.h"
+
+#define NUM_KEYS (1 << 20)
+#define NUM_ROUNDS 4
+
+static uint32_t
+key_value(const void *key)
+{
+   return *(const uint32_t *)key;
+}
+
+static bool
+uint32_t_key_equals(const void *a, const void *b)
+{
+   return key_value(a) == key_value(b);
+}
+
+struct results {
+   int64_t insert, search, search_miss, iterate, remove;
+};
+
+static volatile uintptr_t sink;
+
+#define TIME(result, code)                          \
+   do {                                             \
+      int64_t start = os_time_get_nano();           \
+      code;                                         \
+      result += os_time_get_nano() - start;         \
+   } while (0)
+
+static void
+bench_hash_table(struct hash_table *ht, const void **keys,
+                 const void **missing, struct results *r)
+{
+   uintptr_t sum = 0;
+
+   TIME(r->insert,
+        for (unsigned i = 0; i < NUM_KEYS; i++)
+           _mesa_hash_table_insert(ht, keys[i], NULL));
+   TIME(r->search,
+        for (unsigned i = 0; i < NUM_KEYS; i++)
+           sum += (uintptr_t) _mesa_hash_table_search(ht, keys[i]));
+   TIME(r->search_miss,
+        for (unsigned i = 0; i < NUM_KEYS; i++)
+           sum += (uintptr_t) _mesa_hash_table_search(ht, missing[i]));
+   TIME(r->iterate,
+        hash_table_foreach(ht, entry)
+           sum += (uintptr_t) entry->key);
+   TIME(r->remove,
+        for (unsigned i = 0; i < NUM_KEYS; i++)
+           _mesa_hash_table_remove_key(ht, keys[i]));
+
+   sink = sum;
+}
+
+static void
+bench_swiss_table(struct swiss_table *st, const void **keys,
+                  const void **missing, struct results *r)
+{
+   uintptr_t sum = 0;
+
+   TIME(r->insert,
+        for (unsigned i = 0; i < NUM_KEYS; i++)
+           _mesa_swiss_table_insert(st, keys[i], NULL));
+   TIME(r->search,
+        for (unsigned i = 0; i < NUM_KEYS; i++)
+           sum += (uintptr_t) _mesa_swiss_table_search(st, keys[i]));
+   TIME(r->search_miss,
+        for (unsigned i = 0; i < NUM_KEYS; i++)
+           sum += (uintptr_t) _mesa_swiss_table_search(st, missing[i]));
+   TIME(r->iterate,
+        swiss_table_foreach(st, entry)
+           sum += (uintptr_t) entry->key);
+   TIME(r->remove,
+        for (unsigned i = 0; i < NUM_KEYS; i++)
+           _mesa_swiss_table_remove_key(st, keys[i]));
+
+   sink = sum;
+}
+
+static void
+print_results(const char *name, const struct results *r)
+{
+   /* Nanoseconds per key. */
+   const double n = (double) NUM_KEYS * NUM_ROUNDS;
+
+   printf("%-28s %8.1f %8.1f %8.1f %8.1f %8.1f\n", name,
+          r->insert / n, r->search / n, r->search_miss / n, r->iterate / n,
+          r->remove / n);
+}
+
+int
+main(int argc, char **argv)
+{
+   const void **keys = malloc(NUM_KEYS * sizeof(*keys));
+   const void **missing = malloc(NUM_KEYS * sizeof(*missing));
+   uint32_t *values = malloc(2 * NUM_KEYS * sizeof(*values));
+   struct results r[4] = { 0 };
+
+   if (!keys || !missing || !values)
+      return 1;
+
+   /* Shuffled values, half of them in the tables, with pointers to them as
+    * the keys, like the instructions and variables NIR passes put in
+    * tables.
+    */
+   for (unsigned i = 0; i < 2 * NUM_KEYS; i++)
+      values[i] = i;
+   srand(1);
+   for (unsigned i = 2 * NUM_KEYS - 1; i > 0; i--) {
+      unsigned j = rand() % (i + 1);
+      uint32_t tmp = values[i];
+      values[i] = values[j];
+      values[j] = tmp;
+   }
+   for (unsigned i = 0; i < NUM_KEYS; i++) {
+      keys[i] = &values[i];
+      missing[i] = &values[NUM_KEYS + i];
+   }
+
+   for (unsigned round = 0; round < NUM_ROUNDS; round++) {
+      struct hash_table *ht;
+      struct swiss_table *st;
+
+      ht = _mesa_pointer_hash_table_create(NULL);
+      bench_hash_table(ht, keys, missing, &r[0]);
+      _mesa_hash_table_destroy(ht, NULL);
+
+      st = _mesa_pointer_swiss_table_create(NULL);
+      bench_swiss_table(st, keys, missing, &r[1]);
+      _mesa_swiss_table_destroy(st, NULL);
+
+      ht = _mesa_hash_table_create(NULL, key_value, uint32_t_key_equals);
+      bench_hash_table(ht, keys, missing, &r[2]);
+      _mesa_hash_table_destroy(ht, NULL);
+
+      st = _mesa_swiss_table_create(NULL, key_value, uint32_t_key_equals);
+      bench_swiss_table(st, keys, missing, &r[3]);
+      _mesa_swiss_table_destroy(st, NULL);
+   }
+
+   printf("%u keys, ns per key\n\n", NUM_KEYS);
+   printf("%-28s %8s %8s %8s %8s %8s\n", "", "insert", "search", "miss",
+          "iterate", "remove");
+   print_results("hash_table, pointer keys", &r[0]);
+   print_results("swiss_table, pointer keys", &r[1]);
+   print_results("hash_table, callback keys", &r[2]);
+   print_results("swiss_table, callback keys", &r[3]);
+
+   free(keys);
+   free(missing);
+   free(values);
+
+   return 0;
+}
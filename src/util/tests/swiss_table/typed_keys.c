@@ -0,0 +1,88 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <string.h>
+#include "swiss_table.h"
+
+#define SIZE 10000
+
+static unsigned delete_count;
+
+static void
+count_delete(struct hash_entry *entry)
+{
+   delete_count++;
+}
+
+int
+main(int argc, char **argv)
+{
+   struct swiss_table *st, *clone;
+   struct hash_entry *entry;
+   uint64_t keys[SIZE];
+   uint32_t i;
+
+   (void) argc;
+   (void) argv;
+
+   /* Integer keys cast to pointers, NULL included. */
+   st = _mesa_pointer_swiss_table_create(NULL);
+   for (i = 0; i < SIZE; i++)
+      _mesa_swiss_table_insert(st, (void *)(uintptr_t) i, (void *)(uintptr_t) i);
+
+   for (i = 0; i < SIZE; i++) {
+      entry = _mesa_swiss_table_search(st, (void *)(uintptr_t) i);
+      assert(entry && entry->data == (void *)(uintptr_t) i);
+   }
+   assert(!_mesa_swiss_table_search(st, (void *)(uintptr_t) SIZE));
+
+   clone = _mesa_swiss_table_clone(st, NULL);
+   _mesa_swiss_table_remove_key(st, NULL);
+   assert(!_mesa_swiss_table_search(st, NULL));
+   assert(_mesa_swiss_table_search(clone, NULL));
+
+   _mesa_swiss_table_destroy(clone, count_delete);
+   assert(delete_count == SIZE);
+   _mesa_swiss_table_destroy(st, NULL);
+
+   /* 64-bit keys, differing only in their top bits. */
+   st = _mesa_u64_swiss_table_create(NULL);
+   for (i = 0; i < SIZE; i++) {
+      keys[i] = (uint64_t) i << 40;
+      _mesa_swiss_table_insert(st, &keys[i], NULL);
+   }
+
+   for (i = 0; i < SIZE; i++) {
+      uint64_t key = (uint64_t) i << 40;
+      entry = _mesa_swiss_table_search(st, &key);
+      assert(entry && entry->key == &keys[i]);
+   }
+   assert(_mesa_swiss_table_num_entries(st) == SIZE);
+
+   _mesa_swiss_table_destroy(st, NULL);
+
+   return 0;
+}
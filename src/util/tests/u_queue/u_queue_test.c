@@ -0,0 +1,277 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "u_queue.h"
+
+#define NUM_JOBS 256
+
+struct job {
+   struct util_queue_fence fence;
+   unsigned index;
+   unsigned order;
+};
+
+static unsigned num_executed;
+static unsigned errors;
+
+static void
+check(bool cond, const char *what)
+{
+   if (!cond) {
+      fprintf(stderr, "FAIL: %s\n", what);
+      errors++;
+   }
+}
+
+static void
+execute(void *data, int thread_index)
+{
+   struct job *job = data;
+   job->order = p_atomic_inc_return(&num_executed);
+}
+
+/* Holds the thread it runs on until the test signals the gate. */
+static void
+execute_gate(void *data, int thread_index)
+{
+   util_queue_fence_wait(data);
+}
+
+static void
+init_jobs(struct job *jobs, unsigned count)
+{
+   num_executed = 0;
+   for (unsigned i = 0; i < count; i++) {
+      util_queue_fence_init(&jobs[i].fence);
+      jobs[i].index = i;
+      jobs[i].order = 0;
+   }
+}
+
+static void
+fini_jobs(struct job *jobs, unsigned count)
+{
+   for (unsigned i = 0; i < count; i++)
+      util_queue_fence_destroy(&jobs[i].fence);
+}
+
+/* Higher priorities first, and in order within a priority. */
+static void
+test_priorities(void)
+{
+   struct util_queue queue;
+   struct util_queue_fence gate, gate_done;
+   struct job jobs[3 * 8];
+
+   util_queue_init(&queue, "prio", 32, 1, UTIL_QUEUE_INIT_WORK_STEALING);
+   init_jobs(jobs, ARRAY_SIZE(jobs));
+
+   util_queue_fence_init(&gate);
+   util_queue_fence_init(&gate_done);
+   util_queue_fence_reset(&gate);
+   util_queue_add_job(&queue, &gate, &gate_done, execute_gate, NULL);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(jobs); i++) {
+      enum util_queue_priority prio = UTIL_QUEUE_NUM_PRIORITIES - 1 - i % 3;
+      util_queue_add_job_with_priority(&queue, &jobs[i], &jobs[i].fence,
+                                       execute, NULL, prio);
+   }
+
+   util_queue_fence_signal(&gate);
+   util_queue_finish(&queue);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(jobs); i++) {
+      unsigned prio = UTIL_QUEUE_NUM_PRIORITIES - 1 - i % 3;
+      check(jobs[i].order == prio * 8 + i / 3 + 1, "priority order");
+   }
+
+   util_queue_destroy(&queue);
+   fini_jobs(jobs, ARRAY_SIZE(jobs));
+   util_queue_fence_destroy(&gate);
+   util_queue_fence_destroy(&gate_done);
+}
+
+/* Chains of jobs depending on the previous ones. */
+static void
+test_dependencies(unsigned flags, unsigned num_threads)
+{
+   struct util_queue queue;
+   static struct job jobs[NUM_JOBS];
+
+   util_queue_init(&queue, "deps", 8, num_threads,
+                   flags | UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+   init_jobs(jobs, NUM_JOBS);
+
+   for (unsigned i = 0; i < NUM_JOBS; i++) {
+      struct util_queue_fence *deps[2];
+      unsigned num_deps = 0;
+
+      if (i >= 1)
+         deps[num_deps++] = &jobs[i - 1].fence;
+      if (i >= 7)
+         deps[num_deps++] = &jobs[i - 7].fence;
+
+      util_queue_add_job_after(&queue, &jobs[i], &jobs[i].fence, execute, NULL,
+                               i % 2 ? UTIL_QUEUE_PRIORITY_HIGH :
+                                       UTIL_QUEUE_PRIORITY_LOW,
+                               deps, num_deps);
+   }
+
+   util_queue_finish(&queue);
+
+   for (unsigned i = 0; i < NUM_JOBS; i++) {
+      check(util_queue_fence_is_signalled(&jobs[i].fence), "deps signalled");
+      check(jobs[i].order == i + 1, "deps order");
+   }
+
+   util_queue_destroy(&queue);
+   fini_jobs(jobs, NUM_JOBS);
+}
+
+/* A dependency that isn't a job of the queue. */
+static void
+test_external_dependency(unsigned flags)
+{
+   struct util_queue queue;
+   struct util_queue_fence external;
+   struct util_queue_fence *dep = &external;
+   struct job jobs[2];
+
+   util_queue_init(&queue, "ext", 8, 2, flags);
+   init_jobs(jobs, 2);
+   util_queue_fence_init(&external);
+   util_queue_fence_reset(&external);
+
+   util_queue_add_job_after(&queue, &jobs[0], &jobs[0].fence, execute, NULL,
+                            UTIL_QUEUE_PRIORITY_NORMAL, &dep, 1);
+   util_queue_add_job_after(&queue, &jobs[1], &jobs[1].fence, execute, NULL,
+                            UTIL_QUEUE_PRIORITY_NORMAL, &dep, 1);
+
+   /* Dropping a blocked job signals it without executing it. */
+   util_queue_drop_job(&queue, &jobs[1].fence);
+   check(util_queue_fence_is_signalled(&jobs[1].fence), "dropped signalled");
+
+   check(!util_queue_fence_wait_timeout(&jobs[0].fence,
+                                        os_time_get_absolute_timeout(10000000)),
+         "blocked job didn't run");
+
+   util_queue_fence_signal(&external);
+   util_queue_fence_wait(&jobs[0].fence);
+   check(jobs[0].order == 1 && jobs[1].order == 0, "external dependency");
+
+   util_queue_destroy(&queue);
+   fini_jobs(jobs, 2);
+   util_queue_fence_destroy(&external);
+}
+
+/* Threads are added while jobs pile up, and all of them are used. */
+static void
+test_scale_threads(void)
+{
+   struct util_queue queue;
+   struct util_queue_fence gate, gate_done[4];
+
+   util_queue_init(&queue, "scale", 8, 4,
+                   UTIL_QUEUE_INIT_WORK_STEALING |
+                   UTIL_QUEUE_INIT_SCALE_THREADS);
+   check(queue.num_threads == 1, "one thread at first");
+
+   util_queue_fence_init(&gate);
+   util_queue_fence_reset(&gate);
+   for (unsigned i = 0; i < 4; i++) {
+      util_queue_fence_init(&gate_done[i]);
+      util_queue_add_job(&queue, &gate, &gate_done[i], execute_gate, NULL);
+   }
+
+   check(queue.num_threads == 4, "threads added");
+
+   util_queue_fence_signal(&gate);
+   util_queue_finish(&queue);
+
+   /* Not more than util_queue_adjust_num_threads allows. */
+   util_queue_adjust_num_threads(&queue, 2);
+   check(queue.num_threads == 2, "threads removed");
+
+   util_queue_fence_reset(&gate);
+   for (unsigned i = 0; i < 4; i++)
+      util_queue_add_job(&queue, &gate, &gate_done[i], execute_gate, NULL);
+
+   check(queue.num_threads == 2, "threads limited");
+
+   util_queue_fence_signal(&gate);
+   util_queue_finish(&queue);
+
+   util_queue_destroy(&queue);
+   for (unsigned i = 0; i < 4; i++)
+      util_queue_fence_destroy(&gate_done[i]);
+   util_queue_fence_destroy(&gate);
+}
+
+/* Lots of independent jobs stolen by all the threads. */
+static void
+test_stealing(void)
+{
+   struct util_queue queue;
+   static struct job jobs[NUM_JOBS * 16];
+
+   util_queue_init(&queue, "steal", 8, 4, UTIL_QUEUE_INIT_WORK_STEALING);
+   init_jobs(jobs, ARRAY_SIZE(jobs));
+
+   for (unsigned i = 0; i < ARRAY_SIZE(jobs); i++) {
+      util_queue_add_job_with_priority(&queue, &jobs[i], &jobs[i].fence,
+                                       execute, NULL, i % 3);
+      check(p_atomic_read(&queue.num_queued) <= 8, "max_jobs");
+   }
+
+   for (unsigned i = 0; i < ARRAY_SIZE(jobs); i += 5)
+      util_queue_drop_job(&queue, &jobs[i].fence);
+
+   util_queue_finish(&queue);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(jobs); i++)
+      check(util_queue_fence_is_signalled(&jobs[i].fence), "all signalled");
+   check(num_executed <= ARRAY_SIZE(jobs) &&
+         num_executed >= ARRAY_SIZE(jobs) * 4 / 5, "all executed");
+
+   util_queue_destroy(&queue);
+   fini_jobs(jobs, ARRAY_SIZE(jobs));
+}
+
+int
+main(void)
+{
+   test_priorities();
+   test_dependencies(0, 1);
+   test_dependencies(0, 4);
+   test_dependencies(UTIL_QUEUE_INIT_WORK_STEALING, 1);
+   test_dependencies(UTIL_QUEUE_INIT_WORK_STEALING, 4);
+   test_external_dependency(0);
+   test_external_dependency(UTIL_QUEUE_INIT_WORK_STEALING);
+   test_scale_threads();
+   test_stealing();
+
+   return errors ? 1 : 0;
+}
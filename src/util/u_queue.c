@@ -224,10 +224,357 @@ util_queue_fence_destroy(struct util_queue_fence *fence)
 }
 #endif
 
+/****************************************************************************
+ * Work stealing deques
+ */
+
+static bool
+util_queue_ring_push(struct util_queue_ring *ring,
+                     const struct util_queue_job *job)
+{
+   if (ring->count == ring->size) {
+      unsigned new_size = MAX2(ring->size * 2, 8);
+      struct util_queue_job *jobs =
+         (struct util_queue_job*)malloc(new_size * sizeof(*jobs));
+
+      if (!jobs)
+         return false;
+
+      for (unsigned i = 0; i < ring->count; i++)
+         jobs[i] = ring->jobs[(ring->head + i) % ring->size];
+
+      free(ring->jobs);
+      ring->jobs = jobs;
+      ring->size = new_size;
+      ring->head = 0;
+   }
+
+   ring->jobs[(ring->head + ring->count) % ring->size] = *job;
+   /* Read without the deque lock by util_queue_get_job. */
+   p_atomic_inc(&ring->count);
+   return true;
+}
+
+/* The owner takes the oldest job, thieves the newest. */
+static bool
+util_queue_ring_pop(struct util_queue_ring *ring, bool steal,
+                    struct util_queue_job *job)
+{
+   if (!ring->count)
+      return false;
+
+   if (steal) {
+      *job = ring->jobs[(ring->head + ring->count - 1) % ring->size];
+   } else {
+      *job = ring->jobs[ring->head];
+      ring->head = (ring->head + 1) % ring->size;
+   }
+   p_atomic_dec(&ring->count);
+   return true;
+}
+
+/* Take the highest priority job, from our own deque first. */
+static bool
+util_queue_get_job(struct util_queue *queue, unsigned thread_index,
+                   struct util_queue_job *job)
+{
+   for (unsigned prio = 0; prio < UTIL_QUEUE_NUM_PRIORITIES; prio++) {
+      for (unsigned i = 0; i < queue->max_threads; i++) {
+         unsigned index = (thread_index + i) % queue->max_threads;
+         struct util_queue_deque *deque = &queue->deques[index];
+         bool found;
+
+         if (!p_atomic_read(&deque->rings[prio].count))
+            continue;
+
+         mtx_lock(&deque->lock);
+         found = util_queue_ring_pop(&deque->rings[prio], index != thread_index,
+                                     job);
+         mtx_unlock(&deque->lock);
+
+         if (found)
+            return true;
+      }
+   }
+
+   return false;
+}
+
 /****************************************************************************
  * util_queue implementation
  */
 
+static bool
+util_queue_deps_signalled(struct util_queue_fence **deps, unsigned num_deps)
+{
+   for (unsigned i = 0; i < num_deps; i++) {
+      if (!util_queue_fence_is_signalled(deps[i]))
+         return false;
+   }
+   return true;
+}
+
+/* Make the ring buffer larger, for UTIL_QUEUE_INIT_RESIZE_IF_FULL. */
+static void
+util_queue_resize_locked(struct util_queue *queue)
+{
+   unsigned new_max_jobs = queue->max_jobs + 8;
+   struct util_queue_job *jobs =
+      (struct util_queue_job*)calloc(new_max_jobs,
+                                     sizeof(struct util_queue_job));
+   assert(jobs);
+
+   /* Copy all queued jobs into the new list. */
+   unsigned num_jobs = 0;
+   unsigned i = queue->read_idx;
+
+   do {
+      jobs[num_jobs++] = queue->jobs[i];
+      i = (i + 1) % queue->max_jobs;
+   } while (i != queue->write_idx);
+
+   assert(num_jobs == queue->num_queued);
+
+   free(queue->jobs);
+   queue->jobs = jobs;
+   queue->read_idx = 0;
+   queue->write_idx = num_jobs;
+   queue->max_jobs = new_max_jobs;
+}
+
+/* Queue a job whose dependencies are signalled. Returns false if the ring
+ * buffer is full.
+ */
+static bool
+util_queue_push_locked(struct util_queue *queue,
+                       const struct util_queue_job *job,
+                       enum util_queue_priority priority)
+{
+   if (queue->deques) {
+      struct util_queue_deque *deque;
+      bool pushed;
+
+      if (p_atomic_read(&queue->num_queued) >= queue->max_jobs &&
+          !(queue->flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL))
+         return false;
+
+      deque = &queue->deques[queue->next_deque++ % queue->num_threads];
+
+      mtx_lock(&deque->lock);
+      pushed = util_queue_ring_push(&deque->rings[priority], job);
+      mtx_unlock(&deque->lock);
+      assert(pushed);
+      if (!pushed)
+         return false;
+
+      p_atomic_inc(&queue->num_queued);
+   } else {
+      struct util_queue_job *ptr;
+
+      assert(queue->num_queued >= 0 && queue->num_queued <= queue->max_jobs);
+
+      if (queue->num_queued == queue->max_jobs) {
+         if (!(queue->flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL))
+            return false;
+
+         /* If the queue is full, make it larger to avoid waiting for a free
+          * slot.
+          */
+         util_queue_resize_locked(queue);
+      }
+
+      ptr = &queue->jobs[queue->write_idx];
+      assert(ptr->job == NULL);
+      *ptr = *job;
+      queue->write_idx = (queue->write_idx + 1) % queue->max_jobs;
+
+      queue->num_queued++;
+   }
+
+   cnd_signal(&queue->has_queued_cond);
+   return true;
+}
+
+/* Queue the blocked jobs whose dependencies are signalled, in order. */
+static void
+util_queue_release_blocked_locked(struct util_queue *queue)
+{
+   unsigned num_blocked = 0;
+
+   for (unsigned i = 0; i < queue->num_blocked; i++) {
+      struct util_queue_blocked_job *blocked = &queue->blocked[i];
+
+      if (util_queue_deps_signalled(blocked->deps, blocked->num_deps) &&
+          util_queue_push_locked(queue, &blocked->job, blocked->priority)) {
+         free(blocked->deps);
+         queue->num_released++;
+         continue;
+      }
+
+      queue->blocked[num_blocked++] = *blocked;
+   }
+
+   p_atomic_set(&queue->num_blocked, num_blocked);
+}
+
+static void
+util_queue_block_job_locked(struct util_queue *queue,
+                            const struct util_queue_job *job,
+                            enum util_queue_priority priority,
+                            struct util_queue_fence **deps,
+                            unsigned num_deps)
+{
+   struct util_queue_blocked_job *blocked;
+
+   if (queue->num_blocked == queue->max_blocked) {
+      unsigned new_max_blocked = MAX2(queue->max_blocked * 2, 8);
+      blocked = (struct util_queue_blocked_job*)
+                realloc(queue->blocked, new_max_blocked * sizeof(*blocked));
+      assert(blocked);
+
+      queue->blocked = blocked;
+      queue->max_blocked = new_max_blocked;
+   }
+
+   blocked = &queue->blocked[queue->num_blocked];
+   blocked->job = *job;
+   blocked->priority = priority;
+   blocked->num_deps = num_deps;
+   blocked->deps = (struct util_queue_fence**)malloc(num_deps * sizeof(*deps));
+   assert(blocked->deps);
+   memcpy(blocked->deps, deps, num_deps * sizeof(*deps));
+
+   p_atomic_set(&queue->num_blocked, queue->num_blocked + 1);
+
+   /* Have an idle thread poll the dependencies. */
+   cnd_signal(&queue->has_queued_cond);
+}
+
+/* Wait for a job to be queued. Blocked jobs may depend on fences of other
+ * queues, which nothing tells us about, so poll them meanwhile.
+ */
+static void
+util_queue_wait_locked(struct util_queue *queue)
+{
+   queue->num_idle++;
+
+   if (queue->num_blocked) {
+      struct timespec ts;
+
+      timespec_get(&ts, TIME_UTC);
+      ts.tv_nsec += 1000000;
+      if (ts.tv_nsec >= (1000*1000*1000)) {
+         ts.tv_sec++;
+         ts.tv_nsec -= (1000*1000*1000);
+      }
+
+      cnd_timedwait(&queue->has_queued_cond, &queue->lock, &ts);
+      util_queue_release_blocked_locked(queue);
+   } else {
+      cnd_wait(&queue->has_queued_cond, &queue->lock);
+   }
+
+   queue->num_idle--;
+}
+
+static void
+util_queue_job_done(struct util_queue *queue)
+{
+   if (p_atomic_read(&queue->num_blocked)) {
+      mtx_lock(&queue->lock);
+      util_queue_release_blocked_locked(queue);
+      mtx_unlock(&queue->lock);
+   }
+
+   if (queue->deques && p_atomic_dec_zero(&queue->num_pending)) {
+      mtx_lock(&queue->lock);
+      cnd_broadcast(&queue->idle_cond);
+      mtx_unlock(&queue->lock);
+   }
+}
+
+/* Signal the fences of the jobs that won't be executed, when all threads
+ * are terminated.
+ */
+static void
+util_queue_signal_remaining_locked(struct util_queue *queue)
+{
+   if (queue->deques) {
+      for (unsigned i = 0; i < queue->max_threads; i++) {
+         struct util_queue_deque *deque = &queue->deques[i];
+         struct util_queue_job job;
+
+         mtx_lock(&deque->lock);
+         for (unsigned prio = 0; prio < UTIL_QUEUE_NUM_PRIORITIES; prio++) {
+            while (util_queue_ring_pop(&deque->rings[prio], false, &job)) {
+               if (job.job)
+                  util_queue_fence_signal(job.fence);
+            }
+         }
+         mtx_unlock(&deque->lock);
+      }
+      p_atomic_set(&queue->num_queued, 0);
+      p_atomic_set(&queue->num_pending, 0);
+      cnd_broadcast(&queue->idle_cond);
+   } else {
+      for (unsigned i = queue->read_idx; i != queue->write_idx;
+           i = (i + 1) % queue->max_jobs) {
+         if (queue->jobs[i].job) {
+            util_queue_fence_signal(queue->jobs[i].fence);
+            queue->jobs[i].job = NULL;
+         }
+      }
+      queue->read_idx = queue->write_idx;
+      queue->num_queued = 0;
+   }
+
+   for (unsigned i = 0; i < queue->num_blocked; i++) {
+      util_queue_fence_signal(queue->blocked[i].job.fence);
+      free(queue->blocked[i].deps);
+   }
+   p_atomic_set(&queue->num_blocked, 0);
+}
+
+static void
+util_queue_steal_loop(struct util_queue *queue, unsigned thread_index)
+{
+   while (1) {
+      struct util_queue_job job;
+
+      /* only kill threads that are above "num_threads" */
+      if (thread_index >= p_atomic_read(&queue->num_threads))
+         break;
+
+      if (!util_queue_get_job(queue, thread_index, &job)) {
+         /* wait if the queue is empty */
+         mtx_lock(&queue->lock);
+         while (thread_index < queue->num_threads &&
+                p_atomic_read(&queue->num_queued) == 0)
+            util_queue_wait_locked(queue);
+         mtx_unlock(&queue->lock);
+         continue;
+      }
+
+      p_atomic_dec(&queue->num_queued);
+
+      /* Wake up util_queue_add_job if it's waiting for a free slot. */
+      if (!(queue->flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL)) {
+         mtx_lock(&queue->lock);
+         cnd_signal(&queue->has_space_cond);
+         mtx_unlock(&queue->lock);
+      }
+
+      if (job.job) {
+         job.execute(job.job, thread_index);
+         util_queue_fence_signal(job.fence);
+         if (job.cleanup)
+            job.cleanup(job.job, thread_index);
+      }
+
+      util_queue_job_done(queue);
+   }
+}
+
 struct thread_input {
    struct util_queue *queue;
    int thread_index;
@@ -261,7 +608,7 @@ util_queue_thread_func(void *input)
       u_thread_setname(name);
    }
 
-   while (1) {
+   while (!queue->deques) {
       struct util_queue_job job;
 
       mtx_lock(&queue->lock);
@@ -269,7 +616,7 @@ util_queue_thread_func(void *input)
 
       /* wait if the queue is empty */
       while (thread_index < queue->num_threads && queue->num_queued == 0)
-         cnd_wait(&queue->has_queued_cond, &queue->lock);
+         util_queue_wait_locked(queue);
 
       /* only kill threads that are above "num_threads" */
       if (thread_index >= queue->num_threads) {
@@ -290,22 +637,18 @@ util_queue_thread_func(void *input)
          util_queue_fence_signal(job.fence);
          if (job.cleanup)
             job.cleanup(job.job, thread_index);
+
+         util_queue_job_done(queue);
       }
    }
 
+   if (queue->deques)
+      util_queue_steal_loop(queue, thread_index);
+
    /* signal remaining jobs if all threads are being terminated */
    mtx_lock(&queue->lock);
-   if (queue->num_threads == 0) {
-      for (unsigned i = queue->read_idx; i != queue->write_idx;
-           i = (i + 1) % queue->max_jobs) {
-         if (queue->jobs[i].job) {
-            util_queue_fence_signal(queue->jobs[i].fence);
-            queue->jobs[i].job = NULL;
-         }
-      }
-      queue->read_idx = queue->write_idx;
-      queue->num_queued = 0;
-   }
+   if (queue->num_threads == 0)
+      util_queue_signal_remaining_locked(queue);
    mtx_unlock(&queue->lock);
    return 0;
 }
@@ -350,6 +693,8 @@ util_queue_adjust_num_threads(struct util_queue *queue, unsigned num_threads)
    mtx_lock(&queue->finish_lock);
    unsigned old_num_threads = queue->num_threads;
 
+   p_atomic_set(&queue->scale_limit, num_threads);
+
    if (num_threads == old_num_threads) {
       mtx_unlock(&queue->finish_lock);
       return;
@@ -361,15 +706,27 @@ util_queue_adjust_num_threads(struct util_queue *queue, unsigned num_threads)
       return;
    }
 
+   /* util_queue_scale_threads adds the threads when they are needed. */
+   if (queue->flags & UTIL_QUEUE_INIT_SCALE_THREADS) {
+      mtx_unlock(&queue->finish_lock);
+      return;
+   }
+
    /* Create threads.
     *
     * We need to update num_threads first, because threads terminate
     * when thread_index < num_threads.
     */
-   queue->num_threads = num_threads;
+   mtx_lock(&queue->lock);
+   p_atomic_set(&queue->num_threads, num_threads);
+   mtx_unlock(&queue->lock);
    for (unsigned i = old_num_threads; i < num_threads; i++) {
-      if (!util_queue_create_thread(queue, i))
+      if (!util_queue_create_thread(queue, i)) {
+         mtx_lock(&queue->lock);
+         p_atomic_set(&queue->num_threads, i);
+         mtx_unlock(&queue->lock);
          break;
+      }
    }
    mtx_unlock(&queue->finish_lock);
 }
@@ -414,8 +771,12 @@ util_queue_init(struct util_queue *queue,
    queue->flags = flags;
    queue->max_threads = num_threads;
    queue->num_threads = num_threads;
+   queue->scale_limit = num_threads;
    queue->max_jobs = max_jobs;
 
+   if (flags & UTIL_QUEUE_INIT_SCALE_THREADS)
+      queue->num_threads = MIN2(num_threads, 1);
+
    queue->jobs = (struct util_queue_job*)
                  calloc(max_jobs, sizeof(struct util_queue_job));
    if (!queue->jobs)
@@ -427,13 +788,24 @@ util_queue_init(struct util_queue *queue,
    queue->num_queued = 0;
    cnd_init(&queue->has_queued_cond);
    cnd_init(&queue->has_space_cond);
+   cnd_init(&queue->idle_cond);
+
+   if (flags & UTIL_QUEUE_INIT_WORK_STEALING) {
+      queue->deques = (struct util_queue_deque*)
+                      calloc(num_threads, sizeof(struct util_queue_deque));
+      if (!queue->deques)
+         goto fail;
+
+      for (i = 0; i < num_threads; i++)
+         (void) mtx_init(&queue->deques[i].lock, mtx_plain);
+   }
 
    queue->threads = (thrd_t*) calloc(num_threads, sizeof(thrd_t));
    if (!queue->threads)
       goto fail;
 
    /* start threads */
-   for (i = 0; i < num_threads; i++) {
+   for (i = 0; i < queue->num_threads; i++) {
       if (!util_queue_create_thread(queue, i)) {
          if (i == 0) {
             /* no threads created, fail */
@@ -452,7 +824,14 @@ util_queue_init(struct util_queue *queue,
 fail:
    free(queue->threads);
 
+   if (queue->deques) {
+      for (i = 0; i < num_threads; i++)
+         mtx_destroy(&queue->deques[i].lock);
+      free(queue->deques);
+   }
+
    if (queue->jobs) {
+      cnd_destroy(&queue->idle_cond);
       cnd_destroy(&queue->has_space_cond);
       cnd_destroy(&queue->has_queued_cond);
       mtx_destroy(&queue->lock);
@@ -483,7 +862,7 @@ util_queue_kill_threads(struct util_queue *queue, unsigned keep_num_threads,
    /* Setting num_threads is what causes the threads to terminate.
     * Then cnd_broadcast wakes them up and they will exit their function.
     */
-   queue->num_threads = keep_num_threads;
+   p_atomic_set(&queue->num_threads, keep_num_threads);
    cnd_broadcast(&queue->has_queued_cond);
    mtx_unlock(&queue->lock);
 
@@ -500,22 +879,75 @@ util_queue_destroy(struct util_queue *queue)
    util_queue_kill_threads(queue, 0, false);
    remove_from_atexit_list(queue);
 
+   if (queue->deques) {
+      for (unsigned i = 0; i < queue->max_threads; i++) {
+         for (unsigned prio = 0; prio < UTIL_QUEUE_NUM_PRIORITIES; prio++)
+            free(queue->deques[i].rings[prio].jobs);
+         mtx_destroy(&queue->deques[i].lock);
+      }
+      free(queue->deques);
+   }
+
+   cnd_destroy(&queue->idle_cond);
    cnd_destroy(&queue->has_space_cond);
    cnd_destroy(&queue->has_queued_cond);
    mtx_destroy(&queue->finish_lock);
    mtx_destroy(&queue->lock);
+   free(queue->blocked);
    free(queue->jobs);
    free(queue->threads);
 }
 
+/* Add a thread if there are more queued jobs than idle threads, for
+ * UTIL_QUEUE_INIT_SCALE_THREADS.
+ */
+static void
+util_queue_scale_threads(struct util_queue *queue)
+{
+   /* util_queue_finish adds jobs with finish_lock held. */
+   if (mtx_trylock(&queue->finish_lock) != thrd_success)
+      return;
+
+   unsigned index = queue->num_threads;
+
+   /* Not if the threads are being terminated. */
+   if (index > 0 && index < queue->scale_limit) {
+      /* We need to update num_threads first, because threads terminate
+       * when thread_index < num_threads.  The threads and
+       * util_queue_push_locked read it with the lock held.
+       */
+      mtx_lock(&queue->lock);
+      p_atomic_set(&queue->num_threads, index + 1);
+      mtx_unlock(&queue->lock);
+
+      if (!util_queue_create_thread(queue, index)) {
+         mtx_lock(&queue->lock);
+         p_atomic_set(&queue->num_threads, index);
+         mtx_unlock(&queue->lock);
+      }
+   }
+   mtx_unlock(&queue->finish_lock);
+}
+
 void
-util_queue_add_job(struct util_queue *queue,
-                   void *job,
-                   struct util_queue_fence *fence,
-                   util_queue_execute_func execute,
-                   util_queue_execute_func cleanup)
+util_queue_add_job_after(struct util_queue *queue,
+                         void *job,
+                         struct util_queue_fence *fence,
+                         util_queue_execute_func execute,
+                         util_queue_execute_func cleanup,
+                         enum util_queue_priority priority,
+                         struct util_queue_fence **deps,
+                         unsigned num_deps)
 {
-   struct util_queue_job *ptr;
+   struct util_queue_job entry;
+   bool scale;
+
+   assert(priority < UTIL_QUEUE_NUM_PRIORITIES);
+
+   entry.job = job;
+   entry.fence = fence;
+   entry.execute = execute;
+   entry.cleanup = cleanup;
 
    mtx_lock(&queue->lock);
    if (queue->num_threads == 0) {
@@ -528,53 +960,49 @@ util_queue_add_job(struct util_queue *queue,
 
    util_queue_fence_reset(fence);
 
-   assert(queue->num_queued >= 0 && queue->num_queued <= queue->max_jobs);
+   if (queue->deques)
+      p_atomic_inc(&queue->num_pending);
 
-   if (queue->num_queued == queue->max_jobs) {
-      if (queue->flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL) {
-         /* If the queue is full, make it larger to avoid waiting for a free
-          * slot.
-          */
-         unsigned new_max_jobs = queue->max_jobs + 8;
-         struct util_queue_job *jobs =
-            (struct util_queue_job*)calloc(new_max_jobs,
-                                           sizeof(struct util_queue_job));
-         assert(jobs);
-
-         /* Copy all queued jobs into the new list. */
-         unsigned num_jobs = 0;
-         unsigned i = queue->read_idx;
-
-         do {
-            jobs[num_jobs++] = queue->jobs[i];
-            i = (i + 1) % queue->max_jobs;
-         } while (i != queue->write_idx);
-
-         assert(num_jobs == queue->num_queued);
-
-         free(queue->jobs);
-         queue->jobs = jobs;
-         queue->read_idx = 0;
-         queue->write_idx = num_jobs;
-         queue->max_jobs = new_max_jobs;
-      } else {
-         /* Wait until there is a free slot. */
-         while (queue->num_queued == queue->max_jobs)
-            cnd_wait(&queue->has_space_cond, &queue->lock);
-      }
+   if (!util_queue_deps_signalled(deps, num_deps)) {
+      util_queue_block_job_locked(queue, &entry, priority, deps, num_deps);
+      mtx_unlock(&queue->lock);
+      return;
    }
 
-   ptr = &queue->jobs[queue->write_idx];
-   assert(ptr->job == NULL);
-   ptr->job = job;
-   ptr->fence = fence;
-   ptr->execute = execute;
-   ptr->cleanup = cleanup;
-   queue->write_idx = (queue->write_idx + 1) % queue->max_jobs;
+   /* Wait until there is a free slot. */
+   while (!util_queue_push_locked(queue, &entry, priority))
+      cnd_wait(&queue->has_space_cond, &queue->lock);
 
-   queue->num_queued++;
-   cnd_signal(&queue->has_queued_cond);
+   scale = (queue->flags & UTIL_QUEUE_INIT_SCALE_THREADS) &&
+           queue->num_threads < p_atomic_read(&queue->scale_limit) &&
+           p_atomic_read(&queue->num_queued) > (int)queue->num_idle;
    mtx_unlock(&queue->lock);
+
+   if (scale)
+      util_queue_scale_threads(queue);
+}
+
+void
+util_queue_add_job_with_priority(struct util_queue *queue,
+                                 void *job,
+                                 struct util_queue_fence *fence,
+                                 util_queue_execute_func execute,
+                                 util_queue_execute_func cleanup,
+                                 enum util_queue_priority priority)
+{
+   util_queue_add_job_after(queue, job, fence, execute, cleanup, priority,
+                            NULL, 0);
+}
+
+void
+util_queue_add_job(struct util_queue *queue,
+                   void *job,
+                   struct util_queue_fence *fence,
+                   util_queue_execute_func execute,
+                   util_queue_execute_func cleanup)
+{
+   util_queue_add_job_after(queue, job, fence, execute, cleanup,
+                            UTIL_QUEUE_PRIORITY_NORMAL, NULL, 0);
 }
 
 /**
@@ -596,7 +1024,52 @@ util_queue_drop_job(struct util_queue *queue, struct util_queue_fence *fence)
       return;
 
    mtx_lock(&queue->lock);
-   for (unsigned i = queue->read_idx; i != queue->write_idx;
+   for (unsigned i = 0; i < queue->num_blocked; i++) {
+      struct util_queue_blocked_job *blocked = &queue->blocked[i];
+
+      if (blocked->job.fence == fence) {
+         if (blocked->job.cleanup)
+            blocked->job.cleanup(blocked->job.job, -1);
+
+         free(blocked->deps);
+         memmove(blocked, blocked + 1,
+                 (queue->num_blocked - i - 1) * sizeof(*blocked));
+         p_atomic_set(&queue->num_blocked, queue->num_blocked - 1);
+
+         if (queue->deques && p_atomic_dec_zero(&queue->num_pending))
+            cnd_broadcast(&queue->idle_cond);
+         removed = true;
+         break;
+      }
+   }
+
+   for (unsigned t = 0; queue->deques && !removed && t < queue->max_threads;
+        t++) {
+      struct util_queue_deque *deque = &queue->deques[t];
+
+      mtx_lock(&deque->lock);
+      for (unsigned prio = 0; prio < UTIL_QUEUE_NUM_PRIORITIES; prio++) {
+         struct util_queue_ring *ring = &deque->rings[prio];
+
+         for (unsigned i = 0; !removed && i < ring->count; i++) {
+            struct util_queue_job *job =
+               &ring->jobs[(ring->head + i) % ring->size];
+
+            if (job->fence == fence) {
+               if (job->cleanup)
+                  job->cleanup(job->job, -1);
+
+               /* Just clear it. The threads will treat as a no-op job. */
+               memset(job, 0, sizeof(*job));
+               removed = true;
+            }
+         }
+      }
+      mtx_unlock(&deque->lock);
+   }
+
+   for (unsigned i = queue->read_idx;
+        !queue->deques && !removed && i != queue->write_idx;
         i = (i + 1) % queue->max_jobs) {
       if (queue->jobs[i].fence == fence) {
          if (queue->jobs[i].cleanup)
@@ -631,6 +1104,19 @@ util_queue_finish(struct util_queue *queue)
 {
    util_barrier barrier;
    struct util_queue_fence *fences;
+   unsigned num_released;
+   bool again;
+
+   /* Barrier jobs could overtake jobs of a lower priority, so wait for all
+    * jobs to be done instead. That also waits for the jobs added meanwhile.
+    */
+   if (queue->deques) {
+      mtx_lock(&queue->lock);
+      while (p_atomic_read(&queue->num_pending))
+         cnd_wait(&queue->idle_cond, &queue->lock);
+      mtx_unlock(&queue->lock);
+      return;
+   }
 
    /* If 2 threads were adding jobs for 2 different barries at the same time,
     * a deadlock would happen, because 1 barrier requires that all threads
@@ -638,20 +1124,34 @@ util_queue_finish(struct util_queue *queue)
     */
    mtx_lock(&queue->finish_lock);
    fences = malloc(queue->num_threads * sizeof(*fences));
-   util_barrier_init(&barrier, queue->num_threads);
 
-   for (unsigned i = 0; i < queue->num_threads; ++i) {
-      util_queue_fence_init(&fences[i]);
-      util_queue_add_job(queue, &barrier, &fences[i], util_queue_finish_execute, NULL);
-   }
+   /* Blocked jobs are only queued once their dependencies are done, after
+    * the barrier jobs.
+    */
+   do {
+      mtx_lock(&queue->lock);
+      num_released = queue->num_released;
+      mtx_unlock(&queue->lock);
 
-   for (unsigned i = 0; i < queue->num_threads; ++i) {
-      util_queue_fence_wait(&fences[i]);
-      util_queue_fence_destroy(&fences[i]);
-   }
-   mtx_unlock(&queue->finish_lock);
+      util_barrier_init(&barrier, queue->num_threads);
 
-   util_barrier_destroy(&barrier);
+      for (unsigned i = 0; i < queue->num_threads; ++i) {
+         util_queue_fence_init(&fences[i]);
+         util_queue_add_job(queue, &barrier, &fences[i], util_queue_finish_execute, NULL);
+      }
+
+      for (unsigned i = 0; i < queue->num_threads; ++i) {
+         util_queue_fence_wait(&fences[i]);
+         util_queue_fence_destroy(&fences[i]);
+      }
+
+      util_barrier_destroy(&barrier);
+
+      mtx_lock(&queue->lock);
+      again = queue->num_blocked || queue->num_released != num_released;
+      mtx_unlock(&queue->lock);
+   } while (again);
+   mtx_unlock(&queue->finish_lock);
 
    free(fences);
 }
@@ -28,6 +28,16 @@
  *
  * Jobs can be added from any thread. After that, the wait call can be used
  * to wait for completion of the job.
+ *
+ * By default, jobs are executed in order from a single ring buffer. With
+ * UTIL_QUEUE_INIT_WORK_STEALING, each thread has its own deques, one per
+ * priority, jobs are spread over them and idle threads steal jobs from the
+ * others. Higher priority jobs are then always started first, and jobs of
+ * the same priority in order if there's only one thread.
+ *
+ * Jobs can depend on the fences of other jobs of the same queue, in which
+ * case they are only queued once those are signalled. Other fences are
+ * polled while the queue is idle.
  */
 
 #ifndef U_QUEUE_H
@@ -49,6 +59,11 @@ extern "C" {
 #define UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY      (1 << 0)
 #define UTIL_QUEUE_INIT_RESIZE_IF_FULL            (1 << 1)
 #define UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY  (1 << 2)
+#define UTIL_QUEUE_INIT_WORK_STEALING             (1 << 3)
+/* Start with one thread, and add threads up to the requested number when
+ * more jobs are queued than there are idle threads.
+ */
+#define UTIL_QUEUE_INIT_SCALE_THREADS             (1 << 4)
 
 #if defined(__GNUC__) && defined(HAVE_LINUX_FUTEX_H)
 #define UTIL_QUEUE_FENCE_FUTEX
@@ -191,6 +206,14 @@ util_queue_fence_wait_timeout(struct util_queue_fence *fence,
 
 typedef void (*util_queue_execute_func)(void *job, int thread_index);
 
+/* Only honored by UTIL_QUEUE_INIT_WORK_STEALING queues. */
+enum util_queue_priority {
+   UTIL_QUEUE_PRIORITY_HIGH,
+   UTIL_QUEUE_PRIORITY_NORMAL,
+   UTIL_QUEUE_PRIORITY_LOW,
+   UTIL_QUEUE_NUM_PRIORITIES,
+};
+
 struct util_queue_job {
    void *job;
    struct util_queue_fence *fence;
@@ -198,6 +221,25 @@ struct util_queue_job {
    util_queue_execute_func cleanup;
 };
 
+/* A job waiting for its dependencies. */
+struct util_queue_blocked_job {
+   struct util_queue_job job;
+   enum util_queue_priority priority;
+   unsigned num_deps;
+   struct util_queue_fence **deps;
+};
+
+/* The jobs of one priority of a work stealing thread. */
+struct util_queue_ring {
+   struct util_queue_job *jobs;
+   unsigned size, head, count;
+};
+
+struct util_queue_deque {
+   mtx_t lock;
+   struct util_queue_ring rings[UTIL_QUEUE_NUM_PRIORITIES];
+};
+
 /* Put this into your context. */
 struct util_queue {
    char name[14]; /* 13 characters = the thread name without the index */
@@ -210,10 +252,25 @@ struct util_queue {
    int num_queued;
    unsigned max_threads;
    unsigned num_threads; /* decreasing this number will terminate threads */
+   unsigned scale_limit; /* UTIL_QUEUE_INIT_SCALE_THREADS stops adding threads here */
+   unsigned num_idle; /* threads waiting for jobs */
    int max_jobs;
    int write_idx, read_idx; /* ring buffer pointers */
    struct util_queue_job *jobs;
 
+   /* With UTIL_QUEUE_INIT_WORK_STEALING, one deque per thread instead of
+    * the ring buffer.  num_queued is decremented without the lock then.
+    */
+   struct util_queue_deque *deques;
+   unsigned next_deque;
+   int num_pending; /* queued, running and blocked jobs */
+   cnd_t idle_cond;
+
+   /* Jobs waiting for their dependencies, protected by lock. */
+   struct util_queue_blocked_job *blocked;
+   unsigned num_blocked, max_blocked;
+   unsigned num_released;
+
    /* for cleanup at exit(), protected by exit_mutex */
    struct list_head head;
 };
@@ -231,6 +288,22 @@ void util_queue_add_job(struct util_queue *queue,
                         struct util_queue_fence *fence,
                         util_queue_execute_func execute,
                         util_queue_execute_func cleanup);
+void util_queue_add_job_with_priority(struct util_queue *queue,
+                                      void *job,
+                                      struct util_queue_fence *fence,
+                                      util_queue_execute_func execute,
+                                      util_queue_execute_func cleanup,
+                                      enum util_queue_priority priority);
+
+/* The job isn't started before all of \p deps are signalled. */
+void util_queue_add_job_after(struct util_queue *queue,
+                              void *job,
+                              struct util_queue_fence *fence,
+                              util_queue_execute_func execute,
+                              util_queue_execute_func cleanup,
+                              enum util_queue_priority priority,
+                              struct util_queue_fence **deps,
+                              unsigned num_deps);
 void util_queue_drop_job(struct util_queue *queue,
                          struct util_queue_fence *fence);
 
@@ -239,6 +312,9 @@ void util_queue_finish(struct util_queue *queue);
 /* Adjust the number of active threads. The new number of threads can't be
  * greater than the initial number of threads at the creation of the queue,
  * and it can't be less than 1.
+ *
+ * With UTIL_QUEUE_INIT_SCALE_THREADS, threads are still only added when
+ * jobs pile up, and never more than the new number.
  */
 void
 util_queue_adjust_num_threads(struct util_queue *queue, unsigned num_threads);